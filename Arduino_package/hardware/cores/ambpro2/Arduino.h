@@ -142,6 +142,7 @@ extern PinDescription g_APinDescription[];
 #include "wiring_analog.h"
 ////    #include "WInterrupts.h"
 #include "wiring_os.h"
+#include "boot_phase.h"
 ////    #include "wiring_watchdog.h"
 ////    #include "wiring_shift.h"
 
@@ -18,11 +18,14 @@
 
 #include "RingBuffer.h"
 #include <string.h>
+#include "wiring.h"
+#include "wiring_os.h"
 
 RingBuffer::RingBuffer(void) {
     memset((void *)_aucBuffer, 0, SERIAL_BUFFER_SIZE);
     _iHead=0;
     _iTail=0;
+    _event=0;
 }
 
 void RingBuffer::store_char(uint8_t c) {
@@ -36,4 +39,33 @@ void RingBuffer::store_char(uint8_t c) {
         _aucBuffer[_iHead] = c;
         _iHead = i;
     }
+
+    // called from the receive interrupt, wake whoever waits for data
+    if (_event) {
+        os_semaphore_release_arduino(_event);
+    }
+    loopWakeup();
+}
+
+bool RingBuffer::wait(uint32_t timeout) {
+    uint32_t start = millis();
+    uint32_t elapsed;
+    uint32_t event;
+
+    if (_event == 0) {
+        event = os_semaphore_create_arduino(1);
+        if (event == 0) {
+            return (_iHead != _iTail);
+        }
+        os_semaphore_wait_arduino(event, 0);
+        _event = event;
+    }
+    while (_iHead == _iTail) {
+        elapsed = millis() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        os_semaphore_wait_arduino(_event, (timeout - elapsed));
+    }
+    return true;
 }
@@ -32,10 +32,13 @@ class RingBuffer {
         volatile uint8_t _aucBuffer[SERIAL_BUFFER_SIZE];
         volatile int _iHead;
         volatile int _iTail;
+        volatile uint32_t _event;   // released by store_char() once wait() has created it
 
     public:
         RingBuffer(void);
         void store_char(uint8_t c);
+        // Sleep until a character is stored or timeout ms have passed, returns true if there is one to read
+        bool wait(uint32_t timeout);
 };
 
 #endif /* _RING_BUFFER_ */
@@ -31,22 +31,26 @@
 // private method to read stream with timeout
 int Stream::timedRead() {
     int c;
+    unsigned long elapsed;
     _startMillis = millis();
     do {
         c = read();
         if (c >= 0) return c;
-    } while ((millis() - _startMillis) < _timeout);
+        elapsed = millis() - _startMillis;
+    } while ((elapsed < _timeout) && waitAvailable(_timeout - elapsed));
     return -1;     // -1 indicates timeout
 }
 
 // private method to peek stream with timeout
 int Stream::timedPeek() {
     int c;
+    unsigned long elapsed;
     _startMillis = millis();
     do {
         c = peek();
         if (c >= 0) return c;
-    } while ((millis() - _startMillis) < _timeout);
+        elapsed = millis() - _startMillis;
+    } while ((elapsed < _timeout) && waitAvailable(_timeout - elapsed));
     return -1;     // -1 indicates timeout
 }
 
@@ -66,6 +70,18 @@ int Stream::peekNextDigit() {
 // Public Methods
 //////////////////////////////////////////////////////////////
 
+bool Stream::waitAvailable(unsigned long timeout) {
+    unsigned long start = millis();
+
+    while (available() <= 0) {
+        if ((millis() - start) >= timeout) {
+            return false;
+        }
+        delay(1);
+    }
+    return true;
+}
+
 void Stream::setTimeout(unsigned long timeout) {
     // sets the maximum number of milliseconds to wait
     _timeout = timeout;
@@ -49,6 +49,10 @@ class Stream : public Print {
         virtual int peek() = 0;
         virtual void flush() = 0;
 
+        // Wait up to timeout ms for data, returns true once available() is non zero.
+        // Streams fed by interrupts sleep until data arrives, the default checks available() every ms.
+        virtual bool waitAvailable(unsigned long timeout);
+
         Stream() { _timeout = 1000; }
 
         // parsing methods
@@ -31,6 +31,7 @@ class UARTClassTri : public HardwareSerial {
         int peek(void);
         int read(void);
         void flush(void);
+        bool waitAvailable(unsigned long timeout) { return _rx_buffer->wait(timeout); }
         size_t write(const uint8_t c);
 //        void IrqHandler(void);
         using Print::write; // pull in write(str) and write(buf, size) from Print
@@ -0,0 +1,271 @@
+#include "ard_dtls.h"
+#include <sockets.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/platform.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+#define DTLS_HANDSHAKE_MIN_TIMEOUT      1000    // ms before the first flight is retransmitted
+
+static mbedtls_ctr_drbg_context* drbg_ctx = NULL;
+static mbedtls_entropy_context* ent_ctx = NULL;
+
+//Adding definition here as complier was not able to find this function
+extern int mbedtls_ssl_conf_psk(mbedtls_ssl_config *conf,
+                        const unsigned char *psk, size_t psk_len,
+                        const unsigned char *psk_identity, size_t psk_identity_len);
+
+static void* dtls_calloc(size_t nelements, size_t elementSize) {
+    size_t size;
+    void *ptr = NULL;
+
+    size = nelements * elementSize;
+    ptr = pvPortMalloc(size);
+
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+
+    return ptr;
+}
+
+static uint32_t dtls_millis(void) {
+    return (xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+static int dtls_net_send(void *ctx, const unsigned char *buf, size_t len) {
+    dtlsclient_context *dtls_client = (dtlsclient_context *)ctx;
+    int ret;
+
+    ret = lwip_send(dtls_client->socket, buf, len, 0);
+    if (ret < 0) {
+        return MBEDTLS_ERR_NET_SEND_FAILED;
+    }
+    return ret;
+}
+
+// mbedTLS passes the handshake retransmission timeout here, and the configured read timeout
+// once the session is up. The read timeout is left at 0, which polls the socket instead of
+// blocking so that get_dtls_receive() can be called from loop()
+static int dtls_net_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout) {
+    dtlsclient_context *dtls_client = (dtlsclient_context *)ctx;
+    struct timeval tv;
+    fd_set read_fds;
+    int ret;
+
+    FD_ZERO(&read_fds);
+    FD_SET(dtls_client->socket, &read_fds);
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    ret = lwip_select((dtls_client->socket + 1), &read_fds, NULL, NULL, &tv);
+    if (ret == 0) {
+        return ((timeout == 0) ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_SSL_TIMEOUT);
+    } else if (ret < 0) {
+        return MBEDTLS_ERR_NET_RECV_FAILED;
+    }
+
+    ret = lwip_recv(dtls_client->socket, buf, len, 0);
+    if (ret < 0) {
+        return MBEDTLS_ERR_NET_RECV_FAILED;
+    }
+    return ret;
+}
+
+static void dtls_set_timer(void *ctx, uint32_t int_ms, uint32_t fin_ms) {
+    dtlsclient_context *dtls_client = (dtlsclient_context *)ctx;
+
+    dtls_client->timer_start = dtls_millis();
+    dtls_client->timer_int_ms = int_ms;
+    dtls_client->timer_fin_ms = fin_ms;
+}
+
+static int dtls_get_timer(void *ctx) {
+    dtlsclient_context *dtls_client = (dtlsclient_context *)ctx;
+    uint32_t elapsed;
+
+    if (dtls_client->timer_fin_ms == 0) {
+        return -1;
+    }
+    elapsed = dtls_millis() - dtls_client->timer_start;
+    if (elapsed >= dtls_client->timer_fin_ms) {
+        return 2;
+    }
+    if (elapsed >= dtls_client->timer_int_ms) {
+        return 1;
+    }
+    return 0;
+}
+
+static void free_dtls_session(dtlsclient_context *dtls_client) {
+    if (dtls_client->ssl != NULL) {
+        mbedtls_ssl_free(dtls_client->ssl);
+        free(dtls_client->ssl);
+        dtls_client->ssl = NULL;
+    }
+    if (dtls_client->conf != NULL) {
+        mbedtls_ssl_config_free(dtls_client->conf);
+        free(dtls_client->conf);
+        dtls_client->conf = NULL;
+    }
+    if (dtls_client->socket >= 0) {
+        lwip_close(dtls_client->socket);
+        dtls_client->socket = -1;
+    }
+}
+
+int start_dtls_client(dtlsclient_context *dtls_client, uint32_t ipAddress, uint16_t port, uint16_t local_port, const unsigned char *psk, size_t psk_len, const char *psk_identity, uint32_t handshake_timeout) {
+    struct sockaddr_in addr;
+    uint32_t start;
+    int ret = 0;
+
+    dtls_client->ssl = NULL;
+    dtls_client->conf = NULL;
+    dtls_client->timer_fin_ms = 0;
+
+    do {
+        dtls_client->socket = lwip_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (dtls_client->socket < 0) {
+            printf("\r\n[ERROR] %s opening socket failed! \n", __FUNCTION__);
+            ret = -1;
+            break;
+        }
+
+        if (local_port != 0) {
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = INADDR_ANY;
+            addr.sin_port = htons(local_port);
+            if (lwip_bind(dtls_client->socket, ((struct sockaddr *)&addr), sizeof(addr)) < 0) {
+                printf("\r\n[ERROR] %s bind to port %d failed! \n", __FUNCTION__, local_port);
+                ret = -1;
+                break;
+            }
+        }
+
+        // a connected UDP socket only delivers datagrams from the peer
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = ipAddress;
+        addr.sin_port = htons(port);
+        if (lwip_connect(dtls_client->socket, ((struct sockaddr *)&addr), sizeof(addr)) < 0) {
+            printf("\r\n[ERROR] %s connect to peer failed! \n", __FUNCTION__);
+            ret = -1;
+            break;
+        }
+
+        mbedtls_platform_set_calloc_free(dtls_calloc, vPortFree);
+
+        dtls_client->ssl = (mbedtls_ssl_context *)malloc(sizeof(mbedtls_ssl_context));
+        dtls_client->conf = (mbedtls_ssl_config *)malloc(sizeof(mbedtls_ssl_config));
+        if (drbg_ctx == NULL) {
+            drbg_ctx = (mbedtls_ctr_drbg_context *)malloc(sizeof(mbedtls_ctr_drbg_context));
+        }
+        dtls_client->ctr_drbg = drbg_ctx;
+        if (ent_ctx == NULL) {
+            ent_ctx = (mbedtls_entropy_context *)malloc(sizeof(mbedtls_entropy_context));
+        }
+        dtls_client->entropy = ent_ctx;
+
+        if ((dtls_client->ssl == NULL) || (dtls_client->conf == NULL) || (dtls_client->ctr_drbg == NULL) || (dtls_client->entropy == NULL)) {
+            printf("\r\n[ERROR] malloc dtls failed! \n");
+            ret = -1;
+            break;
+        }
+        mbedtls_ssl_init(dtls_client->ssl);
+        mbedtls_ssl_config_init(dtls_client->conf);
+        mbedtls_ctr_drbg_init(dtls_client->ctr_drbg);
+        mbedtls_entropy_init(dtls_client->entropy);
+
+        if ((mbedtls_ssl_config_defaults(dtls_client->conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_DATAGRAM, MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
+            printf("\r\n[ERROR] mbedtls ssl config defaults failed! \n");
+            ret = -1;
+            break;
+        }
+
+        if ((ret = mbedtls_ctr_drbg_seed(dtls_client->ctr_drbg, mbedtls_entropy_func, dtls_client->entropy, NULL, 0)) != 0) {
+            printf("\r\n[ERROR] mbedtls_ctr_drbg_seed returned %d\n", ret);
+            ret = -1;
+            break;
+        }
+        mbedtls_ssl_conf_rng(dtls_client->conf, mbedtls_ctr_drbg_random, dtls_client->ctr_drbg);
+
+        if (mbedtls_ssl_conf_psk(dtls_client->conf, psk, psk_len, (const unsigned char *)psk_identity, strlen(psk_identity)) != 0) {
+            printf("\r\n[ERROR] mbedtls conf psk failed! \n");
+            ret = -1;
+            break;
+        }
+
+        if (handshake_timeout < DTLS_HANDSHAKE_MIN_TIMEOUT) {
+            handshake_timeout = DTLS_HANDSHAKE_MIN_TIMEOUT;
+        }
+        mbedtls_ssl_conf_handshake_timeout(dtls_client->conf, DTLS_HANDSHAKE_MIN_TIMEOUT, handshake_timeout);
+        mbedtls_ssl_conf_read_timeout(dtls_client->conf, 0);
+
+        if ((mbedtls_ssl_setup(dtls_client->ssl, dtls_client->conf)) != 0) {
+            printf("\r\n[ERROR] mbedtls ssl setup failed! \n");
+            ret = -1;
+            break;
+        }
+        mbedtls_ssl_set_bio(dtls_client->ssl, dtls_client, dtls_net_send, NULL, dtls_net_recv_timeout);
+        mbedtls_ssl_set_timer_cb(dtls_client->ssl, dtls_client, dtls_set_timer, dtls_get_timer);
+
+        // flights are retransmitted by mbedTLS, WANT_READ only comes back when a datagram was dropped
+        start = dtls_millis();
+        do {
+            ret = mbedtls_ssl_handshake(dtls_client->ssl);
+        } while (((ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE)) && ((dtls_millis() - start) < handshake_timeout));
+
+        if (ret != 0) {
+            printf("\r\n[ERROR] mbedtls dtls handshake failed: -0x%04X \n", -ret);
+            ret = -1;
+        }
+    } while (0);
+
+    if (ret < 0) {
+        free_dtls_session(dtls_client);
+        return -1;
+    }
+    return dtls_client->socket;
+}
+
+void stop_dtls_client(dtlsclient_context *dtls_client) {
+    if (dtls_client->ssl != NULL) {
+        mbedtls_ssl_close_notify(dtls_client->ssl);
+    }
+    free_dtls_session(dtls_client);
+}
+
+int send_dtls_data(dtlsclient_context *dtls_client, const uint8_t *data, uint16_t len) {
+    int ret = -1;
+
+    if (dtls_client->ssl != NULL) {
+        ret = mbedtls_ssl_write(dtls_client->ssl, data, len);
+    }
+
+    return ((ret < 0) ? -1 : ret);
+}
+
+int get_dtls_receive(dtlsclient_context *dtls_client, uint8_t *data, int length) {
+    int ret;
+
+    if (dtls_client->ssl == NULL) {
+        return -1;
+    }
+
+    ret = mbedtls_ssl_read(dtls_client->ssl, data, length);
+    if (ret > 0) {
+        return ret;
+    }
+    if ((ret == 0) || (ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE) || (ret == MBEDTLS_ERR_SSL_TIMEOUT)) {
+        return DTLS_ERR_WANT_READ;
+    }
+    if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+        return DTLS_ERR_CLOSED;
+    }
+    printf("\r\n[ERROR] %s mbedtls ssl read failed: -0x%04X \n", __FUNCTION__, -ret);
+    return -1;
+}
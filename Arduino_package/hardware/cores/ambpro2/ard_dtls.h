@@ -0,0 +1,36 @@
+#ifndef ARD_DTLS_H
+#define ARD_DTLS_H
+
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+
+#define DTLS_ERR_WANT_READ      0           // no datagram waiting
+#define DTLS_ERR_CLOSED         -2          // peer sent close_notify
+
+typedef struct {
+    int socket;                             // UDP socket connected to the peer, owned by the context
+    uint32_t timer_start;                   // handshake retransmission timer, see mbedtls_ssl_set_timer_cb()
+    uint32_t timer_int_ms;
+    uint32_t timer_fin_ms;
+    mbedtls_ssl_context *ssl;
+    mbedtls_ssl_config *conf;
+    mbedtls_ctr_drbg_context *ctr_drbg;
+    mbedtls_entropy_context *entropy;
+} dtlsclient_context;
+
+// Open a UDP socket to ipAddress:port and run a DTLS 1.2 PSK handshake, psk is the binary key
+// Returns the socket if successful, -1 on failure or after handshake_timeout ms
+int start_dtls_client(dtlsclient_context *dtls_client, uint32_t ipAddress, uint16_t port, uint16_t local_port, const unsigned char *psk, size_t psk_len, const char *psk_identity, uint32_t handshake_timeout);
+
+// Send close_notify, close the socket and free the session
+void stop_dtls_client(dtlsclient_context *dtls_client);
+
+// Send one record, returns len if successful, -1 on error
+int send_dtls_data(dtlsclient_context *dtls_client, const uint8_t *data, uint16_t len);
+
+// Never blocks, returns the length of one received datagram, DTLS_ERR_WANT_READ if none is waiting,
+// DTLS_ERR_CLOSED or -1 if the session is gone
+int get_dtls_receive(dtlsclient_context *dtls_client, uint8_t *data, int length);
+
+#endif
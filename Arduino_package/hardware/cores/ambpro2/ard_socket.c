@@ -9,6 +9,8 @@
 #define MAX_SEND_SIZE 256
 #define UDP_SERVER_PORT 5002
 #define TCP_SERVER_PORT 5003
+// longest finite sock_select wait, lwip_select computes tv_sec * 1000 + tv_usec / 1000 in 32 bits
+#define ARD_SOCK_SELECT_MAX_MS  2147482000UL
 
 //static int EXAMPLE_IPV6 = 0;
 
@@ -327,10 +329,19 @@ int get_available(int sock) {
     struct sockaddr_in cli_addr;
 
     socklen_t client = sizeof(cli_addr);
+    int flags = fcntl(sock, F_GETFL, 0);
+    int nonblocking = ((flags != -1) && (flags & O_NONBLOCK));
 
     do {
         client_fd = lwip_accept(sock, ((struct sockaddr *)&cli_addr), &client);
         if (client_fd < 0) {
+            // a non-blocking server returns straight away when no client is waiting, which is not an error
+            if (nonblocking) {
+                if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                    return -1;
+                }
+                break;
+            }
             err = get_sock_errno(sock);
             if (err != EAGAIN) {
                 break;
@@ -354,6 +365,87 @@ int get_available(int sock) {
     }
 }
 
+int get_peer_addr(int sock, uint32_t *peer_addr, uint16_t *peer_port) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    if (lwip_getpeername(sock, ((struct sockaddr *)&addr), &len) < 0) {
+        return -1;
+    }
+    *peer_addr = addr.sin_addr.s_addr;
+    *peer_port = ntohs(addr.sin_port);
+    return 0;
+}
+
+// Wait until one of the sockets is ready. events[i] holds the ARD_SOCK_ flags to wait for on
+// socks[i] and is replaced with the ones that are ready. Returns the number of ready sockets.
+int sock_select(const int *socks, uint8_t *events, int count, uint32_t timeout_ms) {
+    fd_set readfds;
+    fd_set writefds;
+    fd_set errfds;
+    struct timeval tv;
+    int maxfd = -1;
+    int ret;
+
+    FD_ZERO(&readfds);
+    FD_ZERO(&writefds);
+    FD_ZERO(&errfds);
+    for (int i = 0; i < count; i++) {
+        if (socks[i] < 0) {
+            continue;
+        }
+        if (events[i] & ARD_SOCK_READ) {
+            FD_SET(socks[i], &readfds);
+        }
+        if (events[i] & ARD_SOCK_WRITE) {
+            FD_SET(socks[i], &writefds);
+        }
+        FD_SET(socks[i], &errfds);
+        if (socks[i] > maxfd) {
+            maxfd = socks[i];
+        }
+    }
+    if (maxfd < 0) {
+        return 0;
+    }
+
+    // lwip_select converts the timeout to ms in a 32-bit long, so 0xFFFFFFFF waits without a
+    // timeout and anything else is kept below the overflow
+    if (timeout_ms != 0xFFFFFFFF) {
+        if (timeout_ms > ARD_SOCK_SELECT_MAX_MS) {
+            timeout_ms = ARD_SOCK_SELECT_MAX_MS;
+        }
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+    }
+    ret = lwip_select(maxfd + 1, &readfds, &writefds, &errfds, (timeout_ms != 0xFFFFFFFF) ? &tv : NULL);
+    if (ret <= 0) {
+        memset(events, 0, count);
+        return ret;
+    }
+
+    ret = 0;
+    for (int i = 0; i < count; i++) {
+        uint8_t ready = 0;
+        if (socks[i] >= 0) {
+            if (FD_ISSET(socks[i], &readfds)) {
+                ready |= ARD_SOCK_READ;
+            }
+            if (FD_ISSET(socks[i], &writefds)) {
+                ready |= ARD_SOCK_WRITE;
+            }
+            if (FD_ISSET(socks[i], &errfds)) {
+                ready |= ARD_SOCK_ERROR;
+            }
+        }
+        events[i] = ready;
+        if (ready) {
+            ret++;
+        }
+    }
+    return ret;
+}
+
 #if 0
 int get_available_v6(int sock) {
     int enable = 1;
@@ -446,13 +538,13 @@ int sendto_data_v6(int sock, const void *send_data, size_t len, uint32_t peer_ip
 int get_receive(int sock, uint8_t *data, int length, int flag, uint32_t *peer_addr, uint16_t *peer_port) {
     int ret = 0;
     struct sockaddr from;
-    socklen_t fromlen;
+    socklen_t fromlen = sizeof(from);
 
     uint8_t backup_recvtimeout = 0;
     int backup_recv_timeout, recv_timeout;
-    socklen_t len;
+    socklen_t len = sizeof(backup_recv_timeout);
 
-    if (flag & 0x01) {
+    if ((flag & ARD_MSG_PEEK) && !(flag & ARD_MSG_DONTWAIT)) {
         // for MSG_PEEK, we try to peek packets by changing receiving timeout to 10ms
         ret = lwip_getsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &backup_recv_timeout, &len);
         if (ret >= 0) {
@@ -474,7 +566,7 @@ int get_receive(int sock, uint8_t *data, int length, int flag, uint32_t *peer_ad
         }
     }
 
-    if ((flag & 0x01) && (backup_recvtimeout == 1)) {
+    if (backup_recvtimeout == 1) {
         // restore receiving timeout
         lwip_setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &backup_recv_timeout, sizeof(recv_timeout));
     }
@@ -16,17 +16,28 @@ int start_client(uint32_t ipAddress, uint16_t port, uint8_t portMode);
 int get_sock_errno(int sock);
 int set_sock_recv_timeout(int sock, int timeout);
 void close_socket(int sock);
+
+// readiness flags for sock_select
+#define ARD_SOCK_READ       0x01
+#define ARD_SOCK_WRITE      0x02
+#define ARD_SOCK_ERROR      0x04
+// timeout_ms 0xFFFFFFFF waits until a socket is ready, other timeouts are limited to about 24 days
+int sock_select(const int *socks, uint8_t *events, int count, uint32_t timeout_ms);
 //int enable_ipv6(void);
 //int get_ipv6_status(void);
 
 // TCP
 int sock_listen(int sock, int max);
 int get_available(int sock);
+int get_peer_addr(int sock, uint32_t *peer_addr, uint16_t *peer_port);
 //int get_available_v6(int sock);
 int recv_data(int sock, const uint8_t *data, uint32_t len, int flag);
 int send_data(int sock, const uint8_t *data, uint32_t len, int flag);
 
 // UDP
+// flag bits for get_receive, same values as the lwip MSG_ flags
+#define ARD_MSG_PEEK        0x01
+#define ARD_MSG_DONTWAIT    0x08
 int get_receive(int sock, uint8_t *data, int length, int flag, uint32_t *peer_addr, uint16_t *peer_port);
 //int get_receive_v6(int server_fd, void *recv_data, int len, int flags, uint32_t *peer_addr, uint16_t *peer_port);
 int sendto_data(int sock, const uint8_t *data, uint32_t len, uint32_t peer_ip, uint16_t peer_port);
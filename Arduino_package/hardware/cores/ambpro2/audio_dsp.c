@@ -0,0 +1,333 @@
+#include "audio_dsp.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include <arm_acle.h>
+#define AUDIO_DSP_SIMD      1
+#else
+#define AUDIO_DSP_SIMD      0
+#endif
+
+#ifndef M_PI
+#define M_PI                3.14159265358979323846
+#endif
+
+#define BIQUAD_SHIFT        14
+
+static inline int16_t sat16(int32_t v) {
+#if AUDIO_DSP_SIMD
+    return (int16_t)__ssat(v, 16);
+#else
+    if (v > 32767) {
+        return 32767;
+    }
+    if (v < -32768) {
+        return -32768;
+    }
+    return (int16_t)v;
+#endif
+}
+
+#if AUDIO_DSP_SIMD
+// Two halfwords as one word, low halfword first, the order the dual MAC instructions expect
+static inline int32_t pack16(int16_t low, int16_t high) {
+    return (int32_t)(((uint32_t)(uint16_t)low) | ((uint32_t)(uint16_t)high << 16));
+}
+
+static inline int32_t load16x2(const int16_t *p) {
+    int32_t v;
+    memcpy(&v, p, sizeof(v));       // samples may only be halfword aligned
+    return v;
+}
+#endif
+
+void AudioDspLevel(const int16_t *samples, uint32_t count, audio_dsp_level_t *level) {
+    int64_t sum = 0;
+    int32_t peak = 0;
+    uint32_t clipped = 0;
+    uint32_t i = 0;
+
+    memset(level, 0, sizeof(audio_dsp_level_t));
+    if ((samples == NULL) || (count == 0)) {
+        return;
+    }
+#if AUDIO_DSP_SIMD
+    for (; (i + 1) < count; i += 2) {
+        int32_t pair = load16x2(&samples[i]);
+        sum = __smlald(pair, pair, sum);
+    }
+#endif
+    for (; i < count; i++) {
+        sum += (int32_t)samples[i] * samples[i];
+    }
+    for (i = 0; i < count; i++) {
+        int32_t v = samples[i];
+        if ((v == 32767) || (v == -32768)) {
+            clipped++;
+        }
+        if (v < 0) {
+            v = -v;
+        }
+        if (v > peak) {
+            peak = v;
+        }
+    }
+    level->rms = sqrtf((float)((double)sum / count)) / 32768.0f;
+    level->peak = (int16_t)((peak > 32767) ? 32767 : peak);
+    level->clipped = clipped;
+}
+
+int AudioDspBiquadSet(audio_dsp_biquad_t *bq, uint8_t stage, float b0, float b1, float b2, float a1, float a2) {
+    float c[5] = {b0, b1, b2, -a1, -a2};
+
+    if (stage >= AUDIO_DSP_BIQUAD_MAX_STAGES) {
+        return -1;
+    }
+    for (int i = 0; i < 5; i++) {
+        float q = roundf(c[i] * (1 << BIQUAD_SHIFT));
+        if ((q > 32767.0f) || (q < -32768.0f)) {
+            return -1;
+        }
+        bq->coeffs[stage][i] = (int16_t)q;
+    }
+    bq->coeffs[stage][5] = 0;
+    memset(bq->state[stage], 0, sizeof(bq->state[stage]));
+    if (bq->stages <= stage) {
+        bq->stages = stage + 1;
+    }
+    return 0;
+}
+
+static int biquad_design(audio_dsp_biquad_t *bq, uint8_t stage, float sample_rate, float freq, float q, int type) {
+    float w0, cw, alpha, a0;
+    float b0, b1, b2;
+
+    if ((sample_rate <= 0.0f) || (freq <= 0.0f) || (freq >= (sample_rate / 2)) || (q <= 0.0f)) {
+        return -1;
+    }
+    w0 = 2.0f * (float)M_PI * freq / sample_rate;
+    cw = cosf(w0);
+    alpha = sinf(w0) / (2.0f * q);
+    a0 = 1.0f + alpha;
+    switch (type) {
+        case 0:
+            b0 = (1.0f - cw) / 2.0f;
+            b1 = 1.0f - cw;
+            b2 = b0;
+            break;
+        case 1:
+            b0 = (1.0f + cw) / 2.0f;
+            b1 = -(1.0f + cw);
+            b2 = b0;
+            break;
+        default:
+            b0 = alpha;
+            b1 = 0.0f;
+            b2 = -alpha;
+            break;
+    }
+    return AudioDspBiquadSet(bq, stage, (b0 / a0), (b1 / a0), (b2 / a0), ((-2.0f * cw) / a0), ((1.0f - alpha) / a0));
+}
+
+int AudioDspBiquadLowPass(audio_dsp_biquad_t *bq, uint8_t stage, float sample_rate, float freq, float q) {
+    return biquad_design(bq, stage, sample_rate, freq, q, 0);
+}
+
+int AudioDspBiquadHighPass(audio_dsp_biquad_t *bq, uint8_t stage, float sample_rate, float freq, float q) {
+    return biquad_design(bq, stage, sample_rate, freq, q, 1);
+}
+
+int AudioDspBiquadBandPass(audio_dsp_biquad_t *bq, uint8_t stage, float sample_rate, float freq, float q) {
+    return biquad_design(bq, stage, sample_rate, freq, q, 2);
+}
+
+void AudioDspBiquadReset(audio_dsp_biquad_t *bq) {
+    memset(bq->state, 0, sizeof(bq->state));
+}
+
+void AudioDspBiquadProcess(audio_dsp_biquad_t *bq, const int16_t *in, int16_t *out, uint32_t count) {
+    for (uint8_t s = 0; s < bq->stages; s++) {
+        const int16_t *src = (s == 0) ? in : out;
+        const int16_t *c = bq->coeffs[s];
+        int16_t x1 = bq->state[s][0];
+        int16_t x2 = bq->state[s][1];
+        int16_t y1 = bq->state[s][2];
+        int16_t y2 = bq->state[s][3];
+#if AUDIO_DSP_SIMD
+        int32_t c01 = load16x2(&c[0]);      // b0, b1
+        int32_t c23 = load16x2(&c[2]);      // b2, -a1
+        int32_t c45 = load16x2(&c[4]);      // -a2, 0
+#endif
+
+        for (uint32_t n = 0; n < count; n++) {
+            int16_t x0 = src[n];
+            int64_t acc = (1 << (BIQUAD_SHIFT - 1));
+            int16_t y0;
+#if AUDIO_DSP_SIMD
+            acc = __smlald(pack16(x0, x1), c01, acc);
+            acc = __smlald(pack16(x2, y1), c23, acc);
+            acc = __smlald(pack16(y2, 0), c45, acc);
+#else
+            acc += (int32_t)c[0] * x0 + (int32_t)c[1] * x1 + (int32_t)c[2] * x2;
+            acc += (int32_t)c[3] * y1 + (int32_t)c[4] * y2;
+#endif
+            y0 = sat16((int32_t)(acc >> BIQUAD_SHIFT));
+            x2 = x1;
+            x1 = x0;
+            y2 = y1;
+            y1 = y0;
+            out[n] = y0;
+        }
+        bq->state[s][0] = x1;
+        bq->state[s][1] = x2;
+        bq->state[s][2] = y1;
+        bq->state[s][3] = y2;
+    }
+}
+
+int AudioDspFftInit(audio_dsp_fft_t *fft, uint16_t size) {
+    float *mem;
+
+    if ((size < AUDIO_DSP_FFT_MIN_SIZE) || (size > AUDIO_DSP_FFT_MAX_SIZE) || (size & (size - 1))) {
+        return -1;
+    }
+    if (fft->size) {
+        AudioDspFftDeinit(fft);
+    }
+    // twiddle, window, work and power in one block
+    mem = (float *)malloc(((size * 3) + (size / 2) + 1) * sizeof(float));
+    if (mem == NULL) {
+        return -1;
+    }
+    fft->size = size;
+    fft->twiddle = mem;
+    fft->window = fft->twiddle + size;
+    fft->work = fft->window + size;
+    fft->power = fft->work + size;
+    for (uint16_t k = 0; k < (size / 2); k++) {
+        double a = -2.0 * M_PI * k / size;
+        fft->twiddle[2 * k] = (float)cos(a);
+        fft->twiddle[(2 * k) + 1] = (float)sin(a);
+    }
+    // periodic Hann, scaled to undo the 16 bit sample range
+    for (uint16_t i = 0; i < size; i++) {
+        fft->window[i] = (float)((0.5 - (0.5 * cos(2.0 * M_PI * i / size))) / 32768.0);
+    }
+    memset(fft->power, 0, ((size / 2) + 1) * sizeof(float));
+    return 0;
+}
+
+void AudioDspFftDeinit(audio_dsp_fft_t *fft) {
+    free(fft->twiddle);
+    memset(fft, 0, sizeof(audio_dsp_fft_t));
+}
+
+// In place radix 2 complex FFT of m points, twiddle holds the factors of a 2 * m point transform
+static void fft_complex(float *data, uint16_t m, const float *twiddle) {
+    uint16_t j = 0;
+
+    for (uint16_t i = 0; i < (m - 1); i++) {
+        if (i < j) {
+            float tr = data[2 * i];
+            float ti = data[(2 * i) + 1];
+            data[2 * i] = data[2 * j];
+            data[(2 * i) + 1] = data[(2 * j) + 1];
+            data[2 * j] = tr;
+            data[(2 * j) + 1] = ti;
+        }
+        uint16_t bit = m >> 1;
+        while (j & bit) {
+            j ^= bit;
+            bit >>= 1;
+        }
+        j |= bit;
+    }
+
+    for (uint16_t len = 2; len <= m; len <<= 1) {
+        uint16_t half = len >> 1;
+        uint16_t step = (uint16_t)((2 * m) / len);     // in units of the 2 * m point table
+        for (uint16_t start = 0; start < m; start += len) {
+            for (uint16_t k = 0; k < half; k++) {
+                float wr = twiddle[2 * (k * step)];
+                float wi = twiddle[(2 * (k * step)) + 1];
+                float *a = &data[2 * (start + k)];
+                float *b = &data[2 * (start + k + half)];
+                float tr = (b[0] * wr) - (b[1] * wi);
+                float ti = (b[0] * wi) + (b[1] * wr);
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+const float *AudioDspFftPower(audio_dsp_fft_t *fft, const int16_t *samples) {
+    uint16_t n = fft->size;
+    uint16_t m = n / 2;
+    float *z = fft->work;
+    // a full scale sine centred on a bin reads 1.0, the Hann window sums to n / 2
+    float scale = 16.0f / ((float)n * n);
+
+    if (n == 0) {
+        return NULL;
+    }
+    // pack even and odd samples as the real and imaginary parts of an n / 2 point transform
+    for (uint16_t i = 0; i < n; i++) {
+        z[i] = samples[i] * fft->window[i];
+    }
+    fft_complex(z, m, fft->twiddle);
+
+    fft->power[0] = ((z[0] + z[1]) * (z[0] + z[1])) * scale;
+    fft->power[m] = ((z[0] - z[1]) * (z[0] - z[1])) * scale;
+    for (uint16_t k = 1; k < m; k++) {
+        float zr = z[2 * k];
+        float zi = z[(2 * k) + 1];
+        float cr = z[2 * (m - k)];
+        float ci = -z[(2 * (m - k)) + 1];
+        float er = (zr + cr) * 0.5f;            // spectrum of the even samples
+        float ei = (zi + ci) * 0.5f;
+        float or_ = (zi - ci) * 0.5f;           // spectrum of the odd samples, -j (z - conj) / 2
+        float oi = -(zr - cr) * 0.5f;
+        float wr = fft->twiddle[2 * k];
+        float wi = fft->twiddle[(2 * k) + 1];
+        float xr = er + ((or_ * wr) - (oi * wi));
+        float xi = ei + ((or_ * wi) + (oi * wr));
+        fft->power[k] = ((xr * xr) + (xi * xi)) * scale;
+    }
+    return fft->power;
+}
+
+float AudioDspBandEnergy(const audio_dsp_fft_t *fft, float sample_rate, float low, float high) {
+    int32_t first, last;
+    float sum = 0.0f;
+
+    if ((fft->size == 0) || (sample_rate <= 0.0f) || (high < low)) {
+        return 0.0f;
+    }
+    first = (int32_t)ceilf(low * fft->size / sample_rate);
+    last = (int32_t)floorf(high * fft->size / sample_rate);
+    if (first < 0) {
+        first = 0;
+    }
+    if (last > (fft->size / 2)) {
+        last = fft->size / 2;
+    }
+    for (int32_t k = first; k <= last; k++) {
+        sum += fft->power[k];
+    }
+    return sum;
+}
+
+void AudioDspBandEnergies(const audio_dsp_fft_t *fft, float sample_rate, const float *edges, uint8_t count, float *energies) {
+    float bin_hz = sample_rate / fft->size;
+
+    for (uint8_t i = 0; i < count; i++) {
+        // the upper edge belongs to the next band
+        energies[i] = AudioDspBandEnergy(fft, sample_rate, edges[i], (edges[i + 1] - (bin_hz / 2)));
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <stdint.h>
+
+// Analysis kernels for 16 bit PCM blocks. The integer kernels use the Cortex-M33 DSP
+// extension (dual 16 bit multiply accumulate) when the compiler targets it and fall back
+// to plain C otherwise, so the same file also builds on a host for checking results.
+
+#define AUDIO_DSP_BIQUAD_MAX_STAGES     4
+#define AUDIO_DSP_FFT_MIN_SIZE          16
+#define AUDIO_DSP_FFT_MAX_SIZE          4096
+
+typedef struct audio_dsp_level_s {
+    float rms;                  // 0.0 to 1.0 of full scale
+    int16_t peak;               // largest absolute sample, 32767 when clipping
+    uint32_t clipped;           // samples at -32768 or 32767
+} audio_dsp_level_t;
+
+// Cascade of second order sections, Direct Form I with Q14 coefficients
+typedef struct audio_dsp_biquad_s {
+    uint8_t stages;
+    int16_t coeffs[AUDIO_DSP_BIQUAD_MAX_STAGES][6];     // b0, b1, b2, -a1, -a2, unused
+    int16_t state[AUDIO_DSP_BIQUAD_MAX_STAGES][4];      // x[n-1], x[n-2], y[n-1], y[n-2]
+} audio_dsp_biquad_t;
+
+typedef struct audio_dsp_fft_s {
+    uint16_t size;              // real input samples, a power of two
+    float *twiddle;             // size / 2 complex factors
+    float *window;              // Hann window, size entries
+    float *work;                // size floats, complex spectrum of size / 2 points
+    float *power;               // size / 2 + 1 bins, squared magnitude normalised to full scale
+} audio_dsp_fft_t;
+
+// RMS, peak and clip count of count samples
+void AudioDspLevel(const int16_t *samples, uint32_t count, audio_dsp_level_t *level);
+
+// Set one section from float coefficients normalised to a0 = 1, |b|, |a| < 2
+// Returns 0 if successful, -1 if stage is out of range or a coefficient does not fit
+int AudioDspBiquadSet(audio_dsp_biquad_t *bq, uint8_t stage, float b0, float b1, float b2, float a1, float a2);
+
+// RBJ cookbook designs for one section, q = 0.7071 gives a Butterworth response
+int AudioDspBiquadLowPass(audio_dsp_biquad_t *bq, uint8_t stage, float sample_rate, float freq, float q);
+int AudioDspBiquadHighPass(audio_dsp_biquad_t *bq, uint8_t stage, float sample_rate, float freq, float q);
+int AudioDspBiquadBandPass(audio_dsp_biquad_t *bq, uint8_t stage, float sample_rate, float freq, float q);
+
+void AudioDspBiquadReset(audio_dsp_biquad_t *bq);
+
+// Filter count samples, in and out may be the same buffer
+void AudioDspBiquadProcess(audio_dsp_biquad_t *bq, const int16_t *in, int16_t *out, uint32_t count);
+
+// Allocate the tables for a size point real FFT
+// Returns 0 if successful, -1 if size is not a supported power of two or allocation failed
+int AudioDspFftInit(audio_dsp_fft_t *fft, uint16_t size);
+
+void AudioDspFftDeinit(audio_dsp_fft_t *fft);
+
+// Window size samples and fill fft->power, returns fft->power
+const float *AudioDspFftPower(audio_dsp_fft_t *fft, const int16_t *samples);
+
+// Sum of fft->power over the bins between low and high Hz, both included
+float AudioDspBandEnergy(const audio_dsp_fft_t *fft, float sample_rate, float low, float high);
+
+// Energies of count adjacent bands, band i spans edges[i] to edges[i + 1] Hz
+void AudioDspBandEnergies(const audio_dsp_fft_t *fft, float sample_rate, const float *edges, uint8_t count, float *energies);
+
+#endif
@@ -0,0 +1,290 @@
+#include <math.h>
+#include "audio_gate_drv.h"
+#include "audio_dsp.h"
+#include "mmf2_module.h"
+#include "us_ticker_api.h"
+
+#define AUDIO_GATE_SILENCE_DB       -100.0f
+#define AUDIO_GATE_NOISE_RISE_DB    1.0f        // per second, sustained sound becomes background
+
+typedef struct audio_gate_ctx_s {
+    void *parent;
+    audio_gate_params_t params;
+    audio_gate_stats_t stats;
+    audio_gate_cb_t callback;
+    void *cb_arg;
+    mm_context_t *next;
+
+    int16_t *window;
+    uint32_t fill;
+    uint32_t samples_per_ms;    // all channels
+    uint32_t last_active;       // stream position of the last active hop
+    uint32_t last_forward;      // stream position of the last forwarded window
+    uint8_t seen_active;
+    uint8_t noise_valid;
+} audio_gate_ctx_t;
+
+static float audio_gate_level_db(const int16_t *samples, uint32_t count) {
+    audio_dsp_level_t level;
+
+    AudioDspLevel(samples, count, &level);
+    if (level.rms <= 0.00001f) {
+        return AUDIO_GATE_SILENCE_DB;
+    }
+    return (20.0f * log10f(level.rms));
+}
+
+static int audio_gate_is_active(audio_gate_ctx_t *ctx, float level_db) {
+    audio_gate_params_t *params = &ctx->params;
+    float hop_s = (float)params->hop_samples / (float)(ctx->samples_per_ms * 1000);
+    float rise;
+
+    switch (params->mode) {
+        case AUDIO_GATE_ENERGY:
+            return (level_db >= params->threshold_db);
+        case AUDIO_GATE_VAD:
+            // the floor follows quiet passages at once and loud ones slowly
+            if (!ctx->noise_valid || (level_db < ctx->stats.noise_db)) {
+                ctx->stats.noise_db = level_db;
+                ctx->noise_valid = 1;
+            } else {
+                rise = level_db - ctx->stats.noise_db;
+                if (rise > (AUDIO_GATE_NOISE_RISE_DB * hop_s)) {
+                    rise = AUDIO_GATE_NOISE_RISE_DB * hop_s;
+                }
+                ctx->stats.noise_db += rise;
+            }
+            return ((level_db >= params->threshold_db) && (level_db >= (ctx->stats.noise_db + params->vad_margin_db)));
+        default:
+            return 1;
+    }
+}
+
+static audio_gate_decision_t audio_gate_decide(audio_gate_ctx_t *ctx, uint32_t end, float level_db) {
+    uint32_t since;
+
+    if (audio_gate_is_active(ctx, level_db)) {
+        ctx->last_active = end;
+        ctx->seen_active = 1;
+        return AUDIO_GATE_ACTIVE;
+    }
+    if (ctx->seen_active) {
+        since = (end - ctx->last_active) / ctx->samples_per_ms;
+        if (since < ctx->params.hangover_ms) {
+            return AUDIO_GATE_HANGOVER;
+        }
+    }
+    if (ctx->params.max_skip_ms) {
+        since = (end - ctx->last_forward) / ctx->samples_per_ms;
+        if (since >= ctx->params.max_skip_ms) {
+            return AUDIO_GATE_FORCED;
+        }
+    }
+    return AUDIO_GATE_SKIPPED;
+}
+
+static void audio_gate_forward(audio_gate_ctx_t *ctx, mm_queue_item_t *input_item) {
+    mm_queue_item_t item;
+    uint32_t start, elapsed;
+
+    if ((ctx->next == NULL) || (ctx->next->module == NULL) || (ctx->next->module->handle == NULL)) {
+        return;
+    }
+    // the window buffer is only read by the next module and is ours again once it returns
+    memset(&item, 0, sizeof(mm_queue_item_t));
+    item.data_addr = (uint32_t)ctx->window;
+    item.size = ctx->params.window_samples * sizeof(int16_t);
+    item.timestamp = input_item->timestamp;
+    item.hw_timestamp = input_item->hw_timestamp;
+    item.type = input_item->type;
+    start = us_ticker_read();
+    ctx->next->module->handle(ctx->next->priv, &item, NULL);
+    elapsed = us_ticker_read() - start;
+    if (elapsed > ctx->stats.max_next_us) {
+        ctx->stats.max_next_us = elapsed;
+    }
+}
+
+static void audio_gate_window(audio_gate_ctx_t *ctx, mm_queue_item_t *input_item, uint32_t end) {
+    uint32_t window = ctx->params.window_samples;
+    uint32_t hop = ctx->params.hop_samples;
+    audio_gate_decision_t decision;
+    float level_db;
+
+    // only the newest hop decides, the rest of the window was judged with earlier windows
+    level_db = audio_gate_level_db(&ctx->window[window - hop], hop);
+    ctx->stats.level_db = level_db;
+    decision = audio_gate_decide(ctx, end, level_db);
+    ctx->stats.windows++;
+    if (ctx->callback) {
+        ctx->callback(decision, (end - window), level_db, ctx->cb_arg);
+    }
+    if (decision == AUDIO_GATE_SKIPPED) {
+        ctx->stats.skipped++;
+    } else {
+        if (decision == AUDIO_GATE_FORCED) {
+            ctx->stats.forced++;
+        }
+        ctx->stats.forwarded++;
+        ctx->last_forward = end;
+        audio_gate_forward(ctx, input_item);
+    }
+    // keep the overlap for the next window
+    memmove(ctx->window, &ctx->window[hop], ((window - hop) * sizeof(int16_t)));
+    ctx->fill = window - hop;
+}
+
+int audio_gate_handle(void *p, void *input, void *output) {
+    (void)output;
+    audio_gate_ctx_t *ctx = (audio_gate_ctx_t *)p;
+    mm_queue_item_t *input_item = (mm_queue_item_t *)input;
+    const int16_t *samples = (const int16_t *)input_item->data_addr;
+    uint32_t count = input_item->size / sizeof(int16_t);
+    uint32_t n;
+
+    if (ctx->window == NULL) {
+        return 0;
+    }
+    while (count) {
+        n = ctx->params.window_samples - ctx->fill;
+        if (n > count) {
+            n = count;
+        }
+        memcpy(&ctx->window[ctx->fill], samples, (n * sizeof(int16_t)));
+        ctx->fill += n;
+        ctx->stats.samples += n;
+        samples += n;
+        count -= n;
+        if (ctx->fill == ctx->params.window_samples) {
+            audio_gate_window(ctx, input_item, ctx->stats.samples);
+        }
+    }
+    return 0;
+}
+
+int audio_gate_control(void *p, int cmd, int arg) {
+    audio_gate_ctx_t *ctx = (audio_gate_ctx_t *)p;
+
+    switch (cmd) {
+        case CMD_AUDIO_GATE_SET_PARAMS:
+            memcpy(&ctx->params, (void *)arg, sizeof(audio_gate_params_t));
+            break;
+        case CMD_AUDIO_GATE_GET_PARAMS:
+            memcpy((void *)arg, &ctx->params, sizeof(audio_gate_params_t));
+            break;
+        case CMD_AUDIO_GATE_SET_NEXT:
+            ctx->next = (mm_context_t *)arg;
+            break;
+        case CMD_AUDIO_GATE_SET_CALLBACK:
+            ctx->callback = (audio_gate_cb_t)arg;
+            break;
+        case CMD_AUDIO_GATE_SET_CB_ARG:
+            ctx->cb_arg = (void *)arg;
+            break;
+        case CMD_AUDIO_GATE_GET_STATS:
+            memcpy((void *)arg, &ctx->stats, sizeof(audio_gate_stats_t));
+            break;
+        case CMD_AUDIO_GATE_APPLY: {
+            audio_gate_params_t *params = &ctx->params;
+            free(ctx->window);
+            ctx->window = NULL;
+            if ((params->window_samples == 0) || (params->hop_samples == 0) || (params->hop_samples > params->window_samples)) {
+                printf("\r\n[ERROR] Audio gate window %lu samples, hop %lu samples is invalid\n", params->window_samples, params->hop_samples);
+                return -1;
+            }
+            ctx->samples_per_ms = (params->sample_rate * params->channels) / 1000;
+            if (ctx->samples_per_ms == 0) {
+                ctx->samples_per_ms = 1;
+            }
+            ctx->window = (int16_t *)malloc(params->window_samples * sizeof(int16_t));
+            if (ctx->window == NULL) {
+                printf("\r\n[ERROR] Audio gate window allocation failed\n");
+                return -1;
+            }
+            ctx->fill = 0;
+            ctx->last_active = 0;
+            ctx->last_forward = 0;
+            ctx->seen_active = 0;
+            ctx->noise_valid = 0;
+            memset(&ctx->stats, 0, sizeof(audio_gate_stats_t));
+            ctx->stats.level_db = AUDIO_GATE_SILENCE_DB;
+            ctx->stats.noise_db = AUDIO_GATE_SILENCE_DB;
+            break;
+        }
+        default:
+            break;
+    }
+    return 0;
+}
+
+void *audio_gate_destroy(void *p) {
+    audio_gate_ctx_t *ctx = (audio_gate_ctx_t *)p;
+    if (ctx) {
+        free(ctx->window);
+        free(ctx);
+    }
+    return NULL;
+}
+
+void *audio_gate_create(void *parent) {
+    audio_gate_ctx_t *ctx = (audio_gate_ctx_t *)malloc(sizeof(audio_gate_ctx_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(audio_gate_ctx_t));
+    ctx->parent = parent;
+    ctx->params.sample_rate = 16000;
+    ctx->params.channels = 1;
+    ctx->params.window_samples = 15600;
+    ctx->params.hop_samples = 7800;
+    ctx->params.mode = AUDIO_GATE_OFF;
+    ctx->params.threshold_db = -50.0f;
+    ctx->params.vad_margin_db = 10.0f;
+    return ctx;
+}
+
+mm_module_t audio_gate_module = {
+    .create = audio_gate_create,
+    .destroy = audio_gate_destroy,
+    .control = audio_gate_control,
+    .handle = audio_gate_handle,
+
+    .new_item = NULL,
+    .del_item = NULL,
+
+    .output_type = MM_TYPE_NONE,
+    .module_type = MM_TYPE_ASINK,
+    .name = "AUDGATE"
+};
+
+//-----------------------------------------------------------------------------
+// Arduino driver interface
+
+mm_context_t *AudioGateInit(void) {
+    return mm_module_open(&audio_gate_module);
+}
+
+mm_context_t *AudioGateDeinit(mm_context_t *p) {
+    return mm_module_close(p);
+}
+
+int AudioGateSetParams(void *p, audio_gate_params_t *params) {
+    return audio_gate_control(p, CMD_AUDIO_GATE_SET_PARAMS, (int)params);
+}
+
+int AudioGateSetApply(void *p) {
+    return audio_gate_control(p, CMD_AUDIO_GATE_APPLY, 0);
+}
+
+void AudioGateSetNext(void *p, mm_context_t *next) {
+    audio_gate_control(p, CMD_AUDIO_GATE_SET_NEXT, (int)next);
+}
+
+void AudioGateSetCallback(void *p, audio_gate_cb_t callback, void *arg) {
+    audio_gate_control(p, CMD_AUDIO_GATE_SET_CB_ARG, (int)arg);
+    audio_gate_control(p, CMD_AUDIO_GATE_SET_CALLBACK, (int)callback);
+}
+
+int AudioGateGetStats(void *p, audio_gate_stats_t *stats) {
+    return audio_gate_control(p, CMD_AUDIO_GATE_GET_STATS, (int)stats);
+}
@@ -0,0 +1,74 @@
+#ifndef AUDIO_GATE_DRV_H
+#define AUDIO_GATE_DRV_H
+
+#include "mmf2_module.h"
+
+#define CMD_AUDIO_GATE_SET_PARAMS   MM_MODULE_CMD(0x00)
+#define CMD_AUDIO_GATE_GET_PARAMS   MM_MODULE_CMD(0x01)
+#define CMD_AUDIO_GATE_SET_NEXT     MM_MODULE_CMD(0x02)
+#define CMD_AUDIO_GATE_SET_CALLBACK MM_MODULE_CMD(0x03)
+#define CMD_AUDIO_GATE_SET_CB_ARG   MM_MODULE_CMD(0x04)
+#define CMD_AUDIO_GATE_GET_STATS    MM_MODULE_CMD(0x05)
+#define CMD_AUDIO_GATE_APPLY        MM_MODULE_CMD(0x20)
+
+typedef enum {
+    AUDIO_GATE_OFF = 0,         // forward every window
+    AUDIO_GATE_ENERGY = 1,      // forward windows louder than threshold_db
+    AUDIO_GATE_VAD = 2          // forward windows standing vad_margin_db above the tracked noise floor
+} audio_gate_mode_t;
+
+// Outcome of one window, passed to the decision callback
+typedef enum {
+    AUDIO_GATE_SKIPPED = 0,
+    AUDIO_GATE_ACTIVE = 1,      // newest hop passed the gate
+    AUDIO_GATE_HANGOVER = 2,    // quiet, but within hangover_ms of activity
+    AUDIO_GATE_FORCED = 3       // quiet, forwarded because max_skip_ms elapsed
+} audio_gate_decision_t;
+
+// Called from the stream task once per window, before a forwarded window reaches the
+// next module. index is the stream position of the first window sample, level_db the
+// level of the newest hop in dBFS.
+typedef void (*audio_gate_cb_t)(audio_gate_decision_t decision, uint32_t index, float level_db, void *arg);
+
+typedef struct audio_gate_params_s {
+    uint32_t sample_rate;
+    uint8_t channels;           // samples of a multi channel stream are interleaved
+    uint32_t window_samples;    // samples the next module receives per window
+    uint32_t hop_samples;       // new samples between windows, window_samples - overlap
+    uint8_t mode;               // audio_gate_mode_t
+    float threshold_db;         // AUDIO_GATE_ENERGY level, also the AUDIO_GATE_VAD floor
+    float vad_margin_db;        // AUDIO_GATE_VAD distance above the noise floor
+    uint32_t hangover_ms;       // keep forwarding this long after the last active hop
+    uint32_t max_skip_ms;       // forward at least one window this often, 0 never forces
+} audio_gate_params_t;
+
+typedef struct audio_gate_stats_s {
+    uint32_t samples;           // samples received
+    uint32_t windows;           // windows completed
+    uint32_t forwarded;         // windows passed to the next module
+    uint32_t forced;            // of those, forwarded only because of max_skip_ms
+    uint32_t skipped;           // windows dropped by the gate
+    float level_db;             // level of the newest hop
+    float noise_db;             // tracked noise floor
+    uint32_t max_next_us;       // longest call into the next module
+} audio_gate_stats_t;
+
+mm_context_t *AudioGateInit(void);
+
+mm_context_t *AudioGateDeinit(mm_context_t *p);
+
+int AudioGateSetParams(void *p, audio_gate_params_t *params);
+
+// Allocate the window buffer and restart counting
+int AudioGateSetApply(void *p);
+
+// Module context that receives forwarded windows, its handle runs in the stream task
+void AudioGateSetNext(void *p, mm_context_t *next);
+
+void AudioGateSetCallback(void *p, audio_gate_cb_t callback, void *arg);
+
+int AudioGateGetStats(void *p, audio_gate_stats_t *stats);
+
+extern mm_module_t audio_gate_module;
+
+#endif
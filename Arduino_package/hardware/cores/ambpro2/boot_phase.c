@@ -0,0 +1,106 @@
+#include "boot_phase.h"
+#include "cmsis.h"
+#include "hal_timer.h"
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct boot_mark_s {
+    const char *name;
+    uint32_t time;
+} boot_mark_t;
+
+static boot_mark_t boot_marks[BOOT_MARK_MAX];
+static volatile uint32_t boot_mark_count = 0;
+
+uint32_t bootTime(void) {
+    return (uint32_t)hal_read_systime_us();
+}
+
+// Entries are only ever appended and the count is raised after an entry is complete,
+// so readers walk the first boot_mark_count entries without locking.
+static int boot_mark_find(const char *name) {
+    uint32_t count = boot_mark_count;
+
+    if (name == NULL) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if ((boot_marks[i].name == name) || (strcmp(boot_marks[i].name, name) == 0)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void bootMark(const char *name) {
+    uint32_t time = bootTime();
+    uint32_t primask;
+
+    if ((name == NULL) || (boot_mark_find(name) >= 0)) {
+        return;
+    }
+    // interrupts off rather than a mutex, markers are set before the scheduler and from ISRs
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if ((boot_mark_find(name) < 0) && (boot_mark_count < BOOT_MARK_MAX)) {
+        boot_marks[boot_mark_count].name = name;
+        boot_marks[boot_mark_count].time = time;
+        __DMB();
+        boot_mark_count++;
+    }
+    __set_PRIMASK(primask);
+}
+
+uint32_t bootMarkTime(const char *name) {
+    int index = boot_mark_find(name);
+
+    if (index < 0) {
+        return 0;
+    }
+    return boot_marks[index].time;
+}
+
+int bootMarkWait(const char *name, uint32_t timeout) {
+    uint32_t start = bootTime();
+
+    while (boot_mark_find(name) < 0) {
+        if (((bootTime() - start) / 1000) >= timeout) {
+            return 0;
+        }
+        vTaskDelay(1);
+    }
+    return 1;
+}
+
+uint32_t bootMarkCount(void) {
+    return boot_mark_count;
+}
+
+const char *bootMarkName(uint32_t index) {
+    if (index >= boot_mark_count) {
+        return NULL;
+    }
+    return boot_marks[index].name;
+}
+
+uint32_t bootMarkTimeAt(uint32_t index) {
+    if (index >= boot_mark_count) {
+        return 0;
+    }
+    return boot_marks[index].time;
+}
+
+void bootPrintMarks(void) {
+    uint32_t count = boot_mark_count;
+    uint32_t previous = 0;
+
+    printf("\r\n------------------------------------------\r\n");
+    printf("Boot Phases (ms since reset, +ms since previous):\r\n");
+    for (uint32_t i = 0; i < count; i++) {
+        printf("%-20s %6lu.%03lu  +%lu.%03lu\r\n", boot_marks[i].name, (boot_marks[i].time / 1000), (boot_marks[i].time % 1000), ((boot_marks[i].time - previous) / 1000), ((boot_marks[i].time - previous) % 1000));
+        previous = boot_marks[i].time;
+    }
+    printf("------------------------------------------\r\n");
+}
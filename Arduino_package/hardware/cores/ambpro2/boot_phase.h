@@ -0,0 +1,86 @@
+/** @file boot_phase.h */
+
+/**
+ * @defgroup boot_phase boot_phase
+ * Timestamped markers for the phases between reset and the first results of a sketch
+ * @{
+ */
+
+#ifndef _BOOT_PHASE_H_
+#define _BOOT_PHASE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/** Most markers kept, later ones are ignored */
+#define BOOT_MARK_MAX       32
+
+/**
+ * \brief Microseconds since reset.
+ *
+ * Read from the system timer started by the boot ROM, so the count includes the boot loader
+ * and is valid before the scheduler runs, unlike micros(). A wake from deep sleep is a reset.
+ */
+extern uint32_t bootTime(void);
+
+/**
+ * \brief Record the time a boot phase is reached.
+ *
+ * Only the first call for each name is kept, so a marker can be placed in code that runs
+ * every frame. Safe to call from any task or interrupt, and before the scheduler starts.
+ * The core marks "ameba_init", "variant", "t2ff_prealloc", "setup" and "loop". The
+ * libraries add "wifi_connected" from WiFi.begin(), "video_init", "video_start" and
+ * "first_frame" from VideoFastStart, and "nn_model_loaded", "first_inference" and
+ * "first_detection" from NNObjectDetection.
+ *
+ * \param name marker name, the pointer is kept so it has to be a string literal
+ */
+extern void bootMark(const char *name);
+
+/**
+ * \brief Time a marker was reached.
+ *
+ * \param name marker name
+ * \return microseconds since reset, 0 if the marker has not been reached
+ */
+extern uint32_t bootMarkTime(const char *name);
+
+/**
+ * \brief Wait until a marker is reached, for example the end of a phase started in another task.
+ *
+ * \param name marker name
+ * \param timeout longest wait in ms
+ * \return 1 once the marker is reached, 0 on timeout
+ */
+extern int bootMarkWait(const char *name, uint32_t timeout);
+
+/**
+ * \brief Number of markers reached, in the order they were reached.
+ */
+extern uint32_t bootMarkCount(void);
+
+/**
+ * \brief Name of the index'th marker reached, NULL past bootMarkCount().
+ */
+extern const char *bootMarkName(uint32_t index);
+
+/**
+ * \brief Time of the index'th marker reached in microseconds since reset, 0 past bootMarkCount().
+ */
+extern uint32_t bootMarkTimeAt(uint32_t index);
+
+/**
+ * \brief Print every marker with its time since reset and since the marker before it.
+ */
+extern void bootPrintMarks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */ // end of group boot_phase
+
+#endif
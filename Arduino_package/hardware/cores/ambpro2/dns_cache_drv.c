@@ -0,0 +1,627 @@
+#include "dns_cache_drv.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <queue.h>
+#include <lwip/sockets.h>
+#include <lwip/sys.h>
+#include <lwip/dns.h>
+#include <lwip/api.h>
+#include <platform_stdlib.h>
+
+// lwIP keeps the TTL of its own answers private, so names are looked up with
+// queries sent from here and cached with the TTL of the answer. The lwIP
+// resolver is only used when no socket is available.
+
+#define DNS_CACHE_STACK_SIZE        1024
+#define DNS_CACHE_TASK_PRIORITY     (tskIDLE_PRIORITY + 1)
+#define DNS_CACHE_QUEUE_DEPTH       8
+#define DNS_CACHE_ATTEMPT_MS        1000        // wait for one server before asking the next
+#define DNS_CACHE_FAIL_TTL          5           // seconds a server failure is remembered
+#define DNS_CACHE_FALLBACK_TTL      60          // seconds for answers from the lwIP resolver
+#define DNS_SERVER_PORT             53
+#define DNS_MSG_SIZE                512
+#define DNS_QUERY_SIZE              (12 + 256 + 5)
+
+#define DNS_ENTRY_FREE              0
+#define DNS_ENTRY_VALID             1
+#define DNS_ENTRY_FAILED            2
+
+#define DNS_LOOKUP_MISS             0
+#define DNS_LOOKUP_HIT              1
+#define DNS_LOOKUP_STALE            2
+#define DNS_LOOKUP_NEGATIVE         3
+
+#define DNS_PARSE_IGNORE            1
+
+typedef struct dns_entry_s {
+    char name[DNS_CACHE_MAX_NAME + 1];
+    uint8_t state;
+    uint8_t refreshing;
+    int8_t result;
+    uint32_t ip;
+    uint32_t ttl;
+    uint32_t expires;
+    uint32_t last_used;
+} dns_entry_t;
+
+typedef struct dns_request_s {
+    char name[DNS_CACHE_MAX_NAME + 1];
+    dns_cache_cb_t cb;
+    void *arg;
+} dns_request_t;
+
+static SemaphoreHandle_t dns_lock = NULL;
+static QueueHandle_t dns_queue = NULL;
+static TaskHandle_t dns_task = NULL;
+static dns_entry_t dns_entries[DNS_CACHE_SIZE];
+static char dns_preresolve[DNS_CACHE_MAX_PRERESOLVE][DNS_CACHE_MAX_NAME + 1];
+static uint8_t dns_preresolve_count = 0;
+static uint32_t dns_negative_ttl = DNS_CACHE_NEGATIVE_TTL;
+static uint32_t dns_serve_stale = 0;
+static dns_cache_stats_t dns_stats;
+
+static int dns_cache_init(void) {
+    SemaphoreHandle_t lock;
+
+    if (dns_lock != NULL) {
+        return 0;
+    }
+    lock = xSemaphoreCreateMutex();
+    if (lock == NULL) {
+        return -1;
+    }
+    taskENTER_CRITICAL();
+    if (dns_lock == NULL) {
+        dns_lock = lock;
+        lock = NULL;
+    }
+    taskEXIT_CRITICAL();
+    if (lock != NULL) {
+        vSemaphoreDelete(lock);
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Cache table, called with dns_lock held
+
+static dns_entry_t *dns_entry_find(const char *name) {
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if ((dns_entries[i].state != DNS_ENTRY_FREE) && (strcasecmp(dns_entries[i].name, name) == 0)) {
+            return &dns_entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Reuse a free or expired slot first, then the least recently used one
+static dns_entry_t *dns_entry_victim(uint32_t now) {
+    dns_entry_t *victim = &dns_entries[0];
+
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        dns_entry_t *e = &dns_entries[i];
+        if (e->state == DNS_ENTRY_FREE) {
+            return e;
+        }
+        if ((int32_t)(e->expires + (dns_serve_stale * 1000) - now) <= 0) {
+            victim = e;
+        } else if (((int32_t)(victim->expires + (dns_serve_stale * 1000) - now) > 0) && ((now - e->last_used) > (now - victim->last_used))) {
+            victim = e;
+        }
+    }
+    return victim;
+}
+
+static int dns_cache_get(const char *name, uint32_t *ip, int *result, int *refresh) {
+    dns_entry_t *e;
+    uint32_t now = sys_now();
+    int ret = DNS_LOOKUP_MISS;
+
+    *refresh = 0;
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    e = dns_entry_find(name);
+    if (e == NULL) {
+        dns_stats.misses++;
+    } else if ((int32_t)(e->expires - now) > 0) {
+        e->last_used = now;
+        if (e->state == DNS_ENTRY_VALID) {
+            *ip = e->ip;
+            dns_stats.hits++;
+            ret = DNS_LOOKUP_HIT;
+        } else {
+            *result = e->result;
+            dns_stats.negative_hits++;
+            ret = DNS_LOOKUP_NEGATIVE;
+        }
+    } else if ((e->state == DNS_ENTRY_VALID) && ((now - e->expires) < (dns_serve_stale * 1000))) {
+        // expired, answer with the old address and refresh it once in the background
+        e->last_used = now;
+        *ip = e->ip;
+        if (!e->refreshing) {
+            e->refreshing = 1;
+            *refresh = 1;
+        }
+        dns_stats.stale_hits++;
+        ret = DNS_LOOKUP_STALE;
+    } else {
+        dns_stats.misses++;
+    }
+    xSemaphoreGive(dns_lock);
+    return ret;
+}
+
+static void dns_cache_store(const char *name, uint32_t ip, int result, uint32_t ttl) {
+    dns_entry_t *e;
+    uint32_t now = sys_now();
+
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    e = dns_entry_find(name);
+    if ((e != NULL) && (result != DNS_CACHE_OK) && (e->state == DNS_ENTRY_VALID) && (dns_serve_stale != 0)) {
+        // a failed refresh keeps serving the stale address
+        e->refreshing = 0;
+        xSemaphoreGive(dns_lock);
+        return;
+    }
+    if ((result == DNS_CACHE_NOT_FOUND) && (dns_negative_ttl == 0)) {
+        if (e != NULL) {
+            e->state = DNS_ENTRY_FREE;
+        }
+        xSemaphoreGive(dns_lock);
+        return;
+    }
+    if (e == NULL) {
+        e = dns_entry_victim(now);
+        strcpy(e->name, name);
+    }
+    if (result == DNS_CACHE_OK) {
+        ttl = (ttl < DNS_CACHE_MIN_TTL) ? DNS_CACHE_MIN_TTL : ((ttl > DNS_CACHE_MAX_TTL) ? DNS_CACHE_MAX_TTL : ttl);
+        e->state = DNS_ENTRY_VALID;
+    } else {
+        ttl = (result == DNS_CACHE_NOT_FOUND) ? dns_negative_ttl : DNS_CACHE_FAIL_TTL;
+        e->state = DNS_ENTRY_FAILED;
+    }
+    e->ip = ip;
+    e->result = result;
+    e->ttl = ttl;
+    e->expires = now + (ttl * 1000);
+    e->last_used = now;
+    e->refreshing = 0;
+    xSemaphoreGive(dns_lock);
+}
+
+//-----------------------------------------------------------------------------
+// DNS queries
+
+static int dns_build_query(uint8_t *msg, const char *name, uint16_t id) {
+    int pos = 12;
+
+    memset(msg, 0, 12);
+    msg[0] = (uint8_t)(id >> 8);
+    msg[1] = (uint8_t)id;
+    msg[2] = 0x01;      // recursion desired
+    msg[5] = 1;         // one question
+    while (*name) {
+        const char *dot = strchr(name, '.');
+        int n = dot ? (dot - name) : strlen(name);
+        if ((n == 0) || (n > 63) || ((pos + n + 6) > DNS_QUERY_SIZE)) {
+            return -1;
+        }
+        msg[pos++] = (uint8_t)n;
+        memcpy(&msg[pos], name, n);
+        pos += n;
+        name += n;
+        if (*name == '.') {
+            name++;
+        }
+    }
+    msg[pos++] = 0;
+    msg[pos++] = 0;
+    msg[pos++] = 1;     // type A
+    msg[pos++] = 0;
+    msg[pos++] = 1;     // class IN
+    return pos;
+}
+
+static int dns_skip_name(const uint8_t *msg, int len, int pos) {
+    while (pos < len) {
+        if ((msg[pos] & 0xC0) == 0xC0) {
+            return pos + 2;
+        }
+        if (msg[pos] == 0) {
+            return pos + 1;
+        }
+        pos += msg[pos] + 1;
+    }
+    return -1;
+}
+
+// The TTL of an answer reached through CNAMEs is the lowest TTL of the chain
+static int dns_parse_response(const uint8_t *msg, int len, uint16_t id, uint32_t *ip, uint32_t *ttl) {
+    uint32_t min_ttl = DNS_CACHE_MAX_TTL;
+    int qdcount, ancount;
+    int pos = 12;
+
+    if ((len < 12) || ((((uint16_t)msg[0] << 8) | msg[1]) != id) || !(msg[2] & 0x80)) {
+        return DNS_PARSE_IGNORE;
+    }
+    if ((msg[3] & 0x0F) == 3) {
+        return DNS_CACHE_NOT_FOUND;
+    }
+    if ((msg[3] & 0x0F) != 0) {
+        return DNS_CACHE_FAILED;
+    }
+    qdcount = ((int)msg[4] << 8) | msg[5];
+    ancount = ((int)msg[6] << 8) | msg[7];
+    for (int i = 0; i < qdcount; i++) {
+        pos = dns_skip_name(msg, len, pos);
+        if ((pos < 0) || ((pos + 4) > len)) {
+            return DNS_CACHE_FAILED;
+        }
+        pos += 4;
+    }
+    for (int i = 0; i < ancount; i++) {
+        uint16_t type, rclass, rdlen;
+        uint32_t rttl;
+
+        pos = dns_skip_name(msg, len, pos);
+        if ((pos < 0) || ((pos + 10) > len)) {
+            return DNS_CACHE_FAILED;
+        }
+        type = ((uint16_t)msg[pos] << 8) | msg[pos + 1];
+        rclass = ((uint16_t)msg[pos + 2] << 8) | msg[pos + 3];
+        rttl = ((uint32_t)msg[pos + 4] << 24) | ((uint32_t)msg[pos + 5] << 16) | ((uint32_t)msg[pos + 6] << 8) | msg[pos + 7];
+        rdlen = ((uint16_t)msg[pos + 8] << 8) | msg[pos + 9];
+        pos += 10;
+        if ((pos + rdlen) > len) {
+            return DNS_CACHE_FAILED;
+        }
+        if (rttl & 0x80000000) {
+            rttl = 0;
+        }
+        if (rttl < min_ttl) {
+            min_ttl = rttl;
+        }
+        if ((type == 1) && (rclass == 1) && (rdlen == 4)) {
+            memcpy(ip, &msg[pos], 4);
+            *ttl = min_ttl;
+            return DNS_CACHE_OK;
+        }
+        pos += rdlen;
+    }
+    // the name exists but has no IPv4 address
+    return DNS_CACHE_NOT_FOUND;
+}
+
+static int dns_query_lwip(const char *name, uint32_t *ip, uint32_t *ttl) {
+    ip_addr_t addr;
+
+    if (netconn_gethostbyname_addrtype(name, &addr, NETCONN_DNS_IPV4) != ERR_OK) {
+        return DNS_CACHE_FAILED;
+    }
+    *ip = ip_2_ip4(&addr)->addr;
+    *ttl = DNS_CACHE_FALLBACK_TTL;
+    return DNS_CACHE_OK;
+}
+
+// Ask each configured server in turn until one answers or timeout ms have passed
+static int dns_query(const char *name, uint32_t *ip, uint32_t *ttl, uint32_t timeout) {
+    uint8_t query[DNS_QUERY_SIZE];
+    uint8_t *reply;
+    struct sockaddr_in server;
+    uint32_t start = sys_now();
+    int result = DNS_CACHE_FAILED;
+    int sent = 0;
+    int sock;
+    int query_len;
+    uint16_t id;
+
+    id = (uint16_t)LWIP_RAND();
+    query_len = dns_build_query(query, name, id);
+    if (query_len < 0) {
+        return DNS_CACHE_NOT_FOUND;
+    }
+    reply = (uint8_t *)malloc(DNS_MSG_SIZE);
+    sock = (reply != NULL) ? lwip_socket(AF_INET, SOCK_DGRAM, 0) : -1;
+    if (sock < 0) {
+        free(reply);
+        return dns_query_lwip(name, ip, ttl);
+    }
+
+    for (int attempt = 0; (sys_now() - start) < timeout; attempt++) {
+        const ip_addr_t *dns_server = dns_getserver(attempt % DNS_MAX_SERVERS);
+        uint32_t elapsed = sys_now() - start;
+        int wait = ((timeout - elapsed) < DNS_CACHE_ATTEMPT_MS) ? (timeout - elapsed) : DNS_CACHE_ATTEMPT_MS;
+        int len;
+
+        if ((attempt >= DNS_MAX_SERVERS) && (sent == 0)) {
+            // no DNS server configured
+            break;
+        }
+        if (ip_addr_isany(dns_server) || !IP_IS_V4(dns_server)) {
+            continue;
+        }
+        memset(&server, 0, sizeof(server));
+        server.sin_family = AF_INET;
+        server.sin_port = htons(DNS_SERVER_PORT);
+        server.sin_addr.s_addr = ip_2_ip4(dns_server)->addr;
+        lwip_setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+        if (lwip_sendto(sock, query, query_len, 0, (struct sockaddr *)&server, sizeof(server)) != query_len) {
+            continue;
+        }
+        sent++;
+        xSemaphoreTake(dns_lock, portMAX_DELAY);
+        dns_stats.queries++;
+        xSemaphoreGive(dns_lock);
+
+        // an answer to an earlier attempt is accepted too, they share the id
+        while ((len = lwip_recv(sock, reply, DNS_MSG_SIZE, 0)) > 0) {
+            result = dns_parse_response(reply, len, id, ip, ttl);
+            if (result != DNS_PARSE_IGNORE) {
+                break;
+            }
+        }
+        if ((result == DNS_CACHE_OK) || (result == DNS_CACHE_NOT_FOUND)) {
+            break;
+        }
+        result = DNS_CACHE_FAILED;
+    }
+    lwip_close(sock);
+    free(reply);
+    return result;
+}
+
+static int dns_resolve(const char *name, uint32_t *ip, uint32_t timeout) {
+    uint32_t ttl = 0;
+    int result;
+
+    result = dns_query(name, ip, &ttl, timeout);
+    if (result != DNS_CACHE_OK) {
+        *ip = 0;
+        xSemaphoreTake(dns_lock, portMAX_DELAY);
+        dns_stats.failures++;
+        xSemaphoreGive(dns_lock);
+    }
+    dns_cache_store(name, *ip, result, ttl);
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Resolver task for background requests
+
+static void dns_cache_task(void *param) {
+    dns_request_t req;
+    uint32_t ip;
+    int result;
+    int refresh;
+    (void)param;
+
+    while (1) {
+        if (xQueueReceive(dns_queue, &req, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        ip = 0;
+        result = DNS_CACHE_OK;
+        // an earlier request may have resolved the same name while this one waited
+        switch (dns_cache_get(req.name, &ip, &result, &refresh)) {
+            case DNS_LOOKUP_HIT:
+            case DNS_LOOKUP_NEGATIVE:
+                break;
+            default:
+                result = dns_resolve(req.name, &ip, DNS_CACHE_TIMEOUT);
+                break;
+        }
+        if (req.cb) {
+            req.cb(req.name, ip, result, req.arg);
+        }
+    }
+}
+
+static int dns_cache_queue(const char *name, dns_cache_cb_t cb, void *arg) {
+    dns_request_t req;
+
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    if (dns_queue == NULL) {
+        dns_queue = xQueueCreate(DNS_CACHE_QUEUE_DEPTH, sizeof(dns_request_t));
+        if ((dns_queue != NULL) && (xTaskCreate(dns_cache_task, "dns_cache", DNS_CACHE_STACK_SIZE, NULL, DNS_CACHE_TASK_PRIORITY, &dns_task) != pdPASS)) {
+            vQueueDelete(dns_queue);
+            dns_queue = NULL;
+        }
+    }
+    xSemaphoreGive(dns_lock);
+    if (dns_queue == NULL) {
+        printf("\r\n[ERROR] %s DNS resolver task create failed\n", __FUNCTION__);
+        return -1;
+    }
+
+    memset(&req, 0, sizeof(req));
+    strcpy(req.name, name);
+    req.cb = cb;
+    req.arg = arg;
+    return (xQueueSend(dns_queue, &req, 0) == pdTRUE) ? 0 : -1;
+}
+
+//-----------------------------------------------------------------------------
+// Arduino driver interface
+
+int DnsCacheResolve(const char *host, uint32_t *ip, uint32_t timeout) {
+    ip4_addr_t addr;
+    int result = DNS_CACHE_OK;
+    int refresh;
+
+    if ((host == NULL) || (ip == NULL)) {
+        return DNS_CACHE_FAILED;
+    }
+    if (ip4addr_aton(host, &addr)) {
+        *ip = addr.addr;
+        return DNS_CACHE_OK;
+    }
+    if (dns_cache_init() != 0) {
+        uint32_t ttl;
+        return dns_query_lwip(host, ip, &ttl);
+    }
+    if (strlen(host) > DNS_CACHE_MAX_NAME) {
+        uint32_t ttl;
+        return dns_query(host, ip, &ttl, timeout);
+    }
+
+    switch (dns_cache_get(host, ip, &result, &refresh)) {
+        case DNS_LOOKUP_HIT:
+            return DNS_CACHE_OK;
+        case DNS_LOOKUP_STALE:
+            if (refresh) {
+                dns_cache_queue(host, NULL, NULL);
+            }
+            return DNS_CACHE_OK;
+        case DNS_LOOKUP_NEGATIVE:
+            *ip = 0;
+            return result;
+        default:
+            return dns_resolve(host, ip, timeout);
+    }
+}
+
+int DnsCacheResolveAsync(const char *host, dns_cache_cb_t cb, void *arg) {
+    ip4_addr_t addr;
+    uint32_t ip = 0;
+    int result = DNS_CACHE_OK;
+    int refresh;
+
+    if ((host == NULL) || (strlen(host) > DNS_CACHE_MAX_NAME) || (dns_cache_init() != 0)) {
+        return -1;
+    }
+    if (ip4addr_aton(host, &addr)) {
+        if (cb) {
+            cb(host, addr.addr, DNS_CACHE_OK, arg);
+        }
+        return 1;
+    }
+
+    switch (dns_cache_get(host, &ip, &result, &refresh)) {
+        case DNS_LOOKUP_STALE:
+            if (refresh) {
+                dns_cache_queue(host, NULL, NULL);
+            }
+            // fall through
+        case DNS_LOOKUP_HIT:
+        case DNS_LOOKUP_NEGATIVE:
+            if (cb) {
+                cb(host, ip, result, arg);
+            }
+            return 1;
+        default:
+            return dns_cache_queue(host, cb, arg);
+    }
+}
+
+int DnsCacheLookup(const char *host, uint32_t *ip) {
+    dns_entry_t *e;
+    int ret = 0;
+
+    if ((host == NULL) || (ip == NULL) || (dns_cache_init() != 0)) {
+        return 0;
+    }
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    e = dns_entry_find(host);
+    if ((e != NULL) && ((int32_t)(e->expires - sys_now()) > 0)) {
+        *ip = e->ip;
+        ret = (e->state == DNS_ENTRY_VALID) ? 1 : -1;
+    }
+    xSemaphoreGive(dns_lock);
+    return ret;
+}
+
+int DnsCacheAddPreresolve(const char *host) {
+    int ret = -1;
+
+    if ((host == NULL) || (strlen(host) > DNS_CACHE_MAX_NAME) || (dns_cache_init() != 0)) {
+        return -1;
+    }
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    for (int i = 0; i < dns_preresolve_count; i++) {
+        if (strcasecmp(dns_preresolve[i], host) == 0) {
+            ret = 0;
+        }
+    }
+    if ((ret != 0) && (dns_preresolve_count < DNS_CACHE_MAX_PRERESOLVE)) {
+        strcpy(dns_preresolve[dns_preresolve_count++], host);
+        ret = 0;
+    }
+    xSemaphoreGive(dns_lock);
+    return ret;
+}
+
+void DnsCachePreresolve(void) {
+    char name[DNS_CACHE_MAX_NAME + 1];
+
+    if ((dns_preresolve_count == 0) || (dns_cache_init() != 0)) {
+        return;
+    }
+    for (int i = 0; i < dns_preresolve_count; i++) {
+        xSemaphoreTake(dns_lock, portMAX_DELAY);
+        strcpy(name, dns_preresolve[i]);
+        xSemaphoreGive(dns_lock);
+        dns_cache_queue(name, NULL, NULL);
+    }
+}
+
+void DnsCacheFlush(void) {
+    if (dns_cache_init() != 0) {
+        return;
+    }
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    memset(dns_entries, 0, sizeof(dns_entries));
+    xSemaphoreGive(dns_lock);
+}
+
+void DnsCacheSetNegativeTtl(uint32_t seconds) {
+    dns_negative_ttl = (seconds > DNS_CACHE_MAX_TTL) ? DNS_CACHE_MAX_TTL : seconds;
+}
+
+void DnsCacheSetServeStale(uint32_t seconds) {
+    dns_serve_stale = (seconds > DNS_CACHE_MAX_TTL) ? DNS_CACHE_MAX_TTL : seconds;
+}
+
+void DnsCacheGetStats(dns_cache_stats_t *stats) {
+    if ((stats == NULL) || (dns_cache_init() != 0)) {
+        return;
+    }
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    memcpy(stats, &dns_stats, sizeof(dns_cache_stats_t));
+    stats->entries = 0;
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (dns_entries[i].state != DNS_ENTRY_FREE) {
+            stats->entries++;
+        }
+    }
+    xSemaphoreGive(dns_lock);
+}
+
+void DnsCachePrint(void) {
+    dns_cache_stats_t stats;
+    uint32_t now = sys_now();
+    char addr[IP4ADDR_STRLEN_MAX];
+
+    DnsCacheGetStats(&stats);
+    printf("\r\n------------------------------------------\r\n");
+    printf("DNS cache: %d/%d entries\r\n", stats.entries, DNS_CACHE_SIZE);
+    printf("Hits: %lu, stale: %lu, negative: %lu, misses: %lu\r\n", stats.hits, stats.stale_hits, stats.negative_hits, stats.misses);
+    printf("Queries: %lu, failures: %lu\r\n", stats.queries, stats.failures);
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        dns_entry_t *e = &dns_entries[i];
+        int32_t left = (int32_t)(e->expires - now) / 1000;
+        if (e->state == DNS_ENTRY_FREE) {
+            continue;
+        }
+        if (e->state == DNS_ENTRY_VALID) {
+            ip4addr_ntoa_r((const ip4_addr_t *)&e->ip, addr, sizeof(addr));
+        } else {
+            strcpy(addr, (e->result == DNS_CACHE_NOT_FOUND) ? "not found" : "failed");
+        }
+        printf("%s: %s, ttl %lu s, %s %ld s\r\n", e->name, addr, e->ttl, ((left >= 0) ? "expires in" : "expired"), ((left >= 0) ? left : -left));
+    }
+    xSemaphoreGive(dns_lock);
+    printf("------------------------------------------\r\n");
+}
@@ -0,0 +1,62 @@
+#ifndef DNS_CACHE_DRV_H
+#define DNS_CACHE_DRV_H
+
+#include <stdint.h>
+
+#define DNS_CACHE_SIZE              16
+// longer names are resolved on every call and never cached
+#define DNS_CACHE_MAX_NAME          96
+#define DNS_CACHE_MAX_PRERESOLVE    8
+#define DNS_CACHE_MIN_TTL           5           // seconds
+#define DNS_CACHE_MAX_TTL           86400       // seconds
+#define DNS_CACHE_NEGATIVE_TTL      30          // seconds an unknown name is remembered by default
+#define DNS_CACHE_TIMEOUT           5000        // ms a blocking resolve may take
+
+#define DNS_CACHE_OK                0
+#define DNS_CACHE_FAILED            -1          // no answer from any DNS server
+#define DNS_CACHE_NOT_FOUND         -2          // the name does not exist or has no IPv4 address
+
+// ip is in network byte order, i.e. IPAddress(ip), result is one of DNS_CACHE_OK/FAILED/NOT_FOUND
+// Called from the resolver task, or from the caller of DnsCacheResolveAsync() on a cache hit
+typedef void (*dns_cache_cb_t)(const char *host, uint32_t ip, int result, void *arg);
+
+typedef struct dns_cache_stats_s {
+    uint32_t hits;              // answered from a fresh entry
+    uint32_t stale_hits;        // answered from an expired entry while it was refreshed
+    uint32_t negative_hits;     // failed straight away from a cached failure
+    uint32_t misses;
+    uint32_t queries;           // queries sent to DNS servers
+    uint32_t failures;          // resolutions that got no answer
+    uint8_t entries;
+} dns_cache_stats_t;
+
+// Resolve through the cache, blocks up to timeout ms on a miss
+int DnsCacheResolve(const char *host, uint32_t *ip, uint32_t timeout);
+
+// Answer from the cache if possible, otherwise resolve in the background
+// Returns 1 if the callback was already called, 0 if queued, -1 if the request queue is full
+int DnsCacheResolveAsync(const char *host, dns_cache_cb_t cb, void *arg);
+
+// Cache only, returns 1 for a fresh address, -1 for a cached failure, 0 if unknown
+int DnsCacheLookup(const char *host, uint32_t *ip);
+
+// Keep host resolved ahead of use, it is resolved in the background at every WiFi connect
+// Returns 0 if successful, -1 if the list is full
+int DnsCacheAddPreresolve(const char *host);
+
+// Queue background resolution of every host added by DnsCacheAddPreresolve()
+void DnsCachePreresolve(void);
+
+void DnsCacheFlush(void);
+
+// Seconds a name that does not exist is remembered, 0 disables negative caching
+void DnsCacheSetNegativeTtl(uint32_t seconds);
+
+// Keep answering with an expired address for up to seconds while it is refreshed in the background
+void DnsCacheSetServeStale(uint32_t seconds);
+
+void DnsCacheGetStats(dns_cache_stats_t *stats);
+
+void DnsCachePrint(void);
+
+#endif
@@ -0,0 +1,959 @@
+#include "httpfmp4_drv.h"
+#include "mmf2_module.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <lwip/sockets.h>
+#include <platform_stdlib.h>
+
+// Redefine here since the libmov headers of libfmp4.a are not shipped with the SDK
+#define MOV_OBJECT_H264         0x21
+#define MOV_FLAG_SEGMENT        0x00000002
+#define MOV_AV_FLAG_KEYFREAME   0x0001
+
+struct mov_buffer_t {
+    int (*read)(void *param, void *data, uint64_t bytes);
+    int (*write)(void *param, const void *data, uint64_t bytes);
+    int (*seek)(void *param, int64_t offset);
+    int64_t (*tell)(void *param);
+};
+
+typedef struct fmp4_writer_t fmp4_writer_t;
+
+extern fmp4_writer_t *fmp4_writer_create(const struct mov_buffer_t *buffer, void *param, int flags);
+extern void fmp4_writer_destroy(fmp4_writer_t *fmp4);
+extern int fmp4_writer_add_video(fmp4_writer_t *fmp4, uint8_t object, int width, int height, const void *extra_data, size_t extra_data_size);
+extern int fmp4_writer_write(fmp4_writer_t *fmp4, int idx, const void *data, size_t bytes, int64_t pts, int64_t dts, int flags);
+extern int fmp4_writer_save_segment(fmp4_writer_t *fmp4);
+extern int fmp4_writer_init_segment(fmp4_writer_t *fmp4);
+
+#define HTTPFMP4_REQ_SIZE       512
+#define HTTPFMP4_POLL_MS        5       // viewers both waiting for a fragment and for socket space
+#define HTTPFMP4_WAIT_MS        100     // longest a fragment wait delays accepting and reading sockets
+#define HTTPFMP4_IDLE_MS        500     // no viewer waiting for a fragment, only to notice a stop
+#define HTTPFMP4_SEG_INIT_SIZE  (32 * 1024)
+#define HTTPFMP4_SPS_MAX        64
+#define HTTPFMP4_PPS_MAX        32
+#define HTTPFMP4_STACK_SIZE     2048
+#define HTTPFMP4_TASK_PRIORITY  (tskIDLE_PRIORITY + 2)
+
+enum {
+    CLIENT_FREE = 0,
+    CLIENT_REQUEST,
+    CLIENT_RESPONSE,
+    CLIENT_STREAMING
+};
+
+enum {
+    TX_CHUNK_HEADER = 0,
+    TX_PAYLOAD,
+    TX_CHUNK_TRAILER
+};
+
+// One encoded fragment (styp/moof/mdat), shared read-only by every viewer and freed on the last unref
+typedef struct fmp4_segment_s {
+    uint8_t *data;
+    uint32_t len;
+    uint32_t cap;
+    uint32_t pos;           // libmov may seek back to patch box sizes
+    uint32_t seq;
+    uint8_t keyframe;
+    int refcnt;
+} fmp4_segment_t;
+
+typedef struct httpfmp4_client_s {
+    int fd;
+    uint8_t state;
+    char req[HTTPFMP4_REQ_SIZE];
+    uint16_t req_len;
+
+    // data currently being sent
+    uint8_t *resp;          // private response buffer (headers, player page)
+    const uint8_t *tx_data;
+    uint32_t tx_len;
+    uint32_t tx_off;
+    uint8_t tx_phase;
+    uint8_t tx_chunked;
+    char chunk_hdr[12];
+    uint8_t chunk_hdr_len;
+
+    fmp4_segment_t *seg;    // segment referenced by tx_data
+    uint32_t next_seq;      // 0 means join at the newest key frame fragment
+    uint8_t sent_init;
+} httpfmp4_client_t;
+
+typedef struct httpfmp4_ctx_s {
+    void *parent;
+    httpfmp4_params_t params;
+
+    SemaphoreHandle_t ring_lock;
+    SemaphoreHandle_t writer_lock;
+    SemaphoreHandle_t seg_ready;    // given on every published fragment
+    TaskHandle_t task;
+    volatile int running;
+    volatile int streaming;
+
+    // muxer state, owned by the StreamIO task calling handle
+    fmp4_writer_t *fmp4;
+    int track;
+    fmp4_segment_t *init;
+    fmp4_segment_t *wseg;
+    fmp4_segment_t *cur;
+    uint32_t cur_start_ts;
+    uint32_t cur_frames;
+    uint32_t base_ts;
+    uint8_t *scratch;
+    uint32_t scratch_size;
+    uint8_t sps[HTTPFMP4_SPS_MAX];
+    uint8_t pps[HTTPFMP4_PPS_MAX];
+    uint16_t sps_len;
+    uint16_t pps_len;
+    char codec[16];
+
+    // published fragments, indexed by seq % segment_depth
+    fmp4_segment_t *ring[HTTPFMP4_MAX_SEGMENTS];
+    uint32_t seq;
+
+    httpfmp4_client_t clients[HTTPFMP4_MAX_CLIENTS];
+    int listen_fd;
+    httpfmp4_stats_t stats;
+} httpfmp4_ctx_t;
+
+static const char *http_stream_header =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: video/mp4\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Cache-Control: no-cache, no-store\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Connection: close\r\n\r\n";
+
+static const char *http_page_format =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/html\r\n"
+    "Content-Length: %d\r\n"
+    "Connection: close\r\n\r\n%s";
+
+static const char *http_player_format =
+    "<!DOCTYPE html><html><head><title>AmebaPro2</title></head>"
+    "<body style=\"margin:0;background:#000\">"
+    "<video id=\"v\" autoplay muted playsinline style=\"width:100%%\"></video><script>"
+    "var v=document.getElementById('v'),ms=new MediaSource(),q=[],sb;"
+    "v.src=URL.createObjectURL(ms);"
+    "ms.addEventListener('sourceopen',function(){"
+    "sb=ms.addSourceBuffer('video/mp4; codecs=\"%s\"');sb.mode='sequence';"
+    "sb.addEventListener('updateend',pump);"
+    "fetch('/stream.mp4').then(function(r){var rd=r.body.getReader();"
+    "(function rl(){rd.read().then(function(x){if(x.done)return;q.push(x.value);pump();rl();});})();});});"
+    "function pump(){if(!sb||sb.updating||!q.length)return;sb.appendBuffer(q.shift());"
+    "if(v.buffered.length&&v.buffered.end(0)-v.currentTime>1)v.currentTime=v.buffered.end(0)-0.1;}"
+    "</script></body></html>";
+
+static const char *http_not_found =
+    "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static const char *http_busy =
+    "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+//-----------------------------------------------------------------------------
+// fragment buffers
+
+static fmp4_segment_t *segment_new(void) {
+    fmp4_segment_t *seg = (fmp4_segment_t *)malloc(sizeof(fmp4_segment_t));
+    if (seg == NULL) {
+        return NULL;
+    }
+    memset(seg, 0, sizeof(fmp4_segment_t));
+    seg->data = (uint8_t *)malloc(HTTPFMP4_SEG_INIT_SIZE);
+    if (seg->data == NULL) {
+        free(seg);
+        return NULL;
+    }
+    seg->cap = HTTPFMP4_SEG_INIT_SIZE;
+    seg->refcnt = 1;
+    return seg;
+}
+
+// caller holds ring_lock, or is the only owner
+static void segment_unref_locked(fmp4_segment_t *seg) {
+    if (seg == NULL) {
+        return;
+    }
+    if (--seg->refcnt <= 0) {
+        free(seg->data);
+        free(seg);
+    }
+}
+
+static void segment_unref(httpfmp4_ctx_t *ctx, fmp4_segment_t *seg) {
+    xSemaphoreTake(ctx->ring_lock, portMAX_DELAY);
+    segment_unref_locked(seg);
+    xSemaphoreGive(ctx->ring_lock);
+}
+
+static int fmp4_buf_read(void *param, void *data, uint64_t bytes) {
+    (void)param;
+    (void)data;
+    (void)bytes;
+    return -1;
+}
+
+static int fmp4_buf_write(void *param, const void *data, uint64_t bytes) {
+    httpfmp4_ctx_t *ctx = (httpfmp4_ctx_t *)param;
+    fmp4_segment_t *seg = ctx->wseg;
+    if (seg == NULL) {
+        return -1;
+    }
+    uint32_t need = seg->pos + (uint32_t)bytes;
+    if (need > seg->cap) {
+        uint32_t cap = seg->cap;
+        while (cap < need) {
+            cap *= 2;
+        }
+        uint8_t *data_new = (uint8_t *)realloc(seg->data, cap);
+        if (data_new == NULL) {
+            return -1;
+        }
+        seg->data = data_new;
+        seg->cap = cap;
+    }
+    memcpy(seg->data + seg->pos, data, (size_t)bytes);
+    seg->pos = need;
+    if (seg->pos > seg->len) {
+        seg->len = seg->pos;
+    }
+    return 0;
+}
+
+static int fmp4_buf_seek(void *param, int64_t offset) {
+    httpfmp4_ctx_t *ctx = (httpfmp4_ctx_t *)param;
+    if ((ctx->wseg == NULL) || (offset < 0) || (offset > ctx->wseg->len)) {
+        return -1;
+    }
+    ctx->wseg->pos = (uint32_t)offset;
+    return 0;
+}
+
+static int64_t fmp4_buf_tell(void *param) {
+    httpfmp4_ctx_t *ctx = (httpfmp4_ctx_t *)param;
+    if (ctx->wseg == NULL) {
+        return -1;
+    }
+    return ctx->wseg->pos;
+}
+
+static const struct mov_buffer_t httpfmp4_buffer_ops = {
+    fmp4_buf_read,
+    fmp4_buf_write,
+    fmp4_buf_seek,
+    fmp4_buf_tell
+};
+
+//-----------------------------------------------------------------------------
+// muxer, runs in the StreamIO task
+
+static int h264_find_start_code(const uint8_t *buf, uint32_t len, uint32_t from, uint32_t *sc_len) {
+    for (uint32_t i = from; (i + 3) <= len; i++) {
+        if ((buf[i] == 0) && (buf[i + 1] == 0)) {
+            if (buf[i + 2] == 1) {
+                *sc_len = 3;
+                return (int)i;
+            }
+            if (((i + 4) <= len) && (buf[i + 2] == 0) && (buf[i + 3] == 1)) {
+                *sc_len = 4;
+                return (int)i;
+            }
+        }
+    }
+    return -1;
+}
+
+// Convert one Annex-B access unit to length prefixed NAL units, keeping SPS/PPS aside for the avcC record
+static int httpfmp4_annexb_to_avcc(httpfmp4_ctx_t *ctx, const uint8_t *buf, uint32_t len, uint32_t *out_len, int *keyframe) {
+    uint32_t sc_len = 0;
+    uint32_t out = 0;
+    int start = h264_find_start_code(buf, len, 0, &sc_len);
+
+    *keyframe = 0;
+    if ((len + 16) > ctx->scratch_size) {
+        uint8_t *scratch = (uint8_t *)realloc(ctx->scratch, len + 16);
+        if (scratch == NULL) {
+            return -1;
+        }
+        ctx->scratch = scratch;
+        ctx->scratch_size = len + 16;
+    }
+
+    while (start >= 0) {
+        uint32_t nal = (uint32_t)start + sc_len;
+        uint32_t next_sc_len = 0;
+        int next = h264_find_start_code(buf, len, nal, &next_sc_len);
+        uint32_t nal_len = ((next < 0) ? len : (uint32_t)next) - nal;
+
+        if (nal_len > 0) {
+            uint8_t type = buf[nal] & 0x1F;
+            if (type == 7) {
+                if (nal_len <= HTTPFMP4_SPS_MAX) {
+                    memcpy(ctx->sps, &buf[nal], nal_len);
+                    ctx->sps_len = nal_len;
+                }
+            } else if (type == 8) {
+                if (nal_len <= HTTPFMP4_PPS_MAX) {
+                    memcpy(ctx->pps, &buf[nal], nal_len);
+                    ctx->pps_len = nal_len;
+                }
+            } else if (type != 9) {
+                if ((out + 4 + nal_len) > ctx->scratch_size) {
+                    return -1;
+                }
+                if (type == 5) {
+                    *keyframe = 1;
+                }
+                ctx->scratch[out++] = (nal_len >> 24) & 0xFF;
+                ctx->scratch[out++] = (nal_len >> 16) & 0xFF;
+                ctx->scratch[out++] = (nal_len >> 8) & 0xFF;
+                ctx->scratch[out++] = nal_len & 0xFF;
+                memcpy(&ctx->scratch[out], &buf[nal], nal_len);
+                out += nal_len;
+            }
+        }
+        start = next;
+        sc_len = next_sc_len;
+    }
+    *out_len = out;
+    return 0;
+}
+
+static int httpfmp4_open_writer(httpfmp4_ctx_t *ctx) {
+    uint8_t avcc[16 + HTTPFMP4_SPS_MAX + HTTPFMP4_PPS_MAX];
+    uint32_t n = 0;
+
+    avcc[n++] = 1;
+    avcc[n++] = ctx->sps[1];
+    avcc[n++] = ctx->sps[2];
+    avcc[n++] = ctx->sps[3];
+    avcc[n++] = 0xFF;                   // 4 byte NAL length
+    avcc[n++] = 0xE1;                   // 1 SPS
+    avcc[n++] = (ctx->sps_len >> 8) & 0xFF;
+    avcc[n++] = ctx->sps_len & 0xFF;
+    memcpy(&avcc[n], ctx->sps, ctx->sps_len);
+    n += ctx->sps_len;
+    avcc[n++] = 1;                      // 1 PPS
+    avcc[n++] = (ctx->pps_len >> 8) & 0xFF;
+    avcc[n++] = ctx->pps_len & 0xFF;
+    memcpy(&avcc[n], ctx->pps, ctx->pps_len);
+    n += ctx->pps_len;
+    snprintf(ctx->codec, sizeof(ctx->codec), "avc1.%02X%02X%02X", ctx->sps[1], ctx->sps[2], ctx->sps[3]);
+
+    ctx->init = segment_new();
+    ctx->cur = segment_new();
+    if ((ctx->init == NULL) || (ctx->cur == NULL)) {
+        return -1;
+    }
+    ctx->fmp4 = fmp4_writer_create(&httpfmp4_buffer_ops, ctx, MOV_FLAG_SEGMENT);
+    if (ctx->fmp4 == NULL) {
+        return -1;
+    }
+    ctx->track = fmp4_writer_add_video(ctx->fmp4, MOV_OBJECT_H264, ctx->params.width, ctx->params.height, avcc, n);
+    ctx->wseg = ctx->init;
+    fmp4_writer_init_segment(ctx->fmp4);
+    ctx->wseg = ctx->cur;
+    return 0;
+}
+
+static void httpfmp4_close_writer(httpfmp4_ctx_t *ctx) {
+    if (ctx->fmp4) {
+        ctx->wseg = NULL;
+        fmp4_writer_destroy(ctx->fmp4);
+        ctx->fmp4 = NULL;
+    }
+    xSemaphoreTake(ctx->ring_lock, portMAX_DELAY);
+    for (int i = 0; i < HTTPFMP4_MAX_SEGMENTS; i++) {
+        segment_unref_locked(ctx->ring[i]);
+        ctx->ring[i] = NULL;
+    }
+    segment_unref_locked(ctx->cur);
+    segment_unref_locked(ctx->init);
+    ctx->cur = NULL;
+    ctx->init = NULL;
+    xSemaphoreGive(ctx->ring_lock);
+    ctx->wseg = NULL;
+    ctx->cur_frames = 0;
+    ctx->sps_len = 0;
+    ctx->pps_len = 0;
+}
+
+// Close the fragment being muxed and hand it to the viewers
+static void httpfmp4_publish(httpfmp4_ctx_t *ctx) {
+    fmp4_segment_t *next = segment_new();
+    if (next == NULL) {
+        return;
+    }
+    fmp4_writer_save_segment(ctx->fmp4);
+
+    fmp4_segment_t *done = ctx->cur;
+    ctx->cur = next;
+    ctx->wseg = next;
+    ctx->cur_frames = 0;
+
+    xSemaphoreTake(ctx->ring_lock, portMAX_DELAY);
+    done->seq = ++ctx->seq;
+    uint32_t idx = done->seq % ctx->params.segment_depth;
+    segment_unref_locked(ctx->ring[idx]);
+    ctx->ring[idx] = done;
+    ctx->stats.fragments++;
+    ctx->stats.fragment_bytes = done->len;
+    xSemaphoreGive(ctx->ring_lock);
+    xSemaphoreGive(ctx->seg_ready);
+}
+
+int httpfmp4_handle(void *p, void *input, void *output) {
+    (void)output;
+    httpfmp4_ctx_t *ctx = (httpfmp4_ctx_t *)p;
+    mm_queue_item_t *input_item = (mm_queue_item_t *)input;
+    uint32_t avcc_len = 0;
+    int keyframe = 0;
+
+    if (!ctx->streaming) {
+        return 0;
+    }
+    xSemaphoreTake(ctx->writer_lock, portMAX_DELAY);
+    if (httpfmp4_annexb_to_avcc(ctx, (uint8_t *)input_item->data_addr, input_item->size, &avcc_len, &keyframe) < 0) {
+        goto exit;
+    }
+    if (ctx->fmp4 == NULL) {
+        // fragments can only start once the first IDR with parameter sets arrives
+        if (!keyframe || (ctx->sps_len < 4) || (ctx->pps_len == 0)) {
+            goto exit;
+        }
+        if (httpfmp4_open_writer(ctx) < 0) {
+            printf("\r\n[ERROR] HTTPFMP4 muxer init failed\n");
+            httpfmp4_close_writer(ctx);
+            goto exit;
+        }
+        ctx->base_ts = input_item->timestamp;
+    }
+    if (avcc_len == 0) {
+        goto exit;
+    }
+
+    // start a new fragment on every key frame so late joiners always begin with an IDR,
+    // and whenever the configured fragment duration has elapsed
+    if (ctx->cur_frames && (keyframe || ((input_item->timestamp - ctx->cur_start_ts) >= ctx->params.fragment_ms))) {
+        httpfmp4_publish(ctx);
+    }
+    if (ctx->cur_frames == 0) {
+        ctx->cur_start_ts = input_item->timestamp;
+        ctx->cur->keyframe = keyframe;
+    }
+    int64_t ts = (int64_t)(input_item->timestamp - ctx->base_ts);
+    fmp4_writer_write(ctx->fmp4, ctx->track, ctx->scratch, avcc_len, ts, ts, keyframe ? MOV_AV_FLAG_KEYFREAME : 0);
+    ctx->cur_frames++;
+
+exit:
+    xSemaphoreGive(ctx->writer_lock);
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// HTTP server, one task multiplexes every viewer with non-blocking sockets
+
+static void client_set_tx(httpfmp4_client_t *c, const uint8_t *data, uint32_t len, uint8_t chunked) {
+    c->tx_data = data;
+    c->tx_len = len;
+    c->tx_off = 0;
+    c->tx_chunked = chunked;
+    if (chunked) {
+        c->tx_phase = TX_CHUNK_HEADER;
+        c->chunk_hdr_len = snprintf(c->chunk_hdr, sizeof(c->chunk_hdr), "%lx\r\n", (unsigned long)len);
+    } else {
+        c->tx_phase = TX_PAYLOAD;
+    }
+}
+
+static void client_close(httpfmp4_ctx_t *ctx, httpfmp4_client_t *c) {
+    if (c->fd >= 0) {
+        lwip_close(c->fd);
+    }
+    if (c->seg) {
+        segment_unref(ctx, c->seg);
+    }
+    if (c->resp) {
+        free(c->resp);
+    }
+    if (c->state == CLIENT_STREAMING) {
+        ctx->stats.clients--;
+    }
+    memset(c, 0, sizeof(httpfmp4_client_t));
+    c->fd = -1;
+}
+
+// Pick the next fragment for a streaming viewer, returns 0 if none is ready yet
+static int client_next_payload(httpfmp4_ctx_t *ctx, httpfmp4_client_t *c) {
+    fmp4_segment_t *seg = NULL;
+    uint32_t depth = ctx->params.segment_depth;
+
+    xSemaphoreTake(ctx->ring_lock, portMAX_DELAY);
+    if (c->seg) {
+        segment_unref_locked(c->seg);
+        c->seg = NULL;
+    }
+    if ((ctx->init == NULL) || (ctx->seq == 0)) {
+        goto exit;
+    }
+    if (c->next_seq && ((ctx->seq - c->next_seq) >= depth) && (c->next_seq <= ctx->seq)) {
+        // viewer fell further behind than the ring holds, resync on the newest key frame
+        ctx->stats.dropped += ctx->seq - c->next_seq + 1;
+        c->next_seq = 0;
+    }
+    if (c->next_seq == 0) {
+        for (uint32_t s = ctx->seq; (s > 0) && ((ctx->seq - s) < depth); s--) {
+            fmp4_segment_t *cand = ctx->ring[s % depth];
+            if (cand && (cand->seq == s) && cand->keyframe) {
+                c->next_seq = s;
+                break;
+            }
+        }
+        if (c->next_seq == 0) {
+            goto exit;
+        }
+    }
+    if (!c->sent_init) {
+        c->seg = ctx->init;
+        c->seg->refcnt++;
+        c->sent_init = 1;
+        client_set_tx(c, c->seg->data, c->seg->len, 1);
+        xSemaphoreGive(ctx->ring_lock);
+        return 1;
+    }
+    if (c->next_seq <= ctx->seq) {
+        seg = ctx->ring[c->next_seq % depth];
+        if (seg && (seg->seq == c->next_seq)) {
+            seg->refcnt++;
+            c->seg = seg;
+            c->next_seq++;
+            client_set_tx(c, seg->data, seg->len, 1);
+            xSemaphoreGive(ctx->ring_lock);
+            return 1;
+        }
+    }
+
+exit:
+    xSemaphoreGive(ctx->ring_lock);
+    return 0;
+}
+
+// Push as much pending data as the socket accepts, returns -1 when the viewer is gone
+static int client_send(httpfmp4_ctx_t *ctx, httpfmp4_client_t *c) {
+    while (1) {
+        if (c->tx_data == NULL) {
+            if (c->state != CLIENT_STREAMING) {
+                return (c->state == CLIENT_RESPONSE) ? -1 : 0;
+            }
+            if (client_next_payload(ctx, c) == 0) {
+                return 0;
+            }
+        }
+
+        const uint8_t *ptr;
+        uint32_t remain;
+        if (c->tx_phase == TX_CHUNK_HEADER) {
+            ptr = (const uint8_t *)c->chunk_hdr + c->tx_off;
+            remain = c->chunk_hdr_len - c->tx_off;
+        } else if (c->tx_phase == TX_PAYLOAD) {
+            ptr = c->tx_data + c->tx_off;
+            remain = c->tx_len - c->tx_off;
+        } else {
+            ptr = (const uint8_t *)"\r\n" + c->tx_off;
+            remain = 2 - c->tx_off;
+        }
+
+        if (remain) {
+            int ret = lwip_send(c->fd, ptr, remain, MSG_DONTWAIT);
+            if (ret < 0) {
+                return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 0 : -1;
+            }
+            c->tx_off += ret;
+            if ((uint32_t)ret < remain) {
+                return 0;
+            }
+        }
+
+        c->tx_off = 0;
+        if ((c->tx_phase == TX_CHUNK_HEADER) || (c->tx_chunked && (c->tx_phase == TX_PAYLOAD))) {
+            c->tx_phase++;
+            continue;
+        }
+
+        // current buffer fully sent
+        c->tx_data = NULL;
+        if (c->resp) {
+            free(c->resp);
+            c->resp = NULL;
+        }
+        if (c->state == CLIENT_RESPONSE) {
+            return -1;
+        }
+    }
+}
+
+static void client_respond(httpfmp4_client_t *c, const char *text) {
+    c->resp = (uint8_t *)strdup(text);
+    if (c->resp) {
+        client_set_tx(c, c->resp, strlen(text), 0);
+    }
+}
+
+static void client_handle_request(httpfmp4_ctx_t *ctx, httpfmp4_client_t *c) {
+    char path[64] = {0};
+
+    c->req[c->req_len] = '\0';
+    if ((strncmp(c->req, "GET ", 4) != 0) || (sscanf(c->req + 4, "%63s", path) != 1)) {
+        c->state = CLIENT_RESPONSE;
+        client_respond(c, http_not_found);
+        return;
+    }
+
+    if (strncmp(path, "/stream", 7) == 0) {
+        int one = 1;
+        lwip_setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        c->state = CLIENT_STREAMING;
+        c->next_seq = 0;
+        c->sent_init = 0;
+        ctx->stats.clients++;
+        client_respond(c, http_stream_header);
+    } else if ((strcmp(path, "/") == 0) || (strcmp(path, "/index.html") == 0)) {
+        const char *codec = ctx->codec[0] ? ctx->codec : "avc1.640028";
+        int body_len = snprintf(NULL, 0, http_player_format, codec);
+        char *body = (char *)malloc(body_len + 1);
+        if (body) {
+            snprintf(body, body_len + 1, http_player_format, codec);
+            int resp_len = snprintf(NULL, 0, http_page_format, body_len, body);
+            c->resp = (uint8_t *)malloc(resp_len + 1);
+            if (c->resp) {
+                snprintf((char *)c->resp, resp_len + 1, http_page_format, body_len, body);
+                client_set_tx(c, c->resp, resp_len, 0);
+            }
+            free(body);
+        }
+        c->state = CLIENT_RESPONSE;
+    } else {
+        c->state = CLIENT_RESPONSE;
+        client_respond(c, http_not_found);
+    }
+}
+
+static int httpfmp4_listen(uint16_t port) {
+    int enable = 1;
+    struct sockaddr_in addr;
+    int fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        return -1;
+    }
+    lwip_setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    if ((lwip_bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (lwip_listen(fd, HTTPFMP4_MAX_CLIENTS) < 0)) {
+        lwip_close(fd);
+        return -1;
+    }
+    lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+static void httpfmp4_accept(httpfmp4_ctx_t *ctx) {
+    struct sockaddr_in cli_addr;
+    socklen_t addr_len = sizeof(cli_addr);
+
+    while (1) {
+        int fd = lwip_accept(ctx->listen_fd, (struct sockaddr *)&cli_addr, &addr_len);
+        if (fd < 0) {
+            return;
+        }
+        lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+        httpfmp4_client_t *c = NULL;
+        for (int i = 0; i < ctx->params.max_clients; i++) {
+            if (ctx->clients[i].state == CLIENT_FREE) {
+                c = &ctx->clients[i];
+                break;
+            }
+        }
+        if (c == NULL) {
+            lwip_send(fd, http_busy, strlen(http_busy), MSG_DONTWAIT);
+            lwip_close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->state = CLIENT_REQUEST;
+        c->req_len = 0;
+    }
+}
+
+static void httpfmp4_server_thread(void *param) {
+    httpfmp4_ctx_t *ctx = (httpfmp4_ctx_t *)param;
+    fd_set rfds;
+    fd_set wfds;
+    struct timeval tv;
+    char discard[64];
+    int waiting = 0;        // streaming viewers that have sent everything published
+    int blocked = 0;        // viewers with data the socket did not take
+
+    ctx->listen_fd = httpfmp4_listen(ctx->params.port);
+    if (ctx->listen_fd < 0) {
+        printf("\r\n[ERROR] HTTPFMP4 listen on port %d failed\n", ctx->params.port);
+        ctx->running = 0;
+    }
+
+    while (ctx->running) {
+        int maxfd = ctx->listen_fd;
+        uint32_t timeout_ms;
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+        FD_SET(ctx->listen_fd, &rfds);
+        for (int i = 0; i < ctx->params.max_clients; i++) {
+            if (ctx->clients[i].state != CLIENT_FREE) {
+                FD_SET(ctx->clients[i].fd, &rfds);
+                if (ctx->clients[i].tx_data != NULL) {
+                    FD_SET(ctx->clients[i].fd, &wfds);
+                }
+                if (ctx->clients[i].fd > maxfd) {
+                    maxfd = ctx->clients[i].fd;
+                }
+            }
+        }
+        // Without caught up viewers nothing is due before a socket event, so select blocks. Caught up
+        // viewers wait for the muxer to publish the next fragment instead, and the sockets are then
+        // checked without waiting. Only when both kinds are present does the task poll.
+        if (waiting && !blocked) {
+            xSemaphoreTake(ctx->seg_ready, HTTPFMP4_WAIT_MS);
+            timeout_ms = 0;
+        } else if (waiting) {
+            timeout_ms = HTTPFMP4_POLL_MS;
+        } else {
+            timeout_ms = HTTPFMP4_IDLE_MS;
+        }
+        tv.tv_sec = 0;
+        tv.tv_usec = timeout_ms * 1000;
+        if (lwip_select(maxfd + 1, &rfds, &wfds, NULL, &tv) < 0) {
+            vTaskDelay(HTTPFMP4_POLL_MS);
+            continue;
+        }
+
+        if (FD_ISSET(ctx->listen_fd, &rfds)) {
+            httpfmp4_accept(ctx);
+        }
+
+        waiting = 0;
+        blocked = 0;
+        for (int i = 0; i < ctx->params.max_clients; i++) {
+            httpfmp4_client_t *c = &ctx->clients[i];
+            if (c->state == CLIENT_FREE) {
+                continue;
+            }
+            if (FD_ISSET(c->fd, &rfds)) {
+                int ret;
+                if (c->state == CLIENT_REQUEST) {
+                    ret = lwip_recv(c->fd, c->req + c->req_len, HTTPFMP4_REQ_SIZE - 1 - c->req_len, MSG_DONTWAIT);
+                } else {
+                    ret = lwip_recv(c->fd, discard, sizeof(discard), MSG_DONTWAIT);
+                }
+                if ((ret == 0) || ((ret < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK))) {
+                    client_close(ctx, c);
+                    continue;
+                }
+                if ((c->state == CLIENT_REQUEST) && (ret > 0)) {
+                    c->req_len += ret;
+                    c->req[c->req_len] = '\0';
+                    if (strstr(c->req, "\r\n\r\n") || (c->req_len >= (HTTPFMP4_REQ_SIZE - 1))) {
+                        client_handle_request(ctx, c);
+                    }
+                }
+            }
+            if ((c->state == CLIENT_RESPONSE) || (c->state == CLIENT_STREAMING)) {
+                if (client_send(ctx, c) < 0) {
+                    client_close(ctx, c);
+                } else if (c->tx_data != NULL) {
+                    blocked = 1;
+                } else if (c->state == CLIENT_STREAMING) {
+                    waiting = 1;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < HTTPFMP4_MAX_CLIENTS; i++) {
+        if (ctx->clients[i].state != CLIENT_FREE) {
+            client_close(ctx, &ctx->clients[i]);
+        }
+    }
+    if (ctx->listen_fd >= 0) {
+        lwip_close(ctx->listen_fd);
+        ctx->listen_fd = -1;
+    }
+    ctx->task = NULL;
+    vTaskDelete(NULL);
+}
+
+static void httpfmp4_stop(httpfmp4_ctx_t *ctx) {
+    ctx->streaming = 0;
+    ctx->running = 0;
+    xSemaphoreGive(ctx->seg_ready);
+    for (int i = 0; (i < 200) && ctx->task; i++) {
+        vTaskDelay(10);
+    }
+    xSemaphoreTake(ctx->writer_lock, portMAX_DELAY);
+    httpfmp4_close_writer(ctx);
+    xSemaphoreGive(ctx->writer_lock);
+}
+
+//-----------------------------------------------------------------------------
+// module interface
+
+int httpfmp4_control(void *p, int cmd, int arg) {
+    httpfmp4_ctx_t *ctx = (httpfmp4_ctx_t *)p;
+
+    switch (cmd) {
+        case CMD_HTTPFMP4_SET_PARAMS:
+            memcpy(&ctx->params, (void *)arg, sizeof(httpfmp4_params_t));
+            break;
+        case CMD_HTTPFMP4_GET_PARAMS:
+            memcpy((void *)arg, &ctx->params, sizeof(httpfmp4_params_t));
+            break;
+        case CMD_HTTPFMP4_APPLY:
+            if ((ctx->params.max_clients == 0) || (ctx->params.max_clients > HTTPFMP4_MAX_CLIENTS)) {
+                ctx->params.max_clients = HTTPFMP4_MAX_CLIENTS;
+            }
+            if (ctx->params.segment_depth < 2) {
+                ctx->params.segment_depth = 2;
+            } else if (ctx->params.segment_depth > HTTPFMP4_MAX_SEGMENTS) {
+                ctx->params.segment_depth = HTTPFMP4_MAX_SEGMENTS;
+            }
+            if (ctx->params.fragment_ms == 0) {
+                ctx->params.fragment_ms = 1000 / (ctx->params.fps ? ctx->params.fps : 30);
+            }
+            break;
+        case CMD_HTTPFMP4_STREAMING:
+            if (arg) {
+                if (ctx->task == NULL) {
+                    memset(&ctx->stats, 0, sizeof(httpfmp4_stats_t));
+                    ctx->seq = 0;
+                    ctx->running = 1;
+                    if (xTaskCreate(httpfmp4_server_thread, "httpfmp4", HTTPFMP4_STACK_SIZE, ctx, HTTPFMP4_TASK_PRIORITY, &ctx->task) != pdPASS) {
+                        ctx->running = 0;
+                        ctx->task = NULL;
+                        printf("\r\n[ERROR] HTTPFMP4 create server task failed\n");
+                        return -1;
+                    }
+                }
+                ctx->streaming = 1;
+            } else {
+                httpfmp4_stop(ctx);
+            }
+            break;
+        case CMD_HTTPFMP4_GET_CLIENT_COUNT:
+            return ctx->stats.clients;
+        case CMD_HTTPFMP4_GET_STATS:
+            xSemaphoreTake(ctx->ring_lock, portMAX_DELAY);
+            memcpy((void *)arg, &ctx->stats, sizeof(httpfmp4_stats_t));
+            xSemaphoreGive(ctx->ring_lock);
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+void *httpfmp4_destroy(void *p) {
+    httpfmp4_ctx_t *ctx = (httpfmp4_ctx_t *)p;
+    if (ctx == NULL) {
+        return NULL;
+    }
+    httpfmp4_stop(ctx);
+    if (ctx->scratch) {
+        free(ctx->scratch);
+    }
+    if (ctx->ring_lock) {
+        vSemaphoreDelete(ctx->ring_lock);
+    }
+    if (ctx->writer_lock) {
+        vSemaphoreDelete(ctx->writer_lock);
+    }
+    if (ctx->seg_ready) {
+        vSemaphoreDelete(ctx->seg_ready);
+    }
+    free(ctx);
+    return NULL;
+}
+
+void *httpfmp4_create(void *parent) {
+    httpfmp4_ctx_t *ctx = (httpfmp4_ctx_t *)malloc(sizeof(httpfmp4_ctx_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(httpfmp4_ctx_t));
+    ctx->parent = parent;
+    ctx->listen_fd = -1;
+    for (int i = 0; i < HTTPFMP4_MAX_CLIENTS; i++) {
+        ctx->clients[i].fd = -1;
+    }
+    ctx->params.port = 80;
+    ctx->params.fps = 30;
+    ctx->params.fragment_ms = 200;
+    ctx->params.max_clients = 4;
+    ctx->params.segment_depth = 8;
+    ctx->ring_lock = xSemaphoreCreateMutex();
+    ctx->writer_lock = xSemaphoreCreateMutex();
+    ctx->seg_ready = xSemaphoreCreateBinary();
+    if ((ctx->ring_lock == NULL) || (ctx->writer_lock == NULL) || (ctx->seg_ready == NULL)) {
+        return httpfmp4_destroy(ctx);
+    }
+    return ctx;
+}
+
+mm_module_t httpfmp4_module = {
+    .create = httpfmp4_create,
+    .destroy = httpfmp4_destroy,
+    .control = httpfmp4_control,
+    .handle = httpfmp4_handle,
+
+    .new_item = NULL,
+    .del_item = NULL,
+
+    .output_type = MM_TYPE_NONE,
+    .module_type = MM_TYPE_VSINK,
+    .name = "HTTPFMP4"
+};
+
+//-----------------------------------------------------------------------------
+// Arduino driver interface
+
+mm_context_t *HTTPFMP4Init(void) {
+    return mm_module_open(&httpfmp4_module);
+}
+
+mm_context_t *HTTPFMP4Deinit(mm_context_t *p) {
+    return mm_module_close(p);
+}
+
+int HTTPFMP4SetParams(void *p, httpfmp4_params_t *params) {
+    return httpfmp4_control(p, CMD_HTTPFMP4_SET_PARAMS, (int)params);
+}
+
+int HTTPFMP4SetApply(void *p) {
+    return httpfmp4_control(p, CMD_HTTPFMP4_APPLY, 0);
+}
+
+void HTTPFMP4SetStreaming(void *p, int arg) {
+    httpfmp4_control(p, CMD_HTTPFMP4_STREAMING, arg);
+}
+
+int HTTPFMP4GetClientCount(void *p) {
+    return httpfmp4_control(p, CMD_HTTPFMP4_GET_CLIENT_COUNT, 0);
+}
+
+int HTTPFMP4GetStats(void *p, httpfmp4_stats_t *stats) {
+    return httpfmp4_control(p, CMD_HTTPFMP4_GET_STATS, (int)stats);
+}
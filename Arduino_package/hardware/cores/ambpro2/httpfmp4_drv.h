@@ -0,0 +1,49 @@
+#ifndef HTTPFMP4_DRV_H
+#define HTTPFMP4_DRV_H
+
+#include "mmf2_module.h"
+
+#define CMD_HTTPFMP4_SET_PARAMS         MM_MODULE_CMD(0x00)
+#define CMD_HTTPFMP4_GET_PARAMS         MM_MODULE_CMD(0x01)
+#define CMD_HTTPFMP4_STREAMING          MM_MODULE_CMD(0x02)
+#define CMD_HTTPFMP4_GET_CLIENT_COUNT   MM_MODULE_CMD(0x03)
+#define CMD_HTTPFMP4_GET_STATS          MM_MODULE_CMD(0x04)
+#define CMD_HTTPFMP4_APPLY              MM_MODULE_CMD(0x20)
+
+#define HTTPFMP4_MAX_CLIENTS            8
+#define HTTPFMP4_MAX_SEGMENTS           16
+
+typedef struct httpfmp4_params_s {
+    uint16_t port;
+    uint16_t width;
+    uint16_t height;
+    uint16_t fps;
+    uint32_t fragment_ms;       // target fragment duration, fragments are also cut on every key frame
+    uint8_t max_clients;        // number of simultaneous HTTP viewers
+    uint8_t segment_depth;      // number of recent fragments kept for catching up slow viewers
+} httpfmp4_params_t;
+
+typedef struct httpfmp4_stats_s {
+    uint32_t fragments;         // fragments produced since streaming started
+    uint32_t fragment_bytes;    // size of the last fragment
+    uint32_t dropped;           // fragments skipped by viewers that fell behind
+    uint32_t clients;           // viewers currently connected
+} httpfmp4_stats_t;
+
+mm_context_t *HTTPFMP4Init(void);
+
+mm_context_t *HTTPFMP4Deinit(mm_context_t *p);
+
+int HTTPFMP4SetParams(void *p, httpfmp4_params_t *params);
+
+int HTTPFMP4SetApply(void *p);
+
+void HTTPFMP4SetStreaming(void *p, int arg);
+
+int HTTPFMP4GetClientCount(void *p);
+
+int HTTPFMP4GetStats(void *p, httpfmp4_stats_t *stats);
+
+extern mm_module_t httpfmp4_module;
+
+#endif
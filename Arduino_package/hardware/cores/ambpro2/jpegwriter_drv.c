@@ -0,0 +1,624 @@
+#include "jpegwriter_drv.h"
+#include "mmf2_module.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <platform_stdlib.h>
+#include "ff.h"
+
+#define JPEGWRITER_STACK_SIZE       2048
+#define JPEGWRITER_TASK_PRIORITY    (tskIDLE_PRIORITY + 2)
+#define JPEGWRITER_IDLE_MS          100
+#define JPEGWRITER_ALIGN            32
+#define JPEGWRITER_ALIGN_UP(x, a)   ((((x) + (a) - 1) / (a)) * (a))
+
+typedef struct jpegwriter_frame_s {
+    uint32_t offset;            // in the buffer
+    uint32_t len;               // bytes to write, a whole padded record in packed files
+    uint32_t size;              // JPEG bytes
+    uint32_t timestamp;
+    uint32_t seq;
+} jpegwriter_frame_t;
+
+typedef struct jpegwriter_ctx_s {
+    void *parent;
+    jpegwriter_params_t params;
+
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t wake;
+    TaskHandle_t task;
+    volatile int running;
+    volatile int flush;
+
+    // frame buffer, filled by the StreamIO task calling handle and drained by the writer task
+    uint8_t *buf_mem;
+    uint8_t *buf;
+    uint32_t buf_size;
+    uint32_t wpos;
+    jpegwriter_frame_t frames[JPEGWRITER_MAX_FRAMES];
+    uint32_t head;
+    uint32_t count;
+    uint32_t used;
+    volatile uint32_t capture_left;
+    uint32_t last_ts;
+    int have_last;
+    uint32_t seq;
+    uint32_t start_ms;
+
+    // file state, owned by the writer task
+    FIL files[2];
+    FIL *fil;
+    FIL *next_fil;              // created ahead of time while the writer is idle
+    volatile int file_open;
+    int next_open;
+    uint32_t file_index;
+    uint32_t file_frames;
+    uint32_t file_bytes;
+    jpegwriter_index_t *index;
+    uint32_t avg_size;
+    uint32_t cluster;
+
+    jpegwriter_stats_t stats;
+} jpegwriter_ctx_t;
+
+static uint32_t jpegwriter_ms(void) {
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+static int jpegwriter_packed(jpegwriter_ctx_t *ctx) {
+    return (ctx->params.pack_frames > 1);
+}
+
+//-----------------------------------------------------------------------------
+// files
+
+// Clusters are allocated up front by seeking past the end of the new file, so the writes that
+// follow do not stop to search the FAT. The unused tail is truncated when the file is closed.
+// FF_USE_EXPAND is off in the SDK build, so f_expand() cannot give a contiguous block instead.
+static int jpegwriter_new_file(jpegwriter_ctx_t *ctx, FIL *fil, uint32_t size_hint) {
+    char name[JPEGWRITER_PATH_LEN + JPEGWRITER_PREFIX_LEN + 16];
+    uint32_t reserve = ctx->params.preallocate;
+    FRESULT res;
+
+    snprintf(name, sizeof(name), "%s%s%05lu.%s", ctx->params.path, ctx->params.prefix, ctx->file_index, jpegwriter_packed(ctx) ? "jpk" : "jpg");
+    res = f_open(fil, name, FA_CREATE_ALWAYS | FA_WRITE);
+    if (res != FR_OK) {
+        printf("\r\n[ERROR] JPEGWriter open %s failed %d\n", name, res);
+        ctx->stats.errors++;
+        return -1;
+    }
+    ctx->file_index++;
+
+    if (ctx->cluster == 0) {
+        ctx->cluster = fil->obj.fs->csize * fil->obj.fs->ssize;
+        if (ctx->params.write_bytes < ctx->cluster) {
+            ctx->params.write_bytes = ctx->cluster;
+        } else {
+            ctx->params.write_bytes -= ctx->params.write_bytes % ctx->cluster;
+        }
+    }
+    if (reserve == 0) {
+        if (size_hint < ctx->avg_size) {
+            size_hint = ctx->avg_size;
+        }
+        // a quarter more than the recent frames, JPEG size varies with the scene
+        reserve = size_hint + (size_hint / 4);
+        if (jpegwriter_packed(ctx)) {
+            reserve = (JPEGWRITER_ALIGN_UP(reserve + sizeof(jpegwriter_record_t), JPEGWRITER_SECTOR) + sizeof(jpegwriter_index_t)) * ctx->params.pack_frames;
+        }
+    }
+    if (reserve > 0) {
+        reserve = JPEGWRITER_ALIGN_UP(reserve, ctx->cluster);
+        // a full card leaves a shorter file, which only means less is reserved
+        f_lseek(fil, reserve);
+        f_lseek(fil, 0);
+    }
+    return 0;
+}
+
+static int jpegwriter_open(jpegwriter_ctx_t *ctx, uint32_t size_hint) {
+    FIL *fil;
+
+    if (ctx->next_open) {
+        fil = ctx->fil;
+        ctx->fil = ctx->next_fil;
+        ctx->next_fil = fil;
+        ctx->next_open = 0;
+    } else if (jpegwriter_new_file(ctx, ctx->fil, size_hint) < 0) {
+        return -1;
+    }
+    ctx->file_open = 1;
+    ctx->file_frames = 0;
+    ctx->file_bytes = 0;
+    return 0;
+}
+
+static void jpegwriter_close(jpegwriter_ctx_t *ctx) {
+    jpegwriter_footer_t footer;
+    UINT bw;
+    FRESULT res = FR_OK;
+
+    if (!ctx->file_open) {
+        return;
+    }
+    if (jpegwriter_packed(ctx) && (ctx->file_frames > 0)) {
+        footer.magic = JPEGWRITER_FOOTER_MAGIC;
+        footer.version = JPEGWRITER_PACK_VERSION;
+        footer.count = ctx->file_frames;
+        footer.index_offset = ctx->file_bytes;
+        res = f_write(ctx->fil, ctx->index, ctx->file_frames * sizeof(jpegwriter_index_t), &bw);
+        if (res == FR_OK) {
+            res = f_write(ctx->fil, &footer, sizeof(footer), &bw);
+        }
+    }
+    // drop what was reserved and not used
+    if ((f_truncate(ctx->fil) != FR_OK) || (f_close(ctx->fil) != FR_OK) || (res != FR_OK)) {
+        ctx->stats.errors++;
+    } else {
+        ctx->stats.files++;
+    }
+    ctx->file_open = 0;
+    ctx->file_frames = 0;
+    ctx->file_bytes = 0;
+}
+
+// Delete the file created ahead of time once capture stops
+static void jpegwriter_discard_next(jpegwriter_ctx_t *ctx) {
+    char name[JPEGWRITER_PATH_LEN + JPEGWRITER_PREFIX_LEN + 16];
+
+    if (!ctx->next_open) {
+        return;
+    }
+    f_close(ctx->next_fil);
+    ctx->next_open = 0;
+    ctx->file_index--;
+    snprintf(name, sizeof(name), "%s%s%05lu.%s", ctx->params.path, ctx->params.prefix, ctx->file_index, jpegwriter_packed(ctx) ? "jpk" : "jpg");
+    f_unlink(name);
+}
+
+//-----------------------------------------------------------------------------
+// writer task
+
+// Frames that lie back to back in the buffer and go to the same packed file are written with one
+// call. Records are whole sectors and the buffer is cache line aligned, so FatFs passes every
+// write straight to the card as multi-sector transfers instead of copying through its window.
+static int jpegwriter_next_batch(jpegwriter_ctx_t *ctx, uint32_t *offset, uint32_t *len) {
+    int n = 0;
+    uint32_t room = jpegwriter_packed(ctx) ? (ctx->params.pack_frames - ctx->file_frames) : 1;
+
+    xSemaphoreTake(ctx->lock, portMAX_DELAY);
+    while ((n < (int)ctx->count) && (n < (int)room)) {
+        jpegwriter_frame_t *f = &ctx->frames[(ctx->head + n) % JPEGWRITER_MAX_FRAMES];
+        if (n == 0) {
+            *offset = f->offset;
+            *len = f->len;
+        } else if ((f->offset != (*offset + *len)) || ((*len + f->len) > ctx->params.write_bytes)) {
+            break;
+        } else {
+            *len += f->len;
+        }
+        n++;
+    }
+    xSemaphoreGive(ctx->lock);
+    return n;
+}
+
+static void jpegwriter_release(jpegwriter_ctx_t *ctx, int n) {
+    xSemaphoreTake(ctx->lock, portMAX_DELAY);
+    for (int i = 0; i < n; i++) {
+        ctx->used -= JPEGWRITER_ALIGN_UP(ctx->frames[ctx->head].len, JPEGWRITER_ALIGN);
+        ctx->head = (ctx->head + 1) % JPEGWRITER_MAX_FRAMES;
+        ctx->count--;
+    }
+    ctx->stats.queued = ctx->count;
+    xSemaphoreGive(ctx->lock);
+}
+
+static void jpegwriter_write_batch(jpegwriter_ctx_t *ctx, int n, uint32_t offset, uint32_t len) {
+    jpegwriter_frame_t *first = &ctx->frames[ctx->head];
+    uint32_t done = 0;
+    uint32_t chunk;
+    uint32_t start;
+    UINT bw;
+    FRESULT res;
+
+    if (!ctx->file_open && (jpegwriter_open(ctx, first->size) < 0)) {
+        ctx->stats.dropped += n;
+        return;
+    }
+    while (done < len) {
+        chunk = ((len - done) > ctx->params.write_bytes) ? ctx->params.write_bytes : (len - done);
+        start = jpegwriter_ms();
+        res = f_write(ctx->fil, ctx->buf + offset + done, chunk, &bw);
+        ctx->stats.write_ms += jpegwriter_ms() - start;
+        if ((res != FR_OK) || (bw != chunk)) {
+            printf("\r\n[ERROR] JPEGWriter write failed %d\n", res);
+            ctx->stats.errors++;
+            ctx->stats.dropped += n;
+            jpegwriter_close(ctx);
+            return;
+        }
+        done += chunk;
+        ctx->stats.bytes += chunk;
+    }
+
+    for (int i = 0; i < n; i++) {
+        jpegwriter_frame_t *f = &ctx->frames[(ctx->head + i) % JPEGWRITER_MAX_FRAMES];
+        if (jpegwriter_packed(ctx)) {
+            ctx->index[ctx->file_frames].offset = ctx->file_bytes;
+            ctx->index[ctx->file_frames].size = f->size;
+            ctx->index[ctx->file_frames].timestamp = f->timestamp;
+            ctx->index[ctx->file_frames].seq = f->seq;
+        }
+        ctx->file_bytes += f->len;
+        ctx->file_frames++;
+        ctx->avg_size = (ctx->avg_size == 0) ? f->size : (((ctx->avg_size * 7) + f->size) / 8);
+    }
+    ctx->stats.frames += n;
+    if (!jpegwriter_packed(ctx) || (ctx->file_frames >= ctx->params.pack_frames)) {
+        jpegwriter_close(ctx);
+    }
+}
+
+static void jpegwriter_thread(void *param) {
+    jpegwriter_ctx_t *ctx = (jpegwriter_ctx_t *)param;
+    uint32_t offset = 0;
+    uint32_t len = 0;
+    int n;
+
+    while (ctx->running) {
+        n = jpegwriter_next_batch(ctx, &offset, &len);
+        if (n > 0) {
+            jpegwriter_write_batch(ctx, n, offset, len);
+            jpegwriter_release(ctx, n);
+            continue;
+        }
+
+        if (ctx->flush || (ctx->capture_left == 0)) {
+            jpegwriter_close(ctx);
+            jpegwriter_discard_next(ctx);
+            ctx->flush = 0;
+        } else if (!ctx->file_open && !ctx->next_open && (ctx->avg_size > 0)) {
+            // create the next file while there is nothing to write, so the directory update
+            // and cluster allocation are done before the frame arrives
+            if (jpegwriter_new_file(ctx, ctx->next_fil, 0) == 0) {
+                ctx->next_open = 1;
+            }
+        }
+        xSemaphoreTake(ctx->wake, JPEGWRITER_IDLE_MS);
+    }
+
+    jpegwriter_close(ctx);
+    jpegwriter_discard_next(ctx);
+    ctx->task = NULL;
+    vTaskDelete(NULL);
+}
+
+//-----------------------------------------------------------------------------
+// frame input
+
+// Find room for len bytes, the buffer is used as a ring of contiguous frames
+static int jpegwriter_reserve(jpegwriter_ctx_t *ctx, uint32_t len, uint32_t *offset) {
+    uint32_t rpos;
+
+    if (ctx->count == 0) {
+        ctx->wpos = 0;
+    }
+    if (ctx->count >= ctx->params.queue_frames) {
+        return -1;
+    }
+    rpos = (ctx->count > 0) ? ctx->frames[ctx->head].offset : 0;
+    if (ctx->wpos >= rpos) {
+        // wrap to the start only if the frame fits before the oldest queued one
+        if ((ctx->buf_size - ctx->wpos) >= len) {
+            *offset = ctx->wpos;
+        } else if (len < rpos) {
+            *offset = 0;
+        } else {
+            return -1;
+        }
+    } else if ((ctx->wpos + len) < rpos) {
+        *offset = ctx->wpos;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int jpegwriter_handle(void *p, void *input, void *output) {
+    (void)output;
+    jpegwriter_ctx_t *ctx = (jpegwriter_ctx_t *)p;
+    mm_queue_item_t *input_item = (mm_queue_item_t *)input;
+    uint32_t size = input_item->size;
+    uint32_t ts = input_item->timestamp;
+    uint32_t len;
+    uint32_t offset;
+    jpegwriter_frame_t *f;
+    int ret;
+
+    if ((ctx->task == NULL) || (ctx->buf == NULL) || (ctx->capture_left == 0) || (size == 0)) {
+        return 0;
+    }
+    if ((ctx->params.interval_ms > 0) && ctx->have_last && ((ts - ctx->last_ts) < ctx->params.interval_ms)) {
+        return 0;
+    }
+    len = jpegwriter_packed(ctx) ? JPEGWRITER_ALIGN_UP(size + sizeof(jpegwriter_record_t), JPEGWRITER_SECTOR) : size;
+
+    xSemaphoreTake(ctx->lock, portMAX_DELAY);
+    ret = jpegwriter_reserve(ctx, JPEGWRITER_ALIGN_UP(len, JPEGWRITER_ALIGN), &offset);
+    if (ret < 0) {
+        ctx->stats.dropped++;
+    }
+    xSemaphoreGive(ctx->lock);
+    if (ret < 0) {
+        return 0;
+    }
+
+    // only this task moves wpos, the writer cannot reuse the reserved space before it is queued
+    if (jpegwriter_packed(ctx)) {
+        jpegwriter_record_t *rec = (jpegwriter_record_t *)(ctx->buf + offset);
+        memset(rec, 0, sizeof(jpegwriter_record_t));
+        rec->magic = JPEGWRITER_RECORD_MAGIC;
+        rec->seq = ctx->seq;
+        rec->timestamp = ts;
+        rec->size = size;
+        memcpy(ctx->buf + offset + sizeof(jpegwriter_record_t), (void *)input_item->data_addr, size);
+        memset(ctx->buf + offset + sizeof(jpegwriter_record_t) + size, 0, len - size - sizeof(jpegwriter_record_t));
+    } else {
+        memcpy(ctx->buf + offset, (void *)input_item->data_addr, size);
+    }
+
+    xSemaphoreTake(ctx->lock, portMAX_DELAY);
+    f = &ctx->frames[(ctx->head + ctx->count) % JPEGWRITER_MAX_FRAMES];
+    f->offset = offset;
+    f->len = len;
+    f->size = size;
+    f->timestamp = ts;
+    f->seq = ctx->seq;
+    ctx->count++;
+    ctx->wpos = offset + JPEGWRITER_ALIGN_UP(len, JPEGWRITER_ALIGN);
+    ctx->used += JPEGWRITER_ALIGN_UP(len, JPEGWRITER_ALIGN);
+    if (ctx->used > ctx->stats.queue_peak) {
+        ctx->stats.queue_peak = ctx->used;
+    }
+    ctx->stats.queued = ctx->count;
+    xSemaphoreGive(ctx->lock);
+
+    ctx->seq++;
+    ctx->last_ts = ts;
+    ctx->have_last = 1;
+    if ((ctx->capture_left != JPEGWRITER_CONTINUOUS) && (ctx->capture_left > 0)) {
+        ctx->capture_left--;
+    }
+    xSemaphoreGive(ctx->wake);
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// module interface
+
+static void jpegwriter_stop(jpegwriter_ctx_t *ctx) {
+    ctx->capture_left = 0;
+    ctx->running = 0;
+    if (ctx->wake) {
+        xSemaphoreGive(ctx->wake);
+    }
+    for (int i = 0; (i < 500) && ctx->task; i++) {
+        vTaskDelay(10);
+    }
+}
+
+static int jpegwriter_apply(jpegwriter_ctx_t *ctx) {
+    if ((ctx->params.queue_frames == 0) || (ctx->params.queue_frames > JPEGWRITER_MAX_FRAMES)) {
+        ctx->params.queue_frames = JPEGWRITER_MAX_FRAMES;
+    }
+    if (ctx->params.pack_frames > JPEGWRITER_MAX_PACK) {
+        ctx->params.pack_frames = JPEGWRITER_MAX_PACK;
+    }
+    if (ctx->params.write_bytes < JPEGWRITER_SECTOR) {
+        ctx->params.write_bytes = 64 * 1024;
+    }
+
+    // settings take effect with an idle writer and an empty buffer, file numbers carry on
+    jpegwriter_stop(ctx);
+    if (ctx->task != NULL) {
+        printf("\r\n[ERROR] JPEGWriter writer task did not stop\n");
+        return -1;
+    }
+    if ((ctx->buf_mem == NULL) || (ctx->buf_size != ctx->params.queue_bytes)) {
+        if (ctx->buf_mem) {
+            free(ctx->buf_mem);
+            ctx->buf_mem = NULL;
+            ctx->buf = NULL;
+        }
+        ctx->buf_mem = (uint8_t *)malloc(ctx->params.queue_bytes + JPEGWRITER_ALIGN);
+        if (ctx->buf_mem == NULL) {
+            printf("\r\n[ERROR] JPEGWriter allocate %lu byte buffer failed\n", ctx->params.queue_bytes);
+            return -1;
+        }
+        ctx->buf = (uint8_t *)JPEGWRITER_ALIGN_UP((uint32_t)ctx->buf_mem, JPEGWRITER_ALIGN);
+        ctx->buf_size = ctx->params.queue_bytes;
+    }
+    if (ctx->index) {
+        free(ctx->index);
+        ctx->index = NULL;
+    }
+    if (ctx->params.pack_frames > 1) {
+        ctx->index = (jpegwriter_index_t *)malloc(ctx->params.pack_frames * sizeof(jpegwriter_index_t));
+        if (ctx->index == NULL) {
+            printf("\r\n[ERROR] JPEGWriter allocate index failed\n");
+            return -1;
+        }
+    }
+
+    ctx->head = 0;
+    ctx->count = 0;
+    ctx->used = 0;
+    ctx->wpos = 0;
+    ctx->seq = 0;
+    ctx->have_last = 0;
+    ctx->start_ms = 0;
+    ctx->avg_size = 0;
+    ctx->cluster = 0;
+    ctx->flush = 0;
+    memset(&ctx->stats, 0, sizeof(jpegwriter_stats_t));
+
+    ctx->running = 1;
+    if (xTaskCreate(jpegwriter_thread, "jpegwriter", JPEGWRITER_STACK_SIZE, ctx, JPEGWRITER_TASK_PRIORITY, &ctx->task) != pdPASS) {
+        ctx->running = 0;
+        ctx->task = NULL;
+        printf("\r\n[ERROR] JPEGWriter create writer task failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int jpegwriter_flush(jpegwriter_ctx_t *ctx, uint32_t timeout) {
+    uint32_t start = jpegwriter_ms();
+
+    if (ctx->task == NULL) {
+        return 0;
+    }
+    ctx->flush = 1;
+    xSemaphoreGive(ctx->wake);
+    while (ctx->flush || (ctx->count > 0) || ctx->file_open) {
+        if ((jpegwriter_ms() - start) >= timeout) {
+            return -1;
+        }
+        vTaskDelay(10);
+    }
+    return 0;
+}
+
+int jpegwriter_control(void *p, int cmd, int arg) {
+    jpegwriter_ctx_t *ctx = (jpegwriter_ctx_t *)p;
+
+    switch (cmd) {
+        case CMD_JPEGWRITER_SET_PARAMS:
+            memcpy(&ctx->params, (void *)arg, sizeof(jpegwriter_params_t));
+            break;
+        case CMD_JPEGWRITER_GET_PARAMS:
+            memcpy((void *)arg, &ctx->params, sizeof(jpegwriter_params_t));
+            break;
+        case CMD_JPEGWRITER_APPLY:
+            return jpegwriter_apply(ctx);
+        case CMD_JPEGWRITER_CAPTURE:
+            if ((arg != 0) && (ctx->start_ms == 0)) {
+                ctx->start_ms = jpegwriter_ms() | 1;
+            }
+            // a new capture saves its first frame without waiting for the interval
+            if ((arg != 0) && (ctx->capture_left == 0)) {
+                ctx->have_last = 0;
+            }
+            ctx->capture_left = (uint32_t)arg;
+            xSemaphoreGive(ctx->wake);
+            break;
+        case CMD_JPEGWRITER_SET_INTERVAL:
+            ctx->params.interval_ms = (uint32_t)arg;
+            break;
+        case CMD_JPEGWRITER_FLUSH:
+            return jpegwriter_flush(ctx, (uint32_t)arg);
+        case CMD_JPEGWRITER_GET_STATS:
+            xSemaphoreTake(ctx->lock, portMAX_DELAY);
+            memcpy((void *)arg, &ctx->stats, sizeof(jpegwriter_stats_t));
+            xSemaphoreGive(ctx->lock);
+            ((jpegwriter_stats_t *)arg)->elapsed_ms = ctx->start_ms ? (jpegwriter_ms() - ctx->start_ms) : 0;
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+void *jpegwriter_destroy(void *p) {
+    jpegwriter_ctx_t *ctx = (jpegwriter_ctx_t *)p;
+    if (ctx == NULL) {
+        return NULL;
+    }
+    jpegwriter_stop(ctx);
+    if (ctx->buf_mem) {
+        free(ctx->buf_mem);
+    }
+    if (ctx->index) {
+        free(ctx->index);
+    }
+    if (ctx->lock) {
+        vSemaphoreDelete(ctx->lock);
+    }
+    if (ctx->wake) {
+        vSemaphoreDelete(ctx->wake);
+    }
+    free(ctx);
+    return NULL;
+}
+
+void *jpegwriter_create(void *parent) {
+    jpegwriter_ctx_t *ctx = (jpegwriter_ctx_t *)malloc(sizeof(jpegwriter_ctx_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(jpegwriter_ctx_t));
+    ctx->parent = parent;
+    ctx->fil = &ctx->files[0];
+    ctx->next_fil = &ctx->files[1];
+    strcpy(ctx->params.prefix, "image");
+    ctx->params.queue_bytes = 4 * 1024 * 1024;
+    ctx->params.queue_frames = 16;
+    ctx->params.write_bytes = 64 * 1024;
+    ctx->lock = xSemaphoreCreateMutex();
+    ctx->wake = xSemaphoreCreateBinary();
+    if ((ctx->lock == NULL) || (ctx->wake == NULL)) {
+        return jpegwriter_destroy(ctx);
+    }
+    return ctx;
+}
+
+mm_module_t jpegwriter_module = {
+    .create = jpegwriter_create,
+    .destroy = jpegwriter_destroy,
+    .control = jpegwriter_control,
+    .handle = jpegwriter_handle,
+
+    .new_item = NULL,
+    .del_item = NULL,
+
+    .output_type = MM_TYPE_NONE,
+    .module_type = MM_TYPE_VSINK,
+    .name = "JPEGWRITER"
+};
+
+//-----------------------------------------------------------------------------
+// Arduino driver interface
+
+mm_context_t *JPEGWriterInit(void) {
+    return mm_module_open(&jpegwriter_module);
+}
+
+mm_context_t *JPEGWriterDeinit(mm_context_t *p) {
+    return mm_module_close(p);
+}
+
+int JPEGWriterSetParams(void *p, jpegwriter_params_t *params) {
+    return jpegwriter_control(p, CMD_JPEGWRITER_SET_PARAMS, (int)params);
+}
+
+int JPEGWriterSetApply(void *p) {
+    return jpegwriter_control(p, CMD_JPEGWRITER_APPLY, 0);
+}
+
+void JPEGWriterCapture(void *p, uint32_t count) {
+    jpegwriter_control(p, CMD_JPEGWRITER_CAPTURE, (int)count);
+}
+
+void JPEGWriterSetInterval(void *p, uint32_t ms) {
+    jpegwriter_control(p, CMD_JPEGWRITER_SET_INTERVAL, (int)ms);
+}
+
+int JPEGWriterFlush(void *p, uint32_t timeout) {
+    return jpegwriter_control(p, CMD_JPEGWRITER_FLUSH, (int)timeout);
+}
+
+int JPEGWriterGetStats(void *p, jpegwriter_stats_t *stats) {
+    return jpegwriter_control(p, CMD_JPEGWRITER_GET_STATS, (int)stats);
+}
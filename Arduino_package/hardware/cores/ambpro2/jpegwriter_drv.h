@@ -0,0 +1,91 @@
+#ifndef JPEGWRITER_DRV_H
+#define JPEGWRITER_DRV_H
+
+#include "mmf2_module.h"
+
+#define CMD_JPEGWRITER_SET_PARAMS       MM_MODULE_CMD(0x00)
+#define CMD_JPEGWRITER_GET_PARAMS       MM_MODULE_CMD(0x01)
+#define CMD_JPEGWRITER_CAPTURE          MM_MODULE_CMD(0x02)
+#define CMD_JPEGWRITER_FLUSH            MM_MODULE_CMD(0x03)
+#define CMD_JPEGWRITER_GET_STATS        MM_MODULE_CMD(0x04)
+#define CMD_JPEGWRITER_SET_INTERVAL     MM_MODULE_CMD(0x05)
+#define CMD_JPEGWRITER_APPLY            MM_MODULE_CMD(0x20)
+
+#define JPEGWRITER_CONTINUOUS           0xFFFFFFFF
+#define JPEGWRITER_MAX_FRAMES           64
+#define JPEGWRITER_MAX_PACK             1024
+#define JPEGWRITER_PATH_LEN             128
+#define JPEGWRITER_PREFIX_LEN           32
+#define JPEGWRITER_SECTOR               512
+
+// Packed files (.jpk) hold a sequence of records, each a jpegwriter_record_t followed by the
+// JPEG data and zero padded to a multiple of JPEGWRITER_SECTOR. An array of jpegwriter_index_t,
+// one per record, and a jpegwriter_footer_t end the file. All fields are little endian.
+#define JPEGWRITER_RECORD_MAGIC         0x524A5041      // "APJR"
+#define JPEGWRITER_FOOTER_MAGIC         0x494A5041      // "APJI"
+#define JPEGWRITER_PACK_VERSION         1
+
+typedef struct jpegwriter_record_s {
+    uint32_t magic;
+    uint32_t seq;               // frame number since begin
+    uint32_t timestamp;         // video timestamp in ms
+    uint32_t size;              // JPEG bytes following this header
+    uint32_t reserved[4];
+} jpegwriter_record_t;
+
+typedef struct jpegwriter_index_s {
+    uint32_t offset;            // file offset of the record header
+    uint32_t size;
+    uint32_t timestamp;
+    uint32_t seq;
+} jpegwriter_index_t;
+
+typedef struct jpegwriter_footer_s {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t index_offset;
+} jpegwriter_footer_t;
+
+typedef struct jpegwriter_params_s {
+    char path[JPEGWRITER_PATH_LEN];         // directory of the files, including the trailing '/'
+    char prefix[JPEGWRITER_PREFIX_LEN];
+    uint32_t interval_ms;       // minimum time between saved frames, 0 to save every frame
+    uint32_t queue_bytes;       // buffer between the video channel and the writer task
+    uint16_t queue_frames;      // frames the buffer can hold, up to JPEGWRITER_MAX_FRAMES
+    uint16_t pack_frames;       // frames per packed file, 0 or 1 writes a .jpg per frame
+    uint32_t write_bytes;       // largest single card write, rounded down to whole clusters
+    uint32_t preallocate;       // bytes reserved when a file is created, 0 to estimate from recent frames
+} jpegwriter_params_t;
+
+typedef struct jpegwriter_stats_s {
+    uint32_t frames;            // frames written
+    uint32_t dropped;           // frames lost to a full buffer or a failed write
+    uint32_t errors;            // failed file operations
+    uint32_t files;             // files completed
+    uint32_t queued;            // frames waiting in the buffer
+    uint32_t queue_peak;        // most buffer bytes ever in use
+    uint64_t bytes;             // bytes written to the card
+    uint32_t write_ms;          // time spent in card writes
+    uint32_t elapsed_ms;        // since the first capture after begin
+} jpegwriter_stats_t;
+
+mm_context_t *JPEGWriterInit(void);
+
+mm_context_t *JPEGWriterDeinit(mm_context_t *p);
+
+int JPEGWriterSetParams(void *p, jpegwriter_params_t *params);
+
+int JPEGWriterSetApply(void *p);
+
+void JPEGWriterCapture(void *p, uint32_t count);
+
+void JPEGWriterSetInterval(void *p, uint32_t ms);
+
+int JPEGWriterFlush(void *p, uint32_t timeout);
+
+int JPEGWriterGetStats(void *p, jpegwriter_stats_t *stats);
+
+extern mm_module_t jpegwriter_module;
+
+#endif
@@ -33,16 +33,80 @@ extern void voe_t2ff_prealloc(void);
 void initVariant() __attribute__((weak));
 void initVariant() { }
 
+// Event driven loop, see loopSleepEnable()
+static uint32_t loop_event = 0;
+static volatile uint32_t loop_sleep_timeout = 0;
+static volatile uint32_t loop_deadline = 0;
+static volatile uint8_t loop_deadline_set = 0;
+
+void loopSleepEnable(uint32_t timeout) {
+    if (loop_event == 0) {
+        loop_event = os_semaphore_create_arduino(1);
+        if (loop_event == 0) {
+            printf("\r\n[ERROR] %s loop event create failed\n", __FUNCTION__);
+            return;
+        }
+        os_semaphore_wait_arduino(loop_event, 0);
+    }
+    loop_sleep_timeout = timeout;
+}
+
+void loopSleepDisable(void) {
+    loop_sleep_timeout = 0;
+    loopWakeup();
+}
+
+void loopWakeup(void) {
+    if (loop_event) {
+        os_semaphore_release_arduino(loop_event);
+    }
+}
+
+void loopWakeAfter(uint32_t ms) {
+    uint32_t deadline = millis() + ms;
+
+    if ((!loop_deadline_set) || ((int32_t)(deadline - loop_deadline) < 0)) {
+        loop_deadline = deadline;
+        loop_deadline_set = 1;
+    }
+}
+
+static void loop_sleep(void) {
+    uint32_t timeout = loop_sleep_timeout;
+    int32_t remaining;
+
+    if (loop_deadline_set) {
+        remaining = (int32_t)(loop_deadline - millis());
+        if (remaining <= 0) {
+            loop_deadline_set = 0;
+            return;
+        }
+        if ((uint32_t)remaining < timeout) {
+            timeout = (uint32_t)remaining;
+        }
+    }
+    os_semaphore_wait_arduino(loop_event, timeout);
+    if (loop_deadline_set && ((int32_t)(loop_deadline - millis()) <= 0)) {
+        loop_deadline_set = 0;
+    }
+}
+
 void main_task (void*) {
     delay(1);
+    bootMark("setup");
     setup();
+    bootMark("loop");
 
     for (;;) {
         loop();
         if (serialEventRun) {
             serialEventRun();
         }
-        vPortYield();
+        if (loop_sleep_timeout) {
+            loop_sleep();
+        } else {
+            vPortYield();
+        }
     }
     vTaskDelete(NULL);
 }
@@ -50,8 +114,11 @@ void main_task (void*) {
 int main(void) {
 
     ameba_init();
+    bootMark("ameba_init");
     initVariant();
+    bootMark("variant");
     voe_t2ff_prealloc();
+    bootMark("t2ff_prealloc");
 
     if (xTaskCreate(main_task, ((const char *)"main task"), MAIN_THREAD_STACK_SIZE, NULL, 1, NULL) != pdPASS) {
         printf("\r\n[ERROR] %s xTaskCreate(main task) failed\n", __FUNCTION__);
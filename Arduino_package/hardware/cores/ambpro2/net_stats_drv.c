@@ -0,0 +1,304 @@
+#include "net_stats_drv.h"
+
+#include <string.h>
+#include <lwip/opt.h>
+#include <lwip/sys.h>
+#include <lwip/memp.h>
+#include <lwip/tcp.h>
+#include <lwip/priv/memp_priv.h>
+#include <lwip/priv/tcp_priv.h>
+#include <lwip/priv/tcpip_priv.h>
+#include <lwip/priv/sockets_priv.h>
+#include <lwip/api.h>
+
+// LWIP_STATS is off in the prebuilt stack, so usage is read from the pool free lists and the TCP
+// PCBs in the tcpip thread instead of from the lwip_stats counters.
+
+#define NET_STATS_RTX_TRACK         16
+
+// same order as memp_t
+static const char *const net_pool_names[] = {
+#define LWIP_MEMPOOL(name, num, size, desc) desc,
+#include "lwip/priv/memp_std.h"
+};
+
+typedef struct net_rtx_track_s {
+    const struct tcp_pcb *pcb;
+    uint8_t nrtx;
+} net_rtx_track_t;
+
+typedef struct net_rcv_cap_s {
+    const struct tcp_pcb *pcb;
+    uint32_t cap;
+} net_rcv_cap_t;
+
+static uint16_t net_pool_peak[MEMP_MAX];
+static uint32_t net_pool_exhausted[MEMP_MAX];
+static net_rtx_track_t net_rtx_track[NET_STATS_RTX_TRACK];
+static uint32_t net_rtx_total = 0;
+static uint16_t net_ooseq_peak = 0;
+static uint32_t net_samples = 0;
+static net_rcv_cap_t net_rcv_cap[MEMP_NUM_NETCONN];
+
+typedef struct net_stats_call_s {
+    struct tcpip_api_call_data call;
+    int sock;
+    uint32_t value;
+    void *out;
+    int ret;
+} net_stats_call_t;
+
+static uint16_t net_pool_used(const struct memp_desc *desc) {
+    uint16_t free_cnt = 0;
+    struct memp *m;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    for (m = *desc->tab; (m != NULL) && (free_cnt < desc->num); m = m->next) {
+        free_cnt++;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+    return (desc->num - free_cnt);
+}
+
+static uint16_t net_tcp_ooseq_count(const struct tcp_pcb *pcb) {
+    uint16_t count = 0;
+#if TCP_QUEUE_OOSEQ
+    for (const struct tcp_seg *seg = pcb->ooseq; seg != NULL; seg = seg->next) {
+        count++;
+    }
+#else
+    (void)pcb;
+#endif
+    return count;
+}
+
+static uint32_t net_tcp_queue_bytes(const struct tcp_seg *seg) {
+    uint32_t bytes = 0;
+    for (; seg != NULL; seg = seg->next) {
+        bytes += seg->len;
+    }
+    return bytes;
+}
+
+// Count retransmission timeouts by comparing nrtx with the previous sample of the same PCB
+static void net_tcp_track_rtx(net_rtx_track_t *next, int *next_cnt, const struct tcp_pcb *pcb) {
+    uint8_t last = 0;
+
+    for (int i = 0; i < NET_STATS_RTX_TRACK; i++) {
+        if (net_rtx_track[i].pcb == pcb) {
+            last = net_rtx_track[i].nrtx;
+            break;
+        }
+    }
+    if (pcb->nrtx > last) {
+        net_rtx_total += (pcb->nrtx - last);
+    }
+    if (*next_cnt < NET_STATS_RTX_TRACK) {
+        next[*next_cnt].pcb = pcb;
+        next[*next_cnt].nrtx = pcb->nrtx;
+        (*next_cnt)++;
+    }
+}
+
+static err_t net_stats_sample_fn(struct tcpip_api_call_data *call) {
+    net_stats_call_t *msg = (net_stats_call_t *)call;
+    net_stats_t *stats = (net_stats_t *)msg->out;
+    net_rtx_track_t next[NET_STATS_RTX_TRACK];
+    int next_cnt = 0;
+
+    memset(stats, 0, sizeof(net_stats_t));
+    net_samples++;
+
+    for (int i = 0; (i < MEMP_MAX) && (i < NET_STATS_MAX_POOLS); i++) {
+        const struct memp_desc *desc = memp_pools[i];
+        net_pool_stats_t *pool = &stats->pools[i];
+        pool->name = net_pool_names[i];
+        pool->size = desc->size;
+        pool->num = desc->num;
+        pool->used = net_pool_used(desc);
+        if (pool->used > net_pool_peak[i]) {
+            net_pool_peak[i] = pool->used;
+        }
+        if (pool->used >= pool->num) {
+            net_pool_exhausted[i]++;
+        }
+        pool->peak = net_pool_peak[i];
+        pool->exhausted = net_pool_exhausted[i];
+        stats->pool_count++;
+    }
+
+    memset(next, 0, sizeof(next));
+    for (const struct tcp_pcb *pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+        stats->tcp.pcbs++;
+        stats->tcp.unsent += net_tcp_queue_bytes(pcb->unsent);
+        stats->tcp.unacked += net_tcp_queue_bytes(pcb->unacked);
+        stats->tcp.ooseq += net_tcp_ooseq_count(pcb);
+        if (pcb->nrtx) {
+            stats->tcp.rtx_pcbs++;
+        }
+        net_tcp_track_rtx(next, &next_cnt, pcb);
+    }
+    memcpy(net_rtx_track, next, sizeof(net_rtx_track));
+    if (stats->tcp.ooseq > net_ooseq_peak) {
+        net_ooseq_peak = stats->tcp.ooseq;
+    }
+    stats->tcp.ooseq_peak = net_ooseq_peak;
+    stats->tcp.rtx = net_rtx_total;
+    stats->samples = net_samples;
+    return ERR_OK;
+}
+
+static struct tcp_pcb *net_sock_tcp_pcb(int sock) {
+    struct lwip_sock *lsock = lwip_socket_dbg_get_socket(sock);
+
+    if ((lsock == NULL) || (lsock->conn == NULL)) {
+        return NULL;
+    }
+    if ((NETCONNTYPE_GROUP(netconn_type(lsock->conn)) != NETCONN_TCP) || (lsock->conn->pcb.tcp == NULL)) {
+        return NULL;
+    }
+    return lsock->conn->pcb.tcp;
+}
+
+static net_rcv_cap_t *net_sock_rcv_cap(int sock, const struct tcp_pcb *pcb) {
+    int index = sock - LWIP_SOCKET_OFFSET;
+
+    if ((index < 0) || (index >= MEMP_NUM_NETCONN)) {
+        return NULL;
+    }
+    // the descriptor may have been reused by a new connection since the window was set
+    if (net_rcv_cap[index].pcb != pcb) {
+        net_rcv_cap[index].pcb = pcb;
+        net_rcv_cap[index].cap = TCP_WND_MAX(pcb);
+    }
+    return &net_rcv_cap[index];
+}
+
+static err_t net_sock_info_fn(struct tcpip_api_call_data *call) {
+    net_stats_call_t *msg = (net_stats_call_t *)call;
+    net_sock_info_t *info = (net_sock_info_t *)msg->out;
+    struct tcp_pcb *pcb = net_sock_tcp_pcb(msg->sock);
+    net_rcv_cap_t *cap;
+
+    memset(info, 0, sizeof(net_sock_info_t));
+    if ((pcb == NULL) || (pcb->state == LISTEN)) {
+        msg->ret = -1;
+        return ERR_OK;
+    }
+    cap = net_sock_rcv_cap(msg->sock, pcb);
+    info->state = pcb->state;
+    info->mss = pcb->mss;
+    info->snd_free = tcp_sndbuf(pcb);
+    info->snd_queued = net_tcp_queue_bytes(pcb->unsent) + net_tcp_queue_bytes(pcb->unacked);
+    info->snd_queuelen = pcb->snd_queuelen;
+    info->cwnd = pcb->cwnd;
+    info->rcv_wnd = pcb->rcv_wnd;
+    info->rcv_wnd_max = cap ? cap->cap : TCP_WND_MAX(pcb);
+    info->ooseq = net_tcp_ooseq_count(pcb);
+    info->nrtx = pcb->nrtx;
+    msg->ret = 0;
+    return ERR_OK;
+}
+
+static err_t net_sock_sndqueue_fn(struct tcpip_api_call_data *call) {
+    net_stats_call_t *msg = (net_stats_call_t *)call;
+    struct tcp_pcb *pcb = net_sock_tcp_pcb(msg->sock);
+
+    if (pcb == NULL) {
+        msg->ret = -1;
+        return ERR_OK;
+    }
+    msg->ret = TCP_SND_BUF - tcp_sndbuf(pcb);
+    return ERR_OK;
+}
+
+// lwIP has no SO_RCVBUF for TCP in this build, so the window itself is resized. Growing goes
+// through tcp_recved() so the peer is told, shrinking only takes the unused part of the window.
+static err_t net_sock_rcvwnd_fn(struct tcpip_api_call_data *call) {
+    net_stats_call_t *msg = (net_stats_call_t *)call;
+    struct tcp_pcb *pcb = net_sock_tcp_pcb(msg->sock);
+    net_rcv_cap_t *cap;
+    uint32_t size = msg->value;
+
+    if ((pcb == NULL) || (pcb->state == LISTEN) || ((cap = net_sock_rcv_cap(msg->sock, pcb)) == NULL)) {
+        msg->ret = -1;
+        return ERR_OK;
+    }
+    if (size > TCP_WND_MAX(pcb)) {
+        size = TCP_WND_MAX(pcb);
+    }
+    if (size < pcb->mss) {
+        size = pcb->mss;
+    }
+    if (size > cap->cap) {
+        tcp_recved(pcb, (u16_t)(size - cap->cap));
+        cap->cap = size;
+    } else if (size < cap->cap) {
+        uint32_t shrink = cap->cap - size;
+        if (shrink > pcb->rcv_wnd) {
+            shrink = pcb->rcv_wnd;
+        }
+        pcb->rcv_wnd -= shrink;
+        cap->cap -= shrink;
+    }
+    msg->ret = cap->cap;
+    return ERR_OK;
+}
+
+static int net_stats_call(tcpip_api_call_fn fn, int sock, uint32_t value, void *out) {
+    net_stats_call_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.sock = sock;
+    msg.value = value;
+    msg.out = out;
+    msg.ret = -1;
+    if (tcpip_api_call(fn, &msg.call) != ERR_OK) {
+        return -1;
+    }
+    return msg.ret;
+}
+
+//-----------------------------------------------------------------------------
+// Arduino driver interface
+
+int NetStatsSample(net_stats_t *stats) {
+    if (stats == NULL) {
+        return -1;
+    }
+    return net_stats_call(net_stats_sample_fn, -1, 0, stats);
+}
+
+void NetStatsReset(void) {
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    memset(net_pool_peak, 0, sizeof(net_pool_peak));
+    memset(net_pool_exhausted, 0, sizeof(net_pool_exhausted));
+    net_rtx_total = 0;
+    net_ooseq_peak = 0;
+    net_samples = 0;
+    SYS_ARCH_UNPROTECT(lev);
+}
+
+int NetSockGetInfo(int sock, net_sock_info_t *info) {
+    if ((sock < 0) || (info == NULL)) {
+        return -1;
+    }
+    return net_stats_call(net_sock_info_fn, sock, 0, info);
+}
+
+int NetSockGetSendQueued(int sock) {
+    if (sock < 0) {
+        return -1;
+    }
+    return net_stats_call(net_sock_sndqueue_fn, sock, 0, NULL);
+}
+
+int NetSockSetRecvWindow(int sock, uint32_t size) {
+    if (sock < 0) {
+        return -1;
+    }
+    return net_stats_call(net_sock_rcvwnd_fn, sock, size, NULL);
+}
@@ -0,0 +1,61 @@
+#ifndef NET_STATS_DRV_H
+#define NET_STATS_DRV_H
+
+#include <stdint.h>
+
+#define NET_STATS_MAX_POOLS         32
+
+typedef struct net_pool_stats_s {
+    const char *name;
+    uint16_t size;          // element size in bytes
+    uint16_t num;           // number of elements
+    uint16_t used;          // elements in use when sampled
+    uint16_t peak;          // highest use seen by any sample
+    uint32_t exhausted;     // samples that found no free element
+} net_pool_stats_t;
+
+typedef struct net_tcp_stats_s {
+    uint16_t pcbs;          // active connections
+    uint16_t rtx_pcbs;      // connections currently retransmitting
+    uint32_t unsent;        // bytes queued and not yet sent, all connections
+    uint32_t unacked;       // bytes sent and not yet acknowledged, all connections
+    uint16_t ooseq;         // out-of-order segments held, all connections
+    uint16_t ooseq_peak;
+    uint32_t rtx;           // retransmission timeouts seen by the samples
+} net_tcp_stats_t;
+
+typedef struct net_stats_s {
+    uint32_t samples;
+    uint8_t pool_count;
+    net_pool_stats_t pools[NET_STATS_MAX_POOLS];
+    net_tcp_stats_t tcp;
+} net_stats_t;
+
+typedef struct net_sock_info_s {
+    uint8_t state;          // enum tcp_state, 0 (CLOSED) for non-TCP sockets
+    uint16_t mss;
+    uint32_t snd_queued;    // bytes unsent + unacked
+    uint32_t snd_free;      // free space in the send buffer
+    uint16_t snd_queuelen;  // pbufs queued for sending
+    uint32_t cwnd;
+    uint32_t rcv_wnd;       // receive window still open
+    uint32_t rcv_wnd_max;   // receive window when no data is waiting to be read
+    uint16_t ooseq;         // out-of-order segments held
+    uint8_t nrtx;           // retransmissions of the current segment
+} net_sock_info_t;
+
+// Sample every lwIP memory pool and TCP connection, peaks and counters accumulate across calls
+int NetStatsSample(net_stats_t *stats);
+
+void NetStatsReset(void);
+
+int NetSockGetInfo(int sock, net_sock_info_t *info);
+
+// Bytes queued on a TCP socket that the peer has not acknowledged yet
+int NetSockGetSendQueued(int sock);
+
+// Resize the TCP receive window of a socket, up to TCP_WND
+// Returns the window size applied, or -1 if the socket is not a TCP connection
+int NetSockSetRecvWindow(int sock, uint32_t size);
+
+#endif
@@ -0,0 +1,329 @@
+#include "object_tracker.h"
+
+#include <math.h>
+#include <string.h>
+
+#define TRACKER_DEFAULT_DT      0.033f      // frame interval when no timestamps are given
+#define TRACKER_MAX_DT          1.0f
+#define TRACKER_SIZE_ALPHA      0.5f        // weight of a new detection in the box size
+#define TRACKER_INITIAL_VEL_VAR 1.0f
+#define TRACKER_RECOG_TIMEOUT   5           // frames to wait for a result before asking again
+
+void ObjectTrackerDefaults(object_tracker_params_t *params) {
+    memset(params, 0, sizeof(object_tracker_params_t));
+    params->iou_threshold = 0.3f;
+    params->distance_gate = 0.5f;
+    params->birth_score = 0.5f;
+    params->min_hits = 3;
+    params->max_misses = 10;
+    params->match_class = 1;
+    params->process_noise = 1.0f;
+    params->measurement_noise = 0.1f;
+    params->recog_confidence = 0.6f;
+    params->recog_retries = 3;
+    params->recog_interval = 90;
+}
+
+void ObjectTrackerInit(object_tracker_t *tracker, const object_tracker_params_t *params) {
+    memset(tracker, 0, sizeof(object_tracker_t));
+    if (params) {
+        memcpy(&tracker->params, params, sizeof(object_tracker_params_t));
+    } else {
+        ObjectTrackerDefaults(&tracker->params);
+    }
+    if (tracker->params.min_hits == 0) {
+        tracker->params.min_hits = 1;
+    }
+    tracker->next_id = 1;
+}
+
+static void axis_init(object_tracker_axis_t *a, float pos, float r) {
+    a->pos = pos;
+    a->vel = 0.0f;
+    a->p00 = r;
+    a->p01 = 0.0f;
+    a->p11 = TRACKER_INITIAL_VEL_VAR;
+}
+
+// x = F x, P = F P F' + Q for white acceleration noise of variance q
+static void axis_predict(object_tracker_axis_t *a, float dt, float q) {
+    float dt2 = dt * dt;
+
+    a->pos += a->vel * dt;
+    a->p00 += dt * (2.0f * a->p01 + dt * a->p11) + q * dt2 * dt2 * 0.25f;
+    a->p01 += dt * a->p11 + q * dt2 * dt * 0.5f;
+    a->p11 += q * dt2;
+}
+
+// Position only measurement, H = [1 0]
+static void axis_update(object_tracker_axis_t *a, float z, float r) {
+    float s = a->p00 + r;
+    float k0 = a->p00 / s;
+    float k1 = a->p01 / s;
+    float y = z - a->pos;
+    float p00 = a->p00;
+    float p01 = a->p01;
+
+    a->pos += k0 * y;
+    a->vel += k1 * y;
+    a->p00 = (1.0f - k0) * p00;
+    a->p01 = (1.0f - k0) * p01;
+    a->p11 -= k1 * p01;
+}
+
+static float box_iou(const object_tracker_box_t *a, const object_tracker_box_t *b) {
+    float w = fminf(a->xmax, b->xmax) - fmaxf(a->xmin, b->xmin);
+    float h = fminf(a->ymax, b->ymax) - fmaxf(a->ymin, b->ymin);
+    float inter, area;
+
+    if ((w <= 0.0f) || (h <= 0.0f)) {
+        return 0.0f;
+    }
+    inter = w * h;
+    area = (a->xmax - a->xmin) * (a->ymax - a->ymin) + (b->xmax - b->xmin) * (b->ymax - b->ymin) - inter;
+    return (area > 0.0f) ? (inter / area) : 0.0f;
+}
+
+void ObjectTrackerBox(const object_tracker_t *tracker, int index, object_tracker_box_t *box) {
+    const object_track_t *t = &tracker->tracks[index];
+
+    box->xmin = t->x.pos - t->w * 0.5f;
+    box->xmax = t->x.pos + t->w * 0.5f;
+    box->ymin = t->y.pos - t->h * 0.5f;
+    box->ymax = t->y.pos + t->h * 0.5f;
+    box->score = t->score;
+    box->classes = t->classes;
+}
+
+static void track_measure(object_tracker_t *tracker, object_track_t *t, const object_tracker_box_t *det) {
+    float w = det->xmax - det->xmin;
+    float h = det->ymax - det->ymin;
+    float rx = tracker->params.measurement_noise * w;
+    float ry = tracker->params.measurement_noise * h;
+
+    axis_update(&t->x, (det->xmin + det->xmax) * 0.5f, rx * rx);
+    axis_update(&t->y, (det->ymin + det->ymax) * 0.5f, ry * ry);
+    t->w += TRACKER_SIZE_ALPHA * (w - t->w);
+    t->h += TRACKER_SIZE_ALPHA * (h - t->h);
+    t->score = det->score;
+}
+
+static int track_birth(object_tracker_t *tracker, const object_tracker_box_t *det, uint32_t now) {
+    float w = det->xmax - det->xmin;
+    float h = det->ymax - det->ymin;
+    float rx = tracker->params.measurement_noise * w;
+    float ry = tracker->params.measurement_noise * h;
+    int i;
+
+    for (i = 0; i < OBJECT_TRACKER_MAX_TRACKS; i++) {
+        object_track_t *t = &tracker->tracks[i];
+        if (t->state != OBJECT_TRACK_FREE) {
+            continue;
+        }
+        memset(t, 0, sizeof(object_track_t));
+        t->id = tracker->next_id++;
+        if (tracker->next_id == 0) {
+            tracker->next_id = 1;
+        }
+        t->state = OBJECT_TRACK_TENTATIVE;
+        t->classes = det->classes;
+        t->score = det->score;
+        axis_init(&t->x, (det->xmin + det->xmax) * 0.5f, rx * rx);
+        axis_init(&t->y, (det->ymin + det->ymax) * 0.5f, ry * ry);
+        t->w = w;
+        t->h = h;
+        t->hits = 1;
+        t->first_ms = now;
+        t->last_ms = now;
+        tracker->stats.born++;
+        if (tracker->params.min_hits <= 1) {
+            t->state = OBJECT_TRACK_CONFIRMED;
+            tracker->stats.confirmed++;
+        }
+        return i;
+    }
+    return -1;
+}
+
+int ObjectTrackerUpdate(object_tracker_t *tracker, const object_tracker_box_t *dets, int count, uint32_t timestamp_ms, int8_t *det_track) {
+    object_tracker_params_t *params = &tracker->params;
+    int8_t assign[OBJECT_TRACKER_MAX_DETECTIONS];
+    float dt = TRACKER_DEFAULT_DT;
+    int matched = 0;
+    int i, j;
+
+    if (count > OBJECT_TRACKER_MAX_DETECTIONS) {
+        count = OBJECT_TRACKER_MAX_DETECTIONS;
+    }
+    if ((timestamp_ms != 0) && (tracker->stats.frames != 0)) {
+        dt = (float)(timestamp_ms - tracker->last_ms) / 1000.0f;
+        if (dt <= 0.0f) {
+            dt = TRACKER_DEFAULT_DT;
+        } else if (dt > TRACKER_MAX_DT) {
+            dt = TRACKER_MAX_DT;
+        }
+    }
+    tracker->last_ms = timestamp_ms;
+    tracker->stats.frames++;
+    tracker->stats.detections += count;
+
+    for (i = 0; i < OBJECT_TRACKER_MAX_TRACKS; i++) {
+        object_track_t *t = &tracker->tracks[i];
+        t->det = -1;
+        if (t->state == OBJECT_TRACK_FREE) {
+            continue;
+        }
+        axis_predict(&t->x, dt, params->process_noise);
+        axis_predict(&t->y, dt, params->process_noise);
+    }
+    for (j = 0; j < count; j++) {
+        assign[j] = -1;
+    }
+
+    // greedy association, best overlap first, then nearest centre for boxes that moved too far to overlap
+    for (int pass = 0; pass < 2; pass++) {
+        while (1) {
+            float best = (pass == 0) ? params->iou_threshold : params->distance_gate;
+            int best_t = -1;
+            int best_d = -1;
+            for (i = 0; i < OBJECT_TRACKER_MAX_TRACKS; i++) {
+                object_track_t *t = &tracker->tracks[i];
+                if ((t->state == OBJECT_TRACK_FREE) || (t->det >= 0)) {
+                    continue;
+                }
+                object_tracker_box_t pred;
+                float diag = sqrtf(t->w * t->w + t->h * t->h);
+                ObjectTrackerBox(tracker, i, &pred);
+                for (j = 0; j < count; j++) {
+                    if ((assign[j] >= 0) || (params->match_class && (dets[j].classes != t->classes))) {
+                        continue;
+                    }
+                    if (pass == 0) {
+                        float iou = box_iou(&pred, &dets[j]);
+                        if (iou >= best) {
+                            best = iou;
+                            best_t = i;
+                            best_d = j;
+                        }
+                    } else if (diag > 0.0f) {
+                        float dx = (dets[j].xmin + dets[j].xmax) * 0.5f - t->x.pos;
+                        float dy = (dets[j].ymin + dets[j].ymax) * 0.5f - t->y.pos;
+                        float dist = sqrtf(dx * dx + dy * dy) / diag;
+                        if (dist <= best) {
+                            best = dist;
+                            best_t = i;
+                            best_d = j;
+                        }
+                    }
+                }
+            }
+            if (best_t < 0) {
+                break;
+            }
+            tracker->tracks[best_t].det = best_d;
+            assign[best_d] = best_t;
+        }
+    }
+
+    for (i = 0; i < OBJECT_TRACKER_MAX_TRACKS; i++) {
+        object_track_t *t = &tracker->tracks[i];
+        if (t->state == OBJECT_TRACK_FREE) {
+            continue;
+        }
+        if (t->det >= 0) {
+            track_measure(tracker, t, &dets[t->det]);
+            t->misses = 0;
+            t->hits++;
+            t->last_ms = timestamp_ms;
+            tracker->stats.matched++;
+            if ((t->state == OBJECT_TRACK_TENTATIVE) && (t->hits >= params->min_hits)) {
+                t->state = OBJECT_TRACK_CONFIRMED;
+                tracker->stats.confirmed++;
+            }
+            if (t->state == OBJECT_TRACK_CONFIRMED) {
+                matched++;
+            }
+            continue;
+        }
+        t->hits = 0;
+        t->misses++;
+        // a tentative track that misses once was probably a false detection
+        if ((t->state == OBJECT_TRACK_TENTATIVE) || (t->misses > params->max_misses)) {
+            t->state = OBJECT_TRACK_FREE;
+            tracker->stats.dropped++;
+        }
+    }
+
+    for (j = 0; j < count; j++) {
+        if ((assign[j] < 0) && (dets[j].score >= params->birth_score)) {
+            assign[j] = track_birth(tracker, &dets[j], timestamp_ms);
+            if (assign[j] >= 0) {
+                tracker->tracks[assign[j]].det = j;
+                if (tracker->tracks[assign[j]].state == OBJECT_TRACK_CONFIRMED) {
+                    matched++;
+                }
+            }
+        }
+        if (det_track) {
+            det_track[j] = assign[j];
+        }
+    }
+    return matched;
+}
+
+int ObjectTrackerNeedsRecognition(object_tracker_t *tracker, int index) {
+    object_tracker_params_t *params = &tracker->params;
+    object_track_t *t;
+    uint32_t frames;
+
+    if ((index < 0) || (index >= OBJECT_TRACKER_MAX_TRACKS)) {
+        return 0;
+    }
+    t = &tracker->tracks[index];
+    if ((t->state == OBJECT_TRACK_FREE) || (t->det < 0)) {
+        return 0;
+    }
+    frames = tracker->stats.frames - t->recog_frame;
+    if (!t->recognized) {
+        // still waiting for the result of the last request
+        if ((t->recog_frame != 0) && (frames < TRACKER_RECOG_TIMEOUT)) {
+            return 0;
+        }
+    } else if ((t->confidence < params->recog_confidence) && (t->attempts < params->recog_retries)) {
+        // uncertain, try again on the next frames, the face may turn towards the camera
+    } else if ((params->recog_interval == 0) || (frames < params->recog_interval)) {
+        return 0;
+    }
+    t->recog_frame = tracker->stats.frames;
+    tracker->stats.recog_requests++;
+    return 1;
+}
+
+void ObjectTrackerSetIdentity(object_tracker_t *tracker, int index, const char *name, float confidence) {
+    object_track_t *t;
+
+    if ((index < 0) || (index >= OBJECT_TRACKER_MAX_TRACKS)) {
+        return;
+    }
+    t = &tracker->tracks[index];
+    if (t->state == OBJECT_TRACK_FREE) {
+        return;
+    }
+    // a confident result replaces anything, an uncertain one only another uncertain one
+    if ((confidence >= tracker->params.recog_confidence) || !t->recognized || (t->confidence < tracker->params.recog_confidence)) {
+        strncpy(t->name, (name != NULL) ? name : "", (OBJECT_TRACKER_NAME_LEN - 1));
+        t->name[OBJECT_TRACKER_NAME_LEN - 1] = '\0';
+        t->confidence = confidence;
+    }
+    t->attempts = (confidence >= tracker->params.recog_confidence) ? 0 : (t->attempts + 1);
+    t->recognized = 1;
+}
+
+int ObjectTrackerFind(const object_tracker_t *tracker, uint32_t id) {
+    for (int i = 0; i < OBJECT_TRACKER_MAX_TRACKS; i++) {
+        if ((tracker->tracks[i].state != OBJECT_TRACK_FREE) && (tracker->tracks[i].id == id)) {
+            return i;
+        }
+    }
+    return -1;
+}
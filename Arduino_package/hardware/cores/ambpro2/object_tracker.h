@@ -0,0 +1,111 @@
+#ifndef OBJECT_TRACKER_H
+#define OBJECT_TRACKER_H
+
+#include <stdint.h>
+
+// Multi-object tracker for per frame detection boxes. Each track runs a constant velocity
+// Kalman filter on the box centre, detections are associated greedily by IoU against the
+// predicted boxes with a centroid distance fallback. Plain C without OS calls, so the same
+// file also builds on a host for replaying recorded detections.
+
+#define OBJECT_TRACKER_MAX_TRACKS       32
+#define OBJECT_TRACKER_MAX_DETECTIONS   128     // detections per frame, further ones are ignored
+#define OBJECT_TRACKER_NAME_LEN         32
+
+typedef enum {
+    OBJECT_TRACK_FREE = 0,
+    OBJECT_TRACK_TENTATIVE = 1,     // seen, not yet min_hits times in a row
+    OBJECT_TRACK_CONFIRMED = 2
+} object_track_state_t;
+
+// Box in normalised frame coordinates, 0.0 to 1.0
+typedef struct object_tracker_box_s {
+    float xmin, ymin, xmax, ymax;
+    float score;
+    int16_t classes;
+} object_tracker_box_t;
+
+// Position and velocity along one axis with its 2x2 covariance
+typedef struct object_tracker_axis_s {
+    float pos;
+    float vel;                      // per second
+    float p00, p01, p11;            // p10 == p01
+} object_tracker_axis_t;
+
+typedef struct object_track_s {
+    uint32_t id;                    // stable for the life of the track, never 0
+    uint8_t state;                  // object_track_state_t
+    int16_t classes;
+    float score;                    // score of the last matched detection
+    object_tracker_axis_t x, y;
+    float w, h;
+    uint16_t hits;                  // consecutive frames matched
+    uint16_t misses;                // consecutive frames not matched
+    int16_t det;                    // detection matched this frame, -1 if none
+    uint32_t first_ms;
+    uint32_t last_ms;               // last matched
+
+    // recognition cache
+    char name[OBJECT_TRACKER_NAME_LEN];
+    float confidence;
+    uint8_t recognized;             // an identity result has been stored
+    uint8_t attempts;               // results below recog_confidence in a row
+    uint32_t recog_frame;           // frame of the last recognition request
+} object_track_t;
+
+typedef struct object_tracker_params_s {
+    float iou_threshold;            // minimum IoU to match a detection to a track
+    float distance_gate;            // fallback centre distance, in track box diagonals
+    float birth_score;              // minimum detection score to start a track
+    uint8_t min_hits;               // matches in a row to confirm a track
+    uint8_t max_misses;             // frames a confirmed track coasts before it is dropped
+    uint8_t match_class;            // only match detections of the track class
+    float process_noise;            // acceleration spread, normalised units per second squared
+    float measurement_noise;        // detection centre spread, fraction of the box size
+    float recog_confidence;         // identities below this are recognised again
+    uint8_t recog_retries;          // recognitions in a row for an uncertain track before backing off
+    uint32_t recog_interval;        // frames between refreshes of a settled identity, 0 never
+} object_tracker_params_t;
+
+typedef struct object_tracker_stats_s {
+    uint32_t frames;
+    uint32_t detections;
+    uint32_t matched;
+    uint32_t born;                  // tracks started
+    uint32_t confirmed;             // tracks that reached min_hits, the number of objects counted
+    uint32_t dropped;
+    uint32_t recog_requests;        // tracks ObjectTrackerNeedsRecognition() asked for
+} object_tracker_stats_t;
+
+typedef struct object_tracker_s {
+    object_tracker_params_t params;
+    object_tracker_stats_t stats;
+    object_track_t tracks[OBJECT_TRACKER_MAX_TRACKS];
+    uint32_t next_id;
+    uint32_t last_ms;
+} object_tracker_t;
+
+void ObjectTrackerDefaults(object_tracker_params_t *params);
+
+// Clear all tracks, params may be NULL for the defaults
+void ObjectTrackerInit(object_tracker_t *tracker, const object_tracker_params_t *params);
+
+// Advance every track to timestamp_ms and associate count detections with them. If
+// det_track is not NULL it receives, per detection, the index of its track or -1.
+// Returns the number of confirmed tracks matched this frame.
+int ObjectTrackerUpdate(object_tracker_t *tracker, const object_tracker_box_t *dets, int count, uint32_t timestamp_ms, int8_t *det_track);
+
+// Estimated box of a track after the last update
+void ObjectTrackerBox(const object_tracker_t *tracker, int index, object_tracker_box_t *box);
+
+// Whether the identity of a track matched this frame should be (re)computed. Counts a
+// request and starts the retry timer when it returns 1.
+int ObjectTrackerNeedsRecognition(object_tracker_t *tracker, int index);
+
+// Store a recognition result for a track
+void ObjectTrackerSetIdentity(object_tracker_t *tracker, int index, const char *name, float confidence);
+
+// Index of the track with this id, -1 if it is gone
+int ObjectTrackerFind(const object_tracker_t *tracker, uint32_t id);
+
+#endif
@@ -0,0 +1,514 @@
+#include "os_profiler_drv.h"
+
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <platform_stdlib.h>
+
+// The SDK libraries are prebuilt, so heap use is attributed from the outside: the linker wraps
+// pvPortMalloc, vPortFree and pvPortReAlloc and every allocation is charged to the module of the
+// task that made it. The wrapping is only linked in when Tools > Heap Profiler is enabled, which
+// also defines OS_PROFILER_HEAP (see build.heap_profiler_flags in boards.txt and platform.txt). The module comes from a
+// tag set by OsProfilerTagSet(), or else from the task name. Live allocations are kept in an open
+// addressing table so that a free can be charged back to the module that allocated the block.
+
+#define OS_PROFILER_MAX_TAGS        8
+#define OS_PROFILER_SIZE_MASK       0x00FFFFFF
+
+#if defined(OS_PROFILER_HEAP)
+extern void *__real_pvPortMalloc(size_t xWantedSize);
+extern void __real_vPortFree(void *pv);
+extern void *__real_pvPortReAlloc(void *pv, size_t xWantedSize);
+#else
+// the profiler's own buffers, reached directly when the allocator is not wrapped
+#define __real_pvPortMalloc(size)   pvPortMalloc(size)
+#define __real_vPortFree(pv)        vPortFree(pv)
+#endif
+
+typedef struct os_heap_entry_s {
+    void *ptr;
+    uint32_t info;          // module in the top 8 bits, requested size below
+} os_heap_entry_t;
+
+typedef struct os_module_s {
+    char name[OS_PROFILER_NAME_LEN];
+    uint32_t bytes;
+    uint32_t peak;
+    uint32_t allocs;
+    uint32_t failed;
+} os_module_t;
+
+typedef struct os_prefix_s {
+    char prefix[OS_PROFILER_NAME_LEN];
+    uint8_t module;
+} os_prefix_t;
+
+typedef struct os_tag_s {
+    TaskHandle_t task;
+    uint8_t module;
+} os_tag_t;
+
+typedef struct os_run_time_s {
+    uint32_t number;
+    uint32_t counter;
+} os_run_time_t;
+
+// same order as the OS_PROFILER_MODULE_ ids
+static os_module_t os_modules[OS_PROFILER_MAX_MODULES] = {
+    {"other"}, {"sketch"}, {"video"}, {"nn"}, {"rtsp"}, {"osd"}, {"lwip"}, {"wifi"}, {"audio"}
+};
+static uint8_t os_module_count = OS_PROFILER_MODULE_AUDIO + 1;
+
+static os_prefix_t os_prefixes[OS_PROFILER_MAX_PREFIXES] = {
+    {"main task", OS_PROFILER_MODULE_SKETCH},
+    {"ARDUINO", OS_PROFILER_MODULE_SKETCH},
+    {"video", OS_PROFILER_MODULE_VIDEO},
+    {"isp", OS_PROFILER_MODULE_VIDEO},
+    {"enc", OS_PROFILER_MODULE_VIDEO},
+    {"vipnn", OS_PROFILER_MODULE_NN},
+    {"nn", OS_PROFILER_MODULE_NN},
+    {"rtsp", OS_PROFILER_MODULE_RTSP},
+    {"rtp", OS_PROFILER_MODULE_RTSP},
+    {"osd", OS_PROFILER_MODULE_OSD},
+    {"TCP_IP", OS_PROFILER_MODULE_LWIP},
+    {"tcpip", OS_PROFILER_MODULE_LWIP},
+    {"dns_cache", OS_PROFILER_MODULE_LWIP},
+    {"wlan", OS_PROFILER_MODULE_WIFI},
+    {"wifi", OS_PROFILER_MODULE_WIFI},
+    {"rtw", OS_PROFILER_MODULE_WIFI},
+    {"audio", OS_PROFILER_MODULE_AUDIO},
+};
+static uint8_t os_prefix_count = 17;
+
+static os_tag_t os_tags[OS_PROFILER_MAX_TAGS];
+
+static os_heap_entry_t *os_heap_table = NULL;
+static uint32_t os_heap_mask = 0;
+static uint32_t os_heap_used = 0;
+static uint32_t os_heap_untracked = 0;
+
+static os_run_time_t os_run_time[OS_PROFILER_MAX_TASKS];
+static uint8_t os_run_time_count = 0;
+static uint32_t os_run_time_total = 0;
+static uint32_t os_sample_time = 0;
+
+//-----------------------------------------------------------------------------
+// module lookup, called with the scheduler suspended
+
+static uint8_t os_task_module(TaskHandle_t task, const char *name) {
+    for (int i = 0; i < OS_PROFILER_MAX_TAGS; i++) {
+        if ((os_tags[i].task != NULL) && (os_tags[i].task == task)) {
+            return os_tags[i].module;
+        }
+    }
+    if (name == NULL) {
+        return OS_PROFILER_MODULE_OTHER;
+    }
+    for (int i = 0; i < os_prefix_count; i++) {
+        if (strncmp(name, os_prefixes[i].prefix, strlen(os_prefixes[i].prefix)) == 0) {
+            return os_prefixes[i].module;
+        }
+    }
+    return OS_PROFILER_MODULE_OTHER;
+}
+
+#if defined(OS_PROFILER_HEAP)
+static uint8_t os_current_module(void) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    // no task runs before the scheduler starts
+    if (task == NULL) {
+        return OS_PROFILER_MODULE_OTHER;
+    }
+    return os_task_module(task, pcTaskGetName(task));
+}
+
+//-----------------------------------------------------------------------------
+// live allocation table, called with the scheduler suspended
+
+static uint32_t os_heap_hash(const void *ptr) {
+    return ((((uint32_t)ptr) >> 3) * 2654435761UL) & os_heap_mask;
+}
+
+static void os_heap_insert(void *ptr, uint32_t size, uint8_t module) {
+    uint32_t i;
+    os_module_t *mod = &os_modules[module];
+
+    // keep a quarter of the table free so that probes stay short
+    if ((os_heap_used + 1) > (((os_heap_mask + 1) / 4) * 3)) {
+        os_heap_untracked += size;
+        return;
+    }
+    if (size > OS_PROFILER_SIZE_MASK) {
+        size = OS_PROFILER_SIZE_MASK;
+    }
+    for (i = os_heap_hash(ptr); os_heap_table[i].ptr != NULL; i = (i + 1) & os_heap_mask) {
+        if (os_heap_table[i].ptr == ptr) {
+            // freed behind the wrapper's back, e.g. inside the heap code itself
+            os_modules[os_heap_table[i].info >> 24].bytes -= (os_heap_table[i].info & OS_PROFILER_SIZE_MASK);
+            os_heap_used--;
+            break;
+        }
+    }
+    os_heap_table[i].ptr = ptr;
+    os_heap_table[i].info = (((uint32_t)module) << 24) | size;
+    os_heap_used++;
+    mod->bytes += size;
+    if (mod->bytes > mod->peak) {
+        mod->peak = mod->bytes;
+    }
+}
+
+// Returns 1 and the entry if ptr was tracked, the entry is removed
+static int os_heap_erase(void *ptr, uint32_t *info) {
+    uint32_t i;
+    uint32_t j;
+    uint32_t k;
+
+    for (i = os_heap_hash(ptr); os_heap_table[i].ptr != ptr; i = (i + 1) & os_heap_mask) {
+        if (os_heap_table[i].ptr == NULL) {
+            // allocated before tracking started, or while the table was full
+            return 0;
+        }
+    }
+    *info = os_heap_table[i].info;
+    os_modules[*info >> 24].bytes -= (*info & OS_PROFILER_SIZE_MASK);
+    os_heap_used--;
+
+    // backward shift deletion, moves up entries whose probe sequence passed through slot i
+    for (j = (i + 1) & os_heap_mask; os_heap_table[j].ptr != NULL; j = (j + 1) & os_heap_mask) {
+        k = os_heap_hash(os_heap_table[j].ptr);
+        if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j))) {
+            continue;
+        }
+        os_heap_table[i] = os_heap_table[j];
+        i = j;
+    }
+    os_heap_table[i].ptr = NULL;
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+// allocator wrappers
+
+void *__wrap_pvPortMalloc(size_t xWantedSize) {
+    void *ptr;
+    uint8_t module;
+
+    if (os_heap_table == NULL) {
+        return __real_pvPortMalloc(xWantedSize);
+    }
+    vTaskSuspendAll();
+    ptr = __real_pvPortMalloc(xWantedSize);
+    if (os_heap_table != NULL) {
+        module = os_current_module();
+        if (ptr != NULL) {
+            os_modules[module].allocs++;
+            os_heap_insert(ptr, xWantedSize, module);
+        } else {
+            os_modules[module].failed++;
+        }
+    }
+    (void)xTaskResumeAll();
+    return ptr;
+}
+
+void __wrap_vPortFree(void *pv) {
+    uint32_t info;
+
+    if ((os_heap_table == NULL) || (pv == NULL)) {
+        __real_vPortFree(pv);
+        return;
+    }
+    // the entry goes first, another task must not be given the block while it is still listed
+    vTaskSuspendAll();
+    if (os_heap_table != NULL) {
+        os_heap_erase(pv, &info);
+    }
+    __real_vPortFree(pv);
+    (void)xTaskResumeAll();
+}
+
+void *__wrap_pvPortReAlloc(void *pv, size_t xWantedSize) {
+    void *ptr;
+    uint32_t info = 0;
+    int tracked = 0;
+    uint8_t module;
+
+    if (os_heap_table == NULL) {
+        return __real_pvPortReAlloc(pv, xWantedSize);
+    }
+    vTaskSuspendAll();
+    if ((os_heap_table != NULL) && (pv != NULL)) {
+        tracked = os_heap_erase(pv, &info);
+    }
+    ptr = __real_pvPortReAlloc(pv, xWantedSize);
+    if (os_heap_table != NULL) {
+        // a resized block stays with the module that allocated it
+        module = tracked ? (uint8_t)(info >> 24) : os_current_module();
+        if (ptr != NULL) {
+            if (!tracked) {
+                os_modules[module].allocs++;
+            }
+            os_heap_insert(ptr, xWantedSize, module);
+        } else if (xWantedSize > 0) {
+            // the old block is still allocated
+            os_modules[module].failed++;
+            if (tracked) {
+                os_heap_insert(pv, (info & OS_PROFILER_SIZE_MASK), module);
+            }
+        }
+    }
+    (void)xTaskResumeAll();
+    return ptr;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Arduino driver interface
+
+int OsProfilerHeapEnable(uint32_t entries) {
+#if defined(OS_PROFILER_HEAP)
+    os_heap_entry_t *table;
+    uint32_t size = 64;
+
+    if (os_heap_table != NULL) {
+        return 0;
+    }
+    if (entries == 0) {
+        entries = OS_PROFILER_HEAP_ENTRIES;
+    }
+    while (size < entries) {
+        size <<= 1;
+    }
+    table = (os_heap_entry_t *)__real_pvPortMalloc(size * sizeof(os_heap_entry_t));
+    if (table == NULL) {
+        printf("\r\n[ERROR] %s allocation table of %lu entries failed\n", __FUNCTION__, size);
+        return -1;
+    }
+    memset(table, 0, (size * sizeof(os_heap_entry_t)));
+
+    vTaskSuspendAll();
+    for (int i = 0; i < os_module_count; i++) {
+        os_modules[i].bytes = 0;
+        os_modules[i].peak = 0;
+        os_modules[i].allocs = 0;
+        os_modules[i].failed = 0;
+    }
+    os_heap_used = 0;
+    os_heap_untracked = 0;
+    os_heap_mask = size - 1;
+    os_heap_table = table;
+    (void)xTaskResumeAll();
+    return 0;
+#else
+    (void)entries;
+    printf("\r\n[ERROR] %s heap tracking needs Tools > Heap Profiler set to Enable\n", __FUNCTION__);
+    return -1;
+#endif
+}
+
+void OsProfilerHeapDisable(void) {
+#if defined(OS_PROFILER_HEAP)
+    os_heap_entry_t *table;
+
+    vTaskSuspendAll();
+    table = os_heap_table;
+    os_heap_table = NULL;
+    (void)xTaskResumeAll();
+    if (table != NULL) {
+        __real_vPortFree(table);
+    }
+#endif
+}
+
+int OsProfilerModuleAdd(const char *name) {
+    int module = OsProfilerModuleFind(name);
+
+    if (module >= 0) {
+        return module;
+    }
+    if ((name == NULL) || (os_module_count >= OS_PROFILER_MAX_MODULES)) {
+        return -1;
+    }
+    vTaskSuspendAll();
+    module = os_module_count;
+    memset(&os_modules[module], 0, sizeof(os_module_t));
+    strncpy(os_modules[module].name, name, (OS_PROFILER_NAME_LEN - 1));
+    os_module_count++;
+    (void)xTaskResumeAll();
+    return module;
+}
+
+int OsProfilerModuleFind(const char *name) {
+    if (name == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < os_module_count; i++) {
+        if (strncmp(os_modules[i].name, name, (OS_PROFILER_NAME_LEN - 1)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char *OsProfilerModuleName(uint8_t module) {
+    return (module < os_module_count) ? os_modules[module].name : "";
+}
+
+int OsProfilerTaskPrefixAdd(const char *prefix, uint8_t module) {
+    if ((prefix == NULL) || (prefix[0] == '\0') || (module >= os_module_count) || (os_prefix_count >= OS_PROFILER_MAX_PREFIXES)) {
+        return -1;
+    }
+    vTaskSuspendAll();
+    // added prefixes are checked first so that they can override a default
+    memmove(&os_prefixes[1], &os_prefixes[0], (os_prefix_count * sizeof(os_prefix_t)));
+    memset(&os_prefixes[0], 0, sizeof(os_prefix_t));
+    strncpy(os_prefixes[0].prefix, prefix, (OS_PROFILER_NAME_LEN - 1));
+    os_prefixes[0].module = module;
+    os_prefix_count++;
+    (void)xTaskResumeAll();
+    return 0;
+}
+
+int OsProfilerTagSet(uint8_t module) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    int previous = -1;
+    int slot = -1;
+
+    if (module >= os_module_count) {
+        return -1;
+    }
+    vTaskSuspendAll();
+    for (int i = 0; i < OS_PROFILER_MAX_TAGS; i++) {
+        if (os_tags[i].task == task) {
+            previous = os_tags[i].module;
+            slot = i;
+            break;
+        }
+        if ((slot < 0) && (os_tags[i].task == NULL)) {
+            slot = i;
+        }
+    }
+    if (slot >= 0) {
+        os_tags[slot].task = task;
+        os_tags[slot].module = module;
+    }
+    (void)xTaskResumeAll();
+    if (slot < 0) {
+        printf("\r\n[ERROR] %s more than %d tasks tagged\n", __FUNCTION__, OS_PROFILER_MAX_TAGS);
+    }
+    return previous;
+}
+
+void OsProfilerTagRestore(int previous) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    vTaskSuspendAll();
+    for (int i = 0; i < OS_PROFILER_MAX_TAGS; i++) {
+        if (os_tags[i].task == task) {
+            if ((previous < 0) || (previous >= os_module_count)) {
+                os_tags[i].task = NULL;
+            } else {
+                os_tags[i].module = (uint8_t)previous;
+            }
+            break;
+        }
+    }
+    (void)xTaskResumeAll();
+}
+
+int OsProfilerSample(os_profile_t *profile) {
+    TaskStatus_t *status;
+    UBaseType_t count;
+    uint32_t total = 0;
+    uint32_t elapsed;
+    uint32_t delta;
+    uint32_t counter;
+    os_run_time_t run_time[OS_PROFILER_MAX_TASKS];
+    uint8_t run_time_count = 0;
+    HeapStats_t heap;
+
+    if (profile == NULL) {
+        return -1;
+    }
+    // a few spare entries for tasks created in between
+    count = uxTaskGetNumberOfTasks() + 4;
+    status = (TaskStatus_t *)__real_pvPortMalloc(count * sizeof(TaskStatus_t));
+    if (status == NULL) {
+        printf("\r\n[ERROR] %s task status allocation failed\n", __FUNCTION__);
+        return -1;
+    }
+    memset(profile, 0, sizeof(os_profile_t));
+    count = uxTaskGetSystemState(status, count, &total);
+    profile->timestamp = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    profile->interval = profile->timestamp - os_sample_time;
+    os_sample_time = profile->timestamp;
+    elapsed = total - os_run_time_total;
+    os_run_time_total = total;
+
+    vTaskSuspendAll();
+    for (UBaseType_t i = 0; (i < count) && (i < OS_PROFILER_MAX_TASKS); i++) {
+        os_task_profile_t *task = &profile->tasks[i];
+
+        strncpy(task->name, status[i].pcTaskName, (OS_PROFILER_NAME_LEN - 1));
+        task->number = status[i].xTaskNumber;
+        task->state = (uint8_t)status[i].eCurrentState;
+        task->priority = (uint8_t)status[i].uxCurrentPriority;
+        task->module = os_task_module(status[i].xHandle, status[i].pcTaskName);
+        task->stack_free = status[i].usStackHighWaterMark * sizeof(StackType_t);
+
+        // run time counted since the previous sample, all of it for a task that was not there
+        counter = status[i].ulRunTimeCounter;
+        delta = counter;
+        for (int j = 0; j < os_run_time_count; j++) {
+            if (os_run_time[j].number == task->number) {
+                delta = counter - os_run_time[j].counter;
+                break;
+            }
+        }
+        run_time[run_time_count].number = task->number;
+        run_time[run_time_count].counter = counter;
+        run_time_count++;
+        if (elapsed > 0) {
+            task->cpu = (uint16_t)((((uint64_t)delta) * 1000) / elapsed);
+        }
+        profile->task_count++;
+    }
+    memcpy(os_run_time, run_time, (run_time_count * sizeof(os_run_time_t)));
+    os_run_time_count = run_time_count;
+
+    for (int i = 0; i < os_module_count; i++) {
+        profile->modules[i].name = os_modules[i].name;
+        profile->modules[i].bytes = os_modules[i].bytes;
+        profile->modules[i].peak = os_modules[i].peak;
+        profile->modules[i].allocs = os_modules[i].allocs;
+        profile->modules[i].failed = os_modules[i].failed;
+    }
+    profile->module_count = os_module_count;
+    profile->heap_untracked = os_heap_untracked;
+    profile->heap_tracking = (os_heap_table != NULL);
+    (void)xTaskResumeAll();
+
+    for (int i = 0; i < profile->task_count; i++) {
+        profile->modules[profile->tasks[i].module].cpu += profile->tasks[i].cpu;
+    }
+    __real_vPortFree(status);
+
+    vPortGetHeapStats(&heap);
+    profile->heap_free = heap.xAvailableHeapSpaceInBytes;
+    profile->heap_min_free = heap.xMinimumEverFreeBytesRemaining;
+    profile->heap_largest = heap.xSizeOfLargestFreeBlockInBytes;
+    return 0;
+}
+
+void OsProfilerReset(void) {
+    vTaskSuspendAll();
+    for (int i = 0; i < os_module_count; i++) {
+        os_modules[i].peak = os_modules[i].bytes;
+        os_modules[i].allocs = 0;
+        os_modules[i].failed = 0;
+    }
+    os_heap_untracked = 0;
+    (void)xTaskResumeAll();
+}
@@ -0,0 +1,89 @@
+#ifndef OS_PROFILER_DRV_H
+#define OS_PROFILER_DRV_H
+
+#include <stdint.h>
+
+#define OS_PROFILER_MAX_TASKS       32
+#define OS_PROFILER_MAX_MODULES     16
+#define OS_PROFILER_MAX_PREFIXES    32
+#define OS_PROFILER_NAME_LEN        12          // same as configMAX_TASK_NAME_LEN
+// live allocations tracked by default, 8 bytes each
+#define OS_PROFILER_HEAP_ENTRIES    2048
+
+// Module ids of the default table, more can be added by OsProfilerModuleAdd()
+#define OS_PROFILER_MODULE_OTHER    0           // tasks that match no prefix
+#define OS_PROFILER_MODULE_SKETCH   1
+#define OS_PROFILER_MODULE_VIDEO    2
+#define OS_PROFILER_MODULE_NN       3
+#define OS_PROFILER_MODULE_RTSP     4
+#define OS_PROFILER_MODULE_OSD      5
+#define OS_PROFILER_MODULE_LWIP     6
+#define OS_PROFILER_MODULE_WIFI     7
+#define OS_PROFILER_MODULE_AUDIO    8
+
+typedef struct os_task_profile_s {
+    char name[OS_PROFILER_NAME_LEN];
+    uint32_t number;        // FreeRTOS task number, stable while the task exists
+    uint8_t state;          // eTaskState
+    uint8_t priority;
+    uint8_t module;
+    uint16_t cpu;           // CPU share since the previous sample in 0.1 %
+    uint32_t stack_free;    // smallest free stack ever seen, in bytes
+} os_task_profile_t;
+
+typedef struct os_module_profile_s {
+    const char *name;
+    uint32_t bytes;         // allocated and not yet freed
+    uint32_t peak;
+    uint32_t allocs;        // allocations made since tracking started
+    uint32_t failed;        // allocations that returned NULL
+    uint16_t cpu;           // summed CPU share of the module tasks in 0.1 %
+} os_module_profile_t;
+
+typedef struct os_profile_s {
+    uint32_t timestamp;     // ms
+    uint32_t interval;      // ms covered by the CPU figures
+    uint32_t heap_free;
+    uint32_t heap_min_free;
+    uint32_t heap_largest;  // largest free block
+    uint32_t heap_untracked;// bytes allocated while the allocation table was full, not charged to any module
+    uint8_t heap_tracking;
+    uint8_t task_count;
+    uint8_t module_count;
+    os_task_profile_t tasks[OS_PROFILER_MAX_TASKS];
+    os_module_profile_t modules[OS_PROFILER_MAX_MODULES];
+} os_profile_t;
+
+// Start attributing pvPortMalloc/vPortFree to modules, entries is the size of the live
+// allocation table taken from the heap. Allocations made before this are not counted.
+// The allocator is only wrapped when the sketch is built with Tools > Heap Profiler set to Enable.
+// Returns 0 if successful, -1 if the table could not be allocated or the allocator is not wrapped
+int OsProfilerHeapEnable(uint32_t entries);
+
+void OsProfilerHeapDisable(void);
+
+// Returns the module id, or -1 if the module table is full
+int OsProfilerModuleAdd(const char *name);
+
+int OsProfilerModuleFind(const char *name);
+
+const char *OsProfilerModuleName(uint8_t module);
+
+// Attribute tasks whose name starts with prefix to module
+// Returns 0 if successful, -1 if the prefix table is full or the module does not exist
+int OsProfilerTaskPrefixAdd(const char *prefix, uint8_t module);
+
+// Charge allocations made by the calling task to module whatever the task name is
+// Returns the previous tag, -1 if there was none, to be given back to OsProfilerTagRestore()
+int OsProfilerTagSet(uint8_t module);
+
+// Restore the tag returned by OsProfilerTagSet(), -1 removes the tag
+void OsProfilerTagRestore(int previous);
+
+// Fill profile with task, module and heap figures, CPU shares cover the time since the previous call
+int OsProfilerSample(os_profile_t *profile);
+
+// Clear module peaks and allocation counters, the bytes currently allocated are kept
+void OsProfilerReset(void);
+
+#endif
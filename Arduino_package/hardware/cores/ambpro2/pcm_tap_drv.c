@@ -0,0 +1,345 @@
+#include "pcm_tap_drv.h"
+#include "mmf2_module.h"
+#include "us_ticker_api.h"
+
+#define PCM_TAP_MAX_GAPS            8
+
+// Where the reader will meet samples the ring had no room for
+typedef struct pcm_tap_gap_s {
+    uint32_t pos;               // ring count of the first sample written after the gap
+    uint32_t dropped;           // samples dropped up to and including this gap
+} pcm_tap_gap_t;
+
+typedef struct pcm_tap_ctx_s {
+    void *parent;
+    pcm_tap_params_t params;
+    pcm_tap_stats_t stats;
+    pcm_tap_block_cb_t callback;
+    void *cb_arg;
+
+    // single producer (stream task), single consumer (reader) ring, counts only ever increase
+    int16_t *ring;
+    uint32_t ring_size;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    pcm_tap_gap_t gaps[PCM_TAP_MAX_GAPS];
+    volatile uint32_t gap_head;
+    volatile uint32_t gap_tail;
+    uint32_t dropped;           // producer total
+    uint8_t gap_pending;        // frames dropped since the last write, not in gaps yet
+    uint32_t read_dropped;      // total of the gaps the reader has passed
+
+    int16_t *block_buf;
+    uint32_t block_fill;
+    uint32_t block_index;
+} pcm_tap_ctx_t;
+
+static void pcm_tap_ring_write(pcm_tap_ctx_t *ctx, const int16_t *samples, uint32_t count) {
+    uint32_t head = ctx->head;
+    uint32_t room = ctx->ring_size - (head - ctx->tail);
+    uint32_t pos, first;
+
+    // A gap is only published with the first frame written after it, so it is never changed once
+    // the reader can see it. While the reader has every gap slot still to pass, frames keep being
+    // dropped, which keeps the pending gap at the head where the next samples will go.
+    if (ctx->gap_pending && ((ctx->gap_head - ctx->gap_tail) >= PCM_TAP_MAX_GAPS)) {
+        room = 0;
+    }
+    // drop whole frames, so the reader only ever sees gaps at frame boundaries
+    if (count > room) {
+        ctx->dropped += count;
+        ctx->stats.overruns += count;
+        ctx->gap_pending = 1;
+        return;
+    }
+    if (ctx->gap_pending) {
+        ctx->gaps[ctx->gap_head % PCM_TAP_MAX_GAPS].pos = head;
+        ctx->gaps[ctx->gap_head % PCM_TAP_MAX_GAPS].dropped = ctx->dropped;
+        __sync_synchronize();
+        ctx->gap_head++;
+        ctx->gap_pending = 0;
+    }
+
+    pos = head & (ctx->ring_size - 1);
+    first = ctx->ring_size - pos;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(&ctx->ring[pos], samples, (first * sizeof(int16_t)));
+    if (count > first) {
+        memcpy(ctx->ring, &samples[first], ((count - first) * sizeof(int16_t)));
+    }
+    // samples must be in memory before the reader can see the new head
+    __sync_synchronize();
+    ctx->head = head + count;
+}
+
+static void pcm_tap_block_call(pcm_tap_ctx_t *ctx, const int16_t *samples, uint32_t index) {
+    uint32_t start = us_ticker_read();
+    uint32_t elapsed;
+
+    ctx->callback(samples, ctx->params.block_samples, index, ctx->cb_arg);
+    elapsed = us_ticker_read() - start;
+    ctx->stats.blocks++;
+    if (elapsed > ctx->stats.max_block_us) {
+        ctx->stats.max_block_us = elapsed;
+    }
+}
+
+static void pcm_tap_block_feed(pcm_tap_ctx_t *ctx, const int16_t *samples, uint32_t count, uint32_t index) {
+    uint32_t block = ctx->params.block_samples;
+    uint32_t n;
+
+    while (count) {
+        // whole blocks are handed over straight from the source frame
+        if ((ctx->block_fill == 0) && (count >= block)) {
+            pcm_tap_block_call(ctx, samples, index);
+            samples += block;
+            count -= block;
+            index += block;
+            continue;
+        }
+        if (ctx->block_fill == 0) {
+            ctx->block_index = index;
+        }
+        n = block - ctx->block_fill;
+        if (n > count) {
+            n = count;
+        }
+        memcpy(&ctx->block_buf[ctx->block_fill], samples, (n * sizeof(int16_t)));
+        ctx->block_fill += n;
+        samples += n;
+        count -= n;
+        index += n;
+        if (ctx->block_fill == block) {
+            ctx->block_fill = 0;
+            pcm_tap_block_call(ctx, ctx->block_buf, ctx->block_index);
+        }
+    }
+}
+
+int pcm_tap_handle(void *p, void *input, void *output) {
+    (void)output;
+    pcm_tap_ctx_t *ctx = (pcm_tap_ctx_t *)p;
+    mm_queue_item_t *input_item = (mm_queue_item_t *)input;
+    const int16_t *samples = (const int16_t *)input_item->data_addr;
+    uint32_t count = input_item->size / sizeof(int16_t);
+
+    if (ctx->stats.frames == 0) {
+        ctx->stats.first_timestamp = input_item->timestamp;
+    }
+    ctx->stats.frames++;
+    if (count == 0) {
+        return 0;
+    }
+    // the source frame is only read, it goes back to the audio module untouched
+    if (ctx->ring) {
+        pcm_tap_ring_write(ctx, samples, count);
+    }
+    if (ctx->callback && ctx->block_buf) {
+        pcm_tap_block_feed(ctx, samples, count, ctx->stats.samples);
+    }
+    ctx->stats.samples += count;
+    return 0;
+}
+
+static void pcm_tap_free_buffers(pcm_tap_ctx_t *ctx) {
+    free(ctx->ring);
+    free(ctx->block_buf);
+    ctx->ring = NULL;
+    ctx->ring_size = 0;
+    ctx->block_buf = NULL;
+}
+
+int pcm_tap_control(void *p, int cmd, int arg) {
+    pcm_tap_ctx_t *ctx = (pcm_tap_ctx_t *)p;
+
+    switch (cmd) {
+        case CMD_PCM_TAP_SET_PARAMS:
+            memcpy(&ctx->params, (void *)arg, sizeof(pcm_tap_params_t));
+            break;
+        case CMD_PCM_TAP_GET_PARAMS:
+            memcpy((void *)arg, &ctx->params, sizeof(pcm_tap_params_t));
+            break;
+        case CMD_PCM_TAP_SET_CALLBACK:
+            ctx->callback = (pcm_tap_block_cb_t)arg;
+            break;
+        case CMD_PCM_TAP_SET_CB_ARG:
+            ctx->cb_arg = (void *)arg;
+            break;
+        case CMD_PCM_TAP_GET_STATS:
+            memcpy((void *)arg, &ctx->stats, sizeof(pcm_tap_stats_t));
+            break;
+        case CMD_PCM_TAP_APPLY: {
+            uint32_t size = 0;
+            pcm_tap_free_buffers(ctx);
+            if (ctx->params.ring_samples) {
+                size = 64;
+                while (size < ctx->params.ring_samples) {
+                    size <<= 1;
+                }
+                ctx->ring = (int16_t *)malloc(size * sizeof(int16_t));
+                if (ctx->ring == NULL) {
+                    printf("\r\n[ERROR] PCM tap ring allocation failed\n");
+                    return -1;
+                }
+                ctx->ring_size = size;
+            }
+            if (ctx->params.block_samples) {
+                ctx->block_buf = (int16_t *)malloc(ctx->params.block_samples * sizeof(int16_t));
+                if (ctx->block_buf == NULL) {
+                    printf("\r\n[ERROR] PCM tap block buffer allocation failed\n");
+                    pcm_tap_free_buffers(ctx);
+                    return -1;
+                }
+            }
+            ctx->head = 0;
+            ctx->tail = 0;
+            ctx->gap_head = 0;
+            ctx->gap_tail = 0;
+            ctx->dropped = 0;
+            ctx->gap_pending = 0;
+            ctx->read_dropped = 0;
+            ctx->block_fill = 0;
+            memset(&ctx->stats, 0, sizeof(pcm_tap_stats_t));
+            break;
+        }
+        default:
+            break;
+    }
+    return 0;
+}
+
+void *pcm_tap_destroy(void *p) {
+    pcm_tap_ctx_t *ctx = (pcm_tap_ctx_t *)p;
+    if (ctx) {
+        pcm_tap_free_buffers(ctx);
+        free(ctx);
+    }
+    return NULL;
+}
+
+void *pcm_tap_create(void *parent) {
+    pcm_tap_ctx_t *ctx = (pcm_tap_ctx_t *)malloc(sizeof(pcm_tap_ctx_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(pcm_tap_ctx_t));
+    ctx->parent = parent;
+    ctx->params.sample_rate = 8000;
+    ctx->params.channels = 1;
+    ctx->params.ring_samples = 4096;
+    return ctx;
+}
+
+mm_module_t pcm_tap_module = {
+    .create = pcm_tap_create,
+    .destroy = pcm_tap_destroy,
+    .control = pcm_tap_control,
+    .handle = pcm_tap_handle,
+
+    .new_item = NULL,
+    .del_item = NULL,
+
+    .output_type = MM_TYPE_NONE,
+    .module_type = MM_TYPE_ASINK,
+    .name = "PCMTAP"
+};
+
+//-----------------------------------------------------------------------------
+// Arduino driver interface
+
+mm_context_t *PCMTapInit(void) {
+    return mm_module_open(&pcm_tap_module);
+}
+
+mm_context_t *PCMTapDeinit(mm_context_t *p) {
+    return mm_module_close(p);
+}
+
+int PCMTapSetParams(void *p, pcm_tap_params_t *params) {
+    return pcm_tap_control(p, CMD_PCM_TAP_SET_PARAMS, (int)params);
+}
+
+int PCMTapSetApply(void *p) {
+    return pcm_tap_control(p, CMD_PCM_TAP_APPLY, 0);
+}
+
+void PCMTapSetCallback(void *p, pcm_tap_block_cb_t callback, void *arg) {
+    pcm_tap_control(p, CMD_PCM_TAP_SET_CB_ARG, (int)arg);
+    pcm_tap_control(p, CMD_PCM_TAP_SET_CALLBACK, (int)callback);
+}
+
+int PCMTapGetStats(void *p, pcm_tap_stats_t *stats) {
+    return pcm_tap_control(p, CMD_PCM_TAP_GET_STATS, (int)stats);
+}
+
+uint32_t PCMTapAvailable(void *p) {
+    pcm_tap_ctx_t *ctx = (pcm_tap_ctx_t *)p;
+    return (ctx->head - ctx->tail);
+}
+
+uint32_t PCMTapAcquire(void *p, const int16_t **data) {
+    pcm_tap_ctx_t *ctx = (pcm_tap_ctx_t *)p;
+    uint32_t available = ctx->head - ctx->tail;
+    uint32_t pos, contiguous;
+
+    if ((available == 0) || (ctx->ring == NULL)) {
+        *data = NULL;
+        return 0;
+    }
+    // read head before the samples it covers
+    __sync_synchronize();
+    pos = ctx->tail & (ctx->ring_size - 1);
+    contiguous = ctx->ring_size - pos;
+    *data = &ctx->ring[pos];
+    return (available < contiguous) ? available : contiguous;
+}
+
+void PCMTapRelease(void *p, uint32_t count) {
+    pcm_tap_ctx_t *ctx = (pcm_tap_ctx_t *)p;
+    uint32_t available = ctx->head - ctx->tail;
+
+    if (count > available) {
+        count = available;
+    }
+    // done with the samples before the producer may reuse their slots
+    __sync_synchronize();
+    ctx->tail += count;
+}
+
+uint32_t PCMTapRead(void *p, int16_t *buffer, uint32_t count) {
+    const int16_t *data;
+    uint32_t copied = 0;
+    uint32_t n;
+
+    while (copied < count) {
+        n = PCMTapAcquire(p, &data);
+        if (n == 0) {
+            break;
+        }
+        if (n > (count - copied)) {
+            n = count - copied;
+        }
+        memcpy(&buffer[copied], data, (n * sizeof(int16_t)));
+        PCMTapRelease(p, n);
+        copied += n;
+    }
+    return copied;
+}
+
+uint32_t PCMTapReadIndex(void *p) {
+    pcm_tap_ctx_t *ctx = (pcm_tap_ctx_t *)p;
+    uint32_t tail = ctx->tail;
+
+    while (ctx->gap_tail != ctx->gap_head) {
+        pcm_tap_gap_t *gap = &ctx->gaps[ctx->gap_tail % PCM_TAP_MAX_GAPS];
+        __sync_synchronize();
+        if ((int32_t)(gap->pos - tail) > 0) {
+            break;
+        }
+        ctx->read_dropped = gap->dropped;
+        ctx->gap_tail++;
+    }
+    return tail + ctx->read_dropped;
+}
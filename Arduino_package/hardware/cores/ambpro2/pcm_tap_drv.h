@@ -0,0 +1,65 @@
+#ifndef PCM_TAP_DRV_H
+#define PCM_TAP_DRV_H
+
+#include "mmf2_module.h"
+
+#define CMD_PCM_TAP_SET_PARAMS      MM_MODULE_CMD(0x00)
+#define CMD_PCM_TAP_GET_PARAMS      MM_MODULE_CMD(0x01)
+#define CMD_PCM_TAP_SET_CALLBACK    MM_MODULE_CMD(0x02)
+#define CMD_PCM_TAP_SET_CB_ARG      MM_MODULE_CMD(0x03)
+#define CMD_PCM_TAP_GET_STATS       MM_MODULE_CMD(0x04)
+#define CMD_PCM_TAP_APPLY           MM_MODULE_CMD(0x20)
+
+// Called from the stream task with block_samples samples, index is the position of the
+// first sample counted from the start of the stream. samples is only valid during the call.
+typedef void (*pcm_tap_block_cb_t)(const int16_t *samples, uint32_t count, uint32_t index, void *arg);
+
+typedef struct pcm_tap_params_s {
+    uint32_t sample_rate;
+    uint8_t channels;           // samples of a multi channel stream are interleaved
+    uint32_t ring_samples;      // read ring capacity, rounded up to a power of two, 0 disables reading
+    uint32_t block_samples;     // block callback size, 0 disables block callbacks
+} pcm_tap_params_t;
+
+typedef struct pcm_tap_stats_s {
+    uint32_t frames;            // audio frames received
+    uint32_t samples;           // samples received, the index of the next sample
+    uint32_t first_timestamp;   // timestamp of the first frame, ms
+    uint32_t overruns;          // samples the reader lost because the ring was full
+    uint32_t blocks;            // block callbacks made
+    uint32_t max_block_us;      // longest block callback
+} pcm_tap_stats_t;
+
+mm_context_t *PCMTapInit(void);
+
+mm_context_t *PCMTapDeinit(mm_context_t *p);
+
+int PCMTapSetParams(void *p, pcm_tap_params_t *params);
+
+// Allocate the ring and block buffers and restart counting
+int PCMTapSetApply(void *p);
+
+void PCMTapSetCallback(void *p, pcm_tap_block_cb_t callback, void *arg);
+
+int PCMTapGetStats(void *p, pcm_tap_stats_t *stats);
+
+// Single reader interface, safe against the stream task without locking
+
+// Samples ready to read
+uint32_t PCMTapAvailable(void *p);
+
+// Copy up to count samples, returns the number copied
+uint32_t PCMTapRead(void *p, int16_t *buffer, uint32_t count);
+
+// Point data at the oldest unread samples without copying, returns how many are contiguous
+uint32_t PCMTapAcquire(void *p, const int16_t **data);
+
+// Give back count samples obtained with PCMTapAcquire()
+void PCMTapRelease(void *p, uint32_t count);
+
+// Index of the next sample PCMTapRead() returns, samples lost to overruns are skipped
+uint32_t PCMTapReadIndex(void *p);
+
+extern mm_module_t pcm_tap_module;
+
+#endif
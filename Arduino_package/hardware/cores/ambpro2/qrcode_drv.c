@@ -0,0 +1,284 @@
+#include "qrcode_drv.h"
+#include "mmf2_module.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+// Redeclare here since the qr_code_scanner headers are not in the Arduino include path
+typedef struct zbar_image_scanner_s zbar_image_scanner_t;
+typedef struct zbar_image_s zbar_image_t;
+typedef struct zbar_symbol_s zbar_symbol_t;
+
+extern zbar_image_scanner_t *zbar_image_scanner_create(void);
+extern void zbar_image_scanner_destroy(zbar_image_scanner_t *scanner);
+extern int zbar_image_scanner_set_config(zbar_image_scanner_t *scanner, int symbology, int config, int value);
+extern int zbar_scan_image(zbar_image_scanner_t *scanner, zbar_image_t *image);
+extern zbar_image_t *zbar_image_create(void);
+extern void zbar_image_destroy(zbar_image_t *image);
+extern void zbar_image_set_format(zbar_image_t *image, unsigned long format);
+extern void zbar_image_set_size(zbar_image_t *image, unsigned width, unsigned height);
+extern void zbar_image_set_data(zbar_image_t *image, const void *data, unsigned long data_byte_length, void *cleanup_hndlr);
+extern const zbar_symbol_t *zbar_image_first_symbol(const zbar_image_t *image);
+extern const zbar_symbol_t *zbar_symbol_next(const zbar_symbol_t *symbol);
+extern int zbar_symbol_get_type(const zbar_symbol_t *symbol);
+extern const char *zbar_symbol_get_data(const zbar_symbol_t *symbol);
+extern unsigned int zbar_symbol_get_data_length(const zbar_symbol_t *symbol);
+extern int zbar_symbol_get_quality(const zbar_symbol_t *symbol);
+extern unsigned zbar_symbol_get_loc_size(const zbar_symbol_t *symbol);
+extern int zbar_symbol_get_loc_x(const zbar_symbol_t *symbol, unsigned index);
+extern int zbar_symbol_get_loc_y(const zbar_symbol_t *symbol, unsigned index);
+extern const char *zbar_get_symbol_name(int symbology);
+
+#define ZBAR_NONE                   0
+#define ZBAR_QRCODE                 64
+#define ZBAR_CFG_ENABLE             0
+#define ZBAR_FOURCC_Y800            ((unsigned long)'Y' | ((unsigned long)'8' << 8) | ((unsigned long)'0' << 16) | ((unsigned long)'0' << 24))
+
+typedef struct qrcode_ctx_s {
+    void *parent;
+    qrcode_params_t params;
+    qrcode_stats_t stats;
+    zbar_image_scanner_t *scanner;
+    uint8_t *roi_buf;           // only used when the ROI is narrower than the frame
+    uint32_t roi_buf_size;
+    uint32_t frame_cnt;
+    volatile TickType_t trigger_end;
+    void (*disppost)(qrcode_result_t *, int);
+    qrcode_result_t results[QRCODE_MAX_RESULTS];
+} qrcode_ctx_t;
+
+static int qrcode_trigger_open(qrcode_ctx_t *ctx) {
+    if (!ctx->params.trigger_mode) {
+        return 1;
+    }
+    return ((int32_t)(ctx->trigger_end - xTaskGetTickCount()) > 0);
+}
+
+// The NV12 luma plane is already a Y800 image, so a full width ROI is scanned in place.
+// Narrower ROIs only copy the selected rows and columns, never the chroma plane.
+static const uint8_t *qrcode_get_roi(qrcode_ctx_t *ctx, const uint8_t *luma, uint16_t *roi_w, uint16_t *roi_h) {
+    qrcode_params_t *params = &ctx->params;
+    uint16_t w = params->roi_xmax - params->roi_xmin;
+    uint16_t h = params->roi_ymax - params->roi_ymin;
+
+    *roi_w = w;
+    *roi_h = h;
+    if (w == params->width) {
+        return luma + (params->roi_ymin * params->width);
+    }
+    if (ctx->roi_buf == NULL) {
+        return NULL;
+    }
+    const uint8_t *src = luma + (params->roi_ymin * params->width) + params->roi_xmin;
+    uint8_t *dst = ctx->roi_buf;
+    for (uint16_t row = 0; row < h; row++) {
+        memcpy(dst, src, w);
+        src += params->width;
+        dst += w;
+    }
+    return ctx->roi_buf;
+}
+
+int qrcode_handle(void *p, void *input, void *output) {
+    (void)output;
+    qrcode_ctx_t *ctx = (qrcode_ctx_t *)p;
+    mm_queue_item_t *input_item = (mm_queue_item_t *)input;
+    const uint8_t *roi;
+    uint16_t roi_w, roi_h;
+    int count = 0;
+
+    ctx->stats.frames++;
+    if ((ctx->scanner == NULL) || !qrcode_trigger_open(ctx)) {
+        return 0;
+    }
+    // skip frames so decoding never falls more than one frame behind the camera
+    if ((ctx->frame_cnt++ % (ctx->params.frame_skip + 1)) != 0) {
+        return 0;
+    }
+    roi = qrcode_get_roi(ctx, (const uint8_t *)input_item->data_addr, &roi_w, &roi_h);
+    if (roi == NULL) {
+        return 0;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    zbar_image_t *image = zbar_image_create();
+    if (image == NULL) {
+        return 0;
+    }
+    zbar_image_set_format(image, ZBAR_FOURCC_Y800);
+    zbar_image_set_size(image, roi_w, roi_h);
+    zbar_image_set_data(image, roi, (unsigned long)roi_w * roi_h, NULL);
+
+    if (zbar_scan_image(ctx->scanner, image) > 0) {
+        const zbar_symbol_t *symbol = zbar_image_first_symbol(image);
+        for (; symbol && (count < QRCODE_MAX_RESULTS); symbol = zbar_symbol_next(symbol)) {
+            qrcode_result_t *res = &ctx->results[count++];
+            res->type = zbar_symbol_get_type(symbol);
+            res->name = zbar_get_symbol_name(res->type);
+            res->data = (const uint8_t *)zbar_symbol_get_data(symbol);
+            res->len = zbar_symbol_get_data_length(symbol);
+            res->quality = zbar_symbol_get_quality(symbol);
+            res->point_cnt = zbar_symbol_get_loc_size(symbol);
+            if (res->point_cnt > QRCODE_MAX_POINTS) {
+                res->point_cnt = QRCODE_MAX_POINTS;
+            }
+            for (int i = 0; i < res->point_cnt; i++) {
+                res->x[i] = zbar_symbol_get_loc_x(symbol, i) + ctx->params.roi_xmin;
+                res->y[i] = zbar_symbol_get_loc_y(symbol, i) + ctx->params.roi_ymin;
+            }
+        }
+    }
+
+    ctx->stats.scanned++;
+    ctx->stats.decoded += count;
+    ctx->stats.last_scan_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+    if (ctx->stats.last_scan_ms > ctx->stats.max_scan_ms) {
+        ctx->stats.max_scan_ms = ctx->stats.last_scan_ms;
+    }
+    if (count && ctx->disppost) {
+        ctx->disppost(ctx->results, count);
+    }
+    // symbol data is owned by the image, results are only valid inside the callback
+    zbar_image_destroy(image);
+    return 0;
+}
+
+int qrcode_control(void *p, int cmd, int arg) {
+    qrcode_ctx_t *ctx = (qrcode_ctx_t *)p;
+
+    switch (cmd) {
+        case CMD_QRCODE_SET_PARAMS:
+            memcpy(&ctx->params, (void *)arg, sizeof(qrcode_params_t));
+            break;
+        case CMD_QRCODE_GET_PARAMS:
+            memcpy((void *)arg, &ctx->params, sizeof(qrcode_params_t));
+            break;
+        case CMD_QRCODE_SET_DISPPOST:
+            ctx->disppost = (void (*)(qrcode_result_t *, int))arg;
+            break;
+        case CMD_QRCODE_TRIGGER:
+            ctx->trigger_end = xTaskGetTickCount() + pdMS_TO_TICKS((uint32_t)arg);
+            break;
+        case CMD_QRCODE_GET_STATS:
+            memcpy((void *)arg, &ctx->stats, sizeof(qrcode_stats_t));
+            break;
+        case CMD_QRCODE_APPLY: {
+            qrcode_params_t *params = &ctx->params;
+            if ((params->roi_xmax == 0) || (params->roi_xmax > params->width)) {
+                params->roi_xmax = params->width;
+            }
+            if ((params->roi_ymax == 0) || (params->roi_ymax > params->height)) {
+                params->roi_ymax = params->height;
+            }
+            if ((params->roi_xmin >= params->roi_xmax) || (params->roi_ymin >= params->roi_ymax)) {
+                printf("\r\n[ERROR] QR code scanner region of interest is empty\n");
+                return -1;
+            }
+            uint32_t roi_size = (uint32_t)(params->roi_xmax - params->roi_xmin) * (params->roi_ymax - params->roi_ymin);
+            if ((params->roi_xmax - params->roi_xmin) == params->width) {
+                roi_size = 0;
+            }
+            if (roi_size != ctx->roi_buf_size) {
+                free(ctx->roi_buf);
+                ctx->roi_buf = NULL;
+                ctx->roi_buf_size = 0;
+                if (roi_size) {
+                    ctx->roi_buf = (uint8_t *)malloc(roi_size);
+                    if (ctx->roi_buf == NULL) {
+                        printf("\r\n[ERROR] QR code scanner ROI buffer allocation failed\n");
+                        return -1;
+                    }
+                    ctx->roi_buf_size = roi_size;
+                }
+            }
+            if (ctx->scanner == NULL) {
+                ctx->scanner = zbar_image_scanner_create();
+                if (ctx->scanner == NULL) {
+                    printf("\r\n[ERROR] QR code scanner init failed\n");
+                    return -1;
+                }
+            }
+            if (params->qr_only) {
+                zbar_image_scanner_set_config(ctx->scanner, ZBAR_NONE, ZBAR_CFG_ENABLE, 0);
+                zbar_image_scanner_set_config(ctx->scanner, ZBAR_QRCODE, ZBAR_CFG_ENABLE, 1);
+            } else {
+                zbar_image_scanner_set_config(ctx->scanner, ZBAR_NONE, ZBAR_CFG_ENABLE, 1);
+            }
+            ctx->frame_cnt = 0;
+            memset(&ctx->stats, 0, sizeof(qrcode_stats_t));
+            break;
+        }
+        default:
+            break;
+    }
+    return 0;
+}
+
+void *qrcode_destroy(void *p) {
+    qrcode_ctx_t *ctx = (qrcode_ctx_t *)p;
+    if (ctx) {
+        if (ctx->scanner) {
+            zbar_image_scanner_destroy(ctx->scanner);
+        }
+        free(ctx->roi_buf);
+        free(ctx);
+    }
+    return NULL;
+}
+
+void *qrcode_create(void *parent) {
+    qrcode_ctx_t *ctx = (qrcode_ctx_t *)malloc(sizeof(qrcode_ctx_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(qrcode_ctx_t));
+    ctx->parent = parent;
+    ctx->params.width = 640;
+    ctx->params.height = 480;
+    return ctx;
+}
+
+mm_module_t qrcode_module = {
+    .create = qrcode_create,
+    .destroy = qrcode_destroy,
+    .control = qrcode_control,
+    .handle = qrcode_handle,
+
+    .new_item = NULL,
+    .del_item = NULL,
+
+    .output_type = MM_TYPE_NONE,
+    .module_type = MM_TYPE_VSINK,
+    .name = "QRCODE"
+};
+
+//-----------------------------------------------------------------------------
+// Arduino driver interface
+
+mm_context_t *QRCodeInit(void) {
+    return mm_module_open(&qrcode_module);
+}
+
+mm_context_t *QRCodeDeinit(mm_context_t *p) {
+    return mm_module_close(p);
+}
+
+int QRCodeSetParams(void *p, qrcode_params_t *params) {
+    return qrcode_control(p, CMD_QRCODE_SET_PARAMS, (int)params);
+}
+
+int QRCodeSetApply(void *p) {
+    return qrcode_control(p, CMD_QRCODE_APPLY, 0);
+}
+
+void QRCodeSetDisppost(void *p, void (*qr_postprocess)(qrcode_result_t *, int)) {
+    qrcode_control(p, CMD_QRCODE_SET_DISPPOST, (int)qr_postprocess);
+}
+
+void QRCodeTrigger(void *p, uint32_t window_ms) {
+    qrcode_control(p, CMD_QRCODE_TRIGGER, (int)window_ms);
+}
+
+int QRCodeGetStats(void *p, qrcode_stats_t *stats) {
+    return qrcode_control(p, CMD_QRCODE_GET_STATS, (int)stats);
+}
@@ -0,0 +1,63 @@
+#ifndef QRCODE_DRV_H
+#define QRCODE_DRV_H
+
+#include "mmf2_module.h"
+
+#define CMD_QRCODE_SET_PARAMS       MM_MODULE_CMD(0x00)
+#define CMD_QRCODE_GET_PARAMS       MM_MODULE_CMD(0x01)
+#define CMD_QRCODE_SET_DISPPOST     MM_MODULE_CMD(0x02)
+#define CMD_QRCODE_TRIGGER          MM_MODULE_CMD(0x03)
+#define CMD_QRCODE_GET_STATS        MM_MODULE_CMD(0x04)
+#define CMD_QRCODE_APPLY            MM_MODULE_CMD(0x20)
+
+#define QRCODE_MAX_RESULTS          8
+#define QRCODE_MAX_POINTS           4
+
+typedef struct qrcode_params_s {
+    uint16_t width;
+    uint16_t height;
+    uint16_t roi_xmin;
+    uint16_t roi_xmax;
+    uint16_t roi_ymin;
+    uint16_t roi_ymax;
+    uint8_t frame_skip;         // decode one frame out of (frame_skip + 1)
+    uint8_t trigger_mode;       // only decode while a trigger window is open
+    uint8_t qr_only;            // disable linear barcodes, decodes faster
+} qrcode_params_t;
+
+typedef struct qrcode_result_s {
+    int type;
+    const char *name;
+    const uint8_t *data;        // valid only during the result callback
+    uint32_t len;
+    int quality;
+    int point_cnt;
+    int16_t x[QRCODE_MAX_POINTS];   // corner coordinates in full frame pixels
+    int16_t y[QRCODE_MAX_POINTS];
+} qrcode_result_t;
+
+typedef struct qrcode_stats_s {
+    uint32_t frames;            // frames received
+    uint32_t scanned;           // frames decoded
+    uint32_t decoded;           // symbols found
+    uint32_t last_scan_ms;      // decode time of the last scanned frame
+    uint32_t max_scan_ms;
+} qrcode_stats_t;
+
+mm_context_t *QRCodeInit(void);
+
+mm_context_t *QRCodeDeinit(mm_context_t *p);
+
+int QRCodeSetParams(void *p, qrcode_params_t *params);
+
+int QRCodeSetApply(void *p);
+
+void QRCodeSetDisppost(void *p, void (*qr_postprocess)(qrcode_result_t *, int));
+
+void QRCodeTrigger(void *p, uint32_t window_ms);
+
+int QRCodeGetStats(void *p, qrcode_stats_t *stats);
+
+extern mm_module_t qrcode_module;
+
+#endif
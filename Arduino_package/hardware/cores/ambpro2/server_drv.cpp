@@ -1,5 +1,6 @@
 #include "server_drv.h"
 #include "platform_stdlib.h"
+#include "errno.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,7 +39,7 @@ int ServerDrv::startClientv6(uint32_t *ipv6Address, uint16_t port, uint8_t portM
 }
 #endif
 
-int ServerDrv::startServer(uint16_t port, uint8_t portMode, tBlockingMode blockMode) {
+int ServerDrv::startServer(uint16_t port, uint8_t portMode, tBlockingMode blockMode, int backlog) {
     int sock;
     if (blockMode == BLOCKING_MODE) {
         //printf("\r\n[INFO] %s WiFi server is set to blocking mode \n", __FUNCTION__);
@@ -47,7 +48,7 @@ int ServerDrv::startServer(uint16_t port, uint8_t portMode, tBlockingMode blockM
             if (sock >= 0) {
                 if (portMode == TCP_MODE) {
                     //Make it listen to socket with max 20 connections
-                    sock_listen(sock, 1);
+                    sock_listen(sock, backlog);
                 }
             }
 //        } else {
@@ -67,7 +68,7 @@ int ServerDrv::startServer(uint16_t port, uint8_t portMode, tBlockingMode blockM
             if (sock >= 0) {
                 if (portMode == TCP_MODE) {
                     //Make it listen to socket with max 20 connections
-                    sock_listen(sock, 1);
+                    sock_listen(sock, backlog);
                 }
             }
 //        } else {
@@ -92,6 +93,24 @@ int ServerDrv::getAvailable(int sock) {
 //    }
 }
 
+int ServerDrv::getPeerAddr(int sock, uint32_t *ip, uint16_t *port) {
+    return get_peer_addr(sock, ip, port);
+}
+
+int ServerDrv::selectSockets(const int *socks, uint8_t *events, int count, uint32_t timeout_ms) {
+    return sock_select(socks, events, count, timeout_ms);
+}
+
+// Check a connected socket without blocking: > 0 data waiting, 0 closed by the peer, < 0 nothing yet
+int ServerDrv::peekAvailable(int sock) {
+    uint8_t c;
+
+    if (sock < 0) {
+        return -1;
+    }
+    return get_receive(sock, &c, 1, (ARD_MSG_PEEK | ARD_MSG_DONTWAIT), NULL, NULL);
+}
+
 int ServerDrv::availData(int sock) {
     int ret;
     uint8_t c[1460];
@@ -153,6 +172,14 @@ int ServerDrv::getDataBuf(int sock, uint8_t *_data, uint32_t _dataLen) {
     return ret;
 }
 
+// Receive one whole datagram, the peer is returned to the caller instead of kept in the driver
+int ServerDrv::recvfromData(int sock, uint8_t *data, uint32_t len, bool nonblock, uint32_t *peer_ip, uint16_t *peer_port) {
+    if (sock < 0) {
+        return -1;
+    }
+    return get_receive(sock, data, len, (nonblock ? ARD_MSG_DONTWAIT : 0), peer_ip, peer_port);
+}
+
 int ServerDrv::getLastErrno(int sock) {
     return get_sock_errno(sock);
 }
@@ -177,6 +204,23 @@ bool ServerDrv::sendData(int sock, const uint8_t *data, uint32_t len) {
     return true;
 }
 
+int ServerDrv::sendDataNonBlocking(int sock, const uint8_t *data, uint32_t len) {
+    int ret;
+    int err;
+
+    if (sock < 0) {
+        return -1;
+    }
+
+    ret = send_data(sock, data, len, ARD_MSG_DONTWAIT);
+    if (ret < 0) {
+        // get_sock_errno() reports 0 for sockets already in non-blocking mode
+        err = get_sock_errno(sock);
+        return ((err == 0) || (err == EAGAIN) || (err == EWOULDBLOCK)) ? 0 : -1;
+    }
+    return ret;
+}
+
 bool ServerDrv::sendtoData(int sock, const uint8_t *data, uint32_t len, uint32_t peer_ip, uint16_t peer_port) {
     int ret;
 
@@ -189,7 +233,7 @@ bool ServerDrv::sendtoData(int sock, const uint8_t *data, uint32_t len, uint32_t
 //    } else {
 //        ret = sendto_data_v6(sock, data, len, peer_ip, peer_port);
 //    }
-    if (ret == 0) {
+    if (ret < 0) {
         return false;
     }
 
@@ -27,17 +27,23 @@
 class ServerDrv {
     public:
         int startClient(uint32_t ipAddress, uint16_t port, uint8_t protMode = TCP_MODE, tBlockingMode blockMode = NON_BLOCKING_MODE);
-        int startServer(uint16_t port, uint8_t portMode = TCP_MODE, tBlockingMode blockMode = NON_BLOCKING_MODE);
+        int startServer(uint16_t port, uint8_t portMode = TCP_MODE, tBlockingMode blockMode = NON_BLOCKING_MODE, int backlog = 1);
     //    int startClientv6(uint32_t *ipv6Address, uint16_t port, uint8_t protMode = TCP_MODE);
     //    int startClientV6(const char *ipv6Address, uint16_t port, uint8_t protMode);
         int getAvailable(int sock);
+        int getPeerAddr(int sock, uint32_t *ip, uint16_t *port);
+        int selectSockets(const int *socks, uint8_t *events, int count, uint32_t timeout_ms);
+        int peekAvailable(int sock);
         int availData(int sock);
         bool recvData(int sock, uint8_t *_data, uint32_t _dataLen);
         bool getData(int sock, uint8_t *data, uint8_t peek = 0);
         int getDataBuf(int sock, uint8_t *_data, uint32_t _dataLen);
+        int recvfromData(int sock, uint8_t *data, uint32_t len, bool nonblock, uint32_t *peer_ip, uint16_t *peer_port);
         int getLastErrno(int sock);
         void stopSocket(int sock);
         bool sendData(int sock, const uint8_t *data, uint32_t len);
+        // Returns the bytes taken by the send buffer, 0 if it is full, -1 on error
+        int sendDataNonBlocking(int sock, const uint8_t *data, uint32_t len);
         bool sendtoData(int sock, const uint8_t *data, uint32_t len, uint32_t peer_ip, uint16_t peer_port);
         void getRemoteData(int sock, uint32_t *ip, uint16_t *port);
         int setSockRecvTimeout(int sock, int timeout);
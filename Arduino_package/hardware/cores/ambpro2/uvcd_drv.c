@@ -0,0 +1,327 @@
+#include "uvcd_drv.h"
+#include "mmf2_module.h"
+#include "module_uvcd.h"
+#include "uvc/inc/usbd_uvc_desc.h"
+#include "us_ticker_api.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+// Redefine here since uapi_videodev2.h is not in the Arduino include path
+#define UVCD_FOURCC(a, b, c, d)     ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define UVCD_PIX_FMT_NV12           UVCD_FOURCC('N', 'V', '1', '2')
+#define UVCD_PIX_FMT_MJPEG          UVCD_FOURCC('M', 'J', 'P', 'G')
+#define UVCD_PIX_FMT_H264           UVCD_FOURCC('H', '2', '6', '4')
+
+#define UVCD_FRAME_COUNT            3
+
+typedef struct uvcd_drv_ctx_s {
+    void *parent;
+    uvcd_params_t params;       // format produced by the linked video channel
+    uvcd_params_t host;         // format last committed by the USB host
+    uvcd_stats_t stats;
+    void (*change_cb)(uvcd_params_t *);
+    volatile int running;
+} uvcd_drv_ctx_t;
+
+static uvcd_drv_ctx_t *uvcd_active_ctx = NULL;
+
+//-----------------------------------------------------------------------------
+// Symbols required by the UVC device class in libusbd.a
+
+struct uvc_format *uvc_format_ptr = NULL;
+
+static struct uvc_frame_info uvcd_frames_h264[UVCD_FRAME_COUNT + 1] = {
+    {1920, 1080, {VALUE_FPS(30), 0}},
+    {1280,  720, {VALUE_FPS(30), 0}},
+    { 640,  480, {VALUE_FPS(30), 0}},
+    {0, 0, {0}},
+};
+
+static struct uvc_frame_info uvcd_frames_mjpeg[UVCD_FRAME_COUNT + 1] = {
+    {1920, 1080, {VALUE_FPS(30), 0}},
+    {1280,  720, {VALUE_FPS(30), 0}},
+    { 640,  480, {VALUE_FPS(30), 0}},
+    {0, 0, {0}},
+};
+
+static struct uvc_frame_info uvcd_frames_nv12[UVCD_FRAME_COUNT + 1] = {
+    {1920, 1080, {VALUE_FPS(30), 0}},
+    {1280,  720, {VALUE_FPS(30), 0}},
+    { 640,  480, {VALUE_FPS(30), 0}},
+    {0, 0, {0}},
+};
+
+// Order follows the streaming class descriptors built into libusbd.a
+struct uvc_format_info uvc_formats[] = {
+    {UVCD_PIX_FMT_H264, uvcd_frames_h264},
+    {UVCD_PIX_FMT_MJPEG, uvcd_frames_mjpeg},
+    {UVCD_PIX_FMT_NV12, uvcd_frames_nv12},
+};
+
+//-----------------------------------------------------------------------------
+
+// Advertise the configured resolution first so hosts pick it by default
+static void uvcd_update_frames(uvcd_params_t *params) {
+    struct uvc_frame_info *frames;
+
+    switch (params->format) {
+        case UVCD_FORMAT_H264:
+            frames = uvcd_frames_h264;
+            break;
+        case UVCD_FORMAT_MJPEG:
+            frames = uvcd_frames_mjpeg;
+            break;
+        default:
+            frames = uvcd_frames_nv12;
+            break;
+    }
+    for (int i = 1; i < UVCD_FRAME_COUNT; i++) {
+        if ((frames[i].width == (unsigned int)params->width) && (frames[i].height == (unsigned int)params->height)) {
+            struct uvc_frame_info tmp = frames[0];
+            frames[0] = frames[i];
+            frames[i] = tmp;
+            break;
+        }
+    }
+    frames[0].width = params->width;
+    frames[0].height = params->height;
+    frames[0].intervals[0] = VALUE_FPS(params->fps);
+}
+
+static void uvcd_change_parm_cb(void *ptr) {
+    (void)ptr;
+    uvcd_drv_ctx_t *ctx = uvcd_active_ctx;
+    if ((ctx == NULL) || (uvc_format_ptr == NULL)) {
+        return;
+    }
+    ctx->host.format = uvc_format_ptr->format;
+    ctx->host.width = uvc_format_ptr->width;
+    ctx->host.height = uvc_format_ptr->height;
+    ctx->host.fps = uvc_format_ptr->fps;
+    if (ctx->change_cb) {
+        ctx->change_cb(&ctx->host);
+    }
+}
+
+static int uvcd_host_matches(uvcd_drv_ctx_t *ctx) {
+    // hosts that never sent a commit stream the default (first advertised) format
+    if (ctx->host.format == 0) {
+        return 1;
+    }
+    return ((ctx->host.format == ctx->params.format) && (ctx->host.width == ctx->params.width) && (ctx->host.height == ctx->params.height));
+}
+
+// Hold the encoder buffer until the ISO transfer hands the payload back, so frames are never copied.
+// The payload points into the encoder output, so the item can only go back to StreamIO once the USB
+// stack no longer reads it: a transfer slower than two frame times is counted as late and still
+// waited for. The wait only ends early when the host stops streaming or the device is stopped,
+// after which the ISO endpoint no longer reads the buffer.
+//
+// This blocks the StreamIO task for the transfer time of every frame, about the frame size divided
+// by the ISO bandwidth the host granted plus up to one tick of polling. For H264 and MJPEG frames
+// that is a few ms; an NV12 frame is much larger and can take longer than a frame time, in which
+// case the encoder queue drops frames. wait_avg_us and wait_max_us in the stats report the cost.
+static void uvcd_wait_payload(uvcd_drv_ctx_t *ctx, struct usbd_uvc_buffer *payload) {
+    TickType_t late = pdMS_TO_TICKS((2000 / (ctx->params.fps ? ctx->params.fps : 30)) + 10);
+    TickType_t start = xTaskGetTickCount();
+    uint32_t start_us = us_ticker_read();
+    uint32_t elapsed;
+    int counted = 0;
+
+    while (ctx->running && usbd_uvc_get_status()) {
+        struct usbd_uvc_buffer *done = uvc_video_out_stream_queue();
+        if (done) {
+            uvc_video_put_out_stream_queue(done);
+            if (done == payload) {
+                break;
+            }
+        }
+        if (!counted && ((xTaskGetTickCount() - start) > late)) {
+            ctx->stats.late++;
+            counted = 1;
+        }
+        vTaskDelay(1);
+    }
+
+    elapsed = us_ticker_read() - start_us;
+    if (elapsed > ctx->stats.wait_max_us) {
+        ctx->stats.wait_max_us = elapsed;
+    }
+    if (ctx->stats.wait_avg_us == 0) {
+        ctx->stats.wait_avg_us = elapsed;
+    } else {
+        ctx->stats.wait_avg_us = ctx->stats.wait_avg_us - (ctx->stats.wait_avg_us / 16) + (elapsed / 16);
+    }
+}
+
+int uvcd_handle(void *p, void *input, void *output) {
+    (void)output;
+    uvcd_drv_ctx_t *ctx = (uvcd_drv_ctx_t *)p;
+    mm_queue_item_t *input_item = (mm_queue_item_t *)input;
+    struct usbd_uvc_buffer *payload;
+
+    if (!ctx->running || !usbd_uvc_get_status()) {
+        return 0;
+    }
+    if (!uvcd_host_matches(ctx)) {
+        ctx->stats.mismatched++;
+        return 0;
+    }
+    payload = uvc_video_out_stream_queue();
+    if (payload == NULL) {
+        ctx->stats.dropped++;
+        return 0;
+    }
+    payload->mem = (unsigned char *)input_item->data_addr;
+    payload->bytesused = input_item->size;
+    uvc_video_put_in_stream_queue(payload);
+    ctx->stats.frames++;
+
+    uvcd_wait_payload(ctx, payload);
+    return 0;
+}
+
+int uvcd_control(void *p, int cmd, int arg) {
+    uvcd_drv_ctx_t *ctx = (uvcd_drv_ctx_t *)p;
+
+    switch (cmd) {
+        case CMD_UVCD_SET_PARAMS:
+            memcpy(&ctx->params, (void *)arg, sizeof(uvcd_params_t));
+            break;
+        case CMD_UVCD_GET_HOST_PARAMS:
+            memcpy((void *)arg, &ctx->host, sizeof(uvcd_params_t));
+            break;
+        case CMD_UVCD_SET_CHANGE_CB:
+            ctx->change_cb = (void (*)(uvcd_params_t *))arg;
+            break;
+        case CMD_UVCD_GET_STATS:
+            memcpy((void *)arg, &ctx->stats, sizeof(uvcd_stats_t));
+            break;
+        case CMD_UVCD_START:
+            if (ctx->running) {
+                break;
+            }
+            if (uvc_format_ptr == NULL) {
+                uvc_format_ptr = (struct uvc_format *)malloc(sizeof(struct uvc_format));
+                if (uvc_format_ptr == NULL) {
+                    return -1;
+                }
+                memset(uvc_format_ptr, 0, sizeof(struct uvc_format));
+                rtw_init_sema(&uvc_format_ptr->uvcd_change_sema, 0);
+            }
+            uvc_format_ptr->format = ctx->params.format;
+            uvc_format_ptr->width = ctx->params.width;
+            uvc_format_ptr->height = ctx->params.height;
+            uvc_format_ptr->fps = ctx->params.fps;
+            uvc_format_ptr->isp_format = 1;
+            uvcd_update_frames(&ctx->params);
+            memset(&ctx->host, 0, sizeof(uvcd_params_t));
+            memset(&ctx->stats, 0, sizeof(uvcd_stats_t));
+
+            uvcd_active_ctx = ctx;
+            usbd_uvc_set_change_parm_cb((int)uvcd_change_parm_cb);
+            if (usbd_uvc_init() < 0) {
+                printf("\r\n[ERROR] USB UVC device init failed\n");
+                uvcd_active_ctx = NULL;
+                return -1;
+            }
+            uvc_format_ptr->init = 1;
+            ctx->running = 1;
+            break;
+        case CMD_UVCD_STOP:
+            if (!ctx->running) {
+                break;
+            }
+            // the ISO endpoint stops first, so a handler still waiting on a payload can only
+            // give its encoder buffer back once the USB stack no longer reads it
+            usbd_uvc_stop();
+            ctx->running = 0;
+            usbd_uvc_deinit();
+            uvcd_active_ctx = NULL;
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
+void *uvcd_destroy(void *p) {
+    uvcd_drv_ctx_t *ctx = (uvcd_drv_ctx_t *)p;
+    if (ctx) {
+        uvcd_control(ctx, CMD_UVCD_STOP, 0);
+        free(ctx);
+    }
+    return NULL;
+}
+
+void *uvcd_create(void *parent) {
+    uvcd_drv_ctx_t *ctx = (uvcd_drv_ctx_t *)malloc(sizeof(uvcd_drv_ctx_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(uvcd_drv_ctx_t));
+    ctx->parent = parent;
+    ctx->params.format = UVCD_FORMAT_H264;
+    ctx->params.width = 1920;
+    ctx->params.height = 1080;
+    ctx->params.fps = 30;
+    return ctx;
+}
+
+mm_module_t uvcd_module = {
+    .create = uvcd_create,
+    .destroy = uvcd_destroy,
+    .control = uvcd_control,
+    .handle = uvcd_handle,
+
+    .new_item = NULL,
+    .del_item = NULL,
+
+    .output_type = MM_TYPE_NONE,
+    .module_type = MM_TYPE_VSINK,
+    .name = "UVCD"
+};
+
+//-----------------------------------------------------------------------------
+// Arduino driver interface
+
+mm_context_t *UVCDInit(void) {
+    return mm_module_open(&uvcd_module);
+}
+
+mm_context_t *UVCDDeinit(mm_context_t *p) {
+    return mm_module_close(p);
+}
+
+int UVCDSetParams(void *p, uvcd_params_t *params) {
+    return uvcd_control(p, CMD_UVCD_SET_PARAMS, (int)params);
+}
+
+int UVCDStart(void *p) {
+    return uvcd_control(p, CMD_UVCD_START, 0);
+}
+
+void UVCDStop(void *p) {
+    uvcd_control(p, CMD_UVCD_STOP, 0);
+}
+
+int UVCDGetStatus(void *p) {
+    uvcd_drv_ctx_t *ctx = (uvcd_drv_ctx_t *)p;
+    if (!ctx->running) {
+        return 0;
+    }
+    return usbd_uvc_get_status();
+}
+
+int UVCDGetHostParams(void *p, uvcd_params_t *params) {
+    return uvcd_control(p, CMD_UVCD_GET_HOST_PARAMS, (int)params);
+}
+
+int UVCDGetStats(void *p, uvcd_stats_t *stats) {
+    return uvcd_control(p, CMD_UVCD_GET_STATS, (int)stats);
+}
+
+void UVCDSetChangeCallback(void *p, void (*cb)(uvcd_params_t *)) {
+    uvcd_control(p, CMD_UVCD_SET_CHANGE_CB, (int)cb);
+}
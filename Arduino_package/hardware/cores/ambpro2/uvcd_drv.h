@@ -0,0 +1,51 @@
+#ifndef UVCD_DRV_H
+#define UVCD_DRV_H
+
+#include "mmf2_module.h"
+
+#define CMD_UVCD_SET_PARAMS         MM_MODULE_CMD(0x10)
+#define CMD_UVCD_GET_HOST_PARAMS    MM_MODULE_CMD(0x11)
+#define CMD_UVCD_SET_CHANGE_CB      MM_MODULE_CMD(0x12)
+#define CMD_UVCD_GET_STATS          MM_MODULE_CMD(0x13)
+#define CMD_UVCD_START              MM_MODULE_CMD(0x14)
+
+// Same values as FORMAT_TYPE_xxx in module_uvcd.h
+#define UVCD_FORMAT_NV12            1
+#define UVCD_FORMAT_MJPEG           2
+#define UVCD_FORMAT_H264            3
+
+typedef struct uvcd_params_s {
+    int format;
+    int width;
+    int height;
+    int fps;
+} uvcd_params_t;
+
+typedef struct uvcd_stats_s {
+    uint32_t frames;        // frames handed to the USB stack
+    uint32_t dropped;       // frames skipped, no free USB payload or host not streaming
+    uint32_t mismatched;    // frames skipped, host committed another format or resolution
+    uint32_t late;          // frames whose ISO transfer took longer than two frame times
+    uint32_t wait_avg_us;   // time the StreamIO task waits for a frame's transfer, average over about 16 frames
+    uint32_t wait_max_us;   // longest of those waits
+} uvcd_stats_t;
+
+mm_context_t *UVCDInit(void);
+
+mm_context_t *UVCDDeinit(mm_context_t *p);
+
+int UVCDSetParams(void *p, uvcd_params_t *params);
+
+int UVCDStart(void *p);
+
+void UVCDStop(void *p);
+
+int UVCDGetStatus(void *p);
+
+int UVCDGetHostParams(void *p, uvcd_params_t *params);
+
+int UVCDGetStats(void *p, uvcd_stats_t *stats);
+
+void UVCDSetChangeCallback(void *p, void (*cb)(uvcd_params_t *));
+
+#endif
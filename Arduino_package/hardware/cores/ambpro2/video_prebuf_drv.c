@@ -0,0 +1,299 @@
+#include "video_prebuf_drv.h"
+#include "mmf2_module.h"
+#include "avcodec.h"
+#include "boot_phase.h"
+
+#define VIDEO_PREBUF_ALIGN          32
+#define VIDEO_PREBUF_SCAN_BYTES     256     // parameter sets and SEI ahead of the first slice are short
+
+typedef struct video_prebuf_frame_s {
+    uint32_t offset;            // in the buffer
+    uint32_t size;
+    uint32_t timestamp;
+    uint32_t hw_timestamp;
+    uint32_t type;
+    uint32_t priv_data;
+} video_prebuf_frame_t;
+
+typedef struct video_prebuf_ctx_s {
+    void *parent;
+    video_prebuf_params_t params;
+    video_prebuf_stats_t stats;
+    mm_context_t *outputs[VIDEO_PREBUF_MAX_OUTPUTS];
+    uint8_t output_count;
+
+    uint8_t *buffer;
+    uint32_t used;
+    video_prebuf_frame_t *frames;
+    volatile uint8_t released;
+    uint8_t replayed;
+    uint8_t need_key;           // a frame was lost, skip frames until one decodes on its own
+} video_prebuf_ctx_t;
+
+// H.264 IDR or SPS, H.265 IRAP or VPS/SPS ahead of the first slice. Other formats are all key frames.
+static int video_prebuf_is_key(mm_queue_item_t *item) {
+    const uint8_t *data = (const uint8_t *)item->data_addr;
+    uint32_t len = (item->size < VIDEO_PREBUF_SCAN_BYTES) ? item->size : VIDEO_PREBUF_SCAN_BYTES;
+    uint8_t nal;
+
+    if ((item->type != AV_CODEC_ID_H264) && (item->type != AV_CODEC_ID_H265)) {
+        return 1;
+    }
+    for (uint32_t i = 0; (i + 3) < len; i++) {
+        if ((data[i] != 0) || (data[i + 1] != 0) || (data[i + 2] != 1)) {
+            continue;
+        }
+        if (item->type == AV_CODEC_ID_H264) {
+            nal = data[i + 3] & 0x1F;
+            if ((nal == 5) || (nal == 7)) {
+                return 1;
+            }
+            if ((nal >= 1) && (nal <= 4)) {
+                return 0;
+            }
+        } else {
+            nal = (data[i + 3] >> 1) & 0x3F;
+            if (((nal >= 16) && (nal <= 21)) || (nal == 32) || (nal == 33)) {
+                return 1;
+            }
+            if (nal <= 9) {
+                return 0;
+            }
+        }
+        i += 3;
+    }
+    return 0;
+}
+
+// Outputs take frames the way a linked sink does, the data is only valid until handle returns
+static void video_prebuf_forward(video_prebuf_ctx_t *ctx, mm_queue_item_t *item) {
+    mm_context_t *output;
+
+    for (int i = 0; i < ctx->output_count; i++) {
+        output = ctx->outputs[i];
+        if ((output == NULL) || (output->module == NULL) || (output->module->handle == NULL)) {
+            continue;
+        }
+        output->module->handle(output->priv, item, NULL);
+    }
+}
+
+// Keep the earliest frames, the start of an event matters more than its middle
+static void video_prebuf_store(video_prebuf_ctx_t *ctx, mm_queue_item_t *input_item, int key) {
+    uint32_t size = (input_item->size + VIDEO_PREBUF_ALIGN - 1) & ~(VIDEO_PREBUF_ALIGN - 1);
+    video_prebuf_frame_t *frame;
+
+    if (ctx->need_key && !key) {
+        ctx->stats.dropped++;
+        return;
+    }
+    if ((ctx->stats.buffered >= ctx->params.buffer_frames) || ((ctx->used + size) > ctx->params.buffer_bytes)) {
+        ctx->stats.dropped++;
+        ctx->need_key = 1;
+        return;
+    }
+    frame = &ctx->frames[ctx->stats.buffered];
+    frame->offset = ctx->used;
+    frame->size = input_item->size;
+    frame->timestamp = input_item->timestamp;
+    frame->hw_timestamp = input_item->hw_timestamp;
+    frame->type = input_item->type;
+    frame->priv_data = input_item->priv_data;
+    memcpy(&ctx->buffer[ctx->used], (void *)input_item->data_addr, input_item->size);
+    ctx->used += size;
+    if (ctx->used > ctx->stats.buffer_peak) {
+        ctx->stats.buffer_peak = ctx->used;
+    }
+    ctx->stats.buffered++;
+    ctx->need_key = 0;
+}
+
+static void video_prebuf_free(video_prebuf_ctx_t *ctx) {
+    free(ctx->buffer);
+    ctx->buffer = NULL;
+    free(ctx->frames);
+    ctx->frames = NULL;
+    ctx->used = 0;
+    ctx->stats.buffered = 0;
+}
+
+// Runs in the stream task with the first frame after release, so live frames wait behind the replay
+static void video_prebuf_replay(video_prebuf_ctx_t *ctx) {
+    uint32_t start = bootTime();
+    video_prebuf_frame_t *frame;
+    mm_queue_item_t item;
+
+    // frames keep their original timestamps, the outputs see them as they were captured
+    for (uint32_t i = 0; i < ctx->stats.buffered; i++) {
+        frame = &ctx->frames[i];
+        memset(&item, 0, sizeof(mm_queue_item_t));
+        item.data_addr = (uint32_t)&ctx->buffer[frame->offset];
+        item.size = frame->size;
+        item.timestamp = frame->timestamp;
+        item.hw_timestamp = frame->hw_timestamp;
+        item.type = frame->type;
+        item.priv_data = frame->priv_data;
+        video_prebuf_forward(ctx, &item);
+        ctx->stats.replayed++;
+    }
+    ctx->stats.replay_us = bootTime() - start;
+    // the buffer is only needed until the outputs are ready, give the memory back
+    video_prebuf_free(ctx);
+    ctx->replayed = 1;
+}
+
+int video_prebuf_handle(void *p, void *input, void *output) {
+    (void)output;
+    video_prebuf_ctx_t *ctx = (video_prebuf_ctx_t *)p;
+    mm_queue_item_t *input_item = (mm_queue_item_t *)input;
+    int key;
+
+    if ((ctx->frames == NULL) && !ctx->replayed) {
+        return 0;
+    }
+    if (ctx->stats.frames++ == 0) {
+        bootMark("first_frame");
+        ctx->stats.first_frame_us = bootTime();
+    }
+    key = video_prebuf_is_key(input_item);
+    if (!ctx->released) {
+        video_prebuf_store(ctx, input_item, key);
+        return 0;
+    }
+    if (!ctx->replayed) {
+        video_prebuf_replay(ctx);
+    }
+    if (ctx->need_key) {
+        if (!key) {
+            ctx->stats.dropped++;
+            return 0;
+        }
+        ctx->need_key = 0;
+    }
+    video_prebuf_forward(ctx, input_item);
+    ctx->stats.forwarded++;
+    return 0;
+}
+
+int video_prebuf_control(void *p, int cmd, int arg) {
+    video_prebuf_ctx_t *ctx = (video_prebuf_ctx_t *)p;
+
+    switch (cmd) {
+        case CMD_VIDEO_PREBUF_SET_PARAMS:
+            memcpy(&ctx->params, (void *)arg, sizeof(video_prebuf_params_t));
+            break;
+        case CMD_VIDEO_PREBUF_GET_PARAMS:
+            memcpy((void *)arg, &ctx->params, sizeof(video_prebuf_params_t));
+            break;
+        case CMD_VIDEO_PREBUF_ADD_OUTPUT:
+            if (ctx->released) {
+                printf("\r\n[ERROR] Video prebuffer outputs have to be added before release\n");
+                return -1;
+            }
+            if (ctx->output_count >= VIDEO_PREBUF_MAX_OUTPUTS) {
+                printf("\r\n[ERROR] Video prebuffer supports up to %d outputs\n", VIDEO_PREBUF_MAX_OUTPUTS);
+                return -1;
+            }
+            ctx->outputs[ctx->output_count++] = (mm_context_t *)arg;
+            break;
+        case CMD_VIDEO_PREBUF_RELEASE:
+            if (!ctx->released) {
+                ctx->stats.release_us = bootTime();
+                ctx->released = 1;
+            }
+            break;
+        case CMD_VIDEO_PREBUF_GET_STATS:
+            memcpy((void *)arg, &ctx->stats, sizeof(video_prebuf_stats_t));
+            break;
+        case CMD_VIDEO_PREBUF_APPLY: {
+            video_prebuf_params_t *params = &ctx->params;
+            video_prebuf_free(ctx);
+            if ((params->buffer_frames == 0) || (params->buffer_frames > VIDEO_PREBUF_MAX_FRAMES) || (params->buffer_bytes == 0)) {
+                printf("\r\n[ERROR] Video prebuffer of %lu bytes, %u frames is invalid\n", params->buffer_bytes, params->buffer_frames);
+                return -1;
+            }
+            ctx->buffer = (uint8_t *)malloc(params->buffer_bytes);
+            ctx->frames = (video_prebuf_frame_t *)malloc(params->buffer_frames * sizeof(video_prebuf_frame_t));
+            if ((ctx->buffer == NULL) || (ctx->frames == NULL)) {
+                printf("\r\n[ERROR] Video prebuffer allocation of %lu bytes failed\n", params->buffer_bytes);
+                video_prebuf_free(ctx);
+                return -1;
+            }
+            // the first frame of the encoder is a key frame, anything else cannot start the buffer
+            ctx->need_key = 1;
+            ctx->released = 0;
+            ctx->replayed = 0;
+            memset(&ctx->stats, 0, sizeof(video_prebuf_stats_t));
+            break;
+        }
+        default:
+            break;
+    }
+    return 0;
+}
+
+void *video_prebuf_destroy(void *p) {
+    video_prebuf_ctx_t *ctx = (video_prebuf_ctx_t *)p;
+    if (ctx) {
+        video_prebuf_free(ctx);
+        free(ctx);
+    }
+    return NULL;
+}
+
+void *video_prebuf_create(void *parent) {
+    video_prebuf_ctx_t *ctx = (video_prebuf_ctx_t *)malloc(sizeof(video_prebuf_ctx_t));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(video_prebuf_ctx_t));
+    ctx->parent = parent;
+    ctx->params.buffer_bytes = 2 * 1024 * 1024;
+    ctx->params.buffer_frames = 90;
+    return ctx;
+}
+
+mm_module_t video_prebuf_module = {
+    .create = video_prebuf_create,
+    .destroy = video_prebuf_destroy,
+    .control = video_prebuf_control,
+    .handle = video_prebuf_handle,
+
+    .new_item = NULL,
+    .del_item = NULL,
+
+    .output_type = MM_TYPE_NONE,
+    .module_type = MM_TYPE_VSINK,
+    .name = "VPREBUF"
+};
+
+//-----------------------------------------------------------------------------
+// Arduino driver interface
+
+mm_context_t *VideoPrebufInit(void) {
+    return mm_module_open(&video_prebuf_module);
+}
+
+mm_context_t *VideoPrebufDeinit(mm_context_t *p) {
+    return mm_module_close(p);
+}
+
+int VideoPrebufSetParams(void *p, video_prebuf_params_t *params) {
+    return video_prebuf_control(p, CMD_VIDEO_PREBUF_SET_PARAMS, (int)params);
+}
+
+int VideoPrebufSetApply(void *p) {
+    return video_prebuf_control(p, CMD_VIDEO_PREBUF_APPLY, 0);
+}
+
+int VideoPrebufAddOutput(void *p, mm_context_t *output) {
+    return video_prebuf_control(p, CMD_VIDEO_PREBUF_ADD_OUTPUT, (int)output);
+}
+
+void VideoPrebufRelease(void *p) {
+    video_prebuf_control(p, CMD_VIDEO_PREBUF_RELEASE, 0);
+}
+
+int VideoPrebufGetStats(void *p, video_prebuf_stats_t *stats) {
+    return video_prebuf_control(p, CMD_VIDEO_PREBUF_GET_STATS, (int)stats);
+}
@@ -0,0 +1,52 @@
+#ifndef VIDEO_PREBUF_DRV_H
+#define VIDEO_PREBUF_DRV_H
+
+#include "mmf2_module.h"
+
+#define CMD_VIDEO_PREBUF_SET_PARAMS     MM_MODULE_CMD(0x00)
+#define CMD_VIDEO_PREBUF_GET_PARAMS     MM_MODULE_CMD(0x01)
+#define CMD_VIDEO_PREBUF_ADD_OUTPUT     MM_MODULE_CMD(0x02)
+#define CMD_VIDEO_PREBUF_RELEASE        MM_MODULE_CMD(0x03)
+#define CMD_VIDEO_PREBUF_GET_STATS      MM_MODULE_CMD(0x04)
+#define CMD_VIDEO_PREBUF_APPLY          MM_MODULE_CMD(0x20)
+
+#define VIDEO_PREBUF_MAX_OUTPUTS        4
+#define VIDEO_PREBUF_MAX_FRAMES         256
+
+typedef struct video_prebuf_params_s {
+    uint32_t buffer_bytes;      // frame data held until release
+    uint16_t buffer_frames;     // frames held until release, up to VIDEO_PREBUF_MAX_FRAMES
+} video_prebuf_params_t;
+
+typedef struct video_prebuf_stats_s {
+    uint32_t frames;            // frames received
+    uint32_t buffered;          // frames waiting for release
+    uint32_t buffer_peak;       // most buffer bytes in use
+    uint32_t replayed;          // buffered frames passed to the outputs at release
+    uint32_t forwarded;         // frames passed to the outputs after release
+    uint32_t dropped;           // frames lost to a full buffer or skipped until the next key frame
+    uint32_t first_frame_us;    // first frame, in us since reset
+    uint32_t release_us;        // release, in us since reset
+    uint32_t replay_us;         // time the outputs took to take the buffered frames
+} video_prebuf_stats_t;
+
+mm_context_t *VideoPrebufInit(void);
+
+mm_context_t *VideoPrebufDeinit(mm_context_t *p);
+
+int VideoPrebufSetParams(void *p, video_prebuf_params_t *params);
+
+// Allocate the buffer and start holding frames
+int VideoPrebufSetApply(void *p);
+
+// Module context that receives the frames once released, its handle runs in the stream task
+int VideoPrebufAddOutput(void *p, mm_context_t *output);
+
+// Pass the buffered frames to the outputs with the next frame, then every frame as it arrives
+void VideoPrebufRelease(void *p);
+
+int VideoPrebufGetStats(void *p, video_prebuf_stats_t *stats);
+
+extern mm_module_t video_prebuf_module;
+
+#endif
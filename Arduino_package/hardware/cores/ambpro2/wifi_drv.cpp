@@ -22,8 +22,13 @@ extern "C" {
 // modifed here
 #include "lwip/netif.h"
 #include "lwip/api.h"
+#include "lwip/dhcp.h"
+#include "lwip/prot/dhcp.h"
+#include "lwip/tcpip.h"
 #include <dhcp/dhcps.h>
 #include "ard_socket.h"
+#include "dns_cache_drv.h"
+#include "kv.h"
 
 extern struct netif xnetif[NET_IF_NUM];
 #ifdef __cplusplus
@@ -59,6 +64,30 @@ bool WiFiDrv::_useStaticIp = false;
 char WiFiDrv::_hostname[HOSTNAME_LEN+1] = {0};
 uint8_t arduino_wifi_mode_check = 0x00;
 
+// Fast connect keeps the last AP and its derived PSK in flash so a reboot or
+// wake from deep sleep can join on a single channel without the 4096 round
+// PBKDF2, and request the previous DHCP address directly (INIT-REBOOT)
+#define FAST_CONNECT_KV_KEY         "wlan_fast_connect"
+#define FAST_CONNECT_MAGIC          0x31434657      // "WFC1"
+#define FAST_CONNECT_DHCP_TIMEOUT   1500            // ms to wait for the INIT-REBOOT ACK
+
+typedef struct wifi_fast_connect_s {
+    uint32_t magic;
+    uint8_t ssid[33];
+    uint8_t ssid_len;
+    uint8_t bssid[ETH_ALEN];
+    uint8_t channel;
+    uint32_t security_type;
+    struct psk_info psk;
+    uint32_t ip;
+    uint32_t crc;
+} wifi_fast_connect_t;
+
+static bool fast_connect_enabled = false;
+static bool fast_connect_reuse_lease = false;
+static bool fast_connect_loaded = false;
+static wifi_fast_connect_t fast_connect_data;
+
 static void init_wifi_struct(void) {
     memset(wifi.ssid.val, 0, sizeof(wifi.ssid.val));
     memset(wifi.bssid.octet, 0, ETH_ALEN);
@@ -67,6 +96,8 @@ static void init_wifi_struct(void) {
     wifi.password = NULL;
     wifi.password_len = 0;
     wifi.key_id = -1;
+    wifi.channel = 0;
+    wifi.pscan_option = 0;
     memset(ap.ssid.val, 0, sizeof(ap.ssid.val));
     ap.ssid.len = 0;
     ap.password = NULL;
@@ -74,6 +105,106 @@ static void init_wifi_struct(void) {
     ap.channel = 1;
 }
 
+static uint32_t fast_connect_crc(const wifi_fast_connect_t* data) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t hash = 2166136261UL;
+    for (uint32_t i = 0; i < offsetof(wifi_fast_connect_t, crc); i++) {
+        hash = (hash ^ p[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+static bool fast_connect_load(void) {
+    if (!fast_connect_loaded) {
+        rt_kv_init();
+        if (rt_kv_get(FAST_CONNECT_KV_KEY, &fast_connect_data, sizeof(fast_connect_data)) != (int32_t)sizeof(fast_connect_data)) {
+            memset(&fast_connect_data, 0, sizeof(fast_connect_data));
+        }
+        fast_connect_loaded = true;
+    }
+    return ((fast_connect_data.magic == FAST_CONNECT_MAGIC) && (fast_connect_data.crc == fast_connect_crc(&fast_connect_data)));
+}
+
+// Use the cached AP only if it was saved for the same SSID and passphrase
+static bool fast_connect_prepare(char* ssid, uint8_t ssid_len, const char* passphrase, uint8_t len) {
+    if ((!fast_connect_enabled) || (!fast_connect_load())) {
+        return false;
+    }
+    if ((fast_connect_data.ssid_len != ssid_len) || (memcmp(fast_connect_data.ssid, ssid, ssid_len) != 0)) {
+        return false;
+    }
+    if ((strlen((const char*)fast_connect_data.psk.psk_passphrase) != len) || (memcmp(fast_connect_data.psk.psk_passphrase, passphrase, len) != 0)) {
+        return false;
+    }
+    memcpy(wifi.bssid.octet, fast_connect_data.bssid, ETH_ALEN);
+    wifi.channel = fast_connect_data.channel;
+    wifi.pscan_option = PSCAN_FAST_SURVEY;
+    wifi.security_type = (rtw_security_t)fast_connect_data.security_type;
+    wifi_psk_info_set(&fast_connect_data.psk);
+    return true;
+}
+
+static void fast_connect_save(char* ssid, uint8_t ssid_len, bool static_ip) {
+    rtw_wifi_setting_t setting;
+    wifi_fast_connect_t data;
+
+    if ((!fast_connect_enabled) || (wifi_get_setting(WLAN0_IDX, &setting) != RTW_SUCCESS)) {
+        return;
+    }
+    fast_connect_load();
+    memset(&data, 0, sizeof(data));
+    data.magic = FAST_CONNECT_MAGIC;
+    memcpy(data.ssid, ssid, ssid_len);
+    data.ssid_len = ssid_len;
+    memcpy(data.bssid, setting.bssid, ETH_ALEN);
+    data.channel = setting.channel;
+    data.security_type = setting.security_type;
+    wifi_psk_info_get(&data.psk);
+    if (!static_ip) {
+        memcpy(&data.ip, LwIP_GetIP(0), sizeof(data.ip));
+    }
+    data.crc = fast_connect_crc(&data);
+
+    // skip the flash write when nothing changed, which is the normal case on every wake
+    if (memcmp(&data, &fast_connect_data, sizeof(data)) == 0) {
+        return;
+    }
+    if (rt_kv_set(FAST_CONNECT_KV_KEY, &data, sizeof(data)) == (int32_t)sizeof(data)) {
+        memcpy(&fast_connect_data, &data, sizeof(data));
+    }
+}
+
+static void fast_connect_dhcp_reboot(void* ctx) {
+    (void)ctx;
+    struct netif* pnetif = &xnetif[0];
+
+    if (dhcp_start(pnetif) != ERR_OK) {
+        return;
+    }
+    struct dhcp* dhcp = netif_dhcp_data(pnetif);
+    ip4_addr_set_u32(&dhcp->offered_ip_addr, fast_connect_data.ip);
+    // a lease that is still considered bound is re-requested with INIT-REBOOT
+    dhcp->state = DHCP_STATE_BOUND;
+    dhcp_network_changed(pnetif);
+}
+
+// Request the cached address again, full DHCP is only used if the server does not ACK it
+static bool fast_connect_dhcp(void) {
+    if ((!fast_connect_reuse_lease) || (fast_connect_data.ip == 0)) {
+        return false;
+    }
+    if (tcpip_callback(fast_connect_dhcp_reboot, NULL) != ERR_OK) {
+        return false;
+    }
+    for (uint32_t waited = 0; waited < FAST_CONNECT_DHCP_TIMEOUT; waited += 10) {
+        if (dhcp_supplied_address(&xnetif[0])) {
+            return true;
+        }
+        vTaskDelay(10);
+    }
+    return false;
+}
+
 void WiFiDrv::wifiDriverInit() {
     if (arduino_wifi_mode_check == 0x11) {
         if (init_wlan == false) {
@@ -182,6 +313,7 @@ int8_t WiFiDrv::wifiSetNetwork(char* ssid, uint8_t ssid_len) {
 int8_t WiFiDrv::wifiSetPassphrase(char* ssid, uint8_t ssid_len, const char* passphrase, const uint8_t len) {
     int ret;
     uint8_t dhcp_result;
+    bool fast;
 
     memset(wifi.bssid.octet, 0, ETH_ALEN);
     memcpy(wifi.ssid.val, ssid, ssid_len);
@@ -196,7 +328,17 @@ int8_t WiFiDrv::wifiSetPassphrase(char* ssid, uint8_t ssid_len, const char* pass
     wifi.password_len = len;
     wifi.key_id = 0;
 
+    fast = fast_connect_prepare(ssid, ssid_len, passphrase, len);
     ret = wifi_connect(&wifi, 1);
+    if ((ret != RTW_SUCCESS) && fast) {
+        // AP moved to another channel or changed security, fall back to a full scan
+        fast = false;
+        memset(wifi.bssid.octet, 0, ETH_ALEN);
+        wifi.channel = 0;
+        wifi.pscan_option = 0;
+        wifi.security_type = RTW_SECURITY_WPA2_AES_PSK;
+        ret = wifi_connect(&wifi, 1);
+    }
 
     if (ret == RTW_SUCCESS) {
         init_wifi_struct();
@@ -212,6 +354,7 @@ int8_t WiFiDrv::wifiSetPassphrase(char* ssid, uint8_t ssid_len, const char* pass
                 IP4_ADDR(ip_2_ip4(&netmask), _arduinoNetmaskAddr[0], _arduinoNetmaskAddr[1], _arduinoNetmaskAddr[2], _arduinoNetmaskAddr[3]);
                 IP4_ADDR(ip_2_ip4(&gw), _arduinoGwAddr[0], _arduinoGwAddr[1], _arduinoGwAddr[2], _arduinoGwAddr[3]);
                 netif_set_addr(pnetif, ip_2_ip4(&ipaddr), ip_2_ip4(&netmask), ip_2_ip4(&gw));
+                fast_connect_save(ssid, ssid_len, true);
 //            } else {
 //                printf("\r\n[INFO] IPv6 is enabled\n");
 //                IP6_ADDR(ip_2_ip6(&ipaddr), _arduinoIpAddr[0], _arduinoIpAddr[1], _arduinoIpAddr[2], _arduinoIpAddr[3]);
@@ -223,8 +366,13 @@ int8_t WiFiDrv::wifiSetPassphrase(char* ssid, uint8_t ssid_len, const char* pass
             return WL_SUCCESS;
         } else {
             netif_set_hostname(&xnetif[0], getHostname());
+            if (fast && fast_connect_dhcp()) {
+                fast_connect_save(ssid, ssid_len, false);
+                return WL_SUCCESS;
+            }
             dhcp_result = LwIP_DHCP(0, DHCP_START);
             if (dhcp_result == DHCP_ADDRESS_ASSIGNED) {
+                fast_connect_save(ssid, ssid_len, false);
                 return WL_SUCCESS;
             } else {
                 wifi_disconnect();
@@ -629,13 +777,13 @@ char* WiFiDrv::getFwVersion() {
 }
 
 int WiFiDrv::getHostByName(const char* aHostname, IPAddress& aResult) {
-    ip_addr_t ip_addr;
-    err_t err;
-    err = netconn_gethostbyname_addrtype(aHostname, &ip_addr, NETCONN_DNS_IPV4);
-    if (err != ERR_OK) {
+    uint32_t ip;
+
+    // cached answers return straight away, misses query the DNS servers
+    if (DnsCacheResolve(aHostname, &ip, DNS_CACHE_TIMEOUT) != DNS_CACHE_OK) {
         return WL_FAILURE;
     } else {
-        aResult = ip_addr.u_addr.ip4.addr;
+        aResult = ip;
         return WL_SUCCESS;
     }
 }
@@ -671,6 +819,18 @@ int WiFiDrv::getHostByNamev6(const char* aHostname, IPv6Address& aResult) {
 }
 #endif 
 
+void WiFiDrv::fastConnectEnable(bool enable, bool reuse_lease) {
+    fast_connect_enabled = enable;
+    fast_connect_reuse_lease = reuse_lease;
+}
+
+void WiFiDrv::fastConnectClear(void) {
+    rt_kv_init();
+    rt_kv_delete(FAST_CONNECT_KV_KEY);
+    memset(&fast_connect_data, 0, sizeof(fast_connect_data));
+    fast_connect_loaded = true;
+}
+
 int WiFiDrv::disablePowerSave() {
     return wifi_set_powersave_mode(1, 1);
 }
@@ -290,6 +290,19 @@ class WiFiDrv {
 
         static int disablePowerSave();
 
+        /*
+         * Cache the AP channel, BSSID, derived PSK and DHCP address in flash
+         * and use them to reconnect without a full scan on the next begin()
+         * param enable: use and update the cached connection info
+         * param reuse_lease: request the previous DHCP address with INIT-REBOOT
+         */
+        static void fastConnectEnable(bool enable, bool reuse_lease);
+
+        /*
+         * Erase the cached connection info
+         */
+        static void fastConnectClear(void);
+
 //        static int getIPv6Status();
 
         static void setHostname(const char* hostname);
@@ -59,6 +59,35 @@ extern uint32_t micros(void);
 extern void delay(uint32_t dwMs);
 extern void delayMicroseconds(uint32_t usec);
 
+/**
+ * \brief Let the main task sleep between two loop() calls instead of calling loop() back to back.
+ *
+ * After each loop() the main task blocks until loopWakeup() is called, the deadline set by
+ * loopWakeAfter() passes, or timeout ms have gone by, whichever comes first. Serial receive
+ * interrupts and BLE write and notification callbacks call loopWakeup().
+ *
+ * \param timeout longest sleep in ms, 0xFFFFFFFF to only wake on events and deadlines
+ */
+extern void loopSleepEnable(uint32_t timeout);
+
+/**
+ * \brief Go back to calling loop() back to back.
+ */
+extern void loopSleepDisable(void);
+
+/**
+ * \brief Wake the main task if it sleeps between two loop() calls. Can be called from interrupts.
+ */
+extern void loopWakeup(void);
+
+/**
+ * \brief Wake the main task at the latest ms from now. The earliest pending deadline is kept
+ * and is cleared once it has passed.
+ *
+ * \param ms the number of milliseconds from now (uint32_t)
+ */
+extern void loopWakeAfter(uint32_t ms);
+
 #ifdef __cplusplus
 }
 #endif
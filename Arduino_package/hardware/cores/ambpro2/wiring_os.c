@@ -8,6 +8,7 @@ extern "C" {
 #include "cmsis_os.h"
 
 extern size_t xPortGetFreeHeapSize(void);
+extern size_t xPortGetMinimumEverFreeHeapSize(void);
 
 uint32_t os_thread_create_arduino(void(* task)(const void *argument), void *argument, int priority, uint32_t stack_size) {
 
@@ -118,6 +119,10 @@ size_t os_get_free_heap_size_arduino(void) {
     return xPortGetFreeHeapSize();
 }
 
+size_t os_get_minimum_free_heap_size_arduino(void) {
+    return xPortGetMinimumEverFreeHeapSize();
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -314,6 +314,14 @@ extern uint32_t os_semaphore_delete_arduino(uint32_t semaphore_id);
  */
 extern size_t os_get_free_heap_size_arduino(void);
 
+/**
+ * @ingroup os_dep_api
+ * @brief get the lowest free heap size seen since boot
+ *
+ * @return minimum ever free heap size
+ */
+extern size_t os_get_minimum_free_heap_size_arduino(void);
+
 #ifdef __cplusplus
 }
 #endif
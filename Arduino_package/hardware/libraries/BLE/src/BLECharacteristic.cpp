@@ -479,6 +479,8 @@ T_APP_RESULT BLECharacteristic::charAttrWriteCallbackDefault(uint8_t conn_id, T_
     if (_pWriteCB != nullptr) {
         _pWriteCB(this, conn_id);
     }
+    // let a sleeping loop() pick up the new value
+    loopWakeup();
 
     return cause;
 }
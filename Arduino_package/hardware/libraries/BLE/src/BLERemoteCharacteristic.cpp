@@ -287,6 +287,7 @@ T_APP_RESULT BLERemoteCharacteristic::clientNotifyIndicateCallbackDefault(uint8_
         if (_pNotifCB != nullptr) {
             _pNotifCB(this, p_value, value_size);
         }
+        loopWakeup();
     }
     return APP_RESULT_SUCCESS;
     (void)conn_id;
@@ -0,0 +1,98 @@
+/*
+ This example runs a CoAP server with three resources:
+
+   coap://<board IP>/uptime     observable, a notification every 5 seconds
+   coap://<board IP>/led        PUT "1" or "0" to switch the LED
+   coap://<board IP>/snapshot   the latest camera JPEG, served block-wise
+
+ Try it with libcoap's coap-client:
+   coap-client -m get -s 60 coap://<board IP>/uptime
+   coap-client -m put -e 1 coap://<board IP>/led
+   coap-client -m get -b 1024 coap://<board IP>/snapshot > snapshot.jpg
+ */
+
+#include "WiFi.h"
+#include "VideoStream.h"
+#include "CoAP.h"
+
+#define CHANNEL 0
+#define SNAPSHOT_INTERVAL 10000
+
+VideoSetting config(VIDEO_VGA, 10, VIDEO_JPEG, 1);
+CoAPServer coap(COAP_DEFAULT_PORT);
+
+char ssid[] = "Network_SSID";   // your network SSID (name)
+char pass[] = "Password";       // your network password
+int status = WL_IDLE_STATUS;
+
+uint32_t lastUptime = 0;
+uint32_t lastSnapshot = 0;
+uint32_t lastInfo = 0;
+
+uint8_t ledHandler(CoAPRequest& request) {
+    if (request.method == COAP_GET) {
+        return 0;
+    }
+    if ((request.method != COAP_PUT) || (request.length != 1)) {
+        return COAP_BAD_REQUEST;
+    }
+    digitalWrite(LED_BUILTIN, (request.payload[0] == '1') ? HIGH : LOW);
+    coap.setValue("led", ((request.payload[0] == '1') ? "1" : "0"));
+    return COAP_CHANGED;
+}
+
+void setup() {
+    Serial.begin(115200);
+    pinMode(LED_BUILTIN, OUTPUT);
+
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to WPA SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+        delay(2000);
+    }
+
+    Camera.configVideoChannel(CHANNEL, config);
+    Camera.videoInit();
+    Camera.channelBegin(CHANNEL);
+
+    coap.addResource("uptime", NULL, true);
+    coap.addResource("led", ledHandler, true);
+    coap.addResource("snapshot");
+    coap.setValue("led", "0");
+    // snapshots are far larger than a datagram and go out in 1024 byte blocks
+    coap.setBlockSize(1024);
+    if (!coap.begin()) {
+        Serial.println("CoAP server start failed");
+    }
+
+    Serial.print("CoAP server on coap://");
+    Serial.println(WiFi.localIP());
+}
+
+void loop() {
+    char uptime[16];
+    uint32_t addr = 0;
+    uint32_t len = 0;
+
+    coap.loop();
+
+    if ((millis() - lastUptime) >= 5000) {
+        lastUptime = millis();
+        snprintf(uptime, sizeof(uptime), "%lu", (millis() / 1000));
+        coap.setValue("uptime", uptime);
+    }
+    // a copy is kept so that every block of a transfer comes from the same picture
+    if ((millis() - lastSnapshot) >= SNAPSHOT_INTERVAL) {
+        lastSnapshot = millis();
+        Camera.getImage(CHANNEL, &addr, &len);
+        if (len > 0) {
+            coap.setValue("snapshot", (const uint8_t*)addr, len, COAP_FORMAT_JPEG);
+        }
+    }
+    if ((millis() - lastInfo) >= 30000) {
+        lastInfo = millis();
+        coap.printInfo();
+    }
+    delay(5);
+}
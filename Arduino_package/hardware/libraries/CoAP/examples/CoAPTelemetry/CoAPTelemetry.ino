@@ -0,0 +1,91 @@
+/*
+ This example reports telemetry to a CoAP server over DTLS with a
+ pre-shared key, and follows a configuration resource with Observe.
+
+ Readings are sent as non-confirmable PUTs: one small datagram each, no
+ connection to keep alive and no acknowledgement to wait for. The
+ configuration is observed, so the server pushes a change as soon as it
+ happens instead of the node polling for it.
+
+ To test without DTLS, remove the setPSK() call and use COAP_DEFAULT_PORT.
+ */
+
+#include <WiFi.h>
+#include <CoAP.h>
+
+char ssid[] = "Network_SSID";       // your network SSID (name)
+char pass[] = "Password";           // your network password
+int status = WL_IDLE_STATUS;        // Indicater of Wifi status
+
+char server[] = "coap.example.com";
+const char* pskIdentity = "node-01";
+const char* pskKey = "000102030405060708090a0b0c0d0e0f";    // hex
+
+CoAPClient coap;
+uint32_t reportInterval = 10000;
+uint32_t lastReport = 0;
+
+void onResponse(CoAPResponse& response) {
+    if (response.status != COAP_STATUS_OK) {
+        Serial.print(response.uri);
+        Serial.print(" failed: ");
+        Serial.println(response.status);
+        return;
+    }
+    if (response.notification) {
+        // e.g. "30000", the new report interval in ms
+        char value[16] = {0};
+        if (response.length < sizeof(value)) {
+            memcpy(value, response.payload, response.length);
+        }
+        reportInterval = atol(value);
+        if (reportInterval < 1000) {
+            reportInterval = 1000;
+        }
+        Serial.print("Report interval is now ");
+        Serial.println(reportInterval);
+    } else {
+        Serial.print(response.uri);
+        Serial.print(" answered ");
+        Serial.print(response.code >> 5);
+        Serial.print(".");
+        Serial.println(response.code & 0x1F);
+    }
+}
+
+void connectCoAP() {
+    while (!coap.begin()) {
+        Serial.println("CoAP connection failed, retrying in 5 seconds");
+        delay(5000);
+    }
+    Serial.println("CoAP connected");
+    coap.observe("config/interval");
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+        delay(2000);
+    }
+
+    coap.setServer(server, COAPS_DEFAULT_PORT).setCallback(onResponse).setPSK(pskIdentity, pskKey);
+    connectCoAP();
+}
+
+void loop() {
+    char json[64];
+
+    if (!coap.loop()) {
+        connectCoAP();
+    }
+    if ((millis() - lastReport) >= reportInterval) {
+        lastReport = millis();
+        snprintf(json, sizeof(json), "{\"uptime\":%lu,\"rssi\":%ld}", (millis() / 1000), WiFi.RSSI());
+        coap.put("sensors/node-01", (const uint8_t*)json, strlen(json), COAP_FORMAT_JSON, false);
+    }
+    delay(10);
+}
@@ -0,0 +1,10 @@
+#ifndef CoAP_h
+#define CoAP_h
+
+// CoAP (RFC 7252) over UDP with Observe (RFC 7641) and block-wise transfer (RFC 7959),
+// the client also speaks DTLS 1.2 with a pre-shared key
+#include "CoAPPacket.h"
+#include "CoAPClient.h"
+#include "CoAPServer.h"
+
+#endif
@@ -0,0 +1,777 @@
+#include "CoAPClient.h"
+#include "WiFi.h"
+
+// Datagrams handled per loop() call, the rest wait for the next call
+#define COAP_LOOP_MAX_PACKETS   8
+
+CoAPClient::CoAPClient() {
+    _domain = NULL;
+    _port = COAP_DEFAULT_PORT;
+    callback = NULL;
+    _socket = -1;
+    _secure = false;
+    _pskIdentity[0] = '\0';
+    _pskLength = 0;
+    _rxBuffer = NULL;
+    _txBuffer = NULL;
+    memset(_requests, 0, sizeof(_requests));
+    _nextId = 1;
+    _nextMessageId = rand() & 0xFFFF;
+    _recentIndex = 0;
+    _recentCount = 0;
+    _szx = COAP_BLOCK_SZX_MAX;
+    _maxBodySize = COAP_MAX_BODY_SIZE;
+    _ackTimeout = COAP_ACK_TIMEOUT;
+    _maxRetransmit = COAP_MAX_RETRANSMIT;
+    _sent = 0;
+    _retransmitted = 0;
+    _received = 0;
+    _timeouts = 0;
+}
+
+CoAPClient::CoAPClient(IPAddress ip, uint16_t port, COAP_CALLBACK_SIGNATURE) : CoAPClient() {
+    setServer(ip, port);
+    setCallback(callback);
+}
+
+CoAPClient::CoAPClient(const char* domain, uint16_t port, COAP_CALLBACK_SIGNATURE) : CoAPClient() {
+    setServer(domain, port);
+    setCallback(callback);
+}
+
+CoAPClient::~CoAPClient() {
+    end();
+}
+
+CoAPClient& CoAPClient::setServer(IPAddress ip, uint16_t port) {
+    _ip = ip;
+    _domain = NULL;
+    _port = port;
+    return *this;
+}
+
+CoAPClient& CoAPClient::setServer(const char* domain, uint16_t port) {
+    _domain = domain;
+    _port = port;
+    return *this;
+}
+
+CoAPClient& CoAPClient::setCallback(COAP_CALLBACK_SIGNATURE) {
+    this->callback = callback;
+    return *this;
+}
+
+CoAPClient& CoAPClient::setPSK(const char* identity, const uint8_t* key, uint8_t keyLength) {
+    if ((keyLength == 0) || (keyLength > COAP_PSK_MAX_LENGTH) || (strlen(identity) > COAP_PSK_IDENTITY_MAX_LENGTH)) {
+        printf("\r\n[ERROR] %s PSK or identity too long\n", __FUNCTION__);
+        return *this;
+    }
+    strcpy(_pskIdentity, identity);
+    memcpy(_psk, key, keyLength);
+    _pskLength = keyLength;
+    _secure = true;
+    return *this;
+}
+
+CoAPClient& CoAPClient::setPSK(const char* identity, const char* hexKey) {
+    uint8_t key[COAP_PSK_MAX_LENGTH];
+    uint16_t length = strlen(hexKey);
+
+    if (((length % 2) != 0) || (length > (2 * COAP_PSK_MAX_LENGTH))) {
+        printf("\r\n[ERROR] %s PSK not in valid hex format or too long\n", __FUNCTION__);
+        return *this;
+    }
+    for (uint16_t i = 0; i < length; i++) {
+        char c = hexKey[i];
+        uint8_t nibble;
+        if ((c >= '0') && (c <= '9')) {
+            nibble = c - '0';
+        } else if ((c >= 'A') && (c <= 'F')) {
+            nibble = c - 'A' + 10;
+        } else if ((c >= 'a') && (c <= 'f')) {
+            nibble = c - 'a' + 10;
+        } else {
+            printf("\r\n[ERROR] %s PSK not in valid hex format\n", __FUNCTION__);
+            return *this;
+        }
+        if (i % 2) {
+            key[i / 2] |= nibble;
+        } else {
+            key[i / 2] = nibble << 4;
+        }
+    }
+    return setPSK(identity, key, (length / 2));
+}
+
+CoAPClient& CoAPClient::setBlockSize(uint16_t size) {
+    for (uint8_t szx = 0; szx <= COAP_BLOCK_SZX_MAX; szx++) {
+        if (COAP_BLOCK_SIZE(szx) == size) {
+            _szx = szx;
+            return *this;
+        }
+    }
+    printf("\r\n[ERROR] %s block size must be a power of 2 from 16 to 1024\n", __FUNCTION__);
+    return *this;
+}
+
+CoAPClient& CoAPClient::setMaxBodySize(uint32_t size) {
+    _maxBodySize = size;
+    return *this;
+}
+
+CoAPClient& CoAPClient::setAckTimeout(uint32_t ms, uint8_t maxRetransmit) {
+    _ackTimeout = (ms < 100) ? 100 : ms;
+    _maxRetransmit = (maxRetransmit > 8) ? 8 : maxRetransmit;
+    return *this;
+}
+
+bool CoAPClient::begin(uint16_t localPort) {
+    if (_socket >= 0) {
+        end();
+    }
+    if (_domain != NULL) {
+        if (!WiFi.hostByName(_domain, _ip)) {
+            printf("\r\n[ERROR] %s failed to resolve %s\n", __FUNCTION__, _domain);
+            return false;
+        }
+    }
+
+    _rxBuffer = (uint8_t*)malloc(COAP_MAX_PACKET_SIZE);
+    _txBuffer = (uint8_t*)malloc(COAP_MAX_PACKET_SIZE);
+    if ((_rxBuffer == NULL) || (_txBuffer == NULL)) {
+        printf("\r\n[ERROR] %s malloc buffers failed\n", __FUNCTION__);
+        end();
+        return false;
+    }
+
+    if (_secure) {
+        _socket = start_dtls_client(&_dtls, (uint32_t)_ip, _port, localPort, _psk, _pskLength, _pskIdentity, COAP_HANDSHAKE_TIMEOUT);
+    } else {
+        _socket = serverDrv.startServer(localPort, UDP_MODE, BLOCKING_MODE);
+    }
+    if (_socket < 0) {
+        printf("\r\n[ERROR] %s failed to open %s socket\n", __FUNCTION__, (_secure ? "DTLS" : "UDP"));
+        end();
+        return false;
+    }
+    return true;
+}
+
+void CoAPClient::end() {
+    for (uint8_t i = 0; i < COAP_CLIENT_MAX_REQUESTS; i++) {
+        if (_requests[i].id != 0) {
+            freeRequest(&_requests[i]);
+        }
+    }
+    if (_socket >= 0) {
+        if (_secure) {
+            stop_dtls_client(&_dtls);
+        } else {
+            serverDrv.stopSocket(_socket);
+        }
+        _socket = -1;
+    }
+    if (_rxBuffer != NULL) {
+        free(_rxBuffer);
+        _rxBuffer = NULL;
+    }
+    if (_txBuffer != NULL) {
+        free(_txBuffer);
+        _txBuffer = NULL;
+    }
+}
+
+bool CoAPClient::connected() {
+    return (_socket >= 0);
+}
+
+uint16_t CoAPClient::get(const char* uri, bool confirmable) {
+    return request(COAP_GET, uri, NULL, 0, COAP_FORMAT_NONE, confirmable, false);
+}
+
+uint16_t CoAPClient::put(const char* uri, const char* payload, bool confirmable) {
+    return request(COAP_PUT, uri, (const uint8_t*)payload, strlen(payload), COAP_FORMAT_TEXT, confirmable, false);
+}
+
+uint16_t CoAPClient::put(const char* uri, const uint8_t* payload, uint32_t length, uint16_t contentFormat, bool confirmable) {
+    return request(COAP_PUT, uri, payload, length, contentFormat, confirmable, false);
+}
+
+uint16_t CoAPClient::post(const char* uri, const char* payload, bool confirmable) {
+    return request(COAP_POST, uri, (const uint8_t*)payload, strlen(payload), COAP_FORMAT_TEXT, confirmable, false);
+}
+
+uint16_t CoAPClient::post(const char* uri, const uint8_t* payload, uint32_t length, uint16_t contentFormat, bool confirmable) {
+    return request(COAP_POST, uri, payload, length, contentFormat, confirmable, false);
+}
+
+uint16_t CoAPClient::del(const char* uri, bool confirmable) {
+    return request(COAP_DELETE, uri, NULL, 0, COAP_FORMAT_NONE, confirmable, false);
+}
+
+uint16_t CoAPClient::observe(const char* uri, bool confirmable) {
+    return request(COAP_GET, uri, NULL, 0, COAP_FORMAT_NONE, confirmable, true);
+}
+
+bool CoAPClient::cancelObserve(uint16_t id) {
+    for (uint8_t i = 0; i < COAP_CLIENT_MAX_REQUESTS; i++) {
+        coap_request_t* req = &_requests[i];
+        if ((req->id == id) && ((req->observe == COAP_OBS_REGISTER) || (req->observe == COAP_OBS_ACTIVE))) {
+            // deregister actively with the same token, the response frees the slot
+            req->observe = COAP_OBS_CANCEL;
+            req->fetching = 0;
+            req->block2 = 0;
+            if (req->rx != NULL) {
+                free(req->rx);
+                req->rx = NULL;
+            }
+            req->rxLength = 0;
+            req->rxSize = 0;
+            return sendRequest(req, true);
+        }
+    }
+    return false;
+}
+
+uint16_t CoAPClient::ping() {
+    coap_request_t* req;
+
+    if (_socket < 0) {
+        return 0;
+    }
+    req = newRequest();
+    if (req == NULL) {
+        return 0;
+    }
+    req->method = COAP_EMPTY;
+    req->confirmable = 1;
+    if (!sendRequest(req, true)) {
+        freeRequest(req);
+        return 0;
+    }
+    return req->id;
+}
+
+bool CoAPClient::loop() {
+    CoAPPacket packet;
+    uint32_t ip;
+    uint16_t port;
+    int length;
+
+    if (_socket < 0) {
+        return false;
+    }
+    for (uint8_t i = 0; i < COAP_LOOP_MAX_PACKETS; i++) {
+        length = receive(&ip, &port);
+        if (length < 0) {
+            printf("\r\n[ERROR] %s DTLS session closed\n", __FUNCTION__);
+            end();
+            return false;
+        }
+        if (length == 0) {
+            break;
+        }
+        // a plain socket also receives datagrams from other hosts
+        if ((ip != (uint32_t)_ip) || (port != _port)) {
+            continue;
+        }
+        _received++;
+        if (packet.parse(_rxBuffer, length)) {
+            handleMessage(packet);
+        }
+        if (_socket < 0) {
+            // end() was called from the callback
+            return false;
+        }
+    }
+    checkTimeouts();
+    return (_socket >= 0);
+}
+
+uint8_t CoAPClient::pending() {
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < COAP_CLIENT_MAX_REQUESTS; i++) {
+        if (_requests[i].id != 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void CoAPClient::printInfo() {
+    printf("\r\n------------------------------------------\r\n");
+    printf("CoAP client %s://%d.%d.%d.%d:%d\r\n", (_secure ? "coaps" : "coap"), _ip[0], _ip[1], _ip[2], _ip[3], _port);
+    printf("Connected: %s, block size %lu\r\n", (connected() ? "yes" : "no"), COAP_BLOCK_SIZE(_szx));
+    printf("Sent %lu, retransmitted %lu, received %lu, timed out %lu\r\n", _sent, _retransmitted, _received, _timeouts);
+    for (uint8_t i = 0; i < COAP_CLIENT_MAX_REQUESTS; i++) {
+        coap_request_t* req = &_requests[i];
+        if (req->id == 0) {
+            continue;
+        }
+        printf("  #%u %s %s%s%s\r\n", req->id, (req->method == COAP_EMPTY ? "PING" : req->uri),
+            ((req->observe == COAP_OBS_ACTIVE) ? "observing" : (req->observe == COAP_OBS_CANCEL) ? "cancelling" : "pending"),
+            (req->awaitingAck ? ", awaiting ACK" : ""), (req->fetching ? ", fetching blocks" : ""));
+    }
+    printf("\r\n------------------------------------------\r\n");
+}
+
+uint16_t CoAPClient::request(uint8_t method, const char* uri, const uint8_t* payload, uint32_t length, uint16_t contentFormat, bool confirmable, bool observe) {
+    coap_request_t* req;
+    uint16_t id;
+
+    if (_socket < 0) {
+        printf("\r\n[ERROR] %s not connected, call begin() first\n", __FUNCTION__);
+        return 0;
+    }
+    if (strlen(uri) >= COAP_MAX_URI) {
+        printf("\r\n[ERROR] %s URI too long\n", __FUNCTION__);
+        return 0;
+    }
+    req = newRequest();
+    if (req == NULL) {
+        printf("\r\n[ERROR] %s too many requests in progress\n", __FUNCTION__);
+        return 0;
+    }
+    strcpy(req->uri, uri);
+    req->method = method;
+    req->confirmable = confirmable ? 1 : 0;
+    req->observe = observe ? COAP_OBS_REGISTER : COAP_OBS_NONE;
+
+    if (length > 0) {
+        // retransmissions and later blocks must not depend on the caller's buffer
+        req->body = (uint8_t*)malloc(length);
+        if (req->body == NULL) {
+            printf("\r\n[ERROR] %s malloc body failed\n", __FUNCTION__);
+            freeRequest(req);
+            return 0;
+        }
+        memcpy(req->body, payload, length);
+        req->bodyLength = length;
+        req->contentFormat = contentFormat;
+        if (length > COAP_BLOCK_SIZE(req->szx1)) {
+            req->confirmable = 1;
+        }
+    }
+
+    if (!sendRequest(req, true)) {
+        freeRequest(req);
+        return 0;
+    }
+    id = req->id;
+    if (!req->confirmable && (method != COAP_GET)) {
+        freeRequest(req);
+    }
+    return id;
+}
+
+coap_request_t* CoAPClient::newRequest() {
+    for (uint8_t i = 0; i < COAP_CLIENT_MAX_REQUESTS; i++) {
+        coap_request_t* req = &_requests[i];
+        if (req->id == 0) {
+            uint32_t token = rand() ^ ((uint32_t)_nextId << 16);
+            memset(req, 0, sizeof(coap_request_t));
+            req->id = _nextId++;
+            if (_nextId == 0) {
+                _nextId = 1;
+            }
+            memcpy(req->token, &token, COAP_TOKEN_LENGTH);
+            req->szx1 = _szx;
+            req->szx2 = _szx;
+            req->contentFormat = COAP_FORMAT_NONE;
+            req->maxAge = COAP_DEFAULT_MAX_AGE * 1000;
+            return req;
+        }
+    }
+    return NULL;
+}
+
+void CoAPClient::freeRequest(coap_request_t* req) {
+    if (req->body != NULL) {
+        free(req->body);
+    }
+    if (req->rx != NULL) {
+        free(req->rx);
+    }
+    memset(req, 0, sizeof(coap_request_t));
+}
+
+bool CoAPClient::sendRequest(coap_request_t* req, bool newMessage) {
+    CoAPPacket packet;
+    uint32_t blockSize = COAP_BLOCK_SIZE(req->szx1);
+    int length;
+
+    if (newMessage) {
+        req->messageId = _nextMessageId++;
+        req->retransmits = 0;
+        req->timeout = req->confirmable ? ackTimeout() : exchangeTimeout();
+    }
+    packet.type = req->confirmable ? COAP_CON : COAP_NON;
+    packet.code = req->method;
+    packet.messageId = req->messageId;
+
+    if (req->method != COAP_EMPTY) {
+        packet.tokenLength = COAP_TOKEN_LENGTH;
+        memcpy(packet.token, req->token, COAP_TOKEN_LENGTH);
+        if ((req->observe == COAP_OBS_REGISTER) || ((req->observe == COAP_OBS_ACTIVE) && !req->fetching)) {
+            packet.addUintOption(COAP_OPTION_OBSERVE, COAP_OBSERVE_REGISTER);
+        } else if (req->observe == COAP_OBS_CANCEL) {
+            packet.addUintOption(COAP_OPTION_OBSERVE, COAP_OBSERVE_DEREGISTER);
+        }
+        if (!packet.addUri(req->uri)) {
+            return false;
+        }
+        // the body went with the first request, later Block2 requests only ask for the response
+        if ((req->bodyLength > 0) && (req->block2 == 0)) {
+            packet.addUintOption(COAP_OPTION_CONTENT_FORMAT, req->contentFormat);
+            if (req->bodyLength > blockSize) {
+                uint32_t offset = req->block1 * blockSize;
+                bool more = ((offset + blockSize) < req->bodyLength);
+                packet.addBlockOption(COAP_OPTION_BLOCK1, req->block1, more, req->szx1);
+                if (req->block1 == 0) {
+                    packet.addUintOption(COAP_OPTION_SIZE1, req->bodyLength);
+                }
+                packet.payload = req->body + offset;
+                packet.payloadLength = more ? blockSize : (req->bodyLength - offset);
+            } else {
+                packet.payload = req->body;
+                packet.payloadLength = req->bodyLength;
+            }
+        }
+        // ask for smaller blocks than the default up front
+        if ((req->block2 > 0) || (req->szx2 < COAP_BLOCK_SZX_MAX)) {
+            packet.addBlockOption(COAP_OPTION_BLOCK2, req->block2, false, req->szx2);
+        }
+    }
+
+    length = packet.serialize(_txBuffer, COAP_MAX_PACKET_SIZE);
+    if (length < 0) {
+        printf("\r\n[ERROR] %s request does not fit in %d bytes\n", __FUNCTION__, COAP_MAX_PACKET_SIZE);
+        return false;
+    }
+    req->sentAt = millis();
+    req->awaitingAck = req->confirmable;
+    return transmit(_txBuffer, length);
+}
+
+bool CoAPClient::transmit(const uint8_t* data, uint16_t length) {
+    bool ok;
+
+    if (_socket < 0) {
+        return false;
+    }
+    if (_secure) {
+        ok = (send_dtls_data(&_dtls, data, length) >= 0);
+    } else {
+        ok = serverDrv.sendtoData(_socket, data, length, (uint32_t)_ip, _port);
+    }
+    if (ok) {
+        _sent++;
+    }
+    return ok;
+}
+
+// Returns the datagram length, 0 if none is waiting, -1 if the DTLS session is gone
+int CoAPClient::receive(uint32_t* ip, uint16_t* port) {
+    int ret;
+
+    if (_secure) {
+        ret = get_dtls_receive(&_dtls, _rxBuffer, COAP_MAX_PACKET_SIZE);
+        *ip = (uint32_t)_ip;
+        *port = _port;
+        return ret;
+    }
+    ret = serverDrv.recvfromData(_socket, _rxBuffer, COAP_MAX_PACKET_SIZE, true, ip, port);
+    return ((ret < 0) ? 0 : ret);
+}
+
+void CoAPClient::sendEmpty(uint8_t type, uint16_t messageId) {
+    uint8_t buf[4];
+
+    buf[0] = (COAP_VERSION << 6) | (type << 4);
+    buf[1] = COAP_EMPTY;
+    buf[2] = (messageId >> 8) & 0xFF;
+    buf[3] = messageId & 0xFF;
+    transmit(buf, sizeof(buf));
+}
+
+void CoAPClient::handleMessage(CoAPPacket& packet) {
+    coap_request_t* req = NULL;
+
+    if ((packet.type == COAP_ACK) || (packet.type == COAP_RST)) {
+        for (uint8_t i = 0; i < COAP_CLIENT_MAX_REQUESTS; i++) {
+            if ((_requests[i].id != 0) && _requests[i].awaitingAck && (_requests[i].messageId == packet.messageId)) {
+                req = &_requests[i];
+                break;
+            }
+        }
+        if (req == NULL) {
+            return;
+        }
+        req->awaitingAck = 0;
+        if ((packet.type == COAP_RST) || (req->method == COAP_EMPTY)) {
+            // a ping is answered with RST, anything else was rejected
+            if (req->method == COAP_EMPTY) {
+                deliver(req, COAP_STATUS_OK, COAP_EMPTY, COAP_FORMAT_NONE, NULL, 0, false);
+            } else if (req->observe != COAP_OBS_CANCEL) {
+                deliver(req, COAP_STATUS_RESET, COAP_EMPTY, COAP_FORMAT_NONE, NULL, 0, (req->observe != COAP_OBS_NONE));
+            }
+            freeRequest(req);
+            return;
+        }
+        if (packet.code == COAP_EMPTY) {
+            // the response follows in a separate message
+            req->sentAt = millis();
+            req->timeout = exchangeTimeout();
+            return;
+        }
+        if ((packet.tokenLength != COAP_TOKEN_LENGTH) || (memcmp(packet.token, req->token, COAP_TOKEN_LENGTH) != 0)) {
+            return;
+        }
+        handleResponse(req, packet);
+        return;
+    }
+
+    // CON or NON from the server, the client does not serve requests
+    if (!packet.isResponse()) {
+        if (packet.type == COAP_CON) {
+            sendEmpty(COAP_RST, packet.messageId);
+        }
+        return;
+    }
+    if (isDuplicate(packet.messageId)) {
+        if (packet.type == COAP_CON) {
+            sendEmpty(COAP_ACK, packet.messageId);
+        }
+        return;
+    }
+    if (packet.tokenLength == COAP_TOKEN_LENGTH) {
+        for (uint8_t i = 0; i < COAP_CLIENT_MAX_REQUESTS; i++) {
+            if ((_requests[i].id != 0) && (_requests[i].method != COAP_EMPTY) && (memcmp(packet.token, _requests[i].token, COAP_TOKEN_LENGTH) == 0)) {
+                req = &_requests[i];
+                break;
+            }
+        }
+    }
+    if (req == NULL) {
+        // also stops notifications for an observation that was forgotten
+        if ((packet.type == COAP_CON) || (packet.findOption(COAP_OPTION_OBSERVE) != NULL)) {
+            sendEmpty(COAP_RST, packet.messageId);
+        }
+        return;
+    }
+    if (packet.type == COAP_CON) {
+        sendEmpty(COAP_ACK, packet.messageId);
+    }
+    // a separate response also tells that the request arrived
+    req->awaitingAck = 0;
+    handleResponse(req, packet);
+}
+
+// Notification sequence numbers are 24 bit and wrap (RFC 7641 3.4)
+static bool coap_is_fresh(uint32_t v1, uint32_t v2, uint32_t elapsed) {
+    return (((v1 < v2) && ((v2 - v1) < (1UL << 23))) || ((v1 > v2) && ((v1 - v2) > (1UL << 23))) || (elapsed > 128000));
+}
+
+void CoAPClient::handleResponse(coap_request_t* req, CoAPPacket& packet) {
+    uint32_t num;
+    bool more;
+    uint8_t szx;
+    uint32_t seq;
+    uint32_t maxAge;
+    bool hasObserve;
+
+    // a large request body is acknowledged block by block (RFC 7959 2.5)
+    if ((req->bodyLength > COAP_BLOCK_SIZE(req->szx1)) && (req->block2 == 0) && packet.getBlockOption(COAP_OPTION_BLOCK1, &num, &more, &szx)) {
+        if (packet.code == COAP_CONTINUE) {
+            uint32_t offset = (num + 1) * COAP_BLOCK_SIZE(req->szx1);
+            if (szx < req->szx1) {
+                req->szx1 = szx;
+            }
+            if (offset < req->bodyLength) {
+                req->block1 = offset / COAP_BLOCK_SIZE(req->szx1);
+                sendRequest(req, true);
+                return;
+            }
+        } else if ((packet.code == COAP_REQUEST_ENTITY_TOO_LARGE) && (szx < req->szx1)) {
+            // start over with the block size the server asked for
+            req->szx1 = szx;
+            req->block1 = 0;
+            sendRequest(req, true);
+            return;
+        }
+    }
+
+    if (req->observe == COAP_OBS_CANCEL) {
+        freeRequest(req);
+        return;
+    }
+    hasObserve = packet.getUintOption(COAP_OPTION_OBSERVE, &seq);
+    if (hasObserve && (packet.code < COAP_BAD_REQUEST) && ((req->observe == COAP_OBS_REGISTER) || (req->observe == COAP_OBS_ACTIVE))) {
+        if ((req->observe == COAP_OBS_ACTIVE) && !coap_is_fresh(req->observeSeq, seq, (millis() - req->notifiedAt))) {
+            // reordered, an older notification than the last one
+            return;
+        }
+        req->observe = COAP_OBS_ACTIVE;
+        req->observeSeq = seq;
+        req->notifiedAt = millis();
+        req->maxAge = (packet.getUintOption(COAP_OPTION_MAX_AGE, &maxAge) ? maxAge : COAP_DEFAULT_MAX_AGE) * 1000;
+        // a newer notification replaces the one being fetched
+        req->fetching = 0;
+    } else if (req->observe == COAP_OBS_REGISTER) {
+        // the resource is not observable, or the request failed
+        req->observe = COAP_OBS_NONE;
+        hasObserve = false;
+    }
+
+    if (!packet.getBlockOption(COAP_OPTION_BLOCK2, &num, &more, &szx)) {
+        deliver(req, COAP_STATUS_OK, packet.code, packet.contentFormat(), packet.payload, packet.payloadLength, hasObserve);
+        finishRequest(req);
+        return;
+    }
+
+    uint32_t offset = num * COAP_BLOCK_SIZE(szx);
+    if (offset == 0) {
+        req->rxLength = 0;
+        req->rxNotification = hasObserve ? 1 : 0;
+    }
+    if (offset != req->rxLength) {
+        // the representation changed during the transfer, start over from the first block
+        req->rxLength = 0;
+        req->block2 = 0;
+        req->szx2 = szx;
+        req->fetching = (req->observe == COAP_OBS_ACTIVE) ? 1 : 0;
+        sendRequest(req, true);
+        return;
+    }
+    if ((offset + packet.payloadLength) > _maxBodySize) {
+        deliver(req, COAP_STATUS_TOO_LARGE, packet.code, packet.contentFormat(), NULL, 0, req->rxNotification);
+        finishRequest(req);
+        return;
+    }
+    if ((offset + packet.payloadLength) > req->rxSize) {
+        uint32_t size;
+        uint8_t* rx;
+        // Size2 in the first block tells the whole length
+        if (!((offset == 0) && packet.getUintOption(COAP_OPTION_SIZE2, &size) && (size <= _maxBodySize) && (size >= packet.payloadLength))) {
+            size = offset + (more ? (2 * COAP_BLOCK_SIZE(szx)) : packet.payloadLength);
+            if (size > _maxBodySize) {
+                size = _maxBodySize;
+            }
+        }
+        rx = (uint8_t*)realloc(req->rx, size);
+        if (rx == NULL) {
+            printf("\r\n[ERROR] %s malloc %lu byte body failed\n", __FUNCTION__, size);
+            deliver(req, COAP_STATUS_TOO_LARGE, packet.code, packet.contentFormat(), NULL, 0, req->rxNotification);
+            finishRequest(req);
+            return;
+        }
+        req->rx = rx;
+        req->rxSize = size;
+    }
+    memcpy((req->rx + offset), packet.payload, packet.payloadLength);
+    req->rxLength = offset + packet.payloadLength;
+
+    if (more) {
+        req->block2 = num + 1;
+        req->szx2 = szx;
+        // the rest of a notification is fetched with plain GETs (RFC 7959 3.4)
+        req->fetching = (req->observe == COAP_OBS_ACTIVE) ? 1 : 0;
+        sendRequest(req, true);
+        return;
+    }
+    deliver(req, COAP_STATUS_OK, packet.code, packet.contentFormat(), req->rx, req->rxLength, req->rxNotification);
+    finishRequest(req);
+}
+
+void CoAPClient::finishRequest(coap_request_t* req) {
+    if (req->observe == COAP_OBS_ACTIVE) {
+        // keep the slot for the next notification
+        if (req->rx != NULL) {
+            free(req->rx);
+            req->rx = NULL;
+        }
+        req->rxLength = 0;
+        req->rxSize = 0;
+        req->block2 = 0;
+        req->fetching = 0;
+        req->awaitingAck = 0;
+        req->sentAt = millis();
+        req->timeout = req->maxAge + COAP_OBSERVE_MARGIN;
+    } else if (req->observe != COAP_OBS_CANCEL) {
+        // cancelObserve() from the callback keeps the slot for the deregistration
+        freeRequest(req);
+    }
+}
+
+void CoAPClient::deliver(coap_request_t* req, int8_t status, uint8_t code, uint16_t contentFormat, const uint8_t* payload, uint32_t length, bool notification) {
+    CoAPResponse response;
+
+    if (callback == NULL) {
+        return;
+    }
+    response.id = req->id;
+    response.status = status;
+    response.code = code;
+    response.uri = req->uri;
+    response.contentFormat = contentFormat;
+    response.payload = payload;
+    response.length = length;
+    response.notification = notification;
+    callback(response);
+}
+
+void CoAPClient::checkTimeouts() {
+    uint32_t now = millis();
+
+    for (uint8_t i = 0; i < COAP_CLIENT_MAX_REQUESTS; i++) {
+        coap_request_t* req = &_requests[i];
+        if ((req->id == 0) || ((now - req->sentAt) < req->timeout)) {
+            continue;
+        }
+        if (req->awaitingAck) {
+            if (req->retransmits < _maxRetransmit) {
+                // same message ID, the timeout doubles every time
+                req->retransmits++;
+                req->timeout *= 2;
+                sendRequest(req, false);
+                _retransmitted++;
+                continue;
+            }
+        } else if ((req->observe == COAP_OBS_ACTIVE) && !req->fetching) {
+            // nothing within Max-Age, the server may have lost the observation
+            req->observe = COAP_OBS_REGISTER;
+            sendRequest(req, true);
+            continue;
+        }
+        _timeouts++;
+        if (req->observe != COAP_OBS_CANCEL) {
+            deliver(req, COAP_STATUS_TIMEOUT, COAP_EMPTY, COAP_FORMAT_NONE, NULL, 0, (req->observe != COAP_OBS_NONE));
+        }
+        freeRequest(req);
+    }
+}
+
+bool CoAPClient::isDuplicate(uint16_t messageId) {
+    for (uint8_t i = 0; i < _recentCount; i++) {
+        if (_recent[i] == messageId) {
+            return true;
+        }
+    }
+    _recent[_recentIndex] = messageId;
+    _recentIndex = (_recentIndex + 1) % (sizeof(_recent) / sizeof(_recent[0]));
+    if (_recentCount < (sizeof(_recent) / sizeof(_recent[0]))) {
+        _recentCount++;
+    }
+    return false;
+}
+
+uint32_t CoAPClient::ackTimeout() {
+    // ACK_TIMEOUT to ACK_TIMEOUT * ACK_RANDOM_FACTOR so that nodes do not retransmit in step
+    return (_ackTimeout + (rand() % ((_ackTimeout / 2) + 1)));
+}
+
+uint32_t CoAPClient::exchangeTimeout() {
+    // time the last retransmission of a confirmable message may wait for its answer
+    return (_ackTimeout * ((1UL << (_maxRetransmit + 1)) - 1));
+}
@@ -0,0 +1,171 @@
+#ifndef CoAPClient_h
+#define CoAPClient_h
+
+#include <Arduino.h>
+#include "IPAddress.h"
+#include "server_drv.h"
+#include "CoAPPacket.h"
+
+extern "C" {
+#include "ard_dtls.h"
+}
+
+// Requests and observations in progress at the same time
+#define COAP_CLIENT_MAX_REQUESTS        8
+#define COAP_TOKEN_LENGTH               4
+#define COAP_PSK_MAX_LENGTH             32
+#define COAP_PSK_IDENTITY_MAX_LENGTH    64
+#define COAP_HANDSHAKE_TIMEOUT          16000       // ms
+// Margin after Max-Age before a silent observation is registered again
+#define COAP_OBSERVE_MARGIN             5000        // ms
+#define COAP_DEFAULT_MAX_AGE            60          // seconds
+
+// coap_request_t.observe
+#define COAP_OBS_NONE                   0
+#define COAP_OBS_REGISTER               1           // waiting for the first notification
+#define COAP_OBS_ACTIVE                 2
+#define COAP_OBS_CANCEL                 3
+
+// Possible values for CoAPResponse.status
+#define COAP_STATUS_OK                  0
+#define COAP_STATUS_TIMEOUT             -1          // no answer after all retransmissions
+#define COAP_STATUS_RESET               -2          // the server rejected the message
+#define COAP_STATUS_TOO_LARGE           -3          // the body did not fit in setMaxBodySize()
+
+typedef struct {
+    uint16_t id;                // returned by the request function
+    int8_t status;              // COAP_STATUS_*
+    uint8_t code;               // response code, i.e. COAP_CONTENT, COAP_EMPTY without a response
+    const char* uri;
+    uint16_t contentFormat;     // COAP_FORMAT_NONE if not given
+    const uint8_t* payload;     // whole body, blocks are already reassembled
+    uint32_t length;
+    bool notification;          // sent for an observed resource
+} CoAPResponse;
+
+#define COAP_CALLBACK_SIGNATURE void (*callback)(CoAPResponse&)
+
+typedef struct {
+    uint16_t id;                // 0 if the slot is free
+    uint8_t method;
+    uint8_t confirmable;
+    uint8_t observe;            // COAP_OBS_*
+    uint8_t fetching;           // later Block2 blocks of a notification are fetched without Observe
+    uint8_t awaitingAck;
+    uint8_t retransmits;
+    uint8_t szx1;               // Block1 and Block2 sizes, lowered when the server asks for smaller blocks
+    uint8_t szx2;
+    uint8_t token[COAP_TOKEN_LENGTH];
+    uint16_t messageId;
+    uint16_t contentFormat;
+    char uri[COAP_MAX_URI];
+    uint8_t* body;              // copy of the request body, sent in Block1 blocks when large
+    uint32_t bodyLength;
+    uint32_t block1;            // block being sent
+    uint32_t block2;            // block being requested
+    uint8_t* rx;                // reassembled Block2 body
+    uint32_t rxLength;
+    uint32_t rxSize;
+    uint8_t rxNotification;
+    uint32_t sentAt;
+    uint32_t timeout;           // ms after sentAt until a retransmission or giving up
+    uint32_t observeSeq;
+    uint32_t notifiedAt;
+    uint32_t maxAge;            // ms the last notification stays fresh
+} coap_request_t;
+
+class CoAPClient {
+    public:
+        CoAPClient();
+        CoAPClient(IPAddress ip, uint16_t port, COAP_CALLBACK_SIGNATURE);
+        CoAPClient(const char* domain, uint16_t port, COAP_CALLBACK_SIGNATURE);
+        ~CoAPClient();
+
+        CoAPClient& setServer(IPAddress ip, uint16_t port = COAP_DEFAULT_PORT);
+        CoAPClient& setServer(const char* domain, uint16_t port = COAP_DEFAULT_PORT);
+        CoAPClient& setCallback(COAP_CALLBACK_SIGNATURE);
+        // Use DTLS with a pre-shared key (coaps://), key is binary, call before begin()
+        CoAPClient& setPSK(const char* identity, const uint8_t* key, uint8_t keyLength);
+        // key given as a hex string, i.e. "0102030405060708"
+        CoAPClient& setPSK(const char* identity, const char* hexKey);
+        // 16 to 1024 bytes, a power of 2, the server may ask for smaller blocks
+        CoAPClient& setBlockSize(uint16_t size);
+        CoAPClient& setMaxBodySize(uint32_t size);
+        CoAPClient& setAckTimeout(uint32_t ms, uint8_t maxRetransmit = COAP_MAX_RETRANSMIT);
+
+        // Open the socket and, with setPSK(), run the DTLS handshake
+        bool begin(uint16_t localPort = 0);
+        void end();
+        bool connected();
+
+        // Requests return an id passed to the callback with the response, 0 on failure.
+        // Bodies larger than the block size are sent block-wise as confirmable. Non-confirmable
+        // put, post and del are sent without waiting for a response or calling back.
+        uint16_t get(const char* uri, bool confirmable = true);
+        uint16_t put(const char* uri, const char* payload, bool confirmable = true);
+        uint16_t put(const char* uri, const uint8_t* payload, uint32_t length, uint16_t contentFormat = COAP_FORMAT_OCTET_STREAM, bool confirmable = true);
+        uint16_t post(const char* uri, const char* payload, bool confirmable = true);
+        uint16_t post(const char* uri, const uint8_t* payload, uint32_t length, uint16_t contentFormat = COAP_FORMAT_OCTET_STREAM, bool confirmable = true);
+        uint16_t del(const char* uri, bool confirmable = true);
+        // Every notification is passed to the callback with notification set
+        uint16_t observe(const char* uri, bool confirmable = true);
+        bool cancelObserve(uint16_t id);
+        // Empty confirmable message, answered with COAP_STATUS_OK when the server is reachable
+        uint16_t ping();
+
+        // Receive responses and retransmit, call often. Returns false when the socket is closed
+        bool loop();
+
+        uint8_t pending();
+        void printInfo();
+
+    private:
+        uint16_t request(uint8_t method, const char* uri, const uint8_t* payload, uint32_t length, uint16_t contentFormat, bool confirmable, bool observe);
+        coap_request_t* newRequest();
+        void freeRequest(coap_request_t* req);
+        bool sendRequest(coap_request_t* req, bool newMessage);
+        bool transmit(const uint8_t* data, uint16_t length);
+        int receive(uint32_t* ip, uint16_t* port);
+        void sendEmpty(uint8_t type, uint16_t messageId);
+        void handleMessage(CoAPPacket& packet);
+        void handleResponse(coap_request_t* req, CoAPPacket& packet);
+        void finishRequest(coap_request_t* req);
+        void deliver(coap_request_t* req, int8_t status, uint8_t code, uint16_t contentFormat, const uint8_t* payload, uint32_t length, bool notification);
+        void checkTimeouts();
+        bool isDuplicate(uint16_t messageId);
+        uint32_t ackTimeout();
+        uint32_t exchangeTimeout();
+
+        IPAddress _ip;
+        const char* _domain;
+        uint16_t _port;
+        COAP_CALLBACK_SIGNATURE;
+
+        ServerDrv serverDrv;
+        int _socket;
+        bool _secure;
+        dtlsclient_context _dtls;
+        char _pskIdentity[COAP_PSK_IDENTITY_MAX_LENGTH + 1];
+        uint8_t _psk[COAP_PSK_MAX_LENGTH];
+        uint8_t _pskLength;
+
+        uint8_t* _rxBuffer;
+        uint8_t* _txBuffer;
+        coap_request_t _requests[COAP_CLIENT_MAX_REQUESTS];
+        uint16_t _nextId;
+        uint16_t _nextMessageId;
+        uint16_t _recent[8];
+        uint8_t _recentIndex;
+        uint8_t _recentCount;
+        uint8_t _szx;
+        uint32_t _maxBodySize;
+        uint32_t _ackTimeout;
+        uint8_t _maxRetransmit;
+
+        uint32_t _sent;
+        uint32_t _retransmitted;
+        uint32_t _received;
+        uint32_t _timeouts;
+};
+
+#endif
@@ -0,0 +1,347 @@
+#include "CoAPPacket.h"
+
+#define COAP_HEADER_SIZE        4
+#define COAP_PAYLOAD_MARKER     0xFF
+
+CoAPPacket::CoAPPacket() {
+    reset();
+}
+
+void CoAPPacket::reset() {
+    type = COAP_CON;
+    code = COAP_EMPTY;
+    messageId = 0;
+    tokenLength = 0;
+    optionCount = 0;
+    payload = NULL;
+    payloadLength = 0;
+    _storageUsed = 0;
+}
+
+bool CoAPPacket::addOption(uint16_t number, const uint8_t* value, uint16_t length) {
+    if (optionCount >= COAP_MAX_OPTIONS) {
+        printf("\r\n[ERROR] %s too many options\n", __FUNCTION__);
+        return false;
+    }
+    options[optionCount].number = number;
+    options[optionCount].length = length;
+    options[optionCount].value = value;
+    optionCount++;
+    return true;
+}
+
+bool CoAPPacket::addOption(uint16_t number, const char* value) {
+    return addOption(number, (const uint8_t*)value, strlen(value));
+}
+
+bool CoAPPacket::addUintOption(uint16_t number, uint32_t value) {
+    uint8_t length = 0;
+    uint8_t* buf = _storage + _storageUsed;
+
+    if ((_storageUsed + 4) > COAP_OPTION_STORAGE) {
+        printf("\r\n[ERROR] %s option storage full\n", __FUNCTION__);
+        return false;
+    }
+    // shortest big-endian encoding, 0 is sent as an empty option
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if ((length > 0) || ((value >> shift) & 0xFF)) {
+            buf[length++] = (value >> shift) & 0xFF;
+        }
+    }
+    if (!addOption(number, buf, length)) {
+        return false;
+    }
+    _storageUsed += length;
+    return true;
+}
+
+bool CoAPPacket::addBlockOption(uint16_t number, uint32_t num, bool more, uint8_t szx) {
+    return addUintOption(number, ((num << 4) | (more ? 0x08 : 0) | (szx & 0x07)));
+}
+
+bool CoAPPacket::addUri(const char* uri) {
+    const char* p = uri;
+    const char* end;
+
+    while (*p == '/') {
+        p++;
+    }
+    while ((*p != '\0') && (*p != '?')) {
+        end = p;
+        while ((*end != '\0') && (*end != '/') && (*end != '?')) {
+            end++;
+        }
+        if (end > p) {
+            if (!addOption(COAP_OPTION_URI_PATH, (const uint8_t*)p, (end - p))) {
+                return false;
+            }
+        }
+        p = (*end == '/') ? (end + 1) : end;
+    }
+    if (*p == '?') {
+        p++;
+        while (*p != '\0') {
+            end = p;
+            while ((*end != '\0') && (*end != '&')) {
+                end++;
+            }
+            if (end > p) {
+                if (!addOption(COAP_OPTION_URI_QUERY, (const uint8_t*)p, (end - p))) {
+                    return false;
+                }
+            }
+            p = (*end == '&') ? (end + 1) : end;
+        }
+    }
+    return true;
+}
+
+const CoAPOption* CoAPPacket::findOption(uint16_t number, const CoAPOption* after) const {
+    uint8_t i = 0;
+
+    if (after != NULL) {
+        i = (after - options) + 1;
+    }
+    for (; i < optionCount; i++) {
+        if (options[i].number == number) {
+            return &options[i];
+        }
+    }
+    return NULL;
+}
+
+bool CoAPPacket::getUintOption(uint16_t number, uint32_t* value) const {
+    const CoAPOption* option = findOption(number);
+
+    if ((option == NULL) || (option->length > 4)) {
+        return false;
+    }
+    *value = 0;
+    for (uint16_t i = 0; i < option->length; i++) {
+        *value = (*value << 8) | option->value[i];
+    }
+    return true;
+}
+
+bool CoAPPacket::getBlockOption(uint16_t number, uint32_t* num, bool* more, uint8_t* szx) const {
+    uint32_t value;
+
+    if (!getUintOption(number, &value)) {
+        return false;
+    }
+    *num = value >> 4;
+    *more = (value & 0x08) ? true : false;
+    *szx = value & 0x07;
+    // SZX 7 is reserved for BERT over TCP
+    return (*szx != 7);
+}
+
+uint16_t CoAPPacket::joinOptions(uint16_t number, char separator, char* buf, uint16_t size) const {
+    const CoAPOption* option = NULL;
+    uint16_t n = 0;
+
+    if (size == 0) {
+        return 0;
+    }
+    while ((option = findOption(number, option)) != NULL) {
+        if ((n + (n ? 1 : 0) + option->length) >= size) {
+            break;
+        }
+        if (n) {
+            buf[n++] = separator;
+        }
+        memcpy((buf + n), option->value, option->length);
+        n += option->length;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+uint16_t CoAPPacket::getUriPath(char* buf, uint16_t size) const {
+    return joinOptions(COAP_OPTION_URI_PATH, '/', buf, size);
+}
+
+uint16_t CoAPPacket::getUriQuery(char* buf, uint16_t size) const {
+    return joinOptions(COAP_OPTION_URI_QUERY, '&', buf, size);
+}
+
+uint16_t CoAPPacket::contentFormat() const {
+    uint32_t value;
+
+    if (!getUintOption(COAP_OPTION_CONTENT_FORMAT, &value)) {
+        return COAP_FORMAT_NONE;
+    }
+    return (uint16_t)value;
+}
+
+bool CoAPPacket::hasUnknownCriticalOption() const {
+    for (uint8_t i = 0; i < optionCount; i++) {
+        switch (options[i].number) {
+            case COAP_OPTION_URI_HOST:
+            case COAP_OPTION_URI_PORT:
+            case COAP_OPTION_URI_PATH:
+            case COAP_OPTION_URI_QUERY:
+            case COAP_OPTION_ACCEPT:
+            case COAP_OPTION_BLOCK2:
+            case COAP_OPTION_BLOCK1:
+                break;
+            default:
+                if (options[i].number & 0x01) {
+                    return true;
+                }
+                break;
+        }
+    }
+    return false;
+}
+
+// Option delta and length nibbles, 13 and 14 announce 1 and 2 extension bytes
+static uint8_t coap_option_nibble(uint16_t value) {
+    if (value < 13) {
+        return value;
+    }
+    return ((value < 269) ? 13 : 14);
+}
+
+static uint8_t* coap_option_extend(uint8_t* p, uint16_t value) {
+    if (value >= 269) {
+        value -= 269;
+        *p++ = (value >> 8) & 0xFF;
+        *p++ = value & 0xFF;
+    } else if (value >= 13) {
+        *p++ = value - 13;
+    }
+    return p;
+}
+
+int CoAPPacket::serialize(uint8_t* buf, uint16_t size) {
+    uint8_t* p = buf;
+    uint8_t* end = buf + size;
+    uint16_t last = 0;
+    CoAPOption option;
+
+    if ((size < (COAP_HEADER_SIZE + tokenLength)) || (tokenLength > COAP_MAX_TOKEN_LENGTH)) {
+        return -1;
+    }
+    // stable insertion sort, repeated options keep their order
+    for (uint8_t i = 1; i < optionCount; i++) {
+        option = options[i];
+        int j = i - 1;
+        while ((j >= 0) && (options[j].number > option.number)) {
+            options[j + 1] = options[j];
+            j--;
+        }
+        options[j + 1] = option;
+    }
+
+    *p++ = (COAP_VERSION << 6) | ((type & 0x03) << 4) | (tokenLength & 0x0F);
+    *p++ = code;
+    *p++ = (messageId >> 8) & 0xFF;
+    *p++ = messageId & 0xFF;
+    memcpy(p, token, tokenLength);
+    p += tokenLength;
+
+    for (uint8_t i = 0; i < optionCount; i++) {
+        uint16_t delta = options[i].number - last;
+        uint16_t length = options[i].length;
+
+        if ((p + 5 + length) > end) {
+            return -1;
+        }
+        *p++ = (coap_option_nibble(delta) << 4) | coap_option_nibble(length);
+        p = coap_option_extend(p, delta);
+        p = coap_option_extend(p, length);
+        memcpy(p, options[i].value, length);
+        p += length;
+        last = options[i].number;
+    }
+
+    if (payloadLength > 0) {
+        if ((p + 1 + payloadLength) > end) {
+            return -1;
+        }
+        *p++ = COAP_PAYLOAD_MARKER;
+        memcpy(p, payload, payloadLength);
+        p += payloadLength;
+    }
+    return (p - buf);
+}
+
+// Reads an option delta or length with its extension bytes, returns false past the end
+static bool coap_option_value(uint8_t nibble, const uint8_t** p, const uint8_t* end, uint16_t* value) {
+    if (nibble < 13) {
+        *value = nibble;
+    } else if (nibble == 13) {
+        if (*p >= end) {
+            return false;
+        }
+        *value = **p + 13;
+        (*p)++;
+    } else if (nibble == 14) {
+        if ((*p + 1) >= end) {
+            return false;
+        }
+        *value = (((*p)[0] << 8) | (*p)[1]) + 269;
+        (*p) += 2;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool CoAPPacket::parse(const uint8_t* buf, uint16_t length) {
+    const uint8_t* p = buf;
+    const uint8_t* end = buf + length;
+    uint16_t number = 0;
+
+    reset();
+    if (length < COAP_HEADER_SIZE) {
+        return false;
+    }
+    if ((buf[0] >> 6) != COAP_VERSION) {
+        return false;
+    }
+    type = (buf[0] >> 4) & 0x03;
+    tokenLength = buf[0] & 0x0F;
+    code = buf[1];
+    messageId = (buf[2] << 8) | buf[3];
+    p += COAP_HEADER_SIZE;
+
+    if ((tokenLength > COAP_MAX_TOKEN_LENGTH) || ((p + tokenLength) > end)) {
+        return false;
+    }
+    memcpy(token, p, tokenLength);
+    p += tokenLength;
+    // an empty message is only the header
+    if ((code == COAP_EMPTY) && ((tokenLength != 0) || (p != end))) {
+        return false;
+    }
+
+    while (p < end) {
+        uint8_t byte = *p++;
+        uint16_t delta;
+        uint16_t len;
+
+        if (byte == COAP_PAYLOAD_MARKER) {
+            // a marker must be followed by payload
+            if (p == end) {
+                return false;
+            }
+            payload = p;
+            payloadLength = end - p;
+            break;
+        }
+        if (!coap_option_value((byte >> 4), &p, end, &delta) || !coap_option_value((byte & 0x0F), &p, end, &len)) {
+            return false;
+        }
+        if ((p + len) > end) {
+            return false;
+        }
+        number += delta;
+        if (!addOption(number, p, len)) {
+            return false;
+        }
+        p += len;
+    }
+    return true;
+}
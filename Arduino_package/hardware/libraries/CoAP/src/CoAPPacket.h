@@ -0,0 +1,155 @@
+#ifndef CoAPPacket_h
+#define CoAPPacket_h
+
+#include <Arduino.h>
+
+#define COAP_DEFAULT_PORT               5683
+#define COAPS_DEFAULT_PORT              5684
+#define COAP_VERSION                    1
+
+// Largest datagram sent or accepted, fits a 1024 byte block and its options (RFC 7252 4.6)
+#define COAP_MAX_PACKET_SIZE            1152
+#define COAP_MAX_OPTIONS                16
+#define COAP_MAX_TOKEN_LENGTH           8
+#define COAP_MAX_URI                    64
+// Bytes available for option values encoded by addUintOption()
+#define COAP_OPTION_STORAGE             32
+
+// Transmission parameters (RFC 7252 4.8), override with setAckTimeout()
+#define COAP_ACK_TIMEOUT                2000        // ms, randomized up to 1.5 times
+#define COAP_MAX_RETRANSMIT             4
+
+// Block-wise transfer (RFC 7959), SZX 6 is 1024 byte blocks, override with setBlockSize()
+#define COAP_BLOCK_SZX_MAX              6
+#define COAP_BLOCK_SIZE(szx)            (1UL << ((szx) + 4))
+// Largest body reassembled from blocks, override with setMaxBodySize()
+#define COAP_MAX_BODY_SIZE              (16 * 1024)
+
+// Message types
+#define COAP_CON                        0
+#define COAP_NON                        1
+#define COAP_ACK                        2
+#define COAP_RST                        3
+
+// Method and response codes, c.dd is written as (c << 5) | dd
+#define COAP_CODE(c, dd)                (((c) << 5) | (dd))
+#define COAP_EMPTY                      COAP_CODE(0, 0)
+#define COAP_GET                        COAP_CODE(0, 1)
+#define COAP_POST                       COAP_CODE(0, 2)
+#define COAP_PUT                        COAP_CODE(0, 3)
+#define COAP_DELETE                     COAP_CODE(0, 4)
+#define COAP_CREATED                    COAP_CODE(2, 1)
+#define COAP_DELETED                    COAP_CODE(2, 2)
+#define COAP_VALID                      COAP_CODE(2, 3)
+#define COAP_CHANGED                    COAP_CODE(2, 4)
+#define COAP_CONTENT                    COAP_CODE(2, 5)
+#define COAP_CONTINUE                   COAP_CODE(2, 31)
+#define COAP_BAD_REQUEST                COAP_CODE(4, 0)
+#define COAP_UNAUTHORIZED               COAP_CODE(4, 1)
+#define COAP_BAD_OPTION                 COAP_CODE(4, 2)
+#define COAP_FORBIDDEN                  COAP_CODE(4, 3)
+#define COAP_NOT_FOUND                  COAP_CODE(4, 4)
+#define COAP_METHOD_NOT_ALLOWED         COAP_CODE(4, 5)
+#define COAP_NOT_ACCEPTABLE             COAP_CODE(4, 6)
+#define COAP_REQUEST_ENTITY_INCOMPLETE  COAP_CODE(4, 8)
+#define COAP_REQUEST_ENTITY_TOO_LARGE   COAP_CODE(4, 13)
+#define COAP_UNSUPPORTED_FORMAT         COAP_CODE(4, 15)
+#define COAP_INTERNAL_SERVER_ERROR      COAP_CODE(5, 0)
+#define COAP_NOT_IMPLEMENTED            COAP_CODE(5, 1)
+#define COAP_SERVICE_UNAVAILABLE        COAP_CODE(5, 3)
+#define COAP_GATEWAY_TIMEOUT            COAP_CODE(5, 4)
+
+// Option numbers
+#define COAP_OPTION_IF_MATCH            1
+#define COAP_OPTION_URI_HOST            3
+#define COAP_OPTION_ETAG                4
+#define COAP_OPTION_IF_NONE_MATCH       5
+#define COAP_OPTION_OBSERVE             6
+#define COAP_OPTION_URI_PORT            7
+#define COAP_OPTION_LOCATION_PATH       8
+#define COAP_OPTION_URI_PATH            11
+#define COAP_OPTION_CONTENT_FORMAT      12
+#define COAP_OPTION_MAX_AGE             14
+#define COAP_OPTION_URI_QUERY           15
+#define COAP_OPTION_ACCEPT              17
+#define COAP_OPTION_LOCATION_QUERY      20
+#define COAP_OPTION_BLOCK2              23
+#define COAP_OPTION_BLOCK1              27
+#define COAP_OPTION_SIZE2               28
+#define COAP_OPTION_SIZE1               60
+
+// Content formats
+#define COAP_FORMAT_TEXT                0
+#define COAP_FORMAT_JPEG                22
+#define COAP_FORMAT_LINK                40
+#define COAP_FORMAT_XML                 41
+#define COAP_FORMAT_OCTET_STREAM        42
+#define COAP_FORMAT_JSON                50
+#define COAP_FORMAT_CBOR                60
+#define COAP_FORMAT_NONE                0xFFFF
+
+// Observe option values in requests (RFC 7641)
+#define COAP_OBSERVE_REGISTER           0
+#define COAP_OBSERVE_DEREGISTER         1
+
+typedef struct {
+    uint16_t number;
+    uint16_t length;
+    const uint8_t* value;
+} CoAPOption;
+
+// One CoAP message. Parsed options and payload point into the received buffer, and
+// added string options point to the caller's strings, all must stay valid until
+// serialize() or the last access.
+class CoAPPacket {
+    public:
+        CoAPPacket();
+
+        void reset();
+
+        // Options can be added in any order, serialize() sorts them
+        bool addOption(uint16_t number, const uint8_t* value, uint16_t length);
+        bool addOption(uint16_t number, const char* value);
+        bool addUintOption(uint16_t number, uint32_t value);
+        bool addBlockOption(uint16_t number, uint32_t num, bool more, uint8_t szx);
+        // Split "path/to/resource?a=1&b=2" into Uri-Path and Uri-Query options
+        bool addUri(const char* uri);
+
+        // Returns the first option with number after the option after, NULL if there is none
+        const CoAPOption* findOption(uint16_t number, const CoAPOption* after = NULL) const;
+        bool getUintOption(uint16_t number, uint32_t* value) const;
+        bool getBlockOption(uint16_t number, uint32_t* num, bool* more, uint8_t* szx) const;
+        // Join Uri-Path options with '/' and Uri-Query options with '&', returns the string length
+        uint16_t getUriPath(char* buf, uint16_t size) const;
+        uint16_t getUriQuery(char* buf, uint16_t size) const;
+        // Content-Format, COAP_FORMAT_NONE if not present
+        uint16_t contentFormat() const;
+        // True if a critical option other than the ones in this library is present (RFC 7252 5.4.1)
+        bool hasUnknownCriticalOption() const;
+
+        bool isRequest() const { return ((code >= COAP_GET) && (code < COAP_CODE(1, 0))); }
+        bool isResponse() const { return (code >= COAP_CODE(2, 0)); }
+
+        // Returns the message length, or -1 if it does not fit in size
+        int serialize(uint8_t* buf, uint16_t size);
+        // Returns false for a message format error
+        bool parse(const uint8_t* buf, uint16_t length);
+
+        uint8_t type;
+        uint8_t code;
+        uint16_t messageId;
+        uint8_t tokenLength;
+        uint8_t token[COAP_MAX_TOKEN_LENGTH];
+        CoAPOption options[COAP_MAX_OPTIONS];
+        uint8_t optionCount;
+        const uint8_t* payload;
+        uint16_t payloadLength;
+
+    private:
+        uint16_t joinOptions(uint16_t number, char separator, char* buf, uint16_t size) const;
+
+        uint8_t _storage[COAP_OPTION_STORAGE];
+        uint8_t _storageUsed;
+};
+
+#endif
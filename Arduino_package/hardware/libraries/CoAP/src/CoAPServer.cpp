@@ -0,0 +1,647 @@
+#include "CoAPServer.h"
+
+// Datagrams handled per loop() call, the rest wait for the next call
+#define COAP_LOOP_MAX_PACKETS   8
+
+CoAPServer::CoAPServer(uint16_t port) {
+    _port = port;
+    _socket = -1;
+    _rxBuffer = NULL;
+    _txBuffer = NULL;
+    memset(_resources, 0, sizeof(_resources));
+    _resourceCount = 0;
+    memset(_observers, 0, sizeof(_observers));
+    memset(_dedup, 0, sizeof(_dedup));
+    _dedupIndex = 0;
+    memset(&_block1, 0, sizeof(_block1));
+    _nextMessageId = rand() & 0xFFFF;
+    _szx = COAP_BLOCK_SZX_MAX;
+    _maxBodySize = COAP_MAX_BODY_SIZE;
+    _ackTimeout = COAP_ACK_TIMEOUT;
+    _maxRetransmit = COAP_MAX_RETRANSMIT;
+    _requests = 0;
+    _duplicates = 0;
+    _notifications = 0;
+    _retransmitted = 0;
+}
+
+CoAPServer::~CoAPServer() {
+    end();
+    for (uint8_t i = 0; i < _resourceCount; i++) {
+        if (_resources[i].value != NULL) {
+            free(_resources[i].value);
+            _resources[i].value = NULL;
+        }
+    }
+}
+
+bool CoAPServer::begin() {
+    if (_socket >= 0) {
+        end();
+    }
+    _rxBuffer = (uint8_t*)malloc(COAP_MAX_PACKET_SIZE);
+    _txBuffer = (uint8_t*)malloc(COAP_MAX_PACKET_SIZE);
+    if ((_rxBuffer == NULL) || (_txBuffer == NULL)) {
+        printf("\r\n[ERROR] %s malloc buffers failed\n", __FUNCTION__);
+        end();
+        return false;
+    }
+    _socket = serverDrv.startServer(_port, UDP_MODE, BLOCKING_MODE);
+    if (_socket < 0) {
+        printf("\r\n[ERROR] %s failed to open UDP port %d\n", __FUNCTION__, _port);
+        end();
+        return false;
+    }
+    return true;
+}
+
+void CoAPServer::end() {
+    if (_socket >= 0) {
+        serverDrv.stopSocket(_socket);
+        _socket = -1;
+    }
+    memset(_observers, 0, sizeof(_observers));
+    for (uint8_t i = 0; i < COAP_SERVER_DEDUP_SIZE; i++) {
+        if (_dedup[i].data != NULL) {
+            free(_dedup[i].data);
+        }
+    }
+    memset(_dedup, 0, sizeof(_dedup));
+    freeBlock1();
+    if (_rxBuffer != NULL) {
+        free(_rxBuffer);
+        _rxBuffer = NULL;
+    }
+    if (_txBuffer != NULL) {
+        free(_txBuffer);
+        _txBuffer = NULL;
+    }
+}
+
+bool CoAPServer::addResource(const char* uri, CoAPResourceHandler handler, bool observable) {
+    coap_resource_t* res;
+
+    while (*uri == '/') {
+        uri++;
+    }
+    if (strlen(uri) >= COAP_MAX_URI) {
+        printf("\r\n[ERROR] %s URI too long\n", __FUNCTION__);
+        return false;
+    }
+    if (findResource(uri) >= 0) {
+        printf("\r\n[ERROR] %s %s already added\n", __FUNCTION__, uri);
+        return false;
+    }
+    if (_resourceCount >= COAP_SERVER_MAX_RESOURCES) {
+        printf("\r\n[ERROR] %s too many resources\n", __FUNCTION__);
+        return false;
+    }
+    res = &_resources[_resourceCount++];
+    strcpy(res->uri, uri);
+    res->handler = handler;
+    res->observable = observable ? 1 : 0;
+    res->value = NULL;
+    res->length = 0;
+    res->contentFormat = COAP_FORMAT_NONE;
+    res->seq = 0;
+    return true;
+}
+
+bool CoAPServer::setValue(const char* uri, const uint8_t* payload, uint32_t length, uint16_t contentFormat, bool confirmable) {
+    int index = findResource(uri);
+    coap_resource_t* res;
+
+    if (index < 0) {
+        printf("\r\n[ERROR] %s %s not found, call addResource() first\n", __FUNCTION__, uri);
+        return false;
+    }
+    res = &_resources[index];
+    if ((length != res->length) || (res->value == NULL)) {
+        uint8_t* value = (uint8_t*)realloc(res->value, (length ? length : 1));
+        if (value == NULL) {
+            printf("\r\n[ERROR] %s malloc %lu byte value failed\n", __FUNCTION__, length);
+            return false;
+        }
+        res->value = value;
+    }
+    memcpy(res->value, payload, length);
+    res->length = length;
+    res->contentFormat = contentFormat;
+    if (res->observable) {
+        notify(index, confirmable);
+    }
+    return true;
+}
+
+bool CoAPServer::setValue(const char* uri, const char* value, bool confirmable) {
+    return setValue(uri, (const uint8_t*)value, strlen(value), COAP_FORMAT_TEXT, confirmable);
+}
+
+void CoAPServer::setBlockSize(uint16_t size) {
+    for (uint8_t szx = 0; szx <= COAP_BLOCK_SZX_MAX; szx++) {
+        if (COAP_BLOCK_SIZE(szx) == size) {
+            _szx = szx;
+            return;
+        }
+    }
+    printf("\r\n[ERROR] %s block size must be a power of 2 from 16 to 1024\n", __FUNCTION__);
+}
+
+void CoAPServer::setMaxBodySize(uint32_t size) {
+    _maxBodySize = size;
+}
+
+void CoAPServer::setAckTimeout(uint32_t ms, uint8_t maxRetransmit) {
+    _ackTimeout = (ms < 100) ? 100 : ms;
+    _maxRetransmit = (maxRetransmit > 8) ? 8 : maxRetransmit;
+}
+
+void CoAPServer::loop() {
+    CoAPPacket packet;
+    uint32_t ip;
+    uint16_t port;
+    int length;
+
+    if (_socket < 0) {
+        return;
+    }
+    for (uint8_t i = 0; i < COAP_LOOP_MAX_PACKETS; i++) {
+        length = serverDrv.recvfromData(_socket, _rxBuffer, COAP_MAX_PACKET_SIZE, true, &ip, &port);
+        if (length <= 0) {
+            break;
+        }
+        if (packet.parse(_rxBuffer, length)) {
+            handleMessage(packet, ip, port);
+        } else if ((length >= 4) && (((_rxBuffer[0] >> 4) & 0x03) == COAP_CON)) {
+            // message format error in a confirmable message (RFC 7252 4.2)
+            sendEmpty(COAP_RST, ((_rxBuffer[2] << 8) | _rxBuffer[3]), ip, port);
+        }
+    }
+    checkTimeouts();
+}
+
+uint8_t CoAPServer::observerCount(const char* uri) {
+    int index = -1;
+    uint8_t count = 0;
+
+    if (uri != NULL) {
+        index = findResource(uri);
+        if (index < 0) {
+            return 0;
+        }
+    }
+    for (uint8_t i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++) {
+        if (_observers[i].used && ((index < 0) || (_observers[i].resource == index))) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void CoAPServer::printInfo() {
+    printf("\r\n------------------------------------------\r\n");
+    printf("CoAP server on UDP port %d, %s\r\n", _port, ((_socket >= 0) ? "running" : "stopped"));
+    printf("Requests %lu, duplicates %lu, notifications %lu, retransmitted %lu\r\n", _requests, _duplicates, _notifications, _retransmitted);
+    for (uint8_t i = 0; i < _resourceCount; i++) {
+        coap_resource_t* res = &_resources[i];
+        printf("  /%s: %lu bytes%s", res->uri, res->length, (res->handler ? ", handler" : ""));
+        if (res->observable) {
+            printf(", %u observers, seq %lu", observerCount(res->uri), res->seq);
+        }
+        printf("\r\n");
+    }
+    printf("\r\n------------------------------------------\r\n");
+}
+
+int CoAPServer::findResource(const char* uri) {
+    while (*uri == '/') {
+        uri++;
+    }
+    for (uint8_t i = 0; i < _resourceCount; i++) {
+        if (strcmp(_resources[i].uri, uri) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void CoAPServer::handleMessage(CoAPPacket& packet, uint32_t ip, uint16_t port) {
+    if ((packet.type == COAP_ACK) || (packet.type == COAP_RST)) {
+        // answers to notifications, RST also rejects non-confirmable ones (RFC 7641 3.6)
+        for (uint8_t i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++) {
+            coap_observer_t* observer = &_observers[i];
+            if (observer->used && (observer->ip == ip) && (observer->port == port) && (observer->messageId == packet.messageId)) {
+                if (packet.type == COAP_RST) {
+                    removeObserver(observer);
+                } else {
+                    observer->awaitingAck = 0;
+                }
+            }
+        }
+        return;
+    }
+    if (!packet.isRequest()) {
+        // a ping, or a response the server never asked for
+        if (packet.type == COAP_CON) {
+            sendEmpty(COAP_RST, packet.messageId, ip, port);
+        }
+        return;
+    }
+    for (uint8_t i = 0; i < COAP_SERVER_DEDUP_SIZE; i++) {
+        coap_dedup_t* entry = &_dedup[i];
+        if ((entry->data != NULL) && (entry->ip == ip) && (entry->port == port) && (entry->messageId == packet.messageId)) {
+            // the response got lost, repeat it without running the handler again
+            _duplicates++;
+            transmit(entry->data, entry->length, ip, port);
+            return;
+        }
+    }
+    _requests++;
+    handleRequest(packet, ip, port);
+}
+
+void CoAPServer::handleRequest(CoAPPacket& packet, uint32_t ip, uint16_t port) {
+    CoAPPacket response;
+    CoAPRequest request;
+    coap_resource_t* res;
+    char path[COAP_MAX_URI];
+    char query[COAP_MAX_URI];
+    const uint8_t* body;
+    uint32_t length;
+    uint16_t contentFormat;
+    uint32_t observe;
+    uint8_t code;
+    bool block1 = false;
+    int index;
+
+    // piggybacked on the ACK for a confirmable request
+    response.type = (packet.type == COAP_CON) ? COAP_ACK : COAP_NON;
+    response.messageId = (packet.type == COAP_CON) ? packet.messageId : _nextMessageId++;
+    response.tokenLength = packet.tokenLength;
+    memcpy(response.token, packet.token, packet.tokenLength);
+
+    if (packet.hasUnknownCriticalOption()) {
+        response.code = COAP_BAD_OPTION;
+        respond(response, packet.messageId, ip, port);
+        return;
+    }
+    packet.getUriPath(path, sizeof(path));
+    packet.getUriQuery(query, sizeof(query));
+    index = findResource(path);
+    if (index < 0) {
+        response.code = COAP_NOT_FOUND;
+        respond(response, packet.messageId, ip, port);
+        return;
+    }
+    res = &_resources[index];
+
+    request.method = packet.code;
+    request.uri = res->uri;
+    request.query = query;
+    request.payload = packet.payload;
+    request.length = packet.payloadLength;
+    request.contentFormat = packet.contentFormat();
+    request.ip = IPAddress(ip);
+    request.port = port;
+    request.responsePayload = NULL;
+    request.responseLength = 0;
+    request.responseFormat = COAP_FORMAT_NONE;
+
+    if (packet.findOption(COAP_OPTION_BLOCK1) != NULL) {
+        if (!receiveBlock(packet, response, index, ip, port)) {
+            // 2.31 Continue or an error went out, the handler runs after the last block
+            return;
+        }
+        request.payload = _block1.body;
+        request.length = _block1.length;
+        block1 = true;
+    }
+
+    if (res->handler != NULL) {
+        code = res->handler(request);
+    } else {
+        code = (packet.code == COAP_GET) ? 0 : COAP_METHOD_NOT_ALLOWED;
+    }
+    if (code == 0) {
+        code = (packet.code == COAP_GET) ? COAP_CONTENT : ((packet.code == COAP_DELETE) ? COAP_DELETED : COAP_CHANGED);
+    }
+    response.code = code;
+
+    if (code < COAP_BAD_REQUEST) {
+        if (request.responsePayload != NULL) {
+            body = request.responsePayload;
+            length = request.responseLength;
+            contentFormat = request.responseFormat;
+        } else if (packet.code == COAP_GET) {
+            body = res->value;
+            length = res->length;
+            contentFormat = res->contentFormat;
+        } else {
+            body = NULL;
+            length = 0;
+            contentFormat = COAP_FORMAT_NONE;
+        }
+        if ((length > 0) && !addBody(response, &packet, body, length)) {
+            response.code = COAP_BAD_OPTION;
+        } else {
+            if (contentFormat != COAP_FORMAT_NONE) {
+                response.addUintOption(COAP_OPTION_CONTENT_FORMAT, contentFormat);
+            }
+            if ((packet.code == COAP_GET) && (code == COAP_CONTENT) && res->observable && packet.getUintOption(COAP_OPTION_OBSERVE, &observe)) {
+                if (observe == COAP_OBSERVE_REGISTER) {
+                    // without a free slot the response goes out without Observe, i.e. not registered
+                    if (addObserver(index, packet, ip, port)) {
+                        response.addUintOption(COAP_OPTION_OBSERVE, (res->seq & 0xFFFFFF));
+                    }
+                } else if (observe == COAP_OBSERVE_DEREGISTER) {
+                    for (uint8_t i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++) {
+                        coap_observer_t* observer = &_observers[i];
+                        if (observer->used && (observer->ip == ip) && (observer->port == port) && (observer->tokenLength == packet.tokenLength) && (memcmp(observer->token, packet.token, packet.tokenLength) == 0)) {
+                            removeObserver(observer);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (block1) {
+        uint32_t num;
+        bool more;
+        uint8_t szx;
+        packet.getBlockOption(COAP_OPTION_BLOCK1, &num, &more, &szx);
+        response.addBlockOption(COAP_OPTION_BLOCK1, num, false, szx);
+    }
+    respond(response, packet.messageId, ip, port);
+    if (block1) {
+        freeBlock1();
+    }
+}
+
+// Returns true when the last block arrived and the body is in _block1, otherwise the response was sent
+bool CoAPServer::receiveBlock(CoAPPacket& packet, CoAPPacket& response, uint8_t resource, uint32_t ip, uint16_t port) {
+    uint32_t num;
+    bool more;
+    uint8_t szx;
+    uint32_t offset;
+    uint32_t size;
+
+    if (!packet.getBlockOption(COAP_OPTION_BLOCK1, &num, &more, &szx)) {
+        response.code = COAP_BAD_OPTION;
+        respond(response, packet.messageId, ip, port);
+        return false;
+    }
+    offset = num * COAP_BLOCK_SIZE(szx);
+    if (num == 0) {
+        // one transfer at a time, a new one replaces an abandoned one
+        freeBlock1();
+        _block1.ip = ip;
+        _block1.port = port;
+        _block1.resource = resource;
+    }
+    if ((_block1.ip != ip) || (_block1.port != port) || (_block1.resource != resource) || (offset != _block1.length) || ((num > 0) && (_block1.body == NULL))) {
+        response.code = COAP_REQUEST_ENTITY_INCOMPLETE;
+        respond(response, packet.messageId, ip, port);
+        return false;
+    }
+    if ((offset + packet.payloadLength) > _maxBodySize) {
+        freeBlock1();
+        response.code = COAP_REQUEST_ENTITY_TOO_LARGE;
+        response.addUintOption(COAP_OPTION_SIZE1, _maxBodySize);
+        respond(response, packet.messageId, ip, port);
+        return false;
+    }
+    if ((offset + packet.payloadLength) > _block1.size) {
+        uint8_t* body;
+        // Size1 in the first block tells the whole length
+        if (!((num == 0) && packet.getUintOption(COAP_OPTION_SIZE1, &size) && (size <= _maxBodySize) && (size >= packet.payloadLength))) {
+            size = offset + (more ? (2 * COAP_BLOCK_SIZE(szx)) : packet.payloadLength);
+            if (size > _maxBodySize) {
+                size = _maxBodySize;
+            }
+        }
+        body = (uint8_t*)realloc(_block1.body, (size ? size : 1));
+        if (body == NULL) {
+            freeBlock1();
+            response.code = COAP_REQUEST_ENTITY_TOO_LARGE;
+            respond(response, packet.messageId, ip, port);
+            return false;
+        }
+        _block1.body = body;
+        _block1.size = size;
+    }
+    memcpy((_block1.body + offset), packet.payload, packet.payloadLength);
+    _block1.length = offset + packet.payloadLength;
+    _block1.updatedAt = millis();
+
+    if (more) {
+        // a smaller SZX asks the client to continue with smaller blocks
+        response.code = COAP_CONTINUE;
+        response.addBlockOption(COAP_OPTION_BLOCK1, num, true, ((szx < _szx) ? szx : _szx));
+        respond(response, packet.messageId, ip, port);
+        return false;
+    }
+    return true;
+}
+
+// Adds the requested Block2 block, or the first one when the body is larger than a block
+bool CoAPServer::addBody(CoAPPacket& response, const CoAPPacket* request, const uint8_t* body, uint32_t length) {
+    uint32_t num = 0;
+    bool more = false;
+    uint8_t szx = _szx;
+    bool requested = false;
+    uint32_t size;
+    uint32_t offset;
+
+    if ((request != NULL) && request->getBlockOption(COAP_OPTION_BLOCK2, &num, &more, &szx)) {
+        requested = true;
+        if (szx > _szx) {
+            num = (num * COAP_BLOCK_SIZE(szx)) / COAP_BLOCK_SIZE(_szx);
+            szx = _szx;
+        }
+    }
+    size = COAP_BLOCK_SIZE(szx);
+    offset = num * size;
+    if (!requested && (length <= size)) {
+        response.payload = body;
+        response.payloadLength = length;
+        return true;
+    }
+    if (offset >= length) {
+        return false;
+    }
+    more = ((offset + size) < length);
+    response.addBlockOption(COAP_OPTION_BLOCK2, num, more, szx);
+    if (num == 0) {
+        response.addUintOption(COAP_OPTION_SIZE2, length);
+    }
+    response.payload = body + offset;
+    response.payloadLength = more ? size : (length - offset);
+    return true;
+}
+
+void CoAPServer::respond(CoAPPacket& response, uint16_t requestId, uint32_t ip, uint16_t port) {
+    coap_dedup_t* entry;
+    int length;
+
+    length = response.serialize(_txBuffer, COAP_MAX_PACKET_SIZE);
+    if (length < 0) {
+        printf("\r\n[ERROR] %s response does not fit in %d bytes\n", __FUNCTION__, COAP_MAX_PACKET_SIZE);
+        return;
+    }
+    transmit(_txBuffer, length, ip, port);
+
+    entry = &_dedup[_dedupIndex];
+    _dedupIndex = (_dedupIndex + 1) % COAP_SERVER_DEDUP_SIZE;
+    if (entry->data != NULL) {
+        free(entry->data);
+    }
+    entry->data = (uint8_t*)malloc(length);
+    if (entry->data != NULL) {
+        memcpy(entry->data, _txBuffer, length);
+        entry->length = length;
+        entry->ip = ip;
+        entry->port = port;
+        entry->messageId = requestId;
+    }
+}
+
+bool CoAPServer::addObserver(uint8_t resource, CoAPPacket& packet, uint32_t ip, uint16_t port) {
+    coap_observer_t* observer = NULL;
+
+    // a client registering again replaces its entry (RFC 7641 4.1)
+    for (uint8_t i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++) {
+        if (_observers[i].used && (_observers[i].resource == resource) && (_observers[i].ip == ip) && (_observers[i].port == port)) {
+            observer = &_observers[i];
+            break;
+        }
+    }
+    for (uint8_t i = 0; (observer == NULL) && (i < COAP_SERVER_MAX_OBSERVERS); i++) {
+        if (!_observers[i].used) {
+            observer = &_observers[i];
+        }
+    }
+    if (observer == NULL) {
+        return false;
+    }
+    memset(observer, 0, sizeof(coap_observer_t));
+    observer->used = 1;
+    observer->resource = resource;
+    observer->ip = ip;
+    observer->port = port;
+    observer->tokenLength = packet.tokenLength;
+    memcpy(observer->token, packet.token, packet.tokenLength);
+    return true;
+}
+
+void CoAPServer::removeObserver(coap_observer_t* observer) {
+    memset(observer, 0, sizeof(coap_observer_t));
+}
+
+void CoAPServer::notify(uint8_t resource, bool confirmable) {
+    _resources[resource].seq++;
+    for (uint8_t i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++) {
+        coap_observer_t* observer = &_observers[i];
+        if (observer->used && (observer->resource == resource)) {
+            observer->nonCount++;
+            sendNotification(observer, (confirmable || (observer->nonCount >= COAP_NOTIFY_CON_INTERVAL)), true);
+        }
+    }
+}
+
+void CoAPServer::sendNotification(coap_observer_t* observer, bool confirmable, bool newMessage) {
+    coap_resource_t* res = &_resources[observer->resource];
+    CoAPPacket packet;
+    int length;
+
+    if (_socket < 0) {
+        return;
+    }
+    // the newest state takes over the retransmission of an outstanding one (RFC 7641 4.5.2)
+    if (observer->awaitingAck) {
+        confirmable = true;
+    }
+    if (newMessage) {
+        observer->messageId = _nextMessageId++;
+    }
+    packet.type = confirmable ? COAP_CON : COAP_NON;
+    packet.code = COAP_CONTENT;
+    packet.messageId = observer->messageId;
+    packet.tokenLength = observer->tokenLength;
+    memcpy(packet.token, observer->token, observer->tokenLength);
+    packet.addUintOption(COAP_OPTION_OBSERVE, (res->seq & 0xFFFFFF));
+    if (res->contentFormat != COAP_FORMAT_NONE) {
+        packet.addUintOption(COAP_OPTION_CONTENT_FORMAT, res->contentFormat);
+    }
+    // a large value goes out as its first block, the client fetches the rest (RFC 7959 3.4)
+    addBody(packet, NULL, res->value, res->length);
+
+    length = packet.serialize(_txBuffer, COAP_MAX_PACKET_SIZE);
+    if (length < 0) {
+        return;
+    }
+    transmit(_txBuffer, length, observer->ip, observer->port);
+    _notifications++;
+
+    if (confirmable) {
+        observer->nonCount = 0;
+        if (!observer->awaitingAck) {
+            observer->awaitingAck = 1;
+            observer->retransmits = 0;
+            observer->timeout = ackTimeout();
+            observer->sentAt = millis();
+        }
+    }
+}
+
+void CoAPServer::sendEmpty(uint8_t type, uint16_t messageId, uint32_t ip, uint16_t port) {
+    uint8_t buf[4];
+
+    buf[0] = (COAP_VERSION << 6) | (type << 4);
+    buf[1] = COAP_EMPTY;
+    buf[2] = (messageId >> 8) & 0xFF;
+    buf[3] = messageId & 0xFF;
+    transmit(buf, sizeof(buf), ip, port);
+}
+
+bool CoAPServer::transmit(const uint8_t* data, uint16_t length, uint32_t ip, uint16_t port) {
+    if (_socket < 0) {
+        return false;
+    }
+    return serverDrv.sendtoData(_socket, data, length, ip, port);
+}
+
+void CoAPServer::freeBlock1() {
+    if (_block1.body != NULL) {
+        free(_block1.body);
+    }
+    memset(&_block1, 0, sizeof(_block1));
+}
+
+void CoAPServer::checkTimeouts() {
+    uint32_t now = millis();
+
+    for (uint8_t i = 0; i < COAP_SERVER_MAX_OBSERVERS; i++) {
+        coap_observer_t* observer = &_observers[i];
+        if (!observer->used || !observer->awaitingAck || ((now - observer->sentAt) < observer->timeout)) {
+            continue;
+        }
+        if (observer->retransmits >= _maxRetransmit) {
+            // the client went away without deregistering
+            removeObserver(observer);
+            continue;
+        }
+        observer->retransmits++;
+        observer->timeout *= 2;
+        observer->sentAt = now;
+        sendNotification(observer, true, false);
+        _retransmitted++;
+    }
+    // drop a Block1 transfer the client abandoned
+    if ((_block1.body != NULL) && ((now - _block1.updatedAt) > (_ackTimeout * ((1UL << (_maxRetransmit + 1)) - 1)))) {
+        freeBlock1();
+    }
+}
+
+uint32_t CoAPServer::ackTimeout() {
+    return (_ackTimeout + (rand() % ((_ackTimeout / 2) + 1)));
+}
@@ -0,0 +1,144 @@
+#ifndef CoAPServer_h
+#define CoAPServer_h
+
+#include <Arduino.h>
+#include "IPAddress.h"
+#include "server_drv.h"
+#include "CoAPPacket.h"
+
+#define COAP_SERVER_MAX_RESOURCES       8
+#define COAP_SERVER_MAX_OBSERVERS       8
+// Responses kept to answer retransmitted requests without running the handler again
+#define COAP_SERVER_DEDUP_SIZE          4
+// Every Nth non-confirmable notification is sent confirmable to find observers that went away
+#define COAP_NOTIFY_CON_INTERVAL        16
+
+typedef struct {
+    uint8_t method;                 // COAP_GET, COAP_POST, COAP_PUT or COAP_DELETE
+    const char* uri;                // resource path given to addResource()
+    const char* query;              // Uri-Query options joined with '&', "" without query
+    const uint8_t* payload;         // whole body, Block1 blocks are already reassembled
+    uint32_t length;
+    uint16_t contentFormat;         // COAP_FORMAT_NONE if not given
+    IPAddress ip;
+    uint16_t port;
+    // Set by the handler to answer with this body instead of the value from setValue(),
+    // it must stay valid until the handler returns
+    const uint8_t* responsePayload;
+    uint32_t responseLength;
+    uint16_t responseFormat;
+} CoAPRequest;
+
+// Returns the response code, or 0 for 2.05 Content to GET, 2.02 Deleted to DELETE and 2.04 Changed otherwise
+typedef uint8_t (*CoAPResourceHandler)(CoAPRequest& request);
+
+typedef struct {
+    char uri[COAP_MAX_URI];
+    CoAPResourceHandler handler;
+    uint8_t observable;
+    uint8_t* value;                 // representation served to GET, set by setValue()
+    uint32_t length;
+    uint16_t contentFormat;
+    uint32_t seq;                   // Observe sequence number
+} coap_resource_t;
+
+typedef struct {
+    uint8_t used;
+    uint8_t resource;
+    uint8_t tokenLength;
+    uint8_t token[COAP_MAX_TOKEN_LENGTH];
+    uint32_t ip;
+    uint16_t port;
+    uint16_t messageId;             // last notification
+    uint8_t awaitingAck;
+    uint8_t retransmits;
+    uint8_t nonCount;               // non-confirmable notifications since the last confirmable one
+    uint32_t sentAt;
+    uint32_t timeout;
+} coap_observer_t;
+
+typedef struct {
+    uint32_t ip;
+    uint16_t port;
+    uint16_t messageId;             // of the request
+    uint8_t* data;
+    uint16_t length;
+} coap_dedup_t;
+
+typedef struct {
+    uint8_t* body;                  // NULL while no Block1 transfer is in progress
+    uint32_t length;
+    uint32_t size;
+    uint32_t ip;
+    uint16_t port;
+    uint8_t resource;
+    uint32_t updatedAt;
+} coap_block1_t;
+
+class CoAPServer {
+    public:
+        CoAPServer(uint16_t port = COAP_DEFAULT_PORT);
+        ~CoAPServer();
+
+        bool begin();
+        void end();
+
+        // Without a handler the resource only answers GET with its value
+        bool addResource(const char* uri, CoAPResourceHandler handler = NULL, bool observable = false);
+        // Set the representation served to GET and notify observers, the value is copied
+        bool setValue(const char* uri, const uint8_t* payload, uint32_t length, uint16_t contentFormat = COAP_FORMAT_OCTET_STREAM, bool confirmable = false);
+        bool setValue(const char* uri, const char* value, bool confirmable = false);
+
+        // 16 to 1024 bytes, a power of 2
+        void setBlockSize(uint16_t size);
+        // Largest request body reassembled from Block1 blocks
+        void setMaxBodySize(uint32_t size);
+        void setAckTimeout(uint32_t ms, uint8_t maxRetransmit = COAP_MAX_RETRANSMIT);
+
+        // Serve requests and retransmit notifications, call often
+        void loop();
+
+        uint8_t observerCount(const char* uri = NULL);
+        void printInfo();
+
+    private:
+        int findResource(const char* uri);
+        void handleMessage(CoAPPacket& packet, uint32_t ip, uint16_t port);
+        void handleRequest(CoAPPacket& packet, uint32_t ip, uint16_t port);
+        bool receiveBlock(CoAPPacket& packet, CoAPPacket& response, uint8_t resource, uint32_t ip, uint16_t port);
+        bool addBody(CoAPPacket& response, const CoAPPacket* request, const uint8_t* body, uint32_t length);
+        void respond(CoAPPacket& response, uint16_t requestId, uint32_t ip, uint16_t port);
+        bool addObserver(uint8_t resource, CoAPPacket& packet, uint32_t ip, uint16_t port);
+        void removeObserver(coap_observer_t* observer);
+        void notify(uint8_t resource, bool confirmable);
+        void sendNotification(coap_observer_t* observer, bool confirmable, bool newMessage);
+        void sendEmpty(uint8_t type, uint16_t messageId, uint32_t ip, uint16_t port);
+        bool transmit(const uint8_t* data, uint16_t length, uint32_t ip, uint16_t port);
+        void freeBlock1();
+        void checkTimeouts();
+        uint32_t ackTimeout();
+
+        ServerDrv serverDrv;
+        uint16_t _port;
+        int _socket;
+        uint8_t* _rxBuffer;
+        uint8_t* _txBuffer;
+        coap_resource_t _resources[COAP_SERVER_MAX_RESOURCES];
+        uint8_t _resourceCount;
+        coap_observer_t _observers[COAP_SERVER_MAX_OBSERVERS];
+        coap_dedup_t _dedup[COAP_SERVER_DEDUP_SIZE];
+        uint8_t _dedupIndex;
+        coap_block1_t _block1;
+        uint16_t _nextMessageId;
+        uint8_t _szx;
+        uint32_t _maxBodySize;
+        uint32_t _ackTimeout;
+        uint8_t _maxRetransmit;
+
+        uint32_t _requests;
+        uint32_t _duplicates;
+        uint32_t _notifications;
+        uint32_t _retransmitted;
+};
+
+#endif
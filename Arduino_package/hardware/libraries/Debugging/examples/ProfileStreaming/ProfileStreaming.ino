@@ -0,0 +1,74 @@
+/*
+ This example shows where the CPU time, the task stacks and the heap go while
+ a camera channel is streamed to RTSP.
+
+ Every 5 seconds a sample is printed: CPU share and stack headroom of every
+ task, and the heap bytes held by each module (video, rtsp, lwip, ...).
+ Allocations are charged to the module of the task that makes them. Setup
+ code runs in the sketch task, so it is tagged with the module it sets up.
+ The heap figures per module need Tools > Heap Profiler set to Enable.
+
+ Set PROFILER_FORMAT_CSV or PROFILER_FORMAT_BINARY to log the samples on a PC
+ instead of reading them.
+ */
+
+#include "WiFi.h"
+#include "StreamIO.h"
+#include "VideoStream.h"
+#include "RTSP.h"
+#include "Profiler.h"
+
+#define CHANNEL 0
+
+VideoSetting config(CHANNEL);
+RTSP rtsp;
+StreamIO videoStreamer(1, 1);   // 1 Input Video -> 1 Output RTSP
+
+char ssid[] = "Network_SSID";   // your network SSID (name)
+char pass[] = "Password";       // your network password
+int status = WL_IDLE_STATUS;
+
+void setup() {
+    Serial.begin(115200);
+
+    // count allocations from here on, before the streaming chain is built
+    if (!Profiler.trackHeap()) {
+        Serial.println("Heap tracking start failed");
+    }
+
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to WPA SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+        delay(2000);
+    }
+
+    {
+        ProfilerTag tag("video");
+        Camera.configVideoChannel(CHANNEL, config);
+        Camera.videoInit();
+    }
+    {
+        ProfilerTag tag("rtsp");
+        rtsp.configVideo(config);
+        rtsp.begin();
+    }
+    {
+        ProfilerTag tag("streamio");
+        videoStreamer.registerInput(Camera.getStream(CHANNEL));
+        videoStreamer.registerOutput(rtsp);
+        if (videoStreamer.begin() != 0) {
+            Serial.println("StreamIO link start failed");
+        }
+    }
+    {
+        ProfilerTag tag("video");
+        Camera.channelBegin(CHANNEL);
+    }
+
+    Profiler.begin(5000, &Serial, PROFILER_FORMAT_TEXT);
+}
+
+void loop() {
+    delay(1000);
+}
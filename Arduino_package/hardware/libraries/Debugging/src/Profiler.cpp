@@ -0,0 +1,299 @@
+#include "Profiler.h"
+
+static const char* const task_state_names[] = {
+    "run", "ready", "block", "susp", "del", "inv"
+};
+
+ProfilerClass::ProfilerClass(void) {
+    memset(&_profile, 0, sizeof(_profile));
+}
+
+void ProfilerClass::samplerThread(const void* argument) {
+    ProfilerClass* self = (ProfilerClass*)argument;
+
+    while (self->_period) {
+        self->sample();
+        if (self->_output != NULL) {
+            switch (self->_format) {
+                case PROFILER_FORMAT_TEXT:
+                    self->printInfo();
+                    break;
+                case PROFILER_FORMAT_BINARY:
+                    self->printBinary(*self->_output);
+                    break;
+                default:
+                    self->printCSV(*self->_output);
+                    break;
+            }
+        }
+        delay(self->_period);
+    }
+    self->_thread = 0;
+    os_thread_terminate_arduino(os_thread_get_id_arduino());
+}
+
+void ProfilerClass::lock(void) {
+    if (_lock == 0) {
+        _lock = os_semaphore_create_arduino(1);
+    }
+    if (_lock) {
+        os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    }
+}
+
+void ProfilerClass::unlock(void) {
+    if (_lock) {
+        os_semaphore_release_arduino(_lock);
+    }
+}
+
+bool ProfilerClass::trackHeap(uint32_t entries) {
+    return (OsProfilerHeapEnable(entries) == 0);
+}
+
+void ProfilerClass::stopHeap(void) {
+    OsProfilerHeapDisable();
+}
+
+void ProfilerClass::begin(uint32_t period, Print* output, uint8_t format) {
+    if (period == 0) {
+        end();
+        return;
+    }
+    _output = output;
+    _format = format;
+    _period = period;
+    if (_thread == 0) {
+        // CPU shares of the first sample cover the time since boot
+        sample();
+        _thread = os_thread_create_arduino(samplerThread, this, OS_PRIORITY_LOW, 2048);
+        if (_thread == 0) {
+            printf("\r\n[ERROR] %s Profiler sampler thread create failed\n", __FUNCTION__);
+            _period = 0;
+        }
+    }
+}
+
+void ProfilerClass::end(void) {
+    // the sampler thread exits after its current delay
+    _period = 0;
+}
+
+bool ProfilerClass::sample(void) {
+    int ret;
+
+    lock();
+    ret = OsProfilerSample(&_profile);
+    unlock();
+    return (ret == 0);
+}
+
+void ProfilerClass::reset(void) {
+    OsProfilerReset();
+}
+
+int ProfilerClass::addModule(const char* name) {
+    return OsProfilerModuleAdd(name);
+}
+
+bool ProfilerClass::addTaskPrefix(const char* prefix, const char* module) {
+    int id = OsProfilerModuleAdd(module);
+
+    if (id < 0) {
+        return false;
+    }
+    return (OsProfilerTaskPrefixAdd(prefix, (uint8_t)id) == 0);
+}
+
+int ProfilerClass::tag(const char* module) {
+    int id = OsProfilerModuleAdd(module);
+
+    if (id < 0) {
+        return -1;
+    }
+    return OsProfilerTagSet((uint8_t)id);
+}
+
+void ProfilerClass::untag(int previous) {
+    OsProfilerTagRestore(previous);
+}
+
+uint8_t ProfilerClass::taskCount(void) {
+    return _profile.task_count;
+}
+
+const char* ProfilerClass::taskName(uint8_t index) {
+    return (index < _profile.task_count) ? _profile.tasks[index].name : "";
+}
+
+const char* ProfilerClass::taskModule(uint8_t index) {
+    return (index < _profile.task_count) ? OsProfilerModuleName(_profile.tasks[index].module) : "";
+}
+
+uint16_t ProfilerClass::taskCpu(uint8_t index) {
+    return (index < _profile.task_count) ? _profile.tasks[index].cpu : 0;
+}
+
+uint32_t ProfilerClass::taskStackFree(uint8_t index) {
+    return (index < _profile.task_count) ? _profile.tasks[index].stack_free : 0;
+}
+
+uint8_t ProfilerClass::moduleCount(void) {
+    return _profile.module_count;
+}
+
+int ProfilerClass::moduleIndex(const char* name) {
+    return OsProfilerModuleFind(name);
+}
+
+const char* ProfilerClass::moduleName(uint8_t index) {
+    return (index < _profile.module_count) ? _profile.modules[index].name : "";
+}
+
+uint32_t ProfilerClass::moduleBytes(uint8_t index) {
+    return (index < _profile.module_count) ? _profile.modules[index].bytes : 0;
+}
+
+uint32_t ProfilerClass::modulePeak(uint8_t index) {
+    return (index < _profile.module_count) ? _profile.modules[index].peak : 0;
+}
+
+uint32_t ProfilerClass::moduleAllocs(uint8_t index) {
+    return (index < _profile.module_count) ? _profile.modules[index].allocs : 0;
+}
+
+uint16_t ProfilerClass::moduleCpu(uint8_t index) {
+    return (index < _profile.module_count) ? _profile.modules[index].cpu : 0;
+}
+
+uint32_t ProfilerClass::heapFree(void) {
+    return _profile.heap_free;
+}
+
+uint32_t ProfilerClass::heapMinFree(void) {
+    return _profile.heap_min_free;
+}
+
+uint32_t ProfilerClass::heapLargestBlock(void) {
+    return _profile.heap_largest;
+}
+
+void ProfilerClass::printInfo(void) {
+    lock();
+    printf("\r\n------------------------------------------\r\n");
+    printf("Profile at %lu ms, CPU over the last %lu ms:\r\n", _profile.timestamp, _profile.interval);
+    printf("%-12s %-8s %-6s %4s %7s %8s\r\n", "task", "module", "state", "prio", "cpu %", "stack");
+    for (int i = 0; i < _profile.task_count; i++) {
+        os_task_profile_t* task = &_profile.tasks[i];
+        printf("%-12s %-8s %-6s %4u %3u.%u %% %8lu\r\n", task->name, OsProfilerModuleName(task->module), task_state_names[(task->state < 5) ? task->state : 5],
+               task->priority, (task->cpu / 10), (task->cpu % 10), task->stack_free);
+    }
+    if (_profile.heap_tracking) {
+        printf("%-12s %10s %10s %8s %6s %7s\r\n", "module", "bytes", "peak", "allocs", "failed", "cpu %");
+        for (int i = 0; i < _profile.module_count; i++) {
+            os_module_profile_t* module = &_profile.modules[i];
+            printf("%-12s %10lu %10lu %8lu %6lu %3u.%u %%\r\n", module->name, module->bytes, module->peak, module->allocs, module->failed,
+                   (module->cpu / 10), (module->cpu % 10));
+        }
+        if (_profile.heap_untracked) {
+            printf("Not charged to a module: %lu bytes\r\n", _profile.heap_untracked);
+        }
+    }
+    printf("Heap free: %lu bytes, minimum ever: %lu, largest block: %lu\r\n", _profile.heap_free, _profile.heap_min_free, _profile.heap_largest);
+    printf("------------------------------------------\r\n");
+    unlock();
+}
+
+void ProfilerClass::printCSV(Print& output, bool header) {
+    char line[96];
+
+    lock();
+    if (header) {
+        output.println("#H,ms,heap_free,heap_min_free,largest_block,untracked");
+        output.println("#T,ms,task,module,cpu_permille,stack_free,priority");
+        output.println("#M,ms,module,bytes,peak,allocs,failed,cpu_permille");
+    }
+    snprintf(line, sizeof(line), "H,%lu,%lu,%lu,%lu,%lu", _profile.timestamp, _profile.heap_free, _profile.heap_min_free, _profile.heap_largest, _profile.heap_untracked);
+    output.println(line);
+    for (int i = 0; i < _profile.task_count; i++) {
+        os_task_profile_t* task = &_profile.tasks[i];
+        snprintf(line, sizeof(line), "T,%lu,%s,%s,%u,%lu,%u", _profile.timestamp, task->name, OsProfilerModuleName(task->module), task->cpu, task->stack_free, task->priority);
+        output.println(line);
+    }
+    for (int i = 0; (i < _profile.module_count) && _profile.heap_tracking; i++) {
+        os_module_profile_t* module = &_profile.modules[i];
+        snprintf(line, sizeof(line), "M,%lu,%s,%lu,%lu,%lu,%lu,%u", _profile.timestamp, module->name, module->bytes, module->peak, module->allocs, module->failed, module->cpu);
+        output.println(line);
+    }
+    unlock();
+}
+
+static void frame_write(Print& output, const void* data, size_t length, uint16_t* sum) {
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    for (size_t i = 0; i < length; i++) {
+        *sum += bytes[i];
+    }
+    output.write(bytes, length);
+}
+
+void ProfilerClass::printBinary(Print& output) {
+    uint8_t header[5];
+    uint16_t sum = 0;
+    uint16_t length;
+    uint8_t counts[2];
+    uint8_t modules;
+    char name[OS_PROFILER_NAME_LEN];
+
+    lock();
+    modules = _profile.heap_tracking ? _profile.module_count : 0;
+    length = (6 * 4) + 2 + (_profile.task_count * (OS_PROFILER_NAME_LEN + 8)) + (modules * (OS_PROFILER_NAME_LEN + 18));
+    header[0] = PROFILER_FRAME_MAGIC_0;
+    header[1] = PROFILER_FRAME_MAGIC_1;
+    header[2] = PROFILER_FRAME_VERSION;
+    header[3] = length & 0xFF;
+    header[4] = length >> 8;
+    output.write(header, sizeof(header));
+
+    frame_write(output, &_profile.timestamp, 4, &sum);
+    frame_write(output, &_profile.interval, 4, &sum);
+    frame_write(output, &_profile.heap_free, 4, &sum);
+    frame_write(output, &_profile.heap_min_free, 4, &sum);
+    frame_write(output, &_profile.heap_largest, 4, &sum);
+    frame_write(output, &_profile.heap_untracked, 4, &sum);
+    counts[0] = _profile.task_count;
+    counts[1] = modules;
+    frame_write(output, counts, 2, &sum);
+    for (int i = 0; i < _profile.task_count; i++) {
+        os_task_profile_t* task = &_profile.tasks[i];
+        frame_write(output, task->name, OS_PROFILER_NAME_LEN, &sum);
+        frame_write(output, &task->cpu, 2, &sum);
+        frame_write(output, &task->stack_free, 4, &sum);
+        frame_write(output, &task->priority, 1, &sum);
+        frame_write(output, &task->module, 1, &sum);
+    }
+    for (int i = 0; i < modules; i++) {
+        os_module_profile_t* module = &_profile.modules[i];
+        memset(name, 0, sizeof(name));
+        strncpy(name, module->name, (OS_PROFILER_NAME_LEN - 1));
+        frame_write(output, name, OS_PROFILER_NAME_LEN, &sum);
+        frame_write(output, &module->bytes, 4, &sum);
+        frame_write(output, &module->peak, 4, &sum);
+        frame_write(output, &module->allocs, 4, &sum);
+        frame_write(output, &module->failed, 4, &sum);
+        frame_write(output, &module->cpu, 2, &sum);
+    }
+    output.write((uint8_t)(sum & 0xFF));
+    output.write((uint8_t)(sum >> 8));
+    unlock();
+}
+
+ProfilerTag::ProfilerTag(const char* module) {
+    _previous = Profiler.tag(module);
+}
+
+ProfilerTag::~ProfilerTag(void) {
+    Profiler.untag(_previous);
+}
+
+ProfilerClass Profiler;
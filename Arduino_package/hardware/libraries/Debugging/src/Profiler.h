@@ -0,0 +1,107 @@
+#ifndef Profiler_h
+#define Profiler_h
+
+#include <Arduino.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "os_profiler_drv.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#define PROFILER_FORMAT_TEXT            0
+#define PROFILER_FORMAT_CSV             1
+#define PROFILER_FORMAT_BINARY          2
+
+// Binary sample frame, little endian:
+//   0xA5 0x50, version, payload length (2 bytes), payload, 16 bit sum of the payload bytes
+// Payload:
+//   timestamp, interval, heap free, heap minimum free, largest free block, untracked bytes (4 bytes each),
+//   task count, module count (1 byte each),
+//   per task:   name (12 bytes), cpu (2), stack free (4), priority (1), module (1)
+//   per module: name (12 bytes), bytes (4), peak (4), allocations (4), failed (4), cpu (2)
+#define PROFILER_FRAME_MAGIC_0          0xA5
+#define PROFILER_FRAME_MAGIC_1          0x50
+#define PROFILER_FRAME_VERSION          1
+
+// CPU share per task, stack headroom per task and heap bytes per module.
+// CPU shares cover the time between two samples and come from the FreeRTOS run time counter,
+// which counts in ticks: tasks that run for less than a tick at a time are undercounted.
+// Heap use is only charged to modules once trackHeap() has been called.
+class ProfilerClass {
+    public:
+        ProfilerClass(void);
+
+        // Start charging allocations to modules, entries is the number of live allocations tracked.
+        // Needs Tools > Heap Profiler set to Enable, otherwise returns false
+        bool trackHeap(uint32_t entries = OS_PROFILER_HEAP_ENTRIES);
+        void stopHeap(void);
+
+        // Sample every period ms in the background, and print each sample to output
+        void begin(uint32_t period = 1000, Print* output = NULL, uint8_t format = PROFILER_FORMAT_CSV);
+        void end(void);
+
+        bool sample(void);
+        // Clear module peaks and allocation counters
+        void reset(void);
+
+        // Returns the module id, or -1 if there are too many modules
+        int addModule(const char* name);
+        // Charge tasks whose name starts with prefix to module, the module is added if needed
+        bool addTaskPrefix(const char* prefix, const char* module);
+        // Charge what the calling task allocates to module until untag(), returns the previous tag
+        int tag(const char* module);
+        void untag(int previous);
+
+        uint8_t taskCount(void);
+        const char* taskName(uint8_t index);
+        const char* taskModule(uint8_t index);
+        uint16_t taskCpu(uint8_t index);            // 0.1 %
+        uint32_t taskStackFree(uint8_t index);      // bytes
+
+        uint8_t moduleCount(void);
+        int moduleIndex(const char* name);
+        const char* moduleName(uint8_t index);
+        uint32_t moduleBytes(uint8_t index);
+        uint32_t modulePeak(uint8_t index);
+        uint32_t moduleAllocs(uint8_t index);
+        uint16_t moduleCpu(uint8_t index);          // 0.1 %
+
+        uint32_t heapFree(void);
+        uint32_t heapMinFree(void);
+        uint32_t heapLargestBlock(void);
+
+        void printInfo(void);
+        void printCSV(Print& output, bool header = false);
+        void printBinary(Print& output);
+
+    private:
+        static void samplerThread(const void* argument);
+        void lock(void);
+        void unlock(void);
+
+        os_profile_t _profile;
+        uint32_t _lock = 0;
+        volatile uint32_t _period = 0;
+        Print* _output = NULL;
+        uint8_t _format = PROFILER_FORMAT_CSV;
+        uint32_t _thread = 0;
+};
+
+// Charge the allocations of the calling task to a module for the lifetime of the object
+class ProfilerTag {
+    public:
+        ProfilerTag(const char* module);
+        ~ProfilerTag(void);
+
+    private:
+        int _previous;
+};
+
+extern ProfilerClass Profiler;
+
+#endif
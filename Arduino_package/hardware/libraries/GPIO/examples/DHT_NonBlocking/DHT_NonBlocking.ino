@@ -0,0 +1,55 @@
+/*
+ Example reading two DHT sensors without blocking the loop
+
+ startRead() returns at once. The start signal is timed by a timer and the
+ response is timestamped by pin interrupts, so loop() keeps running while the
+ sensors are read. Each sensor is read at most once every 2 seconds, asking
+ earlier just starts the reading when the 2 seconds are up.
+ */
+
+#include "DHT.h"
+
+DHT dhtIndoor(8, DHT11);
+DHT dhtOutdoor(9, DHT22);
+
+uint32_t loops = 0;
+
+void printSensor(const char* name, DHT& dht) {
+    Serial.print(name);
+    if (!dht.valid()) {
+        Serial.println(F(": read failed"));
+        return;
+    }
+    Serial.print(F(": humidity "));
+    Serial.print(dht.humidity());
+    Serial.print(F("%, temperature "));
+    Serial.print(dht.temperature());
+    Serial.println(F("°C"));
+}
+
+void setup() {
+    Serial.begin(115200);
+    dhtIndoor.begin();
+    dhtOutdoor.begin();
+    dhtIndoor.startRead();
+    dhtOutdoor.startRead();
+}
+
+void loop() {
+    loops++;
+
+    if (dhtIndoor.ready()) {
+        printSensor("Indoor", dhtIndoor);
+        dhtIndoor.startRead();
+    }
+    if (dhtOutdoor.ready()) {
+        printSensor("Outdoor", dhtOutdoor);
+        dhtOutdoor.startRead();
+        Serial.print(F("Loops since the last reading: "));
+        Serial.println(loops);
+        loops = 0;
+    }
+
+    // other work goes here, e.g. camera or network handling
+    delay(10);
+}
@@ -25,8 +25,35 @@
 
 #include "DHT.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "gpio_irq_api.h"
+#include "gpio_irq_ex_api.h"
+#include "us_ticker_api.h"
+
+extern void *gpio_pin_struct[];
+
+#ifdef __cplusplus
+}
+#endif
+
 #define MIN_INTERVAL 2000 /**< min interval value */
-#define TIMEOUT    UINT32_MAX /**< Used programmatically for timeout. Not a timeout duration. Type: uint32_t. */
+#define READ_TIMEOUT 100 /**< ms read() waits for a reading, start signal included */
+#define CAPTURE_TIME 10 /**< ms from the end of the start signal until the edges are decoded, a reading takes about 5 ms */
+#define BIT_ONE_PERIOD 100 /**< us between falling edges above which a bit is a 1: 50 us low + 26 us or 70 us high */
+#define BIT_MIN_PERIOD 60 /**< us, shorter or longer periods mean an edge was lost */
+#define BIT_MAX_PERIOD 200
+
+enum {
+    DHT_IDLE = 0,
+    DHT_WAITING,      // for MIN_INTERVAL to pass since the previous reading
+    DHT_START,        // data line held low
+    DHT_CAPTURE,      // timestamping falling edges
+};
+
+static DHT *dht_sensors[DHT_MAX_SENSORS];
 
 /*!
  *  @brief  Instantiates a new DHT class
@@ -47,31 +74,65 @@ DHT::DHT(uint8_t pin, uint8_t type, uint8_t count) {
     _port = digitalPinToPort(pin);
 #endif
 
+    _timer = 0;
+    _state = DHT_IDLE;
+    _edgeCount = 0;
+    _lastresult = false;
+    _hasdata = false;
+    _lastgoodtime = 0;
+    // Note that count is now ignored as the response is timed from edge interrupts.
+}
 
-    // 1 millisecond timeout for
-    _maxcycles = microsecondsToClockCycles(1000);
-
-    // reading pulses from DHT sensor.
-    // Note that count is now ignored as the DHT reading algorithm adjusts itself
-    // basd on the speed of the processor.
+/*!
+ *  @brief  Stops a reading in progress and releases the pin
+ */
+DHT::~DHT() {
+    if (_timer) {
+        os_timer_stop_arduino(_timer);
+        os_timer_delete_arduino(_timer);
+    }
+    for (int i = 0; i < DHT_MAX_SENSORS; i++) {
+        if (dht_sensors[i] == this) {
+            digitalClearIrqHandler(_pin);
+            dht_sensors[i] = NULL;
+        }
+    }
 }
 
 /*!
- *  @brief  Setup sensor pins and set pull timings
+ *  @brief  Setup sensor pins and the timer that sequences a reading
  *  @param  usec
- *          Optionally pass pull-up time (in microseconds) before DHT reading
- *starts. Default is 55 (see function declaration in DHT.h).
+ *          Ignored, kept for compatibility. The response is timed from
+ *edge interrupts wherever it starts.
  */
 void DHT::begin(uint8_t usec) {
+    (void)(usec);
+
     // set up the pins!
     pinMode(_pin, INPUT_PULLUP);
     // Using this value makes sure that millis() - lastreadtime will be
     // >= MIN_INTERVAL right away. Note that this assignment wraps around,
     // but so will the subtraction.
     _lastreadtime = millis() - MIN_INTERVAL;
-    DEBUG_PRINT("DHT max clock cycles: ");
-    DEBUG_PRINTLN(_maxcycles, DEC);
-    pullTime = usec;
+
+    if (_timer == 0) {
+        _timer = os_timer_create_arduino(timerHandler, 0, this);
+        if (_timer == 0) {
+            printf("\r\n[ERROR] %s DHT timer create failed\n", __FUNCTION__);
+        }
+    }
+    for (int i = 0; i < DHT_MAX_SENSORS; i++) {
+        if (dht_sensors[i] == this) {
+            return;
+        }
+    }
+    for (int i = 0; i < DHT_MAX_SENSORS; i++) {
+        if (dht_sensors[i] == NULL) {
+            dht_sensors[i] = this;
+            return;
+        }
+    }
+    printf("\r\n[ERROR] %s more than %d DHT sensors\n", __FUNCTION__, DHT_MAX_SENSORS);
 }
 
 /*!
@@ -85,9 +146,28 @@ void DHT::begin(uint8_t usec) {
  *	@return Temperature value in selected scale
  */
 float DHT::readTemperature(bool S, bool force) {
+    if (!read(force)) {
+        return NAN;
+    }
+    return convertTemperature(S);
+}
+
+/*!
+ *  @brief  Temperature of the last good reading
+ *  @param  S
+ *          Scale. Boolean value:
+ *					- true = Fahrenheit
+ *					- false = Celcius
+ *	@return Temperature value in selected scale, NAN before the first reading
+ */
+float DHT::temperature(bool S) {
+    return convertTemperature(S);
+}
+
+float DHT::convertTemperature(bool S) {
     float f = NAN;
 
-    if (read(force)) {
+    if (_hasdata) {
         switch (_type) {
             case DHT11:
                 f = data[2];
@@ -148,8 +228,23 @@ float DHT::convertFtoC(float f) { return (f - 32) * 0.55555; }
  *	@return float value - humidity in percent
  */
 float DHT::readHumidity(bool force) {
+    if (!read(force)) {
+        return NAN;
+    }
+    return convertHumidity();
+}
+
+/*!
+ *  @brief  Humidity of the last good reading
+ *	@return float value - humidity in percent, NAN before the first reading
+ */
+float DHT::humidity() {
+    return convertHumidity();
+}
+
+float DHT::convertHumidity() {
     float f = NAN;
-    if (read(force)) {
+    if (_hasdata) {
         switch (_type) {
             case DHT11:
             case DHT12:
@@ -222,158 +317,200 @@ float DHT::computeHeatIndex (float temperature, float percentHumidity, bool isFa
 
 /*!
  *  @brief  Read value from sensor or return last one from less than two
- *seconds.
+ *seconds. Waits for a reading started by startRead(), other tasks keep running
+ *meanwhile.
  *  @param  force
  *          true if using force mode
- *	@return float value
+ *	@return true if the reading passed its checksum
  */
 bool DHT::read(bool force) {
+    uint32_t start;
 
     // Check if sensor was read less than two seconds ago and return early to use last reading.
-    uint32_t currenttime = millis();
-    if (!force && ((currenttime - _lastreadtime) < MIN_INTERVAL)) {
+    if (!force && (_state == DHT_IDLE) && ((millis() - _lastreadtime) < MIN_INTERVAL)) {
         return _lastresult; // return last correct measurement
     }
-    _lastreadtime = currenttime;
+    if (!startRead(true)) {
+        return false;
+    }
+    start = millis();
+    while (!ready()) {
+        if ((millis() - start) > READ_TIMEOUT) {
+            DEBUG_PRINTLN(F("DHT reading did not complete."));
+            return false;
+        }
+        delay(1);
+    }
+    return _lastresult;
+}
 
-    // Reset 40 bits of received data to zero.
-    data[0] = data[1] = data[2] = data[3] = data[4] = 0;
-    //yield(); // Handle WiFi / reset software watchdog
+/*!
+ *  @brief  Start reading the sensor in the background
+ *  @param  force
+ *          true to start at once even if the previous reading is less than
+ *two seconds old
+ *	@return false if the sensor was not set up with begin()
+ */
+bool DHT::startRead(bool force) {
+    uint32_t elapsed;
 
-    // Send start signal.  See DHT datasheet for full signal diagram:
-    //   http://www.adafruit.com/datasheets/Digital%20humidity%20and%20temperature%20sensor%20AM2302.pdf
+    if (_timer == 0) {
+        return false;
+    }
+    if ((_state == DHT_WAITING) && force) {
+        os_timer_stop_arduino(_timer);
+        startSignal();
+        return true;
+    }
+    if (_state != DHT_IDLE) {
+        // already on its way
+        return true;
+    }
+    elapsed = millis() - _lastreadtime;
+    if (!force && (elapsed < MIN_INTERVAL)) {
+        _state = DHT_WAITING;
+        os_timer_start_arduino(_timer, (MIN_INTERVAL - elapsed));
+        return true;
+    }
+    startSignal();
+    return true;
+}
 
-    // Go into high impedence state to let pull-up raise data line level and
-    // start the reading process.
-    pinMode(_pin, INPUT_PULLUP);
-    delay(1);
+/*!
+ *  @brief  Check whether the reading started by startRead() is over
+ *	@return true when no reading is in progress
+ */
+bool DHT::ready() {
+    return (_state == DHT_IDLE);
+}
+
+/*!
+ *  @brief  Result of the last reading
+ *	@return true if the last reading passed its checksum
+ */
+bool DHT::valid() {
+    return _lastresult;
+}
+
+/*!
+ *  @brief  Age of the values returned by temperature() and humidity()
+ *	@return ms since the last good reading
+ */
+uint32_t DHT::age() {
+    return (millis() - _lastgoodtime);
+}
 
-    // First set data line low for a period according to sensor type
+// Send start signal.  See DHT datasheet for full signal diagram:
+//   http://www.adafruit.com/datasheets/Digital%20humidity%20and%20temperature%20sensor%20AM2302.pdf
+// The data line is held low by the timer instead of a delay, the caller goes on at once.
+void DHT::startSignal() {
+    _lastreadtime = millis();
+    _state = DHT_START;
     pinMode(_pin, OUTPUT);
     digitalWrite(_pin, LOW);
     switch (_type) {
         case DHT22:
         case DHT21:
-            delayMicroseconds(1100); // data sheet says "at least 1ms"
+            // data sheet says "at least 1ms", a timer of 3 ticks waits at least 2
+            os_timer_start_arduino(_timer, 3);
             break;
         case DHT11:
         default:
-            delay(20); // data sheet says at least 18ms, 20ms just to be safe
-        break;
+            os_timer_start_arduino(_timer, 20); // data sheet says at least 18ms, 20ms just to be safe
+            break;
     }
+}
 
-    uint32_t cycles[80];
-    {
-        // End the start signal by setting data line high for 40 microseconds.
-        pinMode(_pin, INPUT_PULLUP);
-
-        // Delay a moment to let sensor pull data line low.
-        delayMicroseconds(pullTime);
-
-        // Now start reading the data line to get the value from the DHT sensor.
+// Runs in the timer task and moves a reading through its phases.
+void DHT::timerHandler(void const *argument) {
+    DHT *self = (DHT *)argument;
 
-        // Turn off interrupts temporarily because the next sections
-        // are timing critical and we don't want any interruptions.
-        InterruptLock lock;
-        // First expect a low signal for ~80 microseconds followed by a high signal for ~80 microseconds again.
-        if (expectPulse(LOW) == TIMEOUT) {
-            DEBUG_PRINTLN(F("DHT timeout waiting for start signal low pulse."));
-            _lastresult = false;
-            return _lastresult;
-        }
-        if (expectPulse(HIGH) == TIMEOUT) {
-            DEBUG_PRINTLN(F("DHT timeout waiting for start signal high pulse."));
-            _lastresult = false;
-            return _lastresult;
-        }
+    switch (self->_state) {
+        case DHT_WAITING:
+            self->startSignal();
+            break;
+        case DHT_START:
+            // End the start signal by releasing the data line and timestamp every falling edge
+            // of the response from the interrupt handler.
+            self->_edgeCount = 0;
+            self->_state = DHT_CAPTURE;
+            digitalSetIrqHandler(self->_pin, irqHandler);
+            pinMode(self->_pin, INPUT_IRQ_FALL);
+            gpio_irq_pull_ctrl((gpio_irq_t *)gpio_pin_struct[self->_pin], PullUp);
+            os_timer_start_arduino(self->_timer, CAPTURE_TIME);
+            break;
+        case DHT_CAPTURE:
+            digitalClearIrqHandler(self->_pin);
+            pinMode(self->_pin, INPUT_PULLUP);
+            self->decode();
+            self->_state = DHT_IDLE;
+            break;
+        default:
+            break;
+    }
+}
 
-        // Now read the 40 bits sent by the sensor.  Each bit is sent as a 50
-        // microsecond low pulse followed by a variable length high pulse.  If the
-        // high pulse is ~28 microseconds then it's a 0 and if it's ~70 microseconds
-        // then it's a 1.  We measure the cycle count of the initial 50us low pulse
-        // and use that to compare to the cycle count of the high pulse to determine
-        // if the bit is a 0 (high state cycle count < low state cycle count), or a
-        // 1 (high state cycle count > low state cycle count). Note that for speed all
-        // the pulses are read into a array and then examined in a later step.
-
-        for (int i = 0; i < 80; i += 2) {
-            cycles[i]   = expectPulse(LOW);
-            cycles[(i + 1)] = expectPulse(HIGH);
+void DHT::irqHandler(uint32_t id, uint32_t event) {
+    uint32_t now = us_ticker_read();
+    DHT *sensor;
+
+    (void)(event);
+    for (int i = 0; i < DHT_MAX_SENSORS; i++) {
+        sensor = dht_sensors[i];
+        if ((sensor != NULL) && (sensor->_pin == id) && (sensor->_state == DHT_CAPTURE)) {
+            sensor->_edges[(sensor->_edgeCount % DHT_MAX_EDGES)] = now;
+            sensor->_edgeCount++;
+            return;
         }
-    } // Timing critical code is now complete.
+    }
+}
 
-    // Inspect pulses and determine which ones are 0 (high state cycle count < low
-    // state cycle count), or 1 (high state cycle count > low state cycle count).
+// Each of the 40 bits is a 50 microsecond low pulse followed by a high pulse of
+// ~28 microseconds for a 0 or ~70 microseconds for a 1, so the time between two
+// falling edges tells the bit. The last falling edge ends the high pulse of the
+// last bit, and the 41 falling edges before it span the 40 bits. Edges missed at
+// the start of the response, while the pin was switched to interrupts, do not matter.
+void DHT::decode() {
+    uint8_t bits[5] = {0, 0, 0, 0, 0};
+    uint32_t count = _edgeCount;
+    uint32_t first;
+    uint32_t period;
+
+    if (count < 41) {
+        DEBUG_PRINT(F("DHT timeout, falling edges: "));
+        DEBUG_PRINTLN(count);
+        _lastresult = false;
+        return;
+    }
+    first = count - 41;
     for (int i = 0; i < 40; ++i) {
-        uint32_t lowCycles  = cycles[(2 * i)];
-        uint32_t highCycles = cycles[(2 * i + 1)];
-        if ((lowCycles == TIMEOUT) || (highCycles == TIMEOUT)) {
-            DEBUG_PRINTLN(F("DHT timeout waiting for pulse."));
+        period = _edges[((first + i + 1) % DHT_MAX_EDGES)] - _edges[((first + i) % DHT_MAX_EDGES)];
+        if ((period < BIT_MIN_PERIOD) || (period > BIT_MAX_PERIOD)) {
+            DEBUG_PRINTLN(F("DHT bit period out of range."));
             _lastresult = false;
-            return _lastresult;
+            return;
         }
-        data[(i / 8)] <<= 1;
-        // Now compare the low and high cycle times to see if the bit is a 0 or 1.
-        if (highCycles > lowCycles) {
-            // High cycles are greater than 50us low cycle count, must be a 1.
-            data[(i / 8)] |= 1;
+        bits[(i / 8)] <<= 1;
+        if (period > BIT_ONE_PERIOD) {
+            bits[(i / 8)] |= 1;
         }
-        // Else high cycles are less than (or equal to, a weird case) the 50us low cycle count so this must be a zero.  Nothing needs to be changed in the stored data.
     }
-    delay(500);
     DEBUG_PRINTLN(F("Received from DHT:"));
-    DEBUG_PRINT(data[0], HEX); DEBUG_PRINT(F(", "));
-    DEBUG_PRINT(data[1], HEX); DEBUG_PRINT(F(", "));
-    DEBUG_PRINT(data[2], HEX); DEBUG_PRINT(F(", "));
-    DEBUG_PRINT(data[3], HEX); DEBUG_PRINT(F(", "));
-    DEBUG_PRINT(data[4], HEX); DEBUG_PRINT(F(" =? "));
-    DEBUG_PRINTLN((data[0] + data[1] + data[2] + data[3]) & 0xFF, HEX);
+    DEBUG_PRINT(bits[0], HEX); DEBUG_PRINT(F(", "));
+    DEBUG_PRINT(bits[1], HEX); DEBUG_PRINT(F(", "));
+    DEBUG_PRINT(bits[2], HEX); DEBUG_PRINT(F(", "));
+    DEBUG_PRINT(bits[3], HEX); DEBUG_PRINT(F(", "));
+    DEBUG_PRINT(bits[4], HEX); DEBUG_PRINT(F(" =? "));
+    DEBUG_PRINTLN((bits[0] + bits[1] + bits[2] + bits[3]) & 0xFF, HEX);
 
     // Check we read 40 bits and that the checksum matches.
-    if (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+    if (bits[4] == ((bits[0] + bits[1] + bits[2] + bits[3]) & 0xFF)) {
+        memcpy(data, bits, sizeof(data));
+        _hasdata = true;
+        _lastgoodtime = millis();
         _lastresult = true;
-        return _lastresult;
     } else {
         DEBUG_PRINTLN(F("DHT checksum failure!"));
         _lastresult = false;
-        return _lastresult;
     }
 }
-
-// Expect the signal line to be at the specified level for a period of time and
-// return a count of loop cycles spent at that level (this cycle count can be
-// used to compare the relative time of two pulses).  If more than a millisecond
-// ellapses without the level changing then the call fails with a 0 response.
-// This is adapted from Arduino's pulseInLong function (which is only available
-// in the very latest IDE versions):
-// https://github.com/arduino/Arduino/blob/master/hardware/arduino/avr/cores/arduino/wiring_pulse.c
-uint32_t DHT::expectPulse(bool level) {
-    uint32_t count = 0;
-
-    // On AVR platforms use direct GPIO port access as it's much faster and better for catching pulses that are 10's of microseconds in length:
-#ifdef __AVR
-    uint8_t portState = level ? _bit : 0;
-    while ((*portInputRegister(_port) & _bit) == portState) {
-        if (count++ >= _maxcycles) {
-            return TIMEOUT; // Exceeded timeout, fail.
-        }
-    }
-
-#elif CONFIG_PLATFORM_8721D
-    count = 1;
-    while (digitalRead(_pin) == level) {
-        if (count++ >= _maxcycles) {
-            return TIMEOUT; // Exceeded timeout, fail.
-        }
-    }
-    return count;
-#else
-    while (digitalRead(_pin) == level) {
-        if (count++ >= _maxcycles) {
-      return TIMEOUT; // Exceeded timeout, fail.
-        }
-    }
-#endif
-
-    return count;
-}
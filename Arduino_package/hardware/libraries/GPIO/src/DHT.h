@@ -51,9 +51,15 @@ static const uint8_t AM2301{21}; /**< AM2301 */
 //#define DHT21 21
 //#define AM2301 21
 
+// Sensors that can be read at the same time, each one needs its own pin
+#define DHT_MAX_SENSORS 8
+// Falling edges kept per reading, a reading ends with 41 of them
+#define DHT_MAX_EDGES 48
+
 class DHT {
     public:
         DHT(uint8_t pin, uint8_t type, uint8_t count = 6);
+        ~DHT();
         void begin(uint8_t usec = 55);
         float readTemperature(bool S = false, bool force = false);
         float convertCtoF(float);
@@ -63,7 +69,28 @@ class DHT {
         float readHumidity(bool force = false);
         bool read(bool force = false);
 
+        // Non-blocking reading: startRead() returns at once, the sensor is read in the background
+        // and ready() turns true when the values below have been updated or the reading failed.
+        // A reading requested less than 2 seconds after the previous one starts when the 2 seconds
+        // are up, unless force is set.
+        bool startRead(bool force = false);
+        bool ready();
+        // true if the last reading passed its checksum
+        bool valid();
+        // Last good values, NAN before the first one
+        float temperature(bool S = false);
+        float humidity();
+        // ms since the last good reading
+        uint32_t age();
+
     private:
+        static void irqHandler(uint32_t id, uint32_t event);
+        static void timerHandler(void const *argument);
+        void startSignal();
+        void decode();
+        float convertTemperature(bool S);
+        float convertHumidity();
+
         uint8_t data[5];
         uint8_t _pin, _type;
 
@@ -75,10 +102,12 @@ class DHT {
 #endif
 
 
-    uint32_t _lastreadtime, _maxcycles;
-    bool _lastresult;
-  uint8_t pullTime; // Time (in usec) to pull up data line before reading
-    uint32_t expectPulse(bool level);
+    uint32_t _lastreadtime, _lastgoodtime;
+    bool _lastresult, _hasdata;
+    uint32_t _timer;
+    volatile uint8_t _state;
+    volatile uint32_t _edges[DHT_MAX_EDGES];
+    volatile uint32_t _edgeCount;
 };
 
 /*!
@@ -0,0 +1,114 @@
+/*
+ This example downloads several files from one server over a single
+ keep-alive connection, writing each response body straight to the SD card,
+ then uploads the first file back with a chunked POST request.
+
+ Change kHostname and the paths to a server you control before running.
+ */
+
+#include <HttpClient.h>
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include "AmebaFatFS.h"
+
+char ssid[] = "Network_SSID";       // your network SSID (name)
+char pass[] = "Password";           // your network password
+int status = WL_IDLE_STATUS;
+
+const char kHostname[] = "192.168.1.100";
+const uint16_t kPort = 8000;
+const char* kPaths[] = {"/model.nb", "/labels.txt", "/config.json"};
+const char kUploadPath[] = "/upload";
+
+AmebaFatFS fs;
+WiFiClient wifiClient;
+HttpClient http(wifiClient);
+
+bool download(const char* path) {
+    char filename[128];
+    unsigned long start = millis();
+
+    int err = http.get(kHostname, kPort, path);
+    if (err != HTTP_SUCCESS) {
+        Serial.print("Request failed: ");
+        Serial.println(err);
+        return false;
+    }
+    int code = http.responseStatusCode();
+    if (code != 200) {
+        Serial.print("Status code: ");
+        Serial.println(code);
+        return false;
+    }
+    if (http.skipResponseHeaders() != HTTP_SUCCESS) {
+        return false;
+    }
+
+    sprintf(filename, "%s%s", fs.getRootPath(), (path + 1));
+    File file = fs.open(filename);
+    long len = http.responseBody(file);
+    file.close();
+
+    Serial.print(path);
+    Serial.print(http.isResponseChunked() ? " (chunked): " : ": ");
+    Serial.print(len);
+    Serial.print(" bytes in ");
+    Serial.print(millis() - start);
+    Serial.println(" ms");
+    return (len >= 0);
+}
+
+bool upload(const char* path) {
+    char filename[128];
+
+    sprintf(filename, "%s%s", fs.getRootPath(), (path + 1));
+    File file = fs.open(filename);
+
+    // beginRequest() keeps the headers open so beginBody() can add the transfer encoding
+    http.beginRequest();
+    int err = http.post(kHostname, kPort, kUploadPath);
+    if (err != HTTP_SUCCESS) {
+        file.close();
+        return false;
+    }
+    http.sendHeader("Content-Type", "application/octet-stream");
+    // no length given, the file is sent as chunks
+    long len = http.sendBody(file);
+    file.close();
+
+    Serial.print("Uploaded ");
+    Serial.print(len);
+    Serial.print(" bytes, status code: ");
+    Serial.println(http.responseStatusCode());
+    http.skipResponseHeaders();
+    http.responseBody(Serial);
+    Serial.println();
+    return (len >= 0);
+}
+
+void setup() {
+    Serial.begin(115200);
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+        delay(2000);
+    }
+    Serial.println("Connected to wifi");
+
+    fs.begin();
+    // the connection stays open between the requests below
+    http.connectionKeepAlive();
+
+    for (unsigned int i = 0; i < (sizeof(kPaths) / sizeof(kPaths[0])); i++) {
+        download(kPaths[i]);
+    }
+    upload(kPaths[0]);
+
+    http.stop();
+    fs.end();
+}
+
+void loop() {
+    delay(1000);
+}
@@ -6,11 +6,11 @@
 
 // Initialize constants
 const char* HttpClient::kUserAgent = "Ameba";
-const char* HttpClient::kContentLengthPrefix = HTTP_HEADER_CONTENT_LENGTH ": ";
 
 #ifdef PROXY_ENABLED // currently disabled as introduces dependency on Dns.h in Ethernet
 HttpClient::HttpClient(Client& aClient, const char* aProxy, uint16_t aProxyPort)
  : iClient(&aClient), iProxyPort(aProxyPort) {
+    iKeepAlive = false;
     resetState();
     if (aProxy) {
         // Resolve the IP address for the proxy
@@ -24,17 +24,34 @@ HttpClient::HttpClient(Client& aClient, const char* aProxy, uint16_t aProxyPort)
 #else
 HttpClient::HttpClient(Client& aClient)
  : iClient(&aClient), iProxyPort(0) {
+    iKeepAlive = false;
     resetState();
 }
 #endif
 
 void HttpClient::resetState() {
+    resetResponse();
+    iTxLen = 0;
+    iServerName[0] = '\0';
+    iServerAddress = IPAddress(0, 0, 0, 0);
+    iServerPort = 0;
+    iHttpResponseTimeout = kHttpResponseTimeout;
+}
+
+void HttpClient::resetResponse() {
     iState = eIdle;
     iStatusCode = 0;
-    iContentLength = 0;
+    iContentLength = kNoContentLengthHeader;
     iBodyLengthConsumed = 0;
-    iContentLengthPtr = kContentLengthPrefix;
-    iHttpResponseTimeout = kHttpResponseTimeout;
+    iChunked = false;
+    iChunkRemaining = 0;
+    iChunkCRLF = false;
+    iChunkEnd = false;
+    iChunkedRequest = false;
+    iServerClose = false;
+    iRxPos = 0;
+    iRxLen = 0;
+    iLineLen = 0;
 }
 
 void HttpClient::stop() {
@@ -42,28 +59,80 @@ void HttpClient::stop() {
     resetState();
 }
 
+void HttpClient::finishResponse() {
+    bool reuse;
+
+    if ((iState == eIdle) || (iState == eRequestStarted)) {
+        return;
+    }
+    // the last chunk usually follows the data right away, read it so the connection can be reused
+    if (endOfHeadersReached() && iChunked && !iChunkEnd && (iChunkRemaining == 0)) {
+        readChunkSize();
+    }
+    reuse = iKeepAlive && !iServerClose && endOfBodyReached() && (iRxPos >= iRxLen) && iClient->connected();
+    if (!reuse) {
+        iClient->stop();
+        iServerName[0] = '\0';
+        iServerAddress = IPAddress(0, 0, 0, 0);
+        iServerPort = 0;
+    }
+    resetResponse();
+}
+
+bool HttpClient::reuseConnection(const char* aServerName, const IPAddress& aServerAddress, uint16_t aServerPort) {
+    if ((!iKeepAlive) || (iServerPort == 0) || (iServerPort != aServerPort) || !(iServerAddress == aServerAddress)) {
+        return false;
+    }
+    if (strcmp(iServerName, (aServerName ? aServerName : "")) != 0) {
+        return false;
+    }
+    return iClient->connected();
+}
+
+void HttpClient::rememberServer(const char* aServerName, const IPAddress& aServerAddress, uint16_t aServerPort) {
+    if (aServerName == NULL) {
+        aServerName = "";
+    }
+    if (strlen(aServerName) >= sizeof(iServerName)) {
+        // name too long to compare later, don't reuse this connection
+        iServerPort = 0;
+        return;
+    }
+    strcpy(iServerName, aServerName);
+    iServerAddress = aServerAddress;
+    iServerPort = aServerPort;
+}
+
 void HttpClient::beginRequest() {
+    finishResponse();
     iState = eRequestStarted;
 }
 
 int HttpClient::startRequest(const char* aServerName, uint16_t aServerPort, const char* aURLPath, const char* aHttpMethod, const char* aUserAgent) {
+    finishResponse();
     tHttpState initialState = iState;
     if ((eIdle != iState) && (eRequestStarted != iState)) {
         return HTTP_ERROR_API;
     }
 
+    if (!reuseConnection(aServerName, IPAddress(0, 0, 0, 0), aServerPort)) {
+        if (iClient->connected()) {
+            iClient->stop();
+        }
 #ifdef PROXY_ENABLED
-    if (iProxyPort) {
-        if ((!(iClient->connect(iProxyAddress, iProxyPort))) > 0) {
-            return HTTP_ERROR_CONNECTION_FAILED;
+        if (iProxyPort) {
+            if ((!(iClient->connect(iProxyAddress, iProxyPort))) > 0) {
+                return HTTP_ERROR_CONNECTION_FAILED;
+            }
         }
-    }
-    else
+        else
 #endif
-    {
-        if ((!(iClient->connect(aServerName, aServerPort))) > 0) {
-            return HTTP_ERROR_CONNECTION_FAILED;
+        {
+            if ((!(iClient->connect(aServerName, aServerPort))) > 0) {
+                return HTTP_ERROR_CONNECTION_FAILED;
+            }
         }
+        rememberServer(aServerName, IPAddress(0, 0, 0, 0), aServerPort);
     }
 
     int ret = sendInitialHeaders(aServerName, IPAddress(0, 0, 0, 0), aServerPort, aURLPath, aHttpMethod, aUserAgent);
@@ -75,23 +144,30 @@ int HttpClient::startRequest(const char* aServerName, uint16_t aServerPort, cons
 }
 
 int HttpClient::startRequest(const IPAddress& aServerAddress, const char* aServerName, uint16_t aServerPort, const char* aURLPath, const char* aHttpMethod, const char* aUserAgent) {
+    finishResponse();
     tHttpState initialState = iState;
     if ((eIdle != iState) && (eRequestStarted != iState)) {
         return HTTP_ERROR_API;
     }
 
+    if (!reuseConnection(aServerName, aServerAddress, aServerPort)) {
+        if (iClient->connected()) {
+            iClient->stop();
+        }
 #ifdef PROXY_ENABLED
-    if (iProxyPort) {
-        if ((!(iClient->connect(iProxyAddress, iProxyPort))) > 0) {
-            return HTTP_ERROR_CONNECTION_FAILED;
+        if (iProxyPort) {
+            if ((!(iClient->connect(iProxyAddress, iProxyPort))) > 0) {
+                return HTTP_ERROR_CONNECTION_FAILED;
+            }
         }
-    }
-    else
+        else
 #endif
-    {
-        if ((!(iClient->connect(aServerAddress, aServerPort))) > 0) {
-            return HTTP_ERROR_CONNECTION_FAILED;
+        {
+            if ((!(iClient->connect(aServerAddress, aServerPort))) > 0) {
+                return HTTP_ERROR_CONNECTION_FAILED;
+            }
         }
+        rememberServer(aServerName, aServerAddress, aServerPort);
     }
 
     int ret = sendInitialHeaders(aServerName, aServerAddress, aServerPort, aURLPath, aHttpMethod, aUserAgent);
@@ -105,32 +181,33 @@ int HttpClient::startRequest(const IPAddress& aServerAddress, const char* aServe
 int HttpClient::sendInitialHeaders(const char* aServerName, IPAddress aServerIP, uint16_t aPort, const char* aURLPath, const char* aHttpMethod, const char* aUserAgent) {
     aServerIP = aServerIP;
     // Send the HTTP command, i.e. "GET /somepath/ HTTP/1.0"
-    iClient->print(aHttpMethod);
-    iClient->print(" ");
+    queueHeader(aHttpMethod);
+    queueHeader(" ");
 #ifdef PROXY_ENABLED
     if (iProxyPort) {
-        iClient->print("http://");
+        queueHeader("http://");
         if (aServerName) {
-            iClient->print(aServerName);
+            queueHeader(aServerName);
         } else {
+            flushHeaders();
             iClient->print(aServerIP);
         }
         if (aPort != kHttpPort) {
-            iClient->print(":");
-            iClient->print(aPort);
+            queueHeader(":");
+            queueHeader(aPort);
         }
     }
 #endif
-    iClient->print(aURLPath);
-    iClient->println(" HTTP/1.1");
+    queueHeader(aURLPath);
+    queueHeader(" HTTP/1.1\r\n");
     if (aServerName) {
-        iClient->print("Host: ");
-        iClient->print(aServerName);
+        queueHeader("Host: ");
+        queueHeader(aServerName);
         if (aPort != kHttpPort) {
-            iClient->print(":");
-            iClient->print(aPort);
+            queueHeader(":");
+            queueHeader(aPort);
         }
-        iClient->println();
+        queueHeader("\r\n");
     }
     // And user-agent string
     if (aUserAgent) {
@@ -138,32 +215,60 @@ int HttpClient::sendInitialHeaders(const char* aServerName, IPAddress aServerIP,
     } else {
         sendHeader(HTTP_HEADER_USER_AGENT, kUserAgent);
     }
-    // We don't support persistent connections, so tell the server to
+    // Unless the connection is kept for the next request, tell the server to
     // close this connection after we're done
-    sendHeader(HTTP_HEADER_CONNECTION, "close");
+    if (!iKeepAlive) {
+        sendHeader(HTTP_HEADER_CONNECTION, "close");
+    }
 
     iState = eRequestStarted;
     return HTTP_SUCCESS;
 }
 
+void HttpClient::queueHeader(const char* aText) {
+    while (*aText != '\0') {
+        if (iTxLen >= sizeof(iTxBuffer)) {
+            flushHeaders();
+        }
+        iTxBuffer[iTxLen++] = *aText++;
+    }
+}
+
+void HttpClient::queueHeader(int aValue) {
+    char value[12];
+
+    snprintf(value, sizeof(value), "%d", aValue);
+    queueHeader(value);
+}
+
+void HttpClient::flushHeaders() {
+    if (iTxLen > 0) {
+        iClient->write(iTxBuffer, iTxLen);
+        iTxLen = 0;
+    }
+}
+
 void HttpClient::sendHeader(const char* aHeader) {
-    iClient->println(aHeader);
+    queueHeader(aHeader);
+    queueHeader("\r\n");
 }
 
 void HttpClient::sendHeader(const char* aHeaderName, const char* aHeaderValue) {
-    iClient->print(aHeaderName);
-    iClient->print(": ");
-    iClient->println(aHeaderValue);
+    queueHeader(aHeaderName);
+    queueHeader(": ");
+    queueHeader(aHeaderValue);
+    queueHeader("\r\n");
 }
 
 void HttpClient::sendHeader(const char* aHeaderName, const int aHeaderValue) {
-    iClient->print(aHeaderName);
-    iClient->print(": ");
-    iClient->println(aHeaderValue);
+    queueHeader(aHeaderName);
+    queueHeader(": ");
+    queueHeader(aHeaderValue);
+    queueHeader("\r\n");
 }
 
 void HttpClient::sendBasicAuth(const char* aUser, const char* aPassword) {
-    iClient->print("Authorization: Basic ");
+    queueHeader("Authorization: Basic ");
 
     unsigned char input[3];
     unsigned char output[5]; // Leave space for a '\0' terminator so we can easily print
@@ -182,15 +287,16 @@ void HttpClient::sendBasicAuth(const char* aUser, const char* aPassword) {
         if ((inputOffset == 3) || (i == (userLen + passwordLen))) {
             b64_encode(input, inputOffset, output, 4);
             output[4] = '\0';
-            iClient->print((char*)output);
+            queueHeader((char*)output);
             inputOffset = 0;
         }
     }
-    iClient->println();
+    queueHeader("\r\n");
 }
 
 void HttpClient::finishHeaders() {
-    iClient->println();
+    queueHeader("\r\n");
+    flushHeaders();
     iState = eRequestSent;
 }
 
@@ -200,152 +306,444 @@ void HttpClient::endRequest() {
     }
 }
 
+int HttpClient::beginBody(long aLength) {
+    if (iState >= eRequestSent) {
+        // headers already sent, the caller must have sent Content-Length itself
+        return (aLength >= 0) ? HTTP_SUCCESS : HTTP_ERROR_API;
+    }
+    if (iState != eRequestStarted) {
+        return HTTP_ERROR_API;
+    }
+    if (aLength >= 0) {
+        sendHeader(HTTP_HEADER_CONTENT_LENGTH, (int)aLength);
+    } else {
+        sendHeader(HTTP_HEADER_TRANSFER_ENCODING, HTTP_HEADER_VALUE_CHUNKED);
+    }
+    finishHeaders();
+    iChunkedRequest = (aLength < 0);
+    return HTTP_SUCCESS;
+}
+
+int HttpClient::endBody() {
+    if (iChunkedRequest) {
+        iChunkedRequest = false;
+        if (iClient->write((const uint8_t*)"0\r\n\r\n", 5) != 5) {
+            return HTTP_ERROR_CONNECTION_FAILED;
+        }
+    }
+    return HTTP_SUCCESS;
+}
+
+size_t HttpClient::write(const uint8_t *aBuffer, size_t aSize) {
+    char chunkSize[12];
+    size_t ret;
+
+    if (iState < eRequestSent) {
+        finishHeaders();
+    }
+    if (!iChunkedRequest) {
+        return iClient->write(aBuffer, aSize);
+    }
+    // an empty chunk would end the body
+    if (aSize == 0) {
+        return 0;
+    }
+    snprintf(chunkSize, sizeof(chunkSize), "%x\r\n", (unsigned int)aSize);
+    iClient->write((const uint8_t*)chunkSize, strlen(chunkSize));
+    ret = iClient->write(aBuffer, aSize);
+    iClient->write((const uint8_t*)"\r\n", 2);
+    return ret;
+}
+
+long HttpClient::sendBody(Stream& aBody, long aLength) {
+    uint8_t* buf;
+    long sent = 0;
+    int ret;
+
+    ret = beginBody(aLength);
+    if (ret != HTTP_SUCCESS) {
+        return ret;
+    }
+    buf = (uint8_t*)malloc(kHttpStreamBufferSize);
+    if (buf == NULL) {
+        printf("\r\n[ERROR] %s Buffer allocation failed\n", __FUNCTION__);
+        return HTTP_ERROR_API;
+    }
+    while ((aLength < 0) || (sent < aLength)) {
+        size_t len = kHttpStreamBufferSize;
+        if ((aLength >= 0) && ((aLength - sent) < (long)len)) {
+            len = aLength - sent;
+        }
+        len = aBody.readBytes(buf, len);
+        if (len == 0) {
+            break;
+        }
+        if (write(buf, len) != len) {
+            free(buf);
+            return HTTP_ERROR_CONNECTION_FAILED;
+        }
+        sent += len;
+    }
+    free(buf);
+
+    ret = endBody();
+    if (ret != HTTP_SUCCESS) {
+        return ret;
+    }
+    return sent;
+}
+
+// Wait for the next byte of the response, the timeout restarts with every byte
+int HttpClient::timedRead() {
+    unsigned long timeoutStart = millis();
+
+    while (iRxPos >= iRxLen) {
+        if (iClient->available() && (fillBuffer() > 0)) {
+            break;
+        }
+        if (!iClient->connected() || ((millis() - timeoutStart) >= iHttpResponseTimeout)) {
+            return -1;
+        }
+        delay(kHttpWaitForDataDelay);
+    }
+    return iRxBuffer[iRxPos++];
+}
+
+int HttpClient::fillBuffer() {
+    int ret = iClient->read(iRxBuffer, sizeof(iRxBuffer));
+
+    iRxPos = 0;
+    iRxLen = (ret > 0) ? ret : 0;
+    return ret;
+}
+
+int HttpClient::rawAvailable() {
+    if (iRxPos < iRxLen) {
+        return (iRxLen - iRxPos);
+    }
+    return iClient->available();
+}
+
+int HttpClient::rawRead(uint8_t *buf, size_t size) {
+    if (iRxPos >= iRxLen) {
+        // large reads go straight to the client instead of through the buffer
+        if (size >= sizeof(iRxBuffer)) {
+            return iClient->read(buf, size);
+        }
+        if (fillBuffer() <= 0) {
+            return -1;
+        }
+    }
+    if (size > (size_t)(iRxLen - iRxPos)) {
+        size = iRxLen - iRxPos;
+    }
+    memcpy(buf, &iRxBuffer[iRxPos], size);
+    iRxPos += size;
+    return size;
+}
+
+// Read a line without its CRLF into iLine, longer lines are truncated
+// Returns the line length, or -1 if it timed out
+int HttpClient::readLine() {
+    int c;
+
+    iLineLen = 0;
+    while ((c = timedRead()) >= 0) {
+        if (c == '\n') {
+            iLine[iLineLen] = '\0';
+            return iLineLen;
+        }
+        if ((c != '\r') && (iLineLen < (kHttpMaxLineLength - 1))) {
+            iLine[iLineLen++] = c;
+        }
+    }
+    iLine[iLineLen] = '\0';
+    iLineLen = 0;
+    return -1;
+}
+
 int HttpClient::responseStatusCode() {
     if (iState < eRequestSent) {
         return HTTP_ERROR_API;
     }
+    if (iState >= eStatusCodeRead) {
+        return iStatusCode;
+    }
 
-    char c = '\0';
     do {
         iStatusCode = 0;
-        iState = eRequestSent;
-
-        unsigned long timeoutStart = millis();
-        const char* statusPrefix = "HTTP/*.* ";
-        const char* statusPtr = statusPrefix;
-        while ((c != '\n') && ((millis() - timeoutStart) < iHttpResponseTimeout )) {
-            if (available()) {
-                c = read();
-                //if (c != -1) {
-                    switch (iState) {
-                        case eRequestSent:
-                            if ((*statusPtr == '*') || (*statusPtr == c)) {
-                                statusPtr++;
-                                if (*statusPtr == '\0') {
-                                    iState = eReadingStatusCode;
-                                }
-                            } else {
-                                return HTTP_ERROR_INVALID_RESPONSE;
-                            }
-                            break;
-                        case eReadingStatusCode:
-                            if (isdigit(c)) {
-                                iStatusCode = iStatusCode * 10 + (c - '0');
-                            } else {
-                                iState = eStatusCodeRead;
-                            }
-                            break;
-                        case eStatusCodeRead:
-                            break;
-                        default:
-                            break;
-                    };
-                    timeoutStart = millis();
-                //}
-            } else {
-                delay(kHttpWaitForDataDelay);
+        iState = eReadingStatusCode;
+
+        // Status line, i.e. "HTTP/1.1 200 OK"
+        if (readLine() < 0) {
+            return HTTP_ERROR_TIMED_OUT;
+        }
+        const char* code = strchr(iLine, ' ');
+        if ((strncmp(iLine, "HTTP/", 5) != 0) || (code == NULL) || !isdigit(code[1])) {
+            return HTTP_ERROR_INVALID_RESPONSE;
+        }
+        iStatusCode = atoi(code + 1);
+        // HTTP/1.0 servers close the connection unless told otherwise by a header
+        iServerClose = (strncmp(iLine, "HTTP/1.0", 8) == 0);
+        iState = eStatusCodeRead;
+
+        if (iStatusCode < 200) {
+            // Informational response, skip its headers and wait for the real one
+            int len;
+            while ((len = readLine()) > 0) {
+            }
+            if (len < 0) {
+                return HTTP_ERROR_TIMED_OUT;
             }
         }
+    } while (iStatusCode < 200);
+
+    iLineLen = 0;
+    return iStatusCode;
+}
+
+void HttpClient::parseHeaderLine() {
+    char* value = strchr(iLine, ':');
+    size_t nameLen;
+    size_t valueLen;
 
-        if ((c == '\n') && (iStatusCode < 200)) {
-            c = '\0'; // Clear c so we'll go back into the data reading loop
+    if (value == NULL) {
+        return;
+    }
+    nameLen = value - iLine;
+    value++;
+    while ((*value == ' ') || (*value == '\t')) {
+        value++;
+    }
+    valueLen = strlen(value);
+
+    if ((nameLen == strlen(HTTP_HEADER_CONTENT_LENGTH)) && (strncasecmp(iLine, HTTP_HEADER_CONTENT_LENGTH, nameLen) == 0)) {
+        iContentLength = atoi(value);
+    } else if ((nameLen == strlen(HTTP_HEADER_TRANSFER_ENCODING)) && (strncasecmp(iLine, HTTP_HEADER_TRANSFER_ENCODING, nameLen) == 0)) {
+        // chunked is always the last encoding applied
+        iChunked = (valueLen >= 7) && (strcasecmp(&value[valueLen - 7], HTTP_HEADER_VALUE_CHUNKED) == 0);
+    } else if ((nameLen == strlen(HTTP_HEADER_CONNECTION)) && (strncasecmp(iLine, HTTP_HEADER_CONNECTION, nameLen) == 0)) {
+        if (strncasecmp(value, "close", 5) == 0) {
+            iServerClose = true;
+        } else if (strncasecmp(value, "keep-alive", 10) == 0) {
+            iServerClose = false;
         }
-    } while ((iState == eStatusCodeRead) && (iStatusCode < 200));
+    }
+}
 
-    if ((c == '\n') && (iState == eStatusCodeRead)) {
-        return iStatusCode;
-    } else if (c != '\n') {
-        return HTTP_ERROR_TIMED_OUT;
-    } else {
-        return HTTP_ERROR_INVALID_RESPONSE;
+void HttpClient::endOfHeaders() {
+    iState = eReadingBody;
+    iBodyLengthConsumed = 0;
+    if (iChunked) {
+        // Content-Length is ignored for chunked bodies
+        iContentLength = kNoContentLengthHeader;
+    } else if ((iStatusCode == 204) || (iStatusCode == 304)) {
+        iContentLength = 0;
     }
 }
 
-int HttpClient::skipResponseHeaders() {
-    unsigned long timeoutStart = millis();
-    while ((!endOfHeadersReached()) && ((millis() - timeoutStart) < iHttpResponseTimeout)) {
-        if (available()) {
-            (void)readHeader();
-            timeoutStart = millis();
+void HttpClient::headerByte(char c) {
+    if (c == '\n') {
+        iLine[iLineLen] = '\0';
+        if (iLineLen == 0) {
+            endOfHeaders();
         } else {
-            delay(kHttpWaitForDataDelay);
+            parseHeaderLine();
         }
+        iLineLen = 0;
+    } else if ((c != '\r') && (iLineLen < (kHttpMaxLineLength - 1))) {
+        iLine[iLineLen++] = c;
     }
+}
 
-    if (endOfHeadersReached()) {
-        return HTTP_SUCCESS;
-    } else {
+int HttpClient::skipResponseHeaders() {
+    int c;
+
+    if (iState < eStatusCodeRead) {
+        int ret = responseStatusCode();
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    while (!endOfHeadersReached()) {
+        c = timedRead();
+        if (c < 0) {
+            return HTTP_ERROR_TIMED_OUT;
+        }
+        headerByte(c);
+    }
+    return HTTP_SUCCESS;
+}
+
+// Read the size line of the next chunk, and the CRLF ending the previous one
+// Returns the chunk size, 0 after the last chunk, or an error code
+int HttpClient::readChunkSize() {
+    int len;
+
+    if (iChunkEnd) {
+        return 0;
+    }
+    if (iChunkCRLF) {
+        if (readLine() < 0) {
+            return HTTP_ERROR_TIMED_OUT;
+        }
+        iChunkCRLF = false;
+    }
+    if (readLine() < 0) {
+        return HTTP_ERROR_TIMED_OUT;
+    }
+    if (!isxdigit(iLine[0])) {
+        return HTTP_ERROR_INVALID_RESPONSE;
+    }
+    // chunk extensions after the size are ignored
+    iChunkRemaining = strtol(iLine, NULL, 16);
+    if (iChunkRemaining > 0) {
+        iChunkCRLF = true;
+        return iChunkRemaining;
+    }
+    // Last chunk, skip the trailer headers up to the blank line
+    while ((len = readLine()) > 0) {
+    }
+    if (len < 0) {
         return HTTP_ERROR_TIMED_OUT;
     }
+    iChunkEnd = true;
+    return 0;
 }
 
 bool HttpClient::endOfBodyReached() {
-    if (endOfHeadersReached() && (contentLength() != kNoContentLengthHeader)) {
+    if (!endOfHeadersReached()) {
+        return false;
+    }
+    if (iChunked) {
+        return iChunkEnd;
+    }
+    if (contentLength() != kNoContentLengthHeader) {
         return (iBodyLengthConsumed >= contentLength());
     }
     return false;
 }
 
-int HttpClient::read() {
-    int ret = iClient->read();
-    if (ret >= 0) {
-        if (endOfHeadersReached() && (iContentLength > 0)) {
-            iBodyLengthConsumed++;
+int HttpClient::available() {
+    int ret;
+
+    if (!endOfHeadersReached()) {
+        return rawAvailable();
+    }
+    if (iChunked) {
+        if (iChunkEnd) {
+            return 0;
+        }
+        if ((iChunkRemaining == 0) && ((rawAvailable() <= 0) || (readChunkSize() <= 0))) {
+            return 0;
         }
+        ret = rawAvailable();
+        return (ret > iChunkRemaining) ? iChunkRemaining : ret;
     }
-    return ret;
+    if ((iContentLength != kNoContentLengthHeader) && (iBodyLengthConsumed >= iContentLength)) {
+        return 0;
+    }
+    return rawAvailable();
+}
+
+int HttpClient::read() {
+    uint8_t c;
+
+    if (available() <= 0) {
+        return -1;
+    }
+    if (read(&c, 1) != 1) {
+        return -1;
+    }
+    return c;
 }
 
 int HttpClient::read(uint8_t *buf, size_t size) {
-    int ret = iClient->read(buf, size);
-    if (endOfHeadersReached() && iContentLength > 0) {
-        if (ret >= 0) {
-            iBodyLengthConsumed += ret;
+    int ret;
+
+    if (!endOfHeadersReached()) {
+        return rawRead(buf, size);
+    }
+    // Stop at the end of the chunk or the body, the rest belongs to the next response
+    if (iChunked) {
+        if ((iChunkRemaining == 0) && (readChunkSize() <= 0)) {
+            return -1;
+        }
+        if (size > (size_t)iChunkRemaining) {
+            size = iChunkRemaining;
+        }
+    } else if (iContentLength != kNoContentLengthHeader) {
+        if (iBodyLengthConsumed >= iContentLength) {
+            return -1;
+        }
+        if (size > (size_t)(iContentLength - iBodyLengthConsumed)) {
+            size = iContentLength - iBodyLengthConsumed;
+        }
+    }
+    ret = rawRead(buf, size);
+    if (ret > 0) {
+        iBodyLengthConsumed += ret;
+        if (iChunked) {
+            iChunkRemaining -= ret;
         }
     }
     return ret;
 }
 
-int HttpClient::readHeader() {
-    char c = read();
-
-    if (endOfHeadersReached()) {
-        return c;
+int HttpClient::peek() {
+    if (available() <= 0) {
+        return -1;
     }
+    if ((iRxPos >= iRxLen) && (fillBuffer() <= 0)) {
+        return -1;
+    }
+    return iRxBuffer[iRxPos];
+}
 
-    switch (iState) {
-        case eStatusCodeRead:
-            if (*iContentLengthPtr == c) {
-                iContentLengthPtr++;
-                if (*iContentLengthPtr == '\0') {
-                    iState = eReadingContentLength;
-                    iContentLength = 0;
-                }
-            } else if ((iContentLengthPtr == kContentLengthPrefix) && (c == '\r')) {
-                iState = eLineStartingCRFound;
-            } else {
-                iState = eSkipToEndOfHeader;
-            }
-            break;
-        case eReadingContentLength:
-            if (isdigit(c)) {
-                iContentLength = iContentLength * 10 + (c - '0');
-            } else {
-                iState = eSkipToEndOfHeader;
-            }
-            break;
-        case eLineStartingCRFound:
-            if (c == '\n') {
-                iState = eReadingBody;
+long HttpClient::responseBody(Print& aOutput) {
+    uint8_t* buf;
+    long total = 0;
+    int ret;
+
+    if (!endOfHeadersReached()) {
+        ret = skipResponseHeaders();
+        if (ret != HTTP_SUCCESS) {
+            return ret;
+        }
+    }
+    buf = (uint8_t*)malloc(kHttpStreamBufferSize);
+    if (buf == NULL) {
+        printf("\r\n[ERROR] %s Buffer allocation failed\n", __FUNCTION__);
+        return HTTP_ERROR_API;
+    }
+    unsigned long timeoutStart = millis();
+    while (!endOfBodyReached()) {
+        ret = read(buf, kHttpStreamBufferSize);
+        if (ret > 0) {
+            if (aOutput.write(buf, ret) != (size_t)ret) {
+                printf("\r\n[ERROR] %s Output write failed\n", __FUNCTION__);
+                break;
             }
+            total += ret;
+            timeoutStart = millis();
+        } else if ((iChunked && iChunkEnd) || ((rawAvailable() <= 0) && !iClient->connected())) {
+            // without a length the body ends when the server closes the connection
             break;
-        default:
-            break;
-    };
+        } else if ((millis() - timeoutStart) >= iHttpResponseTimeout) {
+            free(buf);
+            return HTTP_ERROR_TIMED_OUT;
+        }
+    }
+    free(buf);
+    return total;
+}
 
-    if ((c == '\n') && (!endOfHeadersReached())) {
-        iState = eStatusCodeRead;
-        iContentLengthPtr = kContentLengthPrefix;
+int HttpClient::readHeader() {
+    int c = read();
+
+    if (endOfHeadersReached() || (c < 0)) {
+        return c;
     }
+    headerByte(c);
     return c;
 }
@@ -29,6 +29,8 @@ static const int HTTP_ERROR_INVALID_RESPONSE = -4;
 #define HTTP_HEADER_CONTENT_LENGTH      "Content-Length"
 #define HTTP_HEADER_CONNECTION          "Connection"
 #define HTTP_HEADER_USER_AGENT          "User-Agent"
+#define HTTP_HEADER_TRANSFER_ENCODING   "Transfer-Encoding"
+#define HTTP_HEADER_VALUE_CHUNKED       "chunked"
 
 class HttpClient : public Client {
     public:
@@ -51,6 +53,13 @@ class HttpClient : public Client {
         */
         void beginRequest();
 
+        /** Keep the connection open after the response instead of sending
+          "Connection: close".  The next request to the same server and port
+          reuses it when the previous response body was read to the end, which
+          saves the TCP (and TLS) setup of every request after the first.
+        */
+        void connectionKeepAlive() { iKeepAlive = true; };
+
         /** End a more complex request.
             Use this when you need to have sent additional headers in the request,
             but you will also need to call beginRequest() at the start.
@@ -310,6 +319,28 @@ class HttpClient : public Client {
         */
         void finishRequest();
 
+        /** Start the request body.  Call after beginRequest(), startRequest()
+          and any sendHeader() calls.
+          @param aLength Length of the body, sent as Content-Length.  If
+                         negative, the body is sent with chunked transfer encoding
+                         and every write() becomes one chunk until endBody()
+          @return HTTP_SUCCESS if successful, else an error code
+        */
+        int beginBody(long aLength = -1);
+
+        /** Finish a request body started with beginBody().  Sends the last
+          chunk when the body is chunked.
+        */
+        int endBody();
+
+        /** Send the whole request body from a Stream, e.g. a File.
+          @param aBody   Stream to read the body from
+          @param aLength Number of bytes to send, or negative to send everything
+                         up to the end of the stream as chunks
+          @return Number of bytes sent, or an error code
+        */
+        long sendBody(Stream& aBody, long aLength = -1);
+
         /** Get the HTTP status code contained in the response.
           For example, 200 for successful request, 404 for file not found, etc.
         */
@@ -333,6 +364,12 @@ class HttpClient : public Client {
         */
         int skipResponseHeaders();
 
+        /** Copy the response body to aOutput, e.g. a File, a block at a time.
+          Chunked bodies are decoded.  Call after skipResponseHeaders().
+          @return Number of bytes written, or an error code
+        */
+        long responseBody(Print& aOutput);
+
         /** Test whether all of the response headers have been consumed.
           @return true if we are now processing the response body, else false
         */
@@ -343,29 +380,34 @@ class HttpClient : public Client {
           @return true if we are now at the end of the body, else false
         */
         bool endOfBodyReached();
+
+        /** Test whether the response body is sent with chunked transfer encoding.
+          The chunks are decoded by read(), so the body reads the same either way
+        */
+        bool isResponseChunked() { return iChunked; };
         virtual bool endOfStream() { return endOfBodyReached(); };
         virtual bool completed() { return endOfBodyReached(); };
 
         /** Return the length of the body.
           @return Length of the body, in bytes, or kNoContentLengthHeader if no
-          Content-Length header was returned by the server
+          Content-Length header was returned by the server or the body is chunked
         */
         int contentLength() { return iContentLength; };
 
         // Inherited from Print
         // Note: 1st call to these indicates the user is sending the body, so if need
         // Note: be we should finish the header first
-        virtual size_t write(uint8_t aByte) { if (iState < eRequestSent) { finishHeaders(); }; return iClient-> write(aByte); };
-        virtual size_t write(const uint8_t *aBuffer, size_t aSize) { if (iState < eRequestSent) { finishHeaders(); }; return iClient->write(aBuffer, aSize); };
+        virtual size_t write(uint8_t aByte) { return write(&aByte, 1); };
+        virtual size_t write(const uint8_t *aBuffer, size_t aSize);
 
         // Inherited from Stream
-        virtual int available() { return iClient->available(); };
+        virtual int available();
         /** Read the next byte from the server.
           @return Byte read or -1 if there are no bytes available.
         */
         virtual int read();
         virtual int read(uint8_t *buf, size_t size);
-        virtual int peek() { return iClient->peek(); };
+        virtual int peek();
         virtual void flush() { return iClient->flush(); };
 
         // Inherited from Client
@@ -382,6 +424,37 @@ class HttpClient : public Client {
         */
         void resetState();
 
+        /** Reset the state kept for one response
+        */
+        void resetResponse();
+
+        /** Close out the previous response before a new request, keeping the
+          connection only if it can carry another request
+        */
+        void finishResponse();
+
+        /** Check whether the open connection was made to the given server
+        */
+        bool reuseConnection(const char* aServerName, const IPAddress& aServerAddress, uint16_t aServerPort);
+        void rememberServer(const char* aServerName, const IPAddress& aServerAddress, uint16_t aServerPort);
+
+        // Request headers are collected and sent in one write by finishHeaders()
+        void queueHeader(const char* aText);
+        void queueHeader(int aValue);
+        void flushHeaders();
+
+        // Receive buffer, all of the response is read through it
+        int rawAvailable();
+        int rawRead(uint8_t *buf, size_t size);
+        int fillBuffer();
+        int timedRead();
+        int readLine();
+
+        void headerByte(char c);
+        void parseHeaderLine();
+        void endOfHeaders();
+        int readChunkSize();
+
         /** Send the first part of the request and the initial headers.
           @param aServerName Name of the server being connected to.  If NULL, the
                              "Host" header line won't be sent
@@ -406,22 +479,24 @@ class HttpClient : public Client {
         void finishHeaders();
 
         // Number of milliseconds that we wait each time there isn't any data
-        // available to be read (during status code and header processing)
-        static const int kHttpWaitForDataDelay = 1000;
+        // available to be read.  available() of the client already waits on the
+        // socket for a short while, so this only yields between polls
+        static const int kHttpWaitForDataDelay = 1;
         // Number of milliseconds that we'll wait in total without receiveing any
         // data before returning HTTP_ERROR_TIMED_OUT (during status code and header
         // processing)
         static const int kHttpResponseTimeout = 30*1000;
-        static const char* kContentLengthPrefix;
+        static const int kHttpRxBufferSize = 512;
+        static const int kHttpTxBufferSize = 256;
+        static const int kHttpStreamBufferSize = 4096;
+        static const int kHttpMaxLineLength = 128;
+        static const int kHttpMaxServerNameLength = 64;
         typedef enum {
             eIdle,
             eRequestStarted,
             eRequestSent,
             eReadingStatusCode,
             eStatusCodeRead,
-            eReadingContentLength,
-            eSkipToEndOfHeader,
-            eLineStartingCRFound,
             eReadingBody
         } tHttpState;
         // Ethernet client we're using
@@ -434,8 +509,29 @@ class HttpClient : public Client {
         int iContentLength;
         // How many bytes of the response body have been read by the user
         int iBodyLengthConsumed;
-        // How far through a Content-Length header prefix we are
-        const char* iContentLengthPtr;
+        // Chunked response: bytes left in the current chunk, whether the CRLF
+        // after its data is still to be read and whether the last chunk was read
+        bool iChunked;
+        int iChunkRemaining;
+        bool iChunkCRLF;
+        bool iChunkEnd;
+        // Whether the request body is being sent as chunks
+        bool iChunkedRequest;
+        bool iKeepAlive;
+        // Set when the server will close the connection after this response
+        bool iServerClose;
+        // Server the open connection was made to
+        char iServerName[kHttpMaxServerNameLength];
+        IPAddress iServerAddress;
+        uint16_t iServerPort;
+        uint8_t iRxBuffer[kHttpRxBufferSize];
+        uint16_t iRxPos;
+        uint16_t iRxLen;
+        uint8_t iTxBuffer[kHttpTxBufferSize];
+        uint16_t iTxLen;
+        // Current status, header or chunk size line
+        char iLine[kHttpMaxLineLength];
+        uint16_t iLineLen;
         // Address of the proxy to use, if we're using one
         IPAddress iProxyAddress;
         uint16_t iProxyPort;
@@ -0,0 +1,81 @@
+/*
+ This example serves the files on the SD card and a live MJPEG stream from
+ the camera with the HttpServer library. Each browser is served by its own
+ thread, and all viewers of /stream share one JPEG capture per frame.
+
+ Open http://<board IP>/ for the page below, http://<board IP>/files for the
+ SD card file list, or http://<board IP>/stream for the video only.
+ */
+
+#include <WiFi.h>
+#include "VideoStream.h"
+#include "AmebaFatFS.h"
+#include "HttpServer.h"
+#include "HttpMJPEGStream.h"
+
+#define CHANNEL 0
+
+VideoSetting config(VIDEO_HD, CAM_FPS, VIDEO_JPEG, 1);
+
+char ssid[] = "Network_SSID";   // your network SSID (name)
+char pass[] = "Password";       // your network password
+int status = WL_IDLE_STATUS;
+
+AmebaFatFS fs;
+HttpServer server(80);
+HttpMJPEGStream mjpeg;
+
+const char index_html[] =
+    "<html><head><title>Ameba Camera</title></head><body>"
+    "<h3>Live view</h3><img src=\"/stream\" width=\"640\">"
+    "<p><a href=\"/files\">SD card files</a> | <a href=\"/status\">Status</a></p>"
+    "</body></html>";
+
+void grabFrame(uint32_t* addr, uint32_t* len) {
+    Camera.getImage(CHANNEL, addr, len);
+}
+
+void handleRoot(HttpRequest& request) {
+    request.send("200 OK", "text/html", index_html);
+}
+
+void handleStatus(HttpRequest& request) {
+    char body[128];
+    snprintf(body, sizeof(body), "{\"viewers\":%d,\"frames\":%lu,\"dropped\":%lu}", mjpeg.viewers(), mjpeg.framesCaptured(), mjpeg.framesDropped());
+    request.send("200 OK", "application/json", body);
+}
+
+void setup() {
+    char dir[64];
+
+    Serial.begin(115200);
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+        delay(2000);
+    }
+
+    Camera.configVideoChannel(CHANNEL, config);
+    Camera.videoInit();
+    Camera.channelBegin(CHANNEL);
+
+    fs.begin();
+    sprintf(dir, "%s", fs.getRootPath());
+
+    server.on("/", handleRoot);
+    server.on("/status", handleStatus);
+    server.serveStatic("/files", dir);
+    mjpeg.begin(grabFrame, 15);
+    server.streamMJPEG("/stream", mjpeg);
+    server.begin();
+
+    Serial.print("Open http://");
+    Serial.println(WiFi.localIP());
+}
+
+void loop() {
+    delay(10000);
+    server.printInfo();
+    mjpeg.printInfo();
+}
@@ -0,0 +1,265 @@
+#include "HttpMJPEGStream.h"
+
+#define MJPEG_STREAM_WAIT_TIMEOUT       1000
+#define MJPEG_STREAM_END_TIMEOUT        3000
+
+static const char mjpeg_boundary[] = "\r\n--" MJPEG_STREAM_BOUNDARY "\r\n";
+
+HttpMJPEGStream::HttpMJPEGStream() {
+    _grabber = NULL;
+    _interval = 0;
+    _running = false;
+    _thread = 0;
+    _lock = 0;
+    _wakeup = 0;
+    _viewer_count = 0;
+    _latest = -1;
+    _seq = 0;
+    _dropped = 0;
+    _sent = 0;
+    memset(_slots, 0, sizeof(_slots));
+    for (int i = 0; i < MJPEG_STREAM_MAX_VIEWERS; i++) {
+        _viewer_sem[i] = 0;
+        _viewer_active[i] = false;
+    }
+}
+
+HttpMJPEGStream::~HttpMJPEGStream() {
+    end();
+}
+
+int HttpMJPEGStream::begin(HttpFrameGrabber grabber, uint8_t maxFps) {
+    if (_running) {
+        return 1;
+    }
+    if (grabber == NULL) {
+        return 0;
+    }
+    _grabber = grabber;
+    _interval = maxFps ? (1000 / maxFps) : 0;
+    if (_lock == 0) {
+        _lock = os_semaphore_create_arduino(1);
+        _wakeup = os_semaphore_create_arduino(1);
+        for (int i = 0; i < MJPEG_STREAM_MAX_VIEWERS; i++) {
+            _viewer_sem[i] = os_semaphore_create_arduino(1);
+        }
+    }
+    _latest = -1;
+    _running = true;
+    _thread = os_thread_create_arduino(captureThread, this, OS_PRIORITY_NORMAL, MJPEG_STREAM_STACK_SIZE);
+    if (_thread == 0) {
+        printf("\r\n[ERROR] %s MJPEG capture thread create failed\n", __FUNCTION__);
+        _running = false;
+        return 0;
+    }
+    return 1;
+}
+
+void HttpMJPEGStream::end() {
+    uint32_t start = millis();
+
+    if (_lock == 0) {
+        return;
+    }
+    _running = false;
+    os_semaphore_release_arduino(_wakeup);
+    for (int i = 0; i < MJPEG_STREAM_MAX_VIEWERS; i++) {
+        os_semaphore_release_arduino(_viewer_sem[i]);
+    }
+    // viewers leave once their current frame is sent
+    while (((_thread != 0) || (_viewer_count > 0)) && ((millis() - start) < MJPEG_STREAM_END_TIMEOUT)) {
+        delay(10);
+    }
+    if ((_thread != 0) || (_viewer_count > 0)) {
+        printf("\r\n[ERROR] %s MJPEG stream still in use, frames not freed\n", __FUNCTION__);
+        return;
+    }
+    for (int i = 0; i < MJPEG_STREAM_FRAME_SLOTS; i++) {
+        free(_slots[i].data);
+    }
+    memset(_slots, 0, sizeof(_slots));
+    _latest = -1;
+}
+
+uint8_t HttpMJPEGStream::viewers() {
+    return _viewer_count;
+}
+
+uint32_t HttpMJPEGStream::framesCaptured() {
+    return _seq;
+}
+
+uint32_t HttpMJPEGStream::framesDropped() {
+    return _dropped;
+}
+
+void HttpMJPEGStream::captureThread(const void* argument) {
+    HttpMJPEGStream* self = (HttpMJPEGStream*)argument;
+    uint32_t addr;
+    uint32_t len;
+
+    while (self->_running) {
+        if (self->_viewer_count == 0) {
+            // nobody watching, leave the camera alone until the first viewer joins
+            os_semaphore_wait_arduino(self->_wakeup, 0xFFFFFFFF);
+            continue;
+        }
+
+        uint32_t start = millis();
+        addr = 0;
+        len = 0;
+        self->_grabber(&addr, &len);
+        if ((addr == 0) || (len == 0)) {
+            delay(10);
+            continue;
+        }
+
+        // Any slot no viewer is sending and that is not the newest frame can be overwritten
+        int slot = -1;
+        os_semaphore_wait_arduino(self->_lock, 0xFFFFFFFF);
+        for (int i = 0; i < MJPEG_STREAM_FRAME_SLOTS; i++) {
+            if ((self->_slots[i].users == 0) && (i != self->_latest)) {
+                slot = i;
+                break;
+            }
+        }
+        os_semaphore_release_arduino(self->_lock);
+
+        if (slot < 0) {
+            self->_dropped++;
+        } else {
+            frame_slot_t* frame = &self->_slots[slot];
+            if (len > frame->size) {
+                free(frame->data);
+                // some headroom so small changes in frame size don't reallocate
+                frame->size = len + (len / 4);
+                frame->data = (uint8_t*)malloc(frame->size);
+                if (frame->data == NULL) {
+                    printf("\r\n[ERROR] %s MJPEG frame allocation failed\n", __FUNCTION__);
+                    frame->size = 0;
+                    self->_dropped++;
+                    delay(100);
+                    continue;
+                }
+            }
+            memcpy(frame->data, (uint8_t*)addr, len);
+
+            os_semaphore_wait_arduino(self->_lock, 0xFFFFFFFF);
+            frame->len = len;
+            frame->seq = ++self->_seq;
+            self->_latest = slot;
+            os_semaphore_release_arduino(self->_lock);
+
+            for (int i = 0; i < MJPEG_STREAM_MAX_VIEWERS; i++) {
+                if (self->_viewer_active[i]) {
+                    os_semaphore_release_arduino(self->_viewer_sem[i]);
+                }
+            }
+        }
+
+        uint32_t elapsed = millis() - start;
+        if (elapsed < self->_interval) {
+            delay(self->_interval - elapsed);
+        }
+    }
+    self->_thread = 0;
+    os_thread_terminate_arduino(os_thread_get_id_arduino());
+}
+
+int HttpMJPEGStream::join() {
+    int id = -1;
+
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    for (int i = 0; i < MJPEG_STREAM_MAX_VIEWERS; i++) {
+        if (!_viewer_active[i]) {
+            _viewer_active[i] = true;
+            _viewer_count++;
+            id = i;
+            break;
+        }
+    }
+    os_semaphore_release_arduino(_lock);
+    if ((id >= 0) && (_viewer_count == 1)) {
+        os_semaphore_release_arduino(_wakeup);
+    }
+    return id;
+}
+
+void HttpMJPEGStream::leave(int id) {
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    _viewer_active[id] = false;
+    _viewer_count--;
+    os_semaphore_release_arduino(_lock);
+}
+
+// Take a reference to the newest frame if it is newer than lastSeq
+int HttpMJPEGStream::acquireLatest(uint32_t lastSeq) {
+    int slot = -1;
+
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    if ((_latest >= 0) && (_slots[_latest].seq != lastSeq)) {
+        slot = _latest;
+        _slots[slot].users++;
+    }
+    os_semaphore_release_arduino(_lock);
+    return slot;
+}
+
+void HttpMJPEGStream::release(int slot) {
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    _slots[slot].users--;
+    os_semaphore_release_arduino(_lock);
+}
+
+void HttpMJPEGStream::serve(HttpRequest& request) {
+    char part[96];
+    uint32_t lastSeq = 0;
+    int id;
+
+    if (!_running) {
+        request.serverError();
+        return;
+    }
+    id = join();
+    if (id < 0) {
+        httpd_response_too_many_requests(request.connection(), NULL);
+        return;
+    }
+
+    request.beginResponse("200 OK", "multipart/x-mixed-replace; boundary=" MJPEG_STREAM_BOUNDARY, 0);
+    request.addHeader("Cache-Control", "no-cache");
+    if (request.endHeaders() < 0) {
+        leave(id);
+        return;
+    }
+
+    while (_running) {
+        os_semaphore_wait_arduino(_viewer_sem[id], MJPEG_STREAM_WAIT_TIMEOUT);
+        int slot = acquireLatest(lastSeq);
+        if (slot < 0) {
+            continue;
+        }
+        frame_slot_t* frame = &_slots[slot];
+        int len = snprintf(part, sizeof(part), "%sContent-Type: image/jpeg\r\nContent-Length: %lu\r\n\r\n", ((lastSeq == 0) ? "--" MJPEG_STREAM_BOUNDARY "\r\n" : ""), frame->len);
+        // the slot stays untouched by the capture thread until released
+        bool ok = (request.write((uint8_t*)part, len) >= 0) && (request.write(frame->data, frame->len) >= 0) && (request.write((uint8_t*)mjpeg_boundary, (sizeof(mjpeg_boundary) - 1)) >= 0);
+        lastSeq = frame->seq;
+        release(slot);
+        if (!ok) {
+            break;
+        }
+        _sent++;
+    }
+    leave(id);
+}
+
+void HttpMJPEGStream::printInfo() {
+    printf("\r\n------------------------------------------\r\n");
+    printf("MJPEG Stream: %s\r\n", (_running ? "running" : "stopped"));
+    printf("Viewers: %d\r\n", _viewer_count);
+    printf("Frames captured: %lu, dropped: %lu, sent: %lu\r\n", _seq, _dropped, _sent);
+    for (int i = 0; i < MJPEG_STREAM_FRAME_SLOTS; i++) {
+        printf("Slot %d: %lu/%lu bytes, frame %lu, %d users\r\n", i, _slots[i].len, _slots[i].size, _slots[i].seq, _slots[i].users);
+    }
+    printf("------------------------------------------\r\n");
+}
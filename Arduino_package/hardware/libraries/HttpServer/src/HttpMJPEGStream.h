@@ -0,0 +1,68 @@
+#ifndef HttpMJPEGStream_h
+#define HttpMJPEGStream_h
+
+#include <Arduino.h>
+#include "HttpServer.h"
+
+#define MJPEG_STREAM_MAX_VIEWERS        HTTP_SERVER_MAX_CONNECTIONS
+// latest frame, frames still being sent to slow viewers and the one being captured
+#define MJPEG_STREAM_FRAME_SLOTS        3
+#define MJPEG_STREAM_BOUNDARY           "ameba-mjpeg-frame"
+#define MJPEG_STREAM_STACK_SIZE         2048
+
+// Fetch one encoded JPEG, i.e. Camera.getImage(CHANNEL, addr, len)
+typedef void (*HttpFrameGrabber)(uint32_t* addr, uint32_t* len);
+
+// MJPEG source shared by every viewer. One thread grabs frames only while
+// someone is watching and copies each into a reference counted slot, every
+// viewer then sends the newest slot, so a slow viewer skips frames instead of
+// holding up the camera or the other viewers.
+class HttpMJPEGStream {
+    public:
+        HttpMJPEGStream();
+        ~HttpMJPEGStream();
+
+        // Returns 1 if successful, 0 on failure
+        int begin(HttpFrameGrabber grabber, uint8_t maxFps = 30);
+        void end();
+
+        uint8_t viewers();
+        uint32_t framesCaptured();
+        uint32_t framesDropped();
+        void printInfo();
+
+        // Send the stream on a request until the viewer disconnects, called by HttpServer
+        void serve(HttpRequest& request);
+
+    private:
+        typedef struct {
+            uint8_t* data;
+            uint32_t size;
+            uint32_t len;
+            uint32_t seq;
+            uint8_t users;
+        } frame_slot_t;
+
+        static void captureThread(const void* argument);
+        int join();
+        void leave(int id);
+        int acquireLatest(uint32_t lastSeq);
+        void release(int slot);
+
+        HttpFrameGrabber _grabber;
+        uint32_t _interval;
+        volatile bool _running;
+        uint32_t _thread;
+        uint32_t _lock;
+        uint32_t _wakeup;
+        uint32_t _viewer_sem[MJPEG_STREAM_MAX_VIEWERS];
+        bool _viewer_active[MJPEG_STREAM_MAX_VIEWERS];
+        volatile uint8_t _viewer_count;
+        frame_slot_t _slots[MJPEG_STREAM_FRAME_SLOTS];
+        volatile int _latest;
+        uint32_t _seq;
+        uint32_t _dropped;
+        uint32_t _sent;
+};
+
+#endif
@@ -0,0 +1,701 @@
+#include "HttpServer.h"
+#include "HttpMJPEGStream.h"
+#include <stdarg.h>
+
+extern "C" {
+#include "ff.h"
+}
+
+#define HTTP_SERVER_MAX_STATIC_FILES    64
+#define HTTP_SERVER_LIST_FLUSH          768
+#define HTTP_SERVER_LIST_BUFFER_SIZE    (HTTP_SERVER_LIST_FLUSH + (4 * HTTP_SERVER_MAX_PATH_LENGTH))
+#define HTTP_SERVER_LIST_FAILED         ((size_t)-1)
+
+// httpd page callbacks carry no context, there is only one httpd to route for
+static HttpServer* http_server = NULL;
+
+typedef struct {
+    const char* ext;
+    const char* type;
+} http_content_type_t;
+
+static const http_content_type_t http_content_types[] = {
+    {".html", "text/html"},
+    {".htm",  "text/html"},
+    {".css",  "text/css"},
+    {".js",   "application/javascript"},
+    {".json", "application/json"},
+    {".txt",  "text/plain"},
+    {".csv",  "text/csv"},
+    {".xml",  "text/xml"},
+    {".png",  "image/png"},
+    {".jpg",  "image/jpeg"},
+    {".jpeg", "image/jpeg"},
+    {".gif",  "image/gif"},
+    {".bmp",  "image/bmp"},
+    {".ico",  "image/x-icon"},
+    {".svg",  "image/svg+xml"},
+    {".mp4",  "video/mp4"},
+    {".mp3",  "audio/mpeg"},
+    {".wav",  "audio/wav"},
+    {".aac",  "audio/aac"},
+    {".pdf",  "application/pdf"},
+    {".zip",  "application/zip"},
+};
+
+// Cache line aligned buffer for SD card reads, *raw is the pointer to free
+static uint8_t* http_alloc_aligned(size_t size, uint8_t** raw) {
+    *raw = (uint8_t*)malloc(size + HTTP_SERVER_BUFFER_ALIGN - 1);
+    if (*raw == NULL) {
+        return NULL;
+    }
+    return (uint8_t*)(((uint32_t)*raw + HTTP_SERVER_BUFFER_ALIGN - 1) & ~(HTTP_SERVER_BUFFER_ALIGN - 1));
+}
+
+static char* http_strdup(const char* str) {
+    char* copy = (char*)malloc(strlen(str) + 1);
+    if (copy != NULL) {
+        strcpy(copy, str);
+    }
+    return copy;
+}
+
+// Join a directory and a name with exactly one '/' between them
+static void http_path_join(char* out, size_t len, const char* dir, const char* name) {
+    size_t dir_len = strlen(dir);
+    bool slash = (dir_len > 0) && (dir[dir_len - 1] == '/');
+    snprintf(out, len, "%s%s%s", dir, (slash ? "" : "/"), name);
+}
+
+static int http_hex_value(char c) {
+    if ((c >= '0') && (c <= '9')) {
+        return c - '0';
+    }
+    if ((c >= 'a') && (c <= 'f')) {
+        return c - 'a' + 10;
+    }
+    if ((c >= 'A') && (c <= 'F')) {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static void http_url_decode(char* str) {
+    char* out = str;
+
+    while (*str != '\0') {
+        if ((str[0] == '%') && (http_hex_value(str[1]) >= 0) && (http_hex_value(str[2]) >= 0)) {
+            *out++ = (http_hex_value(str[1]) << 4) | http_hex_value(str[2]);
+            str += 3;
+        } else if (*str == '+') {
+            *out++ = ' ';
+            str++;
+        } else {
+            *out++ = *str++;
+        }
+    }
+    *out = '\0';
+}
+
+static size_t http_url_encode(char* out, size_t len, const char* str) {
+    static const char hex[] = "0123456789ABCDEF";
+    size_t n = 0;
+
+    for (; (*str != '\0') && ((n + 4) < len); str++) {
+        uint8_t c = *str;
+        if (isalnum(c) || (c == '-') || (c == '_') || (c == '.') || (c == '~')) {
+            out[n++] = c;
+        } else {
+            out[n++] = '%';
+            out[n++] = hex[c >> 4];
+            out[n++] = hex[c & 0x0F];
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
+
+// Names go into the page as text and attributes, entities are never split when truncated
+static size_t http_html_escape(char* out, size_t len, const char* str) {
+    size_t n = 0;
+
+    for (; *str != '\0'; str++) {
+        const char* entity = NULL;
+        switch (*str) {
+            case '&': entity = "&amp;"; break;
+            case '<': entity = "&lt;"; break;
+            case '>': entity = "&gt;"; break;
+            case '"': entity = "&quot;"; break;
+            case '\'': entity = "&#39;"; break;
+            default: break;
+        }
+        size_t add = (entity != NULL) ? strlen(entity) : 1;
+        if ((n + add) >= len) {
+            break;
+        }
+        if (entity != NULL) {
+            memcpy(&out[n], entity, add);
+        } else {
+            out[n] = *str;
+        }
+        n += add;
+    }
+    out[n] = '\0';
+    return n;
+}
+
+//-----------------------------------------------------------------------------
+// HttpRequest
+
+HttpRequest::HttpRequest(struct httpd_conn* conn) {
+    size_t len = conn->request.path_len;
+
+    _conn = conn;
+    if (len >= sizeof(_path)) {
+        len = sizeof(_path) - 1;
+    }
+    if (conn->request.path != NULL) {
+        memcpy(_path, conn->request.path, len);
+    } else {
+        len = 0;
+    }
+    _path[len] = '\0';
+}
+
+bool HttpRequest::isMethod(const char* method) {
+    return (httpd_request_is_method(_conn, (char*)method) == 1);
+}
+
+const char* HttpRequest::path() {
+    return _path;
+}
+
+size_t HttpRequest::contentLength() {
+    return _conn->request.content_len;
+}
+
+bool HttpRequest::query(const char* key, char* value, size_t len) {
+    char* result = NULL;
+
+    if ((len == 0) || (httpd_request_get_query_key(_conn, (char*)key, &result) != 0) || (result == NULL)) {
+        return false;
+    }
+    strncpy(value, result, (len - 1));
+    value[len - 1] = '\0';
+    httpd_free(result);
+    return true;
+}
+
+bool HttpRequest::header(const char* field, char* value, size_t len) {
+    char* result = NULL;
+
+    if ((len == 0) || (httpd_request_get_header_field(_conn, (char*)field, &result) != 0) || (result == NULL)) {
+        return false;
+    }
+    strncpy(value, result, (len - 1));
+    value[len - 1] = '\0';
+    httpd_free(result);
+    return true;
+}
+
+int HttpRequest::read(uint8_t* buf, size_t len) {
+    return httpd_request_read_data(_conn, buf, len);
+}
+
+int HttpRequest::send(const char* status, const char* contentType, const uint8_t* body, size_t len) {
+    if ((beginResponse(status, contentType, len) < 0) || (endHeaders() < 0)) {
+        return -1;
+    }
+    if ((body != NULL) && (len > 0)) {
+        return write(body, len);
+    }
+    return 0;
+}
+
+int HttpRequest::send(const char* status, const char* contentType, const char* body) {
+    return send(status, contentType, (const uint8_t*)body, ((body != NULL) ? strlen(body) : 0));
+}
+
+int HttpRequest::beginResponse(const char* status, const char* contentType, size_t contentLength) {
+    if (httpd_response_write_header_start(_conn, (char*)status, (char*)contentType, contentLength) < 0) {
+        return -1;
+    }
+    // the connection is closed after every response
+    return httpd_response_write_header(_conn, (char*)"Connection", (char*)"close");
+}
+
+int HttpRequest::addHeader(const char* name, const char* value) {
+    return httpd_response_write_header(_conn, (char*)name, (char*)value);
+}
+
+int HttpRequest::endHeaders() {
+    int ret = httpd_response_write_header_finish(_conn);
+    return (ret < 0) ? ret : 0;
+}
+
+int HttpRequest::write(const uint8_t* buf, size_t len) {
+    return httpd_response_write_data(_conn, (uint8_t*)buf, len);
+}
+
+int HttpRequest::write(const char* str) {
+    return write((const uint8_t*)str, strlen(str));
+}
+
+const char* HttpRequest::contentTypeFor(const char* path) {
+    const char* ext = strrchr(path, '.');
+
+    if (ext != NULL) {
+        for (size_t i = 0; i < (sizeof(http_content_types) / sizeof(http_content_types[0])); i++) {
+            if (strcasecmp(ext, http_content_types[i].ext) == 0) {
+                return http_content_types[i].type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+int HttpRequest::sendFile(const char* path, const char* contentType) {
+    FIL* file;
+    uint8_t* raw;
+    uint8_t* buf;
+    char range[48];
+    char value[64];
+    uint32_t size;
+    uint32_t start = 0;
+    uint32_t end;
+    UINT len;
+    int ret = 0;
+
+    file = (FIL*)malloc(sizeof(FIL));
+    if (file == NULL) {
+        serverError();
+        return -1;
+    }
+    if (f_open(file, path, FA_READ) != FR_OK) {
+        free(file);
+        notFound();
+        return -1;
+    }
+    size = f_size(file);
+    end = (size > 0) ? (size - 1) : 0;
+
+    // Single range only, enough for browsers seeking in a recording
+    if ((size > 0) && header("Range", range, sizeof(range)) && (strncmp(range, "bytes=", 6) == 0)) {
+        char* dash = strchr(&range[6], '-');
+        if ((dash != NULL) && isdigit(range[6])) {
+            start = strtoul(&range[6], NULL, 10);
+            if (isdigit(dash[1])) {
+                end = strtoul(&dash[1], NULL, 10);
+            }
+        }
+        if ((start >= size) || (end < start)) {
+            f_close(file);
+            free(file);
+            send("416 Range Not Satisfiable", "text/plain", "Range not satisfiable");
+            return -1;
+        }
+        if (end >= size) {
+            end = size - 1;
+        }
+    }
+
+    buf = http_alloc_aligned(HTTP_SERVER_FILE_BUFFER_SIZE, &raw);
+    if ((buf == NULL) || ((start > 0) && (f_lseek(file, start) != FR_OK))) {
+        f_close(file);
+        free(file);
+        free(raw);
+        serverError();
+        return -1;
+    }
+
+    if ((size > 0) && ((start > 0) || (end < (size - 1)))) {
+        beginResponse("206 Partial Content", (contentType ? contentType : contentTypeFor(path)), (end - start + 1));
+        snprintf(value, sizeof(value), "bytes %lu-%lu/%lu", start, end, size);
+        addHeader("Content-Range", value);
+    } else {
+        beginResponse("200 OK", (contentType ? contentType : contentTypeFor(path)), size);
+        if (size == 0) {
+            // a length of 0 leaves the header out, an empty body has to be stated
+            addHeader("Content-Length", "0");
+        }
+    }
+    addHeader("Accept-Ranges", "bytes");
+    endHeaders();
+
+    // Read straight into the aligned buffer and hand it to the socket, no copy in between
+    uint32_t remaining = (size > 0) ? (end - start + 1) : 0;
+    while (remaining > 0) {
+        UINT want = (remaining < HTTP_SERVER_FILE_BUFFER_SIZE) ? remaining : HTTP_SERVER_FILE_BUFFER_SIZE;
+        if ((f_read(file, buf, want, &len) != FR_OK) || (len == 0)) {
+            printf("\r\n[ERROR] %s File read failed\n", __FUNCTION__);
+            ret = -1;
+            break;
+        }
+        if (write(buf, len) < 0) {
+            // client went away
+            ret = -1;
+            break;
+        }
+        remaining -= len;
+    }
+
+    f_close(file);
+    free(file);
+    free(raw);
+    return ret;
+}
+
+void HttpRequest::notFound() {
+    httpd_response_not_found(_conn, NULL);
+}
+
+void HttpRequest::badRequest() {
+    httpd_response_bad_request(_conn, NULL);
+}
+
+void HttpRequest::methodNotAllowed() {
+    httpd_response_method_not_allowed(_conn, NULL);
+}
+
+void HttpRequest::serverError() {
+    httpd_response_internal_server_error(_conn, NULL);
+}
+
+//-----------------------------------------------------------------------------
+// HttpServer
+
+HttpServer::HttpServer(uint16_t port) {
+    _port = port;
+    _running = false;
+    _routes = NULL;
+    _lock = os_semaphore_create_arduino(1);
+}
+
+HttpServer::~HttpServer() {
+    end();
+    while (_routes != NULL) {
+        route_t* next = _routes->next;
+        free(_routes->path);
+        free(_routes->target);
+        free(_routes);
+        _routes = next;
+    }
+    if (_lock) {
+        os_semaphore_delete_arduino(_lock);
+    }
+}
+
+int HttpServer::begin(uint8_t maxConnections, bool multiThread) {
+    if (_running) {
+        return 1;
+    }
+    if ((http_server != NULL) && (http_server != this)) {
+        printf("\r\n[ERROR] %s Another HttpServer is running\n", __FUNCTION__);
+        return 0;
+    }
+    http_server = this;
+    for (route_t* route = _routes; route != NULL; route = route->next) {
+        httpd_reg_page_callback(route->path, pageCallback);
+    }
+    if (httpd_start(_port, maxConnections, HTTP_SERVER_STACK_SIZE, (multiThread ? HTTPD_THREAD_MULTIPLE : HTTPD_THREAD_SINGLE), HTTPD_SECURE_NONE) != 0) {
+        printf("\r\n[ERROR] %s httpd start on port %d failed\n", __FUNCTION__, _port);
+        httpd_clear_page_callbacks();
+        http_server = NULL;
+        return 0;
+    }
+    _running = true;
+    return 1;
+}
+
+void HttpServer::end() {
+    if (!_running) {
+        return;
+    }
+    // also closes the connections and clears the page callbacks
+    httpd_stop();
+    _running = false;
+    http_server = NULL;
+}
+
+bool HttpServer::running() {
+    return _running;
+}
+
+void HttpServer::setIdleTimeout(int seconds) {
+    httpd_setup_idle_timeout(seconds);
+}
+
+void HttpServer::setDebug(uint8_t level) {
+    httpd_setup_debug(level);
+}
+
+HttpServer::route_t* HttpServer::addRoute(route_type_t type, const char* path, const char* target) {
+    route_t* route = (route_t*)malloc(sizeof(route_t));
+
+    if (route == NULL) {
+        printf("\r\n[ERROR] %s Route allocation failed\n", __FUNCTION__);
+        return NULL;
+    }
+    memset(route, 0, sizeof(route_t));
+    route->type = type;
+    route->path = http_strdup(path);
+    route->target = target ? http_strdup(target) : NULL;
+    if ((route->path == NULL) || (target && (route->target == NULL))) {
+        printf("\r\n[ERROR] %s Route allocation failed\n", __FUNCTION__);
+        free(route->path);
+        free(route->target);
+        free(route);
+        return NULL;
+    }
+
+    // Append fully built, handler threads walk the list without the lock
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    route_t** tail = &_routes;
+    while (*tail != NULL) {
+        tail = &(*tail)->next;
+    }
+    *tail = route;
+    os_semaphore_release_arduino(_lock);
+
+    if (_running) {
+        httpd_reg_page_callback(route->path, pageCallback);
+    }
+    return route;
+}
+
+HttpServer::route_t* HttpServer::findRoute(const uint8_t* path, size_t len) {
+    for (route_t* route = _routes; route != NULL; route = route->next) {
+        if ((strlen(route->path) == len) && (memcmp(route->path, path, len) == 0)) {
+            return route;
+        }
+    }
+    return NULL;
+}
+
+int HttpServer::on(const char* path, HttpRouteHandler handler) {
+    route_t* route;
+
+    if ((path == NULL) || (handler == NULL)) {
+        return 0;
+    }
+    route = addRoute(ROUTE_HANDLER, path, NULL);
+    if (route == NULL) {
+        return 0;
+    }
+    route->handler = handler;
+    return 1;
+}
+
+int HttpServer::serveStatic(const char* uri, const char* dir) {
+    DIR* d;
+    FILINFO* info;
+    char route_path[HTTP_SERVER_MAX_PATH_LENGTH];
+    char file_path[HTTP_SERVER_MAX_PATH_LENGTH + 16];
+    int count = 0;
+
+    if ((uri == NULL) || (dir == NULL) || (addRoute(ROUTE_DIR, uri, dir) == NULL)) {
+        return 0;
+    }
+
+    // Give each file present now its own path, later files go through the ?name= query
+    d = (DIR*)malloc(sizeof(DIR));
+    info = (FILINFO*)malloc(sizeof(FILINFO));
+    if ((d == NULL) || (info == NULL) || (f_opendir(d, dir) != FR_OK)) {
+        free(d);
+        free(info);
+        return 1;
+    }
+    while ((f_readdir(d, info) == FR_OK) && (info->fname[0] != '\0')) {
+        if ((info->fattrib & (AM_DIR | AM_HID | AM_SYS)) || (info->fname[0] == '.')) {
+            continue;
+        }
+        if (count >= HTTP_SERVER_MAX_STATIC_FILES) {
+            break;
+        }
+        http_path_join(route_path, sizeof(route_path), uri, info->fname);
+        http_path_join(file_path, sizeof(file_path), dir, info->fname);
+        if (addRoute(ROUTE_FILE, route_path, file_path) != NULL) {
+            count++;
+        }
+    }
+    f_closedir(d);
+    free(d);
+    free(info);
+    return 1;
+}
+
+int HttpServer::streamMJPEG(const char* path, HttpMJPEGStream& stream) {
+    route_t* route = addRoute(ROUTE_MJPEG, path, NULL);
+
+    if (route == NULL) {
+        return 0;
+    }
+    route->stream = &stream;
+    return 1;
+}
+
+// Append one formatted piece of the listing at buf[n], sending what is already in the buffer
+// first when the piece does not fit behind it. Returns the new fill, or HTTP_SERVER_LIST_FAILED
+// once the client has gone away.
+size_t HttpServer::appendList(HttpRequest& request, char* buf, size_t n, const char* format, ...) {
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(&buf[n], (HTTP_SERVER_LIST_BUFFER_SIZE - n), format, args);
+    va_end(args);
+    if (len < 0) {
+        return n;
+    }
+    if ((size_t)len < (HTTP_SERVER_LIST_BUFFER_SIZE - n)) {
+        return (n + len);
+    }
+    if (n > 0) {
+        if (request.write((uint8_t*)buf, n) < 0) {
+            return HTTP_SERVER_LIST_FAILED;
+        }
+        va_start(args, format);
+        len = vsnprintf(buf, HTTP_SERVER_LIST_BUFFER_SIZE, format, args);
+        va_end(args);
+        if (len < 0) {
+            return 0;
+        }
+    }
+    // longer than the whole buffer, only what vsnprintf copied goes out
+    if ((size_t)len >= HTTP_SERVER_LIST_BUFFER_SIZE) {
+        len = HTTP_SERVER_LIST_BUFFER_SIZE - 1;
+    }
+    return len;
+}
+
+void HttpServer::serveDir(HttpRequest& request, route_t* route) {
+    char name[HTTP_SERVER_MAX_QUERY_LENGTH];
+    char path[HTTP_SERVER_MAX_PATH_LENGTH + HTTP_SERVER_MAX_QUERY_LENGTH];
+    char dir[2 * HTTP_SERVER_MAX_PATH_LENGTH];
+    char text[2 * HTTP_SERVER_MAX_PATH_LENGTH];
+    FILINFO* info;
+    DIR* d;
+    uint8_t* raw;
+    char* buf;
+    size_t n = 0;
+
+    if (request.query("name", name, sizeof(name))) {
+        http_url_decode(name);
+        // stay inside the served directory
+        if ((name[0] == '\0') || (name[0] == '/') || (strstr(name, "..") != NULL)) {
+            request.badRequest();
+            return;
+        }
+        http_path_join(path, sizeof(path), route->target, name);
+        request.sendFile(path);
+        return;
+    }
+
+    info = (FILINFO*)malloc(sizeof(FILINFO));
+    if (info == NULL) {
+        request.serverError();
+        return;
+    }
+    http_path_join(path, sizeof(path), route->target, "index.html");
+    if (f_stat(path, info) == FR_OK) {
+        free(info);
+        request.sendFile(path);
+        return;
+    }
+
+    // File listing, written through one buffer instead of a socket write per line
+    d = (DIR*)malloc(sizeof(DIR));
+    buf = (char*)http_alloc_aligned(HTTP_SERVER_LIST_BUFFER_SIZE, &raw);
+    if ((d == NULL) || (buf == NULL) || (f_opendir(d, route->target) != FR_OK)) {
+        free(d);
+        free(raw);
+        free(info);
+        request.notFound();
+        return;
+    }
+    request.beginResponse("200 OK", "text/html", 0);
+    request.endHeaders();
+    http_html_escape(dir, sizeof(dir), route->path);
+    n = appendList(request, buf, n, "<html><head><title>%s</title></head><body><h3>%s</h3><table>\r\n", dir, dir);
+    while ((n != HTTP_SERVER_LIST_FAILED) && (f_readdir(d, info) == FR_OK) && (info->fname[0] != '\0')) {
+        if ((info->fattrib & (AM_DIR | AM_HID | AM_SYS)) || (info->fname[0] == '.')) {
+            continue;
+        }
+        http_url_encode(name, sizeof(name), info->fname);
+        http_html_escape(text, sizeof(text), info->fname);
+        n = appendList(request, buf, n, "<tr><td><a href=\"%s?name=%s\">%s</a></td><td align=\"right\">%lu</td></tr>\r\n", dir, name, text, (uint32_t)info->fsize);
+        if ((n != HTTP_SERVER_LIST_FAILED) && (n >= HTTP_SERVER_LIST_FLUSH)) {
+            n = (request.write((uint8_t*)buf, n) < 0) ? HTTP_SERVER_LIST_FAILED : 0;
+        }
+    }
+    if (n != HTTP_SERVER_LIST_FAILED) {
+        n = appendList(request, buf, n, "</table></body></html>\r\n");
+    }
+    if ((n != HTTP_SERVER_LIST_FAILED) && (n > 0)) {
+        request.write((uint8_t*)buf, n);
+    }
+
+    f_closedir(d);
+    free(d);
+    free(raw);
+    free(info);
+}
+
+void HttpServer::pageCallback(struct httpd_conn* conn) {
+    HttpServer* server = http_server;
+    route_t* route = NULL;
+    HttpRequest request(conn);
+
+    if (server != NULL) {
+        route = server->findRoute(conn->request.path, conn->request.path_len);
+    }
+    if (route == NULL) {
+        request.notFound();
+    } else {
+        route->hits++;
+        switch (route->type) {
+            case ROUTE_HANDLER:
+                route->handler(request);
+                break;
+            case ROUTE_FILE:
+                if (request.isMethod("GET")) {
+                    request.sendFile(route->target);
+                } else {
+                    request.methodNotAllowed();
+                }
+                break;
+            case ROUTE_DIR:
+                serveDir(request, route);
+                break;
+            case ROUTE_MJPEG:
+                route->stream->serve(request);
+                break;
+            default:
+                break;
+        }
+    }
+    httpd_conn_close(conn);
+}
+
+void HttpServer::printInfo() {
+    printf("\r\n------------------------------------------\r\n");
+    printf("HTTP Server on port %d: %s\r\n", _port, (_running ? "running" : "stopped"));
+    for (route_t* route = _routes; route != NULL; route = route->next) {
+        const char* type = "handler";
+        switch (route->type) {
+            case ROUTE_FILE:
+                type = "file";
+                break;
+            case ROUTE_DIR:
+                type = "directory";
+                break;
+            case ROUTE_MJPEG:
+                type = "mjpeg";
+                break;
+            default:
+                break;
+        }
+        printf("  %-32s %-10s %lu requests\r\n", route->path, type, route->hits);
+    }
+    printf("------------------------------------------\r\n");
+}
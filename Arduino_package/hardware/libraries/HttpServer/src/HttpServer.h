@@ -0,0 +1,131 @@
+#ifndef HttpServer_h
+#define HttpServer_h
+
+#include <Arduino.h>
+// pulls in <atomic> for C++, so it must come before the C linkage block below
+#include "platform_stdlib.h"
+
+extern "C" {
+#include "httpd/httpd.h"
+}
+
+#define HTTP_SERVER_MAX_CONNECTIONS     4
+#define HTTP_SERVER_STACK_SIZE          (8 * 1024)
+// File reads are whole multiples of the SD sector size into a cache line aligned
+// buffer, so FatFS reads the card straight into it without its sector buffer
+#define HTTP_SERVER_FILE_BUFFER_SIZE    (8 * 1024)
+#define HTTP_SERVER_BUFFER_ALIGN        32
+#define HTTP_SERVER_MAX_PATH_LENGTH     128
+#define HTTP_SERVER_MAX_QUERY_LENGTH    128
+
+class HttpMJPEGStream;
+
+// One request, valid inside the route handler only
+class HttpRequest {
+    public:
+        HttpRequest(struct httpd_conn* conn);
+
+        bool isMethod(const char* method);
+        const char* path();
+        size_t contentLength();
+
+        // Copy a query string value or request header into value
+        // Returns true if found
+        bool query(const char* key, char* value, size_t len);
+        bool header(const char* field, char* value, size_t len);
+
+        // Read the request body
+        int read(uint8_t* buf, size_t len);
+
+        // Send a whole response
+        int send(const char* status, const char* contentType, const uint8_t* body, size_t len);
+        int send(const char* status, const char* contentType, const char* body);
+
+        // Send a response in parts: beginResponse(), any addHeader(), endHeaders(), then write()
+        // contentLength 0 sends no Content-Length, the body then ends when the connection closes
+        int beginResponse(const char* status, const char* contentType, size_t contentLength);
+        int addHeader(const char* name, const char* value);
+        int endHeaders();
+        int write(const uint8_t* buf, size_t len);
+        int write(const char* str);
+
+        // Send a file from the SD card, honouring a "Range: bytes=" request header
+        // path is the FatFS path, the content type is taken from the extension if NULL
+        int sendFile(const char* path, const char* contentType = NULL);
+
+        void notFound();
+        void badRequest();
+        void methodNotAllowed();
+        void serverError();
+
+        struct httpd_conn* connection() { return _conn; };
+
+        static const char* contentTypeFor(const char* path);
+
+    private:
+        struct httpd_conn* _conn;
+        char _path[HTTP_SERVER_MAX_PATH_LENGTH];
+};
+
+typedef void (*HttpRouteHandler)(HttpRequest& request);
+
+// HTTP server on the SDK httpd. There is a single httpd in the system, so only
+// one HttpServer can be running at a time.
+class HttpServer {
+    public:
+        HttpServer(uint16_t port = 80);
+        ~HttpServer();
+
+        // Start the server, with multiThread each connection is handled by its own thread
+        // so a long response such as a video stream does not hold up other clients
+        // Returns 1 if successful, 0 on failure
+        int begin(uint8_t maxConnections = HTTP_SERVER_MAX_CONNECTIONS, bool multiThread = true);
+        void end();
+
+        // Routes may be added before or after begin()
+        int on(const char* path, HttpRouteHandler handler);
+
+        // Serve the files in the FatFS directory dir under uri, i.e. uri "/rec" and dir "0:/rec"
+        // serves "0:/rec/a.mp4" at "/rec/a.mp4". Files added after this call are reached as
+        // "/rec?name=a.mp4". uri itself returns index.html if present, else a file listing.
+        int serveStatic(const char* uri, const char* dir);
+
+        // Serve a multipart/x-mixed-replace MJPEG stream, all viewers share the frames of one stream
+        int streamMJPEG(const char* path, HttpMJPEGStream& stream);
+
+        void setIdleTimeout(int seconds);
+        void setDebug(uint8_t level);
+        bool running();
+        void printInfo();
+
+    private:
+        typedef enum {
+            ROUTE_HANDLER,
+            ROUTE_FILE,
+            ROUTE_DIR,
+            ROUTE_MJPEG,
+        } route_type_t;
+
+        typedef struct route_s {
+            struct route_s* next;
+            route_type_t type;
+            char* path;
+            char* target;           // file or directory for static routes
+            HttpRouteHandler handler;
+            HttpMJPEGStream* stream;
+            uint32_t hits;
+        } route_t;
+
+        static void pageCallback(struct httpd_conn* conn);
+        static void serveDir(HttpRequest& request, route_t* route);
+        static size_t appendList(HttpRequest& request, char* buf, size_t n, const char* format, ...);
+        route_t* addRoute(route_type_t type, const char* path, const char* target);
+        route_t* findRoute(const uint8_t* path, size_t len);
+
+        uint16_t _port;
+        bool _running;
+        route_t* _routes;
+        uint32_t _lock;
+};
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ Hands raw microphone samples to the sketch and analyses them.
+
+ Every 20 ms block is measured on the audio stream task through the block
+ callback. loop() reads the same samples from the tap ring buffer, runs a
+ 512 point FFT and prints the energy in a few frequency bands. The tap only
+ reads the audio frames, so an encoder can be registered as another output
+ of the same stream without losing any of its buffers.
+ */
+
+#include "StreamIO.h"
+#include "AudioStream.h"
+#include "PCMTap.h"
+#include "AudioDSP.h"
+
+// Default audio preset configurations:
+// 0 :  8kHz Mono Analog Mic
+// 1 : 16kHz Mono Analog Mic
+// 2 :  8kHz Mono Digital PDM Mic
+// 3 : 16kHz Mono Digital PDM Mic
+AudioSetting configA(1);
+Audio audio;
+PCMTap tap;
+StreamIO audioStreamer(1, 1);   // 1 Input Audio -> 1 Output PCM tap
+
+#define FFT_SIZE        512
+#define BAND_COUNT      4
+
+AudioBiquad highPass;
+AudioLevel level;
+AudioFFT fft;
+int16_t samples[FFT_SIZE];
+float edges[BAND_COUNT + 1] = {100, 500, 1000, 2000, 4000};
+float energies[BAND_COUNT];
+
+volatile float loudest = -100;
+volatile uint32_t loudestIndex = 0;
+
+void onBlock(const int16_t* block, uint32_t count, uint32_t index, void* arg) {
+    // runs on the audio stream task, keep it short
+    level.measure(block, count);
+    if (level.dBFS() > loudest) {
+        loudest = level.dBFS();
+        loudestIndex = index;
+    }
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    audio.configAudio(configA);
+    audio.begin();
+
+    tap.configAudio(configA);
+    tap.setBufferSize(500);
+    tap.setBlockCallback(onBlock, (tap.sampleRate() / 50));
+    tap.begin();
+
+    highPass.highPass(tap.sampleRate(), 80);
+    fft.begin(FFT_SIZE, tap.sampleRate());
+
+    audioStreamer.registerInput(audio);
+    audioStreamer.registerOutput(tap);
+    if (audioStreamer.begin() != 0) {
+        Serial.println("StreamIO link start failed");
+    }
+}
+
+void loop() {
+    if (tap.available() < FFT_SIZE) {
+        delay(10);
+        return;
+    }
+    uint32_t index = tap.readIndex();
+    tap.read(samples, FFT_SIZE);
+    highPass.process(samples, samples, FFT_SIZE);
+    fft.process(samples);
+    fft.bandEnergies(edges, BAND_COUNT, energies);
+
+    Serial.print("t=");
+    Serial.print((index * 1000) / tap.sampleRate());
+    Serial.print("ms bands:");
+    for (int i = 0; i < BAND_COUNT; i++) {
+        Serial.print(" ");
+        Serial.print(10 * log10f(energies[i] + 1e-10f), 1);
+    }
+    Serial.print(" dB, loudest block ");
+    Serial.print(loudest, 1);
+    Serial.print(" dBFS at sample ");
+    Serial.println(loudestIndex);
+    loudest = -100;
+
+    if (tap.overruns()) {
+        tap.printInfo();
+    }
+}
@@ -0,0 +1,85 @@
+/*  This example saves 1080p JPEG images from the camera to the SD card
+    in the background, as a timelapse with a burst of full frame rate
+    images every 30 seconds.
+
+    Frames are buffered in memory and written by the JPEGWriter task, so
+    capture does not wait for the SD card. Set PACK_FRAMES to 0 to save
+    one .jpg per frame, or above 1 to pack that many frames into each
+    indexed .jpk file, which saves the FAT and directory updates of every
+    small file. Frames that do not fit in the buffer are dropped and
+    counted.
+
+ Example guide:
+ https://www.amebaiot.com/en/amebapro2-arduino-video-jpeg-sdcard/
+*/
+#include "StreamIO.h"
+#include "VideoStream.h"
+#include "JPEGWriter.h"
+#include "AmebaFatFS.h"
+
+#define CHANNEL 0
+#define INTERVAL 500
+#define BURST_FRAMES 30
+#define BURST_PERIOD 30000
+#define PACK_FRAMES 100
+
+// Use a pre-defined resolution, or choose to configure your own resolution
+VideoSetting config(VIDEO_FHD, CAM_FPS, VIDEO_JPEG, 0);
+JPEGWriter jpegWriter;
+StreamIO videoStreamer(1, 1);   // 1 Input Video -> 1 Output JPEGWriter
+AmebaFatFS fs;
+
+uint32_t lastBurst = 0;
+
+void setup() {
+    Serial.begin(115200);
+
+    fs.begin();
+
+    Camera.configVideoChannel(CHANNEL, config);
+    Camera.videoInit();
+
+    // Configure the writer: 8 MB of buffer covers a burst at full frame rate
+    jpegWriter.configVideo(config);
+    jpegWriter.setPath(fs.getRootPath());
+    jpegWriter.setFilePrefix("timelapse");
+    jpegWriter.setInterval(INTERVAL);
+    jpegWriter.setBufferSize(8 * 1024 * 1024, 32);
+    jpegWriter.setPackFrames(PACK_FRAMES);
+    jpegWriter.begin();
+
+    // Configure StreamIO object to stream data from video channel to the writer
+    videoStreamer.registerInput(Camera.getStream(CHANNEL));
+    videoStreamer.registerOutput(jpegWriter);
+    if (videoStreamer.begin() != 0) {
+        Serial.println("StreamIO link start failed");
+    }
+
+    Camera.channelBegin(CHANNEL);
+    jpegWriter.capture();
+    lastBurst = millis();
+}
+
+void loop() {
+    if ((millis() - lastBurst) >= BURST_PERIOD) {
+        uint32_t start = jpegWriter.getFrameCount() + jpegWriter.getDroppedCount();
+
+        // Every frame for a moment, the burst goes to a file of its own
+        jpegWriter.flush();
+        jpegWriter.setInterval(0);
+        jpegWriter.capture(BURST_FRAMES);
+        while ((jpegWriter.getFrameCount() + jpegWriter.getDroppedCount() - start) < BURST_FRAMES) {
+            delay(10);
+        }
+        jpegWriter.flush();
+        jpegWriter.printInfo();
+
+        // Back to the timelapse
+        jpegWriter.setInterval(INTERVAL);
+        jpegWriter.capture();
+        lastBurst = millis();
+    }
+
+    printf("Saved %lu frames, %lu dropped, %.2f MB/s\r\n", jpegWriter.getFrameCount(), jpegWriter.getDroppedCount(), jpegWriter.getSustainedRate());
+    delay(5000);
+}
@@ -0,0 +1,110 @@
+/*
+ This sketch records a short MP4 clip each time a PIR sensor wakes the board
+ from deep sleep, and the clip starts at the first frame after wake instead of
+ when setup() is done.
+
+ VideoFastStart starts the camera in the background while setup() loads the
+ object detection model and connects to WiFi, and holds the H264 frames encoded
+ in the meantime. Once the SD card recording is ready it gets the held frames
+ first, then the live ones. Before going back to sleep the sketch prints the
+ boot phase markers, which give the time from wake to the first frame
+ ("first_frame") and to the first detection ("first_detection").
+
+ Connect the PIR sensor output to AON GPIO pin 21.
+ */
+
+#include "WiFi.h"
+#include "StreamIO.h"
+#include "VideoStream.h"
+#include "VideoFastStart.h"
+#include "MP4Recording.h"
+#include "NNObjectDetection.h"
+#include "PowerMode.h"
+
+#define CHANNEL     0
+#define CHANNELNN   3
+
+// Lower resolution for NN processing
+#define NNWIDTH     576
+#define NNHEIGHT    320
+
+#define RECORD_SECONDS  10
+#define WAKEUP_SOURCE   1       // AON GPIO
+#define WAKEUP_PIN      21
+
+VideoSetting config(VIDEO_FHD, 30, VIDEO_H264, 0);
+VideoSetting configNN(NNWIDTH, NNHEIGHT, 10, VIDEO_RGB, 0);
+VideoFastStart fastStart;
+MP4Recording mp4;
+NNObjectDetection ObjDet;
+StreamIO videoStreamerNN(1, 1);
+
+char ssid[] = "yourNetwork";    // your network SSID (name)
+char pass[] = "Password";       // your network password
+
+void setup() {
+    Serial.begin(115200);
+
+    // Every channel has to be configured before the camera starts
+    Camera.configVideoChannel(CHANNEL, config);
+    Camera.configVideoChannel(CHANNELNN, configNN);
+
+    // Hold up to 3 seconds of video until the recording is ready
+    fastStart.configVideo(config);
+    fastStart.setBufferSize(3 * 1024 * 1024, 90);
+    fastStart.begin(CHANNEL);
+
+    // The model loads and WiFi connects while the camera starts
+    ObjDet.configVideo(configNN);
+    ObjDet.setResultCallback(ODPostProcess);
+    ObjDet.modelSelect(OBJECT_DETECTION, DEFAULT_YOLOV4TINY, NA_MODEL, NA_MODEL);
+    ObjDet.begin();
+
+    WiFi.begin(ssid, pass);
+
+    if (!fastStart.waitVideo()) {
+        Serial.println("Camera start failed");
+    }
+
+    // The NN channel can start once the camera runs
+    videoStreamerNN.registerInput(Camera.getStream(CHANNELNN));
+    videoStreamerNN.setStackSize();
+    videoStreamerNN.setTaskPriority();
+    videoStreamerNN.registerOutput(ObjDet);
+    if (videoStreamerNN.begin() != 0) {
+        Serial.println("StreamIO link start failed");
+    }
+    Camera.channelBegin(CHANNELNN);
+
+    mp4.configVideo(config);
+    mp4.setRecordingDuration(RECORD_SECONDS);
+    mp4.setRecordingFileCount(1);
+    mp4.setRecordingFileName("WakeRecording");
+    mp4.setRecordingDataType(STORAGE_VIDEO);    // Set MP4 to record video only
+    mp4.begin();
+
+    // The held frames go to the recording first, then every new frame
+    fastStart.registerOutput(mp4);
+    fastStart.release();
+}
+
+void loop() {
+    if (mp4.getRecordingState()) {
+        delay(100);
+        return;
+    }
+
+    bootPrintMarks();
+    fastStart.printInfo();
+
+    PowerMode.begin(DEEPSLEEP_MODE, WAKEUP_SOURCE, WAKEUP_PIN);
+    PowerMode.start();
+}
+
+// User callback function for post processing of object detection results
+void ODPostProcess(std::vector<ObjectDetectionResult> results) {
+    for (uint32_t i = 0; i < results.size(); i++) {
+        ObjectDetectionResult item = results[i];
+        printf("%lu ms since wake %s:\t%d%%\r\n", (bootTime() / 1000), item.name(), item.score());
+    }
+}
@@ -0,0 +1,83 @@
+/*
+
+ Scan QR codes and barcodes from a low resolution NV12 video stream.
+ Decoding only runs for a short window after motion is detected,
+ so the processor stays idle while the scene is static.
+ */
+
+#include "VideoStream.h"
+#include "StreamIO.h"
+#include "MotionDetection.h"
+#include "QRCodeScanner.h"
+
+#define CHANNELQR 1     // NV12 video for QR code scanning
+#define CHANNELMD 3     // RGB format video for motion detection only avaliable on channel 3
+
+VideoSetting configQR(VIDEO_VGA, 10, VIDEO_NV12, 0);    // Low resolution NV12 video for QR code scanning
+VideoSetting configMD(VIDEO_VGA, 10, VIDEO_RGB, 0);     // Low resolution RGB video for motion detection
+StreamIO videoStreamerQR(1, 1);
+StreamIO videoStreamerMD(1, 1);
+MotionDetection MD;
+QRCodeScanner QR;
+
+void mdPostProcess(std::vector<MotionDetectionResult> md_results) {
+    // Keep scanning for 2 seconds after the last motion event
+    if (md_results.size() > 0) {
+        QR.triggerScan(2000);
+    }
+}
+
+void qrPostProcess(std::vector<QRCodeResult> qr_results) {
+    for (uint16_t i = 0; i < qr_results.size(); i++) {
+        QRCodeResult result = qr_results[i];
+        int xmin = (int)(result.xMin() * configQR.width());
+        int xmax = (int)(result.xMax() * configQR.width());
+        int ymin = (int)(result.yMin() * configQR.height());
+        int ymax = (int)(result.yMax() * configQR.height());
+        printf("%s [%d %d %d %d]: %s\r\n", result.typeName(), xmin, xmax, ymin, ymax, result.data().c_str());
+    }
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    Camera.configVideoChannel(CHANNELQR, configQR);
+    Camera.configVideoChannel(CHANNELMD, configMD);
+    Camera.videoInit();
+
+    // Configure motion detection for low resolution RGB video stream
+    MD.configVideo(configMD);
+    MD.setResultCallback(mdPostProcess);
+    MD.begin();
+
+    // Only scan the center of the frame, decode every other frame, and wait for motion
+    QR.configVideo(configQR);
+    QR.configRegionOfInterest(0.2, 0.8, 0.1, 0.9);
+    QR.setFrameSkip(1);
+    QR.setMotionTrigger(true);
+    QR.setResultCallback(qrPostProcess);
+    QR.begin();
+
+    // Configure StreamIO object to stream data from NV12 video channel to QR code scanner
+    videoStreamerQR.registerInput(Camera.getStream(CHANNELQR));
+    videoStreamerQR.setStackSize();
+    videoStreamerQR.registerOutput(QR);
+    if (videoStreamerQR.begin() != 0) {
+        Serial.println("StreamIO link start failed");
+    }
+    Camera.channelBegin(CHANNELQR);
+
+    // Configure StreamIO object to stream data from RGB video channel to motion detection
+    videoStreamerMD.registerInput(Camera.getStream(CHANNELMD));
+    videoStreamerMD.setStackSize();
+    videoStreamerMD.registerOutput(MD);
+    if (videoStreamerMD.begin() != 0) {
+        Serial.println("StreamIO link start failed");
+    }
+    Camera.channelBegin(CHANNELMD);
+}
+
+void loop() {
+    QR.printInfo();
+    delay(10000);
+}
@@ -0,0 +1,87 @@
+/*
+ Stream H264 video as fragmented MP4 over HTTP.
+ Open http://<board IP>/ in a browser to use the built-in player page,
+ or point any MSE based player at http://<board IP>/stream.mp4
+
+ Several browsers can watch at the same time, they all share the fragments
+ produced from a single encoder output.
+*/
+
+#include "WiFi.h"
+#include "StreamIO.h"
+#include "VideoStream.h"
+#include "HTTPFMP4.h"
+
+#define CHANNEL 0
+
+// Default preset configurations for each video channel:
+// Channel 0 : 1920 x 1080 30FPS H264
+// Channel 1 : 1280 x 720  30FPS H264
+
+VideoSetting config(VIDEO_HD, CAM_FPS, VIDEO_H264, 0);
+HTTPFMP4 httpfmp4;
+StreamIO videoStreamer(1, 1);   // 1 Input Video -> 1 Output HTTPFMP4
+
+char ssid[] = "yourNetwork";    // your network SSID (name)
+char pass[] = "Password";       // your network password
+int status = WL_IDLE_STATUS;
+
+void setup() {
+    Serial.begin(115200);
+
+    // attempt to connect to Wifi network:
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to WPA SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+
+        // wait 2 seconds for connection:
+        delay(2000);
+    }
+
+    // Configure camera video channel with video format information
+    config.setBitrate(2 * 1024 * 1024);
+    Camera.configVideoChannel(CHANNEL, config);
+    Camera.videoInit();
+
+    // Configure HTTP fMP4 sink with identical video format information
+    // Shorter fragments lower the latency at the cost of a little more overhead
+    httpfmp4.configVideo(config);
+    httpfmp4.configPort(80);
+    httpfmp4.setFragmentDuration(200);
+    httpfmp4.setMaxClients(4);
+    httpfmp4.begin();
+
+    // Configure StreamIO object to stream data from video channel to HTTP fMP4 sink
+    videoStreamer.registerInput(Camera.getStream(CHANNEL));
+    videoStreamer.registerOutput(httpfmp4);
+    if (videoStreamer.begin() != 0) {
+        Serial.println("StreamIO link start failed");
+    }
+
+    // Start data stream from video channel
+    Camera.channelBegin(CHANNEL);
+
+    delay(1000);
+    printInfo();
+}
+
+void loop() {
+    delay(5000);
+    httpfmp4.printInfo();
+}
+
+void printInfo(void) {
+    Serial.println("------------------------------");
+    Serial.println("- Summary of Streaming -");
+    Serial.println("------------------------------");
+    Camera.printInfo();
+
+    IPAddress ip = WiFi.localIP();
+
+    Serial.println("- HTTP fMP4 -");
+    Serial.print("http://");
+    Serial.print(ip);
+    Serial.print(":");
+    Serial.println(httpfmp4.getPort());
+}
@@ -0,0 +1,56 @@
+/*
+ Stream video to a USB host as a standard UVC webcam, no network required.
+ Connect the board USB port to a PC and open the camera in any webcam
+ application (VLC, OBS, the Windows Camera app, guvcview).
+
+ Encoded frames are passed to the USB stack without being copied.
+ The host must select the same format and resolution as the video channel,
+ use setFormatChangeCallback() to follow what the host asks for.
+*/
+
+#include "StreamIO.h"
+#include "VideoStream.h"
+#include "UVCDevice.h"
+
+#define CHANNEL 0
+
+// Supported formats: VIDEO_H264, VIDEO_JPEG, VIDEO_NV12
+VideoSetting config(VIDEO_FHD, CAM_FPS, VIDEO_H264, 0);
+UVCDevice uvc;
+StreamIO videoStreamer(1, 1);   // 1 Input Video -> 1 Output UVC
+
+void uvcFormatChanged(uint8_t encoder, uint16_t width, uint16_t height, uint16_t fps) {
+    // Called from the USB stack, keep it short
+    printf("\r\nHost selected encoder %d %dx%d @ %d FPS\n", encoder, width, height, fps);
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    // Configure camera video channel with video format information
+    Camera.configVideoChannel(CHANNEL, config);
+    Camera.videoInit();
+
+    // Configure UVC device with identical video format information
+    uvc.configVideo(config);
+    uvc.setFormatChangeCallback(uvcFormatChanged);
+    uvc.begin();
+
+    // Configure StreamIO object to stream data from video channel to USB
+    videoStreamer.registerInput(Camera.getStream(CHANNEL));
+    videoStreamer.registerOutput(uvc);
+    if (videoStreamer.begin() != 0) {
+        Serial.println("StreamIO link start failed");
+    }
+
+    // Start data stream from video channel
+    Camera.channelBegin(CHANNEL);
+
+    delay(1000);
+    Camera.printInfo();
+}
+
+void loop() {
+    delay(5000);
+    uvc.printInfo();
+}
@@ -0,0 +1,110 @@
+#include "AudioDSP.h"
+
+void AudioLevel::measure(const int16_t* samples, uint32_t count) {
+    AudioDspLevel(samples, count, &_level);
+}
+
+float AudioLevel::rms(void) {
+    return _level.rms;
+}
+
+float AudioLevel::dBFS(void) {
+    if (_level.rms < 0.00001f) {
+        return -100.0f;
+    }
+    return 20.0f * log10f(_level.rms);
+}
+
+int16_t AudioLevel::peak(void) {
+    return _level.peak;
+}
+
+uint32_t AudioLevel::clipped(void) {
+    return _level.clipped;
+}
+
+AudioBiquad::AudioBiquad(void) {
+    memset(&_bq, 0, sizeof(_bq));
+}
+
+bool AudioBiquad::lowPass(float sampleRate, float freq, float q, uint8_t stage) {
+    return (AudioDspBiquadLowPass(&_bq, stage, sampleRate, freq, q) == 0);
+}
+
+bool AudioBiquad::highPass(float sampleRate, float freq, float q, uint8_t stage) {
+    return (AudioDspBiquadHighPass(&_bq, stage, sampleRate, freq, q) == 0);
+}
+
+bool AudioBiquad::bandPass(float sampleRate, float freq, float q, uint8_t stage) {
+    return (AudioDspBiquadBandPass(&_bq, stage, sampleRate, freq, q) == 0);
+}
+
+bool AudioBiquad::setCoefficients(uint8_t stage, float b0, float b1, float b2, float a1, float a2) {
+    return (AudioDspBiquadSet(&_bq, stage, b0, b1, b2, a1, a2) == 0);
+}
+
+void AudioBiquad::process(const int16_t* in, int16_t* out, uint32_t count) {
+    AudioDspBiquadProcess(&_bq, in, out, count);
+}
+
+void AudioBiquad::reset(void) {
+    AudioDspBiquadReset(&_bq);
+}
+
+AudioFFT::AudioFFT(void) {
+    memset(&_fft, 0, sizeof(_fft));
+}
+
+AudioFFT::~AudioFFT(void) {
+    end();
+}
+
+bool AudioFFT::begin(uint16_t size, float sampleRate) {
+    _sampleRate = sampleRate;
+    if (AudioDspFftInit(&_fft, size) < 0) {
+        printf("\r\n[ERROR] %s FFT of %d points not supported or out of memory\n", __FUNCTION__, size);
+        return false;
+    }
+    return true;
+}
+
+void AudioFFT::end(void) {
+    if (_fft.size) {
+        AudioDspFftDeinit(&_fft);
+    }
+}
+
+const float* AudioFFT::process(const int16_t* samples) {
+    if (_fft.size == 0) {
+        return NULL;
+    }
+    return AudioDspFftPower(&_fft, samples);
+}
+
+uint16_t AudioFFT::size(void) {
+    return _fft.size;
+}
+
+uint16_t AudioFFT::bins(void) {
+    return _fft.size ? ((_fft.size / 2) + 1) : 0;
+}
+
+float AudioFFT::binFrequency(uint16_t bin) {
+    return _fft.size ? ((bin * _sampleRate) / _fft.size) : 0.0f;
+}
+
+float AudioFFT::power(uint16_t bin) {
+    return (bin < bins()) ? _fft.power[bin] : 0.0f;
+}
+
+float AudioFFT::bandEnergy(float low, float high) {
+    return AudioDspBandEnergy(&_fft, _sampleRate, low, high);
+}
+
+void AudioFFT::bandEnergies(const float* edges, uint8_t count, float* energies) {
+    if (_fft.size == 0) {
+        memset(energies, 0, count * sizeof(float));
+        return;
+    }
+    AudioDspBandEnergies(&_fft, _sampleRate, edges, count, energies);
+}
@@ -0,0 +1,71 @@
+#ifndef __AUDIODSP_H__
+#define __AUDIODSP_H__
+
+#include <Arduino.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "audio_dsp.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+// Level of a block of 16 bit samples
+class AudioLevel {
+    public:
+        void measure(const int16_t* samples, uint32_t count);
+        float rms(void);                // 0.0 to 1.0 of full scale
+        float dBFS(void);               // -100 for silence
+        int16_t peak(void);
+        uint32_t clipped(void);
+
+    private:
+        audio_dsp_level_t _level = {0};
+};
+
+// Up to four cascaded second order sections on 16 bit samples.
+// Coefficients are Q14, so very low cut off frequencies at high sample rates lose accuracy.
+class AudioBiquad {
+    public:
+        AudioBiquad(void);
+
+        bool lowPass(float sampleRate, float freq, float q = 0.7071, uint8_t stage = 0);
+        bool highPass(float sampleRate, float freq, float q = 0.7071, uint8_t stage = 0);
+        bool bandPass(float sampleRate, float freq, float q = 0.7071, uint8_t stage = 0);
+        // Coefficients normalised to a0 = 1
+        bool setCoefficients(uint8_t stage, float b0, float b1, float b2, float a1, float a2);
+        void process(const int16_t* in, int16_t* out, uint32_t count);
+        void reset(void);
+
+    private:
+        audio_dsp_biquad_t _bq;
+};
+
+// Hann windowed real FFT of 16 bit samples, a full scale sine centred on a bin reads 1.0
+class AudioFFT {
+    public:
+        AudioFFT(void);
+        ~AudioFFT(void);
+
+        bool begin(uint16_t size, float sampleRate);
+        void end(void);
+        // Transform size samples, returns size / 2 + 1 power bins
+        const float* process(const int16_t* samples);
+
+        uint16_t size(void);
+        uint16_t bins(void);
+        float binFrequency(uint16_t bin);
+        float power(uint16_t bin);
+        float bandEnergy(float low, float high);
+        // Energies of count bands, band i spans edges[i] to edges[i + 1] Hz
+        void bandEnergies(const float* edges, uint8_t count, float* energies);
+
+    private:
+        audio_dsp_fft_t _fft;
+        float _sampleRate = 8000;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include <Arduino.h>
+#include "HTTPFMP4.h"
+
+HTTPFMP4::HTTPFMP4(void) {
+}
+
+HTTPFMP4::~HTTPFMP4(void) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    end();
+    if (HTTPFMP4Deinit(_p_mmf_context) == NULL) {
+        _p_mmf_context = NULL;
+    } else {
+        printf("\r\n[ERROR] HTTPFMP4 deinit failed\n");
+    }
+}
+
+void HTTPFMP4::configVideo(VideoSetting& config) {
+    if (config._encoder != VIDEO_H264) {
+        printf("\r\n[ERROR] HTTPFMP4 only supports H264 format.\n");
+        return;
+    }
+    // HTTPFMP4Init if not previously done so
+    if (_p_mmf_context == NULL) {
+        _p_mmf_context = HTTPFMP4Init();
+    }
+    if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] HTTPFMP4 init failed\n");
+        return;
+    }
+
+    _params.width = config._w;
+    _params.height = config._h;
+    _params.fps = config._fps;
+}
+
+void HTTPFMP4::configPort(uint16_t port) {
+    _params.port = port;
+}
+
+void HTTPFMP4::setFragmentDuration(uint32_t ms) {
+    _params.fragment_ms = ms;
+}
+
+void HTTPFMP4::setMaxClients(uint8_t count) {
+    if (count > HTTPFMP4_MAX_CLIENTS) {
+        printf("\r\n[WARN] HTTPFMP4 supports up to %d clients\n", HTTPFMP4_MAX_CLIENTS);
+        count = HTTPFMP4_MAX_CLIENTS;
+    }
+    _params.max_clients = count;
+}
+
+void HTTPFMP4::setSegmentDepth(uint8_t count) {
+    _params.segment_depth = count;
+}
+
+void HTTPFMP4::begin(void) {
+    if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] Need HTTPFMP4 init first\n");
+        return;
+    }
+    HTTPFMP4SetParams(_p_mmf_context->priv, &_params);
+    HTTPFMP4SetApply(_p_mmf_context->priv);
+    HTTPFMP4SetStreaming(_p_mmf_context->priv, 1);
+}
+
+void HTTPFMP4::end(void) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    HTTPFMP4SetStreaming(_p_mmf_context->priv, 0);
+}
+
+uint16_t HTTPFMP4::getPort(void) {
+    return _params.port;
+}
+
+uint8_t HTTPFMP4::getClientCount(void) {
+    if (_p_mmf_context == NULL) {
+        return 0;
+    }
+    return HTTPFMP4GetClientCount(_p_mmf_context->priv);
+}
+
+uint32_t HTTPFMP4::getFragmentCount(void) {
+    httpfmp4_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        HTTPFMP4GetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.fragments;
+}
+
+uint32_t HTTPFMP4::getDroppedCount(void) {
+    httpfmp4_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        HTTPFMP4GetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.dropped;
+}
+
+void HTTPFMP4::printInfo(void) {
+    httpfmp4_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        HTTPFMP4GetStats(_p_mmf_context->priv, &stats);
+    }
+    printf("\r\n[INFO] HTTPFMP4 port %d, fragment %lu ms, clients %lu/%d, fragments %lu, dropped %lu\n", _params.port, _params.fragment_ms, stats.clients, _params.max_clients, stats.fragments, stats.dropped);
+}
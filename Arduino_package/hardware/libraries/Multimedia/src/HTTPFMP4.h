@@ -0,0 +1,47 @@
+#ifndef __HTTPFMP4_H__
+#define __HTTPFMP4_H__
+
+#include "VideoStream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "httpfmp4_drv.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+class HTTPFMP4:public MMFModule {
+    public:
+        HTTPFMP4(void);
+        ~HTTPFMP4(void);
+
+        void configVideo(VideoSetting& config);
+        void configPort(uint16_t port);
+        void setFragmentDuration(uint32_t ms);
+        void setMaxClients(uint8_t count);
+        void setSegmentDepth(uint8_t count);
+        void begin(void);
+        void end(void);
+
+        uint16_t getPort(void);
+        uint8_t getClientCount(void);
+        uint32_t getFragmentCount(void);
+        uint32_t getDroppedCount(void);
+        void printInfo(void);
+
+    private:
+        httpfmp4_params_t _params = {
+            .port = 80,
+            .width = 1920,
+            .height = 1080,
+            .fps = 30,
+            .fragment_ms = 200,
+            .max_clients = 4,
+            .segment_depth = 8,
+        };
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include <Arduino.h>
+#include "JPEGWriter.h"
+
+JPEGWriter::JPEGWriter(void) {
+}
+
+JPEGWriter::~JPEGWriter(void) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    end();
+    if (JPEGWriterDeinit(_p_mmf_context) == NULL) {
+        _p_mmf_context = NULL;
+    } else {
+        printf("\r\n[ERROR] JPEGWriter deinit failed\n");
+    }
+}
+
+void JPEGWriter::configVideo(VideoSetting& config) {
+    if (config._encoder != VIDEO_JPEG) {
+        printf("\r\n[ERROR] JPEGWriter only supports JPEG format.\n");
+        return;
+    }
+    // JPEGWriterInit if not previously done so
+    if (_p_mmf_context == NULL) {
+        _p_mmf_context = JPEGWriterInit();
+    }
+    if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] JPEGWriter init failed\n");
+        return;
+    }
+}
+
+void JPEGWriter::setPath(const char* path) {
+    size_t len;
+
+    if (path == NULL) {
+        return;
+    }
+    len = strlen(path);
+    if ((len + 2) > sizeof(_params.path)) {
+        printf("\r\n[ERROR] JPEGWriter path too long\n");
+        return;
+    }
+    strcpy(_params.path, path);
+    if ((len > 0) && (path[len - 1] != '/')) {
+        strcat(_params.path, "/");
+    }
+}
+
+void JPEGWriter::setFilePrefix(const char* prefix) {
+    if (prefix == NULL) {
+        return;
+    }
+    strncpy(_params.prefix, prefix, (sizeof(_params.prefix) - 1));
+    _params.prefix[sizeof(_params.prefix) - 1] = '\0';
+}
+
+void JPEGWriter::setInterval(uint32_t ms) {
+    _params.interval_ms = ms;
+    // takes effect at once, unlike the other settings which wait for begin()
+    if (_p_mmf_context != NULL) {
+        JPEGWriterSetInterval(_p_mmf_context->priv, ms);
+    }
+}
+
+void JPEGWriter::setBufferSize(uint32_t bytes, uint16_t frames) {
+    if (frames > JPEGWRITER_MAX_FRAMES) {
+        printf("\r\n[WARN] JPEGWriter buffers up to %d frames\n", JPEGWRITER_MAX_FRAMES);
+        frames = JPEGWRITER_MAX_FRAMES;
+    }
+    _params.queue_bytes = bytes;
+    _params.queue_frames = frames;
+}
+
+void JPEGWriter::setPackFrames(uint16_t count) {
+    if (count > JPEGWRITER_MAX_PACK) {
+        printf("\r\n[WARN] JPEGWriter packs up to %d frames per file\n", JPEGWRITER_MAX_PACK);
+        count = JPEGWRITER_MAX_PACK;
+    }
+    _params.pack_frames = count;
+}
+
+void JPEGWriter::setWriteSize(uint32_t bytes) {
+    _params.write_bytes = bytes;
+}
+
+void JPEGWriter::setPreallocate(uint32_t bytes) {
+    _params.preallocate = bytes;
+}
+
+void JPEGWriter::begin(void) {
+    if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] Need JPEGWriter init first\n");
+        return;
+    }
+    if (_params.path[0] == '\0') {
+        printf("\r\n[ERROR] JPEGWriter set a path on the SD card first\n");
+        return;
+    }
+    JPEGWriterSetParams(_p_mmf_context->priv, &_params);
+    JPEGWriterSetApply(_p_mmf_context->priv);
+}
+
+void JPEGWriter::end(void) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    stop();
+    flush();
+}
+
+void JPEGWriter::capture(uint32_t count) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    JPEGWriterCapture(_p_mmf_context->priv, count);
+}
+
+void JPEGWriter::stop(void) {
+    capture(0);
+}
+
+bool JPEGWriter::flush(uint32_t timeout) {
+    if (_p_mmf_context == NULL) {
+        return false;
+    }
+    return (JPEGWriterFlush(_p_mmf_context->priv, timeout) == 0);
+}
+
+uint32_t JPEGWriter::getFrameCount(void) {
+    jpegwriter_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        JPEGWriterGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.frames;
+}
+
+uint32_t JPEGWriter::getDroppedCount(void) {
+    jpegwriter_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        JPEGWriterGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.dropped;
+}
+
+uint32_t JPEGWriter::getFileCount(void) {
+    jpegwriter_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        JPEGWriterGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.files;
+}
+
+uint32_t JPEGWriter::getQueuedCount(void) {
+    jpegwriter_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        JPEGWriterGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.queued;
+}
+
+float JPEGWriter::getSustainedRate(void) {
+    jpegwriter_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        JPEGWriterGetStats(_p_mmf_context->priv, &stats);
+    }
+    if (stats.elapsed_ms == 0) {
+        return 0;
+    }
+    return ((float)stats.bytes / (1024 * 1024)) / ((float)stats.elapsed_ms / 1000);
+}
+
+float JPEGWriter::getCardRate(void) {
+    jpegwriter_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        JPEGWriterGetStats(_p_mmf_context->priv, &stats);
+    }
+    if (stats.write_ms == 0) {
+        return 0;
+    }
+    return ((float)stats.bytes / (1024 * 1024)) / ((float)stats.write_ms / 1000);
+}
+
+void JPEGWriter::printInfo(void) {
+    jpegwriter_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        JPEGWriterGetStats(_p_mmf_context->priv, &stats);
+    }
+    printf("\r\n------------------------------------------\r\n");
+    printf("JPEG Writer Info:\r\n");
+    printf("Frames written: %lu, dropped: %lu, files: %lu, errors: %lu\r\n", stats.frames, stats.dropped, stats.files, stats.errors);
+    printf("Buffered frames: %lu, buffer peak: %lu of %lu bytes\r\n", stats.queued, stats.queue_peak, _params.queue_bytes);
+    printf("Written: %.2f MB, sustained %.2f MB/s, card %.2f MB/s\r\n", ((float)stats.bytes / (1024 * 1024)), getSustainedRate(), getCardRate());
+    printf("------------------------------------------\r\n");
+}
@@ -0,0 +1,66 @@
+#ifndef __JPEGWRITER_H__
+#define __JPEGWRITER_H__
+
+#include "VideoStream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "jpegwriter_drv.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+// Saves JPEG frames from a video channel to the SD card from a background task.
+// Frames are copied into a buffer as they arrive and written in cluster sized, sector
+// aligned writes to files that are created and preallocated ahead of time. Frames that
+// arrive while the buffer is full are dropped and counted, capture itself never waits.
+class JPEGWriter:public MMFModule {
+    public:
+        JPEGWriter(void);
+        ~JPEGWriter(void);
+
+        void configVideo(VideoSetting& config);
+        // Directory for the files, usually AmebaFatFS::getRootPath() or a folder below it
+        void setPath(const char* path);
+        void setFilePrefix(const char* prefix);
+        void setInterval(uint32_t ms);
+        void setBufferSize(uint32_t bytes, uint16_t frames = 16);
+        // Pack count frames into each indexed .jpk file instead of one .jpg per frame
+        void setPackFrames(uint16_t count);
+        void setWriteSize(uint32_t bytes);
+        void setPreallocate(uint32_t bytes);
+        void begin(void);
+        void end(void);
+
+        // Save the next count frames, JPEGWRITER_CONTINUOUS until stop()
+        void capture(uint32_t count = JPEGWRITER_CONTINUOUS);
+        void stop(void);
+        // Wait until every buffered frame is on the card and the open file is closed
+        bool flush(uint32_t timeout = 5000);
+
+        uint32_t getFrameCount(void);
+        uint32_t getDroppedCount(void);
+        uint32_t getFileCount(void);
+        uint32_t getQueuedCount(void);
+        // MB/s written over the time since the first capture, and while the card was busy
+        float getSustainedRate(void);
+        float getCardRate(void);
+        void printInfo(void);
+
+    private:
+        jpegwriter_params_t _params = {
+            .path = {0},
+            .prefix = "image",
+            .interval_ms = 0,
+            .queue_bytes = 4 * 1024 * 1024,
+            .queue_frames = 16,
+            .pack_frames = 0,
+            .write_bytes = 64 * 1024,
+            .preallocate = 0,
+        };
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include <Arduino.h>
+#include "PCMTap.h"
+
+PCMTap::PCMTap(void) {
+    _params.sample_rate = 8000;
+    _params.channels = 1;
+}
+
+PCMTap::~PCMTap(void) {
+    end();
+}
+
+void PCMTap::configAudio(AudioSetting& config) {
+    if (config._audioParams.word_length != WL_16BIT) {
+        printf("\r\n[ERROR] PCM tap requires 16 bit audio\n");
+        return;
+    }
+    _params.sample_rate = config._sampleRate;
+    _params.channels = config._audioParams.channel;
+}
+
+void PCMTap::setBufferSize(uint32_t ms) {
+    _bufferMs = ms;
+}
+
+void PCMTap::setBlockCallback(pcm_block_cb_t callback, uint32_t blockSamples, void* arg) {
+    _callback = callback;
+    _cbArg = arg;
+    _params.block_samples = (callback != NULL) ? blockSamples : 0;
+}
+
+void PCMTap::begin(void) {
+    if (_p_mmf_context == NULL) {
+        _p_mmf_context = PCMTapInit();
+    }
+    if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] PCM tap init failed\n");
+        return;
+    }
+    _params.ring_samples = (uint32_t)(((uint64_t)_params.sample_rate * _params.channels * _bufferMs) / 1000);
+    PCMTapSetParams(_p_mmf_context->priv, &_params);
+    if (PCMTapSetApply(_p_mmf_context->priv) < 0) {
+        end();
+        return;
+    }
+    PCMTapSetCallback(_p_mmf_context->priv, _callback, _cbArg);
+}
+
+void PCMTap::end(void) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    PCMTapSetCallback(_p_mmf_context->priv, NULL, NULL);
+    if (PCMTapDeinit(_p_mmf_context) == NULL) {
+        _p_mmf_context = NULL;
+    } else {
+        printf("\r\n[ERROR] PCM tap deinit failed\n");
+    }
+}
+
+uint32_t PCMTap::available(void) {
+    if (_p_mmf_context == NULL) {
+        return 0;
+    }
+    return PCMTapAvailable(_p_mmf_context->priv);
+}
+
+uint32_t PCMTap::read(int16_t* buffer, uint32_t count) {
+    if (_p_mmf_context == NULL) {
+        return 0;
+    }
+    return PCMTapRead(_p_mmf_context->priv, buffer, count);
+}
+
+uint32_t PCMTap::acquire(const int16_t** data) {
+    if (_p_mmf_context == NULL) {
+        *data = NULL;
+        return 0;
+    }
+    return PCMTapAcquire(_p_mmf_context->priv, data);
+}
+
+void PCMTap::release(uint32_t count) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    PCMTapRelease(_p_mmf_context->priv, count);
+}
+
+uint32_t PCMTap::readIndex(void) {
+    if (_p_mmf_context == NULL) {
+        return 0;
+    }
+    return PCMTapReadIndex(_p_mmf_context->priv);
+}
+
+uint32_t PCMTap::sampleRate(void) {
+    return _params.sample_rate;
+}
+
+uint8_t PCMTap::channels(void) {
+    return _params.channels;
+}
+
+uint32_t PCMTap::overruns(void) {
+    pcm_tap_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        PCMTapGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.overruns;
+}
+
+void PCMTap::printInfo(void) {
+    pcm_tap_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        PCMTapGetStats(_p_mmf_context->priv, &stats);
+    }
+    printf("\r\n------------------------------------------\r\n");
+    printf("PCM Tap Info:\r\n");
+    printf("Format: %lu Hz, %d channel(s), 16 bit\r\n", _params.sample_rate, _params.channels);
+    printf("Read ring: %lu samples, %lu unread\r\n", _params.ring_samples, available());
+    printf("Frames: %lu, samples: %lu\r\n", stats.frames, stats.samples);
+    printf("Samples lost to overruns: %lu\r\n", stats.overruns);
+    printf("Block callbacks: %lu of %lu samples (max %lu us)\r\n", stats.blocks, _params.block_samples, stats.max_block_us);
+    printf("------------------------------------------\r\n");
+}
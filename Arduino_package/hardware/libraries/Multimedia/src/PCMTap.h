@@ -0,0 +1,56 @@
+#ifndef __PCMTAP_H__
+#define __PCMTAP_H__
+
+#include "VideoStream.h"
+#include "AudioStream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "pcm_tap_drv.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+typedef void (*pcm_block_cb_t)(const int16_t* samples, uint32_t count, uint32_t index, void* arg);
+
+// Audio sink that hands microphone PCM to the sketch, either as fixed size blocks through a
+// callback on the stream task or through a ring buffer read from any single task.
+// Register it as an extra output of the audio stream, the encoders keep their own buffers.
+class PCMTap:public MMFModule {
+    public:
+        PCMTap(void);
+        ~PCMTap(void);
+
+        void configAudio(AudioSetting& config);
+        // Capacity of the read ring, 0 to only use block callbacks
+        void setBufferSize(uint32_t ms);
+        // Call callback every blockSamples samples, index counts samples from begin()
+        void setBlockCallback(pcm_block_cb_t callback, uint32_t blockSamples, void* arg = NULL);
+        void begin(void);
+        void end(void);
+
+        // Single reader, not to be used from the block callback
+        uint32_t available(void);
+        uint32_t read(int16_t* buffer, uint32_t count);
+        // Borrow the oldest unread samples in place, then release() what was used
+        uint32_t acquire(const int16_t** data);
+        void release(uint32_t count);
+        // Index of the next sample read() returns
+        uint32_t readIndex(void);
+
+        uint32_t sampleRate(void);
+        uint8_t channels(void);
+        uint32_t overruns(void);
+        void printInfo(void);
+
+    private:
+        pcm_tap_params_t _params = {0};
+        pcm_block_cb_t _callback = NULL;
+        void* _cbArg = NULL;
+        uint32_t _bufferMs = 500;
+};
+
+#endif
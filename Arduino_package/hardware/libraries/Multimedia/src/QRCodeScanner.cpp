@@ -0,0 +1,255 @@
+#include <Arduino.h>
+#include "QRCodeScanner.h"
+
+#define LIMIT(x, lower, upper) if (x < lower) x = lower; else if (x > upper) x = upper;
+
+std::vector<QRCodeResult> QRCodeScanner::qr_result_vector;
+void (*QRCodeScanner::QR_user_CB)(std::vector<QRCodeResult>);
+uint16_t QRCodeScanner::qr_width = 0;
+uint16_t QRCodeScanner::qr_height = 0;
+
+QRCodeScanner::QRCodeScanner(void) {
+    _params.width = 640;
+    _params.height = 480;
+}
+
+QRCodeScanner::~QRCodeScanner(void) {
+    end();
+}
+
+void QRCodeScanner::configVideo(VideoSetting& config) {
+    if ((config._encoder != VIDEO_NV12) && (config._encoder != VIDEO_NV16)) {
+        printf("\r\n[ERROR] QR code scanner requires an NV12 video stream\n");
+        return;
+    }
+    _params.width = config._w;
+    _params.height = config._h;
+}
+
+void QRCodeScanner::configRegionOfInterest(float xmin, float xmax, float ymin, float ymax) {
+    LIMIT(xmin, 0.0, 1.0);
+    LIMIT(xmax, 0.0, 1.0);
+    LIMIT(ymin, 0.0, 1.0);
+    LIMIT(ymax, 0.0, 1.0);
+    if ((xmin >= xmax) || (ymin >= ymax)) {
+        printf("\r\n[ERROR] Invalid QR code scanner region of interest\n");
+        return;
+    }
+    _roi[0] = xmin;
+    _roi[1] = xmax;
+    _roi[2] = ymin;
+    _roi[3] = ymax;
+}
+
+void QRCodeScanner::setFrameSkip(uint8_t skip) {
+    _params.frame_skip = skip;
+    if (_p_mmf_context != NULL) {
+        QRCodeSetParams(_p_mmf_context->priv, &_params);
+    }
+}
+
+void QRCodeScanner::setQRCodeOnly(bool enable) {
+    _params.qr_only = enable ? 1 : 0;
+}
+
+void QRCodeScanner::setMotionTrigger(bool enable) {
+    _params.trigger_mode = enable ? 1 : 0;
+    if (_p_mmf_context != NULL) {
+        QRCodeSetParams(_p_mmf_context->priv, &_params);
+    }
+}
+
+void QRCodeScanner::triggerScan(uint32_t window_ms) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    QRCodeTrigger(_p_mmf_context->priv, window_ms);
+}
+
+void QRCodeScanner::begin(void) {
+    if (_p_mmf_context == NULL) {
+        _p_mmf_context = QRCodeInit();
+    }
+    if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] QR code scanner init failed\n");
+        return;
+    }
+
+    // align ROI to even pixels so it stays within the NV12 macro pixels
+    _params.roi_xmin = ((uint16_t)(_roi[0] * _params.width)) & ~1;
+    _params.roi_xmax = ((uint16_t)(_roi[1] * _params.width)) & ~1;
+    _params.roi_ymin = ((uint16_t)(_roi[2] * _params.height)) & ~1;
+    _params.roi_ymax = ((uint16_t)(_roi[3] * _params.height)) & ~1;
+    qr_width = _params.width;
+    qr_height = _params.height;
+
+    QRCodeSetParams(_p_mmf_context->priv, &_params);
+    if (QRCodeSetApply(_p_mmf_context->priv) < 0) {
+        end();
+        return;
+    }
+    QRCodeSetDisppost(_p_mmf_context->priv, QRResultCallback);
+}
+
+void QRCodeScanner::end(void) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    QRCodeSetDisppost(_p_mmf_context->priv, NULL);
+    if (QRCodeDeinit(_p_mmf_context) == NULL) {
+        _p_mmf_context = NULL;
+    } else {
+        printf("\r\n[ERROR] QR code scanner deinit failed\n");
+    }
+}
+
+void QRCodeScanner::setResultCallback(void (*qr_callback)(std::vector<QRCodeResult>)) {
+    QR_user_CB = qr_callback;
+}
+
+uint16_t QRCodeScanner::getResultCount(void) {
+    return qr_result_vector.size();
+}
+
+QRCodeResult QRCodeScanner::getResult(uint16_t index) {
+    if (index >= qr_result_vector.size()) {
+        return QRCodeResult();
+    }
+    return qr_result_vector[index];
+}
+
+std::vector<QRCodeResult> QRCodeScanner::getResult(void) {
+    return qr_result_vector;
+}
+
+uint32_t QRCodeScanner::getScanCount(void) {
+    qrcode_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        QRCodeGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.scanned;
+}
+
+uint32_t QRCodeScanner::getScanTime(void) {
+    qrcode_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        QRCodeGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.last_scan_ms;
+}
+
+void QRCodeScanner::printInfo(void) {
+    qrcode_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        QRCodeGetStats(_p_mmf_context->priv, &stats);
+    }
+    printf("\r\n------------------------------------------\r\n");
+    printf("QR Code Scanner Info:\r\n");
+    printf("Resolution: %d x %d\r\n", _params.width, _params.height);
+    printf("Region of interest: (%d, %d) - (%d, %d)\r\n", _params.roi_xmin, _params.roi_ymin, _params.roi_xmax, _params.roi_ymax);
+    printf("Frame skip: %d\r\n", _params.frame_skip);
+    printf("Motion trigger: %s\r\n", _params.trigger_mode ? "enabled" : "disabled");
+    printf("Frames scanned: %lu / %lu\r\n", stats.scanned, stats.frames);
+    printf("Codes decoded: %lu\r\n", stats.decoded);
+    printf("Scan time: %lu ms (max %lu ms)\r\n", stats.last_scan_ms, stats.max_scan_ms);
+    printf("------------------------------------------\r\n");
+}
+
+void QRCodeScanner::QRResultCallback(qrcode_result_t *result, int count) {
+    if ((result == NULL) || (qr_width == 0) || (qr_height == 0)) {
+        return;
+    }
+    qr_result_vector.clear();
+    qr_result_vector.resize((size_t)count);
+
+    for (int i = 0; i < count; i++) {
+        QRCodeResult& res = qr_result_vector[i];
+        res._type = result[i].type;
+        res._name = result[i].name ? result[i].name : "";
+        res._data = String();
+        res._data.reserve(result[i].len);
+        for (uint32_t j = 0; j < result[i].len; j++) {
+            res._data += (char)result[i].data[j];
+        }
+        res._quality = result[i].quality;
+        res._point_cnt = result[i].point_cnt;
+        for (int j = 0; j < result[i].point_cnt; j++) {
+            res._x[j] = (float)result[i].x[j] / qr_width;
+            res._y[j] = (float)result[i].y[j] / qr_height;
+        }
+    }
+
+    if (QR_user_CB != NULL) {
+        QR_user_CB(qr_result_vector);
+    }
+}
+
+int QRCodeResult::type(void) {
+    return _type;
+}
+
+const char* QRCodeResult::typeName(void) {
+    return _name;
+}
+
+String QRCodeResult::data(void) {
+    return _data;
+}
+
+uint32_t QRCodeResult::length(void) {
+    return _data.length();
+}
+
+int QRCodeResult::quality(void) {
+    return _quality;
+}
+
+uint8_t QRCodeResult::pointCount(void) {
+    return _point_cnt;
+}
+
+float QRCodeResult::pointX(uint8_t index) {
+    if (index >= _point_cnt) {
+        return 0;
+    }
+    return _x[index];
+}
+
+float QRCodeResult::pointY(uint8_t index) {
+    if (index >= _point_cnt) {
+        return 0;
+    }
+    return _y[index];
+}
+
+float QRCodeResult::xMin(void) {
+    float val = 1.0;
+    for (uint8_t i = 0; i < _point_cnt; i++) {
+        if (_x[i] < val) val = _x[i];
+    }
+    return (_point_cnt ? val : 0);
+}
+
+float QRCodeResult::xMax(void) {
+    float val = 0.0;
+    for (uint8_t i = 0; i < _point_cnt; i++) {
+        if (_x[i] > val) val = _x[i];
+    }
+    return val;
+}
+
+float QRCodeResult::yMin(void) {
+    float val = 1.0;
+    for (uint8_t i = 0; i < _point_cnt; i++) {
+        if (_y[i] < val) val = _y[i];
+    }
+    return (_point_cnt ? val : 0);
+}
+
+float QRCodeResult::yMax(void) {
+    float val = 0.0;
+    for (uint8_t i = 0; i < _point_cnt; i++) {
+        if (_y[i] > val) val = _y[i];
+    }
+    return val;
+}
@@ -0,0 +1,83 @@
+#ifndef __QRCODESCANNER_H__
+#define __QRCODESCANNER_H__
+
+#include "VideoStream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "qrcode_drv.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#undef min
+#undef max
+#include <vector>
+
+class QRCodeResult {
+    friend class QRCodeScanner;
+
+    public:
+        int type(void);
+        const char* typeName(void);
+        String data(void);
+        uint32_t length(void);
+        int quality(void);
+
+        uint8_t pointCount(void);
+        float pointX(uint8_t index);
+        float pointY(uint8_t index);
+        float xMin(void);
+        float xMax(void);
+        float yMin(void);
+        float yMax(void);
+
+    private:
+        int _type = 0;
+        const char* _name = "";
+        String _data;
+        int _quality = 0;
+        uint8_t _point_cnt = 0;
+        float _x[QRCODE_MAX_POINTS] = {0};
+        float _y[QRCODE_MAX_POINTS] = {0};
+};
+
+class QRCodeScanner:public MMFModule {
+    public:
+        QRCodeScanner(void);
+        ~QRCodeScanner(void);
+
+        void configVideo(VideoSetting& config);
+        void configRegionOfInterest(float xmin, float xmax, float ymin, float ymax);
+        void setFrameSkip(uint8_t skip);
+        void setQRCodeOnly(bool enable);
+        void setMotionTrigger(bool enable);
+        void triggerScan(uint32_t window_ms = 2000);
+        void begin(void);
+        void end(void);
+
+        void setResultCallback(void (*qr_callback)(std::vector<QRCodeResult>));
+        uint16_t getResultCount(void);
+        QRCodeResult getResult(uint16_t index);
+        std::vector<QRCodeResult> getResult(void);
+
+        uint32_t getScanCount(void);
+        uint32_t getScanTime(void);
+        void printInfo(void);
+
+    private:
+        static void QRResultCallback(qrcode_result_t *result, int count);
+
+        static std::vector<QRCodeResult> qr_result_vector;
+        static void (*QR_user_CB)(std::vector<QRCodeResult>);
+        static uint16_t qr_width;
+        static uint16_t qr_height;
+
+        float _roi[4] = {0.0, 1.0, 0.0, 1.0};
+        qrcode_params_t _params = {0};
+};
+
+#endif
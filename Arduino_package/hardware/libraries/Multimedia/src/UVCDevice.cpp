@@ -0,0 +1,148 @@
+#include <Arduino.h>
+#include "UVCDevice.h"
+
+void (*UVCDevice::UVC_user_CB)(uint8_t, uint16_t, uint16_t, uint16_t);
+
+UVCDevice::UVCDevice(void) {
+}
+
+UVCDevice::~UVCDevice(void) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    end();
+    if (UVCDDeinit(_p_mmf_context) == NULL) {
+        _p_mmf_context = NULL;
+    } else {
+        printf("\r\n[ERROR] UVC device deinit failed\n");
+    }
+}
+
+void UVCDevice::configVideo(VideoSetting& config) {
+    if (config._encoder == VIDEO_H264) {
+        _params.format = UVCD_FORMAT_H264;
+    } else if (config._encoder == VIDEO_JPEG) {
+        _params.format = UVCD_FORMAT_MJPEG;
+    } else if (config._encoder == VIDEO_NV12) {
+        _params.format = UVCD_FORMAT_NV12;
+    } else {
+        printf("\r\n[ERROR] UVC device only supports H264, MJPEG and NV12 format.\n");
+        return;
+    }
+    // UVCDInit if not previously done so
+    if (_p_mmf_context == NULL) {
+        _p_mmf_context = UVCDInit();
+    }
+    if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] UVC device init failed\n");
+        return;
+    }
+
+    _params.width = config._w;
+    _params.height = config._h;
+    _params.fps = config._fps;
+}
+
+void UVCDevice::begin(void) {
+    if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] Need UVC device init first\n");
+        return;
+    }
+    UVCDSetParams(_p_mmf_context->priv, &_params);
+    UVCDSetChangeCallback(_p_mmf_context->priv, UVCChangeCallback);
+    if (UVCDStart(_p_mmf_context->priv) < 0) {
+        printf("\r\n[ERROR] UVC device start failed\n");
+    }
+}
+
+void UVCDevice::end(void) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    UVCDStop(_p_mmf_context->priv);
+}
+
+void UVCDevice::setFormatChangeCallback(void (*uvc_callback)(uint8_t encoder, uint16_t width, uint16_t height, uint16_t fps)) {
+    UVC_user_CB = uvc_callback;
+}
+
+bool UVCDevice::isStreaming(void) {
+    if (_p_mmf_context == NULL) {
+        return false;
+    }
+    return (UVCDGetStatus(_p_mmf_context->priv) != 0);
+}
+
+uint8_t UVCDevice::hostEncoder(void) {
+    uvcd_params_t host = {0};
+    if (_p_mmf_context != NULL) {
+        UVCDGetHostParams(_p_mmf_context->priv, &host);
+    }
+    return formatToEncoder(host.format ? host.format : _params.format);
+}
+
+uint16_t UVCDevice::hostWidth(void) {
+    uvcd_params_t host = {0};
+    if (_p_mmf_context != NULL) {
+        UVCDGetHostParams(_p_mmf_context->priv, &host);
+    }
+    return (host.format ? host.width : _params.width);
+}
+
+uint16_t UVCDevice::hostHeight(void) {
+    uvcd_params_t host = {0};
+    if (_p_mmf_context != NULL) {
+        UVCDGetHostParams(_p_mmf_context->priv, &host);
+    }
+    return (host.format ? host.height : _params.height);
+}
+
+uint16_t UVCDevice::hostFPS(void) {
+    uvcd_params_t host = {0};
+    if (_p_mmf_context != NULL) {
+        UVCDGetHostParams(_p_mmf_context->priv, &host);
+    }
+    return (host.format ? host.fps : _params.fps);
+}
+
+uint32_t UVCDevice::getFrameCount(void) {
+    uvcd_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        UVCDGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.frames;
+}
+
+uint32_t UVCDevice::getDroppedCount(void) {
+    uvcd_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        UVCDGetStats(_p_mmf_context->priv, &stats);
+    }
+    return (stats.dropped + stats.mismatched);
+}
+
+void UVCDevice::printInfo(void) {
+    uvcd_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        UVCDGetStats(_p_mmf_context->priv, &stats);
+    }
+    printf("\r\n[INFO] UVC %s %dx%d@%d, frames %lu, dropped %lu, mismatched %lu, late %lu\n", isStreaming() ? "streaming" : "idle",
+           hostWidth(), hostHeight(), hostFPS(), stats.frames, stats.dropped, stats.mismatched, stats.late);
+    printf("[INFO] UVC transfer wait %lu us on average, %lu us at most\n", stats.wait_avg_us, stats.wait_max_us);
+}
+
+void UVCDevice::UVCChangeCallback(uvcd_params_t *host) {
+    if ((host == NULL) || (UVC_user_CB == NULL)) {
+        return;
+    }
+    UVC_user_CB(formatToEncoder(host->format), host->width, host->height, host->fps);
+}
+
+uint8_t UVCDevice::formatToEncoder(int format) {
+    if (format == UVCD_FORMAT_MJPEG) {
+        return VIDEO_JPEG;
+    } else if (format == UVCD_FORMAT_NV12) {
+        return VIDEO_NV12;
+    }
+    return VIDEO_H264;
+}
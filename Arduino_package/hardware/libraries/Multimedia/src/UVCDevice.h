@@ -0,0 +1,49 @@
+#ifndef __UVCDEVICE_H__
+#define __UVCDEVICE_H__
+
+#include "VideoStream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "uvcd_drv.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+class UVCDevice:public MMFModule {
+    public:
+        UVCDevice(void);
+        ~UVCDevice(void);
+
+        void configVideo(VideoSetting& config);
+        void begin(void);
+        void end(void);
+
+        void setFormatChangeCallback(void (*uvc_callback)(uint8_t encoder, uint16_t width, uint16_t height, uint16_t fps));
+        bool isStreaming(void);
+        uint8_t hostEncoder(void);
+        uint16_t hostWidth(void);
+        uint16_t hostHeight(void);
+        uint16_t hostFPS(void);
+
+        uint32_t getFrameCount(void);
+        uint32_t getDroppedCount(void);
+        void printInfo(void);
+
+    private:
+        static void UVCChangeCallback(uvcd_params_t *host);
+        static uint8_t formatToEncoder(int format);
+        static void (*UVC_user_CB)(uint8_t, uint16_t, uint16_t, uint16_t);
+
+        uvcd_params_t _params = {
+            .format = UVCD_FORMAT_H264,
+            .width = 1920,
+            .height = 1080,
+            .fps = 30,
+        };
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include <Arduino.h>
+#include "VideoFastStart.h"
+
+#define FASTSTART_IDLE      0
+#define FASTSTART_STARTING  1
+#define FASTSTART_RUNNING   2
+#define FASTSTART_FAILED    3
+
+VideoFastStart::VideoFastStart(void) {
+}
+
+VideoFastStart::~VideoFastStart(void) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    end();
+    if (VideoPrebufDeinit(_p_mmf_context) == NULL) {
+        _p_mmf_context = NULL;
+    } else {
+        printf("\r\n[ERROR] VideoFastStart deinit failed\n");
+    }
+}
+
+void VideoFastStart::configVideo(VideoSetting& config) {
+    if ((config._encoder != VIDEO_H264) && (config._encoder != VIDEO_HEVC) && (config._encoder != VIDEO_JPEG)) {
+        printf("\r\n[ERROR] VideoFastStart only supports H264, HEVC and JPEG format.\n");
+        return;
+    }
+    // VideoPrebufInit if not previously done so
+    if (_p_mmf_context == NULL) {
+        _p_mmf_context = VideoPrebufInit();
+    }
+    if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] VideoFastStart init failed\n");
+        return;
+    }
+}
+
+void VideoFastStart::setBufferSize(uint32_t bytes, uint16_t frames) {
+    if (frames > VIDEO_PREBUF_MAX_FRAMES) {
+        printf("\r\n[WARN] VideoFastStart buffers up to %d frames\n", VIDEO_PREBUF_MAX_FRAMES);
+        frames = VIDEO_PREBUF_MAX_FRAMES;
+    }
+    _params.buffer_bytes = bytes;
+    _params.buffer_frames = frames;
+}
+
+void VideoFastStart::startThread(const void *argument) {
+    VideoFastStart* self = (VideoFastStart*)argument;
+
+    Camera.videoInit();
+    bootMark("video_init");
+    self->_link->registerInput(Camera.getStream(self->_channel));
+    self->_link->registerOutput(*self);
+    if (self->_link->begin() != 0) {
+        printf("\r\n[ERROR] VideoFastStart StreamIO link start failed\n");
+        self->_state = FASTSTART_FAILED;
+    } else {
+        Camera.channelBegin(self->_channel);
+        bootMark("video_start");
+        self->_state = FASTSTART_RUNNING;
+    }
+    self->_thread = 0;
+    os_thread_terminate_arduino(os_thread_get_id_arduino());
+}
+
+void VideoFastStart::begin(int channel) {
+    if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] Need VideoFastStart init first\n");
+        return;
+    }
+    if (_state != FASTSTART_IDLE) {
+        return;
+    }
+    VideoPrebufSetParams(_p_mmf_context->priv, &_params);
+    if (VideoPrebufSetApply(_p_mmf_context->priv) != 0) {
+        return;
+    }
+    _channel = channel;
+    _link = new StreamIO(1, 1);
+    _state = FASTSTART_STARTING;
+    // above the main task, the camera start is what the sketch is waiting for
+    _thread = os_thread_create_arduino(startThread, this, OS_PRIORITY_ABOVENORMAL, 4096);
+    if (_thread == 0) {
+        printf("\r\n[ERROR] %s VideoFastStart start thread create failed\n", __FUNCTION__);
+        delete _link;
+        _link = NULL;
+        _state = FASTSTART_IDLE;
+    }
+}
+
+bool VideoFastStart::waitVideo(uint32_t timeout) {
+    uint32_t start = millis();
+
+    while (_state == FASTSTART_STARTING) {
+        if ((millis() - start) >= timeout) {
+            return false;
+        }
+        delay(1);
+    }
+    return (_state == FASTSTART_RUNNING);
+}
+
+void VideoFastStart::registerOutput(const MMFModule& module) {
+    if ((_p_mmf_context == NULL) || (module._p_mmf_context == NULL)) {
+        printf("\r\n[ERROR] VideoFastStart output not initialized\n");
+        return;
+    }
+    VideoPrebufAddOutput(_p_mmf_context->priv, module._p_mmf_context);
+}
+
+void VideoFastStart::release(void) {
+    if (_p_mmf_context == NULL) {
+        return;
+    }
+    VideoPrebufRelease(_p_mmf_context->priv);
+}
+
+void VideoFastStart::end(void) {
+    // let a camera start in progress finish before taking the link down
+    waitVideo(0xFFFFFFFF);
+    if (_state == FASTSTART_RUNNING) {
+        Camera.channelEnd(_channel);
+        _link->end();
+    }
+    if (_link != NULL) {
+        delete _link;
+        _link = NULL;
+    }
+    _state = FASTSTART_IDLE;
+}
+
+uint32_t VideoFastStart::getBufferedCount(void) {
+    video_prebuf_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        VideoPrebufGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.buffered;
+}
+
+uint32_t VideoFastStart::getReplayedCount(void) {
+    video_prebuf_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        VideoPrebufGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.replayed;
+}
+
+uint32_t VideoFastStart::getDroppedCount(void) {
+    video_prebuf_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        VideoPrebufGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.dropped;
+}
+
+uint32_t VideoFastStart::getFirstFrameTime(void) {
+    video_prebuf_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        VideoPrebufGetStats(_p_mmf_context->priv, &stats);
+    }
+    return stats.first_frame_us;
+}
+
+void VideoFastStart::printInfo(void) {
+    video_prebuf_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        VideoPrebufGetStats(_p_mmf_context->priv, &stats);
+    }
+    printf("\r\n------------------------------------------\r\n");
+    printf("Video Fast Start Info:\r\n");
+    printf("Frames: %lu, buffered: %lu, replayed: %lu, forwarded: %lu, dropped: %lu\r\n", stats.frames, stats.buffered, stats.replayed, stats.forwarded, stats.dropped);
+    printf("Buffer peak: %lu of %lu bytes\r\n", stats.buffer_peak, _params.buffer_bytes);
+    printf("First frame at %lu ms, released at %lu ms, replay took %lu ms\r\n", (stats.first_frame_us / 1000), (stats.release_us / 1000), (stats.replay_us / 1000));
+    printf("------------------------------------------\r\n");
+}
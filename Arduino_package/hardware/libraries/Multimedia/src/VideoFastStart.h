@@ -0,0 +1,59 @@
+#ifndef __VIDEOFASTSTART_H__
+#define __VIDEOFASTSTART_H__
+
+#include "VideoStream.h"
+#include "StreamIO.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "video_prebuf_drv.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+// Starts the camera from a background task so sensor, ISP and encoder come up while setup()
+// connects WiFi and loads NN models, and holds the frames encoded in the meantime. Once the
+// outputs are ready, release() hands them the held frames in order with their original
+// timestamps, then every new frame, so a recording starts at wake rather than when setup()
+// gets round to the camera. When the buffer fills the earliest frames are kept.
+class VideoFastStart:public MMFModule {
+    public:
+        VideoFastStart(void);
+        ~VideoFastStart(void);
+
+        void configVideo(VideoSetting& config);
+        void setBufferSize(uint32_t bytes, uint16_t frames = 90);
+        // Configure every channel with Camera.configVideoChannel() first, this calls
+        // Camera.videoInit() and Camera.channelBegin(channel) and returns at once
+        void begin(int channel = 0);
+        // Wait until the channel runs, other channels can be started after this
+        bool waitVideo(uint32_t timeout = 5000);
+        // Up to 4 sinks, such as RTSP or MP4Recording, that receive the channel instead of a StreamIO
+        void registerOutput(const MMFModule& module);
+        void release(void);
+        void end(void);
+
+        uint32_t getBufferedCount(void);
+        uint32_t getReplayedCount(void);
+        uint32_t getDroppedCount(void);
+        // us since reset, 0 until the first frame
+        uint32_t getFirstFrameTime(void);
+        void printInfo(void);
+
+    private:
+        static void startThread(const void *argument);
+
+        video_prebuf_params_t _params = {
+            .buffer_bytes = 2 * 1024 * 1024,
+            .buffer_frames = 90,
+        };
+        StreamIO* _link = NULL;
+        int _channel = 0;
+        uint32_t _thread = 0;
+        volatile uint8_t _state = 0;
+};
+
+#endif
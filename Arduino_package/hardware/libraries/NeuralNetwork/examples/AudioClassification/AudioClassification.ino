@@ -22,6 +22,16 @@ void setup() {
 
     audioNN.configAudio(configA);
     audioNN.setResultCallback(ACPostProcess);
+    // Classify 975 ms windows with 50% overlap, only while there is sound above the background
+    audioNN.setWindow(975, 50);
+    audioNN.setGate(AUDIO_GATE_VAD, -60, 10);   // Mode, minimum level (dBFS), margin above noise floor (dB)
+    audioNN.setHangover(1000);                  // Keep classifying 1 s after the sound stops
+    audioNN.setMaxSkip(10000);                  // Classify at least once every 10 s regardless
+    // Report a sound once its smoothed score stays above 50 for 2 windows, and its end once below 30 for 2 windows
+    audioNN.setSmoothing(0.5);
+    audioNN.setEventThreshold(50, 30);
+    audioNN.setEventDebounce(2, 2);
+    audioNN.setEventCallback(ACEvent);
     audioNN.modelSelect(AUDIO_CLASSIFICATION, NA_MODEL, NA_MODEL, NA_MODEL, DEFAULT_YAMNET);
     audioNN.begin();
 
@@ -34,7 +44,8 @@ void setup() {
 }
 
 void loop() {
-  // Do nothing
+    audioNN.printInfo();
+    delay(10000);
 }
 
 // User callback function
@@ -52,3 +63,16 @@ void ACPostProcess(std::vector<AudioClassificationResult> results) {
         }
     }
 }
+
+// User callback function for debounced sound events
+void ACEvent(AudioClassificationEvent event) {
+    int class_id = event.classID();
+    if (!audioNames[class_id].filter) {
+        return;
+    }
+    if (event.active()) {
+        printf("Started: %s, score: %d\r\n", audioNames[class_id].audioName, event.score());
+    } else {
+        printf("Ended: %s, after %lu ms\r\n", audioNames[class_id].audioName, event.duration());
+    }
+}
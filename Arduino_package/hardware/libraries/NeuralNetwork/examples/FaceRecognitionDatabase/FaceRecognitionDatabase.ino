@@ -0,0 +1,89 @@
+/*
+
+ Face recognition with registered faces kept in a flash database.
+ Each registration is saved immediately as its own record, so large
+ numbers of people can be enrolled without rewriting the whole set.
+
+ Face registration commands
+ --------------------------
+ Point the camera at a target face and enter the following commands into the serial monitor,
+ Register face:                       "REG={Name}"  Ensure that there is only one face detected in frame
+ Remove face:                         "DEL={Name}"  Remove all registered embeddings of a face
+ Reset registered faces:              "RESET"       Forget all previously registered faces
+ Print database information:          "INFO"
+
+*/
+
+#include "StreamIO.h"
+#include "VideoStream.h"
+#include "NNFaceDetectionRecognition.h"
+#include "FaceDatabase.h"
+
+#define CHANNELNN   3
+
+// Customised resolution for NN
+#define NNWIDTH     576
+#define NNHEIGHT    320
+
+VideoSetting configNN(NNWIDTH, NNHEIGHT, 10, VIDEO_RGB, 0);
+NNFaceDetectionRecognition facerecog;
+FaceDatabase faceDB;
+StreamIO videoStreamerRGBFD(1, 1);
+
+void setup() {
+    Serial.begin(115200);
+
+    Camera.configVideoChannel(CHANNELNN, configNN);
+    Camera.videoInit();
+
+    // Open the face database, embeddings are loaded from flash on first use
+    faceDB.begin();
+    faceDB.setThreshold(50);
+
+    // Configure Face Recognition model to match against the face database
+    facerecog.configVideo(configNN);
+    facerecog.modelSelect(FACE_RECOGNITION, NA_MODEL, DEFAULT_SCRFD, DEFAULT_MOBILEFACENET);
+    facerecog.useFaceDatabase(faceDB);
+    facerecog.begin();
+    facerecog.setResultCallback(FRPostProcess);
+
+    // Configure StreamIO object to stream data from RGB video channel to face detection
+    videoStreamerRGBFD.registerInput(Camera.getStream(CHANNELNN));
+    videoStreamerRGBFD.setStackSize();
+    videoStreamerRGBFD.setTaskPriority();
+    videoStreamerRGBFD.registerOutput(facerecog);
+    if (videoStreamerRGBFD.begin() != 0) {
+        Serial.println("StreamIO link start failed");
+    }
+
+    // Start video channel for NN
+    Camera.channelBegin(CHANNELNN);
+}
+
+void loop() {
+    if (Serial.available() > 0) {
+        String input = Serial.readString();
+        input.trim();
+
+        if (input.startsWith(String("REG="))) {
+            String name = input.substring(4);
+            facerecog.registerFace(name);
+        } else if (input.startsWith(String("DEL="))) {
+            String name = input.substring(4);
+            facerecog.removeFace(name);
+        } else if (input.startsWith(String("RESET"))) {
+            facerecog.resetRegisteredFace();
+        } else if (input.startsWith(String("INFO"))) {
+            faceDB.printInfo();
+        }
+    }
+    delay(100);
+}
+
+// User callback function for post processing of face recognition results
+void FRPostProcess(std::vector<FaceRecognitionResult> results) {
+    for (uint32_t i = 0; i < results.size(); i++) {
+        FaceRecognitionResult item = results[i];
+        printf("Face %d name %s:\t%.2f %.2f %.2f %.2f\n\r", i, item.name(), item.xMin(), item.xMax(), item.yMin(), item.yMax());
+    }
+}
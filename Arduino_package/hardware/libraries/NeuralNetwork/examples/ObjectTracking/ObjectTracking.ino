@@ -0,0 +1,90 @@
+/*
+ This sketch follows objects found by object detection from frame to frame,
+ giving each one a stable track ID, and counts the people that walk past.
+
+ Every detection is matched to the predicted position of a track, so an object
+ keeps its ID while it moves and through a few frames of missed detections.
+ Set LOG_DETECTIONS to 1 to print the raw detections as CSV lines, which can be
+ saved to an SD card and replayed with the TrackerReplay example to tune the
+ tracker settings.
+
+ Example guide:
+ https://www.amebaiot.com/en/amebapro2-arduino-neuralnework-object-detection/
+ */
+
+#include "StreamIO.h"
+#include "VideoStream.h"
+#include "NNObjectDetection.h"
+#include "ObjectTracker.h"
+#include "ObjectClassList.h"
+
+#define CHANNELNN 3
+
+// Lower resolution for NN processing
+#define NNWIDTH 576
+#define NNHEIGHT 320
+
+#define LOG_DETECTIONS 0
+#define PERSON 0
+
+VideoSetting configNN(NNWIDTH, NNHEIGHT, 10, VIDEO_RGB, 0);
+NNObjectDetection ObjDet;
+ObjectTracker tracker;
+StreamIO videoStreamerNN(1, 1);
+
+void setup() {
+    Serial.begin(115200);
+
+    Camera.configVideoChannel(CHANNELNN, configNN);
+    Camera.videoInit();
+
+    // A track is confirmed after 3 matched frames in a row and dropped after 10 frames unseen
+    tracker.setLifetime(3, 10);
+    tracker.setAssociation(0.3, 0.5);   // Minimum box overlap, fallback centre distance in box diagonals
+
+    ObjDet.configVideo(configNN);
+    ObjDet.setResultCallback(ODPostProcess);
+    ObjDet.modelSelect(OBJECT_DETECTION, DEFAULT_YOLOV4TINY, NA_MODEL, NA_MODEL);
+    ObjDet.useTracker(tracker);
+    ObjDet.begin();
+
+    videoStreamerNN.registerInput(Camera.getStream(CHANNELNN));
+    videoStreamerNN.setStackSize();
+    videoStreamerNN.setTaskPriority();
+    videoStreamerNN.registerOutput(ObjDet);
+    if (videoStreamerNN.begin() != 0) {
+        Serial.println("StreamIO link start failed");
+    }
+
+    Camera.channelBegin(CHANNELNN);
+}
+
+void loop() {
+    std::vector<TrackedObject> tracks = tracker.getResult();
+    uint16_t people = 0;
+
+    for (uint32_t i = 0; i < tracks.size(); i++) {
+        if ((tracks[i].type() == PERSON) && (tracks[i].missed() == 0)) {
+            people++;
+        }
+    }
+    printf("People in view: %d, objects counted since start: %lu\r\n", people, tracker.totalCount());
+    delay(2000);
+}
+
+// User callback function for post processing of object detection results
+void ODPostProcess(std::vector<ObjectDetectionResult> results) {
+    if (LOG_DETECTIONS) {
+        // One frame line then one line per detection, other lines are ignored by TrackerReplay
+        printf("F,%lu,%d\r\n", millis(), results.size());
+    }
+    for (uint32_t i = 0; i < results.size(); i++) {
+        ObjectDetectionResult item = results[i];
+        int obj_type = item.type();
+        if (LOG_DETECTIONS) {
+            printf("D,%d,%d,%.4f,%.4f,%.4f,%.4f\r\n", obj_type, item.score(), item.xMin(), item.yMin(), item.xMax(), item.yMax());
+        } else if (itemList[obj_type].filter && (item.trackID() != 0)) {
+            printf("Track %lu %s:\t%.2f %.2f %.2f %.2f\r\n", item.trackID(), itemList[obj_type].objectName, item.xMin(), item.yMin(), item.xMax(), item.yMax());
+        }
+    }
+}
@@ -49,6 +49,7 @@
 VideoSetting config(VIDEO_FHD, 30, VIDEO_H264, 0);
 VideoSetting configNN(NNWIDTH, NNHEIGHT, 10, VIDEO_RGB, 0);
 NNFaceDetectionRecognition facerecog;
+ObjectTracker faceTracker;              // Keeps a face's identity across frames, so MobileFaceNet only runs for new faces
 RTSP rtsp;
 StreamIO videoStreamer(1, 1);
 StreamIO videoStreamerFDFR(1, 1);
@@ -92,6 +93,7 @@ void setup() {
     // Select Neural Network(NN) task and models
     facerecog.configVideo(configNN);
     facerecog.modelSelect(FACE_RECOGNITION, NA_MODEL, DEFAULT_SCRFD, DEFAULT_MOBILEFACENET);
+    facerecog.useTracker(faceTracker);
     facerecog.begin();
     facerecog.setResultCallback(FRPostProcess);
 
@@ -179,7 +181,7 @@ void FRPostProcess(std::vector<FaceRecognitionResult> results) {
             }
 
             // Draw boundary box
-            printf("Face %d name %s:\t%d %d %d %d\n\r", i, item.name(), xmin, xmax, ymin, ymax);
+            printf("Face %d track %lu name %s:\t%d %d %d %d\n\r", i, item.trackID(), item.name(), xmin, xmax, ymin, ymax);
             OSD.drawRect(CHANNEL, xmin, ymin, xmax, ymax, 3, osd_color);
 
             // Print identification text above boundary box
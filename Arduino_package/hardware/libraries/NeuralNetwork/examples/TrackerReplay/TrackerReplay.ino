@@ -0,0 +1,99 @@
+/*
+ This sketch replays detections recorded by the ObjectTracking example through
+ the object tracker and reports how long tracking takes per frame, how many
+ tracks were started and confirmed, and how many recognition model runs the
+ track cache saves compared to recognizing every detection.
+
+ Save the serial output of ObjectTracking with LOG_DETECTIONS set to 1 as
+ detections.csv on the SD card. Lines that do not start with "F," or "D," are
+ skipped, so the log can be saved unedited. Change the tracker settings below
+ and run again to compare them on the same recording. The same log can also be
+ replayed on a PC with tests/host/tracker_replay, which reports ID switches too.
+ */
+
+#include "AmebaFatFS.h"
+#include "ObjectTracker.h"
+
+char filename[] = "detections.csv";
+
+AmebaFatFS fs;
+ObjectTracker tracker;
+
+void setup() {
+    char path[128];
+    char line[96];
+    uint32_t frames = 0;
+    uint32_t frame_ms = 0;
+    int expected = 0;
+    uint32_t total_us = 0;
+    uint32_t max_us = 0;
+
+    Serial.begin(115200);
+
+    tracker.setLifetime(3, 10);
+    tracker.setAssociation(0.3, 0.5);
+    tracker.setRecognition(0.6, 3, 90);
+
+    fs.begin();
+    sprintf(path, "%s%s", fs.getRootPath(), filename);
+    File file = fs.open(path);
+    if (!file) {
+        printf("Cannot open \"%s\"\r\n", filename);
+        fs.end();
+        return;
+    }
+
+    while (file.available()) {
+        size_t len = file.readBytesUntil('\n', line, sizeof(line) - 1);
+        line[len] = '\0';
+        if (strncmp(line, "D,", 2) == 0) {
+            int type, score;
+            float xmin, ymin, xmax, ymax;
+            if ((expected > 0) && (sscanf(&line[2], "%d,%d,%f,%f,%f,%f", &type, &score, &xmin, &ymin, &xmax, &ymax) == 6)) {
+                tracker.addDetection(xmin, ymin, xmax, ymax, (score / 100.0), type);
+                expected--;
+            }
+            continue;
+        }
+        if (strncmp(line, "F,", 2) != 0) {
+            continue;
+        }
+        // a new frame line completes the previous frame
+        if (frames > 0) {
+            uint32_t start = micros();
+            tracker.update(frame_ms);
+            uint32_t elapsed = micros() - start;
+            total_us += elapsed;
+            if (elapsed > max_us) {
+                max_us = elapsed;
+            }
+            simulateRecognition();
+        }
+        sscanf(&line[2], "%lu,%d", &frame_ms, &expected);
+        frames++;
+    }
+    if (frames > 0) {
+        tracker.update(frame_ms);
+        simulateRecognition();
+    }
+    file.close();
+    fs.end();
+
+    printf("Replayed %lu frames, tracker update %lu us on average, %lu us at most\r\n", frames, (frames > 0) ? (total_us / frames) : 0, max_us);
+    printf("Recognition runs with tracking: %lu, without: %lu\r\n", tracker.recognitionCount(), tracker.detectionCount());
+    tracker.printInfo();
+}
+
+void loop() {
+    delay(1000);
+}
+
+// Answer every recognition request at once, as if the model always knew the object
+void simulateRecognition(void) {
+    for (int i = 0; i < OBJECT_TRACKER_MAX_DETECTIONS; i++) {
+        uint32_t id = tracker.trackID(i);
+        if ((id != 0) && tracker.needsRecognition(i)) {
+            tracker.setIdentity(id, "known", 1.0);
+        }
+    }
+}
@@ -0,0 +1,480 @@
+#include <Arduino.h>
+#include <math.h>
+#include "FaceDatabase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "kv.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#if defined(__ARM_FEATURE_SIMD32) && (__ARM_FEATURE_SIMD32 == 1)
+#include <arm_acle.h>
+#endif
+
+#define FRDB_MAGIC              0x42445246      // "FRDB"
+#define FRDB_VERSION            1
+#define FRDB_META_INTERVAL      16              // appends between meta record updates
+#define FRDB_COMPACT_MIN        16              // removed records tolerated before compacting
+#define FRDB_KEY_LEN            32
+
+typedef struct frdb_meta_s {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t dim;
+    uint32_t next_seq;
+    uint32_t crc;
+} frdb_meta_t;
+
+typedef struct frdb_record_s {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t dim;
+    char name[FRDB_NAME_LEN];
+    int8_t feature[FRDB_FEATURE_DIM];
+    uint32_t crc;
+} frdb_record_t;
+
+static uint32_t frdb_checksum(const void* data, uint32_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t hash = 2166136261UL;
+    for (uint32_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+static void frdb_fill_record(frdb_record_t* record, const frdb_entry_t* entry) {
+    memset(record, 0, sizeof(frdb_record_t));
+    record->magic = FRDB_MAGIC;
+    record->version = FRDB_VERSION;
+    record->dim = FRDB_FEATURE_DIM;
+    memcpy(record->name, entry->name, FRDB_NAME_LEN);
+    memcpy(record->feature, entry->feature, FRDB_FEATURE_DIM);
+    record->crc = frdb_checksum(record, offsetof(frdb_record_t, crc));
+}
+
+FaceDatabase::FaceDatabase(const char* prefix) {
+    strncpy(_prefix, prefix, sizeof(_prefix) - 1);
+    _prefix[sizeof(_prefix) - 1] = '\0';
+}
+
+FaceDatabase::~FaceDatabase(void) {
+    end();
+}
+
+bool FaceDatabase::begin(void) {
+    if (_started) {
+        return true;
+    }
+    if (_lock == 0) {
+        _lock = os_semaphore_create_arduino(1);
+    }
+    if (_lock == 0) {
+        printf("\r\n[ERROR] FaceDatabase lock init failed\n");
+        return false;
+    }
+    rt_kv_init();
+    // Only the meta record is read here, embeddings are loaded on first use
+    readMeta();
+    _started = true;
+    return true;
+}
+
+void FaceDatabase::end(void) {
+    if (!_started) {
+        return;
+    }
+    sync();
+    _entries.clear();
+    _entries.shrink_to_fit();
+    _loaded = false;
+    _started = false;
+    if (_lock) {
+        os_semaphore_delete_arduino(_lock);
+        _lock = 0;
+    }
+}
+
+int FaceDatabase::enroll(const char* name, const float* feature) {
+    if ((!_started) || (name == NULL) || (feature == NULL) || (name[0] == '\0')) {
+        return -1;
+    }
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    if (!load()) {
+        os_semaphore_release_arduino(_lock);
+        return -1;
+    }
+
+    frdb_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    strncpy(entry.name, name, FRDB_NAME_LEN - 1);
+    quantize(feature, entry.feature);
+    int32_t norm = dot(entry.feature, entry.feature);
+    entry.scale = (norm > 0) ? (1.0f / sqrtf((float)norm)) : 0.0f;
+    entry.seq = _next_seq;
+
+    frdb_record_t record;
+    frdb_fill_record(&record, &entry);
+
+    char key[FRDB_KEY_LEN];
+    recordKey(entry.seq, key);
+    if (rt_kv_set(key, &record, sizeof(record)) != (int32_t)sizeof(record)) {
+        printf("\r\n[ERROR] FaceDatabase failed to write %s\n", key);
+        os_semaphore_release_arduino(_lock);
+        return -1;
+    }
+    _entries.push_back(entry);
+    _next_seq++;
+    // Records past the meta sequence are found by probing, so the meta record
+    // is rewritten only every few enrollments instead of on every append
+    if ((_next_seq - _meta_seq) >= FRDB_META_INTERVAL) {
+        writeMeta();
+    }
+    int index = _entries.size() - 1;
+    os_semaphore_release_arduino(_lock);
+    return index;
+}
+
+int FaceDatabase::remove(const char* name) {
+    int removed = 0;
+    char key[FRDB_KEY_LEN];
+
+    if ((!_started) || (name == NULL)) {
+        return 0;
+    }
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    if (!load()) {
+        os_semaphore_release_arduino(_lock);
+        return 0;
+    }
+    for (size_t i = 0; i < _entries.size();) {
+        if (strncmp(_entries[i].name, name, FRDB_NAME_LEN) != 0) {
+            i++;
+            continue;
+        }
+        // a hole past the meta sequence would stop the probe in load() early
+        if (_entries[i].seq >= _meta_seq) {
+            writeMeta();
+        }
+        recordKey(_entries[i].seq, key);
+        rt_kv_delete(key);
+        _entries.erase(_entries.begin() + i);
+        _holes++;
+        removed++;
+    }
+    os_semaphore_release_arduino(_lock);
+
+    if (removed) {
+        compact();
+    }
+    return removed;
+}
+
+void FaceDatabase::reset(void) {
+    char key[FRDB_KEY_LEN];
+
+    if (!_started) {
+        return;
+    }
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    load();
+    for (size_t i = 0; i < _entries.size(); i++) {
+        recordKey(_entries[i].seq, key);
+        rt_kv_delete(key);
+    }
+    _entries.clear();
+    _next_seq = 0;
+    _holes = 0;
+    writeMeta();
+    _loaded = true;
+    os_semaphore_release_arduino(_lock);
+}
+
+bool FaceDatabase::reload(void) {
+    if (!_started) {
+        return false;
+    }
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    _entries.clear();
+    _loaded = false;
+    readMeta();
+    bool ret = load();
+    os_semaphore_release_arduino(_lock);
+    return ret;
+}
+
+void FaceDatabase::sync(void) {
+    if (!_started) {
+        return;
+    }
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    if (_loaded && (_meta_seq != _next_seq)) {
+        writeMeta();
+    }
+    os_semaphore_release_arduino(_lock);
+}
+
+// Fill the holes left by removed records with the records at the end of the log.
+// Only records above the new end are rewritten, so flash writes stay proportional
+// to the number of removals rather than the database size.
+void FaceDatabase::compact(bool force) {
+    char key[FRDB_KEY_LEN];
+    frdb_record_t record;
+
+    if (!_started) {
+        return;
+    }
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    if ((!load()) || (_holes == 0)) {
+        os_semaphore_release_arduino(_lock);
+        return;
+    }
+    if ((!force) && ((_holes < FRDB_COMPACT_MIN) || (_holes < (_entries.size() / 4)))) {
+        os_semaphore_release_arduino(_lock);
+        return;
+    }
+
+    uint32_t live = _entries.size();
+    std::vector<uint8_t> used(live, 0);
+    for (size_t i = 0; i < _entries.size(); i++) {
+        if (_entries[i].seq < live) {
+            used[_entries[i].seq] = 1;
+        }
+    }
+    uint32_t hole = 0;
+    for (size_t i = 0; i < _entries.size(); i++) {
+        if (_entries[i].seq < live) {
+            continue;
+        }
+        while ((hole < live) && used[hole]) {
+            hole++;
+        }
+        if (hole >= live) {
+            break;
+        }
+        frdb_fill_record(&record, &_entries[i]);
+        recordKey(hole, key);
+        if (rt_kv_set(key, &record, sizeof(record)) != (int32_t)sizeof(record)) {
+            printf("\r\n[ERROR] FaceDatabase compaction failed at %s\n", key);
+            break;
+        }
+        recordKey(_entries[i].seq, key);
+        rt_kv_delete(key);
+        _entries[i].seq = hole;
+        used[hole] = 1;
+    }
+
+    uint32_t next_seq = 0;
+    for (size_t i = 0; i < _entries.size(); i++) {
+        if (_entries[i].seq >= next_seq) {
+            next_seq = _entries[i].seq + 1;
+        }
+    }
+    _holes = next_seq - _entries.size();
+    _next_seq = next_seq;
+    writeMeta();
+    os_semaphore_release_arduino(_lock);
+}
+
+int FaceDatabase::match(const float* feature, char* name, float* similarity) {
+    int8_t query[FRDB_FEATURE_DIM] __attribute__((aligned(4)));
+    int best = -1;
+    float best_sim = -1.0f;
+
+    if ((!_started) || (feature == NULL)) {
+        return -1;
+    }
+    quantize(feature, query);
+    int32_t norm = dot(query, query);
+    if (norm <= 0) {
+        return -1;
+    }
+    float scale = 1.0f / sqrtf((float)norm);
+
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    if (load()) {
+        for (size_t i = 0; i < _entries.size(); i++) {
+            float sim = (float)dot(query, _entries[i].feature) * scale * _entries[i].scale;
+            if (sim > best_sim) {
+                best_sim = sim;
+                best = i;
+            }
+        }
+    }
+    if (best_sim < ((float)_threshold / 100.0f)) {
+        best = -1;
+    }
+    // copy while locked, the entry may move once a removal compacts the database
+    if (name != NULL) {
+        strncpy(name, (best >= 0) ? _entries[best].name : "unknown", FRDB_NAME_LEN - 1);
+        name[FRDB_NAME_LEN - 1] = '\0';
+    }
+    os_semaphore_release_arduino(_lock);
+
+    if (similarity != NULL) {
+        *similarity = best_sim;
+    }
+    return best;
+}
+
+const char* FaceDatabase::name(int index) {
+    if ((index < 0) || ((size_t)index >= _entries.size())) {
+        return "unknown";
+    }
+    return _entries[index].name;
+}
+
+uint16_t FaceDatabase::count(void) {
+    return _entries.size();
+}
+
+uint16_t FaceDatabase::identityCount(void) {
+    uint16_t identities = 0;
+    for (size_t i = 0; i < _entries.size(); i++) {
+        size_t j = 0;
+        while ((j < i) && (strncmp(_entries[i].name, _entries[j].name, FRDB_NAME_LEN) != 0)) {
+            j++;
+        }
+        if (j == i) {
+            identities++;
+        }
+    }
+    return identities;
+}
+
+void FaceDatabase::setThreshold(uint8_t threshold) {
+    if (threshold > 100) {
+        threshold = 100;
+    }
+    _threshold = threshold;
+}
+
+void FaceDatabase::printInfo(void) {
+    printf("\r\n------------------------------------------\r\n");
+    printf("Face Database Info:\r\n");
+    printf("Prefix: %s\r\n", _prefix);
+    printf("Loaded: %s\r\n", _loaded ? "yes" : "no");
+    printf("Embeddings: %d (%d identities)\r\n", count(), identityCount());
+    printf("Records: %lu, removed: %lu\r\n", _next_seq, _holes);
+    printf("Threshold: %d\r\n", _threshold);
+    printf("------------------------------------------\r\n");
+}
+
+bool FaceDatabase::load(void) {
+    char key[FRDB_KEY_LEN];
+    frdb_record_t record;
+
+    if (_loaded) {
+        return true;
+    }
+    _entries.clear();
+    _holes = 0;
+    // Records below the meta sequence may have holes, past it they are contiguous
+    for (uint32_t seq = 0;; seq++) {
+        recordKey(seq, key);
+        int32_t len = rt_kv_get(key, &record, sizeof(record));
+        bool valid = (len == (int32_t)sizeof(record)) && (record.magic == FRDB_MAGIC) && (record.dim == FRDB_FEATURE_DIM) &&
+                     (record.crc == frdb_checksum(&record, offsetof(frdb_record_t, crc)));
+        if (!valid) {
+            if (seq >= _meta_seq) {
+                _next_seq = seq;
+                break;
+            }
+            _holes++;
+            continue;
+        }
+        frdb_entry_t entry;
+        entry.seq = seq;
+        memcpy(entry.name, record.name, FRDB_NAME_LEN);
+        entry.name[FRDB_NAME_LEN - 1] = '\0';
+        memcpy(entry.feature, record.feature, FRDB_FEATURE_DIM);
+        int32_t norm = dot(entry.feature, entry.feature);
+        entry.scale = (norm > 0) ? (1.0f / sqrtf((float)norm)) : 0.0f;
+        _entries.push_back(entry);
+    }
+    _loaded = true;
+    return true;
+}
+
+bool FaceDatabase::readMeta(void) {
+    char key[FRDB_KEY_LEN];
+    frdb_meta_t meta;
+
+    snprintf(key, sizeof(key), "%s_meta", _prefix);
+    int32_t len = rt_kv_get(key, &meta, sizeof(meta));
+    if ((len != (int32_t)sizeof(meta)) || (meta.magic != FRDB_MAGIC) || (meta.dim != FRDB_FEATURE_DIM) ||
+        (meta.crc != frdb_checksum(&meta, offsetof(frdb_meta_t, crc)))) {
+        _meta_seq = 0;
+        return false;
+    }
+    _meta_seq = meta.next_seq;
+    return true;
+}
+
+bool FaceDatabase::writeMeta(void) {
+    char key[FRDB_KEY_LEN];
+    frdb_meta_t meta;
+
+    memset(&meta, 0, sizeof(meta));
+    meta.magic = FRDB_MAGIC;
+    meta.version = FRDB_VERSION;
+    meta.dim = FRDB_FEATURE_DIM;
+    meta.next_seq = _next_seq;
+    meta.crc = frdb_checksum(&meta, offsetof(frdb_meta_t, crc));
+
+    snprintf(key, sizeof(key), "%s_meta", _prefix);
+    if (rt_kv_set(key, &meta, sizeof(meta)) != (int32_t)sizeof(meta)) {
+        printf("\r\n[ERROR] FaceDatabase failed to write %s\n", key);
+        return false;
+    }
+    _meta_seq = _next_seq;
+    return true;
+}
+
+void FaceDatabase::recordKey(uint32_t seq, char* key) {
+    snprintf(key, FRDB_KEY_LEN, "%s_%lu", _prefix, seq);
+}
+
+// Embeddings are L2 normalized and stored as int8, a quarter of the float size,
+// which keeps cosine similarity within about 1% of the float result
+void FaceDatabase::quantize(const float* feature, int8_t* out) {
+    float sum = 0.0f;
+    for (int i = 0; i < FRDB_FEATURE_DIM; i++) {
+        sum += feature[i] * feature[i];
+    }
+    float scale = (sum > 0.0f) ? (127.0f / sqrtf(sum)) : 0.0f;
+    for (int i = 0; i < FRDB_FEATURE_DIM; i++) {
+        int32_t val = lroundf(feature[i] * scale);
+        if (val > 127) {
+            val = 127;
+        } else if (val < -127) {
+            val = -127;
+        }
+        out[i] = (int8_t)val;
+    }
+}
+
+int32_t FaceDatabase::dot(const int8_t* a, const int8_t* b) {
+    int32_t sum = 0;
+#if defined(__ARM_FEATURE_SIMD32) && (__ARM_FEATURE_SIMD32 == 1)
+    // Four int8 products per pair of SMLAD, same approach as arm_dot_prod_q7
+    const uint32_t* pa = (const uint32_t*)a;
+    const uint32_t* pb = (const uint32_t*)b;
+    for (int i = 0; i < (FRDB_FEATURE_DIM / 4); i++) {
+        uint32_t va = pa[i];
+        uint32_t vb = pb[i];
+        sum = __smlad(__sxtb16(va), __sxtb16(vb), sum);
+        sum = __smlad(__sxtb16(__ror(va, 8)), __sxtb16(__ror(vb, 8)), sum);
+    }
+#else
+    for (int i = 0; i < FRDB_FEATURE_DIM; i++) {
+        sum += (int32_t)a[i] * (int32_t)b[i];
+    }
+#endif
+    return sum;
+}
@@ -0,0 +1,76 @@
+#ifndef __FACE_DATABASE_H__
+#define __FACE_DATABASE_H__
+
+#include <Arduino.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "module_vipnn.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#undef min
+#undef max
+#include <vector>
+
+#define FRDB_NAME_LEN       32
+#define FRDB_FEATURE_DIM    MAX_FACE_FEATURE_DIM
+
+// Quantized face embedding kept in RAM for matching
+typedef struct frdb_entry_s {
+    uint32_t seq;                                   // flash record number
+    float scale;                                    // inverse L2 norm of the quantized embedding
+    char name[FRDB_NAME_LEN];
+    int8_t feature[FRDB_FEATURE_DIM] __attribute__((aligned(4)));
+} frdb_entry_t;
+
+// Face embedding store on the littlefs backed key-value partition.
+// Each enrolled embedding is written as its own record, so adding or removing
+// a face only touches that record instead of rewriting the whole set.
+class FaceDatabase {
+    public:
+        FaceDatabase(const char* prefix = "frdb");
+        ~FaceDatabase(void);
+
+        bool begin(void);
+        void end(void);
+
+        int enroll(const char* name, const float* feature);
+        int remove(const char* name);
+        void reset(void);
+        bool reload(void);
+        void sync(void);
+        void compact(bool force = false);
+
+        int match(const float* feature, char* name = NULL, float* similarity = NULL);
+        const char* name(int index);
+        uint16_t count(void);
+        uint16_t identityCount(void);
+        void setThreshold(uint8_t threshold);
+
+        void printInfo(void);
+
+    private:
+        bool load(void);
+        bool readMeta(void);
+        bool writeMeta(void);
+        void recordKey(uint32_t seq, char* key);
+        static void quantize(const float* feature, int8_t* out);
+        static int32_t dot(const int8_t* a, const int8_t* b);
+
+        char _prefix[16];
+        uint32_t _lock = 0;
+        bool _started = false;
+        bool _loaded = false;
+        uint32_t _next_seq = 0;         // next record number to append
+        uint32_t _meta_seq = 0;         // next_seq last written to the meta record
+        uint32_t _holes = 0;            // removed records below next_seq
+        uint8_t _threshold = 50;
+        std::vector<frdb_entry_t> _entries;
+};
+
+#endif
@@ -23,6 +23,7 @@ extern int vipnn_control(void *p, int cmd, int arg);
 
 void (*NNAudioClassification::AC_user_CB)(std::vector<AudioClassificationResult>);
 std::vector<AudioClassificationResult> NNAudioClassification::audio_result_vector;
+NNAudioClassification *NNAudioClassification::_instance = NULL;
 
 NNAudioClassification::NNAudioClassification(void) {
 }
@@ -36,32 +37,95 @@ void NNAudioClassification::configAudio(AudioSetting& config, uint16_t bitDepth)
     audio_nn_params.aud.channel = config._audioParams.channel;  // channel count
     audio_nn_params.aud.sample_rate = config._audioParams.sample_rate;
     audio_nn_params.codec_type = AV_CODEC_ID_PCM_RAW;
+    _gate_params.sample_rate = config._audioParams.sample_rate;
+    _gate_params.channels = config._audioParams.channel;
 }
 
 void NNAudioClassification::begin(void) {
-    if (_p_mmf_context == NULL) {
-        _p_mmf_context = mm_module_open(&vipnn_module);
+    uint32_t frames;
+
+    // StreamIO feeds the gate, the gate runs YAMNet on the windows it lets through
+    if (_vipnn_ctx == NULL) {
+        _vipnn_ctx = mm_module_open(&vipnn_module);
     }
-    if (_p_mmf_context == NULL) {
+    if (_vipnn_ctx == NULL) {
         printf("\r\n[ERROR] NNAudioClassification init failed\n");
         return;
     }
+    frames = (_window_ms * _gate_params.sample_rate) / 1000;
+    audio_nn_params.aud.num_of_samples = frames;
+    _gate_params.window_samples = frames * _gate_params.channels;
+    _gate_params.hop_samples = (_gate_params.window_samples * (100 - _overlap)) / 100;
+    if (_gate_params.hop_samples == 0) {
+        _gate_params.hop_samples = 1;
+    }
 
-    vipnn_control(_p_mmf_context->priv, CMD_VIPNN_SET_MODEL, (int)&yamnet);
-    vipnn_control(_p_mmf_context->priv, CMD_VIPNN_SET_IN_PARAMS, (int)&audio_nn_params);
-    vipnn_control(_p_mmf_context->priv, CMD_VIPNN_SET_DISPPOST, (int)ACResultCallback);
-    vipnn_control(_p_mmf_context->priv, CMD_VIPNN_APPLY, 0);
-}
+    vipnn_control(_vipnn_ctx->priv, CMD_VIPNN_SET_MODEL, (int)&yamnet);
+    vipnn_control(_vipnn_ctx->priv, CMD_VIPNN_SET_IN_PARAMS, (int)&audio_nn_params);
+    vipnn_control(_vipnn_ctx->priv, CMD_VIPNN_SET_DISPPOST, (int)ACResultCallback);
+    vipnn_control(_vipnn_ctx->priv, CMD_VIPNN_APPLY, 0);
 
-void NNAudioClassification::end(void) {
+    if (_smoothed == NULL) {
+        _smoothed = (float *)malloc(AC_CLASS_COUNT * sizeof(float));
+        _run = (uint8_t *)malloc(AC_CLASS_COUNT);
+        _active = (uint8_t *)malloc(AC_CLASS_COUNT);
+        _onset = (uint32_t *)malloc(AC_CLASS_COUNT * sizeof(uint32_t));
+    }
+    if ((_smoothed == NULL) || (_run == NULL) || (_active == NULL) || (_onset == NULL)) {
+        printf("\r\n[ERROR] NNAudioClassification event state allocation failed\n");
+        end();
+        return;
+    }
+    memset(_smoothed, 0, (AC_CLASS_COUNT * sizeof(float)));
+    memset(_run, 0, AC_CLASS_COUNT);
+    memset(_active, 0, AC_CLASS_COUNT);
+    memset(_onset, 0, (AC_CLASS_COUNT * sizeof(uint32_t)));
+    _position_ms = 0;
+    _instance = this;
+
+    if (_p_mmf_context == NULL) {
+        _p_mmf_context = AudioGateInit();
+    }
     if (_p_mmf_context == NULL) {
+        printf("\r\n[ERROR] NNAudioClassification gate init failed\n");
+        end();
         return;
     }
-    if (mm_module_close(_p_mmf_context) == NULL) {
-        _p_mmf_context = NULL;
-    } else {
-        printf("NNAudioClassification deinit failed\r\n");
+    AudioGateSetParams(_p_mmf_context->priv, &_gate_params);
+    AudioGateSetNext(_p_mmf_context->priv, _vipnn_ctx);
+    AudioGateSetCallback(_p_mmf_context->priv, ACGateCallback, this);
+    if (AudioGateSetApply(_p_mmf_context->priv) != 0) {
+        printf("\r\n[ERROR] NNAudioClassification gate apply failed\n");
+    }
+}
+
+void NNAudioClassification::end(void) {
+    // stop the gate first so nothing reaches YAMNet while it closes
+    if (_p_mmf_context != NULL) {
+        if (AudioGateDeinit(_p_mmf_context) == NULL) {
+            _p_mmf_context = NULL;
+        } else {
+            printf("NNAudioClassification gate deinit failed\r\n");
+        }
+    }
+    if (_vipnn_ctx != NULL) {
+        if (mm_module_close(_vipnn_ctx) == NULL) {
+            _vipnn_ctx = NULL;
+        } else {
+            printf("NNAudioClassification deinit failed\r\n");
+        }
     }
+    if (_instance == this) {
+        _instance = NULL;
+    }
+    free(_smoothed);
+    free(_run);
+    free(_active);
+    free(_onset);
+    _smoothed = NULL;
+    _run = NULL;
+    _active = NULL;
+    _onset = NULL;
 }
 
 void NNAudioClassification::setResultCallback(void (*ac_callback)(std::vector<AudioClassificationResult>)) {
@@ -87,6 +151,142 @@ std::vector<AudioClassificationResult> NNAudioClassification::getResult(void) {
     return audio_result_vector;
 }
 
+void NNAudioClassification::setWindow(uint32_t lengthMs, uint8_t overlapPercent) {
+    // YAMNet looks at 975 ms of audio, a 50 % overlap runs it about twice a second
+    _window_ms = (lengthMs > 0) ? lengthMs : 975;
+    _overlap = (overlapPercent < 100) ? overlapPercent : 99;
+}
+
+void NNAudioClassification::setGate(uint8_t mode, float thresholdDb, float vadMarginDb) {
+    _gate_params.mode = mode;
+    _gate_params.threshold_db = thresholdDb;
+    _gate_params.vad_margin_db = vadMarginDb;
+}
+
+void NNAudioClassification::setHangover(uint32_t ms) {
+    _gate_params.hangover_ms = ms;
+}
+
+void NNAudioClassification::setMaxSkip(uint32_t ms) {
+    _gate_params.max_skip_ms = ms;
+}
+
+void NNAudioClassification::setSmoothing(float weight) {
+    if (weight <= 0.0 || weight > 1.0) {
+        weight = 1.0;
+    }
+    _weight = weight;
+}
+
+void NNAudioClassification::setEventThreshold(uint8_t onScore, uint8_t offScore) {
+    if (offScore > onScore) {
+        offScore = onScore;
+    }
+    _on_score = (float)onScore / 100;
+    _off_score = (float)offScore / 100;
+}
+
+void NNAudioClassification::setEventDebounce(uint8_t onWindows, uint8_t offWindows) {
+    _on_windows = (onWindows > 0) ? onWindows : 1;
+    _off_windows = (offWindows > 0) ? offWindows : 1;
+}
+
+void NNAudioClassification::setEventCallback(void (*event_callback)(AudioClassificationEvent)) {
+    _event_CB = event_callback;
+}
+
+bool NNAudioClassification::isActive(int classID) {
+    if ((_active == NULL) || (classID < 0) || (classID >= AC_CLASS_COUNT)) {
+        return false;
+    }
+    return (_active[classID] != 0);
+}
+
+int NNAudioClassification::smoothedScore(int classID) {
+    if ((_smoothed == NULL) || (classID < 0) || (classID >= AC_CLASS_COUNT)) {
+        return 0;
+    }
+    return ((int)(_smoothed[classID] * 100));
+}
+
+void NNAudioClassification::printInfo(void) {
+    audio_gate_stats_t stats = {0};
+    if (_p_mmf_context != NULL) {
+        AudioGateGetStats(_p_mmf_context->priv, &stats);
+    }
+    printf("\r\n------------------------------------------\r\n");
+    printf("Audio Classification Info:\r\n");
+    printf("Window: %lu ms, %d %% overlap, gate mode %d\r\n", _window_ms, _overlap, _gate_params.mode);
+    printf("Windows: %lu, classified: %lu (%lu forced), skipped: %lu\r\n", stats.windows, stats.forwarded, stats.forced, stats.skipped);
+    printf("Level: %d dBFS, noise floor: %d dBFS\r\n", (int)stats.level_db, (int)stats.noise_db);
+    printf("Longest inference: %lu us\r\n", stats.max_next_us);
+    printf("------------------------------------------\r\n");
+}
+
+void NNAudioClassification::updateEvents(const yamnet_res_t *results, int count) {
+    AudioClassificationEvent event;
+    float keep = 1.0 - _weight;
+    int i;
+
+    if (_smoothed == NULL) {
+        return;
+    }
+    // a window that was not classified counts as silence for every class
+    for (i = 0; i < AC_CLASS_COUNT; i++) {
+        _smoothed[i] *= keep;
+    }
+    for (i = 0; i < count; i++) {
+        if ((results[i].clsid >= 0) && (results[i].clsid < AC_CLASS_COUNT)) {
+            _smoothed[results[i].clsid] += _weight * results[i].prob;
+        }
+    }
+
+    for (i = 0; i < AC_CLASS_COUNT; i++) {
+        bool change = false;
+        if (!_active[i]) {
+            if (_smoothed[i] < _on_score) {
+                _run[i] = 0;
+            } else if (++_run[i] >= _on_windows) {
+                _active[i] = 1;
+                _onset[i] = _position_ms;
+                change = true;
+            }
+        } else {
+            if (_smoothed[i] >= _off_score) {
+                _run[i] = 0;
+            } else if (++_run[i] >= _off_windows) {
+                _active[i] = 0;
+                change = true;
+            }
+        }
+        if (change) {
+            _run[i] = 0;
+            if (_event_CB != NULL) {
+                event._classID = i;
+                event._score = _smoothed[i];
+                event._active = (_active[i] != 0);
+                event._duration = _active[i] ? 0 : (_position_ms - _onset[i]);
+                _event_CB(event);
+            }
+        }
+    }
+}
+
+void NNAudioClassification::ACGateCallback(audio_gate_decision_t decision, uint32_t index, float level_db, void *arg) {
+    NNAudioClassification *self = (NNAudioClassification *)arg;
+    uint32_t samples_per_ms = (self->_gate_params.sample_rate * self->_gate_params.channels) / 1000;
+    (void)level_db;
+
+    if (samples_per_ms == 0) {
+        samples_per_ms = 1;
+    }
+    // events are timed at the end of the window that caused them
+    self->_position_ms = (index / samples_per_ms) + self->_window_ms;
+    if (decision == AUDIO_GATE_SKIPPED) {
+        self->updateEvents(NULL, 0);
+    }
+}
+
 void NNAudioClassification::ACResultCallback(void *p, void *img_param) {
     int i = 0;
     (void)img_param;
@@ -98,7 +298,7 @@ void NNAudioClassification::ACResultCallback(void *p, void *img_param) {
     vipnn_out_buf_t *out = (vipnn_out_buf_t *)p;
     yamnet_res_t* result = (yamnet_res_t*)&out->res[0];
 
-    audio_result_vector.clear();
+    // results are written in place, the vector keeps its storage between windows
     audio_result_vector.resize((size_t)out->res_cnt);
     for (i = 0; i < out->res_cnt; i++) {
         audio_result_vector[i].result.clsid = (int)result[i].clsid;
@@ -108,6 +308,9 @@ void NNAudioClassification::ACResultCallback(void *p, void *img_param) {
     if (AC_user_CB != NULL) {
         AC_user_CB(audio_result_vector);
     }
+    if (_instance != NULL) {
+        _instance->updateEvents(result, out->res_cnt);
+    }
 }
 
 int AudioClassificationResult::classID(void) {
@@ -117,3 +320,19 @@ int AudioClassificationResult::classID(void) {
 int AudioClassificationResult::score(void) {
     return ((int)((result.prob) * 100));
 }
+
+int AudioClassificationEvent::classID(void) {
+    return _classID;
+}
+
+int AudioClassificationEvent::score(void) {
+    return ((int)(_score * 100));
+}
+
+bool AudioClassificationEvent::active(void) {
+    return _active;
+}
+
+uint32_t AudioClassificationEvent::duration(void) {
+    return _duration;
+}
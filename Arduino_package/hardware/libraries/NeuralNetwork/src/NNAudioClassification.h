@@ -9,6 +9,7 @@ extern "C" {
 #endif
 
 #include "module_vipnn.h"
+#include "audio_gate_drv.h"
 
 #ifdef __cplusplus
 }
@@ -18,6 +19,8 @@ extern "C" {
 #undef max
 #include <vector>
 
+#define AC_CLASS_COUNT 521      // YAMNet output classes
+
 class AudioClassificationResult {
     friend class NNAudioClassification;
     public:
@@ -28,6 +31,21 @@ class AudioClassificationResult {
         yamnet_res_t result = {0};
 };
 
+class AudioClassificationEvent {
+    friend class NNAudioClassification;
+    public:
+        int classID(void);
+        int score(void);
+        bool active(void);
+        uint32_t duration(void);
+
+    private:
+        int _classID = 0;
+        float _score = 0;
+        bool _active = false;
+        uint32_t _duration = 0;
+};
+
 class NNAudioClassification :public NNModelSelection {
     public:
         NNAudioClassification (void);
@@ -42,12 +60,45 @@ class NNAudioClassification :public NNModelSelection {
         AudioClassificationResult getResult(uint16_t index);
         std::vector<AudioClassificationResult> getResult(void);
 
+        void setWindow(uint32_t lengthMs, uint8_t overlapPercent = 50);
+        void setGate(uint8_t mode, float thresholdDb = -50.0, float vadMarginDb = 10.0);
+        void setHangover(uint32_t ms);
+        void setMaxSkip(uint32_t ms);
+        void setSmoothing(float weight);
+        void setEventThreshold(uint8_t onScore, uint8_t offScore);
+        void setEventDebounce(uint8_t onWindows, uint8_t offWindows);
+        void setEventCallback(void (*event_callback)(AudioClassificationEvent));
+        bool isActive(int classID);
+        int smoothedScore(int classID);
+        void printInfo(void);
+
     private:
         static void ACResultCallback(void *p, void *img_param);
+        static void ACGateCallback(audio_gate_decision_t decision, uint32_t index, float level_db, void *arg);
         static std::vector<AudioClassificationResult> audio_result_vector;
         static void (*AC_user_CB)(std::vector<AudioClassificationResult>);
+        static NNAudioClassification *_instance;
+
+        void updateEvents(const yamnet_res_t *results, int count);
 
         nn_data_param_t audio_nn_params = {0};
+        audio_gate_params_t _gate_params = {0};
+        mm_context_t *_vipnn_ctx = NULL;
+        uint32_t _window_ms = 975;
+        uint8_t _overlap = 50;
+
+        // smoothing and debounce state, one entry per class
+        float *_smoothed = NULL;
+        uint8_t *_run = NULL;
+        uint8_t *_active = NULL;
+        uint32_t *_onset = NULL;
+        float _weight = 0.5;
+        float _on_score = 0.5;
+        float _off_score = 0.3;
+        uint8_t _on_windows = 2;
+        uint8_t _off_windows = 2;
+        uint32_t _position_ms = 0;
+        void (*_event_CB)(AudioClassificationEvent) = NULL;
 
 };
 #endif
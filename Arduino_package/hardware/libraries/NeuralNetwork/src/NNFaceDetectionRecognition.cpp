@@ -26,6 +26,34 @@ extern int vipnn_control(void *p, int cmd, int arg);
 
 std::vector<FaceRecognitionResult> NNFaceDetectionRecognition::face_result_vector;
 void (*NNFaceDetectionRecognition::FR_user_CB)(std::vector<FaceRecognitionResult>);
+FaceDatabase* NNFaceDetectionRecognition::face_db = NULL;
+char NNFaceDetectionRecognition::face_db_enroll[FRDB_NAME_LEN] = {0};
+char NNFaceDetectionRecognition::face_db_names[MAX_FRC_REG_NUM][FRDB_NAME_LEN];
+float NNFaceDetectionRecognition::face_db_sims[MAX_FRC_REG_NUM];
+int NNFaceDetectionRecognition::face_db_count = 0;
+ObjectTracker* NNFaceDetectionRecognition::face_tracker = NULL;
+uint32_t NNFaceDetectionRecognition::face_lock = 0;
+
+// Copy of facerecog_module with the handle wrapped to match against a FaceDatabase
+static mm_module_t facerecog_hook_module;
+
+// Copy of vipnn_module for MobileFaceNet with the handle wrapped to skip faces whose track is already known
+static mm_module_t mbfacenet_track_module;
+
+// Tracks sent to MobileFaceNet in one frame. A result is matched to its batch by the timestamp of
+// the frame, which the VIPNN and face recognition modules pass along with the queue items.
+#define FR_TRACK_BATCHES 4
+typedef struct fr_track_batch_s {
+    uint32_t timestamp;
+    int count;
+    uint32_t ids[MAX_FRC_REG_NUM];
+} fr_track_batch_t;
+
+static fr_track_batch_t fr_track_batches[FR_TRACK_BATCHES];
+static volatile uint32_t fr_track_head = 0;
+static volatile uint32_t fr_track_tail = 0;
+static volatile bool fr_track_refresh = false;
+static uint32_t fr_result_timestamp = 0;   // frame of the result being reported, set in the face recognition task
 
 NNFaceDetectionRecognition::NNFaceDetectionRecognition(void) {
 }
@@ -77,14 +105,31 @@ void NNFaceDetectionRecognition::begin(void) {
 
     // Face Recognition
     if (mbfacenet_ctx == NULL) {
-        mbfacenet_ctx = mm_module_open(&vipnn_module);
+        if (face_tracker != NULL) {
+            if (face_lock == 0) {
+                face_lock = os_semaphore_create_arduino(1);
+            }
+            fr_track_head = 0;
+            fr_track_tail = 0;
+            mbfacenet_track_module = vipnn_module;
+            mbfacenet_track_module.handle = FRTrackHandle;
+            mbfacenet_ctx = mm_module_open(&mbfacenet_track_module);
+        } else {
+            mbfacenet_ctx = mm_module_open(&vipnn_module);
+        }
     }
     if (mbfacenet_ctx == NULL) {
         printf("\r\n[ERROR] NNFaceRecognition init failed\n");
         return;
     }
     if (facerecog_ctx == NULL) {
-        facerecog_ctx = mm_module_open(&facerecog_module);
+        if ((face_db != NULL) || (face_tracker != NULL)) {
+            facerecog_hook_module = facerecog_module;
+            facerecog_hook_module.handle = FRRecognitionHandle;
+            facerecog_ctx = mm_module_open(&facerecog_hook_module);
+        } else {
+            facerecog_ctx = mm_module_open(&facerecog_module);
+        }
     }
     if (facerecog_ctx == NULL) {
         printf("\r\n[ERROR] FaceRecognition module init failed\n");
@@ -208,6 +253,12 @@ void NNFaceDetectionRecognition::registerFace(const char* name) {
     if (!facerecog_ctx) {
         return;
     }
+    // the face being registered needs an embedding even if its track is already known
+    fr_track_refresh = true;
+    if (face_db != NULL) {
+        strncpy(face_db_enroll, name, FRDB_NAME_LEN - 1);
+        return;
+    }
     mm_module_ctrl(facerecog_ctx, CMD_FRC_REGISTER_MODE, (int)name);
 }
 
@@ -219,6 +270,11 @@ void NNFaceDetectionRecognition::removeFace(const char* name) {
     if (!facerecog_ctx) {
         return;
     }
+    fr_track_refresh = true;
+    if (face_db != NULL) {
+        face_db->remove(name);
+        return;
+    }
     mm_module_ctrl(facerecog_ctx, CMD_FRC_UNREGISTER_MODE, (int)name);
 }
 
@@ -226,6 +282,11 @@ void NNFaceDetectionRecognition::resetRegisteredFace(void) {
     if (!facerecog_ctx) {
         return;
     }
+    fr_track_refresh = true;
+    if (face_db != NULL) {
+        face_db->reset();
+        return;
+    }
     mm_module_ctrl(facerecog_ctx, CMD_FRC_RESET_FEATURES, 0);
 }
 
@@ -233,6 +294,11 @@ void NNFaceDetectionRecognition::backupRegisteredFace(void) {
     if (!facerecog_ctx) {
         return;
     }
+    // database records are written as faces are enrolled, only the meta record may be pending
+    if (face_db != NULL) {
+        face_db->sync();
+        return;
+    }
     mm_module_ctrl(facerecog_ctx, CMD_FRC_SAVE_FEATURES, 0);
 }
 
@@ -240,6 +306,11 @@ void NNFaceDetectionRecognition::restoreRegisteredFace(void) {
     if (!facerecog_ctx) {
         return;
     }
+    fr_track_refresh = true;
+    if (face_db != NULL) {
+        face_db->reload();
+        return;
+    }
     mm_module_ctrl(facerecog_ctx, CMD_FRC_LOAD_FEATURES, 0);
 }
 
@@ -256,6 +327,137 @@ void NNFaceDetectionRecognition::setThreshold(uint8_t threshold) {
     mm_module_ctrl(facerecog_ctx, CMD_FRC_SET_THRES100, threshold);
 }
 
+void NNFaceDetectionRecognition::useFaceDatabase(FaceDatabase& db) {
+    if (facerecog_ctx != NULL) {
+        printf("\r\n[ERROR] Face database must be set before begin()\n");
+        return;
+    }
+    face_db = &db;
+}
+
+void NNFaceDetectionRecognition::useTracker(ObjectTracker& tracker) {
+    if (mbfacenet_ctx != NULL) {
+        printf("\r\n[ERROR] Face tracker must be set before begin()\n");
+        return;
+    }
+    face_tracker = &tracker;
+}
+
+// Runs in the face recognition module task ahead of the module's own handler.
+// Embeddings are matched against the database here, so the number of identities
+// is not limited by the MAX_FRC_REG_NUM feature table inside the module. The frame
+// timestamp is kept for FRResultCallback(), which the module calls from its handler.
+int NNFaceDetectionRecognition::FRRecognitionHandle(void *p, void *input, void *output) {
+    mm_queue_item_t* input_item = (mm_queue_item_t*)input;
+    vipnn_out_buf_t* out = (vipnn_out_buf_t*)input_item->data_addr;
+
+    fr_result_timestamp = input_item->timestamp;
+    face_db_count = 0;
+    if ((face_db != NULL) && (out != NULL)) {
+        face_feature_res_t* res = (face_feature_res_t*)&out->res[0];
+        int count = out->res_cnt;
+        if (count > MAX_FRC_REG_NUM) {
+            count = MAX_FRC_REG_NUM;
+        }
+        if (face_db_enroll[0] != '\0') {
+            if (count == 1) {
+                if (face_db->enroll(face_db_enroll, res[0].feature) >= 0) {
+                    printf("Face registered: %s\r\n", face_db_enroll);
+                }
+                face_db_enroll[0] = '\0';
+            } else if (count > 1) {
+                printf("Face registration requires a single face in frame\r\n");
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            if (face_db->match(res[i].feature, face_db_names[i], &face_db_sims[i]) < 0) {
+                face_db_sims[i] = 0.0f;
+            }
+        }
+        face_db_count = count;
+    }
+    return facerecog_module.handle(p, input, output);
+}
+
+// Runs in the MobileFaceNet task ahead of the VIPNN handler. Face boxes from SCRFD are
+// associated with the tracker, and only the faces of new or uncertain tracks are left in
+// the result list MobileFaceNet works through, known faces keep their cached identity.
+int NNFaceDetectionRecognition::FRTrackHandle(void *p, void *input, void *output) {
+    mm_queue_item_t* input_item = (mm_queue_item_t*)input;
+    vipnn_out_buf_t* out = (vipnn_out_buf_t*)input_item->data_addr;
+
+    if ((face_tracker != NULL) && (out != NULL)) {
+        facedetect_res_t* res = (facedetect_res_t*)&out->res[0];
+        fr_track_batch_t* batch = &fr_track_batches[fr_track_head % FR_TRACK_BATCHES];
+        bool room = ((fr_track_head - fr_track_tail) < FR_TRACK_BATCHES);
+        bool all = fr_track_refresh || (face_db_enroll[0] != '\0');
+        int count = out->res_cnt;
+        int n = 0;
+
+        for (int i = 0; i < count; i++) {
+            face_tracker->addDetection(res[i].res.top_x, res[i].res.top_y, res[i].res.bot_x, res[i].res.bot_y, res[i].res.score);
+        }
+        face_tracker->update(millis());
+        fr_track_refresh = false;
+        for (int i = 0; i < count; i++) {
+            if (!room || (n >= MAX_FRC_REG_NUM)) {
+                break;
+            }
+            uint32_t id = face_tracker->trackID(i);
+            if ((id == 0) || !(face_tracker->needsRecognition(i) || all)) {
+                continue;
+            }
+            batch->ids[n] = id;
+            if (n != i) {
+                memcpy(&res[n], &res[i], sizeof(facedetect_res_t));
+            }
+            n++;
+        }
+        out->res_cnt = n;
+        if (n > 0) {
+            batch->timestamp = input_item->timestamp;
+            batch->count = n;
+            __sync_synchronize();
+            fr_track_head++;
+        } else {
+            // nothing to recognise, report the cached identities now
+            FRTrackResults();
+        }
+    }
+    return vipnn_module.handle(p, input, output);
+}
+
+void NNFaceDetectionRecognition::FRTrackResults(void) {
+    uint16_t count = face_tracker->getResultCount();
+    uint16_t n = 0;
+
+    os_semaphore_wait_arduino(face_lock, 0xFFFFFFFF);
+    face_result_vector.resize(count);
+    for (uint16_t i = 0; i < count; i++) {
+        TrackedObject track = face_tracker->getResult(i);
+        if ((track.id() == 0) || (track.missed() > 0)) {
+            continue;
+        }
+        FaceRecognitionResult* item = &face_result_vector[n++];
+        // the vector is reused between frames, nothing may be left from an earlier face
+        *item = FaceRecognitionResult();
+        item->result.xmin = track.xMin();
+        item->result.xmax = track.xMax();
+        item->result.ymin = track.yMin();
+        item->result.ymax = track.yMax();
+        item->track_id = track.id();
+        item->result_score = track.score();
+        strncpy(item->result_name, (track.name()[0] != '\0') ? track.name() : "unknown", (sizeof(item->result_name) - 1));
+        item->result_name[sizeof(item->result_name) - 1] = '\0';
+    }
+    face_result_vector.resize(n);
+
+    if (FR_user_CB != NULL) {
+        FR_user_CB(face_result_vector);
+    }
+    os_semaphore_release_arduino(face_lock);
+}
+
 void NNFaceDetectionRecognition::FRResultCallback(void *p, void *img_param) {
     (void)img_param;
     if (p == NULL) {
@@ -264,11 +466,45 @@ void NNFaceDetectionRecognition::FRResultCallback(void *p, void *img_param) {
 
     frc_draw_t* result = (frc_draw_t*)p;
 
+    if (face_tracker != NULL) {
+        // Results only cover the faces FRTrackHandle() sent, a frame without any was reported there.
+        // Batches of frames that never produced a result (dropped from a queue, failed inference)
+        // are older than this result and are skipped, so they cannot shift later results.
+        while ((fr_track_tail != fr_track_head) && ((int32_t)(fr_track_batches[fr_track_tail % FR_TRACK_BATCHES].timestamp - fr_result_timestamp) < 0)) {
+            fr_track_tail++;
+        }
+        if ((fr_track_tail == fr_track_head) || (fr_track_batches[fr_track_tail % FR_TRACK_BATCHES].timestamp != fr_result_timestamp)) {
+            return;
+        }
+        fr_track_batch_t* batch = &fr_track_batches[fr_track_tail % FR_TRACK_BATCHES];
+        bool db = (face_db != NULL) && (face_db_count == result->obj_cnt);
+        // a result that does not hold one face per track sent cannot be told apart, the batch is dropped
+        int count = (result->obj_cnt == batch->count) ? batch->count : 0;
+        for (int i = 0; i < count; i++) {
+            const char* name = db ? face_db_names[i] : result->obj_name[i];
+            float confidence;
+            if (db) {
+                confidence = face_db_sims[i];
+            } else {
+                confidence = ((name != NULL) && (strcmp(name, "unknown") != 0)) ? 1.0f : 0.0f;
+            }
+            face_tracker->setIdentity(batch->ids[i], name, confidence);
+        }
+        __sync_synchronize();
+        fr_track_tail++;
+        FRTrackResults();
+        return;
+    }
+
     face_result_vector.clear();
     face_result_vector.resize((size_t)result->obj_cnt);
     for (int i = 0; i < result->obj_cnt; i++) {
         memcpy(&(face_result_vector[i].result), &result->bbox[i], sizeof(frc_bbox_t));
-        strcpy(face_result_vector[i].result_name, result->obj_name[i]);
+        if ((face_db != NULL) && (face_db_count == result->obj_cnt)) {
+            strcpy(face_result_vector[i].result_name, face_db_names[i]);
+        } else {
+            strcpy(face_result_vector[i].result_name, result->obj_name[i]);
+        }
     }
 
     if (FR_user_CB != NULL) {
@@ -295,3 +531,11 @@ float FaceRecognitionResult::yMin(void) {
 float FaceRecognitionResult::yMax(void) {
    return ((float)result.ymax);
 }
+
+uint32_t FaceRecognitionResult::trackID(void) {
+    return track_id;
+}
+
+int FaceRecognitionResult::score(void) {
+    return result_score;
+}
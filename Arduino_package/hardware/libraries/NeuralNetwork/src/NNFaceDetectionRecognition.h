@@ -3,6 +3,8 @@
 
 #include "VideoStream.h"
 #include "NNModelSelection.h"
+#include "FaceDatabase.h"
+#include "ObjectTracker.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,10 +30,14 @@ class FaceRecognitionResult {
         float xMax(void);
         float yMin(void);
         float yMax(void);
+        uint32_t trackID(void);
+        int score(void);
 
     private:
         char result_name[32] = {0};
         frc_bbox_t result = {0};
+        uint32_t track_id = 0;
+        int result_score = 0;
 };
 
 class NNFaceDetectionRecognition:public NNModelSelection {
@@ -51,6 +57,8 @@ class NNFaceDetectionRecognition:public NNModelSelection {
         void backupRegisteredFace(void);
         void restoreRegisteredFace(void);
         void setThreshold(uint8_t threshold);
+        void useFaceDatabase(FaceDatabase& db);
+        void useTracker(ObjectTracker& tracker);
 
         void setResultCallback(void (*fr_callback)(std::vector<FaceRecognitionResult>));
         uint16_t getResultCount(void);
@@ -59,9 +67,19 @@ class NNFaceDetectionRecognition:public NNModelSelection {
 
     private:
         static void FRResultCallback(void *p, void *img_param);
+        static int FRRecognitionHandle(void *p, void *input, void *output);
+        static int FRTrackHandle(void *p, void *input, void *output);
+        static void FRTrackResults(void);
 
         static std::vector<FaceRecognitionResult> face_result_vector;
         static void (*FR_user_CB)(std::vector<FaceRecognitionResult>);
+        static FaceDatabase* face_db;
+        static char face_db_enroll[FRDB_NAME_LEN];
+        static char face_db_names[MAX_FRC_REG_NUM][FRDB_NAME_LEN];
+        static float face_db_sims[MAX_FRC_REG_NUM];
+        static int face_db_count;
+        static ObjectTracker* face_tracker;
+        static uint32_t face_lock;
 
         mm_context_t* facerecog_ctx = NULL;
         mm_context_t* mbfacenet_ctx = NULL;
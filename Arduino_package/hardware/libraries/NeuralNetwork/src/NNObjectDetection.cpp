@@ -29,6 +29,7 @@ float NNObjectDetection::xoffset;
 float NNObjectDetection::yscale;
 float NNObjectDetection::yoffset;
 uint8_t NNObjectDetection::use_roi;
+ObjectTracker* NNObjectDetection::od_tracker = NULL;
 
 void (*NNObjectDetection::OD_user_CB)(std::vector<ObjectDetectionResult>);
 
@@ -123,6 +124,7 @@ void NNObjectDetection::begin(void) {
     vipnn_control(_p_mmf_context->priv, CMD_VIPNN_SET_RES_SIZE, sizeof(objdetect_res_t));	// result size
     vipnn_control(_p_mmf_context->priv, CMD_VIPNN_SET_RES_MAX_CNT, MAX_DETECT_OBJ_NUM);		// result max count
     vipnn_control(_p_mmf_context->priv, CMD_VIPNN_APPLY, 0);
+    bootMark("nn_model_loaded");
 }
 
 void NNObjectDetection::end(void) {
@@ -160,6 +162,10 @@ std::vector<ObjectDetectionResult> NNObjectDetection::getResult(void) {
     return object_result_vector;
 }
 
+void NNObjectDetection::useTracker(ObjectTracker& tracker) {
+    od_tracker = &tracker;
+}
+
 void NNObjectDetection::ODResultCallback(void *p, void *img_param) {
     (void)img_param;
     if (p == NULL) {
@@ -168,6 +174,10 @@ void NNObjectDetection::ODResultCallback(void *p, void *img_param) {
     vipnn_out_buf_t *out = (vipnn_out_buf_t *)p;
     objdetect_res_t* result = (objdetect_res_t*)&out->res[0];
 
+    bootMark("first_inference");
+    if (out->res_cnt > 0) {
+        bootMark("first_detection");
+    }
     object_result_vector.clear();
     object_result_vector.resize((size_t)out->res_cnt);
     for (int i = 0; i < out->res_cnt; i++) {
@@ -189,6 +199,18 @@ void NNObjectDetection::ODResultCallback(void *p, void *img_param) {
         }
     }
 
+    if (od_tracker != NULL) {
+        detobj_t* res;
+        for (size_t i = 0; i < object_result_vector.size(); i++) {
+            res = &object_result_vector[i].result;
+            od_tracker->addDetection(res->top_x, res->top_y, res->bot_x, res->bot_y, res->score, (int)res->classes);
+        }
+        od_tracker->update(millis());
+        for (size_t i = 0; i < object_result_vector.size(); i++) {
+            object_result_vector[i].track_id = od_tracker->trackID(i);
+        }
+    }
+
     if (OD_user_CB != NULL) {
         OD_user_CB(object_result_vector);
     }
@@ -221,3 +243,7 @@ float ObjectDetectionResult::yMin(void) {
 float ObjectDetectionResult::yMax(void) {
     return result.bot_y;
 }
+
+uint32_t ObjectDetectionResult::trackID(void) {
+    return track_id;
+}
@@ -3,6 +3,7 @@
 
 #include "VideoStream.h"
 #include "NNModelSelection.h"
+#include "ObjectTracker.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,9 +29,11 @@ class ObjectDetectionResult {
         float xMax(void);
         float yMin(void);
         float yMax(void);
+        uint32_t trackID(void);
 
     private:
         detobj_t result = {0};
+        uint32_t track_id = 0;
 };
 
 class NNObjectDetection :public NNModelSelection {
@@ -48,9 +51,11 @@ class NNObjectDetection :public NNModelSelection {
         uint16_t getResultCount(void);
         ObjectDetectionResult getResult(uint16_t index);
         std::vector<ObjectDetectionResult> getResult(void);
+        void useTracker(ObjectTracker& tracker);
 
     private:
         static void ODResultCallback(void *p, void *img_param);
+        static ObjectTracker* od_tracker;
 
         static std::vector<ObjectDetectionResult> object_result_vector;
         static void (*OD_user_CB)(std::vector<ObjectDetectionResult>);
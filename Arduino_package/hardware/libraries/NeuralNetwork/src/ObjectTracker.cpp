@@ -0,0 +1,270 @@
+#include "ObjectTracker.h"
+
+ObjectTracker::ObjectTracker(void) {
+    ObjectTrackerInit(&_tracker, NULL);
+}
+
+ObjectTracker::~ObjectTracker(void) {
+    if (_lock) {
+        os_semaphore_delete_arduino(_lock);
+        _lock = 0;
+    }
+}
+
+void ObjectTracker::lock(void) {
+    if (_lock == 0) {
+        _lock = os_semaphore_create_arduino(1);
+    }
+    if (_lock) {
+        os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    }
+}
+
+void ObjectTracker::unlock(void) {
+    if (_lock) {
+        os_semaphore_release_arduino(_lock);
+    }
+}
+
+void ObjectTracker::setAssociation(float iouThreshold, float distanceGate) {
+    _tracker.params.iou_threshold = iouThreshold;
+    _tracker.params.distance_gate = distanceGate;
+}
+
+void ObjectTracker::setLifetime(uint8_t minHits, uint8_t maxMisses) {
+    _tracker.params.min_hits = (minHits > 0) ? minHits : 1;
+    _tracker.params.max_misses = maxMisses;
+}
+
+void ObjectTracker::setBirthScore(float score) {
+    _tracker.params.birth_score = score;
+}
+
+void ObjectTracker::setNoise(float process, float measurement) {
+    _tracker.params.process_noise = process;
+    _tracker.params.measurement_noise = measurement;
+}
+
+void ObjectTracker::matchClass(bool enable) {
+    _tracker.params.match_class = enable ? 1 : 0;
+}
+
+void ObjectTracker::setRecognition(float confidence, uint8_t retries, uint32_t refreshFrames) {
+    _tracker.params.recog_confidence = confidence;
+    _tracker.params.recog_retries = retries;
+    _tracker.params.recog_interval = refreshFrames;
+}
+
+void ObjectTracker::reset(void) {
+    object_tracker_params_t params;
+
+    lock();
+    params = _tracker.params;
+    ObjectTrackerInit(&_tracker, &params);
+    _det_count = 0;
+    _frame_count = 0;
+    _active = 0;
+    _results.clear();
+    unlock();
+}
+
+bool ObjectTracker::addDetection(float xmin, float ymin, float xmax, float ymax, float score, int type) {
+    if (_det_count >= OBJECT_TRACKER_MAX_DETECTIONS) {
+        return false;
+    }
+    object_tracker_box_t* box = &_dets[_det_count++];
+    box->xmin = xmin;
+    box->ymin = ymin;
+    box->xmax = xmax;
+    box->ymax = ymax;
+    box->score = score;
+    box->classes = (int16_t)type;
+    return true;
+}
+
+int ObjectTracker::update(uint32_t timestampMs) {
+    int matched;
+
+    lock();
+    matched = ObjectTrackerUpdate(&_tracker, _dets, _det_count, timestampMs, _det_track);
+    _frame_count = _det_count;
+    _det_count = 0;
+
+    // the result list keeps its storage between frames
+    _active = 0;
+    _results.resize(OBJECT_TRACKER_MAX_TRACKS);
+    int count = 0;
+    for (int i = 0; i < OBJECT_TRACKER_MAX_TRACKS; i++) {
+        if (_tracker.tracks[i].state != OBJECT_TRACK_CONFIRMED) {
+            continue;
+        }
+        if (_tracker.tracks[i].misses == 0) {
+            _active++;
+        }
+        fill(i, _results[count++]);
+    }
+    _results.resize(count);
+    unlock();
+    return matched;
+}
+
+uint32_t ObjectTracker::trackID(int detection) {
+    uint32_t id = 0;
+
+    lock();
+    if ((detection >= 0) && (detection < _frame_count) && (_det_track[detection] >= 0)) {
+        id = _tracker.tracks[_det_track[detection]].id;
+    }
+    unlock();
+    return id;
+}
+
+bool ObjectTracker::needsRecognition(int detection) {
+    bool needed = false;
+
+    lock();
+    if ((detection >= 0) && (detection < _frame_count) && (_det_track[detection] >= 0)) {
+        needed = (ObjectTrackerNeedsRecognition(&_tracker, _det_track[detection]) != 0);
+    }
+    unlock();
+    return needed;
+}
+
+void ObjectTracker::setIdentity(uint32_t trackID, const char* name, float confidence) {
+    lock();
+    int index = ObjectTrackerFind(&_tracker, trackID);
+    if (index >= 0) {
+        ObjectTrackerSetIdentity(&_tracker, index, name, confidence);
+        for (size_t i = 0; i < _results.size(); i++) {
+            if (_results[i].track.id == trackID) {
+                fill(index, _results[i]);
+            }
+        }
+    }
+    unlock();
+}
+
+void ObjectTracker::fill(int index, TrackedObject& object) {
+    memcpy(&object.track, &_tracker.tracks[index], sizeof(object_track_t));
+    ObjectTrackerBox(&_tracker, index, &object.box);
+}
+
+uint16_t ObjectTracker::getResultCount(void) {
+    return _results.size();
+}
+
+TrackedObject ObjectTracker::getResult(uint16_t index) {
+    TrackedObject object;
+
+    lock();
+    if (index < _results.size()) {
+        object = _results[index];
+    }
+    unlock();
+    return object;
+}
+
+std::vector<TrackedObject> ObjectTracker::getResult(void) {
+    std::vector<TrackedObject> results;
+
+    lock();
+    results = _results;
+    unlock();
+    return results;
+}
+
+bool ObjectTracker::getTrack(uint32_t trackID, TrackedObject& object) {
+    lock();
+    int index = ObjectTrackerFind(&_tracker, trackID);
+    if (index >= 0) {
+        fill(index, object);
+    }
+    unlock();
+    return (index >= 0);
+}
+
+uint32_t ObjectTracker::totalCount(void) {
+    return _tracker.stats.confirmed;
+}
+
+uint16_t ObjectTracker::activeCount(void) {
+    return _active;
+}
+
+uint32_t ObjectTracker::recognitionCount(void) {
+    return _tracker.stats.recog_requests;
+}
+
+uint32_t ObjectTracker::detectionCount(void) {
+    return _tracker.stats.detections;
+}
+
+void ObjectTracker::printInfo(void) {
+    object_tracker_stats_t stats;
+
+    lock();
+    stats = _tracker.stats;
+    printf("\r\n------------------------------------------\r\n");
+    printf("Object Tracker Info:\r\n");
+    printf("Frames: %lu, detections: %lu, matched to tracks: %lu\r\n", stats.frames, stats.detections, stats.matched);
+    printf("Tracks started: %lu, confirmed: %lu, dropped: %lu, active: %u\r\n", stats.born, stats.confirmed, stats.dropped, _active);
+    printf("Recognitions requested: %lu of %lu detections\r\n", stats.recog_requests, stats.detections);
+    for (size_t i = 0; i < _results.size(); i++) {
+        object_track_t* t = &_results[i].track;
+        printf("Track %lu: type %d, %s (%d%%), %lu ms, missed %u\r\n", t->id, t->classes, t->recognized ? t->name : "-", (int)(t->confidence * 100), (t->last_ms - t->first_ms), t->misses);
+    }
+    printf("------------------------------------------\r\n");
+    unlock();
+}
+
+uint32_t TrackedObject::id(void) {
+    return track.id;
+}
+
+int TrackedObject::type(void) {
+    return track.classes;
+}
+
+const char* TrackedObject::name(void) {
+    return track.name;
+}
+
+int TrackedObject::confidence(void) {
+    return ((int)(track.confidence * 100));
+}
+
+int TrackedObject::score(void) {
+    return ((int)(track.score * 100));
+}
+
+float TrackedObject::xMin(void) {
+    return box.xmin;
+}
+
+float TrackedObject::xMax(void) {
+    return box.xmax;
+}
+
+float TrackedObject::yMin(void) {
+    return box.ymin;
+}
+
+float TrackedObject::yMax(void) {
+    return box.ymax;
+}
+
+float TrackedObject::xVelocity(void) {
+    return track.x.vel;
+}
+
+float TrackedObject::yVelocity(void) {
+    return track.y.vel;
+}
+
+uint32_t TrackedObject::age(void) {
+    return (track.last_ms - track.first_ms);
+}
+
+uint16_t TrackedObject::missed(void) {
+    return track.misses;
+}
@@ -0,0 +1,91 @@
+#ifndef __OBJECT_TRACKER_H__
+#define __OBJECT_TRACKER_H__
+
+#include <Arduino.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "object_tracker.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#undef min
+#undef max
+#include <vector>
+
+class TrackedObject {
+    friend class ObjectTracker;
+    public:
+        uint32_t id(void);
+        int type(void);
+        const char* name(void);
+        int confidence(void);
+        int score(void);
+        float xMin(void);
+        float xMax(void);
+        float yMin(void);
+        float yMax(void);
+        float xVelocity(void);
+        float yVelocity(void);
+        uint32_t age(void);
+        uint16_t missed(void);
+
+    private:
+        object_track_t track = {0};
+        object_tracker_box_t box = {0};
+};
+
+// Follows detections from frame to frame and gives each object a stable id.
+// Detections of a frame are added with addDetection() and then associated with the
+// existing tracks by update(). Identities from a recognition model are cached per track,
+// so the model only needs to run for new or uncertain tracks.
+class ObjectTracker {
+    public:
+        ObjectTracker(void);
+        ~ObjectTracker(void);
+
+        void setAssociation(float iouThreshold, float distanceGate = 0.5);
+        void setLifetime(uint8_t minHits, uint8_t maxMisses);
+        void setBirthScore(float score);
+        void setNoise(float process, float measurement);
+        void matchClass(bool enable);
+        void setRecognition(float confidence, uint8_t retries, uint32_t refreshFrames);
+        void reset(void);
+
+        bool addDetection(float xmin, float ymin, float xmax, float ymax, float score, int type = 0);
+        int update(uint32_t timestampMs = 0);
+        uint32_t trackID(int detection);
+        bool needsRecognition(int detection);
+        void setIdentity(uint32_t trackID, const char* name, float confidence);
+
+        uint16_t getResultCount(void);
+        TrackedObject getResult(uint16_t index);
+        std::vector<TrackedObject> getResult(void);
+        bool getTrack(uint32_t trackID, TrackedObject& object);
+
+        uint32_t totalCount(void);
+        uint16_t activeCount(void);
+        uint32_t recognitionCount(void);
+        uint32_t detectionCount(void);
+        void printInfo(void);
+
+    private:
+        void lock(void);
+        void unlock(void);
+        void fill(int index, TrackedObject& object);
+
+        uint32_t _lock = 0;
+        object_tracker_t _tracker;
+        object_tracker_box_t _dets[OBJECT_TRACKER_MAX_DETECTIONS];
+        int8_t _det_track[OBJECT_TRACKER_MAX_DETECTIONS];
+        int _det_count = 0;
+        int _frame_count = 0;
+        uint16_t _active = 0;
+        std::vector<TrackedObject> _results;
+};
+
+#endif
@@ -7,6 +7,7 @@ extern "C" {
 #endif
 
 #include "rtl8735b.h"
+#include "mbedtls/sha256.h"
 
 #ifdef __cplusplus
 }
@@ -275,122 +276,454 @@ int HUB8735FatFS::setLastModTime(char *path, uint16_t year, uint16_t month, uint
 }
 
 
-void HUB8735FatFS::sd_upgrade(void){
-    FIL m_file;
-    //fatfs_sd_params_t fatfs_sd;
-    flash_t flash;
-    FRESULT res;
-    char fw_name[12] = "hub8735.bin";	//arduino size must string size + 1
-    char path[32] = {0};
-    unsigned int fw_len, addr, r_len;
-    unsigned short block_max = 256;
-    unsigned short i, w_num, presentage;
-    unsigned char *r_buf;
-
-	res = (FRESULT)fatfs_sd_init();
-	if (res < 0) {
-		printf("fatfs_sd_init fail (%d)\n", res);
-		goto fail;
-	}
-
-	printf("sd_upgrade enter\r\n");
-	//printf("[%s] fw_nam %s\r\n", __FUNCTION__, fw_name);
-    //Get SD parameters
-    fatfs_sd_get_param(&fatfs_sd);
-    
-    //Pack FW file path
-    sprintf(path, "%s%s",fatfs_sd.drv, fw_name);
+//-----------------------------------------------------------------------------
+// SD card upgrade
+
+#define SD_UPGRADE_SECTOR_SIZE          (4 * 1024)
+// Partition table and boot headers, programmed last so that they only change once the rest is in place
+#define SD_UPGRADE_BOOT_SIZE            (64 * 1024)
+#define SD_UPGRADE_JOURNAL_MAGIC        0x31475055      // "UPG1"
+// Chunks programmed between progress file updates. A resumed run redoes at most this many, and
+// those are mostly skipped as already up to date.
+#define SD_UPGRADE_JOURNAL_INTERVAL     8
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size;
+    uint8_t digest[32];
+    uint32_t done;          // chunks programmed, in programming order
+} sd_upgrade_journal_t;
+
+typedef struct {
+    FIL *file;
+    uint8_t *buf[2];
+    uint32_t len[2];
+    FRESULT result[2];
+    uint32_t empty[2];
+    uint32_t full[2];
+    uint32_t finished;
+    uint32_t first;         // position of the first chunk to read
+    uint32_t chunks;
+    bool reorder;
+    volatile bool stop;
+} sd_upgrade_reader_t;
+
+typedef struct {
+    const char *name;
+    sd_upgrade_cb_t callback;
+    sd_upgrade_progress_t progress;
+    uint32_t start;
+    uint8_t percent;
+} sd_upgrade_report_t;
+
+// Chunk read at position pos, with reorder the boot area comes after the rest of the image
+static uint32_t sd_upgrade_chunk_at(uint32_t pos, uint32_t chunks, bool reorder) {
+    uint32_t boot = SD_UPGRADE_BOOT_SIZE / SD_UPGRADE_CHUNK_SIZE;
+
+    if ((!reorder) || (chunks <= boot)) {
+        return pos;
+    }
+    return (pos < (chunks - boot)) ? (pos + boot) : (pos - (chunks - boot));
+}
+
+static void sd_upgrade_reader_thread(const void *argument) {
+    sd_upgrade_reader_t *reader = (sd_upgrade_reader_t *)argument;
+    uint32_t b = 0;
+    uint32_t chunk;
+
+    for (uint32_t pos = reader->first; pos < reader->chunks; pos++) {
+        os_semaphore_wait_arduino(reader->empty[b], 0xFFFFFFFF);
+        if (reader->stop) {
+            break;
+        }
+        chunk = sd_upgrade_chunk_at(pos, reader->chunks, reader->reorder);
+        reader->len[b] = 0;
+        reader->result[b] = f_lseek(reader->file, (chunk * SD_UPGRADE_CHUNK_SIZE));
+        if (reader->result[b] == FR_OK) {
+            reader->result[b] = f_read(reader->file, reader->buf[b], SD_UPGRADE_CHUNK_SIZE, (u32 *)&reader->len[b]);
+        }
+        os_semaphore_release_arduino(reader->full[b]);
+        b ^= 1;
+    }
+    os_semaphore_release_arduino(reader->finished);
+    os_thread_terminate_arduino(os_thread_get_id_arduino());
+}
+
+static uint32_t sd_upgrade_semaphore(bool available) {
+    uint32_t sem = os_semaphore_create_arduino(1);
+
+    if ((sem != 0) && (!available)) {
+        os_semaphore_wait_arduino(sem, 0);
+    }
+    return sem;
+}
+
+static void sd_upgrade_reader_free(sd_upgrade_reader_t *reader) {
+    for (int b = 0; b < 2; b++) {
+        if (reader->empty[b]) {
+            os_semaphore_delete_arduino(reader->empty[b]);
+        }
+        if (reader->full[b]) {
+            os_semaphore_delete_arduino(reader->full[b]);
+        }
+    }
+    if (reader->finished) {
+        os_semaphore_delete_arduino(reader->finished);
+    }
+}
+
+static bool sd_upgrade_reader_start(sd_upgrade_reader_t *reader) {
+    reader->stop = false;
+    for (int b = 0; b < 2; b++) {
+        reader->empty[b] = sd_upgrade_semaphore(true);
+        reader->full[b] = sd_upgrade_semaphore(false);
+    }
+    reader->finished = sd_upgrade_semaphore(false);
+    if ((reader->empty[0] == 0) || (reader->empty[1] == 0) || (reader->full[0] == 0) || (reader->full[1] == 0) || (reader->finished == 0)) {
+        sd_upgrade_reader_free(reader);
+        return false;
+    }
+    if (os_thread_create_arduino(sd_upgrade_reader_thread, reader, OS_PRIORITY_ABOVENORMAL, 2048) == 0) {
+        printf("\r\n[ERROR] %s SD reader thread create failed\n", __FUNCTION__);
+        sd_upgrade_reader_free(reader);
+        return false;
+    }
+    return true;
+}
+
+// Stop the reader, possibly waiting for a buffer, and wait for it to exit
+static void sd_upgrade_reader_stop(sd_upgrade_reader_t *reader) {
+    reader->stop = true;
+    os_semaphore_release_arduino(reader->empty[0]);
+    os_semaphore_release_arduino(reader->empty[1]);
+    os_semaphore_wait_arduino(reader->finished, 0xFFFFFFFF);
+    sd_upgrade_reader_free(reader);
+}
+
+static void sd_upgrade_report(sd_upgrade_report_t *report, bool last) {
+    sd_upgrade_progress_t *progress = &report->progress;
+    uint32_t elapsed = millis() - report->start;
+    uint8_t percent = (progress->total > 0) ? (uint8_t)((((uint64_t)progress->done) * 100) / progress->total) : 100;
+    static const char *const phase_names[] = {"Hashing", "Upgrading", "Verifying"};
+
+    progress->rate = (elapsed > 0) ? (uint32_t)((((uint64_t)progress->done) * 1000) / elapsed) : 0;
+    if ((percent != report->percent) || last) {
+        report->percent = percent;
+        printf("[%s] %s... %d%% (%lu KB/s)\r\n", report->name, phase_names[progress->phase], percent, (progress->rate / 1024));
+    }
+    if (report->callback) {
+        report->callback(progress);
+    }
+}
+
+static void sd_upgrade_phase(sd_upgrade_report_t *report, uint8_t phase) {
+    report->progress.phase = phase;
+    report->progress.done = 0;
+    report->percent = 0xFF;
+    report->start = millis();
+}
+
+// SHA-256 of the image file, read through the double buffer
+static int sd_upgrade_hash_file(FIL *file, uint32_t size, uint8_t *buf[2], uint8_t digest[32], sd_upgrade_report_t *report) {
+    sd_upgrade_reader_t reader;
+    mbedtls_sha256_context sha;
+    int ret = SD_UPGRADE_OK;
+    uint32_t b = 0;
+
+    memset(&reader, 0, sizeof(reader));
+    reader.file = file;
+    reader.buf[0] = buf[0];
+    reader.buf[1] = buf[1];
+    reader.chunks = (size + SD_UPGRADE_CHUNK_SIZE - 1) / SD_UPGRADE_CHUNK_SIZE;
+    if (!sd_upgrade_reader_start(&reader)) {
+        return SD_UPGRADE_NO_MEMORY;
+    }
+
+    sd_upgrade_phase(report, SD_UPGRADE_PHASE_HASH);
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    for (uint32_t pos = 0; pos < reader.chunks; pos++) {
+        os_semaphore_wait_arduino(reader.full[b], 0xFFFFFFFF);
+        if ((reader.result[b] != FR_OK) || (reader.len[b] == 0)) {
+            ret = SD_UPGRADE_READ_FAIL;
+            break;
+        }
+        mbedtls_sha256_update_ret(&sha, reader.buf[b], reader.len[b]);
+        report->progress.done += reader.len[b];
+        os_semaphore_release_arduino(reader.empty[b]);
+        b ^= 1;
+        sd_upgrade_report(report, false);
+    }
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    sd_upgrade_reader_stop(&reader);
+    return ret;
+}
+
+// SHA-256 of the first size bytes of flash
+static void sd_upgrade_hash_flash(flash_t *flash, uint32_t size, uint8_t *buf, uint8_t digest[32], sd_upgrade_report_t *report) {
+    mbedtls_sha256_context sha;
+    uint32_t len;
+
+    sd_upgrade_phase(report, SD_UPGRADE_PHASE_VERIFY);
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    for (uint32_t addr = 0; addr < size; addr += len) {
+        len = ((size - addr) < SD_UPGRADE_CHUNK_SIZE) ? (size - addr) : SD_UPGRADE_CHUNK_SIZE;
+        flash_stream_read(flash, addr, len, buf);
+        mbedtls_sha256_update_ret(&sha, buf, len);
+        report->progress.done += len;
+        sd_upgrade_report(report, false);
+    }
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+}
+
+// Expected digest from "<image>.sha256", as written by sha256sum. Returns false if there is none.
+static bool sd_upgrade_expected_digest(const char *path, uint8_t digest[32]) {
+    FIL file;
+    char hex[64];
+    u32 len = 0;
+    char c;
+    uint8_t nibble;
+
+    if (f_open(&file, path, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+        return false;
+    }
+    f_read(&file, hex, sizeof(hex), &len);
+    f_close(&file);
+    if (len < sizeof(hex)) {
+        return false;
+    }
+    for (int i = 0; i < 64; i++) {
+        c = hex[i];
+        if ((c >= '0') && (c <= '9')) {
+            nibble = c - '0';
+        } else if ((c >= 'a') && (c <= 'f')) {
+            nibble = c - 'a' + 10;
+        } else if ((c >= 'A') && (c <= 'F')) {
+            nibble = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        digest[(i / 2)] = (i & 1) ? (digest[(i / 2)] | nibble) : (nibble << 4);
+    }
+    return true;
+}
 
-    //Open FW file
-    res = f_open(&m_file, path, FA_OPEN_EXISTING | FA_READ);
+// The progress file only helps while the device still boots: the image replaces the running
+// firmware in place, and a power loss partway through it leaves nothing bootable to resume from.
+// The progress file stays open for the whole run and the record is rewritten in place, so an
+// update does not free and reallocate its cluster like recreating the file would
+static void sd_upgrade_journal_write(FIL *file, sd_upgrade_journal_t *journal) {
+    u32 len;
 
-    //Check if FW file exist
-    if(res != FR_OK)
-    {
-        //FW file doesn't esixt
-        printf("[%s] Not found upgrade file 'hub8735.bin'\r\n", __FUNCTION__);
+    if (f_lseek(file, 0) != FR_OK) {
         return;
-        //goto fail;
-    }
-    else
-    {
-        //Get FW file length
-        fw_len = f_size(&m_file);
-        
-        //Check if file length is valid
-        if(fw_len > 0)
-        {
-            printf("[%s] %s size %d\r\n",__FUNCTION__, fw_name, fw_len);
-            
-            //Erase flash
-            addr = 0;
-            presentage = 100;
-            
-            for(i=0;i<block_max;i++)
-            {
-                flash_erase_block(&flash, addr+(i*64*1024));
-                if(presentage != (((i+1)*100)/block_max))
-                {
-                	presentage = (((i+1)*100)/block_max);
-                	printf("[%s] Erasing... %d%%\r\n",__FUNCTION__,presentage);
-                }
-            }
-            //Write to flash
-            addr = 0;
-            presentage = 100;
-            
-            w_num = fw_len / (4*1024);
-            if((fw_len % (4*1024)))
-            {
-               w_num++;
-            }
-            
-            r_buf = (unsigned char *)malloc(4*1024);
-            if(r_buf == 0)
-            {
-                f_close(&m_file);
-                return;
-            }
-            
-            for(i=0;i<w_num;i++)
-            {
-                if(f_read(&m_file, r_buf, 4*1024, (u32 *)&r_len) != FR_OK)
-                {
-                    //Read failed
-                    free(r_buf);
-                    f_close(&m_file);
-                    printf("[%s] Read file failed",__FUNCTION__);
-                    return;
-                }
-               
-                flash_stream_write(&flash, addr, r_len, r_buf);
-                //flash_stream_read(&flash, addr, r_len, r_buf);                
-                addr += r_len;
-                if(presentage != (((i+1)*100)/w_num))
-                {
-                	presentage = (((i+1)*100)/w_num);
-                	printf("[%s] Upgrading.... %d%% \r\n",__FUNCTION__, presentage);
-                }
-            }
-            printf("[%s] Upgrade done\r\n",__FUNCTION__);
-        	free(r_buf);
+    }
+    f_write(file, journal, sizeof(sd_upgrade_journal_t), &len);
+    f_sync(file);
+}
+
+// Chunks already programmed by an earlier run of the same image
+static uint32_t sd_upgrade_journal_read(const char *path, uint32_t size, const uint8_t digest[32]) {
+    FIL file;
+    sd_upgrade_journal_t journal;
+    u32 len = 0;
+
+    if (f_open(&file, path, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+        return 0;
+    }
+    f_read(&file, &journal, sizeof(journal), &len);
+    f_close(&file);
+    if ((len != sizeof(journal)) || (journal.magic != SD_UPGRADE_JOURNAL_MAGIC) || (journal.size != size) || (memcmp(journal.digest, digest, 32) != 0)) {
+        return 0;
+    }
+    return journal.done;
+}
+
+// Erase and program the sectors of one chunk that differ from the image, verifying each one written
+static bool sd_upgrade_program_chunk(flash_t *flash, uint32_t addr, uint8_t *data, uint32_t length, uint8_t *sector, sd_upgrade_progress_t *progress) {
+    uint32_t len;
+
+    for (uint32_t offset = 0; offset < length; offset += len) {
+        len = ((length - offset) < SD_UPGRADE_SECTOR_SIZE) ? (length - offset) : SD_UPGRADE_SECTOR_SIZE;
+        flash_stream_read(flash, (addr + offset), len, sector);
+        if (memcmp(sector, (data + offset), len) == 0) {
+            progress->skipped += len;
+            continue;
         }
-        else
-        {
-            printf("[%s] %s is empty\r\n",__FUNCTION__, fw_name);
+        flash_erase_sector(flash, (addr + offset));
+        flash_stream_write(flash, (addr + offset), len, (data + offset));
+        flash_stream_read(flash, (addr + offset), len, sector);
+        if (memcmp(sector, (data + offset), len) != 0) {
+            printf("\r\n[ERROR] %s flash sector 0x%08lx does not hold the data written\n", __FUNCTION__, (addr + offset));
+            return false;
         }
+        progress->written += len;
+    }
+    return true;
+}
+
+int HUB8735FatFS::upgrade(const char* filename, sd_upgrade_cb_t callback) {
+    FIL m_file;
+    FIL journal_file;
+    flash_t flash;
+    sd_upgrade_reader_t reader;
+    sd_upgrade_report_t report;
+    sd_upgrade_journal_t journal;
+    char path[64];
+    char journal_path[72];
+    char digest_path[72];
+    uint8_t expected[32];
+    uint8_t digest[32];
+    uint8_t *buf[2] = {NULL, NULL};
+    uint8_t *sector = NULL;
+    uint32_t fw_len;
+    uint32_t chunk;
+    uint32_t b = 0;
+    bool journal_open = false;
+    int ret = SD_UPGRADE_OK;
+
+    if ((fatfs_sd.drv_num < 0) && (!begin())) {
+        return SD_UPGRADE_NO_FILE;
+    }
+    snprintf(path, sizeof(path), "%s%s", fatfs_sd.drv, filename);
+    snprintf(journal_path, sizeof(journal_path), "%s.upg", path);
+    snprintf(digest_path, sizeof(digest_path), "%s.sha256", path);
+
+    if (f_open(&m_file, path, FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+        printf("[%s] Not found upgrade file '%s'\r\n", __FUNCTION__, filename);
+        return SD_UPGRADE_NO_FILE;
+    }
+    fw_len = f_size(&m_file);
+    if ((fw_len == 0) || (fw_len > SD_UPGRADE_MAX_SIZE)) {
+        printf("[%s] %s size %lu is not a valid image\r\n", __FUNCTION__, filename, fw_len);
         f_close(&m_file);
-                
-      
-        f_unlink(path);
-        printf("[%s] Delete file & Hold system, please reset board\r\n", __FUNCTION__);       
-        while(1);
+        return SD_UPGRADE_BAD_IMAGE;
+    }
+    printf("[%s] %s size %lu\r\n", __FUNCTION__, filename, fw_len);
+
+    buf[0] = (uint8_t *)malloc(SD_UPGRADE_CHUNK_SIZE);
+    buf[1] = (uint8_t *)malloc(SD_UPGRADE_CHUNK_SIZE);
+    sector = (uint8_t *)malloc(SD_UPGRADE_SECTOR_SIZE);
+    if ((buf[0] == NULL) || (buf[1] == NULL) || (sector == NULL)) {
+        ret = SD_UPGRADE_NO_MEMORY;
+        goto done;
+    }
+
+    memset(&report, 0, sizeof(report));
+    report.name = __FUNCTION__;
+    report.callback = callback;
+    report.progress.total = fw_len;
+
+    // The whole image is hashed before the flash is touched: a damaged file is refused, and
+    // the digest ties the progress file to this image
+    ret = sd_upgrade_hash_file(&m_file, fw_len, buf, digest, &report);
+    if (ret != SD_UPGRADE_OK) {
+        printf("[%s] Read file failed\r\n", __FUNCTION__);
+        goto done;
+    }
+    if (sd_upgrade_expected_digest(digest_path, expected) && (memcmp(expected, digest, sizeof(digest)) != 0)) {
+        printf("[%s] %s does not match its SHA-256 digest\r\n", __FUNCTION__, filename);
+        ret = SD_UPGRADE_BAD_IMAGE;
+        goto done;
+    }
+
+    memset(&journal, 0, sizeof(journal));
+    journal.magic = SD_UPGRADE_JOURNAL_MAGIC;
+    journal.size = fw_len;
+    memcpy(journal.digest, digest, sizeof(digest));
+
+    memset(&reader, 0, sizeof(reader));
+    reader.file = &m_file;
+    reader.buf[0] = buf[0];
+    reader.buf[1] = buf[1];
+    reader.chunks = (fw_len + SD_UPGRADE_CHUNK_SIZE - 1) / SD_UPGRADE_CHUNK_SIZE;
+    reader.reorder = true;
+    reader.first = sd_upgrade_journal_read(journal_path, fw_len, digest);
+    if (reader.first >= reader.chunks) {
+        reader.first = 0;
+    }
+    if (reader.first > 0) {
+        printf("[%s] Resuming after %lu of %lu chunks\r\n", __FUNCTION__, reader.first, reader.chunks);
     }
-    
-    fail:
 
-	fatfs_sd_close();
+    sd_upgrade_phase(&report, SD_UPGRADE_PHASE_PROGRAM);
+    report.progress.done = reader.first * SD_UPGRADE_CHUNK_SIZE;
+    if (!sd_upgrade_reader_start(&reader)) {
+        ret = SD_UPGRADE_NO_MEMORY;
+        goto done;
+    }
+    // Without the progress file the upgrade still works, a later run just compares from the start
+    journal_open = (f_open(&journal_file, journal_path, FA_OPEN_ALWAYS | FA_WRITE) == FR_OK);
+    for (uint32_t pos = reader.first; pos < reader.chunks; pos++) {
+        chunk = sd_upgrade_chunk_at(pos, reader.chunks, reader.reorder);
+        os_semaphore_wait_arduino(reader.full[b], 0xFFFFFFFF);
+        if ((reader.result[b] != FR_OK) || (reader.len[b] == 0)) {
+            printf("[%s] Read file failed\r\n", __FUNCTION__);
+            ret = SD_UPGRADE_READ_FAIL;
+            break;
+        }
+        // the reader fills the other buffer while this one is erased and programmed
+        if (!sd_upgrade_program_chunk(&flash, (chunk * SD_UPGRADE_CHUNK_SIZE), reader.buf[b], reader.len[b], sector, &report.progress)) {
+            ret = SD_UPGRADE_VERIFY_FAIL;
+            break;
+        }
+        report.progress.done += reader.len[b];
+        os_semaphore_release_arduino(reader.empty[b]);
+        b ^= 1;
 
+        if (journal_open && ((((pos + 1) % SD_UPGRADE_JOURNAL_INTERVAL) == 0) || ((pos + 1) == reader.chunks))) {
+            journal.done = pos + 1;
+            sd_upgrade_journal_write(&journal_file, &journal);
+        }
+        sd_upgrade_report(&report, false);
+    }
+    sd_upgrade_reader_stop(&reader);
+    if (journal_open) {
+        f_close(&journal_file);
+    }
+    if (ret != SD_UPGRADE_OK) {
+        goto done;
+    }
+    sd_upgrade_report(&report, true);
+    printf("[%s] %lu bytes programmed, %lu bytes already up to date\r\n", __FUNCTION__, report.progress.written, report.progress.skipped);
+
+    sd_upgrade_hash_flash(&flash, fw_len, buf[0], expected, &report);
+    if (memcmp(expected, digest, sizeof(digest)) != 0) {
+        // the image stays on the card and the next run rewrites whatever differs
+        printf("[%s] Flash digest does not match the image\r\n", __FUNCTION__);
+        f_unlink(journal_path);
+        ret = SD_UPGRADE_VERIFY_FAIL;
+        goto done;
+    }
+    printf("[%s] Upgrade done and verified\r\n", __FUNCTION__);
+
+done:
+    f_close(&m_file);
+    if (ret == SD_UPGRADE_OK) {
+        f_unlink(journal_path);
+        f_unlink(path);
+    }
+    if (buf[0]) {
+        free(buf[0]);
+    }
+    if (buf[1]) {
+        free(buf[1]);
+    }
+    if (sector) {
+        free(sector);
+    }
+    return ret;
+}
+
+void HUB8735FatFS::sd_upgrade(void) {
+    printf("sd_upgrade enter\r\n");
+    if (upgrade("hub8735.bin") == SD_UPGRADE_OK) {
+        printf("[%s] Delete file & Hold system, please reset board\r\n", __FUNCTION__);
+        while (1);
+    }
 }
 
 int HUB8735FatFS::status(void) {
@@ -15,6 +15,32 @@ extern "C" {
 
 #include "HUB8735FatFSFile.h"
 
+#define SD_UPGRADE_OK                   0
+#define SD_UPGRADE_NO_FILE              -1
+#define SD_UPGRADE_BAD_IMAGE            -2      // empty, too large, or not matching its .sha256 file
+#define SD_UPGRADE_READ_FAIL            -3
+#define SD_UPGRADE_VERIFY_FAIL          -4      // flash does not hold the image after programming
+#define SD_UPGRADE_NO_MEMORY            -5
+
+#define SD_UPGRADE_PHASE_HASH           0
+#define SD_UPGRADE_PHASE_PROGRAM        1
+#define SD_UPGRADE_PHASE_VERIFY         2
+
+// SD reads are double buffered in chunks of this size against flash erase and program
+#define SD_UPGRADE_CHUNK_SIZE           (32 * 1024)
+#define SD_UPGRADE_MAX_SIZE             (256 * 64 * 1024)
+
+typedef struct {
+    uint8_t phase;
+    uint32_t total;         // bytes in the image
+    uint32_t done;          // bytes through the current phase
+    uint32_t written;       // bytes erased and programmed
+    uint32_t skipped;       // bytes already in flash, left alone
+    uint32_t rate;          // bytes per second in the current phase
+} sd_upgrade_progress_t;
+
+typedef void (*sd_upgrade_cb_t)(const sd_upgrade_progress_t* progress);
+
 class HUB8735FatFS {
     public:
         HUB8735FatFS(void);
@@ -52,7 +78,17 @@ class HUB8735FatFS {
 
         int status(void);
 		void sd_upgrade(void);
-		
+
+        // Program the flash from an image on the SD card, returns one of SD_UPGRADE_*
+        // The image is written in place over the running firmware, there is no second slot to fall
+        // back to. Resuming only covers an upgrade that stopped while the device can still boot,
+        // such as a card read error or a reset before any firmware sector was changed: power loss
+        // while the firmware is being programmed can leave the board unbootable, and it then has to
+        // be recovered over UART in download mode. When it is called again, sectors that already
+        // hold the right data are skipped and programming resumes near where it stopped. The image
+        // and its progress file are deleted once the whole flash image digest has been verified.
+        int upgrade(const char* filename = "hub8735.bin", sd_upgrade_cb_t callback = NULL);
+
     private:
         int getAttribute(char *path, unsigned char *attr);
 
@@ -0,0 +1,84 @@
+/*
+ Shares one SPI bus between a flash memory and an ADC with different settings.
+
+ The flash is read in the background: each read is a command job followed
+ by a data job, submitted together so the SPI bus thread runs them back to
+ back with the chip select held low in between. Large transfers use DMA, and
+ the callback of each block submits the read of the next one. Meanwhile
+ loop() reads the ADC with blocking transfers, which wait for the bus and
+ switch the clock and mode as needed.
+
+ The commands below are for a W25Qxx flash and an MCP3008 ADC, change the
+ chip select pins to match your wiring.
+ */
+
+#include <SPI.h>
+
+#define FLASH_CS        12
+#define ADC_CS          13
+#define FLASH_READ      0x03
+#define BLOCK_SIZE      1024
+
+SPIDevice flash(FLASH_CS, 20000000, SPI_DATA_MODE0);
+SPIDevice adc(ADC_CS, 1000000, SPI_DATA_MODE0);
+
+uint8_t readCmd[4];
+// buffers that fill whole 32 byte cache lines are received by DMA
+uint8_t block[BLOCK_SIZE] __attribute__((aligned(32)));
+SPIJob cmdJob;
+SPIJob dataJob;
+
+uint32_t address = 0;
+volatile uint32_t blocks = 0;
+volatile uint32_t errors = 0;
+
+void readBlock(void) {
+    readCmd[0] = FLASH_READ;
+    readCmd[1] = (address >> 16) & 0xFF;
+    readCmd[2] = (address >> 8) & 0xFF;
+    readCmd[3] = address & 0xFF;
+    address = (address + BLOCK_SIZE) & 0xFFFFF;
+    SPI.submit(cmdJob);
+    SPI.submit(dataJob);
+}
+
+void onBlock(SPIJob& job) {
+    // runs on the bus thread, keep it short
+    if (job.done()) {
+        blocks++;
+    } else {
+        errors++;
+    }
+    readBlock();
+}
+
+void setup() {
+    Serial.begin(115200);
+    SPI.begin();
+    SPI.beginDevice(flash);
+    SPI.beginDevice(adc);
+
+    cmdJob.write(flash, readCmd, sizeof(readCmd));
+    cmdJob.keepSelected();
+    dataJob.read(flash, block, sizeof(block));
+    dataJob.onComplete(onBlock);
+    readBlock();
+}
+
+void loop() {
+    // single ended channel 0
+    uint8_t tx[3] = {0x01, 0x80, 0x00};
+    uint8_t rx[3];
+
+    if (SPI.transfer(adc, tx, rx, sizeof(tx))) {
+        Serial.print("ADC: ");
+        Serial.print(((rx[1] & 0x03) << 8) | rx[2]);
+    }
+    Serial.print(", flash blocks read: ");
+    Serial.print(blocks);
+    Serial.print(" (");
+    Serial.print(errors);
+    Serial.println(" failed)");
+
+    delay(100);
+}
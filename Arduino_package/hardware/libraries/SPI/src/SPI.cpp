@@ -15,6 +15,13 @@
 spi_t spi_obj0;
 spi_t spi_obj1;
 
+// Longest single stream, a multiple of the cache line so DMA chunks stay aligned
+#define SPI_STREAM_CHUNK 4064
+
+#define SPI_IRQ_NONE 0
+#define SPI_IRQ_RX   1
+#define SPI_IRQ_TX   2
+
 SPIClass::SPIClass(spi_t *pSpiObj, int mosi_pin, int miso_pin, int clk_pin, int ss_pin) {
     pSpiMaster = pSpiObj;
     pSpiSlave = pSpiObj;
@@ -32,6 +39,21 @@ SPIClass::SPIClass(spi_t *pSpiObj, int mosi_pin, int miso_pin, int clk_pin, int
     // _pinUserSS = -1;
 
     _SPI_Mode = SPI_MODE_MASTER;
+
+    _shared = false;
+    _busLock = 0;
+    _busOwner = 0;
+    _busDepth = 0;
+    _busClock = 0;
+    _busMode = 0;
+    _transaction = NULL;
+    _doneSignal = 0;
+    _expectIrq = SPI_IRQ_NONE;
+    _queueLock = 0;
+    _jobSignal = 0;
+    _jobThreadId = 0;
+    _jobQueue = NULL;
+    _jobRunning = NULL;
 }
 
 void SPIClass::begin(void) {
@@ -54,6 +76,18 @@ void SPIClass::begin(void) {
     );
     spi_format(pSpiMaster, _dataBits, _dataMode, 0);
     spi_frequency(pSpiMaster, _defaultFrequency);
+    _busClock = 0;
+
+    if (_busLock == 0) {
+        _busLock = os_semaphore_create_arduino(1);
+        _queueLock = os_semaphore_create_arduino(1);
+        _jobSignal = os_semaphore_create_arduino(1);
+        os_semaphore_wait_arduino(_jobSignal, 0);
+        _doneSignal = os_semaphore_create_arduino(1);
+        os_semaphore_wait_arduino(_doneSignal, 0);
+    }
+    spi_irq_hook(pSpiMaster, rxDoneIrq, (uint32_t)this);
+    spi_bus_tx_done_irq_hook(pSpiMaster, txDoneIrq, (uint32_t)this);
 
     // Mark SPI init status
     initStatus = true;
@@ -81,6 +115,18 @@ void SPIClass::begin(int ss_pin) {
     );
     spi_format(pSpiMaster, _dataBits, _dataMode, 0);
     spi_frequency(pSpiMaster, _defaultFrequency);
+    _busClock = 0;
+
+    if (_busLock == 0) {
+        _busLock = os_semaphore_create_arduino(1);
+        _queueLock = os_semaphore_create_arduino(1);
+        _jobSignal = os_semaphore_create_arduino(1);
+        os_semaphore_wait_arduino(_jobSignal, 0);
+        _doneSignal = os_semaphore_create_arduino(1);
+        os_semaphore_wait_arduino(_doneSignal, 0);
+    }
+    spi_irq_hook(pSpiMaster, rxDoneIrq, (uint32_t)this);
+    spi_bus_tx_done_irq_hook(pSpiMaster, txDoneIrq, (uint32_t)this);
 
     // Mark SPI init status
     initStatus = true;
@@ -171,6 +217,8 @@ void SPIClass::beginTransaction(uint8_t ss_pin, SPISettings settings) {
 #endif
 
     spi_frequency(pSpiMaster, settings._clockSetting);
+    // the next device transfer programs its own settings again
+    _busClock = 0;
 }
 
 void SPIClass::beginTransaction(SPISettings settings) {
@@ -182,37 +230,55 @@ void SPIClass::endTransaction(void) {
     //     digitalWrite(_pinUserSS, 1);
     //     _pinUserSS = -1;
     // }
+    if ((_transaction != NULL) && (_busOwner == os_thread_get_id_arduino())) {
+        if (_busDepth == 1) {
+            deselectDevice(_transaction);
+            _transaction = NULL;
+        }
+        unlockBus();
+    }
 }
 
 byte SPIClass::transfer(uint8_t data, SPITransferMode mode) { // transfer 1 byte data without SS
+    int ret;
+
     (void)mode;
-    spi_master_write(pSpiMaster, data);
+    lockBus();
+    ret = spi_master_write(pSpiMaster, data);
+    unlockBus();
     //printf("\r\n[INFO] Master write: %02X\n", _data);
-    return 0;
+    return (byte)ret;
 }
 
 byte SPIClass::transfer(byte pin, uint8_t data, SPITransferMode mode) { // transfer 1 byte data with SS
+    int ret;
+
+    lockBus();
     if (pin != _pinSS) {
         pinMode(pin, OUTPUT);
         digitalWrite(pin, 0);
     }
-    spi_master_write(pSpiMaster, data);
+    ret = spi_master_write(pSpiMaster, data);
     //printf("\r\n[INFO] Master write: %02X\n", _data);
+    unlockBus();
 
-    return 0;
+    return (byte)ret;
 }
 
 void SPIClass::transfer(byte pin, void *buf, SIZE_T count, SPITransferMode mode) {
+    lockBus();
     if (pin != _pinSS) {
         pinMode(pin, OUTPUT);
         digitalWrite(pin, 0);
     }
 
-    spi_master_write_read_stream(pSpiMaster, (char *)buf, (char *)buf, (uint32_t) count);
+    // wait for the stream, the caller reuses the buffer as soon as this returns
+    stream((const uint8_t *)buf, (uint8_t *)buf, count);
 
     if ((pin != _pinSS) && (mode == SPI_LAST)) {
         digitalWrite(pin, 1);
     }
+    unlockBus();
 }
 
 void SPIClass::transfer(void *buf, SIZE_T count, SPITransferMode mode) {
@@ -268,7 +334,10 @@ void SPIClass::setDataMode(uint8_t bits, uint8_t dataMode, char SPI_mode) {
     
     if (initStatus) {
         if (_SPI_Mode == SPI_MODE_MASTER) {
+            lockBus();
             spi_format(pSpiMaster, _dataBits, _dataMode, 0);
+            _busClock = 0;
+            unlockBus();
         } else if (_SPI_Mode == SPI_MODE_SLAVE) {
             spi_format(pSpiSlave, _dataBits, _dataMode, 1);
         }
@@ -300,6 +369,437 @@ void SPIClass::end(char SPI_mode) {
      }
 }
 
+SPIDevice::SPIDevice(int csPin, uint32_t clock, uint8_t dataMode) {
+    _csPin = csPin;
+    _clock = clock;
+    _dataMode = dataMode;
+    _csReady = false;
+}
+
+void SPIDevice::setClock(uint32_t clock) {
+    _clock = clock;
+}
+
+void SPIDevice::setDataMode(uint8_t dataMode) {
+    _dataMode = dataMode;
+}
+
+void SPIDevice::setCSPin(int csPin) {
+    _csPin = csPin;
+    _csReady = false;
+}
+
+SPIJob::SPIJob(void) {
+    _device = NULL;
+    _txData = NULL;
+    _rxData = NULL;
+    _count = 0;
+    _length = 0;
+    _keep = false;
+    _callback = NULL;
+    _arg = NULL;
+    _status = SPI_JOB_IDLE;
+    _queued = false;
+    _next = NULL;
+}
+
+void SPIJob::transfer(SPIDevice& device, const void* txData, void* rxData, size_t length) {
+    _device = &device;
+    _txData = (const uint8_t*)txData;
+    _rxData = (uint8_t*)rxData;
+    _count = ((txData != NULL) || (rxData != NULL)) ? length : 0;
+}
+
+void SPIJob::write(SPIDevice& device, const void* data, size_t length) {
+    transfer(device, data, NULL, length);
+}
+
+void SPIJob::read(SPIDevice& device, void* data, size_t length) {
+    transfer(device, NULL, data, length);
+}
+
+void SPIJob::keepSelected(bool keep) {
+    _keep = keep;
+}
+
+void SPIJob::onComplete(spi_job_cb_t callback, void* arg) {
+    _callback = callback;
+    _arg = arg;
+}
+
+void SPIClass::rxDoneIrq(uint32_t id, SpiIrq event) {
+    SPIClass* spi = (SPIClass*)id;
+
+    if ((event == SpiRxIrq) && (spi->_expectIrq == SPI_IRQ_RX)) {
+        spi->_expectIrq = SPI_IRQ_NONE;
+        os_semaphore_release_arduino(spi->_doneSignal);
+    }
+}
+
+// Raised once the last bit has left the bus, the tx FIFO interrupt comes earlier
+void SPIClass::txDoneIrq(uint32_t id, SpiIrq event) {
+    SPIClass* spi = (SPIClass*)id;
+
+    (void)event;
+    if (spi->_expectIrq == SPI_IRQ_TX) {
+        spi->_expectIrq = SPI_IRQ_NONE;
+        os_semaphore_release_arduino(spi->_doneSignal);
+    }
+}
+
+// Legacy calls only take the bus lock once a sketch shares the bus, so single device
+// sketches keep the cost of a byte transfer as it was
+void SPIClass::share(void) {
+    _shared = true;
+}
+
+void SPIClass::lockBus(void) {
+    uint32_t self;
+
+    if (!_shared || (_busLock == 0)) {
+        return;
+    }
+    self = os_thread_get_id_arduino();
+    if (_busOwner == self) {
+        _busDepth++;
+        return;
+    }
+    os_semaphore_wait_arduino(_busLock, 0xFFFFFFFF);
+    _busOwner = self;
+    _busDepth = 1;
+}
+
+void SPIClass::unlockBus(void) {
+    if ((_busOwner == 0) || (_busOwner != os_thread_get_id_arduino())) {
+        return;
+    }
+    if (--_busDepth == 0) {
+        _busOwner = 0;
+        os_semaphore_release_arduino(_busLock);
+    }
+}
+
+// Program the device settings if the bus has others, and pull its chip select low. Call with the bus locked.
+void SPIClass::selectDevice(SPIDevice* device) {
+    if ((device->_clock != _busClock) || (device->_dataMode != _busMode)) {
+        phal_ssi_adaptor_t phal_ssi_adaptor = &(pSpiMaster->hal_ssi_adaptor);
+        hal_spi_format(phal_ssi_adaptor, (8 - 1), device->_dataMode);
+        spi_frequency(pSpiMaster, device->_clock);
+        _busClock = device->_clock;
+        _busMode = device->_dataMode;
+    }
+    if (device->_csPin >= 0) {
+        if (!device->_csReady) {
+            pinMode(device->_csPin, OUTPUT);
+            device->_csReady = true;
+        }
+        digitalWrite(device->_csPin, 0);
+    }
+}
+
+void SPIClass::deselectDevice(SPIDevice* device) {
+    if (device->_csPin >= 0) {
+        digitalWrite(device->_csPin, 1);
+    }
+}
+
+// Start one stream and return without waiting, the completion interrupt releases doneSignal.
+// DMA only pays off past a few FIFO fills, and received data can only be written by DMA
+// to buffers that fill whole cache lines, otherwise the FIFO interrupt moves the data.
+bool SPIClass::startStream(const uint8_t* txData, uint8_t* rxData, size_t length) {
+    int32_t ret;
+    bool dma = (length >= SPI_DMA_MIN_LENGTH);
+
+    if ((rxData != NULL) && ((((uint32_t)rxData) | length) & 0x1F)) {
+        dma = false;
+    }
+    // a pending signal from an earlier stream that timed out
+    os_semaphore_wait_arduino(_doneSignal, 0);
+
+    if (rxData != NULL) {
+        _expectIrq = SPI_IRQ_RX;
+        if (txData != NULL) {
+            ret = dma ? spi_master_write_read_stream_dma(pSpiMaster, (char *)txData, (char *)rxData, length) : spi_master_write_read_stream(pSpiMaster, (char *)txData, (char *)rxData, length);
+        } else {
+            ret = dma ? spi_master_read_stream_dma(pSpiMaster, (char *)rxData, length) : spi_master_read_stream(pSpiMaster, (char *)rxData, length);
+        }
+    } else {
+        _expectIrq = SPI_IRQ_TX;
+        ret = dma ? spi_master_write_stream_dma(pSpiMaster, (char *)txData, length) : spi_master_write_stream(pSpiMaster, (char *)txData, length);
+    }
+    if (ret != HAL_OK) {
+        _expectIrq = SPI_IRQ_NONE;
+        printf("\r\n[ERROR] %s SPI stream start failed %ld\n", __FUNCTION__, ret);
+        return false;
+    }
+    return true;
+}
+
+bool SPIClass::waitStream(size_t length) {
+    uint32_t clock = (_busClock > 0) ? _busClock : _defaultFrequency;
+    // eight bits per byte at the bus clock, with a margin for the interrupt and task switch
+    uint32_t timeout = ((length * 8) / ((clock / 1000) + 1)) + 100;
+    bool write = (_expectIrq == SPI_IRQ_TX);
+
+    if (os_semaphore_wait_arduino(_doneSignal, timeout) != 1) {
+        _expectIrq = SPI_IRQ_NONE;
+        printf("\r\n[ERROR] %s SPI stream timeout\n", __FUNCTION__);
+        return false;
+    }
+    if (write) {
+        // a write only stream leaves what was received in the FIFO
+        spi_flush_rx_fifo(pSpiMaster);
+    }
+    return true;
+}
+
+// Blocking stream of any length. Call with the bus locked.
+bool SPIClass::stream(const uint8_t* txData, uint8_t* rxData, size_t length) {
+    size_t done = 0;
+    size_t chunk;
+
+    if (!initStatus || (_doneSignal == 0)) {
+        printf("\r\n[ERROR] %s call begin() first\n", __FUNCTION__);
+        return false;
+    }
+    while (done < length) {
+        chunk = ((length - done) > SPI_STREAM_CHUNK) ? SPI_STREAM_CHUNK : (length - done);
+        if (!startStream(((txData != NULL) ? (txData + done) : NULL), ((rxData != NULL) ? (rxData + done) : NULL), chunk)) {
+            return false;
+        }
+        if (!waitStream(chunk)) {
+            return false;
+        }
+        done += chunk;
+    }
+    return true;
+}
+
+void SPIClass::beginDevice(SPIDevice& device) {
+    if (_busLock == 0) {
+        printf("\r\n[ERROR] %s call begin() first\n", __FUNCTION__);
+        return;
+    }
+    share();
+    if (device._csPin >= 0) {
+        pinMode(device._csPin, OUTPUT);
+        digitalWrite(device._csPin, 1);
+        device._csReady = true;
+    }
+}
+
+bool SPIClass::transfer(SPIDevice& device, const void* txData, void* rxData, size_t length) {
+    bool ret;
+
+    if ((txData == NULL) && (rxData == NULL)) {
+        return (length == 0);
+    }
+    share();
+    lockBus();
+    selectDevice(&device);
+    ret = stream((const uint8_t*)txData, (uint8_t*)rxData, length);
+    // stay selected inside beginTransaction() for the same device
+    if (_transaction != &device) {
+        deselectDevice(&device);
+    }
+    unlockBus();
+    return ret;
+}
+
+void SPIClass::beginTransaction(SPIDevice& device) {
+    share();
+    lockBus();
+    if ((_transaction != NULL) && (_transaction != &device)) {
+        deselectDevice(_transaction);
+    }
+    _transaction = &device;
+    selectDevice(&device);
+}
+
+// Start the first or next chunk of a job, returns its length or 0 on failure. Call with the bus locked.
+size_t SPIClass::startJob(SPIJob* job) {
+    size_t chunk = job->_count - job->_length;
+
+    if (chunk > SPI_STREAM_CHUNK) {
+        chunk = SPI_STREAM_CHUNK;
+    }
+    if (job->_length == 0) {
+        selectDevice(job->_device);
+    }
+    if (!startStream(((job->_txData != NULL) ? (job->_txData + job->_length) : NULL), ((job->_rxData != NULL) ? (job->_rxData + job->_length) : NULL), chunk)) {
+        return 0;
+    }
+    return chunk;
+}
+
+SPIJob* SPIClass::takeJob(void) {
+    SPIJob* job;
+
+    os_semaphore_wait_arduino(_queueLock, 0xFFFFFFFF);
+    job = _jobQueue;
+    if (job != NULL) {
+        _jobQueue = job->_next;
+        job->_next = NULL;
+    }
+    _jobRunning = job;
+    os_semaphore_release_arduino(_queueLock);
+    return job;
+}
+
+// Call with queueLock held
+bool SPIClass::unlink(SPIJob* job) {
+    SPIJob** link = &_jobQueue;
+
+    while (*link != NULL) {
+        if (*link == job) {
+            *link = job->_next;
+            job->_next = NULL;
+            return true;
+        }
+        link = &((*link)->_next);
+    }
+    return false;
+}
+
+// Jobs are pipelined: as soon as one completes the next queued job is started, and the
+// finished job's callback runs while the next transfer is on the bus. The bus stays locked
+// from the first job to the last one of a run, so blocking calls from other tasks wait.
+void SPIClass::jobThread(const void *argument) {
+    SPIClass* spi = (SPIClass*)argument;
+    SPIJob* job = NULL;
+    SPIJob* next;
+    size_t chunk = 0;
+    bool ok;
+
+    while (1) {
+        if (job == NULL) {
+            job = spi->takeJob();
+            if (job == NULL) {
+                os_semaphore_wait_arduino(spi->_jobSignal, 0xFFFFFFFF);
+                continue;
+            }
+            spi->lockBus();
+            chunk = spi->startJob(job);
+        }
+
+        ok = (chunk > 0) && spi->waitStream(chunk);
+        if (ok) {
+            job->_length += chunk;
+            if (job->_length < job->_count) {
+                chunk = spi->startJob(job);
+                continue;
+            }
+        }
+
+        next = spi->takeJob();
+        if (!ok || !job->_keep || (next == NULL) || (next->_device != job->_device)) {
+            spi->deselectDevice(job->_device);
+        }
+        if (next != NULL) {
+            chunk = spi->startJob(next);
+        } else {
+            spi->unlockBus();
+        }
+
+        // the callback may submit the job again
+        os_semaphore_wait_arduino(spi->_queueLock, 0xFFFFFFFF);
+        job->_status = ok ? SPI_JOB_DONE : SPI_JOB_FAILED;
+        job->_queued = false;
+        os_semaphore_release_arduino(spi->_queueLock);
+        if (job->_callback != NULL) {
+            job->_callback(*job);
+        }
+        job = next;
+    }
+}
+
+bool SPIClass::submit(SPIJob& job) {
+    SPIJob** link;
+
+    if (_queueLock == 0) {
+        printf("\r\n[ERROR] %s call begin() first\n", __FUNCTION__);
+        return false;
+    }
+    if (job._queued || (job._device == NULL) || (job._count == 0)) {
+        return false;
+    }
+    share();
+    if (_jobThreadId == 0) {
+        _jobThreadId = os_thread_create_arduino(jobThread, this, OS_PRIORITY_ABOVENORMAL, 2048);
+        if (_jobThreadId == 0) {
+            printf("\r\n[ERROR] %s SPI job thread create failed\n", __FUNCTION__);
+            return false;
+        }
+    }
+
+    os_semaphore_wait_arduino(_queueLock, 0xFFFFFFFF);
+    job._status = SPI_JOB_PENDING;
+    job._length = 0;
+    job._queued = true;
+    link = &_jobQueue;
+    while (*link != NULL) {
+        link = &((*link)->_next);
+    }
+    *link = &job;
+    os_semaphore_release_arduino(_queueLock);
+    os_semaphore_release_arduino(_jobSignal);
+    return true;
+}
+
+bool SPIClass::cancel(SPIJob& job) {
+    bool running;
+
+    if (_queueLock == 0) {
+        return false;
+    }
+    os_semaphore_wait_arduino(_queueLock, 0xFFFFFFFF);
+    if (!job._queued) {
+        os_semaphore_release_arduino(_queueLock);
+        return false;
+    }
+    running = (_jobRunning == &job);
+    if (!running && unlink(&job)) {
+        job._queued = false;
+        job._status = SPI_JOB_IDLE;
+    }
+    os_semaphore_release_arduino(_queueLock);
+
+    // the buffers are in use until the transfer ends, unless cancelled from a job callback
+    while (running && (_jobRunning == &job) && (os_thread_get_id_arduino() != _jobThreadId)) {
+        delay(1);
+    }
+    return true;
+}
+
+bool SPIClass::wait(SPIJob& job, uint32_t timeout) {
+    uint32_t start = millis();
+
+    while (job._queued) {
+        if ((millis() - start) >= timeout) {
+            return false;
+        }
+        delay(1);
+    }
+    return job.done();
+}
+
+uint8_t SPIClass::queued(void) {
+    uint8_t count = 0;
+
+    if (_queueLock == 0) {
+        return 0;
+    }
+    os_semaphore_wait_arduino(_queueLock, 0xFFFFFFFF);
+    for (SPIJob* job = _jobQueue; job != NULL; job = job->_next) {
+        count++;
+    }
+    if (_jobRunning != NULL) {
+        count++;
+    }
+    os_semaphore_release_arduino(_queueLock);
+    return count;
+}
+
 //SPIClass SPI((&spi_obj0), SPI_MOSI, SPI_MISO, SPI_SCLK, SPI_SS);
 SPIClass SPI((&spi_obj0), 8, 10, 9, 7);
 //SPIClass SPI1((&spi_obj1), SPI1_MOSI, SPI1_MISO, SPI1_SCLK, SPI1_SS);
@@ -58,11 +58,85 @@ extern "C" {
 
 #define SPI_DEFAULT_FREQ 200000
 
+#define SPI_JOB_IDLE       0
+#define SPI_JOB_PENDING    1       // queued or on the bus
+#define SPI_JOB_DONE       2
+#define SPI_JOB_FAILED     3
+
+// Transfers of at least this many bytes use DMA, shorter ones the FIFO interrupt
+#define SPI_DMA_MIN_LENGTH 32
+
 enum SPITransferMode {
     SPI_CONTINUE,
     SPI_LAST
 };
 
+class SPIClass;
+class SPIJob;
+
+// Called from the bus thread when a job completes, while the next job is already on the bus.
+// Use submit() from the callback, the blocking transfer calls would wait for the bus thread itself.
+typedef void (*spi_job_cb_t)(SPIJob& job);
+
+// Bus settings and chip select of one device sharing an SPI bus. Transfers through a device
+// reprogram the bus only when the previous transfer was for a device with other settings.
+class SPIDevice {
+    public:
+        SPIDevice(int csPin = -1, uint32_t clock = 4000000, uint8_t dataMode = SPI_DATA_MODE0);
+
+        void setClock(uint32_t clock);
+        void setDataMode(uint8_t dataMode);
+        void setCSPin(int csPin);
+
+    private:
+        friend class SPIClass;
+
+        int _csPin;                 // -1 if the hardware SS pin or the caller selects the device
+        uint32_t _clock;
+        uint8_t _dataMode;
+        bool _csReady;
+};
+
+// One transfer run in the background by SPIClass::submit(). The job and its buffers belong to
+// the caller and must stay valid until the job is no longer pending. Jobs run in the order they
+// were submitted, a job marked keepSelected() leaves its device selected if the next job is for
+// the same device, so a command and its data can be split into two jobs.
+class SPIJob {
+    public:
+        SPIJob(void);
+
+        // Either buffer may be NULL for a write only or read only transfer
+        void transfer(SPIDevice& device, const void* txData, void* rxData, size_t length);
+        void write(SPIDevice& device, const void* data, size_t length);
+        void read(SPIDevice& device, void* data, size_t length);
+        void keepSelected(bool keep = true);
+        void onComplete(spi_job_cb_t callback, void* arg = NULL);
+
+        uint8_t status(void) { return _status; }
+        bool pending(void) { return (_status == SPI_JOB_PENDING); }
+        bool done(void) { return (_status == SPI_JOB_DONE); }
+        bool failed(void) { return (_status == SPI_JOB_FAILED); }
+        // Bytes transferred, less than requested if the job failed
+        size_t length(void) { return _length; }
+        void* arg(void) { return _arg; }
+
+    private:
+        friend class SPIClass;
+
+        SPIDevice* _device;
+        const uint8_t* _txData;
+        uint8_t* _rxData;
+        size_t _count;
+        size_t _length;
+        bool _keep;
+        spi_job_cb_t _callback;
+        void* _arg;
+
+        volatile uint8_t _status;
+        bool _queued;
+        SPIJob* _next;
+};
+
 class SPISettings {
     public:
         SPISettings(uint32_t clock, BitOrder bitOrder, uint8_t dataMode) {
@@ -134,7 +208,53 @@ class SPIClass {
         // Set default SPI frequency
         void setDefaultFrequency(int frequency);
 
+        // Shared bus use, safe between tasks: each call holds the bus for its whole transfer
+        void beginDevice(SPIDevice& device);
+        // Blocking transfer to one device, returns false on a timeout
+        bool transfer(SPIDevice& device, const void* txData, void* rxData, size_t length);
+        // Hold the bus and select the device until endTransaction(), plain transfer() calls in between go to it
+        void beginTransaction(SPIDevice& device);
+
+        // Queue a job on the bus thread, jobs run back to back in submission order
+        bool submit(SPIJob& job);
+        // Take a job off the queue, waits for it if it is on the bus
+        bool cancel(SPIJob& job);
+        // Wait for a job to complete, returns true if it succeeded
+        bool wait(SPIJob& job, uint32_t timeout = 1000);
+        uint8_t queued(void);
+
     private:
+        static void jobThread(const void *argument);
+        static void rxDoneIrq(uint32_t id, SpiIrq event);
+        static void txDoneIrq(uint32_t id, SpiIrq event);
+        void share(void);
+        void lockBus(void);
+        void unlockBus(void);
+        void selectDevice(SPIDevice* device);
+        void deselectDevice(SPIDevice* device);
+        bool startStream(const uint8_t* txData, uint8_t* rxData, size_t length);
+        bool waitStream(size_t length);
+        bool stream(const uint8_t* txData, uint8_t* rxData, size_t length);
+        size_t startJob(SPIJob* job);
+        SPIJob* takeJob(void);
+        bool unlink(SPIJob* job);
+
+        bool _shared;               // device, transaction or job calls made, lock the bus for every call
+        uint32_t _busLock;
+        volatile uint32_t _busOwner;
+        uint32_t _busDepth;
+        uint32_t _busClock;         // settings the bus has, 0 after a legacy call changed them
+        uint8_t _busMode;
+        SPIDevice* _transaction;
+        uint32_t _doneSignal;       // released by the completion interrupt
+        volatile uint8_t _expectIrq;
+
+        uint32_t _queueLock;
+        uint32_t _jobSignal;
+        uint32_t _jobThreadId;
+        SPIJob* _jobQueue;
+        SPIJob* volatile _jobRunning;
+
         spi_t *pSpiMaster;
         spi_t *pSpiSlave;
         
@@ -0,0 +1,126 @@
+/*
+ This example pushes object detection results and camera snapshots to
+ browser dashboards over WebSocket instead of having them poll over HTTP.
+
+ Connect to ws://<board IP>:81/ from a dashboard. Each detection run arrives
+ as a JSON text message, e.g.
+ {"seq":12,"ms":34567,"results":[{"type":0,"name":"person","score":87,"box":[0.120,0.300,0.450,0.980]}]}
+ and snapshots arrive as binary JPEG messages.
+
+ With WS_COALESCE a dashboard on a slow link only ever has the newest result
+ set and the newest snapshot waiting for it, the NN callback never blocks.
+ */
+
+#include "WiFi.h"
+#include "VideoStream.h"
+#include "StreamIO.h"
+#include "NNObjectDetection.h"
+#include "WebSocketServer.h"
+#include "WebSocketNN.h"
+
+#define CHANNELJPEG 0
+#define CHANNELNN   3
+
+// Lower resolution for NN processing
+#define NNWIDTH  576
+#define NNHEIGHT 320
+
+#define SNAPSHOT_INTERVAL 200
+
+VideoSetting configJPEG(VIDEO_VGA, 10, VIDEO_JPEG, 1);
+VideoSetting configNN(NNWIDTH, NNHEIGHT, 10, VIDEO_RGB, 0);
+NNObjectDetection ObjDet;
+StreamIO videoStreamerNN(1, 1);
+WebSocketServer ws(81);
+WebSocketNN wsnn(ws);
+
+char ssid[] = "Network_SSID";   // your network SSID (name)
+char pass[] = "Password";       // your network password
+int status = WL_IDLE_STATUS;
+
+uint32_t lastSnapshot = 0;
+uint32_t lastInfo = 0;
+
+void onWebSocketEvent(WebSocketEvent event, uint8_t id, const uint8_t* data, uint32_t len) {
+    switch (event) {
+        case WS_EVENT_CONNECT:
+            Serial.print("Dashboard connected: ");
+            Serial.println(ws.remoteIP(id));
+            break;
+        case WS_EVENT_DISCONNECT:
+            Serial.println("Dashboard disconnected");
+            break;
+        case WS_EVENT_TEXT:
+            Serial.print("Dashboard says: ");
+            Serial.println((const char*)data);
+            break;
+        default:
+            break;
+    }
+}
+
+// Runs in the NN thread, publishing only queues the results
+void ODPostProcess(std::vector<ObjectDetectionResult> results) {
+    wsnn.publishResults(results);
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to WPA SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+        delay(2000);
+    }
+
+    Camera.configVideoChannel(CHANNELJPEG, configJPEG);
+    Camera.configVideoChannel(CHANNELNN, configNN);
+    Camera.videoInit();
+
+    ObjDet.configVideo(configNN);
+    ObjDet.setResultCallback(ODPostProcess);
+    ObjDet.modelSelect(OBJECT_DETECTION, DEFAULT_YOLOV4TINY, NA_MODEL, NA_MODEL);
+    ObjDet.begin();
+
+    videoStreamerNN.registerInput(Camera.getStream(CHANNELNN));
+    videoStreamerNN.setStackSize();
+    videoStreamerNN.setTaskPriority();
+    videoStreamerNN.registerOutput(ObjDet);
+    if (videoStreamerNN.begin() != 0) {
+        Serial.println("StreamIO link start failed");
+    }
+
+    Camera.channelBegin(CHANNELJPEG);
+    Camera.channelBegin(CHANNELNN);
+
+    // keep at most 4 messages per dashboard and replace stale ones with the newest
+    ws.setBackpressure(WS_COALESCE, 4, (256 * 1024));
+    ws.setPingInterval(10000);
+    ws.onEvent(onWebSocketEvent);
+    if (!ws.begin()) {
+        Serial.println("WebSocket server start failed");
+    }
+
+    Serial.print("Dashboards connect to ws://");
+    Serial.print(WiFi.localIP());
+    Serial.println(":81/");
+}
+
+void loop() {
+    uint32_t addr = 0;
+    uint32_t len = 0;
+
+    if ((ws.clientCount() > 0) && ((millis() - lastSnapshot) >= SNAPSHOT_INTERVAL)) {
+        lastSnapshot = millis();
+        Camera.getImage(CHANNELJPEG, &addr, &len);
+        if (len > 0) {
+            wsnn.publishJPEG(addr, len);
+        }
+    }
+    if ((millis() - lastInfo) >= 10000) {
+        lastInfo = millis();
+        ws.printInfo();
+    }
+    delay(10);
+}
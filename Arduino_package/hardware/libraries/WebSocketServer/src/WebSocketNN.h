@@ -0,0 +1,91 @@
+#ifndef WebSocketNN_h
+#define WebSocketNN_h
+
+#include "WebSocketServer.h"
+
+#undef min
+#undef max
+#include <vector>
+
+// message tags, WS_COALESCE keeps only the newest result set and snapshot per client
+#define WS_NN_TAG_RESULTS               1
+#define WS_NN_TAG_JPEG                  2
+// JSON bytes reserved per result
+#define WS_NN_RESULT_SIZE               128
+
+// Publishes NeuralNetwork results as JSON text and camera snapshots as binary
+// JPEG messages. Works with any result type of the NeuralNetwork library
+// (ObjectDetectionResult, FaceDetectionResult, FaceRecognitionResult, ...)
+// without linking it into sketches that do not use it.
+//
+// {"seq":12,"ms":34567,"results":[{"type":0,"name":"person","score":87,"box":[0.120,0.300,0.450,0.980]}]}
+// box is xMin, yMin, xMax, yMax as fractions of the frame, type and score are
+// left out for result types without them.
+class WebSocketNN {
+    public:
+        WebSocketNN(WebSocketServer& server) : _server(server), _seq(0) {}
+
+        // Returns the number of clients the results were queued for
+        template <typename T>
+        int publishResults(std::vector<T>& results) {
+            uint32_t size = 64 + (results.size() * WS_NN_RESULT_SIZE);
+            char* json;
+            uint32_t n;
+            int ret;
+
+            // nothing is formatted while no dashboard is connected
+            if (_server.clientCount() == 0) {
+                return 0;
+            }
+            json = (char*)malloc(size);
+            if (json == NULL) {
+                return 0;
+            }
+            n = snprintf(json, size, "{\"seq\":%lu,\"ms\":%lu,\"results\":[", _seq++, millis());
+            for (uint32_t i = 0; i < results.size(); i++) {
+                T& item = results[i];
+                uint32_t start = n;
+                n += snprintf((json + n), (size - n), "%s{", (i ? "," : ""));
+                n += appendType((json + n), (size - n), item, 0);
+                n += appendScore((json + n), (size - n), item, 0);
+                n += snprintf((json + n), (size - n), "\"name\":\"%s\",\"box\":[%.3f,%.3f,%.3f,%.3f]}", item.name(), item.xMin(), item.yMin(), item.xMax(), item.yMax());
+                if (n >= (size - 3)) {
+                    // drop the result that did not fit so the JSON stays valid
+                    n = start;
+                    break;
+                }
+            }
+            snprintf((json + n), (size - n), "]}");
+            ret = _server.broadcastText(json, WS_NN_TAG_RESULTS);
+            free(json);
+            return ret;
+        }
+
+        // Send an encoded frame, i.e. from Camera.getImage(CHANNEL, &addr, &len)
+        int publishJPEG(uint32_t addr, uint32_t len) {
+            return _server.broadcastBinary((const uint8_t*)addr, len, WS_NN_TAG_JPEG);
+        }
+
+    private:
+        template <typename T>
+        static auto appendType(char* buf, uint32_t size, T& item, int) -> decltype(item.type(), uint32_t()) {
+            return snprintf(buf, size, "\"type\":%d,", item.type());
+        }
+        template <typename T>
+        static uint32_t appendType(char* buf, uint32_t size, T& item, long) {
+            return 0;
+        }
+        template <typename T>
+        static auto appendScore(char* buf, uint32_t size, T& item, int) -> decltype(item.score(), uint32_t()) {
+            return snprintf(buf, size, "\"score\":%d,", item.score());
+        }
+        template <typename T>
+        static uint32_t appendScore(char* buf, uint32_t size, T& item, long) {
+            return 0;
+        }
+
+        WebSocketServer& _server;
+        uint32_t _seq;
+};
+
+#endif
@@ -0,0 +1,894 @@
+#include "WebSocketServer.h"
+
+// room for the largest frame plus its header, or a handshake request with cookies
+#define WS_SERVER_RX_BUFFER_SIZE        (WS_SERVER_MAX_RX_MESSAGE + 1024)
+#define WS_SERVER_HANDSHAKE_TIMEOUT     5000
+#define WS_SERVER_CLOSE_TIMEOUT         1000
+#define WS_SERVER_END_TIMEOUT           3000
+
+#define WS_CLIENT_FREE                  0
+#define WS_CLIENT_HANDSHAKE             1
+#define WS_CLIENT_OPEN                  2
+#define WS_CLIENT_CLOSING               3
+
+#define WS_OPCODE_CONTINUATION          0x0
+#define WS_OPCODE_TEXT                  0x1
+#define WS_OPCODE_BINARY                0x2
+#define WS_OPCODE_CLOSE                 0x8
+#define WS_OPCODE_PING                  0x9
+#define WS_OPCODE_PONG                  0xA
+
+#define WS_CLOSE_NORMAL                 1000
+#define WS_CLOSE_PROTOCOL_ERROR         1002
+#define WS_CLOSE_UNSUPPORTED            1003
+#define WS_CLOSE_TOO_BIG                1009
+
+static const char ws_guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+static const char ws_b64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static WebSocketServer* ws_servers[WS_SERVER_MAX_INSTANCES];
+
+//-----------------------------------------------------------------------------
+// Handshake helpers, the accept key is base64(SHA-1(key + GUID))
+
+static uint32_t ws_rol(uint32_t value, int bits) {
+    return ((value << bits) | (value >> (32 - bits)));
+}
+
+static void ws_sha1_block(uint32_t* h, const uint8_t* p) {
+    uint32_t w[80];
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) | ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = ws_rol((w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16]), 1);
+    }
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | ((~b) & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t t = ws_rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ws_rol(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+static void ws_sha1(const uint8_t* data, uint32_t len, uint8_t* digest) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    uint8_t block[64];
+    uint64_t bits = (uint64_t)len * 8;
+    uint32_t i;
+
+    for (i = 0; (i + 64) <= len; i += 64) {
+        ws_sha1_block(h, (data + i));
+    }
+    memset(block, 0, sizeof(block));
+    memcpy(block, (data + i), (len - i));
+    block[len - i] = 0x80;
+    if ((len - i) >= 56) {
+        ws_sha1_block(h, block);
+        memset(block, 0, sizeof(block));
+    }
+    for (int j = 0; j < 8; j++) {
+        block[63 - j] = (uint8_t)(bits >> (8 * j));
+    }
+    ws_sha1_block(h, block);
+    for (int j = 0; j < 20; j++) {
+        digest[j] = (uint8_t)(h[j / 4] >> (24 - 8 * (j % 4)));
+    }
+}
+
+static void ws_base64(const uint8_t* data, uint32_t len, char* out) {
+    uint32_t i;
+
+    for (i = 0; (i + 2) < len; i += 3) {
+        *out++ = ws_b64_table[data[i] >> 2];
+        *out++ = ws_b64_table[((data[i] & 0x03) << 4) | (data[i + 1] >> 4)];
+        *out++ = ws_b64_table[((data[i + 1] & 0x0F) << 2) | (data[i + 2] >> 6)];
+        *out++ = ws_b64_table[data[i + 2] & 0x3F];
+    }
+    if (i < len) {
+        *out++ = ws_b64_table[data[i] >> 2];
+        if ((i + 1) < len) {
+            *out++ = ws_b64_table[((data[i] & 0x03) << 4) | (data[i + 1] >> 4)];
+            *out++ = ws_b64_table[(data[i + 1] & 0x0F) << 2];
+        } else {
+            *out++ = ws_b64_table[(data[i] & 0x03) << 4];
+            *out++ = '=';
+        }
+        *out++ = '=';
+    }
+    *out = '\0';
+}
+
+// Copy the value of a request header, returns false if the header is missing
+static bool ws_header(const char* request, const char* name, char* value, uint32_t size) {
+    uint32_t name_len = strlen(name);
+    const char* line = strstr(request, "\r\n");
+
+    while ((line != NULL) && (line[2] != '\r')) {
+        line += 2;
+        if ((strncasecmp(line, name, name_len) == 0) && (line[name_len] == ':')) {
+            const char* p = line + name_len + 1;
+            uint32_t n = 0;
+            while ((*p == ' ') || (*p == '\t')) {
+                p++;
+            }
+            while ((p[n] != '\r') && (p[n] != '\0') && (n < (size - 1))) {
+                value[n] = p[n];
+                n++;
+            }
+            value[n] = '\0';
+            return true;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+
+WebSocketServer::WebSocketServer(uint16_t port, uint8_t maxClients) {
+    _server = NULL;
+    _callback = NULL;
+    _policy = WS_DROP_OLDEST;
+    _port = port;
+    _max_clients = maxClients ? maxClients : 1;
+    if (_max_clients > WIFI_EVENT_SERVER_MAX_CLIENTS) {
+        _max_clients = WIFI_EVENT_SERVER_MAX_CLIENTS;
+    }
+    _depth = WS_SERVER_QUEUE_DEPTH;
+    _max_bytes = WS_SERVER_QUEUE_BYTES;
+    _ping_interval = 0;
+    _path = NULL;
+    _clients = NULL;
+    _client_count = 0;
+    _running = false;
+    _thread = 0;
+    _lock = 0;
+    _sent = 0;
+    _dropped = 0;
+    _coalesced = 0;
+}
+
+WebSocketServer::~WebSocketServer() {
+    end();
+}
+
+int WebSocketServer::begin(const char* path) {
+    int slot = -1;
+
+    if (_running) {
+        return 1;
+    }
+    for (int i = 0; i < WS_SERVER_MAX_INSTANCES; i++) {
+        if ((ws_servers[i] != NULL) && (ws_servers[i]->_port == _port)) {
+            printf("\r\n[ERROR] %s Port %d already has a WebSocket server\n", __FUNCTION__, _port);
+            return 0;
+        }
+        if ((slot < 0) && (ws_servers[i] == NULL)) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        printf("\r\n[ERROR] %s Too many WebSocket servers\n", __FUNCTION__);
+        return 0;
+    }
+    if (_lock == 0) {
+        _lock = os_semaphore_create_arduino(1);
+    }
+    _clients = (client_t*)malloc(_max_clients * sizeof(client_t));
+    _server = new WiFiEventServer(_max_clients);
+    if ((_lock == 0) || (_clients == NULL) || (_server == NULL)) {
+        printf("\r\n[ERROR] %s WebSocket server allocation failed\n", __FUNCTION__);
+        end();
+        return 0;
+    }
+    memset(_clients, 0, (_max_clients * sizeof(client_t)));
+    for (uint8_t id = 0; id < _max_clients; id++) {
+        _clients[id].sock = -1;
+    }
+    if (path != NULL) {
+        _path = strdup(path);
+    }
+    ws_servers[slot] = this;
+    _server->setCallback(eventCallback);
+    if (!_server->listen(_port)) {
+        end();
+        return 0;
+    }
+
+    _running = true;
+    _thread = os_thread_create_arduino(serverThread, this, OS_PRIORITY_NORMAL, WS_SERVER_STACK_SIZE);
+    if (_thread == 0) {
+        printf("\r\n[ERROR] %s WebSocket server thread create failed\n", __FUNCTION__);
+        _running = false;
+        end();
+        return 0;
+    }
+    return 1;
+}
+
+void WebSocketServer::end() {
+    uint32_t start = millis();
+
+    _running = false;
+    while ((_thread != 0) && ((millis() - start) < WS_SERVER_END_TIMEOUT)) {
+        delay(10);
+    }
+    if (_thread != 0) {
+        printf("\r\n[ERROR] %s WebSocket server thread still running\n", __FUNCTION__);
+        return;
+    }
+    for (int i = 0; i < WS_SERVER_MAX_INSTANCES; i++) {
+        if (ws_servers[i] == this) {
+            ws_servers[i] = NULL;
+        }
+    }
+    if (_server != NULL) {
+        delete _server;
+        _server = NULL;
+    }
+    free(_clients);
+    free(_path);
+    _clients = NULL;
+    _path = NULL;
+    _client_count = 0;
+}
+
+void WebSocketServer::onEvent(WebSocketEventCallback callback) {
+    _callback = callback;
+}
+
+void WebSocketServer::setBackpressure(WebSocketBackpressure policy, uint8_t depth, uint32_t maxBytes) {
+    _policy = policy;
+    _depth = (depth == 0) ? 1 : ((depth > WS_SERVER_MAX_QUEUE) ? WS_SERVER_MAX_QUEUE : depth);
+    _max_bytes = maxBytes;
+}
+
+void WebSocketServer::setPingInterval(uint32_t interval) {
+    _ping_interval = interval;
+}
+
+int WebSocketServer::broadcastText(const char* text, uint8_t tag) {
+    return publish(-1, WS_OPCODE_TEXT, (const uint8_t*)text, strlen(text), tag);
+}
+
+int WebSocketServer::broadcastBinary(const uint8_t* data, uint32_t len, uint8_t tag) {
+    return publish(-1, WS_OPCODE_BINARY, data, len, tag);
+}
+
+int WebSocketServer::sendText(uint8_t id, const char* text, uint8_t tag) {
+    return publish(id, WS_OPCODE_TEXT, (const uint8_t*)text, strlen(text), tag);
+}
+
+int WebSocketServer::sendBinary(uint8_t id, const uint8_t* data, uint32_t len, uint8_t tag) {
+    return publish(id, WS_OPCODE_BINARY, data, len, tag);
+}
+
+void WebSocketServer::disconnect(uint8_t id) {
+    if ((_clients != NULL) && (id < _max_clients)) {
+        _clients[id].close_requested = true;
+    }
+}
+
+uint16_t WebSocketServer::port() {
+    return _port;
+}
+
+uint8_t WebSocketServer::clientCount() {
+    return _client_count;
+}
+
+bool WebSocketServer::connected(uint8_t id) {
+    return ((_clients != NULL) && (id < _max_clients) && (_clients[id].state == WS_CLIENT_OPEN));
+}
+
+IPAddress WebSocketServer::remoteIP(uint8_t id) {
+    if (!connected(id)) {
+        return IPAddress(0, 0, 0, 0);
+    }
+    return _server->remoteIP(id);
+}
+
+uint8_t WebSocketServer::queueDepth(uint8_t id) {
+    if ((_clients == NULL) || (id >= _max_clients)) {
+        return 0;
+    }
+    return _clients[id].count;
+}
+
+uint32_t WebSocketServer::messagesSent() {
+    return _sent;
+}
+
+uint32_t WebSocketServer::messagesDropped() {
+    return _dropped;
+}
+
+uint32_t WebSocketServer::messagesCoalesced() {
+    return _coalesced;
+}
+
+//-----------------------------------------------------------------------------
+// Outgoing messages, queues are shared with the sending threads and guarded by _lock
+
+// Frame the payload once, every client queue holds a reference to the same buffer
+WebSocketServer::message_t* WebSocketServer::createMessage(uint8_t opcode, const uint8_t* data, uint32_t len) {
+    uint32_t hdr = (len < 126) ? 2 : ((len <= 0xFFFF) ? 4 : 10);
+    message_t* msg = (message_t*)malloc(sizeof(message_t) + hdr + len);
+
+    if (msg == NULL) {
+        return NULL;
+    }
+    msg->refs = 1;
+    msg->len = hdr + len;
+    msg->data[0] = 0x80 | opcode;
+    if (hdr == 2) {
+        msg->data[1] = (uint8_t)len;
+    } else if (hdr == 4) {
+        msg->data[1] = 126;
+        msg->data[2] = (uint8_t)(len >> 8);
+        msg->data[3] = (uint8_t)len;
+    } else {
+        msg->data[1] = 127;
+        memset(&msg->data[2], 0, 4);
+        msg->data[6] = (uint8_t)(len >> 24);
+        msg->data[7] = (uint8_t)(len >> 16);
+        msg->data[8] = (uint8_t)(len >> 8);
+        msg->data[9] = (uint8_t)len;
+    }
+    if (len) {
+        memcpy(&msg->data[hdr], data, len);
+    }
+    return msg;
+}
+
+// Called with _lock held
+void WebSocketServer::releaseMessage(message_t* msg) {
+    if (--msg->refs == 0) {
+        free(msg);
+    }
+}
+
+int WebSocketServer::publish(int id, uint8_t opcode, const uint8_t* data, uint32_t len, uint8_t tag) {
+    message_t* msg;
+    int queued = 0;
+
+    // skip the copy when nobody is listening
+    if (!_running || (_client_count == 0)) {
+        return 0;
+    }
+    if ((id >= 0) && !connected(id)) {
+        return 0;
+    }
+    msg = createMessage(opcode, data, len);
+    if (msg == NULL) {
+        printf("\r\n[ERROR] %s Message allocation failed, %lu bytes\n", __FUNCTION__, len);
+        return 0;
+    }
+
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    for (uint8_t i = 0; i < _max_clients; i++) {
+        if (((id < 0) || (id == i)) && enqueue(i, msg, tag)) {
+            queued++;
+        }
+    }
+    releaseMessage(msg);
+    os_semaphore_release_arduino(_lock);
+    return queued;
+}
+
+// The head entry belongs to the server thread once it started sending it
+bool WebSocketServer::headBusy(client_t* c) {
+    return ((c->count > 0) && (c->sending || (c->sent_offset > 0)));
+}
+
+// Called with _lock held
+void WebSocketServer::removeEntry(client_t* c, uint8_t index) {
+    c->queued_bytes -= c->queue[index].msg->len;
+    releaseMessage(c->queue[index].msg);
+    c->count--;
+    for (uint8_t i = index; i < c->count; i++) {
+        c->queue[i] = c->queue[i + 1];
+    }
+}
+
+// Called with _lock held
+bool WebSocketServer::enqueue(uint8_t id, message_t* msg, uint8_t tag) {
+    client_t* c = &_clients[id];
+    uint8_t first;
+
+    if (c->state != WS_CLIENT_OPEN) {
+        return false;
+    }
+    first = headBusy(c) ? 1 : 0;
+    if ((_policy == WS_COALESCE) && (tag != 0)) {
+        for (uint8_t i = first; i < c->count; i++) {
+            if (c->queue[i].tag == tag) {
+                c->queued_bytes += msg->len;
+                c->queued_bytes -= c->queue[i].msg->len;
+                releaseMessage(c->queue[i].msg);
+                c->queue[i].msg = msg;
+                msg->refs++;
+                c->coalesced++;
+                _coalesced++;
+                return true;
+            }
+        }
+    }
+    while ((c->count >= _depth) || ((c->count > 0) && ((c->queued_bytes + msg->len) > _max_bytes))) {
+        if ((_policy == WS_DROP_NEWEST) || (first >= c->count)) {
+            c->dropped++;
+            _dropped++;
+            return false;
+        }
+        removeEntry(c, first);
+        c->dropped++;
+        _dropped++;
+    }
+    c->queue[c->count].msg = msg;
+    c->queue[c->count].tag = tag;
+    c->count++;
+    c->queued_bytes += msg->len;
+    msg->refs++;
+    if (c->count > c->peak) {
+        c->peak = c->count;
+    }
+    return true;
+}
+
+// Control frames skip the backpressure limits so pongs and close frames are not dropped
+void WebSocketServer::sendControl(uint8_t id, uint8_t opcode, const uint8_t* data, uint32_t len) {
+    client_t* c = &_clients[id];
+    message_t* msg = createMessage(opcode, data, len);
+
+    if (msg == NULL) {
+        return;
+    }
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    if (c->count < WS_SERVER_MAX_QUEUE) {
+        c->queue[c->count].msg = msg;
+        c->queue[c->count].tag = 0;
+        c->count++;
+        c->queued_bytes += msg->len;
+        msg->refs++;
+    }
+    releaseMessage(msg);
+    os_semaphore_release_arduino(_lock);
+}
+
+// Send queued messages until the socket send buffer is full, never blocks
+void WebSocketServer::flush(uint8_t id) {
+    client_t* c = &_clients[id];
+    message_t* msg;
+    uint32_t offset;
+    bool complete;
+    int ret;
+
+    while ((c->state == WS_CLIENT_OPEN) || (c->state == WS_CLIENT_CLOSING)) {
+        os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+        if (c->count == 0) {
+            os_semaphore_release_arduino(_lock);
+            break;
+        }
+        msg = c->queue[0].msg;
+        offset = c->sent_offset;
+        c->sending = true;
+        os_semaphore_release_arduino(_lock);
+
+        ret = _drv.sendDataNonBlocking(c->sock, (msg->data + offset), (msg->len - offset));
+
+        complete = false;
+        os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+        c->sending = false;
+        if (ret > 0) {
+            c->sent_offset += ret;
+            if (c->sent_offset >= msg->len) {
+                removeEntry(c, 0);
+                c->sent_offset = 0;
+                c->sent++;
+                _sent++;
+                complete = true;
+            }
+        }
+        os_semaphore_release_arduino(_lock);
+
+        if (ret < 0) {
+            closeClient(id);
+            return;
+        }
+        if (!complete) {
+            // send buffer full, wait for WIFI_SERVER_EVENT_WRITABLE
+            break;
+        }
+    }
+    if ((c->state == WS_CLIENT_CLOSING) && (c->count == 0)) {
+        closeClient(id);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Server thread
+
+void WebSocketServer::serverThread(const void* argument) {
+    WebSocketServer* self = (WebSocketServer*)argument;
+
+    while (self->_running) {
+        // only ask select for writability while something is waiting to be sent
+        for (uint8_t id = 0; id < self->_max_clients; id++) {
+            if (self->_clients[id].state != WS_CLIENT_FREE) {
+                self->_server->notifyWritable(id, (self->_clients[id].count > 0));
+            }
+        }
+        self->_server->poll(WS_SERVER_POLL_MS);
+        self->checkClients();
+    }
+
+    for (uint8_t id = 0; id < self->_max_clients; id++) {
+        if (self->_clients[id].state != WS_CLIENT_FREE) {
+            self->closeClient(id);
+        }
+    }
+    self->_server->end();
+    self->_thread = 0;
+    os_thread_terminate_arduino(os_thread_get_id_arduino());
+}
+
+void WebSocketServer::eventCallback(WiFiServerEvent event, uint8_t id, WiFiClient& client, uint16_t port) {
+    WebSocketServer* self = NULL;
+
+    for (int i = 0; i < WS_SERVER_MAX_INSTANCES; i++) {
+        if ((ws_servers[i] != NULL) && (ws_servers[i]->_port == port)) {
+            self = ws_servers[i];
+            break;
+        }
+    }
+    if ((self == NULL) || (id >= self->_max_clients)) {
+        client.stop();
+        return;
+    }
+
+    client_t* c = &self->_clients[id];
+    switch (event) {
+        case WIFI_SERVER_EVENT_ACCEPT:
+            self->resetClient(id);
+            c->rx = (uint8_t*)malloc(WS_SERVER_RX_BUFFER_SIZE);
+            if (c->rx == NULL) {
+                printf("\r\n[ERROR] %s Receive buffer allocation failed\n", __FUNCTION__);
+                client.stop();
+                return;
+            }
+            c->sock = client.getSocket();
+            c->state = WS_CLIENT_HANDSHAKE;
+            c->last_rx = millis();
+            break;
+        case WIFI_SERVER_EVENT_READABLE:
+            self->receive(id, client);
+            break;
+        case WIFI_SERVER_EVENT_WRITABLE:
+            self->flush(id);
+            break;
+        case WIFI_SERVER_EVENT_CLOSED:
+        case WIFI_SERVER_EVENT_TIMEOUT:
+            self->closeClient(id);
+            break;
+    }
+}
+
+void WebSocketServer::receive(uint8_t id, WiFiClient& client) {
+    client_t* c = &_clients[id];
+    uint32_t space;
+    int ret;
+
+    if ((c->rx == NULL) || (c->state == WS_CLIENT_FREE)) {
+        return;
+    }
+    // one byte is kept to null terminate handshakes and text messages
+    space = WS_SERVER_RX_BUFFER_SIZE - 1 - c->rx_len;
+    if (space == 0) {
+        closeClient(id);
+        return;
+    }
+    ret = client.read((c->rx + c->rx_len), space);
+    if (ret <= 0) {
+        return;
+    }
+    c->rx_len += ret;
+    c->rx[c->rx_len] = '\0';
+    c->last_rx = millis();
+    c->ping_sent = false;
+
+    if (c->state == WS_CLIENT_HANDSHAKE) {
+        handshake(id);
+    } else {
+        parseFrames(id);
+    }
+}
+
+void WebSocketServer::handshake(uint8_t id) {
+    client_t* c = &_clients[id];
+    char* request = (char*)c->rx;
+    char* end = strstr(request, "\r\n\r\n");
+    char key[64 + sizeof(ws_guid)];
+    char value[16];
+    char response[160];
+    uint8_t digest[20];
+    char accept[32];
+    const char* status = NULL;
+    uint32_t len;
+
+    if (end == NULL) {
+        if (c->rx_len >= (WS_SERVER_RX_BUFFER_SIZE - 1)) {
+            status = "431 Request Header Fields Too Large";
+        } else {
+            return;
+        }
+    } else if (strncmp(request, "GET ", 4) != 0) {
+        status = "405 Method Not Allowed";
+    } else if (_path != NULL) {
+        const char* path = request + 4;
+        uint32_t n = strlen(_path);
+        if ((strncmp(path, _path, n) != 0) || ((path[n] != ' ') && (path[n] != '?'))) {
+            status = "404 Not Found";
+        }
+    }
+    if (status == NULL) {
+        if (!ws_header(request, "Upgrade", value, sizeof(value)) || (strcasecmp(value, "websocket") != 0) ||
+            !ws_header(request, "Sec-WebSocket-Key", key, 64)) {
+            status = "400 Bad Request";
+        } else if (!ws_header(request, "Sec-WebSocket-Version", value, sizeof(value)) || (strcmp(value, "13") != 0)) {
+            status = "426 Upgrade Required\r\nSec-WebSocket-Version: 13";
+        }
+    }
+    if (status != NULL) {
+        len = snprintf(response, sizeof(response), "HTTP/1.1 %s\r\nConnection: close\r\nContent-Length: 0\r\n\r\n", status);
+        _drv.sendDataNonBlocking(c->sock, (const uint8_t*)response, len);
+        closeClient(id);
+        return;
+    }
+
+    strcat(key, ws_guid);
+    ws_sha1((const uint8_t*)key, strlen(key), digest);
+    ws_base64(digest, sizeof(digest), accept);
+    len = snprintf(response, sizeof(response), "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept);
+    // the send buffer of a new connection is empty, a short write means the connection failed
+    if (_drv.sendDataNonBlocking(c->sock, (const uint8_t*)response, len) != (int)len) {
+        closeClient(id);
+        return;
+    }
+
+    // keep any frame the client sent right behind the request
+    end += 4;
+    c->rx_len -= (end - request);
+    memmove(c->rx, end, c->rx_len);
+    c->state = WS_CLIENT_OPEN;
+    _client_count++;
+    if (_callback) {
+        _callback(WS_EVENT_CONNECT, id, NULL, 0);
+    }
+    if ((c->state == WS_CLIENT_OPEN) && (c->rx_len > 0)) {
+        parseFrames(id);
+    }
+}
+
+void WebSocketServer::parseFrames(uint8_t id) {
+    client_t* c = &_clients[id];
+    uint16_t close_code = 0;
+
+    while ((c->rx != NULL) && (c->rx_len >= 2)) {
+        uint8_t* p = c->rx;
+        bool fin = (p[0] & 0x80);
+        uint8_t opcode = p[0] & 0x0F;
+        uint64_t len = p[1] & 0x7F;
+        uint32_t hdr = 2;
+
+        if (!(p[1] & 0x80)) {
+            // client frames must be masked
+            close_code = WS_CLOSE_PROTOCOL_ERROR;
+            break;
+        }
+        if (len == 126) {
+            if (c->rx_len < 4) {
+                return;
+            }
+            len = ((uint32_t)p[2] << 8) | p[3];
+            hdr = 4;
+        } else if (len == 127) {
+            if (c->rx_len < 10) {
+                return;
+            }
+            len = 0;
+            for (int i = 2; i < 10; i++) {
+                len = (len << 8) | p[i];
+            }
+            hdr = 10;
+        }
+        if (len > WS_SERVER_MAX_RX_MESSAGE) {
+            close_code = WS_CLOSE_TOO_BIG;
+            break;
+        }
+        if (c->rx_len < (hdr + 4 + len)) {
+            return;
+        }
+
+        uint8_t* mask = p + hdr;
+        uint8_t* payload = mask + 4;
+        uint32_t frame_len = hdr + 4 + (uint32_t)len;
+        for (uint32_t i = 0; i < len; i++) {
+            payload[i] ^= mask[i & 3];
+        }
+
+        if ((opcode == WS_OPCODE_TEXT) || (opcode == WS_OPCODE_BINARY)) {
+            if (!fin) {
+                // fragmented messages are not reassembled
+                close_code = WS_CLOSE_UNSUPPORTED;
+                break;
+            }
+            if ((c->state == WS_CLIENT_OPEN) && _callback) {
+                uint8_t saved = payload[len];
+                payload[len] = '\0';
+                _callback(((opcode == WS_OPCODE_TEXT) ? WS_EVENT_TEXT : WS_EVENT_BINARY), id, payload, len);
+                payload[len] = saved;
+            }
+        } else if (opcode == WS_OPCODE_PING) {
+            sendControl(id, WS_OPCODE_PONG, payload, len);
+        } else if (opcode == WS_OPCODE_CLOSE) {
+            if (c->state == WS_CLIENT_CLOSING) {
+                closeClient(id);
+            } else {
+                // echo the status code back and close once it is sent
+                startClose(id, payload, ((len >= 2) ? 2 : 0));
+                c->rx_len = 0;
+            }
+            return;
+        } else if (opcode != WS_OPCODE_PONG) {
+            close_code = WS_CLOSE_PROTOCOL_ERROR;
+            break;
+        }
+
+        if ((c->rx == NULL) || (c->state == WS_CLIENT_FREE)) {
+            return;
+        }
+        c->rx_len -= frame_len;
+        memmove(c->rx, (c->rx + frame_len), c->rx_len);
+    }
+
+    if (close_code != 0) {
+        uint8_t code[2] = {(uint8_t)(close_code >> 8), (uint8_t)close_code};
+        c->rx_len = 0;
+        if (c->state == WS_CLIENT_OPEN) {
+            startClose(id, code, sizeof(code));
+        } else {
+            closeClient(id);
+        }
+    }
+}
+
+// Handle disconnect requests, pings and timeouts, then drain every queue
+void WebSocketServer::checkClients() {
+    uint32_t now = millis();
+
+    for (uint8_t id = 0; id < _max_clients; id++) {
+        client_t* c = &_clients[id];
+        uint32_t silent = now - c->last_rx;
+
+        if (c->state == WS_CLIENT_FREE) {
+            continue;
+        }
+        if (c->close_requested) {
+            c->close_requested = false;
+            if (c->state == WS_CLIENT_OPEN) {
+                uint8_t code[2] = {(uint8_t)(WS_CLOSE_NORMAL >> 8), (uint8_t)WS_CLOSE_NORMAL};
+                startClose(id, code, sizeof(code));
+                continue;
+            } else if (c->state == WS_CLIENT_HANDSHAKE) {
+                closeClient(id);
+                continue;
+            }
+        }
+        if (((c->state == WS_CLIENT_HANDSHAKE) && (silent >= WS_SERVER_HANDSHAKE_TIMEOUT)) ||
+            ((c->state == WS_CLIENT_CLOSING) && (silent >= WS_SERVER_CLOSE_TIMEOUT))) {
+            closeClient(id);
+            continue;
+        }
+        if ((c->state == WS_CLIENT_OPEN) && (_ping_interval != 0)) {
+            if (silent >= (2 * _ping_interval)) {
+                closeClient(id);
+                continue;
+            }
+            if ((silent >= _ping_interval) && !c->ping_sent) {
+                sendControl(id, WS_OPCODE_PING, NULL, 0);
+                c->ping_sent = true;
+            }
+        }
+        flush(id);
+    }
+}
+
+// Send a close frame, the connection is dropped once it is out or after WS_SERVER_CLOSE_TIMEOUT
+void WebSocketServer::startClose(uint8_t id, const uint8_t* payload, uint32_t len) {
+    client_t* c = &_clients[id];
+
+    if (c->state != WS_CLIENT_OPEN) {
+        return;
+    }
+    sendControl(id, WS_OPCODE_CLOSE, payload, len);
+    c->state = WS_CLIENT_CLOSING;
+    c->last_rx = millis();
+    _client_count--;
+    if (_callback) {
+        _callback(WS_EVENT_DISCONNECT, id, NULL, 0);
+    }
+}
+
+void WebSocketServer::closeClient(uint8_t id) {
+    client_t* c = &_clients[id];
+
+    if (c->state == WS_CLIENT_FREE) {
+        return;
+    }
+    if (c->state == WS_CLIENT_OPEN) {
+        c->state = WS_CLIENT_CLOSING;
+        _client_count--;
+        if (_callback) {
+            _callback(WS_EVENT_DISCONNECT, id, NULL, 0);
+        }
+    }
+    resetClient(id);
+    _server->close(id);
+}
+
+void WebSocketServer::resetClient(uint8_t id) {
+    client_t* c = &_clients[id];
+
+    os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    while (c->count > 0) {
+        removeEntry(c, (c->count - 1));
+    }
+    free(c->rx);
+    memset(c, 0, sizeof(client_t));
+    c->sock = -1;
+    os_semaphore_release_arduino(_lock);
+}
+
+void WebSocketServer::printInfo() {
+    static const char* const policy_names[] = {"drop newest", "drop oldest", "coalesce"};
+
+    printf("\r\n------------------------------------------\r\n");
+    printf("WebSocket Server: port %d, %s\r\n", _port, (_running ? "running" : "stopped"));
+    printf("Path: %s\r\n", (_path ? _path : "any"));
+    printf("Clients: %d/%d\r\n", _client_count, _max_clients);
+    printf("Backpressure: %s, %d messages, %lu bytes\r\n", policy_names[_policy], _depth, _max_bytes);
+    printf("Messages sent: %lu, dropped: %lu, coalesced: %lu\r\n", _sent, _dropped, _coalesced);
+    for (uint8_t id = 0; (_clients != NULL) && (id < _max_clients); id++) {
+        client_t* c = &_clients[id];
+        if (c->state != WS_CLIENT_OPEN) {
+            continue;
+        }
+        IPAddress ip = _server->remoteIP(id);
+        printf("Client %d: %s, queued %d (peak %d, %lu bytes), sent %lu, dropped %lu, coalesced %lu\r\n", id, ip.get_address(), c->count, c->peak, c->queued_bytes, c->sent, c->dropped, c->coalesced);
+    }
+    printf("------------------------------------------\r\n");
+}
@@ -0,0 +1,149 @@
+#ifndef WebSocketServer_h
+#define WebSocketServer_h
+
+#include <Arduino.h>
+#include "WiFiEventServer.h"
+
+#define WS_SERVER_MAX_CLIENTS           8
+#define WS_SERVER_MAX_INSTANCES         4
+// hard limit of messages queued per client, setBackpressure() may lower it
+#define WS_SERVER_MAX_QUEUE             16
+#define WS_SERVER_QUEUE_DEPTH           8
+#define WS_SERVER_QUEUE_BYTES           (128 * 1024)
+// largest message accepted from a client
+#define WS_SERVER_MAX_RX_MESSAGE        1024
+// longest a queued message waits before the server thread picks it up
+#define WS_SERVER_POLL_MS               10
+#define WS_SERVER_STACK_SIZE            4096
+
+typedef enum {
+    WS_DROP_NEWEST = 0,     // a full queue rejects the new message
+    WS_DROP_OLDEST,         // a full queue discards its oldest unsent messages
+    WS_COALESCE,            // a new message replaces the queued one with the same tag, else drop oldest
+} WebSocketBackpressure;
+
+typedef enum {
+    WS_EVENT_CONNECT = 0,   // handshake completed
+    WS_EVENT_DISCONNECT,    // closed by either side, the id is free after the callback
+    WS_EVENT_TEXT,          // text message from the client, data is null terminated
+    WS_EVENT_BINARY,        // binary message from the client
+} WebSocketEvent;
+
+// Called from the server thread, data is only valid during the call
+typedef void (*WebSocketEventCallback)(WebSocketEvent event, uint8_t id, const uint8_t* data, uint32_t len);
+
+// WebSocket (RFC 6455) server for pushing data to many clients. A message is
+// framed once into a reference counted buffer and queued on every client, so
+// broadcasting from an NN or camera callback costs one copy and never waits
+// for the network. One thread owns the sockets and drains the queues with
+// non-blocking sends; a client that falls behind has messages dropped or
+// coalesced by its backpressure policy instead of stalling the others.
+class WebSocketServer {
+    public:
+        WebSocketServer(uint16_t port = 81, uint8_t maxClients = WS_SERVER_MAX_CLIENTS);
+        ~WebSocketServer();
+
+        // Accept upgrades on path, NULL accepts any path
+        // Returns 1 if successful, 0 on failure
+        int begin(const char* path = NULL);
+        void end();
+
+        void onEvent(WebSocketEventCallback callback);
+
+        // Applies to every client, depth is capped at WS_SERVER_MAX_QUEUE
+        void setBackpressure(WebSocketBackpressure policy, uint8_t depth = WS_SERVER_QUEUE_DEPTH, uint32_t maxBytes = WS_SERVER_QUEUE_BYTES);
+
+        // Ping clients silent for interval ms and close them after another interval, 0 disables
+        void setPingInterval(uint32_t interval);
+
+        // Queue a message without blocking, tag identifies messages that WS_COALESCE may replace, 0 is never coalesced
+        // Returns the number of clients the message was queued for
+        int broadcastText(const char* text, uint8_t tag = 0);
+        int broadcastBinary(const uint8_t* data, uint32_t len, uint8_t tag = 0);
+        int sendText(uint8_t id, const char* text, uint8_t tag = 0);
+        int sendBinary(uint8_t id, const uint8_t* data, uint32_t len, uint8_t tag = 0);
+
+        // Close a client from any thread, takes effect in the server thread
+        void disconnect(uint8_t id);
+
+        uint16_t port();
+        uint8_t clientCount();
+        bool connected(uint8_t id);
+        IPAddress remoteIP(uint8_t id);
+        uint8_t queueDepth(uint8_t id);
+        uint32_t messagesSent();
+        uint32_t messagesDropped();
+        uint32_t messagesCoalesced();
+        void printInfo();
+
+    private:
+        typedef struct {
+            uint16_t refs;
+            uint32_t len;
+            uint8_t data[1];
+        } message_t;
+
+        typedef struct {
+            message_t* msg;
+            uint8_t tag;
+        } queue_entry_t;
+
+        typedef struct {
+            uint8_t state;
+            int sock;
+            bool close_requested;
+            bool ping_sent;
+            bool sending;
+            uint32_t last_rx;
+            uint8_t* rx;
+            uint32_t rx_len;
+            queue_entry_t queue[WS_SERVER_MAX_QUEUE];
+            uint8_t count;
+            uint8_t peak;
+            uint32_t queued_bytes;
+            uint32_t sent_offset;
+            uint32_t sent;
+            uint32_t dropped;
+            uint32_t coalesced;
+        } client_t;
+
+        static void serverThread(const void* argument);
+        static void eventCallback(WiFiServerEvent event, uint8_t id, WiFiClient& client, uint16_t port);
+
+        message_t* createMessage(uint8_t opcode, const uint8_t* data, uint32_t len);
+        void releaseMessage(message_t* msg);
+        int publish(int id, uint8_t opcode, const uint8_t* data, uint32_t len, uint8_t tag);
+        bool enqueue(uint8_t id, message_t* msg, uint8_t tag);
+        void removeEntry(client_t* c, uint8_t index);
+        bool headBusy(client_t* c);
+        void flush(uint8_t id);
+        void receive(uint8_t id, WiFiClient& client);
+        void handshake(uint8_t id);
+        void parseFrames(uint8_t id);
+        void sendControl(uint8_t id, uint8_t opcode, const uint8_t* data, uint32_t len);
+        void checkClients();
+        void startClose(uint8_t id, const uint8_t* payload, uint32_t len);
+        void closeClient(uint8_t id);
+        void resetClient(uint8_t id);
+
+        WiFiEventServer* _server;
+        ServerDrv _drv;
+        WebSocketEventCallback _callback;
+        WebSocketBackpressure _policy;
+        uint16_t _port;
+        uint8_t _max_clients;
+        uint8_t _depth;
+        uint32_t _max_bytes;
+        uint32_t _ping_interval;
+        char* _path;
+        client_t* _clients;
+        volatile uint8_t _client_count;
+        volatile bool _running;
+        uint32_t _thread;
+        uint32_t _lock;
+        uint32_t _sent;
+        uint32_t _dropped;
+        uint32_t _coalesced;
+};
+
+#endif
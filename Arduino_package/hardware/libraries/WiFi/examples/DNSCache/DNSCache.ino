@@ -0,0 +1,78 @@
+/*
+ This example shows the DNS cache behind WiFi.hostByName() and the
+ non-blocking WiFi.resolveAsync().
+
+ Names added with WiFi.preresolve() are looked up in the background right
+ after WiFi.begin(), so the first connect to them does not wait for DNS.
+ Later lookups are answered from the cache until the TTL of the DNS answer
+ runs out, and the sensor loop below never blocks on a slow DNS server.
+ */
+
+#include <WiFi.h>
+
+char ssid[] = "Network_SSID";       // your network SSID (name)
+char pass[] = "Password";           // your network password
+int status = WL_IDLE_STATUS;        // Indicater of Wifi status
+
+const char* host = "www.example.com";
+IPAddress hostIP;
+volatile bool resolved = false;
+uint32_t lastResolve = 0;
+uint32_t lastPrint = 0;
+
+// Runs in the resolver task, or inside resolveAsync() when the name was cached
+void onResolved(const char* name, uint32_t ip, int result, void* arg) {
+    if (result == DNS_CACHE_OK) {
+        hostIP = IPAddress(ip);
+        resolved = true;
+    } else {
+        printf("%s could not be resolved (%d)\r\n", name, result);
+    }
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    // resolved in the background as soon as the connection is up
+    WiFi.preresolve(host);
+    // keep using an expired address for up to 5 minutes while it is refreshed
+    WiFi.setDnsServeStale(300);
+
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+        delay(2000);
+    }
+
+    // blocks only on a cache miss
+    uint32_t start = millis();
+    if (WiFi.hostByName(host, hostIP)) {
+        Serial.print(host);
+        Serial.print(" is ");
+        Serial.print(hostIP);
+        Serial.print(", resolved in ");
+        Serial.print(millis() - start);
+        Serial.println(" ms");
+    }
+}
+
+void loop() {
+    // the sensor work keeps running while names are resolved
+    if ((millis() - lastResolve) >= 1000) {
+        lastResolve = millis();
+        WiFi.resolveAsync(host, onResolved);
+    }
+    if (resolved) {
+        resolved = false;
+        Serial.print("Current address of ");
+        Serial.print(host);
+        Serial.print(": ");
+        Serial.println(hostIP);
+    }
+    if ((millis() - lastPrint) >= 10000) {
+        lastPrint = millis();
+        WiFi.printDnsCache();
+    }
+    delay(10);
+}
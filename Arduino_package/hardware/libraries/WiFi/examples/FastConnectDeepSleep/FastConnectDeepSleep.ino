@@ -0,0 +1,50 @@
+/*
+ This example shows how to reconnect to a WPA2 network quickly after
+ waking up from deep sleep.
+
+ The AP channel, BSSID, derived PSK and DHCP address of the first
+ connection are saved in flash. On every following wake up the
+ connection skips the channel scan and PSK derivation, and the previous
+ DHCP address is requested again instead of running full DHCP discovery.
+ If the AP has changed, a normal connection is made and the saved info is
+ updated.
+ */
+
+#include <WiFi.h>
+#include "PowerMode.h"
+
+char ssid[] = "Network_SSID";       // your network SSID (name)
+char pass[] = "Password";           // your network password
+int status = WL_IDLE_STATUS;        // Indicater of Wifi status
+
+// wake up by AON timer, 100kHz clock, 30 seconds
+uint32_t PM_AONtimer_setting[2] = {0, 30};
+
+void setup() {
+    Serial.begin(115200);
+
+    // call before WiFi.begin() so the saved connection info is used and updated
+    WiFi.enableFastConnect();
+
+    uint32_t start = millis();
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to WPA SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+    }
+    Serial.print("Connected in ");
+    Serial.print(millis() - start);
+    Serial.println(" ms");
+    Serial.print("IP Address: ");
+    Serial.println(WiFi.localIP());
+
+    // do the periodic work here, e.g. upload a sensor reading
+
+    Serial.println("Enter DeepSleep Mode");
+    PowerMode.begin(DEEPSLEEP_MODE, 0, (uint32_t)(PM_AONtimer_setting));
+    PowerMode.start();
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,85 @@
+/*
+ This example serves a small text control port and a data port
+ from loop(), without a task per connection.
+
+ Port 80 answers every request with the uptime and the number of
+ connected clients. Port 5000 echoes what each client sends.
+ Clients that are idle for 30 seconds are closed.
+ */
+
+#include <WiFi.h>
+
+char ssid[] = "Network_SSID";       // your network SSID (name)
+char pass[] = "Password";           // your network password
+int status = WL_IDLE_STATUS;        // Indicater of Wifi status
+
+#define CONTROL_PORT    80
+#define DATA_PORT       5000
+
+WiFiEventServer server(16);
+char buffer[512];
+
+void serverEvent(WiFiServerEvent event, uint8_t id, WiFiClient& client, uint16_t port) {
+    switch (event) {
+        case WIFI_SERVER_EVENT_ACCEPT:
+            Serial.print("Client ");
+            Serial.print(id);
+            Serial.print(" connected from ");
+            Serial.print(server.remoteIP(id));
+            Serial.print(" on port ");
+            Serial.println(port);
+            break;
+        case WIFI_SERVER_EVENT_READABLE: {
+            int n = client.read((uint8_t*)buffer, sizeof(buffer));
+            if (n <= 0) {
+                break;
+            }
+            if (port == CONTROL_PORT) {
+                client.print("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n");
+                client.print("uptime ");
+                client.print(millis());
+                client.print(" ms, clients ");
+                client.println(server.clientCount());
+                client.stop();
+            } else {
+                client.write((uint8_t*)buffer, n);
+            }
+            break;
+        }
+        case WIFI_SERVER_EVENT_CLOSED:
+            Serial.print("Client ");
+            Serial.print(id);
+            Serial.println(" closed");
+            break;
+        case WIFI_SERVER_EVENT_TIMEOUT:
+            Serial.print("Client ");
+            Serial.print(id);
+            Serial.println(" idle timeout");
+            break;
+        default:
+            break;
+    }
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to Network named: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+        delay(2000);
+    }
+    Serial.print("IP Address: ");
+    Serial.println(WiFi.localIP());
+
+    server.setCallback(serverEvent);
+    server.setIdleTimeout(30000);
+    server.listen(CONTROL_PORT);
+    server.listen(DATA_PORT);
+}
+
+void loop() {
+    // waits up to 100 ms for activity on any port or client
+    server.poll(100);
+}
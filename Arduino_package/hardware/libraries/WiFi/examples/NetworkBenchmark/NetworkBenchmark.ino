@@ -0,0 +1,309 @@
+/*
+ This example measures network throughput and latency on the board so
+ that changes to the WiFi, MQTT and HTTP libraries can be compared run
+ against run. Each test prints one result line, followed by the lwIP
+ pool usage it caused.
+
+ Start the peers on a PC in the same network, then set benchHost:
+   TCP send:      nc -l -k 5001 > /dev/null
+   TCP receive:   while true; do head -c 4194304 /dev/zero | nc -l 5002; done
+   TCP latency:   socat TCP4-LISTEN:5003,fork,reuseaddr PIPE
+   UDP send:      nc -u -l -k 5004 > /dev/null
+   UDP latency:   socat UDP4-LISTEN:5005,fork PIPE
+   MQTT publish:  mosquitto -p 1883
+   HTTP GET:      head -c 1048576 /dev/urandom > 1mb.bin; python3 -m http.server 8000
+ Tests whose peer is not running report a connect failure and are skipped.
+ */
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <NetStats.h>
+#include <PubSubClient.h>
+#include <HttpClient.h>
+
+char ssid[] = "Network_SSID";       // your network SSID (name)
+char pass[] = "Password";           // your network password
+int status = WL_IDLE_STATUS;        // Indicater of Wifi status
+
+IPAddress benchHost(192, 168, 1, 100);
+char benchHostName[] = "192.168.1.100";
+
+#define TCP_SEND_BYTES      (4 * 1024 * 1024)
+#define TCP_RECV_BYTES      (4 * 1024 * 1024)
+#define LATENCY_ROUNDS      100
+#define UDP_SEND_PACKETS    10000
+#define UDP_PACKET_SIZE     64
+#define MQTT_MESSAGES       1000
+#define MQTT_PAYLOAD_SIZE   128
+#define HTTP_PATH           "/1mb.bin"
+
+uint8_t buffer[4096];
+
+void printResult(const char* test, uint32_t bytes, uint32_t ms) {
+    Serial.print(test);
+    Serial.print(": ");
+    Serial.print(bytes);
+    Serial.print(" bytes in ");
+    Serial.print(ms);
+    Serial.print(" ms, ");
+    Serial.print((ms ? ((float)bytes * 8 / 1000 / ms) : 0), 2);
+    Serial.println(" Mbps");
+}
+
+void printRate(const char* test, uint32_t count, uint32_t ms, const char* unit) {
+    Serial.print(test);
+    Serial.print(": ");
+    Serial.print(count);
+    Serial.print(" in ");
+    Serial.print(ms);
+    Serial.print(" ms, ");
+    Serial.print((ms ? ((float)count * 1000 / ms) : 0), 1);
+    Serial.println(unit);
+}
+
+void printLatency(const char* test, uint32_t* samples, int count) {
+    uint32_t total = 0;
+    uint32_t worst = 0;
+    uint32_t best = 0xFFFFFFFF;
+    for (int i = 0; i < count; i++) {
+        total += samples[i];
+        worst = max(worst, samples[i]);
+        best = min(best, samples[i]);
+    }
+    Serial.print(test);
+    Serial.print(": ");
+    Serial.print(count);
+    Serial.print(" round trips, min ");
+    Serial.print(count ? best : 0);
+    Serial.print(" us, avg ");
+    Serial.print(count ? (total / count) : 0);
+    Serial.print(" us, max ");
+    Serial.print(worst);
+    Serial.println(" us");
+}
+
+void benchTcpSend() {
+    WiFiClient client;
+    uint32_t sent = 0;
+
+    if (!client.connect(benchHost, 5001)) {
+        Serial.println("TCP send: connect failed");
+        return;
+    }
+    memset(buffer, 0x55, sizeof(buffer));
+    uint32_t start = millis();
+    while (sent < TCP_SEND_BYTES) {
+        size_t n = client.write(buffer, sizeof(buffer));
+        if (n == 0) {
+            break;
+        }
+        sent += n;
+    }
+    printResult("TCP send", sent, millis() - start);
+    client.stop();
+}
+
+void benchTcpRecv() {
+    WiFiClient client;
+    uint32_t received = 0;
+
+    if (!client.connect(benchHost, 5002)) {
+        Serial.println("TCP receive: connect failed");
+        return;
+    }
+    uint32_t start = millis();
+    while (received < TCP_RECV_BYTES) {
+        int n = client.read(buffer, sizeof(buffer));
+        if (n <= 0) {
+            break;
+        }
+        received += n;
+    }
+    printResult("TCP receive", received, millis() - start);
+    client.stop();
+}
+
+void benchTcpLatency() {
+    WiFiClient client;
+    uint32_t samples[LATENCY_ROUNDS];
+    int count = 0;
+
+    if (!client.connect(benchHost, 5003)) {
+        Serial.println("TCP latency: connect failed");
+        return;
+    }
+    for (int i = 0; i < LATENCY_ROUNDS; i++) {
+        uint32_t start = micros();
+        if (client.write(buffer, 32) != 32) {
+            break;
+        }
+        int got = 0;
+        while (got < 32) {
+            int n = client.read(buffer + got, 32 - got);
+            if (n <= 0) {
+                break;
+            }
+            got += n;
+        }
+        if (got < 32) {
+            break;
+        }
+        samples[count++] = micros() - start;
+    }
+    printLatency("TCP latency", samples, count);
+    client.stop();
+}
+
+void benchUdpSend() {
+    WiFiUDP udp;
+    WiFiUDPPacket packets[8];
+    uint32_t sent = 0;
+
+    udp.begin(5104);
+    memset(buffer, 0xAA, sizeof(buffer));
+    for (int i = 0; i < 8; i++) {
+        packets[i].data = buffer;
+        packets[i].len = UDP_PACKET_SIZE;
+        packets[i].ip = benchHost;
+        packets[i].port = 5004;
+    }
+    uint32_t start = millis();
+    while (sent < UDP_SEND_PACKETS) {
+        int n = udp.sendPackets(packets, 8);
+        if (n <= 0) {
+            delay(1);
+            continue;
+        }
+        sent += n;
+    }
+    printRate("UDP send", sent, millis() - start, " packets/s");
+    udp.stop();
+}
+
+void benchUdpLatency() {
+    WiFiUDP udp;
+    uint32_t samples[LATENCY_ROUNDS];
+    int count = 0;
+
+    udp.begin(5105);
+    for (int i = 0; i < LATENCY_ROUNDS; i++) {
+        uint32_t start = micros();
+        udp.beginPacket(benchHost, 5005);
+        udp.write(buffer, 32);
+        udp.endPacket();
+        while (!udp.parsePacket() && ((micros() - start) < 500000)) {
+        }
+        if (udp.available()) {
+            samples[count++] = micros() - start;
+        }
+    }
+    printLatency("UDP latency", samples, count);
+    udp.stop();
+}
+
+void benchMqttPublish() {
+    WiFiClient wifiClient;
+    PubSubClient mqtt(wifiClient);
+    uint32_t published = 0;
+
+    mqtt.setServer(benchHost, 1883);
+    mqtt.setBufferSize(MQTT_PAYLOAD_SIZE + 64);
+    if (!mqtt.connect("amebaBenchmark")) {
+        Serial.println("MQTT publish: connect failed");
+        return;
+    }
+    memset(buffer, 'M', MQTT_PAYLOAD_SIZE);
+    uint32_t start = millis();
+    for (; published < MQTT_MESSAGES; published++) {
+        if (!mqtt.publish("bench/ameba", buffer, MQTT_PAYLOAD_SIZE)) {
+            break;
+        }
+        mqtt.loop();
+    }
+    printRate("MQTT publish", published, millis() - start, " messages/s");
+    mqtt.disconnect();
+}
+
+void benchHttpGet() {
+    WiFiClient wifiClient;
+    HttpClient http(wifiClient);
+    uint32_t received = 0;
+
+    uint32_t start = millis();
+    if ((http.get(benchHostName, 8000, HTTP_PATH) != 0) || (http.responseStatusCode() != 200) || (http.skipResponseHeaders() < 0)) {
+        Serial.println("HTTP GET: request failed");
+        http.stop();
+        return;
+    }
+    int length = http.contentLength();
+    while ((length < 0) || (received < (uint32_t)length)) {
+        int n = http.read(buffer, sizeof(buffer));
+        if (n <= 0) {
+            if (!http.connected()) {
+                break;
+            }
+            continue;
+        }
+        received += n;
+    }
+    printResult("HTTP GET", received, millis() - start);
+    http.stop();
+}
+
+void runTest(void (*test)(void)) {
+    NetStats.reset();
+    test();
+    NetStats.sample();
+    for (int i = 0; i < NetStats.poolCount(); i++) {
+        if (NetStats.poolPeak(i) == 0) {
+            continue;
+        }
+        Serial.print("    ");
+        Serial.print(NetStats.poolName(i));
+        Serial.print(" peak ");
+        Serial.print(NetStats.poolPeak(i));
+        Serial.print("/");
+        Serial.print(NetStats.poolTotal(i));
+        if (NetStats.poolExhausted(i)) {
+            Serial.print(", empty in ");
+            Serial.print(NetStats.poolExhausted(i));
+            Serial.print(" samples");
+        }
+        Serial.println();
+    }
+    Serial.print("    TCP retransmissions ");
+    Serial.println(NetStats.tcpRetransmissions());
+}
+
+void setup() {
+    Serial.begin(115200);
+
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+        delay(2000);
+    }
+    Serial.print("IP Address: ");
+    Serial.println(WiFi.localIP());
+    Serial.print("RSSI: ");
+    Serial.println(WiFi.RSSI());
+
+    // sample pools often enough to catch the peaks of each test
+    NetStats.begin(20);
+
+    runTest(benchTcpSend);
+    runTest(benchTcpRecv);
+    runTest(benchTcpLatency);
+    runTest(benchUdpSend);
+    runTest(benchUdpLatency);
+    runTest(benchMqttPublish);
+    runTest(benchHttpGet);
+
+    NetStats.end();
+    Serial.println("Benchmark done");
+}
+
+void loop() {
+    delay(1000);
+}
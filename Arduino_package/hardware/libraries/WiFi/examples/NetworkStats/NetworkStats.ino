@@ -0,0 +1,66 @@
+/*
+ This example prints lwIP memory pool and TCP queue usage while
+ uploading to a TCP server, and shows how to size the buffers of a
+ bulk connection and a control connection differently.
+
+ Start a TCP sink on the server first, for example: nc -l -k 5001 > /dev/null
+ */
+
+#include <WiFi.h>
+#include <NetStats.h>
+
+char ssid[] = "Network_SSID";       // your network SSID (name)
+char pass[] = "Password";           // your network password
+int status = WL_IDLE_STATUS;        // Indicater of Wifi status
+
+IPAddress server(192, 168, 1, 100); // server running the TCP sink
+uint16_t bulkPort = 5001;
+uint16_t controlPort = 5002;
+
+WiFiClient bulk;
+WiFiClient control;
+uint8_t payload[1460];
+uint32_t lastPrint = 0;
+
+void setup() {
+    Serial.begin(115200);
+
+    while (status != WL_CONNECTED) {
+        Serial.print("Attempting to connect to SSID: ");
+        Serial.println(ssid);
+        status = WiFi.begin(ssid, pass);
+        delay(2000);
+    }
+
+    // sample every 100 ms so short pool bursts show up in the peaks, print every 5 s from loop()
+    NetStats.begin(100);
+
+    if (bulk.connect(server, bulkPort)) {
+        // the bulk stream may keep 16 KB in flight
+        bulk.setSendBufferSize(16 * 1024);
+    }
+    if (control.connect(server, controlPort)) {
+        // the control connection only needs a small window in both directions
+        control.setSendBufferSize(2 * 1024);
+        Serial.print("Control receive window: ");
+        Serial.println(control.setRecvBufferSize(2 * 1024));
+    }
+    memset(payload, 'A', sizeof(payload));
+}
+
+void loop() {
+    if (bulk.connected()) {
+        bulk.write(payload, sizeof(payload));
+    }
+
+    if ((millis() - lastPrint) > 5000) {
+        lastPrint = millis();
+        NetStats.printInfo();
+        if (bulk.connected()) {
+            NetStats.printSocket(bulk);
+        }
+        if (control.connected()) {
+            NetStats.printSocket(control);
+        }
+    }
+}
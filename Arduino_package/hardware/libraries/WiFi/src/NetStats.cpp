@@ -0,0 +1,177 @@
+#include "NetStats.h"
+
+static const char* const tcp_state_names[] = {
+    "CLOSED", "LISTEN", "SYN_SENT", "SYN_RCVD", "ESTABLISHED", "FIN_WAIT_1",
+    "FIN_WAIT_2", "CLOSE_WAIT", "CLOSING", "LAST_ACK", "TIME_WAIT"
+};
+
+NetStatsClass::NetStatsClass(void) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void NetStatsClass::samplerThread(const void* argument) {
+    NetStatsClass* self = (NetStatsClass*)argument;
+
+    while (self->_period) {
+        self->sample();
+        if (self->_print) {
+            self->printInfo();
+        }
+        delay(self->_period);
+    }
+    self->_thread = 0;
+    os_thread_terminate_arduino(os_thread_get_id_arduino());
+}
+
+void NetStatsClass::begin(uint32_t period, bool print) {
+    if (period == 0) {
+        end();
+        return;
+    }
+    if (_lock == 0) {
+        _lock = os_semaphore_create_arduino(1);
+    }
+    _print = print;
+    _period = period;
+    if (_thread == 0) {
+        _thread = os_thread_create_arduino(samplerThread, this, OS_PRIORITY_LOW, 1024);
+        if (_thread == 0) {
+            printf("\r\n[ERROR] %s NetStats sampler thread create failed\n", __FUNCTION__);
+            _period = 0;
+        }
+    }
+}
+
+void NetStatsClass::end(void) {
+    // the sampler thread exits after its current delay
+    _period = 0;
+}
+
+bool NetStatsClass::sample(void) {
+    net_stats_t stats;
+
+    if (NetStatsSample(&stats) < 0) {
+        return false;
+    }
+    if (_lock) {
+        os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    }
+    memcpy(&_stats, &stats, sizeof(net_stats_t));
+    if (_lock) {
+        os_semaphore_release_arduino(_lock);
+    }
+    return true;
+}
+
+void NetStatsClass::reset(void) {
+    NetStatsReset();
+    sample();
+}
+
+uint8_t NetStatsClass::poolCount(void) {
+    return _stats.pool_count;
+}
+
+int NetStatsClass::poolIndex(const char* name) {
+    for (int i = 0; i < _stats.pool_count; i++) {
+        if ((_stats.pools[i].name != NULL) && (strcmp(_stats.pools[i].name, name) == 0)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char* NetStatsClass::poolName(uint8_t index) {
+    return (index < _stats.pool_count) ? _stats.pools[index].name : "";
+}
+
+uint16_t NetStatsClass::poolSize(uint8_t index) {
+    return (index < _stats.pool_count) ? _stats.pools[index].size : 0;
+}
+
+uint16_t NetStatsClass::poolTotal(uint8_t index) {
+    return (index < _stats.pool_count) ? _stats.pools[index].num : 0;
+}
+
+uint16_t NetStatsClass::poolUsed(uint8_t index) {
+    return (index < _stats.pool_count) ? _stats.pools[index].used : 0;
+}
+
+uint16_t NetStatsClass::poolPeak(uint8_t index) {
+    return (index < _stats.pool_count) ? _stats.pools[index].peak : 0;
+}
+
+uint32_t NetStatsClass::poolExhausted(uint8_t index) {
+    return (index < _stats.pool_count) ? _stats.pools[index].exhausted : 0;
+}
+
+uint16_t NetStatsClass::tcpConnections(void) {
+    return _stats.tcp.pcbs;
+}
+
+uint32_t NetStatsClass::tcpUnsent(void) {
+    return _stats.tcp.unsent;
+}
+
+uint32_t NetStatsClass::tcpUnacked(void) {
+    return _stats.tcp.unacked;
+}
+
+uint16_t NetStatsClass::tcpOutOfOrder(void) {
+    return _stats.tcp.ooseq;
+}
+
+uint16_t NetStatsClass::tcpOutOfOrderPeak(void) {
+    return _stats.tcp.ooseq_peak;
+}
+
+uint32_t NetStatsClass::tcpRetransmissions(void) {
+    return _stats.tcp.rtx;
+}
+
+bool NetStatsClass::socketInfo(WiFiClient& client, net_sock_info_t* info) {
+    return socketInfo(client.getSocket(), info);
+}
+
+bool NetStatsClass::socketInfo(int sock, net_sock_info_t* info) {
+    return (NetSockGetInfo(sock, info) == 0);
+}
+
+void NetStatsClass::printInfo(void) {
+    net_stats_t stats;
+
+    if (_lock) {
+        os_semaphore_wait_arduino(_lock, 0xFFFFFFFF);
+    }
+    memcpy(&stats, &_stats, sizeof(net_stats_t));
+    if (_lock) {
+        os_semaphore_release_arduino(_lock);
+    }
+
+    printf("\r\n------------------------------------------\r\n");
+    printf("Network Stats (sample %lu):\r\n", stats.samples);
+    printf("%-16s %6s %6s %6s %6s %8s\r\n", "pool", "size", "total", "used", "peak", "empty");
+    for (int i = 0; i < stats.pool_count; i++) {
+        net_pool_stats_t* pool = &stats.pools[i];
+        printf("%-16s %6u %6u %6u %6u %8lu\r\n", pool->name, pool->size, pool->num, pool->used, pool->peak, pool->exhausted);
+    }
+    printf("TCP connections: %u\r\n", stats.tcp.pcbs);
+    printf("TCP unsent / unacked: %lu / %lu bytes\r\n", stats.tcp.unsent, stats.tcp.unacked);
+    printf("TCP out-of-order segments: %u (peak %u)\r\n", stats.tcp.ooseq, stats.tcp.ooseq_peak);
+    printf("TCP retransmissions: %lu (%u connections retransmitting)\r\n", stats.tcp.rtx, stats.tcp.rtx_pcbs);
+    printf("------------------------------------------\r\n");
+}
+
+void NetStatsClass::printSocket(WiFiClient& client) {
+    net_sock_info_t info;
+
+    if (!socketInfo(client, &info)) {
+        printf("\r\n[INFO] Socket %d is not a TCP connection\n", client.getSocket());
+        return;
+    }
+    printf("Socket %d: %s, mss %u, cwnd %lu\r\n", client.getSocket(), (info.state < 11) ? tcp_state_names[info.state] : "?", info.mss, info.cwnd);
+    printf("  send queued %lu, free %lu, pbufs %u, retransmits %u\r\n", info.snd_queued, info.snd_free, info.snd_queuelen, info.nrtx);
+    printf("  receive window %lu / %lu, out-of-order %u\r\n", info.rcv_wnd, info.rcv_wnd_max, info.ooseq);
+}
+
+NetStatsClass NetStats;
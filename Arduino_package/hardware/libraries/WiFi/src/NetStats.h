@@ -0,0 +1,65 @@
+#ifndef NetStats_h
+#define NetStats_h
+
+#include <Arduino.h>
+#include "WiFiClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "net_stats_drv.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+// Runtime view of the lwIP memory pools and TCP queues.
+// Pool peaks and exhaustion counts come from sampling, so a periodic sampler
+// started with begin() catches short bursts that single sample() calls miss.
+class NetStatsClass {
+    public:
+        NetStatsClass(void);
+
+        // Sample every period ms in the background, optionally printing each sample
+        void begin(uint32_t period = 1000, bool print = false);
+        void end(void);
+
+        bool sample(void);
+        void reset(void);
+
+        uint8_t poolCount(void);
+        int poolIndex(const char* name);
+        const char* poolName(uint8_t index);
+        uint16_t poolSize(uint8_t index);
+        uint16_t poolTotal(uint8_t index);
+        uint16_t poolUsed(uint8_t index);
+        uint16_t poolPeak(uint8_t index);
+        uint32_t poolExhausted(uint8_t index);
+
+        uint16_t tcpConnections(void);
+        uint32_t tcpUnsent(void);
+        uint32_t tcpUnacked(void);
+        uint16_t tcpOutOfOrder(void);
+        uint16_t tcpOutOfOrderPeak(void);
+        uint32_t tcpRetransmissions(void);
+
+        bool socketInfo(WiFiClient& client, net_sock_info_t* info);
+        bool socketInfo(int sock, net_sock_info_t* info);
+
+        void printInfo(void);
+        void printSocket(WiFiClient& client);
+
+    private:
+        static void samplerThread(const void* argument);
+
+        net_stats_t _stats;
+        uint32_t _lock = 0;
+        volatile uint32_t _period = 0;
+        volatile bool _print = false;
+        uint32_t _thread = 0;
+};
+
+extern NetStatsClass NetStats;
+
+#endif
@@ -23,6 +23,7 @@
 
 #include "wifi_drv.h"
 #include "wiring.h"
+#include "boot_phase.h"
 
 WiFiClass::WiFiClass() {
 }
@@ -46,6 +47,10 @@ int WiFiClass::begin(char* ssid) {
 
     if ((WiFiDrv::wifiSetNetwork(ssid, (strlen(ssid)))) != WL_FAILURE) {
         status = WiFiDrv::getConnectionStatus();
+        startDnsCache();
+        if (status == WL_CONNECTED) {
+            bootMark("wifi_connected");
+        }
     } else {
         status = WL_CONNECT_FAILED;
     }
@@ -62,6 +67,10 @@ int WiFiClass::begin(char* ssid, uint8_t key_idx, const char *key) {
     // set encryption key
     if (WiFiDrv::wifiSetKey(ssid, strlen(ssid), key_idx, key, strlen(key)) != WL_FAILURE) {
         status = WiFiDrv::getConnectionStatus();
+        startDnsCache();
+        if (status == WL_CONNECTED) {
+            bootMark("wifi_connected");
+        }
     } else {
         status = WL_CONNECT_FAILED;
     }
@@ -78,6 +87,10 @@ int WiFiClass::begin(char* ssid, const char *passphrase) {
     // set passphrase
     if (WiFiDrv::wifiSetPassphrase(ssid, strlen(ssid), passphrase, strlen(passphrase))!= WL_FAILURE) {
          status = WiFiDrv::getConnectionStatus();
+         startDnsCache();
+         if (status == WL_CONNECTED) {
+             bootMark("wifi_connected");
+         }
     } else {
         status = WL_CONNECT_FAILED;
     }
@@ -179,6 +192,41 @@ int WiFiClass::hostByName(const char* aHostname, IPAddress& aResult) {
     return WiFiDrv::getHostByName(aHostname, aResult);
 }
 
+int WiFiClass::resolveAsync(const char* aHostname, dns_cache_cb_t callback, void* arg) {
+    return DnsCacheResolveAsync(aHostname, callback, arg);
+}
+
+int WiFiClass::preresolve(const char* aHostname) {
+    int ret = DnsCacheAddPreresolve(aHostname);
+    // already connected, no begin() will follow to resolve it
+    if ((ret == 0) && (status() == WL_CONNECTED)) {
+        DnsCacheResolveAsync(aHostname, NULL, NULL);
+    }
+    return ret;
+}
+
+void WiFiClass::setDnsNegativeTtl(uint32_t seconds) {
+    DnsCacheSetNegativeTtl(seconds);
+}
+
+void WiFiClass::setDnsServeStale(uint32_t seconds) {
+    DnsCacheSetServeStale(seconds);
+}
+
+void WiFiClass::flushDnsCache() {
+    DnsCacheFlush();
+}
+
+void WiFiClass::printDnsCache() {
+    DnsCachePrint();
+}
+
+// Answers from the previous network may not hold on this one
+void WiFiClass::startDnsCache() {
+    DnsCacheFlush();
+    DnsCachePreresolve();
+}
+
 //int WiFiClass::hostByNamev6(const char* aHostname, IPv6Address& aResult)
 //{
 //    printf("\r\n[INFO] wifi.cpp: hostByNamev6()\n");
@@ -230,6 +278,18 @@ int WiFiClass::disablePowerSave() {
     return WiFiDrv::disablePowerSave();
 }
 
+void WiFiClass::enableFastConnect(bool reuseLease) {
+    WiFiDrv::fastConnectEnable(true, reuseLease);
+}
+
+void WiFiClass::disableFastConnect(void) {
+    WiFiDrv::fastConnectEnable(false, false);
+}
+
+void WiFiClass::clearFastConnect(void) {
+    WiFiDrv::fastConnectClear();
+}
+
 void WiFiClass::config(IPAddress local_ip) {
     WiFiDrv::config(1, local_ip, IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
 }
@@ -26,18 +26,21 @@
 extern "C" {
     #include "wl_definitions.h"
     #include "wl_types.h"
+    #include "dns_cache_drv.h"
 }
 
 #include "IPAddress.h"
 //#include "IPv6Address.h"
 #include "WiFiClient.h"
 #include "WiFiServer.h"
+#include "WiFiEventServer.h"
 #include "WiFiSSLClient.h"
 #include "WiFiUdp.h"
 
 class WiFiClass {
     private:
         static void init();
+        static void startDnsCache();
     public:
         WiFiClass();
         ~WiFiClass();
@@ -252,6 +255,36 @@ class WiFiClass {
          */
         int hostByName(const char* aHostname, IPAddress& aResult);
 
+        /*
+         * Resolve the given hostname without blocking.
+         * Answers are cached for the TTL given by the DNS server, names that do not exist for the negative TTL.
+         * param aHostname: Name to be resolved
+         * param callback: Called with the address in network byte order, i.e. IPAddress(ip), and a DNS_CACHE_* result.
+         *                 Runs in the resolver task, or before returning if the name was cached
+         * param arg: Passed to the callback
+         * result: 1 if answered from the cache, 0 if queued, -1 if the request could not be queued
+         */
+        int resolveAsync(const char* aHostname, dns_cache_cb_t callback, void* arg = NULL);
+
+        /*
+         * Keep the given hostname resolved ahead of use, it is resolved in the background after every begin()
+         * result: 0 if successful, -1 if the list of DNS_CACHE_MAX_PRERESOLVE names is full
+         */
+        int preresolve(const char* aHostname);
+
+        /*
+         * Seconds a name that does not exist is remembered, 0 disables negative caching
+         */
+        void setDnsNegativeTtl(uint32_t seconds);
+
+        /*
+         * Keep answering with an expired address for up to the given seconds while it is refreshed in the background
+         */
+        void setDnsServeStale(uint32_t seconds);
+
+        void flushDnsCache();
+        void printDnsCache();
+
 #if 0
         /*
          * Resolve the given hostname to an IPv6 address.
@@ -269,6 +302,21 @@ class WiFiClass {
 
         int disablePowerSave();
 
+        /*
+         * Remember the AP channel, BSSID, PSK and DHCP address of the next
+         * successful connection so that later begin() calls, including the
+         * one after waking from deep sleep, skip the scan and key derivation
+         * param reuseLease: request the previous DHCP address before falling back to full DHCP
+         */
+        void enableFastConnect(bool reuseLease = true);
+
+        void disableFastConnect(void);
+
+        /*
+         * Erase the connection info saved for fast connect
+         */
+        void clearFastConnect(void);
+
         void setHostname(const char* hostname);
 
         const char* getHostname();
@@ -5,6 +5,8 @@ extern "C" {
     #include "wl_definitions.h"
     #include "wl_types.h"
     #include "string.h"
+    #include "net_stats_drv.h"
+    #include "ard_socket.h"
 //    #include "update.h"
 }
 
@@ -12,6 +14,8 @@ extern "C" {
 #include "WiFiServer.h"
 #include "server_drv.h"
 
+#define SEND_QUEUE_TIMEOUT  30000
+
 WiFiClient::WiFiClient() : _sock(MAX_SOCK_NUM) {
     _is_connected = false;
     recvTimeout = 3000;
@@ -19,6 +23,7 @@ WiFiClient::WiFiClient() : _sock(MAX_SOCK_NUM) {
 
 WiFiClient::WiFiClient(uint8_t sock) {
     _sock = sock;
+    _is_connected = false;
     if ((sock >= 0) && (sock != 0xFF)) {
 //    if (sock != 0xFF) {
         _is_connected = true;
@@ -40,6 +45,7 @@ WiFiClient::WiFiClient(tBlockingMode blockMode) : _sock(MAX_SOCK_NUM) {
 
 WiFiClient::WiFiClient(uint8_t sock, tProtMode portMode) {
     _sock = sock;
+    _is_connected = false;
     if ((sock >= 0) && (sock != 0xFF)) {
         _is_connected = true;
     }
@@ -49,6 +55,7 @@ WiFiClient::WiFiClient(uint8_t sock, tProtMode portMode) {
 
 WiFiClient::WiFiClient(uint8_t sock, tProtMode portMode, tBlockingMode blockMode) {
     _sock = sock;
+    _is_connected = false;
     if ((sock >= 0) && (sock != 0xFF)) {
         _is_connected = true;
     }
@@ -90,6 +97,8 @@ try_again:
         } else {
             err = clientdrv.getLastErrno(_sock);
             if (err == EAGAIN) {
+                // sleep until lwIP has something for this socket instead of peeking again straight away
+                waitReadable(0xFFFFFFFF);
                 goto try_again;
             }
             if (err != 0) {
@@ -101,6 +110,24 @@ try_again:
     return 0;
 }
 
+// Returns true when the socket has data, an error or the peer closed it
+bool WiFiClient::waitReadable(uint32_t timeout) {
+    int sock = _sock;
+    uint8_t events = ARD_SOCK_READ;
+
+    return (clientdrv.selectSockets(&sock, &events, 1, timeout) > 0);
+}
+
+bool WiFiClient::waitAvailable(unsigned long timeout) {
+    if (!_is_connected) {
+        return false;
+    }
+    if (!waitReadable(timeout)) {
+        return false;
+    }
+    return (available() > 0);
+}
+
 int WiFiClient::read() {
     int ret;
     int err;
@@ -184,12 +211,52 @@ size_t WiFiClient::write(const uint8_t *buf, size_t size) {
         return 0;
     }
 
-    if (!clientdrv.sendData(_sock, buf, size)) {
-        setWriteError();
-        _is_connected = false;
-        return 0;
+    if (_sndbuf_size == 0) {
+        if (!clientdrv.sendData(_sock, buf, size)) {
+            setWriteError();
+            _is_connected = false;
+            return 0;
+        }
+        return size;
     }
-    return size;
+
+    // keep at most _sndbuf_size bytes in flight so this connection can not drain the TCP segment pools
+    size_t sent = 0;
+    uint32_t start = millis();
+    while (sent < size) {
+        size_t chunk = size - sent;
+        int queued = NetSockGetSendQueued(_sock);
+        if ((queued >= 0) && ((uint32_t)queued >= _sndbuf_size)) {
+            if ((millis() - start) > SEND_QUEUE_TIMEOUT) {
+                break;
+            }
+            delay(1);
+            continue;
+        }
+        if ((queued >= 0) && (chunk > (_sndbuf_size - queued))) {
+            chunk = _sndbuf_size - queued;
+        }
+        if (!clientdrv.sendData(_sock, (buf + sent), chunk)) {
+            setWriteError();
+            _is_connected = false;
+            break;
+        }
+        sent += chunk;
+        start = millis();
+    }
+    return sent;
+}
+
+int WiFiClient::getSocket() {
+    return ((_sock == 0xFF) ? -1 : _sock);
+}
+
+int WiFiClient::setRecvBufferSize(uint32_t size) {
+    return NetSockSetRecvWindow(getSocket(), size);
+}
+
+void WiFiClient::setSendBufferSize(uint32_t size) {
+    _sndbuf_size = size;
 }
 
 WiFiClient::operator bool() {
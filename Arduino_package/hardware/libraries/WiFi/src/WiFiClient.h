@@ -20,6 +20,8 @@ class WiFiClient : public Client {
         uint8_t status();
         virtual uint8_t connected();
         virtual int available();
+        // Sleep in lwIP until data arrives, the peer closes or timeout ms have passed
+        virtual bool waitAvailable(unsigned long timeout);
         virtual int read();
         virtual int read(uint8_t *buf, size_t size);
         virtual int recv(uint8_t *buf, size_t size);
@@ -37,6 +39,11 @@ class WiFiClient : public Client {
         // extend API from RTK
         int setRecvTimeout(int timeout);
         int read(char *buf, size_t size);
+        int getSocket();
+        // Limit the TCP receive window of this connection, up to TCP_WND. Returns the window applied
+        int setRecvBufferSize(uint32_t size);
+        // Limit the bytes this connection keeps queued unacknowledged, write() waits for ACKs beyond it
+        void setSendBufferSize(uint32_t size);
         // IPv6 related
         //int enableIPv6();
         //int getIPv6Status();
@@ -45,11 +52,14 @@ class WiFiClient : public Client {
         using Print::write;
 
     private:
+        bool waitReadable(uint32_t timeout);
+
         uint8_t _sock;
         ServerDrv clientdrv;
         bool _is_connected;
         uint8_t data[DATA_LENTH];
         int recvTimeout;
+        uint32_t _sndbuf_size = 0;
         tProtMode _portMode = TCP_MODE;
         tBlockingMode _is_blocked = BLOCKING_MODE;
 };
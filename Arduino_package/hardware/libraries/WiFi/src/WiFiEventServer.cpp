@@ -0,0 +1,289 @@
+#include "WiFiEventServer.h"
+#include "errno.h"
+
+extern "C" {
+#include "ard_socket.h"
+}
+
+WiFiEventServer::WiFiEventServer(uint8_t maxClients) {
+    _callback = NULL;
+    _max_clients = maxClients ? maxClients : 1;
+    _listener_count = 0;
+    _client_count = 0;
+    _idle_timeout = 0;
+    _conn = NULL;
+    _socks = NULL;
+    _events = NULL;
+    for (int i = 0; i < WIFI_EVENT_SERVER_MAX_LISTENERS; i++) {
+        _listen_sock[i] = -1;
+        _listen_port[i] = 0;
+    }
+}
+
+WiFiEventServer::~WiFiEventServer() {
+    end();
+}
+
+int WiFiEventServer::listen(uint16_t port) {
+    int sock;
+
+    if (_listener_count >= WIFI_EVENT_SERVER_MAX_LISTENERS) {
+        printf("\r\n[ERROR] %s Too many listening ports\n", __FUNCTION__);
+        return 0;
+    }
+    if (_conn == NULL) {
+        _conn = (connection_t*)malloc(_max_clients * sizeof(connection_t));
+        _socks = (int*)malloc((WIFI_EVENT_SERVER_MAX_LISTENERS + _max_clients) * sizeof(int));
+        _events = (uint8_t*)malloc(WIFI_EVENT_SERVER_MAX_LISTENERS + _max_clients);
+        if ((_conn == NULL) || (_socks == NULL) || (_events == NULL)) {
+            printf("\r\n[ERROR] %s Connection table allocation failed\n", __FUNCTION__);
+            end();
+            return 0;
+        }
+        memset(_conn, 0, (_max_clients * sizeof(connection_t)));
+    }
+
+    // the listening socket is non-blocking so accepting never waits for a client
+    sock = serverdrv.startServer(port, TCP_MODE, NON_BLOCKING_MODE, WIFI_EVENT_SERVER_BACKLOG);
+    if (sock < 0) {
+        printf("\r\n[ERROR] %s Listen on port %d failed\n", __FUNCTION__, port);
+        return 0;
+    }
+    _listen_sock[_listener_count] = sock;
+    _listen_port[_listener_count] = port;
+    _listener_count++;
+    return 1;
+}
+
+void WiFiEventServer::end() {
+    if (_conn != NULL) {
+        for (uint8_t id = 0; id < _max_clients; id++) {
+            release(id);
+        }
+    }
+    for (int i = 0; i < _listener_count; i++) {
+        serverdrv.stopSocket(_listen_sock[i]);
+        _listen_sock[i] = -1;
+        _listen_port[i] = 0;
+    }
+    _listener_count = 0;
+    free(_conn);
+    free(_socks);
+    free(_events);
+    _conn = NULL;
+    _socks = NULL;
+    _events = NULL;
+}
+
+void WiFiEventServer::setCallback(WiFiServerEventCallback callback) {
+    _callback = callback;
+}
+
+void WiFiEventServer::setIdleTimeout(uint32_t timeout) {
+    _idle_timeout = timeout;
+}
+
+void WiFiEventServer::setIdleTimeout(uint8_t id, uint32_t timeout) {
+    if ((id < _max_clients) && (_conn != NULL) && (_conn[id].client != NULL)) {
+        _conn[id].idle_timeout = timeout;
+    }
+}
+
+void WiFiEventServer::notifyWritable(uint8_t id, bool enable) {
+    if ((id < _max_clients) && (_conn != NULL) && (_conn[id].client != NULL)) {
+        _conn[id].writable = enable;
+    }
+}
+
+void WiFiEventServer::close(uint8_t id) {
+    release(id);
+}
+
+WiFiClient* WiFiEventServer::client(uint8_t id) {
+    if ((id >= _max_clients) || (_conn == NULL)) {
+        return NULL;
+    }
+    return _conn[id].client;
+}
+
+IPAddress WiFiEventServer::remoteIP(uint8_t id) {
+    if ((id >= _max_clients) || (_conn == NULL) || (_conn[id].client == NULL)) {
+        return IPAddress(0, 0, 0, 0);
+    }
+    return IPAddress(_conn[id].peer_ip);
+}
+
+uint16_t WiFiEventServer::remotePort(uint8_t id) {
+    if ((id >= _max_clients) || (_conn == NULL) || (_conn[id].client == NULL)) {
+        return 0;
+    }
+    return _conn[id].peer_port;
+}
+
+uint16_t WiFiEventServer::localPort(uint8_t id) {
+    if ((id >= _max_clients) || (_conn == NULL) || (_conn[id].client == NULL)) {
+        return 0;
+    }
+    return _listen_port[_conn[id].listener];
+}
+
+uint8_t WiFiEventServer::clientCount() {
+    return _client_count;
+}
+
+void WiFiEventServer::release(uint8_t id) {
+    if ((id >= _max_clients) || (_conn == NULL) || (_conn[id].client == NULL)) {
+        return;
+    }
+    // the client closes its socket when deleted, unless the sketch already stopped it
+    delete _conn[id].client;
+    memset(&_conn[id], 0, sizeof(connection_t));
+    _conn[id].sock = -1;
+    _client_count--;
+}
+
+void WiFiEventServer::dispatch(WiFiServerEvent event, uint8_t id) {
+    if (_callback) {
+        _callback(event, id, *_conn[id].client, _listen_port[_conn[id].listener]);
+    }
+}
+
+void WiFiEventServer::acceptClients(uint8_t listener) {
+    int sock;
+    uint8_t id;
+
+    while ((sock = serverdrv.getAvailable(_listen_sock[listener])) >= 0) {
+        for (id = 0; id < _max_clients; id++) {
+            if (_conn[id].client == NULL) {
+                break;
+            }
+        }
+        if (id >= _max_clients) {
+            printf("\r\n[ERROR] %s Connection table full, client rejected\n", __FUNCTION__);
+            serverdrv.stopSocket(sock);
+            continue;
+        }
+        _conn[id].client = new WiFiClient((uint8_t)sock);
+        if (_conn[id].client == NULL) {
+            serverdrv.stopSocket(sock);
+            return;
+        }
+        _conn[id].sock = sock;
+        _conn[id].listener = listener;
+        _conn[id].writable = false;
+        _conn[id].idle_timeout = _idle_timeout;
+        _conn[id].last_activity = millis();
+        serverdrv.getPeerAddr(sock, &_conn[id].peer_ip, &_conn[id].peer_port);
+        _client_count++;
+
+        dispatch(WIFI_SERVER_EVENT_ACCEPT, id);
+        if ((_conn[id].client != NULL) && !_conn[id].client->connected()) {
+            release(id);
+        }
+    }
+}
+
+// Shorten the select timeout so idle clients are closed on time
+uint32_t WiFiEventServer::nextTimeout(uint32_t timeout) {
+    uint32_t now = millis();
+
+    for (uint8_t id = 0; id < _max_clients; id++) {
+        connection_t* conn = &_conn[id];
+        if ((conn->client == NULL) || (conn->idle_timeout == 0)) {
+            continue;
+        }
+        uint32_t elapsed = now - conn->last_activity;
+        uint32_t remaining = (elapsed >= conn->idle_timeout) ? 0 : (conn->idle_timeout - elapsed);
+        if (remaining < timeout) {
+            timeout = remaining;
+        }
+    }
+    return timeout;
+}
+
+int WiFiEventServer::checkTimeouts() {
+    int count = 0;
+    uint32_t now = millis();
+
+    for (uint8_t id = 0; id < _max_clients; id++) {
+        connection_t* conn = &_conn[id];
+        if ((conn->client == NULL) || (conn->idle_timeout == 0)) {
+            continue;
+        }
+        if ((now - conn->last_activity) >= conn->idle_timeout) {
+            dispatch(WIFI_SERVER_EVENT_TIMEOUT, id);
+            release(id);
+            count++;
+        }
+    }
+    return count;
+}
+
+int WiFiEventServer::poll(uint32_t timeout) {
+    int count = 0;
+    int n = 0;
+    int ret;
+
+    if ((_conn == NULL) || (_listener_count == 0)) {
+        return 0;
+    }
+
+    for (int i = 0; i < _listener_count; i++) {
+        _socks[n] = _listen_sock[i];
+        _events[n++] = ARD_SOCK_READ;
+    }
+    for (uint8_t id = 0; id < _max_clients; id++) {
+        if (_conn[id].client != NULL) {
+            _socks[n] = _conn[id].sock;
+            _events[n++] = ARD_SOCK_READ | (_conn[id].writable ? ARD_SOCK_WRITE : 0);
+        } else {
+            _socks[n] = -1;
+            _events[n++] = 0;
+        }
+    }
+
+    ret = serverdrv.selectSockets(_socks, _events, n, nextTimeout(timeout));
+    if (ret > 0) {
+        for (uint8_t i = 0; i < _listener_count; i++) {
+            if (_events[i] & ARD_SOCK_READ) {
+                uint8_t before = _client_count;
+                acceptClients(i);
+                count += (_client_count > before) ? (_client_count - before) : 0;
+            }
+        }
+        for (uint8_t id = 0; id < _max_clients; id++) {
+            connection_t* conn = &_conn[id];
+            uint8_t ready = _events[_listener_count + id];
+            // skip slots that were empty when select started or were reused by an accept above
+            if ((ready == 0) || (conn->client == NULL) || (conn->sock != _socks[_listener_count + id])) {
+                continue;
+            }
+            bool closed = (ready & ARD_SOCK_ERROR);
+            if (!closed && (ready & ARD_SOCK_READ)) {
+                ret = serverdrv.peekAvailable(conn->sock);
+                if (ret > 0) {
+                    conn->last_activity = millis();
+                    dispatch(WIFI_SERVER_EVENT_READABLE, id);
+                    count++;
+                } else if ((ret == 0) || (serverdrv.getLastErrno(conn->sock) != EAGAIN)) {
+                    closed = true;
+                }
+            }
+            if (!closed && (conn->client != NULL) && (ready & ARD_SOCK_WRITE) && conn->writable) {
+                dispatch(WIFI_SERVER_EVENT_WRITABLE, id);
+                count++;
+            }
+            if (closed) {
+                dispatch(WIFI_SERVER_EVENT_CLOSED, id);
+                release(id);
+                count++;
+            } else if ((conn->client != NULL) && !conn->client->connected()) {
+                // stopped by the sketch inside the callback
+                release(id);
+            }
+        }
+    }
+
+    count += checkTimeouts();
+    return count;
+}
@@ -0,0 +1,89 @@
+#ifndef WiFiEventServer_h
+#define WiFiEventServer_h
+
+#include <Arduino.h>
+#include "IPAddress.h"
+#include "server_drv.h"
+#include "WiFiClient.h"
+
+#define WIFI_EVENT_SERVER_MAX_LISTENERS     4
+#define WIFI_EVENT_SERVER_MAX_CLIENTS       16
+#define WIFI_EVENT_SERVER_BACKLOG           4
+
+typedef enum {
+    WIFI_SERVER_EVENT_ACCEPT = 0,       // new client in the table
+    WIFI_SERVER_EVENT_READABLE,         // data waiting, read it with client.read()
+    WIFI_SERVER_EVENT_WRITABLE,         // send buffer has room, only raised after notifyWritable()
+    WIFI_SERVER_EVENT_CLOSED,           // peer closed or socket error, the slot is freed after the callback
+    WIFI_SERVER_EVENT_TIMEOUT,          // idle timeout expired, the slot is freed after the callback
+} WiFiServerEvent;
+
+// id is the connection table slot, port is the local port the client connected to
+typedef void (*WiFiServerEventCallback)(WiFiServerEvent event, uint8_t id, WiFiClient& client, uint16_t port);
+
+// TCP server that serves several listening ports and all of their clients from
+// one task. Each poll() waits on every socket with a single select and
+// dispatches the ready ones to the callback, so no call blocks on one client.
+class WiFiEventServer {
+    public:
+        WiFiEventServer(uint8_t maxClients = WIFI_EVENT_SERVER_MAX_CLIENTS);
+        ~WiFiEventServer();
+
+        // Start listening on port, may be called for up to WIFI_EVENT_SERVER_MAX_LISTENERS ports
+        // Returns 1 if successful, 0 on failure
+        int listen(uint16_t port);
+        void end();
+
+        void setCallback(WiFiServerEventCallback callback);
+
+        // Close clients with no received data for timeout ms, 0 disables the timeout
+        void setIdleTimeout(uint32_t timeout);
+        void setIdleTimeout(uint8_t id, uint32_t timeout);
+
+        // Raise WIFI_SERVER_EVENT_WRITABLE for this client until disabled
+        void notifyWritable(uint8_t id, bool enable);
+
+        // Wait up to timeout ms for socket activity and dispatch it
+        // Returns the number of events dispatched
+        int poll(uint32_t timeout = 0);
+
+        void close(uint8_t id);
+        WiFiClient* client(uint8_t id);
+        IPAddress remoteIP(uint8_t id);
+        uint16_t remotePort(uint8_t id);
+        uint16_t localPort(uint8_t id);
+        uint8_t clientCount();
+
+    private:
+        typedef struct {
+            WiFiClient* client;
+            int sock;
+            uint8_t listener;
+            bool writable;
+            uint32_t idle_timeout;
+            uint32_t last_activity;
+            uint32_t peer_ip;
+            uint16_t peer_port;
+        } connection_t;
+
+        void acceptClients(uint8_t listener);
+        void dispatch(WiFiServerEvent event, uint8_t id);
+        void release(uint8_t id);
+        uint32_t nextTimeout(uint32_t timeout);
+        int checkTimeouts();
+
+        ServerDrv serverdrv;
+        WiFiServerEventCallback _callback;
+        uint8_t _max_clients;
+        uint8_t _listener_count;
+        uint8_t _client_count;
+        int _listen_sock[WIFI_EVENT_SERVER_MAX_LISTENERS];
+        uint16_t _listen_port[WIFI_EVENT_SERVER_MAX_LISTENERS];
+        uint32_t _idle_timeout;
+        connection_t* _conn;
+        // scratch arrays for select, listeners first then the connection table
+        int* _socks;
+        uint8_t* _events;
+};
+
+#endif
@@ -31,11 +31,90 @@ extern "C" {
 #endif
 
 /* Constructor */
-WiFiUDP::WiFiUDP() : _sock(-1), _client_sock(-1) {}
+WiFiUDP::WiFiUDP() : _sock(-1), _client_sock(-1), _port(0), _peer_port(0),
+    _tx_buf(NULL), _tx_size(UDP_DATAGRAM_MAX_SIZE), _tx_len(0),
+    _rx_slots(NULL), _rx_buf(NULL), _rx_depth(UDP_RX_QUEUE_DEPTH), _rx_slot_size(UDP_DATAGRAM_MAX_SIZE),
+    _rx_head(0), _rx_count(0), _rx_current(false), _rx_pos(0) {
+    memset(&_rx_last, 0, sizeof(_rx_last));
+}
 
 /* Destructor */
 WiFiUDP::~WiFiUDP() {
     stop();
+    freeBuffers();
+}
+
+bool WiFiUDP::allocRxQueue() {
+    if (_rx_slots != NULL) {
+        return true;
+    }
+    _rx_slots = (rx_slot_t *)malloc(_rx_depth * sizeof(rx_slot_t));
+    _rx_buf = (uint8_t *)malloc(_rx_depth * _rx_slot_size);
+    if ((_rx_slots == NULL) || (_rx_buf == NULL)) {
+        printf("\r\n[ERROR] %s UDP receive queue allocation failed\n", __FUNCTION__);
+        free(_rx_slots);
+        free(_rx_buf);
+        _rx_slots = NULL;
+        _rx_buf = NULL;
+        return false;
+    }
+    _rx_head = 0;
+    _rx_count = 0;
+    _rx_current = false;
+    _rx_pos = 0;
+    return true;
+}
+
+void WiFiUDP::freeBuffers() {
+    free(_rx_slots);
+    free(_rx_buf);
+    free(_tx_buf);
+    _rx_slots = NULL;
+    _rx_buf = NULL;
+    _tx_buf = NULL;
+    _rx_head = 0;
+    _rx_count = 0;
+    _rx_current = false;
+    _rx_pos = 0;
+    _tx_len = 0;
+}
+
+uint8_t *WiFiUDP::rxSlotData(uint8_t index) {
+    return (_rx_buf + ((uint32_t)index * _rx_slot_size));
+}
+
+void WiFiUDP::popRxQueue() {
+    if (_rx_count) {
+        _rx_head = (_rx_head + 1) % _rx_depth;
+        _rx_count--;
+    }
+    _rx_current = false;
+    _rx_pos = 0;
+}
+
+/* Move every datagram already waiting on the socket into free queue slots without blocking */
+int WiFiUDP::fillRxQueue() {
+    int received = 0;
+    uint32_t ip;
+    uint16_t port;
+
+    if ((_sock < 0) || (_rx_slots == NULL)) {
+        return 0;
+    }
+    while (_rx_count < _rx_depth) {
+        uint8_t index = (_rx_head + _rx_count) % _rx_depth;
+        int ret = serverDrv.recvfromData(_sock, rxSlotData(index), _rx_slot_size, true, &ip, &port);
+        if (ret < 0) {
+            break;
+        }
+        _rx_slots[index].len = ret;
+        _rx_slots[index].ip = ip;
+        _rx_slots[index].port = port;
+        _rx_slots[index].timestamp = millis();
+        _rx_count++;
+        received++;
+    }
+    return received;
 }
 
 /* Start WiFiUDP socket, listening at local port PORT */
@@ -50,11 +129,15 @@ uint8_t WiFiUDP::begin(uint16_t port) {
     // UDP start server as blocking mode
     _sock = serverDrv.startServer(port, UDP_MODE, BLOCKING_MODE);
 
-    if (_sock >= 0) {
-        return 1;
+    if (_sock < 0) {
+        return 0;
+    }
+    if (!allocRxQueue()) {
+        stop();
+        return 0;
     }
 
-    return 0;
+    return 1;
 }
 
 #if 0
@@ -93,17 +176,10 @@ int WiFiUDP::connect(const char *host, uint16_t port) {
 /* return number of bytes available in the current packet,
    will return zero if parsePacket hasn't been called yet */
 int WiFiUDP::available() {
-    int ret;
-
-    if (_sock >= 0) {
-        ret = serverDrv.availData(_sock);
-        if (ret > 0) {
-            return ret;
-        } else {
-            return 0;
-        }
+    if (!_rx_current) {
+        return 0;
     }
-    return 0;
+    return (_rx_slots[_rx_head].len - _rx_pos);
 }
 
 /* Release any resources being used by this WiFiUDP instance */
@@ -115,6 +191,11 @@ void WiFiUDP::stop() {
     serverDrv.stopSocket(_sock);
 
     _sock = -1;
+    _port = 0;
+    _rx_head = 0;
+    _rx_count = 0;
+    _rx_current = false;
+    _rx_pos = 0;
 }
 
 int WiFiUDP::beginPacket(const char *host, uint16_t port) {
@@ -138,12 +219,27 @@ int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
 
     if (_client_sock < 0) {
         return 0;
-    } else {
-        return 1;
     }
+
+    _tx_len = 0;
+    if (_tx_buf == NULL) {
+        _tx_buf = (uint8_t *)malloc(_tx_size);
+        if (_tx_buf == NULL) {
+            printf("\r\n[ERROR] %s UDP transmit buffer allocation failed\n", __FUNCTION__);
+            endPacket();
+            return 0;
+        }
+    }
+    return 1;
 }
 
+/* Send everything written since beginPacket as one datagram */
 int WiFiUDP::endPacket() {
+    int ret = 0;
+
+    if ((_client_sock >= 0) && (_tx_buf != NULL)) {
+        ret = serverDrv.sendtoData(_client_sock, _tx_buf, _tx_len, _peer_ip, _peer_port);
+    }
     if (_client_sock >= 0 && _client_sock != _sock) {
         serverDrv.stopSocket(_client_sock);
     }
@@ -151,16 +247,27 @@ int WiFiUDP::endPacket() {
     _peer_ip = IPAddress(0, 0, 0, 0);
     _peer_port = 0;
     _client_sock = -1;
+    _tx_len = 0;
 
-    return true;
+    return ret;
 }
 
 size_t WiFiUDP::write(uint8_t byte) {
     return write(&byte, 1);
 }
 
+/* Append to the datagram started by beginPacket, bytes that do not fit are not written */
 size_t WiFiUDP::write(const uint8_t *buffer, size_t size) {
-    return writeImmediately(buffer, size);
+    if ((_client_sock < 0) || (_tx_buf == NULL)) {
+        return 0;
+    }
+    if (size > (size_t)(_tx_size - _tx_len)) {
+        size = _tx_size - _tx_len;
+    }
+    memcpy((_tx_buf + _tx_len), buffer, size);
+    _tx_len += size;
+
+    return size;
 }
 
 size_t WiFiUDP::writeImmediately(const uint8_t *buffer, size_t size) {
@@ -168,63 +275,102 @@ size_t WiFiUDP::writeImmediately(const uint8_t *buffer, size_t size) {
 }
 
 size_t WiFiUDP::writeImmediately(const uint8_t *buffer, size_t size, IPAddress peer_ip, uint16_t peer_port) {
-    _client_sock = 0;
-    serverDrv.sendtoData(_client_sock, buffer, size, peer_ip, peer_port);
+    int sock = (_client_sock >= 0) ? _client_sock : _sock;
+    bool sent;
 
-    return size;
+    if (sock >= 0) {
+        sent = serverDrv.sendtoData(sock, buffer, size, peer_ip, peer_port);
+    } else {
+        sock = serverDrv.startClient(peer_ip, peer_port, UDP_MODE, BLOCKING_MODE);
+        if (sock < 0) {
+            return 0;
+        }
+        sent = serverDrv.sendtoData(sock, buffer, size, peer_ip, peer_port);
+        serverDrv.stopSocket(sock);
+    }
+
+    return (sent ? size : 0);
 }
 
+/* Finish the current packet and move to the next queued datagram, never blocks */
 int WiFiUDP::parsePacket() {
-    return available();
+    if (_rx_current) {
+        popRxQueue();
+    }
+    fillRxQueue();
+    // zero length datagrams can not be told apart from "no packet", skip them
+    while (_rx_count && (_rx_slots[_rx_head].len == 0)) {
+        popRxQueue();
+    }
+    if (_rx_count == 0) {
+        return 0;
+    }
+    _rx_current = true;
+    _rx_pos = 0;
+
+    return _rx_slots[_rx_head].len;
 }
 
 int WiFiUDP::read() {
+    if (available() <= 0) {
+        return -1;
+    }
+    return rxSlotData(_rx_head)[_rx_pos++];
+}
+
+/* Without parsePacket, one whole datagram is returned per call, waiting up to the receive timeout */
+int WiFiUDP::read(unsigned char *buffer, size_t len) {
     int ret;
-    uint8_t b;
+    uint32_t ip;
+    uint16_t port;
 
-    ret = serverDrv.getData(_sock, &b);
-    if (ret == 1) {
-        return b;
-    } else {
+    if (_rx_current) {
+        ret = available();
+        if ((size_t)ret > len) {
+            ret = len;
+        }
+        memcpy(buffer, (rxSlotData(_rx_head) + _rx_pos), ret);
+        _rx_pos += ret;
+        return ret;
+    }
+    if (_rx_count) {
+        _rx_last = _rx_slots[_rx_head];
+        ret = (_rx_last.len > len) ? len : _rx_last.len;
+        memcpy(buffer, rxSlotData(_rx_head), ret);
+        popRxQueue();
         return ret;
     }
-}
 
-int WiFiUDP::read(unsigned char *buffer, size_t len) {
-    return serverDrv.getDataBuf(_sock, buffer, len);
+    ret = serverDrv.recvfromData(_sock, buffer, len, false, &ip, &port);
+    if (ret >= 0) {
+        _rx_last.len = ret;
+        _rx_last.ip = ip;
+        _rx_last.port = port;
+        _rx_last.timestamp = millis();
+    }
+    return ret;
 }
 
 int WiFiUDP::peek() {
-    uint8_t b;
-    if (!available()) {
+    if (available() <= 0) {
         return -1;
     }
-    serverDrv.getData(_sock, &b, 1);
-
-    return b;
+    return rxSlotData(_rx_head)[_rx_pos];
 }
 
 void WiFiUDP::flush() {
-    while((read() > 0));
+    if (_rx_current) {
+        popRxQueue();
+    }
 }
 
 IPAddress WiFiUDP::remoteIP() {
-    uint32_t _remoteIp;
-    uint16_t _remotePort;
-
-    serverDrv.getRemoteData(_sock, &_remoteIp, &_remotePort);
-
-    IPAddress ip(_remoteIp);
+    IPAddress ip(_rx_current ? _rx_slots[_rx_head].ip : _rx_last.ip);
     return ip;
 }
 
 uint16_t WiFiUDP::remotePort() {
-    uint32_t _remoteIp;
-    uint16_t _remotePort;
-
-    serverDrv.getRemoteData(_sock, &_remoteIp, &_remotePort);
-
-    return _remotePort;
+    return (_rx_current ? _rx_slots[_rx_head].port : _rx_last.port);
 }
 
 // extend API by RTK
@@ -234,6 +380,105 @@ void WiFiUDP::setRecvTimeout(int timeout) {
     }
 }
 
+void WiFiUDP::setRxQueue(uint8_t depth, uint16_t maxSize) {
+    if ((depth == 0) || (maxSize == 0)) {
+        return;
+    }
+    free(_rx_slots);
+    free(_rx_buf);
+    _rx_slots = NULL;
+    _rx_buf = NULL;
+    _rx_depth = depth;
+    _rx_slot_size = maxSize;
+    _rx_head = 0;
+    _rx_count = 0;
+    _rx_current = false;
+    _rx_pos = 0;
+    if (_sock >= 0) {
+        allocRxQueue();
+    }
+}
+
+void WiFiUDP::setTxBufferSize(uint16_t size) {
+    if ((size == 0) || (size == _tx_size) || (_tx_len != 0)) {
+        return;
+    }
+    free(_tx_buf);
+    _tx_buf = NULL;
+    _tx_size = size;
+    if (_client_sock >= 0) {
+        _tx_buf = (uint8_t *)malloc(_tx_size);
+    }
+}
+
+uint32_t WiFiUDP::packetTimestamp() {
+    return (_rx_current ? _rx_slots[_rx_head].timestamp : _rx_last.timestamp);
+}
+
+int WiFiUDP::queuedPackets() {
+    fillRxQueue();
+    return (_rx_count - (_rx_current ? 1 : 0));
+}
+
+int WiFiUDP::sendPackets(const WiFiUDPPacket *packets, int count) {
+    int sock = _sock;
+    int sent = 0;
+
+    if (count <= 0) {
+        return 0;
+    }
+    if (sock < 0) {
+        sock = serverDrv.startClient(packets[0].ip, packets[0].port, UDP_MODE, BLOCKING_MODE);
+        if (sock < 0) {
+            return 0;
+        }
+    }
+    for (; sent < count; sent++) {
+        const WiFiUDPPacket *packet = &packets[sent];
+        if (!serverDrv.sendtoData(sock, packet->data, packet->len, packet->ip, packet->port)) {
+            break;
+        }
+    }
+    if (sock != _sock) {
+        serverDrv.stopSocket(sock);
+    }
+    return sent;
+}
+
+/* Queued datagrams are copied out first, the rest are received straight into the caller buffers */
+int WiFiUDP::receivePackets(WiFiUDPPacket *packets, int maxCount) {
+    int n = 0;
+    int ret;
+    uint32_t ip;
+    uint16_t port;
+
+    if (_rx_current) {
+        popRxQueue();
+    }
+    for (; (n < maxCount) && _rx_count; n++) {
+        rx_slot_t *slot = &_rx_slots[_rx_head];
+        WiFiUDPPacket *packet = &packets[n];
+        packet->len = (slot->len > packet->size) ? packet->size : slot->len;
+        memcpy(packet->data, rxSlotData(_rx_head), packet->len);
+        packet->ip = IPAddress(slot->ip);
+        packet->port = slot->port;
+        packet->timestamp = slot->timestamp;
+        popRxQueue();
+    }
+    for (; n < maxCount; n++) {
+        WiFiUDPPacket *packet = &packets[n];
+        ret = serverDrv.recvfromData(_sock, packet->data, packet->size, true, &ip, &port);
+        if (ret < 0) {
+            break;
+        }
+        packet->len = ret;
+        packet->ip = IPAddress(ip);
+        packet->port = port;
+        packet->timestamp = millis();
+    }
+    return n;
+}
+
 // IPv6 related
 //int WiFiUDP::enableIPv6() {
 //    return serverDrv.enableIPv6();
@@ -27,6 +27,21 @@
 
 #define UDP_TX_PACKET_MAX_SIZE 24
 
+// Largest UDP payload that fits in a single 1500 byte Ethernet frame
+#define UDP_DATAGRAM_MAX_SIZE   1472
+// Number of received datagrams buffered between parsePacket() calls
+#define UDP_RX_QUEUE_DEPTH      4
+
+// One datagram for the batch send and receive functions
+typedef struct {
+    uint8_t* data;          // payload, caller owned
+    uint16_t size;          // capacity of data, only used when receiving
+    uint16_t len;           // payload length to send, or received length
+    IPAddress ip;           // destination when sending, source when receiving
+    uint16_t port;
+    uint32_t timestamp;     // millis() when the datagram was taken from the socket
+} WiFiUDPPacket;
+
 class WiFiUDP : public UDP {
     public:
         // Constructor
@@ -99,6 +114,24 @@ class WiFiUDP : public UDP {
         // extend API by RTK
         void setRecvTimeout(int timeout);
 
+        // Set the number of buffered datagrams and the largest datagram size, call before begin()
+        void setRxQueue(uint8_t depth, uint16_t maxSize = UDP_DATAGRAM_MAX_SIZE);
+
+        // Set the largest datagram that beginPacket() / write() / endPacket() can assemble
+        void setTxBufferSize(uint16_t size);
+
+        // millis() when the current packet was taken from the socket
+        uint32_t packetTimestamp();
+
+        // Number of received datagrams waiting after the current packet
+        int queuedPackets();
+
+        // Send count datagrams in one call, returns the number sent
+        int sendPackets(const WiFiUDPPacket* packets, int count);
+
+        // Receive up to maxCount queued or pending datagrams without blocking, returns the number received
+        int receivePackets(WiFiUDPPacket* packets, int maxCount);
+
         // IPv6 related
     ////    virtual int enableIPv6();
     ////    virtual int getIPv6Status();
@@ -108,6 +141,19 @@ class WiFiUDP : public UDP {
         using Print::write;
 
     private:
+        typedef struct {
+            uint16_t len;
+            uint16_t port;
+            uint32_t ip;
+            uint32_t timestamp;
+        } rx_slot_t;
+
+        bool allocRxQueue();
+        void freeBuffers();
+        int fillRxQueue();
+        uint8_t* rxSlotData(uint8_t index);
+        void popRxQueue();
+
         int _sock;  // socket ID
         int _client_sock;
     //    int recvTimeout;
@@ -120,6 +166,22 @@ class WiFiUDP : public UDP {
         uint16_t _peer_port;
     //    uint32_t _peer_ip_v6;
     //    uint32_t _peer_port_v6;
+
+        // datagram being assembled between beginPacket() and endPacket()
+        uint8_t* _tx_buf;
+        uint16_t _tx_size;
+        uint16_t _tx_len;
+
+        // ring of whole received datagrams, the head slot is the current packet while _rx_current is set
+        rx_slot_t* _rx_slots;
+        uint8_t* _rx_buf;
+        uint8_t _rx_depth;
+        uint16_t _rx_slot_size;
+        uint8_t _rx_head;
+        uint8_t _rx_count;
+        bool _rx_current;
+        uint16_t _rx_pos;
+        rx_slot_t _rx_last;     // source of a datagram read without parsePacket()
 };
 
 #endif
@@ -0,0 +1,73 @@
+/*
+ Polls two I2C sensors in the background while loop() keeps running.
+
+ Each sensor read is a WireJob: a register address write followed by a
+ repeated start and a read. The jobs are submitted once and rerun by the
+ I2C bus thread every period ms, their callbacks run on that thread when
+ the data is in.
+
+ The addresses and registers below are for a BMP280 (0x76) and an
+ SHT3x style device (0x44), change them to match your sensors.
+ */
+
+#include <Wire.h>
+
+#define PRESSURE_ADDR       0x76
+#define PRESSURE_REG        0xF7
+#define HUMIDITY_ADDR       0x44
+
+uint8_t pressureReg = PRESSURE_REG;
+uint8_t pressureData[6];
+WireJob pressureJob;
+
+// periodic measurement at 1 mps, high repeatability, is started in setup()
+uint8_t humidityCmd[2] = {0xE0, 0x00};
+uint8_t humidityData[6];
+WireJob humidityJob;
+
+volatile uint32_t samples = 0;
+
+void onSample(WireJob& job) {
+    // runs on the bus thread, just count and let loop() print
+    if (job.done()) {
+        samples++;
+    }
+}
+
+void setup() {
+    uint8_t startPeriodic[2] = {0x21, 0x30};
+
+    Serial.begin(115200);
+    Wire.begin();
+    Wire.setClock(400000);
+
+    Wire.beginTransmission(HUMIDITY_ADDR);
+    Wire.write(startPeriodic, sizeof(startPeriodic));
+    Wire.endTransmission();
+
+    pressureJob.writeRead(PRESSURE_ADDR, &pressureReg, 1, pressureData, sizeof(pressureData));
+    pressureJob.every(100);
+    pressureJob.onComplete(onSample);
+    Wire.submit(pressureJob);
+
+    humidityJob.writeRead(HUMIDITY_ADDR, humidityCmd, sizeof(humidityCmd), humidityData, sizeof(humidityData));
+    humidityJob.every(1000);
+    humidityJob.onComplete(onSample);
+    Wire.submit(humidityJob);
+}
+
+void loop() {
+    Serial.print("Samples: ");
+    Serial.print(samples);
+    Serial.print(", pressure reads: ");
+    Serial.print(pressureJob.runs());
+    Serial.print(" (");
+    Serial.print(pressureJob.errors());
+    Serial.print(" failed), humidity reads: ");
+    Serial.print(humidityJob.runs());
+    Serial.print(" (");
+    Serial.print(humidityJob.errors());
+    Serial.println(" failed)");
+
+    delay(2000);
+}
@@ -44,11 +44,21 @@ TwoWire::TwoWire(void *pWireObj, uint32_t dwSDAPin, uint32_t dwSCLPin) {
     this->user_onRequest = NULL;
     this->pI2C = pWireObj;
 
+    this->rxBuffer = this->rxBufferDefault;
     this->rxBufferIndex = 0;
     this->rxBufferLength = 0;
     this->txAddress = 0;
+    this->txBuffer = this->txBufferDefault;
     this->txBufferLength = 0;
+    this->bufferSize = BUFFER_LENGTH;
     this->twiClock = this->TWI_CLOCK;
+
+    this->busLock = 0;
+    this->queueLock = 0;
+    this->jobSignal = 0;
+    this->jobThreadId = 0;
+    this->jobQueue = NULL;
+    this->jobRunning = NULL;
 }
 
 void TwoWire::begin() {
@@ -60,17 +70,18 @@ void TwoWire::begin() {
 
     i2c_init(((i2c_t *)this->pI2C), ((PinName)this->SDA_pin), ((PinName)this->SCL_pin));
     i2c_frequency(((i2c_t *)this->pI2C), this->twiClock);
-}
-
-void TwoWire::begin(uint8_t address = 0) {
-    amb_ard_pin_check_fun(SDA_pin, PIO_I2C);
-    amb_ard_pin_check_fun(SCL_pin, PIO_I2C);
 
-    SDA_pin = (PinName)g_APinDescription[SDA_pin].pinname;
-    SCL_pin = (PinName)g_APinDescription[SCL_pin].pinname;
+    if (this->busLock == 0) {
+        this->busLock = os_semaphore_create_arduino(1);
+        this->queueLock = os_semaphore_create_arduino(1);
+        this->jobSignal = os_semaphore_create_arduino(1);
+        os_semaphore_wait_arduino(this->jobSignal, 0);
+    }
+}
 
-    i2c_init(((i2c_t *)this->pI2C), ((PinName)this->SDA_pin), ((PinName)this->SCL_pin));
-    i2c_frequency(((i2c_t *)this->pI2C), this->twiClock);
+void TwoWire::begin(uint8_t address) {
+    (void)address;
+    begin();
 }
 
 void TwoWire::begin(int address) {
@@ -83,49 +94,159 @@ void TwoWire::end() {
 
 void TwoWire::setClock(uint32_t frequency) {
     twiClock = frequency;
+    lockBus();
     i2c_frequency(((i2c_t *)this->pI2C), this->twiClock);
+    unlockBus();
 }
 
-uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop) {
-    int readed = 0;
+void TwoWire::lockBus(void) {
+    if (busLock) {
+        os_semaphore_wait_arduino(busLock, 0xFFFFFFFF);
+    }
+}
 
-    if (quantity > BUFFER_LENGTH) {
-        quantity = BUFFER_LENGTH;
+void TwoWire::unlockBus(void) {
+    if (busLock) {
+        os_semaphore_release_arduino(busLock);
     }
+}
 
-    // perform blocking read into buffer
-    readed = i2c_read(((i2c_t *)this->pI2C), ((int)address), ((char*)&this->rxBuffer[0]), ((int)quantity), ((int)sendStop));
+// Write, then read after a repeated start, with the bus already locked
+// Returns the number of bytes read, or written if there is nothing to read, -1 on failure
+int TwoWire::transfer(uint8_t address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint8_t sendStop) {
+    int ret;
 
-    // i2c_read error;
-    if (readed != 0) {
-        printf("\r\n[ERROR] requestFrom: readed=%d, quantity=%d \n", readed, quantity);
+    if (txLength > 0) {
+        ret = i2c_write(((i2c_t *)this->pI2C), ((int)address), ((const char*)txData), ((int)txLength), ((rxLength > 0) ? 0 : ((int)sendStop)));
+        if (ret <= 0) {
+            return -1;
+        }
+    }
+    if (rxLength > 0) {
+        ret = i2c_read(((i2c_t *)this->pI2C), ((int)address), ((char*)rxData), ((int)rxLength), ((int)sendStop));
+        // depending on the HAL version success is reported as 0 or as the length read
+        if ((ret != 0) && (ret != ((int)rxLength))) {
+            return -1;
+        }
+        return (int)rxLength;
     }
+    return (int)txLength;
+}
+
+size_t TwoWire::requestBytes(uint8_t address, size_t quantity, uint8_t sendStop) {
+    int readed = 0;
 
-    /*//i2c_read error;
-    if (readed != quantity) {
-        printf("\r\n[ERROR] requestFrom: readed=%d, quantity=%d \n", readed, quantity);
-        
-        return readed;
+    if (quantity > bufferSize) {
+        quantity = bufferSize;
     }
-    rxBufferLength = readed;*/
-    
+
+    // perform blocking read into buffer
+    lockBus();
+    readed = transfer(address, NULL, 0, rxBuffer, quantity, sendStop);
+    unlockBus();
+
     // set rx buffer iterator vars
     rxBufferIndex = 0;
-    rxBufferLength = quantity;
+    if (readed < 0) {
+        printf("\r\n[ERROR] requestFrom: address=0x%02x, quantity=%d \n", address, quantity);
+        rxBufferLength = 0;
+        return 0;
+    }
+    rxBufferLength = readed;
 
-    return quantity;
+    return rxBufferLength;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop) {
+    return (uint8_t)requestBytes(address, quantity, sendStop);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint32_t iaddress, uint8_t isize, uint8_t sendStop) {
+    uint8_t reg[4];
+    int readed;
+
+    if (isize > sizeof(reg)) {
+        isize = sizeof(reg);
+    }
+    if (quantity > bufferSize) {
+        quantity = bufferSize;
+    }
+    // internal address, most significant byte first
+    for (uint8_t i = 0; i < isize; i++) {
+        reg[i] = (uint8_t)(iaddress >> ((isize - 1 - i) * 8));
+    }
+    lockBus();
+    readed = transfer(address, reg, isize, rxBuffer, quantity, sendStop);
+    unlockBus();
+
+    rxBufferIndex = 0;
+    rxBufferLength = (readed < 0) ? 0 : readed;
+    return (uint8_t)rxBufferLength;
 }
 
 uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
     return requestFrom(((uint8_t)address), ((uint8_t)quantity), ((uint8_t)true));
 }
 
-uint8_t TwoWire::requestFrom(int address, int quantity) {
-    return requestFrom(((uint8_t)address), ((uint8_t)quantity), ((uint8_t)true));
+size_t TwoWire::requestFrom(int address, int quantity) {
+    return requestBytes(((uint8_t)address), ((size_t)quantity), ((uint8_t)true));
 }
 
-uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop) {
-    return requestFrom(((uint8_t)address), ((uint8_t)quantity), ((uint8_t)sendStop));
+size_t TwoWire::requestFrom(int address, int quantity, int sendStop) {
+    return requestBytes(((uint8_t)address), ((size_t)quantity), ((uint8_t)sendStop));
+}
+
+bool TwoWire::setBufferSize(size_t size) {
+    uint8_t* rx = rxBufferDefault;
+    uint8_t* tx = txBufferDefault;
+
+    if (size > BUFFER_LENGTH) {
+        rx = (uint8_t*)malloc(size);
+        tx = (uint8_t*)malloc(size);
+        if ((rx == NULL) || (tx == NULL)) {
+            printf("\r\n[ERROR] %s %d byte buffers allocation failed\n", __FUNCTION__, size);
+            if (rx) {
+                free(rx);
+            }
+            if (tx) {
+                free(tx);
+            }
+            return false;
+        }
+    } else {
+        size = BUFFER_LENGTH;
+    }
+
+    lockBus();
+    if (rxBuffer != rxBufferDefault) {
+        free(rxBuffer);
+        free(txBuffer);
+    }
+    rxBuffer = rx;
+    txBuffer = tx;
+    bufferSize = size;
+    rxBufferIndex = 0;
+    rxBufferLength = 0;
+    txBufferLength = 0;
+    unlockBus();
+    return true;
+}
+
+size_t TwoWire::getBufferSize(void) {
+    return bufferSize;
+}
+
+int TwoWire::writeRead(uint8_t address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength) {
+    int ret;
+
+    lockBus();
+    ret = transfer(address, txData, txLength, rxData, rxLength, 1);
+    unlockBus();
+    return ret;
+}
+
+int TwoWire::readRegister(uint8_t address, uint8_t reg, uint8_t* data, size_t length) {
+    return writeRead(address, &reg, 1, data, length);
 }
 
 void TwoWire::beginTransmission(uint8_t address) {
@@ -133,7 +254,7 @@ void TwoWire::beginTransmission(uint8_t address) {
     // If target address changes, wait for 50us to avoid losing next data packet, tested ok down to 10us
     if (txAddress != address) {
        txAddress = address;
-       delay(50);
+       delayMicroseconds(50);
     }
     txBufferLength = 0;
 }
@@ -157,7 +278,9 @@ uint8_t TwoWire::endTransmission(uint8_t sendStop) {
     int length;
     uint8_t error = 0;
 
+    lockBus();
     length = i2c_write(((i2c_t *)this->pI2C), ((int)this->txAddress), ((const char*)&this->txBuffer[0]), ((int)this->txBufferLength), ((int)sendStop));
+    unlockBus();
     if ((txBufferLength > 0) && (length <= 0)) {
         error = 1;
     }
@@ -173,7 +296,7 @@ uint8_t TwoWire::endTransmission(void) {
 }
 
 size_t TwoWire::write(uint8_t data) {
-    if (txBufferLength >= BUFFER_LENGTH) {
+    if (txBufferLength >= bufferSize) {
         return 0;
     }
     txBuffer[txBufferLength++] = data;
@@ -182,7 +305,7 @@ size_t TwoWire::write(uint8_t data) {
 
 size_t TwoWire::write(const uint8_t *data, size_t quantity) {
     for (size_t i = 0; i < quantity; ++i) {
-        if (txBufferLength >= BUFFER_LENGTH) {
+        if (txBufferLength >= bufferSize) {
             return i;
         }
         txBuffer[txBufferLength++] = data[i];
@@ -222,7 +345,10 @@ void TwoWire::onReceiveService(uint8_t *inBytes, size_t numBytes, bool stop, voi
     if(!wire->user_onReceive){
         return;
     }
-    for (uint8_t i = 0; i < numBytes; ++i) {
+    if (numBytes > wire->bufferSize) {
+        numBytes = wire->bufferSize;
+    }
+    for (size_t i = 0; i < numBytes; ++i) {
         wire->rxBuffer[i] = inBytes[i];
     }
     wire->rxBufferIndex = 0;
@@ -268,5 +394,224 @@ size_t TwoWire::slaveWrite(uint8_t *buffer, size_t len) {
 
 #endif
 
+WireJob::WireJob(void) {
+    _address = 0;
+    _txData = NULL;
+    _txLength = 0;
+    _rxData = NULL;
+    _rxLength = 0;
+    _period = 0;
+    _callback = NULL;
+    _arg = NULL;
+    _status = WIRE_JOB_IDLE;
+    _length = 0;
+    _due = 0;
+    _runs = 0;
+    _errors = 0;
+    _queued = false;
+    _next = NULL;
+}
+
+void WireJob::write(uint8_t address, const uint8_t* data, size_t length) {
+    writeRead(address, data, length, NULL, 0);
+}
+
+void WireJob::read(uint8_t address, uint8_t* data, size_t length) {
+    writeRead(address, NULL, 0, data, length);
+}
+
+void WireJob::writeRead(uint8_t address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength) {
+    _address = address;
+    _txData = txData;
+    _txLength = (txData != NULL) ? txLength : 0;
+    _rxData = rxData;
+    _rxLength = (rxData != NULL) ? rxLength : 0;
+}
+
+void WireJob::every(uint32_t period) {
+    _period = period;
+}
+
+void WireJob::onComplete(wire_job_cb_t callback, void* arg) {
+    _callback = callback;
+    _arg = arg;
+}
+
+// Insert in order of due time, after the jobs due at the same time. Call with queueLock held.
+void TwoWire::enqueue(WireJob* job) {
+    WireJob** link = &jobQueue;
+
+    while ((*link != NULL) && ((int32_t)((*link)->_due - job->_due) <= 0)) {
+        link = &((*link)->_next);
+    }
+    job->_next = *link;
+    *link = job;
+}
+
+// Call with queueLock held
+bool TwoWire::unlink(WireJob* job) {
+    WireJob** link = &jobQueue;
+
+    while (*link != NULL) {
+        if (*link == job) {
+            *link = job->_next;
+            job->_next = NULL;
+            return true;
+        }
+        link = &((*link)->_next);
+    }
+    return false;
+}
+
+void TwoWire::jobThread(const void *argument) {
+    TwoWire* wire = (TwoWire*)argument;
+    WireJob* job;
+    int32_t wait;
+    int ret;
+
+    while (1) {
+        os_semaphore_wait_arduino(wire->queueLock, 0xFFFFFFFF);
+        job = wire->jobQueue;
+        wait = 0;
+        if (job != NULL) {
+            wait = (int32_t)(job->_due - millis());
+            if (wait <= 0) {
+                wire->jobQueue = job->_next;
+                job->_next = NULL;
+                wire->jobRunning = job;
+            }
+        }
+        os_semaphore_release_arduino(wire->queueLock);
+
+        if (job == NULL) {
+            os_semaphore_wait_arduino(wire->jobSignal, 0xFFFFFFFF);
+            continue;
+        }
+        if (wait > 0) {
+            // woken early by submit() when a job is due sooner
+            os_semaphore_wait_arduino(wire->jobSignal, (uint32_t)wait);
+            continue;
+        }
+
+        wire->lockBus();
+        ret = wire->transfer(job->_address, job->_txData, job->_txLength, job->_rxData, job->_rxLength, 1);
+        wire->unlockBus();
+
+        if (ret < 0) {
+            job->_length = 0;
+            job->_errors++;
+            job->_status = WIRE_JOB_FAILED;
+        } else {
+            job->_length = ret;
+            job->_status = WIRE_JOB_DONE;
+        }
+        job->_runs++;
+        if (job->_callback != NULL) {
+            job->_callback(*job);
+        }
+
+        os_semaphore_wait_arduino(wire->queueLock, 0xFFFFFFFF);
+        wire->jobRunning = NULL;
+        if (job->_period && job->_queued) {
+            job->_due += job->_period;
+            // skip the runs that were missed rather than running them back to back
+            if ((int32_t)(millis() - job->_due) > 0) {
+                job->_due = millis() + job->_period;
+            }
+            wire->enqueue(job);
+        } else {
+            job->_queued = false;
+        }
+        os_semaphore_release_arduino(wire->queueLock);
+    }
+}
+
+bool TwoWire::submit(WireJob& job) {
+    if (busLock == 0) {
+        printf("\r\n[ERROR] %s call begin() first\n", __FUNCTION__);
+        return false;
+    }
+    if (job._queued) {
+        return false;
+    }
+    if (jobThreadId == 0) {
+        jobThreadId = os_thread_create_arduino(jobThread, this, OS_PRIORITY_ABOVENORMAL, 2048);
+        if (jobThreadId == 0) {
+            printf("\r\n[ERROR] %s I2C job thread create failed\n", __FUNCTION__);
+            return false;
+        }
+    }
+
+    os_semaphore_wait_arduino(queueLock, 0xFFFFFFFF);
+    job._status = WIRE_JOB_PENDING;
+    job._length = 0;
+    job._queued = true;
+    job._due = millis();
+    enqueue(&job);
+    os_semaphore_release_arduino(queueLock);
+    os_semaphore_release_arduino(jobSignal);
+    return true;
+}
+
+bool TwoWire::cancel(WireJob& job) {
+    bool running;
+
+    if (queueLock == 0) {
+        return false;
+    }
+    os_semaphore_wait_arduino(queueLock, 0xFFFFFFFF);
+    if (!job._queued) {
+        os_semaphore_release_arduino(queueLock);
+        return false;
+    }
+    // a running job is not requeued once it completes
+    job._queued = false;
+    running = (jobRunning == &job);
+    if (!running) {
+        unlink(&job);
+        if (job._status == WIRE_JOB_PENDING) {
+            job._status = WIRE_JOB_IDLE;
+        }
+    }
+    os_semaphore_release_arduino(queueLock);
+
+    // the buffers are in use until the transaction ends, unless cancelled from the job callback
+    while (running && (jobRunning == &job) && (os_thread_get_id_arduino() != jobThreadId)) {
+        delay(1);
+    }
+    return true;
+}
+
+bool TwoWire::wait(WireJob& job, uint32_t timeout) {
+    uint32_t start = millis();
+    uint32_t runs = job._runs;
+
+    // periodic jobs stay queued, wait for their next run instead
+    while (job._queued && (job._runs == runs)) {
+        if ((millis() - start) >= timeout) {
+            return false;
+        }
+        delay(1);
+    }
+    return job.done();
+}
+
+uint8_t TwoWire::queued(void) {
+    uint8_t count = 0;
+
+    if (queueLock == 0) {
+        return 0;
+    }
+    os_semaphore_wait_arduino(queueLock, 0xFFFFFFFF);
+    for (WireJob* job = jobQueue; job != NULL; job = job->_next) {
+        count++;
+    }
+    if (jobRunning != NULL) {
+        count++;
+    }
+    os_semaphore_release_arduino(queueLock);
+    return count;
+}
+
 TwoWire Wire  = TwoWire((void *)(&i2cwire0), 28, 27);
 TwoWire Wire1  = TwoWire((void *)(&i2cwire1), 28, 27);
@@ -23,11 +23,70 @@
 
 #include "Stream.h"
 
+// Default size of the requestFrom() and beginTransmission() buffers, setBufferSize() changes it per bus
+#ifndef BUFFER_LENGTH
 #define BUFFER_LENGTH 128
+#endif
+
+#define WIRE_JOB_IDLE       0
+#define WIRE_JOB_PENDING    1       // queued or on the bus
+#define WIRE_JOB_DONE       2
+#define WIRE_JOB_FAILED     3
 
 typedef void(*user_onRequest)(void);
 typedef void(*user_onReceive)(int);
 
+class TwoWire;
+class WireJob;
+
+// Called from the bus thread when a job completes, keep it short
+typedef void (*wire_job_cb_t)(WireJob& job);
+
+// One I2C transaction run in the background by TwoWire::submit(): a write, a read, or a write
+// followed by a repeated start and a read (a register read). The job and its buffers belong to
+// the caller and must stay valid until the job is no longer pending.
+class WireJob {
+    public:
+        WireJob(void);
+
+        void write(uint8_t address, const uint8_t* data, size_t length);
+        void read(uint8_t address, uint8_t* data, size_t length);
+        void writeRead(uint8_t address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength);
+        // Run the job again every period ms once submitted, 0 to run it once
+        void every(uint32_t period);
+        void onComplete(wire_job_cb_t callback, void* arg = NULL);
+
+        uint8_t status(void) { return _status; }
+        bool pending(void) { return (_status == WIRE_JOB_PENDING); }
+        bool done(void) { return (_status == WIRE_JOB_DONE); }
+        bool failed(void) { return (_status == WIRE_JOB_FAILED); }
+        // Bytes read by the last run, or written for a write job
+        size_t length(void) { return _length; }
+        void* arg(void) { return _arg; }
+        uint32_t runs(void) { return _runs; }
+        uint32_t errors(void) { return _errors; }
+
+    private:
+        friend class TwoWire;
+
+        uint8_t _address;
+        const uint8_t* _txData;
+        size_t _txLength;
+        uint8_t* _rxData;
+        size_t _rxLength;
+        uint32_t _period;
+        wire_job_cb_t _callback;
+        void* _arg;
+
+        volatile uint8_t _status;
+        volatile size_t _length;
+        uint32_t _due;
+        uint32_t _runs;
+        uint32_t _errors;
+        bool _queued;               // periodic jobs stay queued while their last run is reported
+        WireJob* _next;
+};
+
 class TwoWire : public Stream {
     public:
         TwoWire(void *pWireObj, uint32_t dwSDAPin, uint32_t dwSCLPin);
@@ -43,8 +102,25 @@ class TwoWire : public Stream {
         uint8_t requestFrom(uint8_t, uint8_t);
         uint8_t requestFrom(uint8_t, uint8_t, uint8_t);
         uint8_t requestFrom(uint8_t, uint8_t, uint32_t, uint8_t, uint8_t);
-        uint8_t requestFrom(int, int);
-        uint8_t requestFrom(int, int, int);
+        size_t requestFrom(int, int);
+        size_t requestFrom(int, int, int);
+
+        // Resize the receive and transmit buffers, e.g. for reads of more than BUFFER_LENGTH bytes
+        bool setBufferSize(size_t size);
+        size_t getBufferSize(void);
+
+        // Blocking write, repeated start and read, e.g. of a device register
+        // Returns the number of bytes read, or -1 if the transaction failed
+        int writeRead(uint8_t address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength);
+        int readRegister(uint8_t address, uint8_t reg, uint8_t* data, size_t length);
+
+        // Queue a job on the bus thread, jobs run in order of their due time, back to back
+        bool submit(WireJob& job);
+        // Take a job off the queue, waits for it if it is on the bus
+        bool cancel(WireJob& job);
+        // Wait for a job to complete, returns true if it succeeded
+        bool wait(WireJob& job, uint32_t timeout = 1000);
+        uint8_t queued(void);
 
         void beginTransmission(uint8_t);
         void beginTransmission(int);
@@ -78,15 +154,34 @@ class TwoWire : public Stream {
     private:
         bool is_slave;
         
-        // RX Buffer
-        uint8_t rxBuffer[BUFFER_LENGTH];
-        uint8_t rxBufferIndex;
-        uint8_t rxBufferLength;
+        // RX Buffer, points to rxBufferDefault unless setBufferSize() allocated a larger one
+        uint8_t rxBufferDefault[BUFFER_LENGTH];
+        uint8_t* rxBuffer;
+        size_t rxBufferIndex;
+        size_t rxBufferLength;
 
         // TX Buffer
         uint8_t txAddress;
-        uint8_t txBuffer[BUFFER_LENGTH];
-        uint8_t txBufferLength;
+        uint8_t txBufferDefault[BUFFER_LENGTH];
+        uint8_t* txBuffer;
+        size_t txBufferLength;
+        size_t bufferSize;
+
+        // Background jobs
+        static void jobThread(const void *argument);
+        int transfer(uint8_t address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint8_t sendStop);
+        void lockBus(void);
+        void unlockBus(void);
+        size_t requestBytes(uint8_t address, size_t quantity, uint8_t sendStop);
+        void enqueue(WireJob* job);
+        bool unlink(WireJob* job);
+
+        uint32_t busLock;           // held for every transaction, foreground or background
+        uint32_t queueLock;
+        uint32_t jobSignal;
+        uint32_t jobThreadId;
+        WireJob* jobQueue;
+        WireJob* volatile jobRunning;
 
 
         // Callback user functions
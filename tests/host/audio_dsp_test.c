@@ -0,0 +1,342 @@
+// Host check of the audio analysis kernels in cores/ambpro2/audio_dsp.c against plain
+// reference implementations: levels against direct loops, the biquad cascade against a
+// double precision filter with the same Q14 coefficients, FFT power and band energies
+// against a direct DFT. Build and run with "make check".
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "audio_dsp.h"
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+static int failures = 0;
+
+static void check(int ok, const char *what, double error, double limit) {
+    printf("%-52s %s  error %.3g (limit %.3g)\n", what, (ok ? "ok  " : "FAIL"), error, limit);
+    if (!ok) {
+        failures++;
+    }
+}
+
+// Repeatable noise, independent of the host C library
+static uint32_t rng_state = 12345;
+
+static int16_t noise16(int32_t amplitude) {
+    rng_state = (rng_state * 1664525u) + 1013904223u;
+    return (int16_t)((int32_t)((rng_state >> 16) % (2 * amplitude + 1)) - amplitude);
+}
+
+static void make_signal(int16_t *x, uint32_t count, double sample_rate, int32_t noise) {
+    for (uint32_t i = 0; i < count; i++) {
+        double t = i / sample_rate;
+        double v = (9000.0 * sin(2 * M_PI * 440.0 * t)) + (6000.0 * sin(2 * M_PI * 3150.0 * t)) + noise16(noise);
+        x[i] = (int16_t)lrint(v);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Levels
+
+static void test_level(void) {
+    static int16_t x[4001];
+    audio_dsp_level_t level;
+    double sum = 0.0;
+    int32_t peak = 0;
+    uint32_t clipped = 0;
+
+    make_signal(x, 4001, 16000.0, 3000);
+    x[17] = 32767;
+    x[1000] = -32768;
+    x[4000] = -32768;
+    for (uint32_t i = 0; i < 4001; i++) {
+        int32_t a = (x[i] < 0) ? -x[i] : x[i];
+        sum += (double)x[i] * x[i];
+        if (a > peak) {
+            peak = a;
+        }
+        if ((x[i] == 32767) || (x[i] == -32768)) {
+            clipped++;
+        }
+    }
+    if (peak > 32767) {
+        peak = 32767;
+    }
+
+    // odd count also covers the scalar tail after the paired samples
+    AudioDspLevel(x, 4001, &level);
+    double rms = sqrt(sum / 4001) / 32768.0;
+    double err = fabs(level.rms - rms) / rms;
+    check((err < 1e-6), "level rms (relative)", err, 1e-6);
+    check((level.peak == peak), "level peak", fabs((double)level.peak - peak), 0);
+    check((level.clipped == clipped), "level clipped count", fabs((double)level.clipped - clipped), 0);
+
+    AudioDspLevel(x, 0, &level);
+    check(((level.rms == 0.0f) && (level.peak == 0) && (level.clipped == 0)), "level of no samples", level.rms, 0);
+}
+
+//-----------------------------------------------------------------------------
+// Biquad cascade
+
+// Direct Form I in double precision with the coefficients the kernel actually uses
+static void biquad_reference(const audio_dsp_biquad_t *bq, const int16_t *in, double *out, uint32_t count) {
+    static double stage_in[8192];
+
+    for (uint32_t n = 0; n < count; n++) {
+        stage_in[n] = in[n];
+    }
+    for (uint8_t s = 0; s < bq->stages; s++) {
+        double b0 = bq->coeffs[s][0] / 16384.0;
+        double b1 = bq->coeffs[s][1] / 16384.0;
+        double b2 = bq->coeffs[s][2] / 16384.0;
+        double na1 = bq->coeffs[s][3] / 16384.0;
+        double na2 = bq->coeffs[s][4] / 16384.0;
+        double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+        for (uint32_t n = 0; n < count; n++) {
+            double x0 = stage_in[n];
+            double y0 = (b0 * x0) + (b1 * x1) + (b2 * x2) + (na1 * y1) + (na2 * y2);
+            x2 = x1;
+            x1 = x0;
+            y2 = y1;
+            y1 = y0;
+            out[n] = y0;
+        }
+        memcpy(stage_in, out, count * sizeof(double));
+    }
+}
+
+// The same arithmetic in plain integer C: Q14 products, rounding, saturation to 16 bits
+static void biquad_integer_model(const audio_dsp_biquad_t *bq, const int16_t *in, int16_t *out, uint32_t count) {
+    static int16_t stage_in[8192];
+
+    memcpy(stage_in, in, count * sizeof(int16_t));
+    for (uint8_t s = 0; s < bq->stages; s++) {
+        const int16_t *c = bq->coeffs[s];
+        int32_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+        for (uint32_t n = 0; n < count; n++) {
+            int64_t acc = 8192 + ((int64_t)c[0] * stage_in[n]) + ((int64_t)c[1] * x1) + ((int64_t)c[2] * x2) + ((int64_t)c[3] * y1) + ((int64_t)c[4] * y2);
+            int64_t y0 = acc >> 14;
+            y0 = (y0 > 32767) ? 32767 : ((y0 < -32768) ? -32768 : y0);
+            x2 = x1;
+            x1 = stage_in[n];
+            y2 = y1;
+            y1 = (int32_t)y0;
+            out[n] = (int16_t)y0;
+        }
+        memcpy(stage_in, out, count * sizeof(int16_t));
+    }
+}
+
+// L1 norm of the impulse response of one section, or of its recursive part 1 / A(z) alone
+static double biquad_l1(const audio_dsp_biquad_t *bq, uint8_t s, int recursive_only) {
+    double b0 = recursive_only ? 1.0 : (bq->coeffs[s][0] / 16384.0);
+    double b1 = recursive_only ? 0.0 : (bq->coeffs[s][1] / 16384.0);
+    double b2 = recursive_only ? 0.0 : (bq->coeffs[s][2] / 16384.0);
+    double na1 = bq->coeffs[s][3] / 16384.0;
+    double na2 = bq->coeffs[s][4] / 16384.0;
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0, sum = 0;
+
+    for (uint32_t n = 0; n < 20000; n++) {
+        double x0 = (n == 0) ? 1.0 : 0.0;
+        double y0 = (b0 * x0) + (b1 * x1) + (b2 * x2) + (na1 * y1) + (na2 * y2);
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = y0;
+        sum += fabs(y0);
+    }
+    return sum;
+}
+
+// Worst case difference from the unrounded filter: each section rounds its output to an
+// integer, an error of up to half an LSB that its own feedback path 1 / A(z) amplifies, and
+// the error arriving from the section before passes through the whole section
+static double biquad_rounding_bound(const audio_dsp_biquad_t *bq) {
+    double bound = 0.0;
+
+    for (uint8_t s = 0; s < bq->stages; s++) {
+        bound = (bound * biquad_l1(bq, s, 0)) + (0.5 * biquad_l1(bq, s, 1));
+    }
+    return bound;
+}
+
+static void test_biquad_case(const char *name, audio_dsp_biquad_t *bq) {
+    static int16_t x[8192];
+    static int16_t y[8192];
+    static double ref[8192];
+    double max_err = 0.0;
+    double limit = biquad_rounding_bound(bq);
+    char what[64];
+
+    make_signal(x, 8192, 16000.0, 2000);
+    AudioDspBiquadReset(bq);
+    // two calls so the state carried between blocks is covered
+    AudioDspBiquadProcess(bq, x, y, 3000);
+    AudioDspBiquadProcess(bq, &x[3000], &y[3000], 8192 - 3000);
+    biquad_reference(bq, x, ref, 8192);
+    for (uint32_t n = 0; n < 8192; n++) {
+        double e = fabs(y[n] - ref[n]);
+        if (e > max_err) {
+            max_err = e;
+        }
+    }
+    snprintf(what, sizeof(what), "biquad %s (LSB)", name);
+    check((max_err <= limit), what, max_err, limit);
+
+    static int16_t exact[8192];
+    uint32_t mismatches = 0;
+    biquad_integer_model(bq, x, exact, 8192);
+    for (uint32_t n = 0; n < 8192; n++) {
+        if (y[n] != exact[n]) {
+            mismatches++;
+        }
+    }
+    snprintf(what, sizeof(what), "biquad %s, integer model", name);
+    check((mismatches == 0), what, mismatches, 0);
+}
+
+static void test_biquad(void) {
+    audio_dsp_biquad_t bq;
+    int err = 0;
+
+    // the kernel rounds every section output to 16 bits and the reference does not, the limit
+    // is the largest difference that rounding can cause, see biquad_rounding_bound()
+    memset(&bq, 0, sizeof(bq));
+    err |= AudioDspBiquadLowPass(&bq, 0, 16000.0f, 1000.0f, 0.7071f);
+    test_biquad_case("low pass, 1 stage", &bq);
+
+    memset(&bq, 0, sizeof(bq));
+    err |= AudioDspBiquadHighPass(&bq, 0, 16000.0f, 200.0f, 0.7071f);
+    err |= AudioDspBiquadLowPass(&bq, 1, 16000.0f, 4000.0f, 0.7071f);
+    test_biquad_case("high pass + low pass, 2 stages", &bq);
+
+    memset(&bq, 0, sizeof(bq));
+    err |= AudioDspBiquadBandPass(&bq, 0, 16000.0f, 3150.0f, 2.0f);
+    test_biquad_case("band pass, 1 stage", &bq);
+
+    check((err == 0), "biquad designs accepted", err, 0);
+    memset(&bq, 0, sizeof(bq));
+    check((AudioDspBiquadSet(&bq, 0, 2.5f, 0, 0, 0, 0) == -1), "biquad rejects coefficient >= 2", 0, 0);
+    check((AudioDspBiquadSet(&bq, AUDIO_DSP_BIQUAD_MAX_STAGES, 1, 0, 0, 0, 0) == -1), "biquad rejects stage out of range", 0, 0);
+}
+
+//-----------------------------------------------------------------------------
+// FFT power and band energies
+
+// Same window and normalisation as AudioDspFftPower(), evaluated as a direct DFT
+static void dft_power(const int16_t *x, uint16_t n, double *power) {
+    static double w[AUDIO_DSP_FFT_MAX_SIZE];
+
+    for (uint16_t i = 0; i < n; i++) {
+        w[i] = x[i] * ((0.5 - (0.5 * cos(2.0 * M_PI * i / n))) / 32768.0);
+    }
+    for (uint16_t k = 0; k <= (n / 2); k++) {
+        double re = 0.0, im = 0.0;
+        for (uint16_t i = 0; i < n; i++) {
+            double a = -2.0 * M_PI * (double)(((uint32_t)k * i) % n) / n;
+            re += w[i] * cos(a);
+            im += w[i] * sin(a);
+        }
+        power[k] = ((re * re) + (im * im)) * 16.0 / ((double)n * n);
+    }
+}
+
+static double band_reference(const double *power, uint16_t n, double sample_rate, double low, double high) {
+    double sum = 0.0;
+
+    for (uint16_t k = 0; k <= (n / 2); k++) {
+        double f = k * sample_rate / n;
+        if ((f >= low) && (f <= high)) {
+            sum += power[k];
+        }
+    }
+    return sum;
+}
+
+static void test_fft_size(uint16_t n) {
+    static int16_t x[AUDIO_DSP_FFT_MAX_SIZE];
+    static double ref[(AUDIO_DSP_FFT_MAX_SIZE / 2) + 1];
+    audio_dsp_fft_t fft;
+    const float *power;
+    double max_err = 0.0, peak = 0.0;
+    char what[64];
+
+    memset(&fft, 0, sizeof(fft));
+    if (AudioDspFftInit(&fft, n) != 0) {
+        check(0, "fft init", 0, 0);
+        return;
+    }
+    make_signal(x, n, 16000.0, 4000);
+    power = AudioDspFftPower(&fft, x);
+    dft_power(x, n, ref);
+    for (uint16_t k = 0; k <= (n / 2); k++) {
+        if (ref[k] > peak) {
+            peak = ref[k];
+        }
+    }
+    for (uint16_t k = 0; k <= (n / 2); k++) {
+        double e = fabs(power[k] - ref[k]) / peak;
+        if (e > max_err) {
+            max_err = e;
+        }
+    }
+    snprintf(what, sizeof(what), "fft %u power vs DFT (of peak bin)", n);
+    check((max_err < 1e-5), what, max_err, 1e-5);
+
+    // bands: a single one, then adjacent ones whose shared edges land on and between bins
+    const float edges[] = {0.0f, 300.0f, 1000.0f, 2000.0f, 3150.0f, 5000.0f, 8000.0f};
+    float energies[6];
+    double band_err = 0.0;
+    double bin_hz = 16000.0 / n;
+    AudioDspBandEnergies(&fft, 16000.0f, edges, 6, energies);
+    for (int i = 0; i < 6; i++) {
+        double r = band_reference(ref, n, 16000.0, edges[i], edges[i + 1] - (bin_hz / 2));
+        double e = fabs(energies[i] - r) / peak;
+        if (e > band_err) {
+            band_err = e;
+        }
+    }
+    double single = fabs(AudioDspBandEnergy(&fft, 16000.0f, 400.0f, 500.0f) - band_reference(ref, n, 16000.0, 400.0, 500.0)) / peak;
+    if (single > band_err) {
+        band_err = single;
+    }
+    snprintf(what, sizeof(what), "fft %u band energies vs DFT", n);
+    check((band_err < 1e-5), what, band_err, 1e-5);
+
+    AudioDspFftDeinit(&fft);
+}
+
+static void test_fft(void) {
+    audio_dsp_fft_t fft;
+    static int16_t x[1024];
+
+    for (uint32_t n = AUDIO_DSP_FFT_MIN_SIZE; n <= AUDIO_DSP_FFT_MAX_SIZE; n <<= 1) {
+        test_fft_size((uint16_t)n);
+    }
+
+    // a full scale sine centred on a bin reads 1.0
+    memset(&fft, 0, sizeof(fft));
+    AudioDspFftInit(&fft, 1024);
+    for (uint32_t i = 0; i < 1024; i++) {
+        x[i] = (int16_t)lrint(32767.0 * sin(2 * M_PI * 64 * i / 1024.0));
+    }
+    const float *power = AudioDspFftPower(&fft, x);
+    double err = fabs(power[64] - 1.0);
+    check((err < 1e-3), "fft full scale sine on bin 64", err, 1e-3);
+    AudioDspFftDeinit(&fft);
+
+    memset(&fft, 0, sizeof(fft));
+    check((AudioDspFftInit(&fft, 1000) == -1), "fft rejects size 1000", 0, 0);
+    check((AudioDspFftInit(&fft, 8192) == -1), "fft rejects size 8192", 0, 0);
+}
+
+int main(void) {
+    test_level();
+    test_biquad();
+    test_fft();
+    printf("%s: %d failed\n", (failures ? "FAILED" : "PASSED"), failures);
+    return (failures ? 1 : 0);
+}
@@ -0,0 +1,278 @@
+// Host replay of recorded detections through the object tracker in cores/ambpro2/object_tracker.c.
+// Reads the log printed by the ObjectTracking example with LOG_DETECTIONS set to 1 and reports
+// the time per tracker update, the track ID switches and how often recognition would run with
+// the track cache compared to once per detection. Run it with different settings to compare
+// them on the same recording:
+//
+//   tracker_replay [options] detections.csv      ("-" reads standard input)
+//     -i iou     minimum IoU to match a detection to a track (0.3)
+//     -g gate    fallback centre distance in track box diagonals (0.5)
+//     -b score   minimum detection score to start a track (0.5)
+//     -m hits    matches in a row to confirm a track (3)
+//     -x misses  frames a confirmed track coasts before it is dropped (10)
+//     -a         match detections of any class to a track
+//     -c conf    identities below this are recognised again (0.6)
+//     -r count   recognitions in a row for an uncertain track (3)
+//     -n frames  frames between refreshes of a settled identity, 0 never (90)
+//     -s conf    confidence the simulated recognition answers with (1.0)
+//     -v         print the tracks of every frame
+//
+// Lines that do not start with "F," or "D," are skipped, so a serial capture can be used as is.
+// A frame is "F,<ms>,<count>" followed by its detections "D,<class>,<score %>,<xmin>,<ymin>,<xmax>,<ymax>".
+// A detection line may end with ",<object>", a ground truth object number above 0 added by hand
+// or by a labelling tool. ID switches are then counted as in the MOT benchmarks, whenever an
+// object is matched to a different track than the last time it was matched. Without it, a
+// switch is a detection whose track differs from that of the detection it overlaps most in
+// the frame before (IoU 0.5 or more, same class), which misses switches across missed frames.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "object_tracker.h"
+
+#define REPLAY_LINE_LEN         256
+#define REPLAY_MAX_OBJECTS      4096    // ground truth objects followed, further ones are ignored
+#define REPLAY_SWITCH_IOU       0.5f
+
+typedef struct {
+    object_tracker_box_t box[OBJECT_TRACKER_MAX_DETECTIONS];
+    uint32_t object[OBJECT_TRACKER_MAX_DETECTIONS];     // ground truth, 0 if not labelled
+    uint32_t track[OBJECT_TRACKER_MAX_DETECTIONS];      // track id after the update, 0 if none
+    int count;
+    uint32_t ms;
+} replay_frame_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t detections;
+    uint32_t labelled;
+    double total_us;
+    double max_us;
+    uint32_t switches;
+    uint32_t recog_first;       // first recognition of a track
+    uint32_t recog_again;       // recognition of a track that already had an identity
+    uint32_t last_track[REPLAY_MAX_OBJECTS + 1];    // by ground truth object, 0 not seen yet
+} replay_result_t;
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-i iou] [-g gate] [-b score] [-m hits] [-x misses] [-a] [-c conf] [-r count] [-n frames] [-s conf] [-v] detections.csv\n", name);
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e6) + (ts.tv_nsec / 1e3);
+}
+
+static float box_iou(const object_tracker_box_t *a, const object_tracker_box_t *b) {
+    float w = ((a->xmax < b->xmax) ? a->xmax : b->xmax) - ((a->xmin > b->xmin) ? a->xmin : b->xmin);
+    float h = ((a->ymax < b->ymax) ? a->ymax : b->ymax) - ((a->ymin > b->ymin) ? a->ymin : b->ymin);
+    float inter, uni;
+
+    if ((w <= 0.0f) || (h <= 0.0f)) {
+        return 0.0f;
+    }
+    inter = w * h;
+    uni = ((a->xmax - a->xmin) * (a->ymax - a->ymin)) + ((b->xmax - b->xmin) * (b->ymax - b->ymin)) - inter;
+    return (uni > 0.0f) ? (inter / uni) : 0.0f;
+}
+
+// Track of the detection in the previous frame that overlaps this one most, 0 if none
+static uint32_t previous_track(const replay_frame_t *prev, const object_tracker_box_t *box) {
+    float best = REPLAY_SWITCH_IOU;
+    uint32_t track = 0;
+
+    for (int j = 0; j < prev->count; j++) {
+        if (prev->box[j].classes != box->classes) {
+            continue;
+        }
+        float iou = box_iou(&prev->box[j], box);
+        if (iou >= best) {
+            best = iou;
+            track = prev->track[j];
+        }
+    }
+    return track;
+}
+
+static void replay_frame(object_tracker_t *tracker, replay_frame_t *frame, const replay_frame_t *prev, replay_result_t *result, float answer, int verbose) {
+    int8_t det_track[OBJECT_TRACKER_MAX_DETECTIONS];
+    double start, elapsed;
+
+    start = now_us();
+    ObjectTrackerUpdate(tracker, frame->box, frame->count, frame->ms, det_track);
+    elapsed = now_us() - start;
+    result->total_us += elapsed;
+    if (elapsed > result->max_us) {
+        result->max_us = elapsed;
+    }
+    result->frames++;
+    result->detections += frame->count;
+
+    if (verbose) {
+        printf("frame %u at %u ms, %d detections:", result->frames, frame->ms, frame->count);
+    }
+    for (int j = 0; j < frame->count; j++) {
+        int index = det_track[j];
+        uint32_t id = (index >= 0) ? tracker->tracks[index].id : 0;
+        uint32_t object = frame->object[j];
+
+        frame->track[j] = id;
+        if (verbose) {
+            printf(" %u", id);
+        }
+        if (id == 0) {
+            continue;
+        }
+        if (object != 0) {
+            result->labelled++;
+            if (object <= REPLAY_MAX_OBJECTS) {
+                if ((result->last_track[object] != 0) && (result->last_track[object] != id)) {
+                    result->switches++;
+                }
+                result->last_track[object] = id;
+            }
+        } else {
+            uint32_t before = previous_track(prev, &frame->box[j]);
+            if ((before != 0) && (before != id)) {
+                result->switches++;
+            }
+        }
+
+        // answer every request at once, as if the model always knew the object
+        if (ObjectTrackerNeedsRecognition(tracker, index)) {
+            if (tracker->tracks[index].recognized) {
+                result->recog_again++;
+            } else {
+                result->recog_first++;
+            }
+            ObjectTrackerSetIdentity(tracker, index, "known", answer);
+        }
+    }
+    if (verbose) {
+        printf("\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    static object_tracker_t tracker;
+    static replay_frame_t frames[2];
+    static replay_result_t result;
+    object_tracker_params_t params;
+    replay_frame_t *frame = &frames[0];
+    replay_frame_t *prev = &frames[1];
+    char line[REPLAY_LINE_LEN];
+    float answer = 1.0f;
+    int verbose = 0;
+    int started = 0;
+    int expected = 0;
+    FILE *file;
+    int opt;
+
+    ObjectTrackerDefaults(&params);
+    while ((opt = getopt(argc, argv, "i:g:b:m:x:ac:r:n:s:v")) != -1) {
+        switch (opt) {
+            case 'i':
+                params.iou_threshold = strtof(optarg, NULL);
+                break;
+            case 'g':
+                params.distance_gate = strtof(optarg, NULL);
+                break;
+            case 'b':
+                params.birth_score = strtof(optarg, NULL);
+                break;
+            case 'm':
+                params.min_hits = (uint8_t)atoi(optarg);
+                break;
+            case 'x':
+                params.max_misses = (uint8_t)atoi(optarg);
+                break;
+            case 'a':
+                params.match_class = 0;
+                break;
+            case 'c':
+                params.recog_confidence = strtof(optarg, NULL);
+                break;
+            case 'r':
+                params.recog_retries = (uint8_t)atoi(optarg);
+                break;
+            case 'n':
+                params.recog_interval = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                answer = strtof(optarg, NULL);
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind != (argc - 1)) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (strcmp(argv[optind], "-") == 0) {
+        file = stdin;
+    } else if ((file = fopen(argv[optind], "r")) == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    ObjectTrackerInit(&tracker, &params);
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (strncmp(line, "D,", 2) == 0) {
+            object_tracker_box_t *box = &frame->box[frame->count];
+            int type, score;
+            unsigned int object = 0;
+            if ((expected > 0) && (frame->count < OBJECT_TRACKER_MAX_DETECTIONS) &&
+                (sscanf(&line[2], "%d,%d,%f,%f,%f,%f,%u", &type, &score, &box->xmin, &box->ymin, &box->xmax, &box->ymax, &object) >= 6)) {
+                box->score = score / 100.0f;
+                box->classes = (int16_t)type;
+                frame->object[frame->count] = object;
+                frame->count++;
+                expected--;
+            }
+            continue;
+        }
+        if (strncmp(line, "F,", 2) != 0) {
+            continue;
+        }
+        // a new frame line completes the previous frame
+        if (started) {
+            replay_frame_t *done = frame;
+            replay_frame(&tracker, frame, prev, &result, answer, verbose);
+            frame = prev;
+            prev = done;
+        }
+        frame->count = 0;
+        frame->ms = 0;
+        expected = 0;
+        sscanf(&line[2], "%u,%d", &frame->ms, &expected);
+        started = 1;
+    }
+    if (started) {
+        replay_frame(&tracker, frame, prev, &result, answer, verbose);
+    }
+    if (file != stdin) {
+        fclose(file);
+    }
+    if (result.frames == 0) {
+        fprintf(stderr, "%s: no frames found\n", argv[optind]);
+        return 1;
+    }
+
+    printf("Replayed %u frames with %u detections, %.2f per frame\n", result.frames, result.detections, (double)result.detections / result.frames);
+    printf("Tracker update: %.2f us on average, %.2f us at most\n", result.total_us / result.frames, result.max_us);
+    printf("Tracks started: %u, confirmed: %u, dropped: %u, matched detections: %u\n",
+           tracker.stats.born, tracker.stats.confirmed, tracker.stats.dropped, tracker.stats.matched);
+    printf("ID switches: %u (%s)\n", result.switches,
+           (result.labelled > 0) ? "against the ground truth objects" : "against the best overlap in the frame before");
+    printf("Recognition runs: %u with tracking (%u first, %u again), %u without\n",
+           (result.recog_first + result.recog_again), result.recog_first, result.recog_again, result.detections);
+    return 0;
+}